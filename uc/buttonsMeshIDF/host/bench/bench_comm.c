@@ -0,0 +1,33 @@
+/**
+ * @file bench_comm.c
+ * @brief mesh_comm.c compiled in whole, so the benchmarks own the TX queue:
+ *        they create it without the TX task and drain it between
+ *        iterations, keeping the enqueue cost in and the radio out.
+ */
+
+#include "../../src/mesh_comm.c"
+
+#include "bench_hooks.h"
+
+void bench_relay_command(const char* cmd) { relay_handle_command(cmd); }
+
+void bench_node_status(void) {
+    bool was_root = g_is_root;
+    g_is_root = false;
+    node_publish_status();
+    g_is_root = was_root;
+}
+
+void bench_tx_init(void) {
+    if (queue == NULL) queue = xQueueCreate(40, sizeof(tx_item_t*));
+}
+
+int bench_tx_depth(void) { return mesh_tx_queue_depth(); }
+
+void bench_tx_drain(void) {
+    tx_item_t* item;
+    while (queue && xQueueReceive(queue, &item, 0) == pdTRUE) {
+        heap_tag_free(HEAP_TAG_MESH_TX, item->msg);
+        heap_tag_free(HEAP_TAG_MESH_TX, item);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/**
+ * @file bench_hooks.h
+ * @brief C entry points into the root hot paths for the benchmarks.
+ *
+ * registry_find() and friends are static in node_root.c, so bench_root.c
+ * compiles node_root.c into itself and exports thin wrappers; bench_comm.c
+ * does the same for the TX queue in mesh_comm.c.  Nothing here changes what
+ * the wrapped functions do.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Registry, connection table and blind pair capacity of the root. */
+#define BENCH_MAX_NODES 64
+#define BENCH_MAX_BUTTONS 24
+#define BENCH_MAX_TARGETS 10
+#define BENCH_MAX_BLIND_PAIRS 32
+
+/** @brief Device ID of bench node @p i (switches and relays alike). */
+uint64_t bench_node_id(int i);
+
+/**
+ * @brief Boot the root tables at full house: a full registry, a maximal
+ *        connection table, a full blind pair table, and a relay board for
+ *        relay_handle_command().
+ */
+void bench_setup(void);
+
+// bench_root.c
+bool bench_registry_find(uint64_t id);
+void bench_registry_update(uint64_t id);
+void bench_route_button(uint64_t from_id, char button, int state);
+bool bench_blind_pair(uint64_t from_id, char button);
+
+/**
+ * @brief A connections payload for @p devices switches with @p buttons
+ *        buttons of @p targets targets each.  Caller frees.
+ */
+char* bench_connections_json(int devices, int buttons, int targets);
+
+/** @brief parse_json_connections() on the "data" member of @p json. */
+void bench_parse_connections(const void* json);
+
+/** @brief cJSON_Parse() plus parse_json_connections(), as on MQTT. */
+void bench_parse_connections_text(const char* text);
+
+void* bench_json_parse(const char* text);
+void bench_json_delete(void* json);
+
+// bench_comm.c
+void bench_relay_command(const char* cmd);
+void bench_node_status(void);
+void bench_tx_init(void);
+int bench_tx_depth(void);
+
+/** @brief Free everything waiting in the TX queue. */
+void bench_tx_drain(void);
+
+#ifdef __cplusplus
+}
+#endif
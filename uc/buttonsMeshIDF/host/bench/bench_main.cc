@@ -0,0 +1,159 @@
+/**
+ * @file bench_main.cc
+ * @brief domator_bench: Google Benchmark suite for the paths the root runs
+ *        on every press and every config push, at full house (64 nodes,
+ *        64 x 24 x 10 routes, 32 blind pairs).
+ *
+ *   domator_bench --benchmark_out=bench.json --benchmark_out_format=json
+ *
+ * Times are host times; compare runs of the same build machine against
+ * each other, not against the ESP32.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "bench_hooks.h"
+
+namespace {
+
+/** Keep the TX queue from filling; draining is not part of the timing. */
+void drain_if_needed(benchmark::State& state) {
+    if (bench_tx_depth() > 20) {
+        state.PauseTiming();
+        bench_tx_drain();
+        state.ResumeTiming();
+    }
+}
+
+// ====================
+// Registry
+// ====================
+
+// Arg: registry slot of the wanted node; BENCH_MAX_NODES means absent.
+void BM_RegistryFind(benchmark::State& state) {
+    uint64_t id = bench_node_id(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_registry_find(id));
+    }
+}
+BENCHMARK(BM_RegistryFind)->Arg(0)->Arg(BENCH_MAX_NODES - 1)
+    ->Arg(BENCH_MAX_NODES);
+
+// Arg: registry slot; BENCH_MAX_NODES is a new node with the table full.
+void BM_RegistryUpdate(benchmark::State& state) {
+    uint64_t id = bench_node_id(static_cast<int>(state.range(0)));
+    for (auto _ : state) bench_registry_update(id);
+}
+BENCHMARK(BM_RegistryUpdate)->Arg(0)->Arg(BENCH_MAX_NODES - 1)
+    ->Arg(BENCH_MAX_NODES);
+
+// ====================
+// Routing
+// ====================
+
+// Arg: connection table slot of the pressing switch.  Every button has
+// BENCH_MAX_TARGETS targets, each one registry lookup and one enqueue.
+void BM_RouteButton(benchmark::State& state) {
+    uint64_t from = bench_node_id(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        bench_route_button(from, 'x', 0);
+        drain_if_needed(state);
+    }
+    state.SetItemsProcessed(state.iterations() * BENCH_MAX_TARGETS);
+    bench_tx_drain();
+}
+BENCHMARK(BM_RouteButton)->Arg(0)->Arg(BENCH_MAX_NODES - 1);
+
+void BM_BlindPairMiss(benchmark::State& state) {
+    uint64_t from = bench_node_id(BENCH_MAX_NODES - 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_blind_pair(from, 'x'));
+    }
+}
+BENCHMARK(BM_BlindPairMiss);
+
+void BM_BlindPairHit(benchmark::State& state) {
+    uint64_t from = bench_node_id(0);
+    if (!bench_blind_pair(from, 'a')) state.SkipWithError("no blind pair");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bench_blind_pair(from, 'a'));
+    }
+}
+BENCHMARK(BM_BlindPairHit);
+
+// ====================
+// Config push
+// ====================
+
+// Args: switches, buttons, targets per button.  Tree only: the payload is
+// parsed once and parse_json_connections() rebuilds the table from it.
+void BM_ParseConnections(benchmark::State& state) {
+    char* text = bench_connections_json(static_cast<int>(state.range(0)),
+                                        static_cast<int>(state.range(1)),
+                                        static_cast<int>(state.range(2)));
+    void* json = bench_json_parse(text);
+    for (auto _ : state) bench_parse_connections(json);
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(strlen(text)));
+    bench_json_delete(json);
+    free(text);
+}
+BENCHMARK(BM_ParseConnections)
+    ->Args({8, 8, 1})
+    ->Args({BENCH_MAX_NODES, 8, 2})
+    ->Args({BENCH_MAX_NODES, BENCH_MAX_BUTTONS, BENCH_MAX_TARGETS})
+    ->Unit(benchmark::kMicrosecond);
+
+// Same, including cJSON_Parse() of the MQTT payload.
+void BM_ParseConnectionsText(benchmark::State& state) {
+    char* text = bench_connections_json(static_cast<int>(state.range(0)),
+                                        static_cast<int>(state.range(1)),
+                                        static_cast<int>(state.range(2)));
+    for (auto _ : state) bench_parse_connections_text(text);
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(strlen(text)));
+    free(text);
+}
+BENCHMARK(BM_ParseConnectionsText)
+    ->Args({8, 8, 1})
+    ->Args({BENCH_MAX_NODES, BENCH_MAX_BUTTONS, BENCH_MAX_TARGETS})
+    ->Unit(benchmark::kMicrosecond);
+
+// ====================
+// Relay and status
+// ====================
+
+void BM_RelayCommand(benchmark::State& state, const char* cmd) {
+    for (auto _ : state) {
+        bench_relay_command(cmd);
+        drain_if_needed(state);
+    }
+    bench_tx_drain();
+}
+BENCHMARK_CAPTURE(BM_RelayCommand, toggle, "c");
+BENCHMARK_CAPTURE(BM_RelayCommand, set, "c1");
+BENCHMARK_CAPTURE(BM_RelayCommand, auto_off, "Tc0");
+BENCHMARK_CAPTURE(BM_RelayCommand, invalid, "z9");
+
+void BM_NodeStatus(benchmark::State& state) {
+    for (auto _ : state) {
+        bench_node_status();
+        drain_if_needed(state);
+    }
+    bench_tx_drain();
+}
+BENCHMARK(BM_NodeStatus)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    bench_setup();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file bench_root.c
+ * @brief node_root.c compiled in whole, so the benchmarks can reach its
+ *        static registry, routing and config parsing functions.
+ */
+
+#include "../../src/node_root.c"
+
+#include "bench_hooks.h"
+#include "host_hal.h"
+
+_Static_assert(BENCH_MAX_NODES == MAX_NODES, "registry size");
+_Static_assert(BENCH_MAX_BUTTONS == MAX_BUTTONS_EXTENDED, "button count");
+_Static_assert(BENCH_MAX_TARGETS == MAX_ROUTES_PER_BUTTON, "route count");
+_Static_assert(BENCH_MAX_BLIND_PAIRS == MAX_BLIND_PAIRS, "blind pairs");
+
+uint64_t bench_node_id(int i) { return 0x020000001000ULL + (uint64_t)i; }
+
+// ====================
+// Wrappers
+// ====================
+
+bool bench_registry_find(uint64_t id) {
+    mesh_addr_t addr;
+    return registry_find(id, &addr);
+}
+
+void bench_registry_update(uint64_t id) {
+    mesh_addr_t addr;
+    host_id_to_addr(id, &addr);
+    registry_update(id, &addr, NULL);
+}
+
+void bench_route_button(uint64_t from_id, char button, int state) {
+    route_button_to_relays(from_id, button, state, NULL);
+}
+
+bool bench_blind_pair(uint64_t from_id, char button) {
+    uint64_t relay_id;
+    char power_id;
+    char dir_id;
+    return button_targets_blind_pair(from_id, button, &relay_id, &power_id,
+                                     &dir_id);
+}
+
+void* bench_json_parse(const char* text) { return cJSON_Parse(text); }
+
+void bench_json_delete(void* json) { cJSON_Delete(json); }
+
+void bench_parse_connections(const void* json) {
+    parse_json_connections(cJSON_GetObjectItem(json, "data"));
+}
+
+void bench_parse_connections_text(const char* text) {
+    cJSON* json = cJSON_Parse(text);
+    if (json == NULL) return;
+    parse_json_connections(cJSON_GetObjectItem(json, "data"));
+    cJSON_Delete(json);
+}
+
+// ====================
+// Full-house tables
+// ====================
+
+char* bench_connections_json(int devices, int buttons, int targets) {
+    size_t cap = 64 + (size_t)devices * (24 + buttons * (8 + targets * 24));
+    char* out = malloc(cap);
+    if (out == NULL) return NULL;
+    size_t n = snprintf(out, cap, "{\"type\":\"connections\",\"data\":{");
+    for (int d = 0; d < devices; d++) {
+        n += snprintf(out + n, cap - n, "%s\"%" PRIu64 "\":{", d ? "," : "",
+                      bench_node_id(d));
+        for (int b = 0; b < buttons; b++) {
+            n += snprintf(out + n, cap - n, "%s\"%c\":[", b ? "," : "",
+                          'a' + b);
+            for (int t = 0; t < targets; t++) {
+                // Targets spread over the registry, so lookups vary.
+                int relay = (d * buttons + b * targets + t) % devices;
+                n += snprintf(out + n, cap - n, "%s[%" PRIu64 ",\"%c\"]",
+                              t ? "," : "", bench_node_id(relay),
+                              'a' + (b + t) % MAX_RELAYS_8);
+            }
+            n += snprintf(out + n, cap - n, "]");
+        }
+        n += snprintf(out + n, cap - n, "}");
+    }
+    snprintf(out + n, cap - n, "}}");
+    return out;
+}
+
+/**
+ * @brief A full blind pair table on relays nothing routes to, except the
+ *        last pair: the last target of switch 0, button 'a' (relay 9,
+ *        output 'b').  Lookups either miss after scanning everything or hit
+ *        at the very end.
+ */
+static void fill_blind_pairs(void) {
+    cJSON* data = cJSON_CreateObject();
+    for (int p = 0; p < MAX_BLIND_PAIRS; p++) {
+        bool last = p == MAX_BLIND_PAIRS - 1;
+        char key[24];
+        snprintf(key, sizeof(key), "%" PRIu64,
+                 bench_node_id(last ? MAX_ROUTES_PER_BUTTON - 1
+                                    : MAX_NODES + p));
+        cJSON* pairs = cJSON_AddArrayToObject(data, key);
+        cJSON* pair = cJSON_CreateArray();
+        cJSON_AddItemToArray(pair, cJSON_CreateString(last ? "b" : "g"));
+        cJSON_AddItemToArray(pair, cJSON_CreateString(last ? "c" : "h"));
+        cJSON_AddItemToArray(pairs, pair);
+    }
+    parse_json_blind_pairs(data);
+    cJSON_Delete(data);
+}
+
+void bench_setup(void) {
+    host_log_set_level(ESP_LOG_NONE);
+    ESP_ERROR_CHECK(nvs_flash_init());
+    g_device_id = bench_node_id(-1);
+    g_is_root = true;
+    g_connections_mutex = xSemaphoreCreateMutex();
+    g_button_types_mutex = xSemaphoreCreateMutex();
+    node_root_start();
+    bench_tx_init();
+
+    for (int i = 0; i < MAX_NODES; i++) bench_registry_update(bench_node_id(i));
+
+    char* conns = bench_connections_json(MAX_NODES, MAX_BUTTONS_EXTENDED,
+                                         MAX_ROUTES_PER_BUTTON);
+    bench_parse_connections_text(conns);
+    free(conns);
+    fill_blind_pairs();
+
+    g_board_type = BOARD_TYPE_8_RELAY;
+    g_relay_mutex = xSemaphoreCreateMutex();
+    relay_init();
+    bench_tx_drain();
+}
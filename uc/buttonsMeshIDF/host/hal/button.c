@@ -0,0 +1,51 @@
+/**
+ * @file button.c
+ * @brief Button input stand-in for button_input.c: the debounced,
+ *        timestamped transitions come from host_button_event() instead of
+ *        GPIO interrupts, so the switch and relay button tasks run as on
+ *        target.
+ */
+
+#include "domator_mesh.h"
+#include "host_hal.h"
+
+#define BUTTON_QUEUE_LEN 32
+
+static QueueHandle_t s_events;
+static int s_count;
+static uint32_t s_overflows;
+
+void button_input_init(const int* pins, int count) {
+    (void)pins;
+    s_count = count;
+    if (s_events == NULL) {
+        s_events = xQueueCreate(BUTTON_QUEUE_LEN, sizeof(button_event_t));
+    }
+}
+
+bool button_input_get_event(button_event_t* ev, TickType_t max_wait) {
+    if (s_events == NULL) {
+        vTaskDelay(max_wait ? max_wait : 1);
+        return false;
+    }
+    return xQueueReceive(s_events, ev, max_wait) == pdTRUE;
+}
+
+void button_input_get_stats(uint32_t* overflows, uint32_t* missed_edges) {
+    if (overflows) *overflows = s_overflows;
+    if (missed_edges) *missed_edges = 0;
+}
+
+bool host_button_event(int index, int level) {
+    if (s_events == NULL || index < 0 || index >= s_count) return false;
+    button_event_t ev = {
+        .index = (uint8_t)index,
+        .level = level ? 1 : 0,
+        .time_us = esp_timer_get_time(),
+    };
+    if (xQueueSend(s_events, &ev, 0) != pdTRUE) {
+        s_overflows++;
+        return false;
+    }
+    return true;
+}
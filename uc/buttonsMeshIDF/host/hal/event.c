@@ -0,0 +1,103 @@
+/**
+ * @file event.c
+ * @brief Default event loop stand-in.  Posted events are copied into a
+ *        queue and dispatched by the "sys_evt" task at the priority the
+ *        ESP-IDF event task has on target.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_event.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define EVENT_TASK_PRIORITY 20
+#define EVENT_QUEUE_LEN 32
+#define MAX_HANDLERS 16
+
+esp_event_base_t const MESH_EVENT = "MESH_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+} handler_entry_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    void* data;  // malloc'd copy, freed after dispatch
+} posted_event_t;
+
+static QueueHandle_t s_queue;
+static handler_entry_t s_handlers[MAX_HANDLERS];
+static int s_handler_count;
+
+static void event_task(void* arg) {
+    (void)arg;
+    posted_event_t ev;
+    while (true) {
+        if (xQueueReceive(s_queue, &ev, portMAX_DELAY) != pdTRUE) continue;
+        for (int i = 0; i < s_handler_count; i++) {
+            handler_entry_t* h = &s_handlers[i];
+            if (h->base != ev.base) continue;
+            if (h->id != ESP_EVENT_ANY_ID && h->id != ev.id) continue;
+            h->handler(h->arg, ev.base, ev.id, ev.data);
+        }
+        free(ev.data);
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void) {
+    if (s_queue) return ESP_ERR_INVALID_STATE;
+    s_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(posted_event_t));
+    if (s_queue == NULL) return ESP_ERR_NO_MEM;
+    xTaskCreate(event_task, "sys_evt", 4096, NULL, EVENT_TASK_PRIORITY, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base,
+                                     int32_t event_id,
+                                     esp_event_handler_t event_handler,
+                                     void* event_handler_arg) {
+    if (s_handler_count >= MAX_HANDLERS) return ESP_ERR_NO_MEM;
+    s_handlers[s_handler_count++] = (handler_entry_t){
+        .base = event_base,
+        .id = event_id,
+        .handler = event_handler,
+        .arg = event_handler_arg,
+    };
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(
+    esp_event_base_t event_base, int32_t event_id,
+    esp_event_handler_t event_handler, void* event_handler_arg,
+    esp_event_handler_instance_t* instance) {
+    if (instance) *instance = NULL;
+    return esp_event_handler_register(event_base, event_id, event_handler,
+                                      event_handler_arg);
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id,
+                         const void* event_data, size_t event_data_size,
+                         TickType_t ticks_to_wait) {
+    if (s_queue == NULL) return ESP_ERR_INVALID_STATE;
+
+    posted_event_t ev = {.base = event_base, .id = event_id};
+    if (event_data && event_data_size > 0) {
+        ev.data = malloc(event_data_size);
+        if (ev.data == NULL) return ESP_ERR_NO_MEM;
+        memcpy(ev.data, event_data, event_data_size);
+    }
+    if (xQueueSend(s_queue, &ev, ticks_to_wait) != pdTRUE) {
+        free(ev.data);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
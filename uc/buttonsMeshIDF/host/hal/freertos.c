@@ -0,0 +1,757 @@
+/**
+ * @file freertos.c
+ * @brief Deterministic single-core FreeRTOS stand-in on host threads.
+ *
+ * Every task is a pthread, but exactly one of them (s_current) runs at any
+ * time; the others sit on their own condition variable.  A task gives up the
+ * CPU only inside a kernel call (delay, blocking queue operation, waking a
+ * higher-priority task, returning), and the next task is chosen the way the
+ * single-core kernel chooses it: highest ready priority, FIFO among equals,
+ * a preempted task going back to the front of its priority.
+ *
+ * Time is virtual.  It stands still while tasks run and, when every task is
+ * blocked, jumps to the earliest timeout.  Nothing depends on host timing,
+ * so a run replays identically every time.
+ *
+ * s_lock protects the scheduler state only; it is held while a task is
+ * inside one of these functions and released while it runs firmware code.
+ *
+ * Software timers and esp_timer share one timer service task at
+ * configTIMER_TASK_PRIORITY, the priority of the FreeRTOS timer task on
+ * target.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "host_hal.h"
+
+#define FOREVER UINT64_MAX
+
+typedef enum {
+    TASK_READY,
+    TASK_RUNNING,
+    TASK_BLOCKED,
+    TASK_SUSPENDED,
+    TASK_DELETED,
+} task_state_t;
+
+struct host_task {
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    TaskFunction_t code;
+    void* arg;
+    pthread_cond_t cond;
+    task_state_t state;
+    int64_t ready_seq;     // order among ready tasks of equal priority
+    const void* wait_key;  // object the task is blocked on, NULL for delays
+    uint64_t wake_us;      // timeout, FOREVER if none
+    struct host_task* next;
+};
+
+struct host_queue {
+    uint8_t* storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    char not_empty;  // wait keys: only their addresses are used
+    char not_full;
+};
+
+struct host_timer {
+    char name[configMAX_TASK_NAME_LEN];
+    uint64_t period_us;
+    bool auto_reload;
+    bool active;
+    bool deleted;
+    uint64_t due_us;
+    void* timer_id;
+    TimerCallbackFunction_t callback;  // FreeRTOS timer
+    esp_timer_cb_t esp_callback;       // esp_timer
+    void* esp_arg;
+    struct host_timer* next;
+};
+
+struct esp_timer {
+    struct host_timer base;
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct host_task* s_tasks;  // creation order, deleted ones included
+static struct host_task* s_current;
+static struct host_task* s_main;
+static UBaseType_t s_task_count;
+static uint64_t s_now_us;
+static int64_t s_back_seq;
+static int64_t s_front_seq;
+
+static struct host_timer* s_timers;
+static struct host_task* s_timer_task;
+static char s_timer_key;
+
+// ====================
+// Scheduler core
+// ====================
+
+static void fatal(const char* what) {
+    fprintf(stderr, "host scheduler: %s at %llu us\n", what,
+            (unsigned long long)s_now_us);
+    for (struct host_task* t = s_tasks; t; t = t->next) {
+        static const char* const states[] = {"ready", "running", "blocked",
+                                             "suspended", "deleted"};
+        fprintf(stderr, "  %-16s prio %2u %s%s\n", t->name, t->priority,
+                states[t->state], t->wait_key ? " (on object)" : "");
+    }
+    abort();
+}
+
+static void make_ready(struct host_task* t, bool front) {
+    t->state = TASK_READY;
+    t->ready_seq = front ? --s_front_seq : ++s_back_seq;
+    t->wait_key = NULL;
+    t->wake_us = FOREVER;
+}
+
+static struct host_task* new_task(const char* name, UBaseType_t priority) {
+    struct host_task* t = calloc(1, sizeof(*t));
+    if (t == NULL) return NULL;
+    snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+    t->priority = priority;
+    t->wake_us = FOREVER;
+    pthread_cond_init(&t->cond, NULL);
+
+    struct host_task** tail = &s_tasks;
+    while (*tail) tail = &(*tail)->next;
+    *tail = t;
+    s_task_count++;
+    return t;
+}
+
+/** @brief Take s_lock; the first thread to get here becomes task "main". */
+static void lock(void) {
+    pthread_mutex_lock(&s_lock);
+    if (s_current == NULL) {
+        s_current = new_task("main", 1);
+        if (s_current == NULL) fatal("out of memory");
+        s_current->state = TASK_RUNNING;
+        s_main = s_current;
+    }
+}
+
+static void unlock(void) { pthread_mutex_unlock(&s_lock); }
+
+/**
+ * @brief Highest-priority ready task.  When none is ready, advance the clock
+ *        to the earliest timeout and wake everything due by then.
+ */
+static struct host_task* pick_next(void) {
+    for (;;) {
+        struct host_task* best = NULL;
+        for (struct host_task* t = s_tasks; t; t = t->next) {
+            if (t->state != TASK_READY) continue;
+            if (best == NULL || t->priority > best->priority ||
+                (t->priority == best->priority &&
+                 t->ready_seq < best->ready_seq)) {
+                best = t;
+            }
+        }
+        if (best) return best;
+
+        uint64_t earliest = FOREVER;
+        for (struct host_task* t = s_tasks; t; t = t->next) {
+            if (t->state == TASK_BLOCKED && t->wake_us < earliest) {
+                earliest = t->wake_us;
+            }
+        }
+        if (earliest == FOREVER) fatal("every task is blocked forever");
+
+        s_now_us = earliest;
+        for (struct host_task* t = s_tasks; t; t = t->next) {
+            if (t->state == TASK_BLOCKED && t->wake_us <= s_now_us) {
+                make_ready(t, false);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Hand the CPU to the next task.  The caller has already set its own
+ *        state; unless it deleted itself, this returns once it runs again.
+ */
+static void reschedule(struct host_task* self) {
+    struct host_task* next = pick_next();
+    next->state = TASK_RUNNING;
+    s_current = next;
+    if (next == self) return;
+
+    pthread_cond_signal(&next->cond);
+    if (self->state == TASK_DELETED) return;
+    while (s_current != self) pthread_cond_wait(&self->cond, &s_lock);
+}
+
+/** @brief Let a higher-priority ready task run now, as the kernel would. */
+static void maybe_preempt(void) {
+    for (struct host_task* t = s_tasks; t; t = t->next) {
+        if (t->state == TASK_READY && t->priority > s_current->priority) {
+            struct host_task* self = s_current;
+            make_ready(self, true);
+            reschedule(self);
+            return;
+        }
+    }
+}
+
+/** @brief Block the current task on @p key until woken or @p wake_us. */
+static void block_on(const void* key, uint64_t wake_us) {
+    struct host_task* self = s_current;
+    self->state = TASK_BLOCKED;
+    self->wait_key = key;
+    self->wake_us = wake_us;
+    reschedule(self);
+}
+
+/** @brief Make every task blocked on @p key ready; preempt if needed. */
+static void wake_all(const void* key) {
+    bool any = false;
+    for (struct host_task* t = s_tasks; t; t = t->next) {
+        if (t->state == TASK_BLOCKED && t->wait_key == key) {
+            make_ready(t, false);
+            any = true;
+        }
+    }
+    if (any) maybe_preempt();
+}
+
+static uint64_t ticks_to_deadline(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) return FOREVER;
+    return s_now_us + (uint64_t)ticks * 1000000U / configTICK_RATE_HZ;
+}
+
+static void* task_entry(void* arg) {
+    struct host_task* t = arg;
+    pthread_mutex_lock(&s_lock);
+    while (s_current != t) pthread_cond_wait(&t->cond, &s_lock);
+    pthread_mutex_unlock(&s_lock);
+
+    t->code(t->arg);
+    vTaskDelete(NULL);  // a task function must not return; tidy up anyway
+    return NULL;
+}
+
+static struct host_task* create_task(TaskFunction_t code, const char* name,
+                                     void* arg, UBaseType_t priority) {
+    struct host_task* t = new_task(name, priority);
+    if (t == NULL) return NULL;
+    t->code = code;
+    t->arg = arg;
+    make_ready(t, false);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, task_entry, t) != 0) {
+        fatal("pthread_create failed");
+    }
+    pthread_attr_destroy(&attr);
+    return t;
+}
+
+// ====================
+// Tasks
+// ====================
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char* name,
+                       uint32_t stack_depth, void* params,
+                       UBaseType_t priority, TaskHandle_t* created_task) {
+    (void)stack_depth;
+    lock();
+    struct host_task* t = create_task(task_code, name, params, priority);
+    if (created_task) *created_task = t;
+    if (t) maybe_preempt();
+    unlock();
+    return t ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code,
+                                   const char* name, uint32_t stack_depth,
+                                   void* params, UBaseType_t priority,
+                                   TaskHandle_t* created_task,
+                                   BaseType_t core_id) {
+    (void)core_id;
+    return xTaskCreate(task_code, name, stack_depth, params, priority,
+                       created_task);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    lock();
+    struct host_task* self = s_current;
+    if (task == NULL) task = self;
+    if (task->state != TASK_DELETED) {
+        task->state = TASK_DELETED;
+        task->wait_key = NULL;
+        s_task_count--;
+    }
+    if (task != self) {
+        unlock();  // its thread stays parked on its condition variable
+        return;
+    }
+    if (self == s_main) {
+        fatal("the main task deleted itself");
+    }
+    reschedule(self);
+    unlock();
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    lock();
+    if (ticks == 0) {
+        make_ready(s_current, false);
+        reschedule(s_current);
+    } else {
+        block_on(NULL, ticks_to_deadline(ticks));
+    }
+    unlock();
+}
+
+void taskYIELD(void) { vTaskDelay(0); }
+
+TickType_t xTaskGetTickCount(void) {
+    lock();
+    TickType_t ticks =
+        (TickType_t)(s_now_us * configTICK_RATE_HZ / 1000000U);
+    unlock();
+    return ticks;
+}
+
+TickType_t xTaskGetTickCountFromISR(void) { return xTaskGetTickCount(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    lock();
+    TaskHandle_t self = s_current;
+    unlock();
+    return self;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    if (task == NULL) task = xTaskGetCurrentTaskHandle();
+    return task->name;
+}
+
+TaskHandle_t xTaskGetHandle(const char* name) {
+    lock();
+    struct host_task* found = NULL;
+    for (struct host_task* t = s_tasks; t && !found; t = t->next) {
+        if (t->state != TASK_DELETED && strcmp(t->name, name) == 0) found = t;
+    }
+    unlock();
+    return found;
+}
+
+/**
+ * @brief Take a task off the CPU until vTaskResume().  A task suspended in
+ *        vTaskDelay() returns from it when resumed, as on target; one
+ *        suspended on a queue goes back to waiting with its original
+ *        timeout, where the kernel would return a timeout.
+ */
+void vTaskSuspend(TaskHandle_t task) {
+    lock();
+    struct host_task* self = s_current;
+    if (task == NULL) task = self;
+    if (task->state != TASK_DELETED && task->state != TASK_SUSPENDED) {
+        task->state = TASK_SUSPENDED;
+        task->wait_key = NULL;
+        task->wake_us = FOREVER;
+        if (task == self) reschedule(self);
+    }
+    unlock();
+}
+
+void vTaskResume(TaskHandle_t task) {
+    lock();
+    if (task->state == TASK_SUSPENDED) {
+        make_ready(task, false);
+        maybe_preempt();
+    }
+    unlock();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    if (task == NULL) task = xTaskGetCurrentTaskHandle();
+    return task->priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 1024;  // host stacks are megabytes; report a comfortable margin
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    lock();
+    UBaseType_t n = s_task_count;
+    unlock();
+    return n;
+}
+
+BaseType_t xPortGetCoreID(void) { return 0; }
+
+// ====================
+// Queues and semaphores
+// ====================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (length == 0) return NULL;
+    struct host_queue* q = calloc(1, sizeof(*q));
+    if (q == NULL) return NULL;
+    if (item_size > 0) {
+        q->storage = calloc(length, item_size);
+        if (q->storage == NULL) {
+            free(q);
+            return NULL;
+        }
+    }
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) return;
+    free(queue->storage);
+    free(queue);
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void* item,
+                             TickType_t ticks_to_wait, bool front) {
+    lock();
+    uint64_t deadline = ticks_to_deadline(ticks_to_wait);
+    while (q->count == q->length) {
+        if (s_now_us >= deadline) {
+            unlock();
+            return errQUEUE_FULL;
+        }
+        block_on(&q->not_full, deadline);
+    }
+
+    UBaseType_t slot;
+    if (front) {
+        q->head = (q->head + q->length - 1) % q->length;
+        slot = q->head;
+    } else {
+        slot = (q->head + q->count) % q->length;
+    }
+    if (q->item_size > 0) {
+        memcpy(q->storage + (size_t)slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    wake_all(&q->not_empty);
+    unlock();
+    return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void* buffer,
+                                TickType_t ticks_to_wait, bool peek) {
+    lock();
+    uint64_t deadline = ticks_to_deadline(ticks_to_wait);
+    while (q->count == 0) {
+        if (s_now_us >= deadline) {
+            unlock();
+            return errQUEUE_EMPTY;
+        }
+        block_on(&q->not_empty, deadline);
+    }
+
+    if (q->item_size > 0 && buffer) {
+        memcpy(buffer, q->storage + (size_t)q->head * q->item_size,
+               q->item_size);
+    }
+    if (!peek) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        wake_all(&q->not_full);
+    }
+    unlock();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item,
+                            TickType_t ticks_to_wait) {
+    return queue_send(queue, item, ticks_to_wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item,
+                             TickType_t ticks_to_wait) {
+    return queue_send(queue, item, ticks_to_wait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer,
+                         TickType_t ticks_to_wait) {
+    return queue_receive(queue, buffer, ticks_to_wait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer,
+                      TickType_t ticks_to_wait) {
+    return queue_receive(queue, buffer, ticks_to_wait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    lock();
+    if (queue->item_size > 0) memcpy(queue->storage, item, queue->item_size);
+    queue->head = 0;
+    queue->count = 1;
+    wake_all(&queue->not_empty);
+    unlock();
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    lock();
+    queue->head = 0;
+    queue->count = 0;
+    wake_all(&queue->not_full);
+    unlock();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    lock();
+    UBaseType_t n = queue->count;
+    unlock();
+    return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    lock();
+    UBaseType_t n = queue->length - queue->count;
+    unlock();
+    return n;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count,
+                                           UBaseType_t initial_count) {
+    SemaphoreHandle_t sem = xQueueCreate(max_count, 0);
+    if (sem) sem->count = initial_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+// ====================
+// Timer service (FreeRTOS timers and esp_timer)
+// ====================
+
+static void timer_task(void* arg) {
+    (void)arg;
+    lock();
+    for (;;) {
+        struct host_timer* first = NULL;
+        for (struct host_timer* t = s_timers; t; t = t->next) {
+            if (t->active && (first == NULL || t->due_us < first->due_us)) {
+                first = t;
+            }
+        }
+        if (first == NULL || first->due_us > s_now_us) {
+            block_on(&s_timer_key, first ? first->due_us : FOREVER);
+            continue;
+        }
+
+        if (first->auto_reload && first->period_us > 0) {
+            first->due_us += first->period_us;
+        } else {
+            first->active = false;
+        }
+        unlock();
+        if (first->callback) {
+            first->callback(first);
+        } else {
+            first->esp_callback(first->esp_arg);
+        }
+        lock();
+    }
+}
+
+static struct host_timer* timer_new(const char* name) {
+    struct host_timer* t = calloc(1, sizeof(struct esp_timer));
+    if (t == NULL) return NULL;
+    snprintf(t->name, sizeof(t->name), "%s", name ? name : "");
+
+    lock();
+    t->next = s_timers;
+    s_timers = t;
+    if (s_timer_task == NULL) {
+        s_timer_task =
+            create_task(timer_task, "Tmr Svc", NULL, configTIMER_TASK_PRIORITY);
+        if (s_timer_task) maybe_preempt();
+    }
+    unlock();
+    return t;
+}
+
+static void timer_arm(struct host_timer* t, uint64_t delay_us, bool reload) {
+    lock();
+    t->period_us = delay_us;
+    t->auto_reload = reload;
+    t->due_us = s_now_us + delay_us;
+    t->active = true;
+    wake_all(&s_timer_key);
+    unlock();
+}
+
+static bool timer_disarm(struct host_timer* t) {
+    lock();
+    bool was_active = t->active;
+    t->active = false;
+    wake_all(&s_timer_key);
+    unlock();
+    return was_active;
+}
+
+static uint64_t ticks_to_us(TickType_t ticks) {
+    return (uint64_t)ticks * 1000000U / configTICK_RATE_HZ;
+}
+
+TimerHandle_t xTimerCreate(const char* name, TickType_t period,
+                           UBaseType_t auto_reload, void* timer_id,
+                           TimerCallbackFunction_t callback) {
+    if (period == 0 || callback == NULL) return NULL;
+    struct host_timer* t = timer_new(name);
+    if (t == NULL) return NULL;
+    t->period_us = ticks_to_us(period);
+    t->auto_reload = auto_reload;
+    t->timer_id = timer_id;
+    t->callback = callback;
+    return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    timer_arm(timer, timer->period_us, timer->auto_reload);
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    timer_disarm(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t new_period,
+                              TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    if (new_period == 0) return pdFAIL;
+    timer_arm(timer, ticks_to_us(new_period), timer->auto_reload);
+    return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    timer_disarm(timer);
+    timer->deleted = true;  // stays on the list; handles may be stale
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+    lock();
+    BaseType_t active = timer->active;
+    unlock();
+    return active;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) { return timer->timer_id; }
+
+int64_t esp_timer_get_time(void) {
+    lock();
+    int64_t now = (int64_t)s_now_us;
+    unlock();
+    return now;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
+                           esp_timer_handle_t* out_handle) {
+    if (create_args == NULL || create_args->callback == NULL ||
+        out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct host_timer* t = timer_new(create_args->name);
+    if (t == NULL) return ESP_ERR_NO_MEM;
+    t->esp_callback = create_args->callback;
+    t->esp_arg = create_args->arg;
+    *out_handle = (esp_timer_handle_t)t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    timer_arm(&timer->base, timeout_us, false);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period) {
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    timer_arm(&timer->base, period, true);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    return timer_disarm(&timer->base) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    timer->base.deleted = true;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    lock();
+    bool active = timer->base.active;
+    unlock();
+    return active;
+}
+
+// ====================
+// Host control
+// ====================
+
+uint64_t host_now_us(void) { return (uint64_t)esp_timer_get_time(); }
+
+void host_run_for_ms(uint32_t ms) {
+    if (ms > 0) vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void host_run_to_us(uint64_t us) {
+    lock();
+    if (us > s_now_us) block_on(NULL, us);
+    unlock();
+}
+
+bool host_run_until(bool (*done)(void* ctx), void* ctx, uint32_t step_ms,
+                    uint32_t timeout_ms) {
+    uint64_t end_us = host_now_us() + (uint64_t)timeout_ms * 1000U;
+    while (!done(ctx)) {
+        if (host_now_us() >= end_us) return false;
+        host_run_for_ms(step_ms ? step_ms : 1);
+    }
+    return true;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+/**
+ * @file host_hal.h
+ * @brief Control surface of the host build, used by main.c and the tests.
+ *
+ * The firmware runs unmodified on top of the stand-ins in hal/: every
+ * FreeRTOS task is a host thread, but only one runs at a time and the
+ * scheduler picks it exactly as the single-core kernel would (highest ready
+ * priority, FIFO among equals).  Time is virtual: it only moves when every
+ * task is blocked, and then jumps straight to the next wake-up, so a run is
+ * deterministic and an hour of mesh traffic takes milliseconds.
+ *
+ * The thread that calls into the HAL first becomes the task "main" at
+ * priority 1 (app_main()'s priority on target).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_mesh.h"
+
+// ====================
+// Scheduler and clock
+// ====================
+
+/** @brief Virtual microseconds since start; same as esp_timer_get_time(). */
+uint64_t host_now_us(void);
+
+/** @brief Let every other task run for @p ms of virtual time. */
+void host_run_for_ms(uint32_t ms);
+
+/** @brief Let every other task run until virtual time @p us. */
+void host_run_to_us(uint64_t us);
+
+/**
+ * @brief Run in steps of @p step_ms until @p done returns true or
+ *        @p timeout_ms elapsed.  Returns the final value of @p done.
+ */
+bool host_run_until(bool (*done)(void* ctx), void* ctx, uint32_t step_ms,
+                    uint32_t timeout_ms);
+
+// ====================
+// Node identity and mesh position
+// ====================
+
+typedef struct {
+    uint8_t mac[6];           ///< SoftAP MAC; the device ID derives from it
+    bool is_root;             ///< esp_mesh_is_root()
+    int layer;                ///< layer reported on PARENT_CONNECTED
+    uint8_t parent_bssid[6];  ///< parent reported on PARENT_CONNECTED
+    int8_t rssi;              ///< esp_wifi_sta_get_rssi()
+    int total_nodes;          ///< esp_mesh_get_total_node_num()
+} host_node_t;
+
+/**
+ * @brief Configure the node before app_main().  Defaults: root at layer 1,
+ *        MAC 02:00:00:00:00:01, RSSI -50, one node.
+ */
+void host_node_config(const host_node_t* node);
+
+/** @brief Device ID the firmware derives from @p mac. */
+uint64_t host_mac_to_id(const uint8_t mac[6]);
+
+/** @brief The mesh address of a node, as used by esp_mesh_send(). */
+void host_id_to_addr(uint64_t id, mesh_addr_t* out);
+
+// ====================
+// Mesh
+// ====================
+
+/**
+ * @brief Called for every esp_mesh_send(); the return value is what
+ *        esp_mesh_send() returns.
+ */
+typedef esp_err_t (*host_mesh_tx_hook_t)(const mesh_addr_t* to,
+                                         const uint8_t* data, size_t len,
+                                         int flag, void* ctx);
+
+/**
+ * @brief Replace the send hook.  NULL restores the default, which keeps
+ *        every frame for host_mesh_pop_sent().
+ */
+void host_mesh_set_tx_hook(host_mesh_tx_hook_t hook, void* ctx);
+
+/**
+ * @brief Take the oldest frame kept by the default hook.  @p len is the
+ *        buffer size on entry and the frame length on return.
+ */
+bool host_mesh_pop_sent(mesh_addr_t* to, void* buf, size_t* len);
+
+/** @brief Number of frames kept by the default hook. */
+size_t host_mesh_sent_count(void);
+
+/**
+ * @brief Queue a frame for esp_mesh_recv() as if it arrived from @p from.
+ *        Returns ESP_ERR_MESH_QUEUE_FULL when the receive queue is full.
+ */
+esp_err_t host_mesh_inject(const mesh_addr_t* from, const void* data,
+                           size_t len);
+
+/**
+ * @brief Take the last esp_mesh_waive_root() request, if there was one
+ *        since the previous call.
+ */
+bool host_mesh_pop_waive(mesh_vote_t* vote);
+
+// ====================
+// MQTT
+// ====================
+
+/** @brief Called for every publish while the client is connected. */
+typedef void (*host_mqtt_publish_hook_t)(const char* topic, const char* data,
+                                         int len, int qos, int retain,
+                                         void* ctx);
+
+/** @brief Replace the publish hook; NULL restores the default outbox. */
+void host_mqtt_set_publish_hook(host_mqtt_publish_hook_t hook, void* ctx);
+
+/**
+ * @brief Take the oldest publish kept by the default hook.  Topic and data
+ *        are NUL-terminated (truncated to the buffer sizes).
+ */
+bool host_mqtt_pop_published(char* topic, size_t topic_size, char* data,
+                             size_t data_size);
+
+/**
+ * @brief Deliver a message to the client.  Returns false when there is no
+ *        connected client or no subscription matches @p topic.
+ */
+bool host_mqtt_inject(const char* topic, const char* data, int len);
+
+/** @brief Drop or restore the broker connection (DISCONNECTED/CONNECTED). */
+void host_mqtt_set_connected(bool connected);
+
+// ====================
+// Buttons, GPIO, NVS, logging
+// ====================
+
+/**
+ * @brief Report a debounced transition of button @p index (1 = pressed) to
+ *        the button task, stamped with the current virtual time.  Returns
+ *        false before button_input_init() or when the event queue is full.
+ */
+bool host_button_event(int index, int level);
+
+void host_gpio_set_input(int gpio, int level);
+int host_gpio_get_output(int gpio);
+
+/** @brief Called on every gpio_set_level() that changes an output. */
+typedef void (*host_gpio_hook_t)(int gpio, int level, void* ctx);
+
+void host_gpio_set_output_hook(host_gpio_hook_t hook, void* ctx);
+
+/** @brief Forget every NVS namespace, as after a flash erase. */
+void host_nvs_reset(void);
+
+/**
+ * @brief Log level for every tag.  The default comes from the
+ *        DOMATOR_HOST_LOG environment variable (E, W, I, D or V) and is W.
+ */
+void host_log_set_level(esp_log_level_t level);
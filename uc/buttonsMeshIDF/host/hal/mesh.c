@@ -0,0 +1,440 @@
+/**
+ * @file mesh.c
+ * @brief Radio-side stand-ins: node identity, WiFi, the station netif and
+ *        ESP-MESH itself.
+ *
+ * The node does not scan or elect anything.  Shortly after esp_mesh_start()
+ * it posts the events the real stack posts once the node has joined at the
+ * position set with host_node_config(), and frames only move through the
+ * send hook and the receive queue fed by host_mesh_inject().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_mac.h"
+#include "esp_mesh.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/queue.h"
+#include "host_hal.h"
+
+#define RX_QUEUE_LEN 32
+
+/** Scan and association time before PARENT_CONNECTED. */
+#define HOST_JOIN_DELAY_MS 300
+
+typedef struct {
+    mesh_addr_t from;
+    size_t len;
+    uint8_t* data;
+} rx_frame_t;
+
+typedef struct sent_frame {
+    mesh_addr_t to;
+    size_t len;
+    struct sent_frame* next;
+    uint8_t data[];
+} sent_frame_t;
+
+struct esp_netif_obj {
+    int unused;
+};
+
+static host_node_t s_node = {
+    .mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01},
+    .is_root = true,
+    .layer = 1,
+    .rssi = -50,
+    .total_nodes = 1,
+};
+
+static struct esp_netif_obj s_sta_netif;
+static bool s_mesh_started;
+static bool s_got_ip;
+static QueueHandle_t s_rx_queue;
+static esp_timer_handle_t s_join_timer;
+
+static host_mesh_tx_hook_t s_tx_hook;
+static void* s_tx_hook_ctx;
+static sent_frame_t* s_sent_head;
+static sent_frame_t* s_sent_tail;
+static size_t s_sent_count;
+
+static bool s_waived;
+static mesh_vote_t s_waive_vote;
+
+// ====================
+// Node identity
+// ====================
+
+void host_node_config(const host_node_t* node) {
+    s_node = *node;
+    if (s_node.total_nodes < 1) s_node.total_nodes = 1;
+}
+
+uint64_t host_mac_to_id(const uint8_t mac[6]) {
+    uint64_t id = 0;
+    for (int i = 0; i < 6; i++) id = (id << 8) | mac[i];
+    return id;
+}
+
+void host_id_to_addr(uint64_t id, mesh_addr_t* out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 5; i >= 0; i--) {
+        out->addr[i] = (uint8_t)id;
+        id >>= 8;
+    }
+}
+
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type) {
+    (void)type;
+    memcpy(mac, s_node.mac, 6);
+    return ESP_OK;
+}
+
+// ====================
+// WiFi and netif
+// ====================
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config) {
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage) {
+    (void)storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) { return ESP_OK; }
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_rssi(int* rssi) {
+    *rssi = s_node.rssi;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->bssid, s_node.parent_bssid, 6);
+    snprintf((char*)ap_info->ssid, sizeof(ap_info->ssid), "%s",
+             CONFIG_ROUTER_SSID);
+    ap_info->primary = 11;
+    ap_info->rssi = s_node.rssi;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void) { return ESP_OK; }
+
+esp_netif_t* esp_netif_create_default_wifi_sta(void) { return &s_sta_netif; }
+
+esp_netif_t* esp_netif_create_default_wifi_ap(void) { return NULL; }
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* if_key) {
+    return strcmp(if_key, "WIFI_STA_DEF") == 0 ? &s_sta_netif : NULL;
+}
+
+bool esp_netif_is_netif_up(esp_netif_t* esp_netif) {
+    return esp_netif == &s_sta_netif && s_got_ip;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t* esp_netif) {
+    (void)esp_netif;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t* esp_netif,
+                                esp_netif_ip_info_t* ip_info) {
+    if (esp_netif != &s_sta_netif) return ESP_ERR_INVALID_ARG;
+    static const uint8_t ip[4] = {192, 168, 1, 50};
+    static const uint8_t mask[4] = {255, 255, 255, 0};
+    static const uint8_t gw[4] = {192, 168, 1, 1};
+    memset(ip_info, 0, sizeof(*ip_info));
+    if (!s_got_ip) return ESP_OK;
+    memcpy(&ip_info->ip.addr, ip, 4);
+    memcpy(&ip_info->netmask.addr, mask, 4);
+    memcpy(&ip_info->gw.addr, gw, 4);
+    return ESP_OK;
+}
+
+// ====================
+// Mesh configuration
+// ====================
+
+esp_err_t esp_mesh_init(void) {
+    if (s_rx_queue == NULL) {
+        s_rx_queue = xQueueCreate(RX_QUEUE_LEN, sizeof(rx_frame_t));
+        if (s_rx_queue == NULL) return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_config(const mesh_cfg_t* config) {
+    return config ? ESP_OK : ESP_ERR_MESH_ARGUMENT;
+}
+
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent) {
+    (void)enable;
+    (void)select_parent;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_switch_parent_paras(mesh_switch_parent_t* paras) {
+    memset(paras, 0, sizeof(*paras));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_switch_parent_paras(mesh_switch_parent_t* paras) {
+    (void)paras;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_max_layer(int max_layer) {
+    return max_layer > 0 ? ESP_OK : ESP_ERR_MESH_ARGUMENT;
+}
+
+esp_err_t esp_mesh_set_vote_percentage(float percentage) {
+    (void)percentage;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo) {
+    (void)topo;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_root_healing_delay(int delay_ms) {
+    (void)delay_ms;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_parent(const wifi_config_t* parent,
+                              const mesh_addr_t* parent_mesh_id,
+                              mesh_type_t my_type, int my_layer) {
+    (void)parent;
+    (void)parent_mesh_id;
+    (void)my_type;
+    (void)my_layer;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_parent_bssid(mesh_addr_t* bssid) {
+    memset(bssid, 0, sizeof(*bssid));
+    memcpy(bssid->addr, s_node.parent_bssid, 6);
+    return ESP_OK;
+}
+
+bool esp_mesh_is_root(void) { return s_node.is_root; }
+
+int esp_mesh_get_layer(void) { return s_node.layer; }
+
+int esp_mesh_get_total_node_num(void) { return s_node.total_nodes; }
+
+/** @brief Only recorded; the tests decide whether the switch happens. */
+esp_err_t esp_mesh_waive_root(const mesh_vote_t* vote, int reason) {
+    if (vote == NULL || reason != MESH_VOTE_REASON_ROOT_INITIATED) {
+        return ESP_ERR_MESH_ARGUMENT;
+    }
+    if (!s_mesh_started || !s_node.is_root) return ESP_ERR_MESH_NOT_ALLOWED;
+    s_waive_vote = *vote;
+    s_waived = true;
+    return ESP_OK;
+}
+
+bool host_mesh_pop_waive(mesh_vote_t* vote) {
+    if (!s_waived) return false;
+    if (vote) *vote = s_waive_vote;
+    s_waived = false;
+    return true;
+}
+
+/**
+ * @brief Post what the stack posts once the node has joined: PARENT_CONNECTED
+ *        and, on the root, IP_EVENT_STA_GOT_IP.
+ */
+static void join_cb(void* arg) {
+    (void)arg;
+    if (!s_mesh_started) return;
+
+    mesh_event_connected_t connected = {.self_layer = s_node.layer};
+    size_t ssid_len = strlen(CONFIG_ROUTER_SSID);
+    if (ssid_len > sizeof(connected.connected.ssid)) {
+        ssid_len = sizeof(connected.connected.ssid);
+    }
+    memcpy(connected.connected.ssid, CONFIG_ROUTER_SSID, ssid_len);
+    connected.connected.ssid_len = ssid_len;
+    memcpy(connected.connected.bssid, s_node.parent_bssid, 6);
+    connected.connected.channel = 11;
+    esp_event_post(MESH_EVENT, MESH_EVENT_PARENT_CONNECTED, &connected,
+                   sizeof(connected), portMAX_DELAY);
+
+    if (s_node.is_root) {
+        s_got_ip = true;
+        ip_event_got_ip_t got_ip = {.esp_netif = &s_sta_netif};
+        esp_netif_get_ip_info(&s_sta_netif, &got_ip.ip_info);
+        esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip),
+                       portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Post STARTED now and join HOST_JOIN_DELAY_MS later, so that, as on
+ *        target, app_main() has created its tasks before the node is
+ *        connected.
+ */
+esp_err_t esp_mesh_start(void) {
+    if (s_rx_queue == NULL) return ESP_ERR_MESH_NOT_INIT;
+    if (s_join_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = join_cb,
+            .name = "mesh_join",
+        };
+        esp_err_t err = esp_timer_create(&args, &s_join_timer);
+        if (err != ESP_OK) return err;
+    }
+    s_mesh_started = true;
+    esp_event_post(MESH_EVENT, MESH_EVENT_STARTED, NULL, 0, portMAX_DELAY);
+    esp_timer_stop(s_join_timer);
+    return esp_timer_start_once(s_join_timer, HOST_JOIN_DELAY_MS * 1000);
+}
+
+esp_err_t esp_mesh_stop(void) {
+    s_mesh_started = false;
+    s_got_ip = false;
+    esp_event_post(MESH_EVENT, MESH_EVENT_STOPPED, NULL, 0, portMAX_DELAY);
+    return ESP_OK;
+}
+
+/**
+ * @brief Leave the parent: post PARENT_DISCONNECTED now and, as the
+ *        self-organised stack would, join the same parent again
+ *        HOST_JOIN_DELAY_MS later.
+ */
+esp_err_t esp_mesh_disconnect(void) {
+    if (!s_mesh_started) return ESP_ERR_MESH_NOT_START;
+
+    mesh_event_disconnected_t disconnected = {
+        .reason = 8,  // WIFI_REASON_ASSOC_LEAVE
+    };
+    memcpy(disconnected.bssid, s_node.parent_bssid, 6);
+    s_got_ip = false;
+    esp_event_post(MESH_EVENT, MESH_EVENT_PARENT_DISCONNECTED, &disconnected,
+                   sizeof(disconnected), portMAX_DELAY);
+    esp_timer_stop(s_join_timer);
+    return esp_timer_start_once(s_join_timer, HOST_JOIN_DELAY_MS * 1000);
+}
+
+// ====================
+// Frames
+// ====================
+
+static esp_err_t keep_sent(const mesh_addr_t* to, const uint8_t* data,
+                           size_t len, int flag, void* ctx) {
+    (void)flag;
+    (void)ctx;
+    sent_frame_t* f = malloc(sizeof(*f) + len);
+    if (f == NULL) return ESP_ERR_MESH_NO_MEMORY;
+    f->to = *to;
+    f->len = len;
+    f->next = NULL;
+    memcpy(f->data, data, len);
+    if (s_sent_tail) {
+        s_sent_tail->next = f;
+    } else {
+        s_sent_head = f;
+    }
+    s_sent_tail = f;
+    s_sent_count++;
+    return ESP_OK;
+}
+
+void host_mesh_set_tx_hook(host_mesh_tx_hook_t hook, void* ctx) {
+    s_tx_hook = hook;
+    s_tx_hook_ctx = ctx;
+}
+
+bool host_mesh_pop_sent(mesh_addr_t* to, void* buf, size_t* len) {
+    sent_frame_t* f = s_sent_head;
+    if (f == NULL) return false;
+    s_sent_head = f->next;
+    if (s_sent_head == NULL) s_sent_tail = NULL;
+    s_sent_count--;
+
+    if (to) *to = f->to;
+    if (buf && len) {
+        size_t n = f->len < *len ? f->len : *len;
+        memcpy(buf, f->data, n);
+    }
+    if (len) *len = f->len;
+    free(f);
+    return true;
+}
+
+size_t host_mesh_sent_count(void) { return s_sent_count; }
+
+/** @brief A NULL destination (to the root) reaches the hook as all-zero. */
+esp_err_t esp_mesh_send(const mesh_addr_t* to, const mesh_data_t* data,
+                        int flag, const mesh_opt_t opt[], int opt_count) {
+    (void)opt;
+    (void)opt_count;
+    if (!s_mesh_started) return ESP_ERR_MESH_NOT_START;
+    if (data == NULL || data->data == NULL) return ESP_ERR_MESH_ARGUMENT;
+
+    mesh_addr_t dest = {0};
+    if (to) dest = *to;
+    host_mesh_tx_hook_t hook = s_tx_hook ? s_tx_hook : keep_sent;
+    return hook(&dest, data->data, data->size, flag, s_tx_hook_ctx);
+}
+
+esp_err_t host_mesh_inject(const mesh_addr_t* from, const void* data,
+                           size_t len) {
+    if (s_rx_queue == NULL) return ESP_ERR_MESH_NOT_INIT;
+    rx_frame_t frame = {.from = *from, .len = len, .data = malloc(len)};
+    if (frame.data == NULL) return ESP_ERR_MESH_NO_MEMORY;
+    memcpy(frame.data, data, len);
+    if (xQueueSend(s_rx_queue, &frame, 0) != pdTRUE) {
+        free(frame.data);
+        return ESP_ERR_MESH_QUEUE_FULL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_recv(mesh_addr_t* from, mesh_data_t* data, int timeout_ms,
+                        int* flag, mesh_opt_t opt[], int opt_count) {
+    (void)opt;
+    (void)opt_count;
+    if (s_rx_queue == NULL) return ESP_ERR_MESH_NOT_INIT;
+
+    TickType_t ticks =
+        timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    rx_frame_t frame;
+    if (xQueueReceive(s_rx_queue, &frame, ticks) != pdTRUE) {
+        return ESP_ERR_MESH_TIMEOUT;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (frame.len > data->size) {
+        err = ESP_ERR_MESH_ARGUMENT;  // the receive buffer is too small
+    } else {
+        memcpy(data->data, frame.data, frame.len);
+        data->size = frame.len;
+        data->proto = MESH_PROTO_BIN;
+        data->tos = MESH_TOS_P2P;
+        if (from) *from = frame.from;
+        if (flag) *flag = MESH_DATA_P2P;
+    }
+    free(frame.data);
+    return err;
+}
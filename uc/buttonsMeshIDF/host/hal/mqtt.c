@@ -0,0 +1,326 @@
+/**
+ * @file mqtt.c
+ * @brief ESP-MQTT client stand-in with the broker folded in.
+ *
+ * esp_mqtt_client_start() spawns the client task (priority 5, as on
+ * target), which reports MQTT_EVENT_CONNECTED straight away.  Everything the
+ * handler sees afterwards comes through the same task: injected messages on
+ * subscribed topics and connection changes from host_mqtt_set_connected().
+ * Publishes are handed to a hook, by default an outbox the tests drain.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host_hal.h"
+#include "mqtt_client.h"
+
+#define MQTT_TASK_PRIORITY 5
+#define MQTT_QUEUE_LEN 32
+#define MAX_SUBSCRIPTIONS 16
+
+typedef enum {
+    ITEM_CONNECT,
+    ITEM_DISCONNECT,
+    ITEM_DATA,
+    ITEM_STOP,
+} item_kind_t;
+
+typedef struct {
+    item_kind_t kind;
+    char* topic;
+    char* data;
+    int len;
+} client_item_t;
+
+struct esp_mqtt_client {
+    esp_event_handler_t handler;
+    void* handler_arg;
+    QueueHandle_t items;
+    TaskHandle_t task;
+    bool connected;
+    bool destroyed;
+    int next_msg_id;
+    int sub_count;
+    char* subs[MAX_SUBSCRIPTIONS];
+};
+
+typedef struct published {
+    char* topic;
+    char* data;
+    int len;
+    struct published* next;
+} published_t;
+
+static esp_mqtt_client_handle_t s_client;
+static host_mqtt_publish_hook_t s_publish_hook;
+static void* s_publish_hook_ctx;
+static published_t* s_pub_head;
+static published_t* s_pub_tail;
+
+// ====================
+// Topic matching
+// ====================
+
+/** @brief MQTT filter match with the single-level '+' and trailing '#'. */
+static bool topic_matches(const char* filter, const char* topic) {
+    while (*filter) {
+        if (*filter == '#') return true;
+        if (*filter == '+') {
+            while (*topic && *topic != '/') topic++;
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) return false;
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
+
+static bool is_subscribed(esp_mqtt_client_handle_t c, const char* topic) {
+    for (int i = 0; i < c->sub_count; i++) {
+        if (topic_matches(c->subs[i], topic)) return true;
+    }
+    return false;
+}
+
+// ====================
+// Client task
+// ====================
+
+static void dispatch(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t id,
+                     client_item_t* item) {
+    if (c->handler == NULL) return;
+    esp_mqtt_event_t event = {
+        .event_id = id,
+        .client = c,
+        .msg_id = 0,
+    };
+    if (item) {
+        event.topic = item->topic;
+        event.topic_len = (int)strlen(item->topic);
+        event.data = item->data;
+        event.data_len = item->len;
+        event.total_data_len = item->len;
+    }
+    c->handler(c->handler_arg, "MQTT_EVENTS", id, &event);
+}
+
+static void free_client(esp_mqtt_client_handle_t c) {
+    for (int i = 0; i < c->sub_count; i++) free(c->subs[i]);
+    vQueueDelete(c->items);
+    free(c);
+}
+
+static void mqtt_task(void* arg) {
+    esp_mqtt_client_handle_t c = arg;
+    client_item_t item;
+    while (xQueueReceive(c->items, &item, portMAX_DELAY) == pdTRUE) {
+        if (item.kind == ITEM_STOP) break;
+        switch (item.kind) {
+            case ITEM_CONNECT:
+                if (!c->connected) {
+                    c->connected = true;
+                    dispatch(c, MQTT_EVENT_CONNECTED, NULL);
+                }
+                break;
+            case ITEM_DISCONNECT:
+                if (c->connected) {
+                    c->connected = false;
+                    dispatch(c, MQTT_EVENT_DISCONNECTED, NULL);
+                }
+                break;
+            case ITEM_DATA:
+                if (c->connected && is_subscribed(c, item.topic)) {
+                    dispatch(c, MQTT_EVENT_DATA, &item);
+                }
+                break;
+            default:
+                break;
+        }
+        free(item.topic);
+        free(item.data);
+    }
+
+    while (xQueueReceive(c->items, &item, 0) == pdTRUE) {
+        free(item.topic);
+        free(item.data);
+    }
+    c->task = NULL;
+    c->connected = false;
+    if (c->destroyed) free_client(c);
+    vTaskDelete(NULL);
+}
+
+static bool post_item(esp_mqtt_client_handle_t c, item_kind_t kind,
+                      const char* topic, const char* data, int len) {
+    client_item_t item = {.kind = kind, .len = len};
+    if (topic) {
+        item.topic = strdup(topic);
+        item.data = malloc(len + 1);
+        if (item.topic == NULL || item.data == NULL) goto fail;
+        memcpy(item.data, data, len);
+        item.data[len] = '\0';
+    }
+    if (xQueueSend(c->items, &item, portMAX_DELAY) == pdTRUE) return true;
+fail:
+    free(item.topic);
+    free(item.data);
+    return false;
+}
+
+// ====================
+// Client API
+// ====================
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(
+    const esp_mqtt_client_config_t* config) {
+    if (config == NULL) return NULL;
+    esp_mqtt_client_handle_t c = calloc(1, sizeof(*c));
+    if (c == NULL) return NULL;
+    c->items = xQueueCreate(MQTT_QUEUE_LEN, sizeof(client_item_t));
+    if (c->items == NULL) {
+        free(c);
+        return NULL;
+    }
+    c->next_msg_id = 1;
+    s_client = c;
+    return c;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+                                         esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler,
+                                         void* event_handler_arg) {
+    (void)event;
+    client->handler = event_handler;
+    client->handler_arg = event_handler_arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    if (client->task) return ESP_FAIL;
+    if (xTaskCreate(mqtt_task, "mqtt_task", 6144, client, MQTT_TASK_PRIORITY,
+                    &client->task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    post_item(client, ITEM_CONNECT, NULL, NULL, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+    if (client->task == NULL) return ESP_FAIL;
+    client->connected = false;
+    post_item(client, ITEM_STOP, NULL, NULL, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client) {
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    if (s_client == client) s_client = NULL;
+    if (client->task) {
+        // The task frees the client once it has drained its queue.
+        client->destroyed = true;
+        post_item(client, ITEM_STOP, NULL, NULL, 0);
+    } else {
+        free_client(client);
+    }
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client,
+                              const char* topic, int qos) {
+    (void)qos;
+    if (!client->connected) return -1;
+    for (int i = 0; i < client->sub_count; i++) {
+        if (strcmp(client->subs[i], topic) == 0) {
+            return client->next_msg_id++;
+        }
+    }
+    if (client->sub_count >= MAX_SUBSCRIPTIONS) return -1;
+    client->subs[client->sub_count] = strdup(topic);
+    if (client->subs[client->sub_count] == NULL) return -1;
+    client->sub_count++;
+    return client->next_msg_id++;
+}
+
+static void keep_published(const char* topic, const char* data, int len,
+                           int qos, int retain, void* ctx) {
+    (void)qos;
+    (void)retain;
+    (void)ctx;
+    published_t* p = calloc(1, sizeof(*p));
+    if (p == NULL) return;
+    p->topic = strdup(topic);
+    p->data = malloc(len + 1);
+    if (p->topic == NULL || p->data == NULL) {
+        free(p->topic);
+        free(p->data);
+        free(p);
+        return;
+    }
+    memcpy(p->data, data, len);
+    p->data[len] = '\0';
+    p->len = len;
+    if (s_pub_tail) {
+        s_pub_tail->next = p;
+    } else {
+        s_pub_head = p;
+    }
+    s_pub_tail = p;
+}
+
+/** @brief len 0 means a NUL-terminated payload; QoS 0 returns msg_id 0. */
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client,
+                            const char* topic, const char* data, int len,
+                            int qos, int retain) {
+    if (client == NULL || !client->connected) return -1;
+    if (data == NULL) data = "";
+    if (len <= 0) len = (int)strlen(data);
+
+    host_mqtt_publish_hook_t hook =
+        s_publish_hook ? s_publish_hook : keep_published;
+    hook(topic, data, len, qos, retain, s_publish_hook_ctx);
+    return qos > 0 ? client->next_msg_id++ : 0;
+}
+
+// ====================
+// Host control
+// ====================
+
+void host_mqtt_set_publish_hook(host_mqtt_publish_hook_t hook, void* ctx) {
+    s_publish_hook = hook;
+    s_publish_hook_ctx = ctx;
+}
+
+bool host_mqtt_pop_published(char* topic, size_t topic_size, char* data,
+                             size_t data_size) {
+    published_t* p = s_pub_head;
+    if (p == NULL) return false;
+    s_pub_head = p->next;
+    if (s_pub_head == NULL) s_pub_tail = NULL;
+
+    if (topic && topic_size) snprintf(topic, topic_size, "%s", p->topic);
+    if (data && data_size) snprintf(data, data_size, "%s", p->data);
+    free(p->topic);
+    free(p->data);
+    free(p);
+    return true;
+}
+
+bool host_mqtt_inject(const char* topic, const char* data, int len) {
+    esp_mqtt_client_handle_t c = s_client;
+    if (c == NULL || c->task == NULL || !c->connected) return false;
+    if (!is_subscribed(c, topic)) return false;
+    if (len < 0) len = (int)strlen(data);
+    return post_item(c, ITEM_DATA, topic, data, len);
+}
+
+void host_mqtt_set_connected(bool connected) {
+    esp_mqtt_client_handle_t c = s_client;
+    if (c == NULL || c->task == NULL) return;
+    post_item(c, connected ? ITEM_CONNECT : ITEM_DISCONNECT, NULL, NULL, 0);
+}
@@ -0,0 +1,228 @@
+/**
+ * @file nvs.c
+ * @brief In-memory NVS: typed entries per namespace with the error codes of
+ *        the real API (NOT_FOUND, READ_ONLY, INVALID_LENGTH, TYPE_MISMATCH).
+ *        Writes are visible at once; nvs_commit() has nothing to do.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#define NVS_KEY_NAME_MAX_SIZE 16
+#define MAX_HANDLES 32
+
+typedef enum {
+    TYPE_U8,
+    TYPE_U16,
+    TYPE_U32,
+    TYPE_U64,
+    TYPE_BLOB,
+} entry_type_t;
+
+typedef struct entry {
+    char ns[NVS_KEY_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    entry_type_t type;
+    size_t len;
+    uint8_t* value;
+    struct entry* next;
+} entry_t;
+
+typedef struct {
+    bool used;
+    bool writable;
+    char ns[NVS_KEY_NAME_MAX_SIZE];
+} handle_t;
+
+static entry_t* s_entries;
+static handle_t s_handles[MAX_HANDLES];
+static bool s_initialized;
+
+esp_err_t nvs_flash_init(void) {
+    s_initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    host_nvs_reset();
+    return ESP_OK;
+}
+
+void host_nvs_reset(void) {
+    while (s_entries) {
+        entry_t* e = s_entries;
+        s_entries = e->next;
+        free(e->value);
+        free(e);
+    }
+}
+
+static bool name_ok(const char* name) {
+    return name && name[0] && strlen(name) < NVS_KEY_NAME_MAX_SIZE;
+}
+
+static handle_t* get_handle(nvs_handle_t h) {
+    if (h == 0 || h > MAX_HANDLES || !s_handles[h - 1].used) return NULL;
+    return &s_handles[h - 1];
+}
+
+static entry_t* find(const char* ns, const char* key) {
+    for (entry_t* e = s_entries; e; e = e->next) {
+        if (strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+/** @brief A read-only open of a namespace never written fails, as on flash. */
+esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle) {
+    if (!s_initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!name_ok(namespace_name)) return ESP_ERR_NVS_INVALID_NAME;
+    if (open_mode == NVS_READONLY) {
+        bool exists = false;
+        for (entry_t* e = s_entries; e && !exists; e = e->next) {
+            exists = strcmp(e->ns, namespace_name) == 0;
+        }
+        if (!exists) return ESP_ERR_NVS_NOT_FOUND;
+    }
+    for (int i = 0; i < MAX_HANDLES; i++) {
+        if (s_handles[i].used) continue;
+        s_handles[i].used = true;
+        s_handles[i].writable = open_mode == NVS_READWRITE;
+        strcpy(s_handles[i].ns, namespace_name);
+        *out_handle = (nvs_handle_t)(i + 1);
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    handle_t* h = get_handle(handle);
+    if (h) h->used = false;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return get_handle(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+static esp_err_t set_entry(nvs_handle_t handle, const char* key,
+                           entry_type_t type, const void* value, size_t len) {
+    handle_t* h = get_handle(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!h->writable) return ESP_ERR_NVS_READ_ONLY;
+    if (!name_ok(key)) return ESP_ERR_NVS_INVALID_NAME;
+
+    uint8_t* copy = malloc(len ? len : 1);
+    if (copy == NULL) return ESP_ERR_NO_MEM;
+    memcpy(copy, value, len);
+
+    entry_t* e = find(h->ns, key);
+    if (e == NULL) {
+        e = calloc(1, sizeof(*e));
+        if (e == NULL) {
+            free(copy);
+            return ESP_ERR_NO_MEM;
+        }
+        strcpy(e->ns, h->ns);
+        strcpy(e->key, key);
+        e->next = s_entries;
+        s_entries = e;
+    }
+    free(e->value);
+    e->type = type;
+    e->value = copy;
+    e->len = len;
+    return ESP_OK;
+}
+
+static esp_err_t get_entry(nvs_handle_t handle, const char* key,
+                           entry_type_t type, void* out, size_t len) {
+    handle_t* h = get_handle(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    entry_t* e = find(h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (e->type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+    memcpy(out, e->value, len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    handle_t* h = get_handle(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!h->writable) return ESP_ERR_NVS_READ_ONLY;
+    for (entry_t** p = &s_entries; *p; p = &(*p)->next) {
+        entry_t* e = *p;
+        if (strcmp(e->ns, h->ns) == 0 && strcmp(e->key, key) == 0) {
+            *p = e->next;
+            free(e->value);
+            free(e);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    handle_t* h = get_handle(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!h->writable) return ESP_ERR_NVS_READ_ONLY;
+    for (entry_t** p = &s_entries; *p;) {
+        entry_t* e = *p;
+        if (strcmp(e->ns, h->ns) == 0) {
+            *p = e->next;
+            free(e->value);
+            free(e);
+        } else {
+            p = &e->next;
+        }
+    }
+    return ESP_OK;
+}
+
+#define NVS_INT(suffix, type, tag)                                            \
+    esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char* key,          \
+                               type* out) {                                   \
+        return get_entry(handle, key, tag, out, sizeof(type));                \
+    }                                                                         \
+    esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char* key,          \
+                               type value) {                                  \
+        return set_entry(handle, key, tag, &value, sizeof(type));             \
+    }
+
+NVS_INT(u8, uint8_t, TYPE_U8)
+NVS_INT(u16, uint16_t, TYPE_U16)
+NVS_INT(u32, uint32_t, TYPE_U32)
+NVS_INT(u64, uint64_t, TYPE_U64)
+
+/**
+ * @brief Blob read with the real length rules: a NULL @p out only reports
+ *        the length, a short buffer fails with INVALID_LENGTH.
+ */
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out,
+                       size_t* length) {
+    handle_t* h = get_handle(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    entry_t* e = find(h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (e->type != TYPE_BLOB) return ESP_ERR_NVS_TYPE_MISMATCH;
+    if (out == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        *length = e->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, e->value, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key,
+                       const void* value, size_t length) {
+    return set_entry(handle, key, TYPE_BLOB, value, length);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file stubs.c
+ * @brief Host versions of the firmware modules that only make sense on the
+ *        board: the LED strip driver, OTA and the health monitor, the telnet
+ *        shell, and the task/heap statistics that read FreeRTOS and heap
+ *        internals.  Tasks delete themselves; reports come back empty.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "led_strip.h"
+
+// ====================
+// Status LED
+// ====================
+
+struct led_strip_t {
+    uint8_t rgb[3];
+};
+
+static struct led_strip_t s_strip;
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t* led_config,
+                                   const led_strip_rmt_config_t* rmt_config,
+                                   led_strip_handle_t* ret_strip) {
+    (void)led_config;
+    (void)rmt_config;
+    *ret_strip = &s_strip;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index,
+                              uint32_t red, uint32_t green, uint32_t blue) {
+    if (index != 0) return ESP_ERR_INVALID_ARG;
+    strip->rgb[0] = (uint8_t)red;
+    strip->rgb[1] = (uint8_t)green;
+    strip->rgb[2] = (uint8_t)blue;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip) {
+    (void)strip;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip) {
+    memset(strip->rgb, 0, sizeof(strip->rgb));
+    return ESP_OK;
+}
+
+// ====================
+// OTA, health, telnet
+// ====================
+
+void ota_task(void* arg) {
+    (void)arg;
+    vTaskDelete(NULL);
+}
+
+void health_monitor_task(void* arg) {
+    (void)arg;
+    vTaskDelete(NULL);
+}
+
+void telnet_start(void) {}
+
+void telnet_stop(void) {}
+
+int shell_printf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+}
+
+// ====================
+// Task and heap statistics
+// ====================
+
+void task_stats_register_queue(const char* name, QueueHandle_t q) {
+    (void)name;
+    (void)q;
+}
+
+void task_stats_note_queue(QueueHandle_t q) { (void)q; }
+
+void task_stats_sample(void) {}
+
+void task_stats_add_summary(struct cJSON* json) { (void)json; }
+
+void task_stats_build_msg(mesh_app_msg_t* msg) {
+    task_stats_hdr_t hdr = {0};
+    memset(msg, 0, sizeof(*msg));
+    msg->src_id = g_device_id;
+    msg->msg_type = MSG_TYPE_TASK_STATS;
+    memcpy(msg->data, &hdr, sizeof(hdr));
+    msg->data_len = sizeof(hdr);
+}
+
+void heap_stats_init(void) {}
+
+void heap_stats_add_summary(struct cJSON* json) { (void)json; }
@@ -0,0 +1,318 @@
+/**
+ * @file system.c
+ * @brief System service stand-ins: logging, error names, reset and heap
+ *        queries, the cycle counter, GPIO, SNTP and the wall clock.
+ *
+ * The wall clock is a fixed epoch plus virtual time plus whatever offset
+ * settimeofday()/adjtime() applied, so time_sync.c can step and slew it
+ * without touching the host's clock.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "driver/gpio.h"
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_sntp.h"
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "host_compat.h"
+#include "host_hal.h"
+
+// host_compat.h redirects these for the firmware; here they must be real.
+#undef gettimeofday
+#undef settimeofday
+#undef adjtime
+#undef time
+#undef strlcpy
+
+/** Wall clock at virtual time 0: 2024-01-01T00:00:00Z. */
+#define HOST_EPOCH_S 1704067200LL
+
+#define HOST_HEAP_SIZE (200 * 1024)
+
+// ====================
+// Logging
+// ====================
+
+static esp_log_level_t s_log_level = ESP_LOG_WARN;
+static bool s_log_level_set;
+static vprintf_like_t s_log_vprintf;
+
+static esp_log_level_t level_from_env(void) {
+    const char* env = getenv("DOMATOR_HOST_LOG");
+    if (env == NULL) return ESP_LOG_WARN;
+    switch (env[0]) {
+        case 'N':
+            return ESP_LOG_NONE;
+        case 'E':
+            return ESP_LOG_ERROR;
+        case 'I':
+            return ESP_LOG_INFO;
+        case 'D':
+            return ESP_LOG_DEBUG;
+        case 'V':
+            return ESP_LOG_VERBOSE;
+        default:
+            return ESP_LOG_WARN;
+    }
+}
+
+void host_log_set_level(esp_log_level_t level) {
+    s_log_level = level;
+    s_log_level_set = true;
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    (void)tag;  // one level for every tag
+    host_log_set_level(level);
+}
+
+esp_log_level_t esp_log_level_get(const char* tag) {
+    (void)tag;
+    if (!s_log_level_set) host_log_set_level(level_from_env());
+    return s_log_level;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    vprintf_like_t prev = s_log_vprintf;
+    s_log_vprintf = func;
+    return prev;
+}
+
+static int log_to_stderr(const char* format, va_list args) {
+    return vfprintf(stderr, format, args);
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format,
+                   ...) {
+    (void)level;
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    (s_log_vprintf ? s_log_vprintf : log_to_stderr)(format, args);
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+        case ESP_FAIL:
+            return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:
+            return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:
+            return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:
+            return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:
+            return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_FOUND:
+            return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_READ_ONLY:
+            return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_INVALID_HANDLE:
+            return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_INVALID_LENGTH:
+            return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_MESH_NOT_START:
+            return "ESP_ERR_MESH_NOT_START";
+        case ESP_ERR_MESH_ARGUMENT:
+            return "ESP_ERR_MESH_ARGUMENT";
+        case ESP_ERR_MESH_TIMEOUT:
+            return "ESP_ERR_MESH_TIMEOUT";
+        case ESP_ERR_MESH_QUEUE_FULL:
+            return "ESP_ERR_MESH_QUEUE_FULL";
+        case ESP_ERR_MESH_NO_ROUTE_FOUND:
+            return "ESP_ERR_MESH_NO_ROUTE_FOUND";
+        case ESP_ERR_MESH_DISCONNECTED:
+            return "ESP_ERR_MESH_DISCONNECTED";
+        default:
+            return "UNKNOWN ERROR";
+    }
+}
+
+// ====================
+// Reset, heap, CPU
+// ====================
+
+esp_reset_reason_t esp_reset_reason(void) { return ESP_RST_POWERON; }
+
+void esp_restart(void) {
+    fflush(NULL);
+    fprintf(stderr, "esp_restart() at %lld us: exiting\n",
+            (long long)esp_timer_get_time());
+    exit(3);
+}
+
+uint32_t esp_get_free_heap_size(void) { return HOST_HEAP_SIZE; }
+
+uint32_t esp_get_minimum_free_heap_size(void) { return HOST_HEAP_SIZE; }
+
+/** @brief Host monotonic nanoseconds, so profiler numbers are real. */
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000U +
+                                   (uint64_t)ts.tv_nsec);
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void) { return 1000; }
+
+void esp_rom_delay_us(uint32_t us) { (void)us; }
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task_handle) {
+    (void)task_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_delete(TaskHandle_t task_handle) {
+    (void)task_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset(void) { return ESP_OK; }
+
+// ====================
+// GPIO
+// ====================
+
+static uint8_t s_gpio_input[GPIO_NUM_MAX];
+static uint8_t s_gpio_output[GPIO_NUM_MAX];
+static host_gpio_hook_t s_gpio_hook;
+static void* s_gpio_hook_ctx;
+
+esp_err_t gpio_config(const gpio_config_t* config) {
+    if (config == NULL || config->pin_bit_mask >> GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return 0;
+    return s_gpio_input[gpio_num];
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    uint8_t value = level ? 1 : 0;
+    if (s_gpio_output[gpio_num] == value) return ESP_OK;
+    s_gpio_output[gpio_num] = value;
+    if (s_gpio_hook) s_gpio_hook(gpio_num, value, s_gpio_hook_ctx);
+    return ESP_OK;
+}
+
+void host_gpio_set_input(int gpio, int level) {
+    if (gpio >= 0 && gpio < GPIO_NUM_MAX) s_gpio_input[gpio] = level ? 1 : 0;
+}
+
+int host_gpio_get_output(int gpio) {
+    if (gpio < 0 || gpio >= GPIO_NUM_MAX) return 0;
+    return s_gpio_output[gpio];
+}
+
+void host_gpio_set_output_hook(host_gpio_hook_t hook, void* ctx) {
+    s_gpio_hook = hook;
+    s_gpio_hook_ctx = ctx;
+}
+
+// ====================
+// Wall clock and SNTP
+// ====================
+
+static int64_t s_wall_offset_us;
+static sntp_sync_time_cb_t s_sntp_cb;
+static bool s_sntp_enabled;
+
+static int64_t wall_us(void) {
+    return HOST_EPOCH_S * 1000000LL + esp_timer_get_time() + s_wall_offset_us;
+}
+
+int host_gettimeofday(struct timeval* tv, void* tz) {
+    (void)tz;
+    int64_t us = wall_us();
+    tv->tv_sec = us / 1000000;
+    tv->tv_usec = us % 1000000;
+    return 0;
+}
+
+int host_settimeofday(const struct timeval* tv, const void* tz) {
+    (void)tz;
+    int64_t target = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    s_wall_offset_us += target - wall_us();
+    return 0;
+}
+
+/** @brief Applied at once: the host clock has no slew to simulate. */
+int host_adjtime(const struct timeval* delta, struct timeval* olddelta) {
+    if (delta) {
+        s_wall_offset_us += (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+    }
+    if (olddelta) {
+        olddelta->tv_sec = 0;
+        olddelta->tv_usec = 0;
+    }
+    return 0;
+}
+
+time_t host_time(time_t* out) {
+    time_t now = (time_t)(wall_us() / 1000000);
+    if (out) *out = now;
+    return now;
+}
+
+size_t host_strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+void esp_sntp_setoperatingmode(esp_sntp_operatingmode_t operating_mode) {
+    (void)operating_mode;
+}
+
+void esp_sntp_setservername(uint8_t idx, const char* server) {
+    (void)idx;
+    (void)server;
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    s_sntp_cb = callback;
+}
+
+/** @brief The host clock is "synced" the moment SNTP starts. */
+void esp_sntp_init(void) {
+    s_sntp_enabled = true;
+    if (s_sntp_cb) {
+        struct timeval tv;
+        host_gettimeofday(&tv, NULL);
+        s_sntp_cb(&tv);
+    }
+}
+
+void esp_sntp_stop(void) { s_sntp_enabled = false; }
+
+bool esp_sntp_enabled(void) { return s_sntp_enabled; }
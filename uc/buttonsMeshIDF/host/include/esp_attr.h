@@ -0,0 +1,10 @@
+#pragma once
+
+/** @file esp_attr.h
+ *  @brief Host stand-in: memory placement attributes have no meaning here. */
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define __NOINIT_ATTR
@@ -0,0 +1,10 @@
+#pragma once
+
+/** @file esp_bit_defs.h
+ *  @brief Host stand-in for the ESP-IDF bit helpers. */
+
+#define BIT(nr) (1UL << (nr))
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
@@ -0,0 +1,11 @@
+#pragma once
+
+/** @file esp_cpu.h
+ *  @brief Host stand-in: the "cycle" counter counts nanoseconds of the host
+ *         monotonic clock (esp_rom_get_cpu_ticks_per_us() returns 1000). */
+
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,5 @@
+#pragma once
+
+/** @file esp_crt_bundle.h
+ *  @brief Host stand-in: included by the firmware but nothing from it is
+ *         used by the sources built on the host. */
@@ -0,0 +1,66 @@
+#pragma once
+
+/**
+ * @file esp_err.h
+ * @brief Host stand-in for ESP-IDF error codes.  Values match ESP-IDF so
+ *        logs read the same on both builds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_TYPE_MISMATCH (ESP_ERR_NVS_BASE + 0x03)
+#define ESP_ERR_NVS_READ_ONLY (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_INVALID_HANDLE (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_NAME (ESP_ERR_NVS_BASE + 0x09)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (ESP_ERR_NVS_BASE + 0x10)
+
+#define ESP_ERR_MESH_BASE 0x4000
+#define ESP_ERR_MESH_WIFI_NOT_START (ESP_ERR_MESH_BASE + 0x01)
+#define ESP_ERR_MESH_NOT_INIT (ESP_ERR_MESH_BASE + 0x02)
+#define ESP_ERR_MESH_NOT_CONFIG (ESP_ERR_MESH_BASE + 0x03)
+#define ESP_ERR_MESH_NOT_START (ESP_ERR_MESH_BASE + 0x04)
+#define ESP_ERR_MESH_NOT_SUPPORT (ESP_ERR_MESH_BASE + 0x05)
+#define ESP_ERR_MESH_NOT_ALLOWED (ESP_ERR_MESH_BASE + 0x06)
+#define ESP_ERR_MESH_NO_MEMORY (ESP_ERR_MESH_BASE + 0x07)
+#define ESP_ERR_MESH_ARGUMENT (ESP_ERR_MESH_BASE + 0x08)
+#define ESP_ERR_MESH_EXCEED_MTU (ESP_ERR_MESH_BASE + 0x09)
+#define ESP_ERR_MESH_TIMEOUT (ESP_ERR_MESH_BASE + 0x0a)
+#define ESP_ERR_MESH_DISCONNECTED (ESP_ERR_MESH_BASE + 0x0b)
+#define ESP_ERR_MESH_QUEUE_FAIL (ESP_ERR_MESH_BASE + 0x0c)
+#define ESP_ERR_MESH_QUEUE_FULL (ESP_ERR_MESH_BASE + 0x0d)
+#define ESP_ERR_MESH_NO_PARENT_FOUND (ESP_ERR_MESH_BASE + 0x0e)
+#define ESP_ERR_MESH_NO_ROUTE_FOUND (ESP_ERR_MESH_BASE + 0x0f)
+
+const char* esp_err_to_name(esp_err_t code);
+
+/** @brief Abort with the failing expression, like the ESP-IDF macro. */
+#define ESP_ERROR_CHECK(x)                                                    \
+    do {                                                                      \
+        esp_err_t err_rc_ = (x);                                              \
+        if (err_rc_ != ESP_OK) {                                              \
+            fprintf(stderr,                                                   \
+                    "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d: %s\n",       \
+                    esp_err_to_name(err_rc_), err_rc_, __FILE__, __LINE__,    \
+                    #x);                                                      \
+            abort();                                                          \
+        }                                                                     \
+    } while (0)
@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * @file esp_log.h
+ * @brief Host stand-in for the ESP-IDF logging macros.  Lines keep the
+ *        ESP-IDF "I (1234) TAG: text" layout (timestamp in virtual ms) and
+ *        go to stderr, filtered by one global level (host_log_level()).
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+typedef int (*vprintf_like_t)(const char*, va_list);
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format,
+                   ...) __attribute__((format(printf, 3, 4)));
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+esp_log_level_t esp_log_level_get(const char* tag);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+uint32_t esp_log_timestamp(void);
+
+#define LOG_FORMAT(letter, format) #letter " (%" PRIu32 ") %s: " format "\n"
+
+#define ESP_LOG_LEVEL(level, letter, tag, format, ...)                        \
+    do {                                                                      \
+        if (esp_log_level_get(tag) >= (level)) {                              \
+            esp_log_write((level), (tag), LOG_FORMAT(letter, format),         \
+                          esp_log_timestamp(), (tag), ##__VA_ARGS__);         \
+        }                                                                     \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...)                                            \
+    ESP_LOG_LEVEL(ESP_LOG_ERROR, E, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)                                            \
+    ESP_LOG_LEVEL(ESP_LOG_WARN, W, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)                                            \
+    ESP_LOG_LEVEL(ESP_LOG_INFO, I, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)                                            \
+    ESP_LOG_LEVEL(ESP_LOG_DEBUG, D, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)                                            \
+    ESP_LOG_LEVEL(ESP_LOG_VERBOSE, V, tag, format, ##__VA_ARGS__)
+
+#define ESP_EARLY_LOGE ESP_LOGE
+#define ESP_EARLY_LOGW ESP_LOGW
+#define ESP_EARLY_LOGI ESP_LOGI
+#define ESP_DRAM_LOGE ESP_LOGE
+#define ESP_DRAM_LOGW ESP_LOGW
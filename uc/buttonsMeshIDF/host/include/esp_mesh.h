@@ -0,0 +1,208 @@
+#pragma once
+
+/**
+ * @file esp_mesh.h
+ * @brief Host stand-in for ESP-MESH.
+ *
+ * The node's place in the tree (root or not, layer, parent BSSID) is set
+ * with host_node_config() before app_main().  esp_mesh_start() then posts
+ * the same event sequence the real stack would after joining: STARTED,
+ * PARENT_CONNECTED and, on the root, IP_EVENT_STA_GOT_IP.  A root handover
+ * asked for with esp_mesh_waive_root() is only recorded
+ * (host_mesh_pop_waive()).  Frames passed to
+ * esp_mesh_send() go to a hook (host_mesh_set_tx_hook()) and frames injected
+ * with host_mesh_inject() come out of esp_mesh_recv().
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+
+typedef union {
+    uint8_t addr[6];
+    struct {
+        uint32_t ip4;
+        uint16_t port;
+    } __attribute__((packed)) mip;
+} mesh_addr_t;
+
+typedef enum {
+    MESH_PROTO_BIN,
+    MESH_PROTO_HTTP,
+    MESH_PROTO_JSON,
+    MESH_PROTO_MQTT,
+    MESH_PROTO_AP,
+    MESH_PROTO_STA,
+} mesh_proto_t;
+
+typedef enum {
+    MESH_TOS_P2P,
+    MESH_TOS_E2E,
+    MESH_TOS_DEF,
+} mesh_tos_t;
+
+typedef struct {
+    uint8_t* data;
+    uint16_t size;
+    mesh_proto_t proto;
+    mesh_tos_t tos;
+} mesh_data_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint8_t* val;
+} __attribute__((packed)) mesh_opt_t;
+
+#define MESH_DATA_ENC 0x01
+#define MESH_DATA_P2P 0x02
+#define MESH_DATA_FROMDS 0x04
+#define MESH_DATA_TODS 0x08
+#define MESH_DATA_NONBLOCK 0x10
+#define MESH_DATA_DROP 0x20
+#define MESH_DATA_GROUP 0x40
+
+typedef enum {
+    MESH_TOPO_TREE,
+    MESH_TOPO_CHAIN,
+} esp_mesh_topology_t;
+
+typedef enum {
+    MESH_IDLE,
+    MESH_ROOT,
+    MESH_NODE,
+    MESH_LEAF,
+    MESH_STA,
+} mesh_type_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t password[64];
+    bool allow_router_switch;
+} mesh_router_t;
+
+typedef struct {
+    uint8_t password[64];
+    uint8_t max_connection;
+    uint8_t nonmesh_max_connection;
+} mesh_ap_cfg_t;
+
+typedef struct {
+    uint8_t channel;
+    bool allow_channel_switch;
+    mesh_addr_t mesh_id;
+    mesh_router_t router;
+    mesh_ap_cfg_t mesh_ap;
+    const void* crypto_funcs;
+} mesh_cfg_t;
+
+#define MESH_INIT_CONFIG_DEFAULT() {0}
+
+typedef struct {
+    int duration_ms;
+    int cnx_rssi;
+    int select_rssi;
+    int switch_rssi;
+    int backoff_rssi;
+} mesh_switch_parent_t;
+
+typedef enum {
+    MESH_EVENT_STARTED,
+    MESH_EVENT_STOPPED,
+    MESH_EVENT_CHANNEL_SWITCH,
+    MESH_EVENT_CHILD_CONNECTED,
+    MESH_EVENT_CHILD_DISCONNECTED,
+    MESH_EVENT_ROUTING_TABLE_ADD,
+    MESH_EVENT_ROUTING_TABLE_REMOVE,
+    MESH_EVENT_PARENT_CONNECTED,
+    MESH_EVENT_PARENT_DISCONNECTED,
+    MESH_EVENT_NO_PARENT_FOUND,
+    MESH_EVENT_LAYER_CHANGE,
+    MESH_EVENT_TODS_STATE,
+    MESH_EVENT_VOTE_STARTED,
+    MESH_EVENT_VOTE_STOPPED,
+    MESH_EVENT_ROOT_ADDRESS,
+    MESH_EVENT_ROOT_SWITCH_REQ,
+    MESH_EVENT_ROOT_SWITCH_ACK,
+    MESH_EVENT_ROOT_ASKED_YIELD,
+    MESH_EVENT_ROOT_FIXED,
+    MESH_EVENT_SCAN_DONE,
+    MESH_EVENT_NETWORK_STATE,
+    MESH_EVENT_STOP_RECONNECTION,
+    MESH_EVENT_FIND_NETWORK,
+    MESH_EVENT_ROUTER_SWITCH,
+    MESH_EVENT_MAX,
+} mesh_event_id_t;
+
+typedef struct {
+    wifi_event_sta_connected_t connected;
+    uint16_t self_layer;
+    uint8_t duty;
+} mesh_event_connected_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+    int8_t rssi;
+} mesh_event_disconnected_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;
+} mesh_event_child_connected_t;
+
+typedef mesh_event_child_connected_t mesh_event_child_disconnected_t;
+
+typedef enum {
+    MESH_VOTE_REASON_ROOT_INITIATED = 1,
+    MESH_VOTE_REASON_CHILD_INITIATED,
+} mesh_vote_reason_t;
+
+typedef union {
+    int attempts;
+    mesh_addr_t rc_addr;
+} mesh_rc_config_t;
+
+typedef struct {
+    float percentage;
+    bool is_rc_specified;
+    mesh_rc_config_t config;
+} mesh_vote_t;
+
+typedef enum {
+    MESH_TODS_UNREACHABLE,
+    MESH_TODS_REACHABLE,
+} mesh_event_toDS_state_t;
+
+esp_err_t esp_mesh_init(void);
+esp_err_t esp_mesh_start(void);
+esp_err_t esp_mesh_stop(void);
+esp_err_t esp_mesh_disconnect(void);
+esp_err_t esp_mesh_set_config(const mesh_cfg_t* config);
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent);
+esp_err_t esp_mesh_get_switch_parent_paras(mesh_switch_parent_t* paras);
+esp_err_t esp_mesh_set_switch_parent_paras(mesh_switch_parent_t* paras);
+esp_err_t esp_mesh_set_max_layer(int max_layer);
+esp_err_t esp_mesh_set_vote_percentage(float percentage);
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo);
+esp_err_t esp_mesh_set_root_healing_delay(int delay_ms);
+esp_err_t esp_mesh_set_parent(const wifi_config_t* parent,
+                              const mesh_addr_t* parent_mesh_id,
+                              mesh_type_t my_type, int my_layer);
+esp_err_t esp_mesh_get_parent_bssid(mesh_addr_t* bssid);
+bool esp_mesh_is_root(void);
+int esp_mesh_get_layer(void);
+int esp_mesh_get_total_node_num(void);
+esp_err_t esp_mesh_waive_root(const mesh_vote_t* vote, int reason);
+
+esp_err_t esp_mesh_send(const mesh_addr_t* to, const mesh_data_t* data,
+                        int flag, const mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_recv(mesh_addr_t* from, mesh_data_t* data, int timeout_ms,
+                        int* flag, mesh_opt_t opt[], int opt_count);
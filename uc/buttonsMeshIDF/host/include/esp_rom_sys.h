@@ -0,0 +1,9 @@
+#pragma once
+
+/** @file esp_rom_sys.h
+ *  @brief Host stand-in for the ROM helpers the firmware uses. */
+
+#include <stdint.h>
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
+void esp_rom_delay_us(uint32_t us);
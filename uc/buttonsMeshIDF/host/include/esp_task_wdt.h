@@ -0,0 +1,12 @@
+#pragma once
+
+/** @file esp_task_wdt.h
+ *  @brief Host stand-in: the task watchdog accepts everything. */
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task_handle);
+esp_err_t esp_task_wdt_delete(TaskHandle_t task_handle);
+esp_err_t esp_task_wdt_reset(void);
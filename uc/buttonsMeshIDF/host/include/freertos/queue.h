@@ -0,0 +1,31 @@
+#pragma once
+
+/** @file queue.h
+ *  @brief Host stand-in for FreeRTOS queues (see hal/freertos.c). */
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item,
+                            TickType_t ticks_to_wait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item,
+                             TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer,
+                         TickType_t ticks_to_wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer,
+                      TickType_t ticks_to_wait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSend(queue, item, ticks) xQueueSendToBack(queue, item, ticks)
+#define xQueueSendFromISR(queue, item, woken)                                 \
+    xQueueSendToBack(queue, item, 0)
+#define xQueueSendToBackFromISR(queue, item, woken)                           \
+    xQueueSendToBack(queue, item, 0)
+#define xQueueReceiveFromISR(queue, buffer, woken)                            \
+    xQueueReceive(queue, buffer, 0)
@@ -0,0 +1,20 @@
+#pragma once
+
+/** @file semphr.h
+ *  @brief Host stand-in for FreeRTOS semaphores: queues of zero-size items,
+ *         as in the real kernel.  Mutexes have no priority inheritance. */
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count,
+                                           UBaseType_t initial_count);
+
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem) xQueueSendToBack((sem), NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) xQueueSendToBack((sem), NULL, 0)
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+#define uxSemaphoreGetCount(sem) uxQueueMessagesWaiting(sem)
@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * @file host_compat.h
+ * @brief Force-included into every firmware source of the host build.
+ *
+ * Routes the firmware's wall-clock calls to the simulated clock so that
+ * time_sync.c and schedule.c never touch the host's real clock, and
+ * supplies strlcpy(), which newlib has and older glibc lacks.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+int host_gettimeofday(struct timeval* tv, void* tz);
+int host_settimeofday(const struct timeval* tv, const void* tz);
+int host_adjtime(const struct timeval* delta, struct timeval* olddelta);
+time_t host_time(time_t* out);
+size_t host_strlcpy(char* dst, const char* src, size_t size);
+
+#define gettimeofday(tv, tz) host_gettimeofday((tv), (tz))
+#define settimeofday(tv, tz) host_settimeofday((tv), (tz))
+#define adjtime(delta, olddelta) host_adjtime((delta), (olddelta))
+#define time(out) host_time(out)
+#define strlcpy(dst, src, size) host_strlcpy((dst), (src), (size))
@@ -0,0 +1,10 @@
+#pragma once
+
+/** @file nvs_flash.h
+ *  @brief Host stand-in for NVS partition setup. */
+
+#include "esp_err.h"
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * @file sdkconfig.h
+ * @brief Host build configuration: the Kconfig.projbuild defaults plus the
+ *        few ESP-IDF options the firmware looks at.
+ *
+ * Every value can be overridden from CMake (e.g. -DCONFIG_DOMATOR_PROFILER=1).
+ * No CONFIG_IDF_TARGET_* is defined, so target-specific branches take their
+ * generic path.
+ */
+
+#ifndef CONFIG_ROUTER_SSID
+#define CONFIG_ROUTER_SSID "domator_mesh"
+#endif
+#ifndef CONFIG_ROUTER_PASSWD
+#define CONFIG_ROUTER_PASSWD "domator123"
+#endif
+#ifndef CONFIG_MQTT_BROKER_URI
+#define CONFIG_MQTT_BROKER_URI "mqtt://127.0.0.1"
+#endif
+#ifndef CONFIG_MQTT_USER
+#define CONFIG_MQTT_USER "domator"
+#endif
+#ifndef CONFIG_MQTT_PASSWORD
+#define CONFIG_MQTT_PASSWORD "domator"
+#endif
+#ifndef CONFIG_MESH_ID
+#define CONFIG_MESH_ID "DMESH0"
+#endif
+#ifndef CONFIG_MESH_AP_PASSWD
+#define CONFIG_MESH_AP_PASSWD "domator"
+#endif
+#ifndef CONFIG_OTA_URL
+#define CONFIG_OTA_URL "http://127.0.0.1/firmware.bin"
+#endif
+#ifndef CONFIG_DOMATOR_SNTP_SERVER
+#define CONFIG_DOMATOR_SNTP_SERVER "pool.ntp.org"
+#endif
+#ifndef CONFIG_DOMATOR_TIMEZONE
+#define CONFIG_DOMATOR_TIMEZONE "CET-1CEST,M3.5.0,M10.5.0/3"
+#endif
+#ifndef CONFIG_DOMATOR_BUTTON_GLITCH_FILTER
+#define CONFIG_DOMATOR_BUTTON_GLITCH_FILTER 1
+#endif
+#ifndef CONFIG_DOMATOR_TRACE_EVENTS
+#define CONFIG_DOMATOR_TRACE_EVENTS 2048
+#endif
+// The fault suites and the simulator use it; with no rules it passes
+// every frame untouched.
+#ifndef CONFIG_DOMATOR_FAULT
+#define CONFIG_DOMATOR_FAULT 1
+#endif
+
+// CONFIG_DOMATOR_DEFERRED_LOG, CONFIG_DOMATOR_HEAP_TAGS,
+// CONFIG_DOMATOR_PROFILER: off unless set from CMake.
+// CONFIG_DOMATOR_TRACE needs the FreeRTOS kernel and is not available here.
+
+#define CONFIG_LOG_TIMESTAMP_SOURCE_SYSTEM 1
+#define CONFIG_FREERTOS_HZ 1000
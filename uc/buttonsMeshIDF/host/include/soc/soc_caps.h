@@ -0,0 +1,4 @@
+#pragma once
+
+/** @file soc_caps.h
+ *  @brief Host stand-in: no SoC capabilities (no GPIO glitch filter). */
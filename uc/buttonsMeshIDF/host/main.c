@@ -0,0 +1,220 @@
+/**
+ * @file main.c
+ * @brief domator_host: the root firmware on the host, driven by a script.
+ *
+ * Boots app_main() as the mesh root with MQTT connected, then reads commands
+ * from stdin (or the file given as the only argument), one per line:
+ *
+ *   join <id> <S|R>             node announces itself (MSG_TYPE_TYPE_INFO)
+ *   press <id> <button> <0|1>   switch button edge (MSG_TYPE_BUTTON)
+ *   mesh <id> <type> [data]     any frame from node <id>, type one char
+ *   mqtt <topic> [payload]      message from the broker
+ *   run <ms>                    let virtual time pass
+ *   quit
+ *
+ * Every frame the firmware sends prints as "@MESH <to> <type> <data>" and
+ * every publish as "@MQTT <topic> <payload>", with the virtual time in ms
+ * in front.  Firmware logs go to stderr (level from DOMATOR_HOST_LOG).
+ *
+ * With "--capture <file>" before the script, the session from @READY on is
+ * also saved in the root's traffic capture format, for domator_replay.
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture_file.h"
+#include "domator_mesh.h"
+#include "host_hal.h"
+
+void app_main(void);
+
+/** Virtual time each command gets to be handled before the next one. */
+#define SETTLE_MS 20
+
+static capture_file_t s_capture;
+static uint64_t s_capture_t0;
+
+static uint64_t capture_time(void) { return host_now_us() - s_capture_t0; }
+
+static void print_data(const char* data, int len) {
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)data[i];
+        if (isprint(c) && c != '\\') {
+            putchar(c);
+        } else {
+            printf("\\x%02x", c);
+        }
+    }
+}
+
+static esp_err_t print_frame(const mesh_addr_t* to, const uint8_t* data,
+                             size_t len, int flag, void* ctx) {
+    (void)flag;
+    (void)ctx;
+    if (len < sizeof(mesh_app_msg_t)) return ESP_OK;
+    const mesh_app_msg_t* msg = (const mesh_app_msg_t*)data;
+    if (s_capture.f) {
+        capture_file_mesh(&s_capture, CAPTURE_REC_MESH_TX, capture_time(), to,
+                          msg);
+    }
+    uint64_t id = 0;
+    for (int i = 0; i < 6; i++) id = (id << 8) | to->addr[i];
+    printf("%" PRIu64 " @MESH %" PRIu64 " %c ", host_now_us() / 1000, id,
+           msg->msg_type);
+    int n = msg->data_len < MESH_MSG_DATA_SIZE ? msg->data_len
+                                               : MESH_MSG_DATA_SIZE;
+    print_data(msg->data, n);
+    putchar('\n');
+    return ESP_OK;
+}
+
+static void print_publish(const char* topic, const char* data, int len,
+                          int qos, int retain, void* ctx) {
+    (void)qos;
+    (void)ctx;
+    if (s_capture.f) {
+        capture_file_mqtt(&s_capture, CAPTURE_REC_MQTT_OUT, capture_time(),
+                          topic, data, len, retain);
+    }
+    // Publishers count the terminating NUL in some payloads.
+    while (len > 0 && data[len - 1] == '\0') len--;
+    printf("%" PRIu64 " @MQTT %s ", host_now_us() / 1000, topic);
+    print_data(data, len);
+    putchar('\n');
+}
+
+static bool mqtt_up(void* ctx) {
+    (void)ctx;
+    return g_mqtt_connected;
+}
+
+static void inject(uint64_t src, uint8_t type, const char* data) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = src;
+    msg.msg_type = type;
+    size_t len = data ? strlen(data) : 0;
+    if (len > MESH_MSG_DATA_SIZE) len = MESH_MSG_DATA_SIZE;
+    memcpy(msg.data, data, len);
+    msg.data_len = (uint16_t)len;
+
+    mesh_addr_t from;
+    host_id_to_addr(src, &from);
+    if (s_capture.f) {
+        capture_file_mesh(&s_capture, CAPTURE_REC_MESH_RX, capture_time(),
+                          &from, &msg);
+    }
+    if (host_mesh_inject(&from, &msg, sizeof(msg)) != ESP_OK) {
+        fprintf(stderr, "mesh receive queue full\n");
+    }
+}
+
+/** @brief Execute one script line; false on quit. */
+static bool run_line(char* line) {
+    char* cmd = strtok(line, " \t\r\n");
+    if (cmd == NULL || cmd[0] == '#') return true;
+
+    if (strcmp(cmd, "quit") == 0) return false;
+
+    if (strcmp(cmd, "run") == 0) {
+        char* ms = strtok(NULL, " \t\r\n");
+        host_run_for_ms(ms ? (uint32_t)strtoul(ms, NULL, 10) : 0);
+        return true;
+    }
+
+    if (strcmp(cmd, "mqtt") == 0) {
+        char* topic = strtok(NULL, " \t\r\n");
+        char* payload = strtok(NULL, "\r\n");
+        if (topic == NULL) {
+            fprintf(stderr, "usage: mqtt <topic> [payload]\n");
+            return true;
+        }
+        if (payload == NULL) payload = "";
+        if (s_capture.f) {
+            capture_file_mqtt(&s_capture, CAPTURE_REC_MQTT_IN, capture_time(),
+                              topic, payload, (int)strlen(payload), false);
+        }
+        if (!host_mqtt_inject(topic, payload, -1)) {
+            fprintf(stderr, "no subscription for %s\n", topic);
+        }
+        host_run_for_ms(SETTLE_MS);
+        return true;
+    }
+
+    char* id_str = strtok(NULL, " \t\r\n");
+    if (id_str == NULL) {
+        fprintf(stderr, "missing node id: %s\n", cmd);
+        return true;
+    }
+    uint64_t id = strtoull(id_str, NULL, 0);
+
+    if (strcmp(cmd, "join") == 0) {
+        char* type = strtok(NULL, " \t\r\n");
+        inject(id, MSG_TYPE_TYPE_INFO, type ? type : "S");
+    } else if (strcmp(cmd, "press") == 0) {
+        char* button = strtok(NULL, " \t\r\n");
+        char* state = strtok(NULL, " \t\r\n");
+        if (button == NULL || state == NULL) {
+            fprintf(stderr, "usage: press <id> <button> <0|1>\n");
+            return true;
+        }
+        char data[3] = {button[0], state[0], '\0'};
+        inject(id, MSG_TYPE_BUTTON, data);
+    } else if (strcmp(cmd, "mesh") == 0) {
+        char* type = strtok(NULL, " \t\r\n");
+        char* data = strtok(NULL, "\r\n");
+        if (type == NULL) {
+            fprintf(stderr, "usage: mesh <id> <type> [data]\n");
+            return true;
+        }
+        inject(id, (uint8_t)type[0], data);
+    } else {
+        fprintf(stderr, "unknown command: %s\n", cmd);
+        return true;
+    }
+    host_run_for_ms(SETTLE_MS);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* capture = NULL;
+    if (argc > 2 && strcmp(argv[1], "--capture") == 0) {
+        capture = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    FILE* in = stdin;
+    if (argc > 1) {
+        in = fopen(argv[1], "r");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    host_mesh_set_tx_hook(print_frame, NULL);
+    host_mqtt_set_publish_hook(print_publish, NULL);
+    app_main();
+    if (!host_run_until(mqtt_up, NULL, 10, 5000)) {
+        fprintf(stderr, "root did not reach MQTT\n");
+        return 1;
+    }
+    printf("%" PRIu64 " @READY %" PRIu64 "\n", host_now_us() / 1000,
+           g_device_id);
+    s_capture_t0 = host_now_us();
+    if (capture &&
+        !capture_file_create(&s_capture, capture, g_device_id, s_capture_t0)) {
+        return 1;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), in) && run_line(line)) {
+    }
+    if (in != stdin) fclose(in);
+    if (s_capture.f) capture_file_close(&s_capture);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file capture_file.c
+ * @brief Capture files: the header, record framing and the two payload
+ *        layouts, mirroring what capture.c streams from the root.
+ */
+
+#include "capture_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ====================
+// Writing
+// ====================
+
+static void put_record(capture_file_t* cf, uint8_t kind, uint8_t flags,
+                       uint64_t t_us, const void* head, size_t head_len,
+                       const void* body, size_t body_len) {
+    if (head_len + body_len > cf->hdr.snaplen) {
+        body_len = cf->hdr.snaplen - head_len;
+        flags |= CAPTURE_FLAG_TRUNCATED;
+    }
+    capture_rec_hdr_t hdr = {
+        .ts_sec = (uint32_t)(t_us / 1000000),
+        .ts_usec = (uint32_t)(t_us % 1000000),
+        .len = (uint16_t)(head_len + body_len),
+        .kind = kind,
+        .flags = flags,
+    };
+    fwrite(&hdr, sizeof(hdr), 1, cf->f);
+    fwrite(head, 1, head_len, cf->f);
+    if (body_len) fwrite(body, 1, body_len, cf->f);
+}
+
+bool capture_file_create(capture_file_t* cf, const char* path,
+                         uint64_t device_id, int64_t start_us) {
+    memset(cf, 0, sizeof(*cf));
+    cf->f = fopen(path, "wb");
+    if (cf->f == NULL) {
+        perror(path);
+        return false;
+    }
+    cf->hdr = (capture_file_hdr_t){
+        .magic = CAPTURE_MAGIC,
+        .version = CAPTURE_VERSION,
+        .hdr_size = sizeof(capture_file_hdr_t),
+        .snaplen = UINT16_MAX,  // no host record needs cutting
+        .device_id = device_id,
+        .start_us = start_us,
+    };
+    fwrite(&cf->hdr, sizeof(cf->hdr), 1, cf->f);
+    return true;
+}
+
+void capture_file_mesh(capture_file_t* cf, uint8_t kind, uint64_t t_us,
+                       const mesh_addr_t* peer, const mesh_app_msg_t* msg) {
+    uint8_t head[6 + CAPTURE_MSG_HDR_SIZE];
+    if (peer) {
+        memcpy(head, peer->addr, 6);
+    } else {
+        memset(head, 0, 6);
+    }
+    memcpy(head + 6, msg, CAPTURE_MSG_HDR_SIZE);
+    size_t data_len = msg->data_len < MESH_MSG_DATA_SIZE ? msg->data_len
+                                                         : MESH_MSG_DATA_SIZE;
+    put_record(cf, kind, 0, t_us, head, sizeof(head), msg->data, data_len);
+}
+
+void capture_file_mqtt(capture_file_t* cf, uint8_t kind, uint64_t t_us,
+                       const char* topic, const char* data, int len,
+                       bool retain) {
+    size_t topic_len = strlen(topic);
+    if (topic_len > UINT8_MAX) topic_len = UINT8_MAX;
+    uint8_t head[1 + UINT8_MAX];
+    head[0] = (uint8_t)topic_len;
+    memcpy(head + 1, topic, topic_len);
+    put_record(cf, kind, retain ? CAPTURE_FLAG_RETAIN : 0, t_us, head,
+               1 + topic_len, data, len > 0 ? (size_t)len : 0);
+}
+
+// ====================
+// Reading
+// ====================
+
+bool capture_file_open(capture_file_t* cf, const char* path) {
+    memset(cf, 0, sizeof(*cf));
+    cf->f = fopen(path, "rb");
+    if (cf->f == NULL) {
+        perror(path);
+        return false;
+    }
+    if (fread(&cf->hdr, sizeof(cf->hdr), 1, cf->f) != 1 ||
+        cf->hdr.magic != CAPTURE_MAGIC) {
+        fprintf(stderr, "%s: not a capture file\n", path);
+    } else if (cf->hdr.version != CAPTURE_VERSION ||
+               cf->hdr.hdr_size < sizeof(cf->hdr)) {
+        fprintf(stderr, "%s: capture version %u not supported\n", path,
+                cf->hdr.version);
+    } else if (capture_file_rewind(cf)) {
+        return true;
+    }
+    capture_file_close(cf);
+    return false;
+}
+
+int capture_file_next(capture_file_t* cf, capture_rec_t* rec) {
+    capture_rec_hdr_t hdr;
+    size_t n = fread(&hdr, 1, sizeof(hdr), cf->f);
+    if (n == 0) return 0;
+    if (n != sizeof(hdr)) return -1;
+
+    if (hdr.len > cf->buf_cap) {
+        cf->buf = realloc(cf->buf, hdr.len);
+        if (cf->buf == NULL) abort();
+        cf->buf_cap = hdr.len;
+    }
+    if (hdr.len && fread(cf->buf, 1, hdr.len, cf->f) != hdr.len) return -1;
+
+    rec->t_us = (uint64_t)hdr.ts_sec * 1000000 + hdr.ts_usec;
+    rec->kind = hdr.kind;
+    rec->flags = hdr.flags;
+    rec->len = hdr.len;
+    rec->payload = cf->buf;
+    return 1;
+}
+
+bool capture_file_rewind(capture_file_t* cf) {
+    return fseek(cf->f, cf->hdr.hdr_size, SEEK_SET) == 0;
+}
+
+bool capture_rec_mesh(const capture_rec_t* rec, mesh_addr_t* peer,
+                      mesh_app_msg_t* msg) {
+    size_t head = 6 + CAPTURE_MSG_HDR_SIZE;
+    if (rec->len < head) return false;
+
+    memset(peer, 0, sizeof(*peer));
+    memcpy(peer->addr, rec->payload, 6);
+    memset(msg, 0, sizeof(*msg));
+    memcpy(msg, rec->payload + 6, CAPTURE_MSG_HDR_SIZE);
+    size_t data_len = rec->len - head;
+    if (data_len > MESH_MSG_DATA_SIZE) data_len = MESH_MSG_DATA_SIZE;
+    memcpy(msg->data, rec->payload + head, data_len);
+    return true;
+}
+
+bool capture_rec_mqtt(const capture_rec_t* rec, char topic[256],
+                      const char** data, int* len) {
+    if (rec->len < 1 || rec->len < 1 + rec->payload[0]) return false;
+
+    size_t topic_len = rec->payload[0];
+    memcpy(topic, rec->payload + 1, topic_len);
+    topic[topic_len] = '\0';
+    *data = (const char*)rec->payload + 1 + topic_len;
+    *len = (int)(rec->len - 1 - topic_len);
+    return true;
+}
+
+void capture_file_close(capture_file_t* cf) {
+    if (cf->f) fclose(cf->f);
+    free(cf->buf);
+    memset(cf, 0, sizeof(*cf));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/**
+ * @file capture_file.h
+ * @brief Read and write the traffic capture files of capture.c on the host.
+ *
+ * The format is defined next to the firmware's capture hooks in
+ * domator_mesh.h; a file is exactly the byte stream the root sends to
+ * tools/mesh_capture.py.  domator_host writes one with --capture, and
+ * domator_replay reads one back and can write the replayed session.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "domator_mesh.h"
+
+typedef struct {
+    FILE* f;
+    capture_file_hdr_t hdr;
+    uint8_t* buf;  ///< payload of the last record read
+    size_t buf_cap;
+} capture_file_t;
+
+/** @brief One record as read back; @c payload is valid until the next. */
+typedef struct {
+    uint64_t t_us;  ///< since the capture started
+    uint8_t kind;   ///< capture_rec_kind_t
+    uint8_t flags;  ///< CAPTURE_FLAG_*
+    uint16_t len;
+    const uint8_t* payload;
+} capture_rec_t;
+
+// ====================
+// Writing
+// ====================
+
+/** @brief Create @p path and write the file header; false on error. */
+bool capture_file_create(capture_file_t* cf, const char* path,
+                         uint64_t device_id, int64_t start_us);
+
+/** @brief Append a mesh frame record (CAPTURE_REC_MESH_RX/TX). */
+void capture_file_mesh(capture_file_t* cf, uint8_t kind, uint64_t t_us,
+                       const mesh_addr_t* peer, const mesh_app_msg_t* msg);
+
+/** @brief Append an MQTT record (CAPTURE_REC_MQTT_IN/OUT). */
+void capture_file_mqtt(capture_file_t* cf, uint8_t kind, uint64_t t_us,
+                       const char* topic, const char* data, int len,
+                       bool retain);
+
+// ====================
+// Reading
+// ====================
+
+/** @brief Open @p path and check its header; prints why on failure. */
+bool capture_file_open(capture_file_t* cf, const char* path);
+
+/** @brief Read the next record: 1, 0 at the end, -1 on a damaged file. */
+int capture_file_next(capture_file_t* cf, capture_rec_t* rec);
+
+/** @brief Go back to the first record. */
+bool capture_file_rewind(capture_file_t* cf);
+
+/**
+ * @brief Rebuild the frame of a MESH_RX/TX record.  @p msg gets the header
+ *        and data, zero-padded to the full mesh_app_msg_t.
+ */
+bool capture_rec_mesh(const capture_rec_t* rec, mesh_addr_t* peer,
+                      mesh_app_msg_t* msg);
+
+/**
+ * @brief Split an MQTT_IN/OUT record.  @p topic is NUL-terminated; @p data
+ *        points into the record.
+ */
+bool capture_rec_mqtt(const capture_rec_t* rec, char topic[256],
+                      const char** data, int* len);
+
+void capture_file_close(capture_file_t* cf);
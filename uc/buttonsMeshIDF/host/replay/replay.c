@@ -0,0 +1,462 @@
+/**
+ * @file replay.c
+ * @brief domator_replay: feed a traffic capture to the root on the host.
+ *
+ *   domator_replay [--speed <x|max>] [--config <file>] [--out <file>]
+ *                  [--strict] <capture.dcap>
+ *
+ * Boots app_main() as the mesh root with the captured root's MAC, waits for
+ * MQTT like domator_host, then delivers every MESH_RX record through
+ * host_mesh_inject() and every MQTT_IN record through host_mqtt_inject() at
+ * its recorded offset on the virtual clock, divided by --speed ("max" sends
+ * each input as soon as the previous one is handled).  Runs are
+ * deterministic, so a capture replays the same way every time.
+ *
+ * The MESH_TX and MQTT_OUT records of the capture are what the root did on
+ * target.  The replayed root's frames and publishes are matched against
+ * them by peer, type and payload (sequence numbers and clocks ignored) and
+ * the report shows what differs; --strict makes any difference an error.
+ * The root starts empty: --config publishes a config JSON to
+ * /switch/cmd/root first when the capture began after the root had one.
+ * --out writes the replayed session as a capture of its own.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_file.h"
+#include "domator_mesh.h"
+#include "host_hal.h"
+
+void app_main(void);
+
+/** Virtual time the root gets after --config before the first record. */
+#define CONFIG_SETTLE_MS 100
+
+/** With --speed max, virtual time for the last input to be handled. */
+#define MAX_SPEED_TAIL_MS 100
+
+/** Report row for MQTT; mesh frames use their message type. */
+#define ROW_MQTT 256
+
+typedef struct {
+    uint8_t kind;  ///< CAPTURE_REC_MESH_TX or CAPTURE_REC_MQTT_OUT
+    bool matched;
+    size_t len;
+    uint8_t* key;  ///< what has to be equal for a match
+} expected_t;
+
+typedef struct {
+    uint64_t recorded;
+    uint64_t replayed;
+    uint64_t matched;
+} row_stats_t;
+
+static expected_t* s_expected;
+static size_t s_expected_count;
+static size_t s_expected_cap;
+static size_t s_first_open;  ///< no unmatched entry before this index
+
+static row_stats_t s_rows[ROW_MQTT + 1];
+static uint64_t s_extra;
+static bool s_replaying;  ///< outputs before the first record don't count
+static uint64_t s_replay_t0;
+static capture_file_t s_out;
+
+// ====================
+// Output matching
+// ====================
+
+/**
+ * @brief Comparable form of a frame or publish: peer, type and data of a
+ *        frame; topic and payload of a publish, without trailing NULs.
+ */
+static uint8_t* make_key(uint8_t kind, const uint8_t* a, size_t a_len,
+                         const void* b, size_t b_len, size_t* len) {
+    if (kind == CAPTURE_REC_MQTT_OUT) {
+        const char* data = b;
+        while (b_len > 0 && data[b_len - 1] == '\0') b_len--;
+    }
+    uint8_t* key = malloc(a_len + b_len + 1);
+    if (key == NULL) abort();
+    memcpy(key, a, a_len);
+    if (b_len) memcpy(key + a_len, b, b_len);
+    *len = a_len + b_len;
+    return key;
+}
+
+static uint8_t* mesh_key(const mesh_addr_t* peer, const mesh_app_msg_t* msg,
+                         size_t* len) {
+    uint8_t head[7];
+    memcpy(head, peer->addr, 6);
+    head[6] = msg->msg_type;
+    size_t data_len = msg->data_len < MESH_MSG_DATA_SIZE ? msg->data_len
+                                                         : MESH_MSG_DATA_SIZE;
+    return make_key(CAPTURE_REC_MESH_TX, head, sizeof(head), msg->data,
+                    data_len, len);
+}
+
+static uint8_t* mqtt_key(const char* topic, const char* data, int len,
+                         size_t* key_len) {
+    return make_key(CAPTURE_REC_MQTT_OUT, (const uint8_t*)topic,
+                    strlen(topic) + 1, data, len > 0 ? (size_t)len : 0,
+                    key_len);
+}
+
+static void expect(uint8_t kind, uint16_t row, uint8_t* key, size_t len) {
+    if (s_expected_count == s_expected_cap) {
+        s_expected_cap = s_expected_cap ? s_expected_cap * 2 : 256;
+        s_expected = realloc(s_expected, s_expected_cap * sizeof(*s_expected));
+        if (s_expected == NULL) abort();
+    }
+    s_expected[s_expected_count++] = (expected_t){
+        .kind = kind,
+        .len = len,
+        .key = key,
+    };
+    s_rows[row].recorded++;
+}
+
+/** @brief Tick off the earliest recorded output equal to this one. */
+static void match(uint8_t kind, uint16_t row, uint8_t* key, size_t len) {
+    s_rows[row].replayed++;
+    for (size_t i = s_first_open; i < s_expected_count; i++) {
+        expected_t* e = &s_expected[i];
+        if (e->matched || e->kind != kind || e->len != len ||
+            memcmp(e->key, key, len) != 0) {
+            continue;
+        }
+        e->matched = true;
+        s_rows[row].matched++;
+        while (s_first_open < s_expected_count &&
+               s_expected[s_first_open].matched) {
+            s_first_open++;
+        }
+        free(key);
+        return;
+    }
+    s_extra++;
+    free(key);
+}
+
+// ====================
+// HAL hooks
+// ====================
+
+static esp_err_t on_send(const mesh_addr_t* to, const uint8_t* data,
+                         size_t len, int flag, void* ctx) {
+    (void)flag;
+    (void)ctx;
+    if (!s_replaying || len < sizeof(mesh_app_msg_t)) return ESP_OK;
+    const mesh_app_msg_t* msg = (const mesh_app_msg_t*)data;
+    mesh_addr_t peer = {0};
+    if (to) peer = *to;
+
+    size_t key_len;
+    uint8_t* key = mesh_key(&peer, msg, &key_len);
+    match(CAPTURE_REC_MESH_TX, msg->msg_type, key, key_len);
+    if (s_out.f) {
+        capture_file_mesh(&s_out, CAPTURE_REC_MESH_TX,
+                          host_now_us() - s_replay_t0, &peer, msg);
+    }
+    return ESP_OK;
+}
+
+static void on_publish(const char* topic, const char* data, int len,
+                       int qos, int retain, void* ctx) {
+    (void)qos;
+    (void)ctx;
+    if (!s_replaying) return;
+    size_t key_len;
+    uint8_t* key = mqtt_key(topic, data, len, &key_len);
+    match(CAPTURE_REC_MQTT_OUT, ROW_MQTT, key, key_len);
+    if (s_out.f) {
+        capture_file_mqtt(&s_out, CAPTURE_REC_MQTT_OUT,
+                          host_now_us() - s_replay_t0, topic, data, len,
+                          retain);
+    }
+}
+
+static bool mqtt_up(void* ctx) {
+    (void)ctx;
+    return g_mqtt_connected;
+}
+
+// ====================
+// Replay
+// ====================
+
+typedef struct {
+    double speed;  ///< 0 = as fast as the root handles inputs
+    const char* config;
+    const char* out;
+    bool strict;
+    const char* path;
+} options_t;
+
+typedef struct {
+    uint64_t records;
+    uint64_t mesh_in;
+    uint64_t mqtt_in;
+    uint64_t truncated;
+    uint64_t lost;      ///< records the root could not stream
+    uint64_t rx_full;   ///< frames refused by the full receive queue
+    uint64_t no_sub;    ///< MQTT inputs no subscription took
+    uint64_t span_us;   ///< capture time of the last record
+    double wall_s;
+    double cpu_s;
+} replay_stats_t;
+
+static double seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool push_config(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    static char json[65536];
+    size_t len = fread(json, 1, sizeof(json) - 1, f);
+    fclose(f);
+    json[len] = '\0';
+    if (!host_mqtt_inject("/switch/cmd/root", json, (int)len)) {
+        fprintf(stderr, "root did not take the config\n");
+        return false;
+    }
+    host_run_for_ms(CONFIG_SETTLE_MS);
+    return true;
+}
+
+/** @brief Deliver one input record at its (scaled) capture time. */
+static void feed(const options_t* opt, const capture_rec_t* rec,
+                 replay_stats_t* st) {
+    uint64_t at = s_replay_t0;
+    if (opt->speed > 0) at += (uint64_t)(rec->t_us / opt->speed);
+    host_run_to_us(at);
+
+    if (rec->flags & CAPTURE_FLAG_TRUNCATED) {
+        st->truncated++;
+        return;
+    }
+
+    if (rec->kind == CAPTURE_REC_MESH_RX) {
+        mesh_addr_t from;
+        mesh_app_msg_t msg;
+        if (!capture_rec_mesh(rec, &from, &msg)) return;
+        st->mesh_in++;
+        if (s_out.f) {
+            capture_file_mesh(&s_out, CAPTURE_REC_MESH_RX,
+                              host_now_us() - s_replay_t0, &from, &msg);
+        }
+        if (host_mesh_inject(&from, &msg, sizeof(msg)) != ESP_OK) {
+            st->rx_full++;
+        }
+    } else {
+        char topic[256];
+        const char* data;
+        int len;
+        if (!capture_rec_mqtt(rec, topic, &data, &len)) return;
+        st->mqtt_in++;
+        if (s_out.f) {
+            capture_file_mqtt(&s_out, CAPTURE_REC_MQTT_IN,
+                              host_now_us() - s_replay_t0, topic, data, len,
+                              false);
+        }
+        if (!host_mqtt_inject(topic, data, len)) st->no_sub++;
+    }
+}
+
+/** @brief Record the capture's own outputs as the expected ones. */
+static void expect_record(const capture_rec_t* rec) {
+    size_t key_len;
+    if (rec->kind == CAPTURE_REC_MESH_TX) {
+        mesh_addr_t peer;
+        mesh_app_msg_t msg;
+        if (!capture_rec_mesh(rec, &peer, &msg)) return;
+        uint8_t* key = mesh_key(&peer, &msg, &key_len);
+        expect(rec->kind, msg.msg_type, key, key_len);
+    } else {
+        char topic[256];
+        const char* data;
+        int len;
+        if (!capture_rec_mqtt(rec, topic, &data, &len)) return;
+        uint8_t* key = mqtt_key(topic, data, len, &key_len);
+        expect(rec->kind, ROW_MQTT, key, key_len);
+    }
+}
+
+static bool replay(const options_t* opt, replay_stats_t* st) {
+    capture_file_t in;
+    if (!capture_file_open(&in, opt->path)) return false;
+
+    host_node_t node = {.is_root = true, .layer = 1, .rssi = -50};
+    mesh_addr_t root;
+    host_id_to_addr(in.hdr.device_id, &root);
+    memcpy(node.mac, root.addr, 6);
+    host_node_config(&node);
+
+    host_mesh_set_tx_hook(on_send, NULL);
+    host_mqtt_set_publish_hook(on_publish, NULL);
+    app_main();
+    if (!host_run_until(mqtt_up, NULL, 10, 5000)) {
+        fprintf(stderr, "root did not reach MQTT\n");
+        capture_file_close(&in);
+        return false;
+    }
+    if (opt->config && !push_config(opt->config)) {
+        capture_file_close(&in);
+        return false;
+    }
+
+    s_replay_t0 = host_now_us();
+    if (opt->out &&
+        !capture_file_create(&s_out, opt->out, g_device_id, s_replay_t0)) {
+        capture_file_close(&in);
+        return false;
+    }
+
+    // An input's outputs can appear before the next record is read, so
+    // every expected output is known before the first input goes in.
+    capture_rec_t rec;
+    int r;
+    while ((r = capture_file_next(&in, &rec)) > 0) {
+        st->records++;
+        st->span_us = rec.t_us;
+        if (rec.kind == CAPTURE_REC_MESH_TX ||
+            rec.kind == CAPTURE_REC_MQTT_OUT) {
+            expect_record(&rec);
+        } else if (rec.kind == CAPTURE_REC_DROP &&
+                   rec.len >= sizeof(uint32_t)) {
+            uint32_t n;
+            memcpy(&n, rec.payload, sizeof(n));
+            st->lost += n;
+        }
+    }
+    if (r < 0) fprintf(stderr, "%s: damaged record, stopping\n", opt->path);
+    capture_file_rewind(&in);
+
+    s_replaying = true;
+    double wall0 = seconds(CLOCK_MONOTONIC);
+    double cpu0 = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    for (uint64_t i = 0; i < st->records; i++) {
+        if (capture_file_next(&in, &rec) <= 0) break;
+        if (rec.kind == CAPTURE_REC_MESH_RX ||
+            rec.kind == CAPTURE_REC_MQTT_IN) {
+            feed(opt, &rec, st);
+        }
+    }
+
+    // Let the root finish what the capture saw it finish.
+    if (opt->speed > 0) {
+        host_run_to_us(s_replay_t0 + (uint64_t)(st->span_us / opt->speed));
+    } else {
+        host_run_for_ms(MAX_SPEED_TAIL_MS);
+    }
+    st->wall_s = seconds(CLOCK_MONOTONIC) - wall0;
+    st->cpu_s = seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu0;
+
+    capture_file_close(&in);
+    if (s_out.f) capture_file_close(&s_out);
+    return true;
+}
+
+// ====================
+// Report
+// ====================
+
+static void report(const options_t* opt, const replay_stats_t* st,
+                   uint64_t* matched, uint64_t* recorded) {
+    uint64_t inputs = st->mesh_in + st->mqtt_in;
+    printf("domator_replay: %s, root %" PRIu64 ", %" PRIu64
+           " records over %.3f s\n",
+           opt->path, g_device_id, st->records, st->span_us / 1e6);
+    if (opt->speed > 0) {
+        printf("fed %" PRIu64 " inputs (%" PRIu64 " mesh, %" PRIu64
+               " mqtt) at %gx",
+               inputs, st->mesh_in, st->mqtt_in, opt->speed);
+    } else {
+        printf("fed %" PRIu64 " inputs (%" PRIu64 " mesh, %" PRIu64
+               " mqtt) back to back",
+               inputs, st->mesh_in, st->mqtt_in);
+    }
+    printf(": %.3f s wall, %.3f s CPU, %.0f inputs/s\n", st->wall_s,
+           st->cpu_s, st->wall_s > 0 ? inputs / st->wall_s : 0);
+    if (st->truncated || st->lost || st->rx_full || st->no_sub) {
+        printf("skipped: %" PRIu64 " truncated, %" PRIu64
+               " lost in capture, %" PRIu64 " rx queue full, %" PRIu64
+               " unsubscribed\n",
+               st->truncated, st->lost, st->rx_full, st->no_sub);
+    }
+
+    printf("\noutputs   recorded  replayed   matched\n");
+    *matched = 0;
+    *recorded = 0;
+    for (int row = 0; row <= ROW_MQTT; row++) {
+        const row_stats_t* s = &s_rows[row];
+        if (s->recorded == 0 && s->replayed == 0) continue;
+        if (row == ROW_MQTT) {
+            printf("  mqtt  ");
+        } else {
+            printf("  mesh %c", row);
+        }
+        printf(" %9" PRIu64 " %9" PRIu64 " %9" PRIu64 "\n", s->recorded,
+               s->replayed, s->matched);
+        *matched += s->matched;
+        *recorded += s->recorded;
+    }
+    printf("outputs: %" PRIu64 "/%" PRIu64 " matched, %" PRIu64 " extra\n",
+           *matched, *recorded, s_extra);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--speed <x|max>] [--config <file>] [--out <file>]"
+            " [--strict] <capture.dcap>\n",
+            argv0);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    options_t opt = {.speed = 1};
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--speed") == 0 && has_value) {
+            const char* v = argv[++i];
+            opt.speed = strcmp(v, "max") == 0 ? 0 : strtod(v, NULL);
+            if (strcmp(v, "max") != 0 && opt.speed <= 0) usage(argv[0]);
+        } else if (strcmp(arg, "--config") == 0 && has_value) {
+            opt.config = argv[++i];
+        } else if (strcmp(arg, "--out") == 0 && has_value) {
+            opt.out = argv[++i];
+        } else if (strcmp(arg, "--strict") == 0) {
+            opt.strict = true;
+        } else if (arg[0] == '-' || opt.path) {
+            usage(argv[0]);
+        } else {
+            opt.path = arg;
+        }
+    }
+    if (opt.path == NULL) usage(argv[0]);
+
+    replay_stats_t st = {0};
+    if (!replay(&opt, &st)) return 1;
+
+    uint64_t matched, recorded;
+    report(&opt, &st, &matched, &recorded);
+    for (size_t i = 0; i < s_expected_count; i++) free(s_expected[i].key);
+    free(s_expected);
+
+    bool same = matched == recorded && s_extra == 0;
+    // Firmware tasks are still parked in the scheduler; skip their teardown.
+    fflush(stdout);
+    _exit(opt.strict && !same ? 1 : 0);
+}
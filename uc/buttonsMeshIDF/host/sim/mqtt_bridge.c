@@ -0,0 +1,242 @@
+/**
+ * @file mqtt_bridge.c
+ * @brief MQTT 3.1.1 over a plain TCP socket: CONNECT, SUBSCRIBE, PUBLISH at
+ *        QoS 0 in both directions and PINGREQ, which is all the root needs.
+ */
+
+#include "mqtt_bridge.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KEEPALIVE_S 60
+
+static const char* const s_topics[] = {
+    "/switch/cmd/+",
+    "/switch/cmd",
+    "/relay/cmd/+",
+    "/relay/cmd",
+};
+
+static int s_sock = -1;
+static uint8_t* s_rx;
+static size_t s_rx_len;
+static size_t s_rx_cap;
+static time_t s_last_tx;
+
+// ====================
+// Packets
+// ====================
+
+static bool send_all(const uint8_t* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(s_sock, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    s_last_tx = time(NULL);
+    return true;
+}
+
+/** @brief Send fixed header @p type with the body parts concatenated. */
+static bool send_packet(uint8_t type, const uint8_t* a, size_t a_len,
+                        const uint8_t* b, size_t b_len) {
+    size_t body = a_len + b_len;
+    uint8_t head[5] = {type};
+    size_t n = 1;
+    size_t rest = body;
+    do {
+        uint8_t byte = rest % 128;
+        rest /= 128;
+        if (rest) byte |= 0x80;
+        head[n++] = byte;
+    } while (rest && n < sizeof(head));
+
+    return send_all(head, n) && (a_len == 0 || send_all(a, a_len)) &&
+           (b_len == 0 || send_all(b, b_len));
+}
+
+static size_t put_string(uint8_t* p, const char* s) {
+    size_t len = strlen(s);
+    p[0] = (uint8_t)(len >> 8);
+    p[1] = (uint8_t)len;
+    memcpy(p + 2, s, len);
+    return len + 2;
+}
+
+/**
+ * @brief Length of the first complete packet in the receive buffer, 0 if
+ *        more bytes are needed.  @p body gets the offset of its body.
+ */
+static size_t packet_length(size_t* body) {
+    size_t value = 0;
+    size_t shift = 0;
+    for (size_t i = 1; i < s_rx_len && i < 5; i++) {
+        value |= (size_t)(s_rx[i] & 0x7F) << shift;
+        shift += 7;
+        if ((s_rx[i] & 0x80) == 0) {
+            *body = i + 1;
+            return s_rx_len >= i + 1 + value ? i + 1 + value : 0;
+        }
+    }
+    return 0;
+}
+
+static void handle_packet(const uint8_t* p, size_t body, size_t len,
+                          mqtt_bridge_rx_t rx, void* ctx) {
+    if ((p[0] >> 4) != 3 || len < body + 2) return;  // only PUBLISH
+    int qos = (p[0] >> 1) & 3;
+    size_t topic_len = ((size_t)p[body] << 8) | p[body + 1];
+    size_t data = body + 2 + topic_len + (qos ? 2 : 0);
+    if (data > len) return;
+
+    char topic[256];
+    if (topic_len >= sizeof(topic)) return;
+    memcpy(topic, p + body + 2, topic_len);
+    topic[topic_len] = '\0';
+
+    if (qos == 1) {
+        // PUBACK with the packet identifier.
+        send_packet(0x40, p + data - 2, 2, NULL, 0);
+    }
+    if (rx) rx(topic, (const char*)p + data, len - data, ctx);
+}
+
+// ====================
+// API
+// ====================
+
+bool mqtt_bridge_open(const char* broker, const char* client_id) {
+    char host[128];
+    const char* port = "1883";
+    snprintf(host, sizeof(host), "%s", broker);
+    char* colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = broker + (colon - host) + 1;
+    }
+
+    struct addrinfo hints = {.ai_socktype = SOCK_STREAM};
+    struct addrinfo* res = NULL;
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "mqtt: %s: %s\n", broker, gai_strerror(err));
+        return false;
+    }
+    for (struct addrinfo* ai = res; ai && s_sock < 0; ai = ai->ai_next) {
+        s_sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s_sock >= 0 && connect(s_sock, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(s_sock);
+            s_sock = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (s_sock < 0) {
+        fprintf(stderr, "mqtt: cannot connect to %s\n", broker);
+        return false;
+    }
+
+    uint8_t conn[300];
+    size_t n = put_string(conn, "MQTT");
+    conn[n++] = 4;     // protocol level 3.1.1
+    conn[n++] = 0x02;  // clean session
+    conn[n++] = KEEPALIVE_S >> 8;
+    conn[n++] = KEEPALIVE_S & 0xFF;
+    n += put_string(conn + n, client_id);
+    if (!send_packet(0x10, conn, n, NULL, 0)) return false;
+
+    uint8_t ack[4];
+    size_t got = 0;
+    while (got < sizeof(ack)) {
+        ssize_t r = recv(s_sock, ack + got, sizeof(ack) - got, 0);
+        if (r <= 0) {
+            fprintf(stderr, "mqtt: connection closed before CONNACK\n");
+            mqtt_bridge_close();
+            return false;
+        }
+        got += (size_t)r;
+    }
+    if (ack[0] != 0x20 || ack[3] != 0) {
+        fprintf(stderr, "mqtt: broker refused the connection (%u)\n",
+                ack[3]);
+        mqtt_bridge_close();
+        return false;
+    }
+
+    uint8_t sub[256];
+    n = 0;
+    sub[n++] = 0;
+    sub[n++] = 1;  // packet identifier
+    for (size_t i = 0; i < sizeof(s_topics) / sizeof(s_topics[0]); i++) {
+        n += put_string(sub + n, s_topics[i]);
+        sub[n++] = 0;  // QoS 0
+    }
+    return send_packet(0x82, sub, n, NULL, 0);
+}
+
+bool mqtt_bridge_publish(const char* topic, const char* data, size_t len,
+                         bool retain) {
+    if (s_sock < 0) return false;
+    uint8_t head[260];
+    if (strlen(topic) + 2 > sizeof(head)) return false;
+    size_t n = put_string(head, topic);
+    return send_packet(retain ? 0x31 : 0x30, head, n, (const uint8_t*)data,
+                       len);
+}
+
+bool mqtt_bridge_poll(mqtt_bridge_rx_t rx, void* ctx) {
+    if (s_sock < 0) return false;
+
+    struct pollfd pfd = {.fd = s_sock, .events = POLLIN};
+    while (poll(&pfd, 1, 0) > 0) {
+        if (s_rx_cap - s_rx_len < 4096) {
+            s_rx_cap = s_rx_cap ? s_rx_cap * 2 : 8192;
+            s_rx = realloc(s_rx, s_rx_cap);
+            if (s_rx == NULL) abort();
+        }
+        ssize_t r = recv(s_sock, s_rx + s_rx_len, s_rx_cap - s_rx_len, 0);
+        if (r <= 0) {
+            fprintf(stderr, "mqtt: broker closed the connection\n");
+            mqtt_bridge_close();
+            return false;
+        }
+        s_rx_len += (size_t)r;
+
+        size_t body;
+        size_t len;
+        while ((len = packet_length(&body)) > 0) {
+            handle_packet(s_rx, body, len, rx, ctx);
+            memmove(s_rx, s_rx + len, s_rx_len - len);
+            s_rx_len -= len;
+        }
+    }
+
+    if (time(NULL) - s_last_tx >= KEEPALIVE_S / 2) {
+        send_packet(0xC0, NULL, 0, NULL, 0);  // PINGREQ
+    }
+    return true;
+}
+
+void mqtt_bridge_close(void) {
+    if (s_sock >= 0) {
+        send_packet(0xE0, NULL, 0, NULL, 0);  // DISCONNECT
+        close(s_sock);
+    }
+    s_sock = -1;
+    free(s_rx);
+    s_rx = NULL;
+    s_rx_len = 0;
+    s_rx_cap = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * @file mqtt_bridge.h
+ * @brief Minimal MQTT 3.1.1 client (QoS 0, clean session) that connects the
+ *        simulated root to a real broker such as the Mosquitto of
+ *        turbacz/docker-compose.yml.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Called for every PUBLISH the broker sends. */
+typedef void (*mqtt_bridge_rx_t)(const char* topic, const char* data,
+                                 size_t len, void* ctx);
+
+/**
+ * @brief Connect to @p broker ("host:port", port 1883 if omitted) and
+ *        subscribe to the root's command topics.  Blocks until CONNACK.
+ */
+bool mqtt_bridge_open(const char* broker, const char* client_id);
+
+/** @brief Publish at QoS 0.  Returns false once the connection is gone. */
+bool mqtt_bridge_publish(const char* topic, const char* data, size_t len,
+                         bool retain);
+
+/**
+ * @brief Read whatever the broker sent without blocking, hand each PUBLISH
+ *        to @p rx, and keep the session alive.
+ */
+bool mqtt_bridge_poll(mqtt_bridge_rx_t rx, void* ctx);
+
+void mqtt_bridge_close(void);
@@ -0,0 +1,723 @@
+/**
+ * @file sim.c
+ * @brief domator_sim: many firmware nodes on one simulated mesh.
+ *
+ *   domator_sim [--json <file>] [--node-bin <path>] [--<key> <value>]...
+ *               <scenario>
+ *
+ * Builds a tree of one root, switches and relays from the scenario (see
+ * scenarios/), starts a domator_sim_node process per node and moves them
+ * forward in lockstep steps no longer than the shortest hop, so no frame
+ * can arrive inside the step it was sent in.  The root gets a connections
+ * table that routes every switch button to a relay output, then the
+ * switches are pressed and every press is followed until the relay output
+ * changes.  Any scenario key can be overridden on the command line, e.g.
+ * `--nodes 128 --loss 0.02`.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_bridge.h"
+#include "sim.h"
+
+/** Outputs of a relay8 board. */
+#define SIM_RELAY_OUTPUTS 8
+
+static sim_config_t s_cfg;
+static sim_node_t* s_nodes;
+static int s_count;
+static int s_switches;
+
+static sim_press_result_t* s_presses;
+static int s_press_count;
+static int s_press_cap;
+static uint64_t s_stray_applies;
+static uint64_t s_publishes;
+static bool s_bridge;
+static size_t s_config_bytes;
+
+// ====================
+// Scenario
+// ====================
+
+void sim_config_defaults(sim_config_t* cfg) {
+    *cfg = (sim_config_t){
+        .nodes = 16,
+        .relays = 5,
+        .fanout = 4,
+        .latency_us = 2000,
+        .jitter_us = 500,
+        .loss = 0.0,
+        .retries = 3,
+        .bandwidth_kbps = 2000,
+        .overhead_bytes = 60,
+        .queue = 32,
+        .seed = 1,
+        .config_ms = 1000,
+        .settle_ms = 3000,
+        .duration_ms = 10000,
+        .drain_ms = 2000,
+        .hold_ms = 120,
+        .rate = 2.0,
+        .buttons = 1,
+    };
+}
+
+static bool parse_u32(const char* s, uint32_t* out) {
+    char* end;
+    unsigned long v = strtoul(s, &end, 0);
+    if (*s == '\0' || *end != '\0' || v > UINT32_MAX) return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
+static bool parse_int(const char* s, int* out) {
+    uint32_t v;
+    if (!parse_u32(s, &v) || v > INT_MAX) return false;
+    *out = (int)v;
+    return true;
+}
+
+static bool parse_double(const char* s, double* out) {
+    char* end;
+    *out = strtod(s, &end);
+    return *s != '\0' && *end == '\0';
+}
+
+bool sim_config_set(sim_config_t* cfg, const char* key, const char* value) {
+    static const struct {
+        const char* key;
+        size_t offset;
+        char type;  // i = int, u = uint32, d = double
+    } keys[] = {
+#define K(name, type) {#name, offsetof(sim_config_t, name), type}
+        K(nodes, 'i'),          K(relays, 'i'),
+        K(fanout, 'i'),         K(latency_us, 'u'),
+        K(jitter_us, 'u'),      K(loss, 'd'),
+        K(retries, 'i'),        K(bandwidth_kbps, 'u'),
+        K(overhead_bytes, 'u'), K(queue, 'i'),
+        K(quantum_us, 'u'),     K(config_ms, 'u'),
+        K(settle_ms, 'u'),      K(duration_ms, 'u'),
+        K(drain_ms, 'u'),       K(hold_ms, 'u'),
+        K(rate, 'd'),           K(buttons, 'i'),
+#undef K
+    };
+
+    if (strcmp(key, "seed") == 0) {
+        char* end;
+        cfg->seed = strtoull(value, &end, 0);
+        return *value != '\0' && *end == '\0';
+    }
+    if (strcmp(key, "broker") == 0) {
+        snprintf(cfg->broker, sizeof(cfg->broker), "%s", value);
+        return true;
+    }
+    if (strcmp(key, "realtime") == 0) {
+        cfg->realtime = strcmp(value, "0") != 0;
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strcmp(key, keys[i].key) != 0) continue;
+        void* field = (uint8_t*)cfg + keys[i].offset;
+        switch (keys[i].type) {
+            case 'i':
+                return parse_int(value, field);
+            case 'u':
+                return parse_u32(value, field);
+            default:
+                return parse_double(value, field);
+        }
+    }
+    return false;
+}
+
+static bool add_press(sim_config_t* cfg, char* args) {
+    char* at = strtok(args, " \t");
+    char* sw = strtok(NULL, " \t");
+    char* button = strtok(NULL, " \t");
+    sim_press_t p;
+    if (at == NULL || sw == NULL || button == NULL ||
+        !parse_u32(at, &p.at_ms) || !parse_int(sw, &p.sw) ||
+        button[0] < 'a' || button[0] >= 'a' + NUM_BUTTONS) {
+        return false;
+    }
+    p.button = button[0] - 'a';
+    sim_press_t* grown = realloc(cfg->presses,
+                                 (cfg->press_count + 1) * sizeof(*grown));
+    if (grown == NULL) return false;
+    cfg->presses = grown;
+    cfg->presses[cfg->press_count++] = p;
+    return true;
+}
+
+bool sim_config_load(sim_config_t* cfg, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    int n = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* key = strtok(line, " \t\r\n");
+        if (key == NULL) continue;
+        char* value = strtok(NULL, "\r\n");
+        while (value && (*value == ' ' || *value == '\t')) value++;
+        char* end = value ? value + strlen(value) : NULL;
+        while (end && end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+
+        bool good = value != NULL &&
+                    (strcmp(key, "press") == 0 ? add_press(cfg, value)
+                                               : sim_config_set(cfg, key,
+                                                                value));
+        if (!good) {
+            fprintf(stderr, "%s:%d: bad line: %s\n", path, n, key);
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool config_check(const sim_config_t* cfg) {
+    if (cfg->nodes < 2 || cfg->nodes > SIM_MAX_NODES) {
+        fprintf(stderr, "nodes must be 2..%d\n", SIM_MAX_NODES);
+        return false;
+    }
+    if (cfg->relays < 1 || cfg->relays > cfg->nodes - 2) {
+        fprintf(stderr, "relays must leave at least one switch\n");
+        return false;
+    }
+    if (cfg->fanout < 1 || cfg->buttons < 1 || cfg->buttons > NUM_BUTTONS) {
+        fprintf(stderr, "fanout and buttons (1..%d) must be set\n",
+                NUM_BUTTONS);
+        return false;
+    }
+    if (cfg->latency_us == 0 && cfg->bandwidth_kbps == 0) {
+        fprintf(stderr, "a hop must take time: set latency_us\n");
+        return false;
+    }
+    if (cfg->loss < 0 || cfg->loss >= 1 || cfg->retries < 0 ||
+        cfg->queue < 1) {
+        fprintf(stderr, "loss must be in [0, 1), queue at least 1\n");
+        return false;
+    }
+    return true;
+}
+
+// ====================
+// Topology
+// ====================
+
+/** @brief Breadth-first tree with relays spread evenly over the nodes. */
+static int build_topology(void) {
+    int relays = 0;
+    int switches = 0;
+    int layers = 1;
+    int others = s_count - 1;
+    for (int i = 0; i < s_count; i++) {
+        sim_node_t* n = &s_nodes[i];
+        n->parent = i == 0 ? -1 : (i - 1) / s_cfg.fanout;
+        n->layer = i == 0 ? 1 : s_nodes[n->parent].layer + 1;
+        n->first_child = i * s_cfg.fanout + 1;
+        n->child_count = 0;
+        if (n->first_child < s_count) {
+            n->child_count = s_count - n->first_child;
+            if (n->child_count > s_cfg.fanout) n->child_count = s_cfg.fanout;
+        }
+        if (n->layer > layers) layers = n->layer;
+
+        if (i == 0) {
+            n->role = SIM_ROLE_ROOT;
+        } else if ((long)i * s_cfg.relays / others !=
+                   (long)(i - 1) * s_cfg.relays / others) {
+            n->role = SIM_ROLE_RELAY;
+            n->ordinal = relays++;
+        } else {
+            n->role = SIM_ROLE_SWITCH;
+            n->ordinal = switches++;
+        }
+    }
+    s_switches = switches;
+    return layers;
+}
+
+static int node_of_ordinal(sim_role_t role, int ordinal) {
+    for (int i = 0; i < s_count; i++) {
+        if (s_nodes[i].role == role && s_nodes[i].ordinal == ordinal) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** @brief Relay node and output that switch @p sw, button @p b drives. */
+static void route_of(int sw, int b, int* relay, int* output) {
+    int k = sw * s_cfg.buttons + b;
+    *relay = node_of_ordinal(SIM_ROLE_RELAY, k % s_cfg.relays);
+    *output = (k / s_cfg.relays) % SIM_RELAY_OUTPUTS;
+}
+
+// ====================
+// Node processes
+// ====================
+
+static bool spawn(int i, const char* node_bin) {
+    static const char* const roles[] = {"root", "switch", "relay"};
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        perror("socketpair");
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        int fd = dup(sv[1]);  // without CLOEXEC
+        char args[5][16];
+        snprintf(args[0], sizeof(args[0]), "%d", fd);
+        snprintf(args[1], sizeof(args[1]), "%d", i);
+        snprintf(args[2], sizeof(args[2]), "%d", s_nodes[i].layer);
+        snprintf(args[3], sizeof(args[3]), "%d", s_nodes[i].parent);
+        snprintf(args[4], sizeof(args[4]), "%d", s_count);
+        execl(node_bin, node_bin, args[0], args[1], roles[s_nodes[i].role],
+              args[2], args[3], args[4], (char*)NULL);
+        perror(node_bin);
+        _exit(127);
+    }
+    close(sv[1]);
+    s_nodes[i].pid = pid;
+    s_nodes[i].fd = sv[0];
+    return true;
+}
+
+static bool write_all(int fd, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* buf, size_t len) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// ====================
+// Presses
+// ====================
+
+static void add_result(int sw, int button, uint64_t release_us) {
+    if (s_press_count == s_press_cap) {
+        s_press_cap = s_press_cap ? s_press_cap * 2 : 256;
+        s_presses = realloc(s_presses, s_press_cap * sizeof(*s_presses));
+        if (s_presses == NULL) abort();
+    }
+    sim_press_result_t* r = &s_presses[s_press_count++];
+    *r = (sim_press_result_t){.sw = sw, .button = button,
+                              .release_us = release_us};
+    route_of(sw, button, &r->relay, &r->output);
+}
+
+/** @brief Press and release every switch button of the workload. */
+static void schedule_presses(void) {
+    uint64_t start = (uint64_t)s_cfg.settle_ms * 1000;
+    uint64_t end = start + (uint64_t)s_cfg.duration_ms * 1000;
+    uint64_t hold = (uint64_t)s_cfg.hold_ms * 1000;
+
+    for (int i = 0; i < s_cfg.press_count; i++) {
+        const sim_press_t* p = &s_cfg.presses[i];
+        int node = node_of_ordinal(SIM_ROLE_SWITCH, p->sw);
+        if (node < 0) {
+            fprintf(stderr, "press: no switch %d\n", p->sw);
+            continue;
+        }
+        uint64_t t = start + (uint64_t)p->at_ms * 1000;
+        sim_net_button(node, p->button, 1, t);
+        sim_net_button(node, p->button, 0, t + hold);
+        add_result(p->sw, p->button, t + hold);
+    }
+
+    if (s_cfg.rate <= 0) return;
+    // Poisson arrivals; a button that is still held is skipped.
+    uint64_t* held = calloc((size_t)s_switches * s_cfg.buttons,
+                            sizeof(*held));
+    if (held == NULL) abort();
+    double t = (double)start;
+    for (;;) {
+        t += -1e6 / s_cfg.rate * log1p(-sim_random());
+        if (t >= (double)end) break;
+        int sw = (int)(sim_random() * s_switches);
+        int b = (int)(sim_random() * s_cfg.buttons);
+        uint64_t at = (uint64_t)t;
+        if (held[sw * s_cfg.buttons + b] > at) continue;
+        held[sw * s_cfg.buttons + b] = at + hold + 50000;
+
+        int node = node_of_ordinal(SIM_ROLE_SWITCH, sw);
+        sim_net_button(node, b, 1, at);
+        sim_net_button(node, b, 0, at + hold);
+        add_result(sw, b, at + hold);
+    }
+    free(held);
+}
+
+/** @brief Match a relay output change to the oldest press waiting for it. */
+static void on_apply(int relay, int output, uint64_t t_us) {
+    for (int i = 0; i < s_press_count; i++) {
+        sim_press_result_t* r = &s_presses[i];
+        if (r->apply_us == 0 && r->relay == relay && r->output == output &&
+            r->release_us <= t_us) {
+            r->apply_us = t_us;
+            return;
+        }
+    }
+    s_stray_applies++;
+}
+
+// ====================
+// Root configuration and MQTT
+// ====================
+
+static void mqtt_to_root(const char* topic, const char* data, size_t len,
+                         uint64_t t_us) {
+    sim_buf_record(&s_nodes[0].inbox, SIM_REC_MQTT, t_us, topic,
+                   strlen(topic) + 1, data, len);
+}
+
+static uint64_t s_bridge_now;
+
+static void on_broker_message(const char* topic, const char* data,
+                              size_t len, void* ctx) {
+    (void)ctx;
+    mqtt_to_root(topic, data, len, s_bridge_now);
+}
+
+/**
+ * @brief Button types (all toggle) and connections for every switch, as
+ *        the backend would publish them.  Returns the larger payload size.
+ */
+static size_t configure_root(uint64_t t_us) {
+    size_t cap = 256 + (size_t)s_switches * s_cfg.buttons * 48;
+    char* types = malloc(cap);
+    char* conns = malloc(cap);
+    if (types == NULL || conns == NULL) abort();
+    size_t tn = snprintf(types, cap,
+                         "{\"type\":\"button_types\",\"data\":{");
+    size_t cn = snprintf(conns, cap, "{\"type\":\"connections\",\"data\":{");
+
+    for (int sw = 0; sw < s_switches; sw++) {
+        uint64_t id = s_nodes[node_of_ordinal(SIM_ROLE_SWITCH, sw)].id;
+        tn += snprintf(types + tn, cap - tn, "%s\"%" PRIu64 "\":{",
+                       sw ? "," : "", id);
+        cn += snprintf(conns + cn, cap - cn, "%s\"%" PRIu64 "\":{",
+                       sw ? "," : "", id);
+        for (int b = 0; b < s_cfg.buttons; b++) {
+            int relay;
+            int output;
+            route_of(sw, b, &relay, &output);
+            tn += snprintf(types + tn, cap - tn, "%s\"%c\":0", b ? "," : "",
+                           'a' + b);
+            cn += snprintf(conns + cn, cap - cn,
+                           "%s\"%c\":[[%" PRIu64 ",\"%c\"]]", b ? "," : "",
+                           'a' + b, s_nodes[relay].id, 'a' + output);
+        }
+        tn += snprintf(types + tn, cap - tn, "}");
+        cn += snprintf(conns + cn, cap - cn, "}");
+    }
+    tn += snprintf(types + tn, cap - tn, "}}");
+    cn += snprintf(conns + cn, cap - cn, "}}");
+
+    mqtt_to_root("/switch/cmd/root", types, tn, t_us);
+    mqtt_to_root("/switch/cmd/root", conns, cn, t_us + 1000);
+    free(types);
+    free(conns);
+    return tn > cn ? tn : cn;
+}
+
+// ====================
+// Lockstep
+// ====================
+
+static bool handle_record(int i, const sim_rec_t* rec,
+                          const uint8_t* payload) {
+    switch (rec->kind) {
+        case SIM_REC_HELLO: {
+            sim_hello_t hello;
+            if (rec->len < sizeof(hello)) return false;
+            memcpy(&hello, payload, sizeof(hello));
+            s_nodes[i].id = hello.device_id;
+            memcpy(s_nodes[i].addr, hello.addr, 6);
+            break;
+        }
+        case SIM_REC_TX:
+            if (rec->len < 6) return false;
+            sim_net_send(i, payload, payload + 6, rec->len - 6, rec->t_us);
+            break;
+        case SIM_REC_PUBLISH: {
+            s_publishes++;
+            if (!s_bridge || rec->len < 2) break;
+            const char* topic = (const char*)payload + 1;
+            size_t topic_len = strnlen(topic, rec->len - 1);
+            if (topic_len + 2 > rec->len) break;
+            mqtt_bridge_publish(topic, topic + topic_len + 1,
+                                rec->len - topic_len - 2, payload[0]);
+            break;
+        }
+        case SIM_REC_APPLY:
+            if (rec->len < 2) return false;
+            on_apply(i, payload[0], rec->t_us);
+            break;
+        case SIM_REC_STATS:
+            if (rec->len < sizeof(sim_stats_t)) return false;
+            memcpy(&s_nodes[i].stats, payload, sizeof(sim_stats_t));
+            break;
+    }
+    return true;
+}
+
+/** @brief Read node @p i's records up to (and including) @p until. */
+static bool collect(int i, uint8_t until) {
+    static uint8_t* payload;
+    static size_t cap;
+    for (;;) {
+        sim_rec_t rec;
+        if (!read_all(s_nodes[i].fd, &rec, sizeof(rec))) {
+            fprintf(stderr, "node %d exited\n", i);
+            return false;
+        }
+        if (rec.len > cap) {
+            payload = realloc(payload, rec.len);
+            if (payload == NULL) abort();
+            cap = rec.len;
+        }
+        if (rec.len && !read_all(s_nodes[i].fd, payload, rec.len)) {
+            return false;
+        }
+        if (!handle_record(i, &rec, payload)) {
+            fprintf(stderr, "node %d: bad record %u\n", i, rec.kind);
+            return false;
+        }
+        if (rec.kind == until) return true;
+    }
+}
+
+/** @brief Hand every node its inbox, run all to @p until_us, collect. */
+static bool step(uint64_t until_us, uint8_t kind) {
+    for (int i = 0; i < s_count; i++) {
+        sim_node_t* n = &s_nodes[i];
+        sim_buf_record(&n->inbox, kind, until_us, NULL, 0, NULL, 0);
+        if (!write_all(n->fd, n->inbox.data, n->inbox.len)) {
+            fprintf(stderr, "node %d: write failed\n", i);
+            return false;
+        }
+        n->inbox.len = 0;
+    }
+    uint8_t until = kind == SIM_REC_FINISH ? SIM_REC_STATS : SIM_REC_DONE;
+    for (int i = 0; i < s_count; i++) {
+        if (!collect(i, until)) return false;
+    }
+    return true;
+}
+
+static double wall_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run(uint64_t quantum, uint64_t end_us, double wall_start) {
+    uint64_t config_us = (uint64_t)s_cfg.config_ms * 1000;
+    bool configured = false;
+    uint64_t t = 0;
+    while (t < end_us) {
+        uint64_t next = t + quantum < end_us ? t + quantum : end_us;
+        if (!configured && config_us < next) {
+            s_config_bytes = configure_root(config_us > t ? config_us : t);
+            configured = true;
+        }
+        if (s_bridge) {
+            s_bridge_now = t;
+            if (!mqtt_bridge_poll(on_broker_message, NULL)) s_bridge = false;
+        }
+        if (s_cfg.realtime) {
+            double ahead = next / 1e6 - (wall_now() - wall_start);
+            if (ahead > 0) usleep((useconds_t)(ahead * 1e6));
+        }
+        sim_net_run(t, next);
+        if (!step(next, SIM_REC_STEP)) return false;
+        t = next;
+    }
+    return true;
+}
+
+// ====================
+// Main
+// ====================
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--json <file>] [--node-bin <path>]"
+            " [--<key> <value>]... <scenario>\n",
+            argv0);
+}
+
+static void default_node_bin(char* out, size_t size) {
+    char self[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (n <= 0) {
+        snprintf(out, size, "domator_sim_node");
+        return;
+    }
+    self[n] = '\0';
+    char* slash = strrchr(self, '/');
+    if (slash) slash[1] = '\0';
+    snprintf(out, size, "%sdomator_sim_node", slash ? self : "");
+}
+
+int main(int argc, char** argv) {
+    sim_config_defaults(&s_cfg);
+    const char* json_path = NULL;
+    const char* scenario = NULL;
+    char node_bin[PATH_MAX];
+    default_node_bin(node_bin, sizeof(node_bin));
+
+    // The scenario file first, then command-line overrides on top.
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) scenario = argv[i];
+        else i++;
+    }
+    if (scenario == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!sim_config_load(&s_cfg, scenario)) return 2;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) continue;
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* key = argv[i] + 2;
+        const char* value = argv[++i];
+        if (strcmp(key, "json") == 0) {
+            json_path = value;
+        } else if (strcmp(key, "node-bin") == 0) {
+            snprintf(node_bin, sizeof(node_bin), "%s", value);
+        } else if (!sim_config_set(&s_cfg, key, value)) {
+            fprintf(stderr, "bad option --%s %s\n", key, value);
+            return 2;
+        }
+    }
+    if (!config_check(&s_cfg)) return 2;
+
+    s_count = s_cfg.nodes;
+    s_nodes = calloc(s_count, sizeof(*s_nodes));
+    if (s_nodes == NULL) abort();
+    int layers = build_topology();
+    if (layers >= SIM_MAX_LAYERS) {
+        fprintf(stderr, "tree too deep: %d layers\n", layers);
+        return 2;
+    }
+    sim_net_init(&s_cfg, s_nodes, s_count);
+
+    uint64_t quantum = sim_net_min_hop_us();
+    if (s_cfg.quantum_us && s_cfg.quantum_us < quantum) {
+        quantum = s_cfg.quantum_us;
+    }
+
+    if (s_cfg.broker[0]) {
+        char client_id[32];
+        snprintf(client_id, sizeof(client_id), "domator-sim-%d",
+                 (int)getpid());
+        if (!mqtt_bridge_open(s_cfg.broker, client_id)) return 1;
+        s_bridge = true;
+    }
+
+    // Nodes log errors only unless asked otherwise.
+    setenv("DOMATOR_HOST_LOG", "E", 0);
+    signal(SIGPIPE, SIG_IGN);
+    double wall_start = wall_now();
+    for (int i = 0; i < s_count; i++) {
+        if (!spawn(i, node_bin)) return 1;
+    }
+    for (int i = 0; i < s_count; i++) {
+        if (!collect(i, SIM_REC_HELLO)) return 1;
+    }
+
+    schedule_presses();
+    uint64_t end_us = ((uint64_t)s_cfg.settle_ms + s_cfg.duration_ms +
+                       s_cfg.drain_ms) * 1000;
+    bool ok = run(quantum, end_us, wall_start) &&
+              step(end_us, SIM_REC_FINISH);
+    double wall_s = wall_now() - wall_start;
+
+    for (int i = 0; i < s_count; i++) {
+        close(s_nodes[i].fd);
+        waitpid(s_nodes[i].pid, NULL, 0);
+    }
+    if (s_bridge) mqtt_bridge_close();
+    if (!ok) return 1;
+
+    sim_result_t result = {
+        .cfg = &s_cfg,
+        .nodes = s_nodes,
+        .count = s_count,
+        .layers = layers,
+        .presses = s_presses,
+        .press_count = s_press_count,
+        .stray_applies = s_stray_applies,
+        .publishes = s_publishes,
+        .config_bytes = s_config_bytes,
+        .quantum_us = quantum,
+        .virtual_us = end_us,
+        .wall_s = wall_s,
+    };
+    sim_report_text(&result, stdout);
+    if (json_path) {
+        FILE* f = fopen(json_path, "w");
+        if (f == NULL) {
+            perror(json_path);
+            return 1;
+        }
+        sim_report_json(&result, f);
+        fclose(f);
+    }
+    return 0;
+}
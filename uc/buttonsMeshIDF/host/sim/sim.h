@@ -0,0 +1,184 @@
+#pragma once
+
+/**
+ * @file sim.h
+ * @brief domator_sim internals shared by the coordinator (sim.c), the
+ *        network model (sim_net.c) and the report (sim_report.c).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "sim_proto.h"
+
+#define SIM_MAX_NODES 1024
+#define SIM_MAX_LAYERS 32
+
+// ====================
+// Scenario
+// ====================
+
+typedef struct {
+    uint32_t at_ms;  ///< after the workload starts
+    int sw;          ///< switch ordinal
+    int button;      ///< 0 = 'a'
+} sim_press_t;
+
+typedef struct {
+    // Topology
+    int nodes;   ///< including the root
+    int relays;  ///< the rest are switches
+    int fanout;  ///< children per node, filled breadth-first
+
+    // Per-hop link model
+    uint32_t latency_us;      ///< propagation plus mesh stack, per hop
+    uint32_t jitter_us;       ///< uniform extra latency per hop
+    double loss;              ///< per attempt
+    int retries;              ///< MAC retransmissions before a frame is lost
+    uint32_t bandwidth_kbps;  ///< airtime of every transmission
+    uint32_t overhead_bytes;  ///< MAC and mesh headers per frame
+    int queue;                ///< frames a radio holds before dropping
+    uint32_t quantum_us;      ///< lockstep step; 0 = lookahead
+
+    // Workload
+    uint64_t seed;
+    uint32_t config_ms;    ///< when the root gets its routes
+    uint32_t settle_ms;    ///< when presses start
+    uint32_t duration_ms;  ///< presses happen during this window
+    uint32_t drain_ms;     ///< quiet time after the last press
+    uint32_t hold_ms;      ///< press to release
+    double rate;           ///< random presses per second, mesh-wide
+    int buttons;           ///< routed buttons per switch
+    sim_press_t* presses;  ///< scripted presses
+    int press_count;
+
+    // MQTT bridge
+    char broker[128];  ///< host:port, empty for none
+    bool realtime;     ///< never run ahead of the wall clock
+} sim_config_t;
+
+bool sim_config_load(sim_config_t* cfg, const char* path);
+bool sim_config_set(sim_config_t* cfg, const char* key, const char* value);
+void sim_config_defaults(sim_config_t* cfg);
+
+// ====================
+// Nodes
+// ====================
+
+typedef enum {
+    SIM_ROLE_ROOT,
+    SIM_ROLE_SWITCH,
+    SIM_ROLE_RELAY,
+} sim_role_t;
+
+/** @brief Growable byte buffer for outgoing records. */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} sim_buf_t;
+
+typedef struct {
+    sim_role_t role;
+    int ordinal;  ///< index among the nodes of the same role
+    int parent;   ///< -1 for the root
+    int layer;    ///< root is 1
+    int first_child;
+    int child_count;
+
+    pid_t pid;
+    int fd;
+    uint64_t id;
+    uint8_t addr[6];
+    sim_buf_t inbox;  ///< records for the next step
+    sim_stats_t stats;
+
+    // Radio
+    uint64_t busy_until_us;
+    int queued;
+    uint64_t airtime_us;
+} sim_node_t;
+
+// ====================
+// Network (sim_net.c)
+// ====================
+
+/** @brief Per hop tier (link between layer L and L+1) and direction. */
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t retries;
+    uint64_t lost;
+    uint64_t queue_drops;
+} sim_tier_t;
+
+typedef struct {
+    sim_tier_t tiers[SIM_MAX_LAYERS][2];  ///< [upper layer][0 = up, 1 = down]
+    uint64_t hops_by_type[256];           ///< transmissions per msg_type
+    uint64_t sent_by_type[256];           ///< frames the firmware sent
+    uint64_t delivered;
+    uint64_t no_route;   ///< unknown destination address
+    uint64_t late;       ///< deliveries the lookahead could not honour
+} sim_net_stats_t;
+
+void sim_net_init(const sim_config_t* cfg, sim_node_t* nodes, int count);
+
+/** @brief Shortest time a frame can spend on one hop; bounds the step. */
+uint64_t sim_net_min_hop_us(void);
+
+/** @brief A frame node @p src sent at @p t_us to mesh address @p to. */
+void sim_net_send(int src, const uint8_t to[6], const uint8_t* frame,
+                  size_t len, uint64_t t_us);
+
+/** @brief Queue a button edge for a node at @p t_us. */
+void sim_net_button(int node, int index, int level, uint64_t t_us);
+
+/**
+ * @brief Run the network until @p until_us; every delivery before it is
+ *        appended to the receiving node's inbox.  @p window_start is the
+ *        earliest time a delivery may still be handed to a node.
+ */
+void sim_net_run(uint64_t window_start, uint64_t until_us);
+
+const sim_net_stats_t* sim_net_stats(void);
+
+/** @brief Append one record to a node's inbox. */
+void sim_buf_record(sim_buf_t* buf, uint8_t kind, uint64_t t_us,
+                    const void* a, size_t a_len, const void* b,
+                    size_t b_len);
+
+/** @brief Uniform random number in [0, 1), from the scenario seed. */
+double sim_random(void);
+
+// ====================
+// Results (sim_report.c)
+// ====================
+
+typedef struct {
+    int sw;
+    int button;
+    int relay;   ///< node index
+    int output;  ///< 0 = 'a'
+    uint64_t release_us;
+    uint64_t apply_us;  ///< 0 until the relay output changed
+} sim_press_result_t;
+
+typedef struct {
+    const sim_config_t* cfg;
+    const sim_node_t* nodes;
+    int count;
+    int layers;
+    sim_press_result_t* presses;
+    int press_count;
+    uint64_t stray_applies;  ///< output changes no press explains
+    uint64_t publishes;
+    size_t config_bytes;  ///< size of the largest config payload sent
+    uint64_t quantum_us;
+    uint64_t virtual_us;
+    double wall_s;
+} sim_result_t;
+
+void sim_report_text(const sim_result_t* r, FILE* out);
+void sim_report_json(const sim_result_t* r, FILE* out);
@@ -0,0 +1,349 @@
+/**
+ * @file sim_net.c
+ * @brief The simulated mesh: a tree of radios with per-hop latency, loss
+ *        and bandwidth, driven by a time-ordered event queue.
+ *
+ * ESP-MESH forwards in the WiFi stack, not in the application, so frames
+ * cross intermediate nodes without waking their firmware: a unicast frame
+ * climbs to the lowest common ancestor and descends to its destination,
+ * the all-zero address means the root, and a broadcast goes to the root
+ * and is then flooded down every link.
+ *
+ * Every node has one radio.  A hop queues at the sending radio (up to
+ * `queue` frames, then drops), occupies it for the frame's airtime once per
+ * attempt (each attempt lost with probability `loss`, `retries` more
+ * attempts before the frame is lost), and arrives `latency` plus up to
+ * `jitter` after the last attempt ends.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+typedef struct {
+    int refs;
+    int src;   ///< originating node
+    int dest;  ///< unicast destination; the root for broadcasts
+    bool broadcast;
+    size_t len;
+    uint8_t data[];
+} net_frame_t;
+
+typedef enum {
+    EV_ENQUEUE,  ///< frame reaches the sending radio's queue
+    EV_TX_DONE,  ///< last attempt left the radio
+    EV_ARRIVE,   ///< frame reaches the next node
+    EV_BUTTON,
+} ev_kind_t;
+
+typedef struct {
+    uint64_t t_us;
+    uint64_t seq;  ///< FIFO among equal times
+    uint8_t kind;
+    bool lost;
+    bool flooding;  ///< broadcast on its way down from the root
+    int from;       ///< transmitting node
+    int to;         ///< receiving node (or the button's node)
+    net_frame_t* frame;
+    int button;
+    int level;
+} net_event_t;
+
+static const sim_config_t* s_cfg;
+static sim_node_t* s_nodes;
+static int s_count;
+static sim_net_stats_t s_stats;
+static uint64_t s_window_start;
+
+static net_event_t* s_heap;
+static size_t s_heap_len;
+static size_t s_heap_cap;
+static uint64_t s_seq;
+static uint64_t s_rng;
+
+// ====================
+// Helpers
+// ====================
+
+double sim_random(void) {
+    // xorshift64*
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    uint64_t r = (s_rng * 0x2545F4914F6CDD1DULL) >> 11;
+    return (double)r / (double)(1ULL << 53);
+}
+
+void sim_buf_record(sim_buf_t* buf, uint8_t kind, uint64_t t_us,
+                    const void* a, size_t a_len, const void* b,
+                    size_t b_len) {
+    size_t need = buf->len + sizeof(sim_rec_t) + a_len + b_len;
+    if (need > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap < need) cap *= 2;
+        buf->data = realloc(buf->data, cap);
+        if (buf->data == NULL) abort();
+        buf->cap = cap;
+    }
+    sim_rec_t rec = {.kind = kind, .len = (uint32_t)(a_len + b_len),
+                     .t_us = t_us};
+    memcpy(buf->data + buf->len, &rec, sizeof(rec));
+    buf->len += sizeof(rec);
+    if (a_len) memcpy(buf->data + buf->len, a, a_len);
+    buf->len += a_len;
+    if (b_len) memcpy(buf->data + buf->len, b, b_len);
+    buf->len += b_len;
+}
+
+static uint64_t airtime_us(size_t len) {
+    if (s_cfg->bandwidth_kbps == 0) return 0;
+    uint64_t bits = (uint64_t)(len + s_cfg->overhead_bytes) * 8;
+    return (bits * 1000 + s_cfg->bandwidth_kbps - 1) / s_cfg->bandwidth_kbps;
+}
+
+uint64_t sim_net_min_hop_us(void) {
+    return s_cfg->latency_us + airtime_us(0);
+}
+
+/** @brief Node index of a mesh address, or -1. */
+static int node_of(const uint8_t addr[6]) {
+    int index = ((addr[4] << 8) | addr[5]) - 1;
+    if (index < 0 || index >= s_count) return -1;
+    if (memcmp(s_nodes[index].addr, addr, 6) != 0) return -1;
+    return index;
+}
+
+/** @brief The neighbour of @p u on the tree path to @p dest. */
+static int next_hop(int u, int dest) {
+    int v = dest;
+    while (v >= 0 && s_nodes[v].layer > s_nodes[u].layer + 1) {
+        v = s_nodes[v].parent;
+    }
+    if (v >= 0 && s_nodes[v].parent == u) return v;
+    return s_nodes[u].parent;
+}
+
+static void frame_unref(net_frame_t* f) {
+    if (--f->refs == 0) free(f);
+}
+
+// ====================
+// Event queue
+// ====================
+
+static bool before(const net_event_t* a, const net_event_t* b) {
+    return a->t_us < b->t_us || (a->t_us == b->t_us && a->seq < b->seq);
+}
+
+static void push(net_event_t ev) {
+    if (s_heap_len == s_heap_cap) {
+        s_heap_cap = s_heap_cap ? s_heap_cap * 2 : 1024;
+        s_heap = realloc(s_heap, s_heap_cap * sizeof(*s_heap));
+        if (s_heap == NULL) abort();
+    }
+    ev.seq = s_seq++;
+    size_t i = s_heap_len++;
+    while (i > 0) {
+        size_t up = (i - 1) / 2;
+        if (!before(&ev, &s_heap[up])) break;
+        s_heap[i] = s_heap[up];
+        i = up;
+    }
+    s_heap[i] = ev;
+}
+
+static net_event_t pop(void) {
+    net_event_t top = s_heap[0];
+    net_event_t last = s_heap[--s_heap_len];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= s_heap_len) break;
+        if (c + 1 < s_heap_len && before(&s_heap[c + 1], &s_heap[c])) c++;
+        if (!before(&s_heap[c], &last)) break;
+        s_heap[i] = s_heap[c];
+        i = c;
+    }
+    if (s_heap_len) s_heap[i] = last;
+    return top;
+}
+
+// ====================
+// Hops
+// ====================
+
+static void hop(int from, int to, net_frame_t* f, bool flooding,
+                uint64_t t_us) {
+    push((net_event_t){.t_us = t_us, .kind = EV_ENQUEUE, .from = from,
+                       .to = to, .frame = f, .flooding = flooding});
+}
+
+static void deliver(int v, net_frame_t* f, uint64_t t_us) {
+    if (t_us < s_window_start) {
+        s_stats.late++;
+        t_us = s_window_start;
+    }
+    sim_buf_record(&s_nodes[v].inbox, SIM_REC_FRAME, t_us,
+                   s_nodes[f->src].addr, 6, f->data, f->len);
+    s_stats.delivered++;
+}
+
+static void on_enqueue(const net_event_t* ev) {
+    sim_node_t* u = &s_nodes[ev->from];
+    bool up = s_nodes[ev->to].layer < u->layer;
+    int upper = up ? s_nodes[ev->to].layer : u->layer;
+    sim_tier_t* tier = &s_stats.tiers[upper][up ? 0 : 1];
+
+    if (u->queued >= s_cfg->queue) {
+        tier->queue_drops++;
+        frame_unref(ev->frame);
+        return;
+    }
+    u->queued++;
+
+    uint64_t air = airtime_us(ev->frame->len);
+    uint64_t start =
+        u->busy_until_us > ev->t_us ? u->busy_until_us : ev->t_us;
+    int attempts = 0;
+    bool lost = true;
+    while (attempts <= s_cfg->retries) {
+        attempts++;
+        if (sim_random() >= s_cfg->loss) {
+            lost = false;
+            break;
+        }
+    }
+    u->busy_until_us = start + air * attempts;
+    u->airtime_us += air * attempts;
+
+    tier->frames++;
+    tier->bytes += ev->frame->len;
+    tier->retries += attempts - 1;
+    if (ev->frame->len > 8) s_stats.hops_by_type[ev->frame->data[8]]++;
+
+    net_event_t done = *ev;
+    done.t_us = u->busy_until_us;
+    done.kind = EV_TX_DONE;
+    done.lost = lost;
+    push(done);
+}
+
+static void on_tx_done(const net_event_t* ev) {
+    sim_node_t* u = &s_nodes[ev->from];
+    u->queued--;
+    if (ev->lost) {
+        bool up = s_nodes[ev->to].layer < u->layer;
+        int upper = up ? s_nodes[ev->to].layer : u->layer;
+        s_stats.tiers[upper][up ? 0 : 1].lost++;
+        frame_unref(ev->frame);
+        return;
+    }
+    net_event_t arrive = *ev;
+    arrive.t_us = ev->t_us + s_cfg->latency_us +
+                  (uint64_t)(sim_random() * s_cfg->jitter_us);
+    arrive.kind = EV_ARRIVE;
+    push(arrive);
+}
+
+static void flood(int v, net_frame_t* f, uint64_t t_us) {
+    const sim_node_t* n = &s_nodes[v];
+    for (int c = 0; c < n->child_count; c++) {
+        f->refs++;
+        hop(v, n->first_child + c, f, true, t_us);
+    }
+}
+
+static void on_arrive(const net_event_t* ev) {
+    int v = ev->to;
+    net_frame_t* f = ev->frame;
+    if (ev->flooding || (f->broadcast && v == f->dest)) {
+        if (v != f->src) deliver(v, f, ev->t_us);
+        flood(v, f, ev->t_us);
+    } else if (v == f->dest) {
+        deliver(v, f, ev->t_us);
+    } else {
+        f->refs++;
+        hop(v, next_hop(v, f->dest), f, false, ev->t_us);
+    }
+    frame_unref(f);
+}
+
+// ====================
+// API
+// ====================
+
+void sim_net_init(const sim_config_t* cfg, sim_node_t* nodes, int count) {
+    s_cfg = cfg;
+    s_nodes = nodes;
+    s_count = count;
+    s_rng = cfg->seed ? cfg->seed : 1;
+}
+
+void sim_net_send(int src, const uint8_t to[6], const uint8_t* frame,
+                  size_t len, uint64_t t_us) {
+    static const uint8_t zero[6] = {0};
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (len > 8) s_stats.sent_by_type[frame[8]]++;
+
+    bool broadcast = memcmp(to, bcast, 6) == 0;
+    int dest = (broadcast || memcmp(to, zero, 6) == 0) ? 0 : node_of(to);
+    if (dest < 0) {
+        s_stats.no_route++;
+        return;
+    }
+
+    net_frame_t* f = malloc(sizeof(*f) + len);
+    if (f == NULL) abort();
+    f->refs = 1;
+    f->src = src;
+    f->dest = dest;
+    f->broadcast = broadcast;
+    f->len = len;
+    memcpy(f->data, frame, len);
+
+    if (broadcast && src == 0) {
+        flood(0, f, t_us);
+        frame_unref(f);
+    } else if (dest == src) {
+        // Loopback never touches the radio; hand it over one hop later.
+        push((net_event_t){.t_us = t_us + sim_net_min_hop_us(),
+                           .kind = EV_ARRIVE, .from = src, .to = src,
+                           .frame = f});
+    } else {
+        hop(src, next_hop(src, dest), f, false, t_us);
+    }
+}
+
+void sim_net_button(int node, int index, int level, uint64_t t_us) {
+    push((net_event_t){.t_us = t_us, .kind = EV_BUTTON, .to = node,
+                       .button = index, .level = level});
+}
+
+void sim_net_run(uint64_t window_start, uint64_t until_us) {
+    s_window_start = window_start;
+    while (s_heap_len > 0 && s_heap[0].t_us < until_us) {
+        net_event_t ev = pop();
+        switch (ev.kind) {
+            case EV_ENQUEUE:
+                on_enqueue(&ev);
+                break;
+            case EV_TX_DONE:
+                on_tx_done(&ev);
+                break;
+            case EV_ARRIVE:
+                on_arrive(&ev);
+                break;
+            case EV_BUTTON: {
+                uint8_t edge[2] = {(uint8_t)ev.button, (uint8_t)ev.level};
+                uint64_t t = ev.t_us;
+                if (t < s_window_start) t = s_window_start;
+                sim_buf_record(&s_nodes[ev.to].inbox, SIM_REC_BUTTON, t,
+                               edge, sizeof(edge), NULL, 0);
+                break;
+            }
+        }
+    }
+}
+
+const sim_net_stats_t* sim_net_stats(void) { return &s_stats; }
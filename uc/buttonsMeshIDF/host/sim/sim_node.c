@@ -0,0 +1,268 @@
+/**
+ * @file sim_node.c
+ * @brief domator_sim_node: one firmware instance inside a domator_sim run.
+ *
+ *   domator_sim_node <fd> <index> <root|switch|relay> <layer> <parent>
+ *                    <total_nodes>
+ *
+ * Boots app_main() at virtual time 0 at the given mesh position, then
+ * serves the records of sim_proto.h on @p fd until FINISH.  Frames the
+ * firmware sends, root publishes and relay output changes are collected by
+ * the HAL hooks and returned, stamped, when the step ends.  Switch presses
+ * go through host_button_event(), so node_switch.c's button task builds the
+ * frames exactly as on target.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "domator_mesh.h"
+#include "host_hal.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "sim_proto.h"
+
+void app_main(void);
+
+static int s_fd = -1;
+static uint32_t s_rx_drops;
+
+/** Records produced during the current step, flushed before DONE. */
+static uint8_t* s_out;
+static size_t s_out_len;
+static size_t s_out_cap;
+
+// ====================
+// Record I/O
+// ====================
+
+static void die(const char* what) {
+    fprintf(stderr, "sim_node: %s: %s\n", what, strerror(errno));
+    exit(2);
+}
+
+static void read_all(void* buf, size_t len) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = read(s_fd, p, len);
+        if (n == 0) exit(0);  // coordinator went away
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            die("read");
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+static void write_all(const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(s_fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            die("write");
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * @brief Queue a record for the end of the step.  Only one firmware task
+ *        runs at a time, so the hooks need no lock.
+ */
+static void emit(uint8_t kind, const void* a, size_t a_len, const void* b,
+                 size_t b_len) {
+    size_t need = s_out_len + sizeof(sim_rec_t) + a_len + b_len;
+    if (need > s_out_cap) {
+        size_t cap = s_out_cap ? s_out_cap : 4096;
+        while (cap < need) cap *= 2;
+        s_out = realloc(s_out, cap);
+        if (s_out == NULL) die("realloc");
+        s_out_cap = cap;
+    }
+    sim_rec_t rec = {
+        .kind = kind,
+        .len = (uint32_t)(a_len + b_len),
+        .t_us = host_now_us(),
+    };
+    memcpy(s_out + s_out_len, &rec, sizeof(rec));
+    s_out_len += sizeof(rec);
+    if (a_len) memcpy(s_out + s_out_len, a, a_len);
+    s_out_len += a_len;
+    if (b_len) memcpy(s_out + s_out_len, b, b_len);
+    s_out_len += b_len;
+}
+
+static void flush(void) {
+    write_all(s_out, s_out_len);
+    s_out_len = 0;
+}
+
+// ====================
+// HAL hooks
+// ====================
+
+static esp_err_t on_send(const mesh_addr_t* to, const uint8_t* data,
+                         size_t len, int flag, void* ctx) {
+    (void)flag;
+    (void)ctx;
+    emit(SIM_REC_TX, to->addr, 6, data, len);
+    return ESP_OK;
+}
+
+static void on_publish(const char* topic, const char* data, int len,
+                       int qos, int retain, void* ctx) {
+    (void)qos;
+    (void)ctx;
+    while (len > 0 && data[len - 1] == '\0') len--;
+    char head[160];
+    head[0] = retain ? 1 : 0;
+    int n = snprintf(head + 1, sizeof(head) - 1, "%s", topic);
+    if (n < 0 || n >= (int)sizeof(head) - 1) return;
+    emit(SIM_REC_PUBLISH, head, (size_t)n + 2, data, (size_t)len);
+}
+
+static void on_gpio(int gpio, int level, void* ctx) {
+    (void)ctx;
+    for (int i = 0; i < MAX_RELAYS_8; i++) {
+        if (g_relay_8_pins[i] == gpio) {
+            uint8_t apply[2] = {(uint8_t)i, (uint8_t)level};
+            emit(SIM_REC_APPLY, apply, sizeof(apply), NULL, 0);
+            return;
+        }
+    }
+}
+
+// ====================
+// Commands
+// ====================
+
+static void deliver(const sim_rec_t* rec, const uint8_t* payload) {
+    host_run_to_us(rec->t_us);
+    switch (rec->kind) {
+        case SIM_REC_FRAME: {
+            if (rec->len < 6) break;
+            mesh_addr_t from = {0};
+            memcpy(from.addr, payload, 6);
+            if (host_mesh_inject(&from, payload + 6, rec->len - 6) != ESP_OK) {
+                s_rx_drops++;
+            }
+            break;
+        }
+        case SIM_REC_BUTTON:
+            if (rec->len >= 2) host_button_event(payload[0], payload[1]);
+            break;
+        case SIM_REC_MQTT: {
+            size_t topic_len = strnlen((const char*)payload, rec->len);
+            if (topic_len >= rec->len) break;
+            host_mqtt_inject((const char*)payload,
+                             (const char*)payload + topic_len + 1,
+                             (int)(rec->len - topic_len - 1));
+            break;
+        }
+    }
+}
+
+static void send_stats(void) {
+    sim_stats_t stats = {.rx_drops = s_rx_drops};
+    for (int i = 0; i < CNT_COUNT; i++) stats.counters[i] = counter_get(i);
+
+    struct timespec cpu;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    stats.cpu_us = (uint64_t)cpu.tv_sec * 1000000 + cpu.tv_nsec / 1000;
+
+#if CONFIG_DOMATOR_PROFILER
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        prof_hist_t h;
+        profiler_get(s, &h);
+        stats.prof_count[s] = h.count;
+        stats.prof_cycles[s] = h.sum;
+        profiler_stage_name(s, stats.prof_name[s], sizeof(stats.prof_name[s]));
+    }
+#endif
+    emit(SIM_REC_STATS, &stats, sizeof(stats), NULL, 0);
+    flush();
+}
+
+// ====================
+// Boot
+// ====================
+
+static void boot(int index, const char* role, int layer, int parent,
+                 int total) {
+    host_node_t node = {
+        .is_root = index == 0,
+        .layer = index == 0 ? 1 : layer,
+        .rssi = (int8_t)(-45 - 5 * layer),
+        .total_nodes = total,
+    };
+    sim_node_mac(index, node.mac);
+    if (index != 0) sim_node_mac(parent, node.parent_bssid);
+    host_node_config(&node);
+
+    uint8_t hardware_type = strcmp(role, "relay") == 0 ? 1 : 0;
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(nvs_open("domator", NVS_READWRITE, &nvs));
+    ESP_ERROR_CHECK(nvs_set_u8(nvs, "hardware_type", hardware_type));
+    nvs_close(nvs);
+
+    host_mesh_set_tx_hook(on_send, NULL);
+    host_mqtt_set_publish_hook(on_publish, NULL);
+    host_gpio_set_output_hook(on_gpio, NULL);
+    app_main();
+
+    sim_hello_t hello = {.device_id = g_device_id};
+    mesh_addr_t addr;
+    host_id_to_addr(g_device_id, &addr);
+    memcpy(hello.addr, addr.addr, 6);
+    emit(SIM_REC_HELLO, &hello, sizeof(hello), NULL, 0);
+    flush();
+}
+
+int main(int argc, char** argv) {
+    if (argc != 7) {
+        fprintf(stderr,
+                "usage: %s <fd> <index> <root|switch|relay> <layer> <parent>"
+                " <total_nodes>\n",
+                argv[0]);
+        return 2;
+    }
+    s_fd = atoi(argv[1]);
+    boot(atoi(argv[2]), argv[3], atoi(argv[4]), atoi(argv[5]),
+         atoi(argv[6]));
+
+    uint8_t* payload = NULL;
+    size_t payload_cap = 0;
+    for (;;) {
+        sim_rec_t rec;
+        read_all(&rec, sizeof(rec));
+        if (rec.len > payload_cap) {
+            payload = realloc(payload, rec.len);
+            if (payload == NULL) die("realloc");
+            payload_cap = rec.len;
+        }
+        if (rec.len) read_all(payload, rec.len);
+
+        if (rec.kind == SIM_REC_STEP) {
+            host_run_to_us(rec.t_us);
+            emit(SIM_REC_DONE, NULL, 0, NULL, 0);
+            flush();
+        } else if (rec.kind == SIM_REC_FINISH) {
+            send_stats();
+            break;
+        } else {
+            deliver(&rec, payload);
+        }
+    }
+    free(payload);
+    free(s_out);
+    // Firmware tasks are still parked in the scheduler; skip their teardown.
+    _exit(0);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * @file sim_proto.h
+ * @brief Records exchanged between domator_sim and its node processes.
+ *
+ * The firmware keeps its state in globals, so every simulated node is its
+ * own domator_sim_node process with one firmware instance on the virtual
+ * clock of hal/freertos.c.  The coordinator owns the network and moves all
+ * nodes forward in lockstep over a socketpair per node:
+ *
+ *   coordinator -> node:  FRAME / BUTTON / MQTT records stamped with the
+ *                         virtual time they happen at, then STEP(t).
+ *   node -> coordinator:  everything the firmware did until t (TX,
+ *                         PUBLISH, APPLY, each stamped), then DONE.
+ *
+ * Every record is a sim_rec_t followed by @c len payload bytes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "domator_mesh.h"
+
+typedef struct {
+    uint8_t kind;
+    uint8_t pad[3];
+    uint32_t len;   ///< payload bytes after the header
+    uint64_t t_us;  ///< virtual time the record applies to
+} sim_rec_t;
+
+enum {
+    // coordinator -> node
+    SIM_REC_FRAME = 1,  ///< 6-byte sender address, then the frame
+    SIM_REC_BUTTON,     ///< button index, level
+    SIM_REC_MQTT,       ///< topic, NUL, payload (root only)
+    SIM_REC_STEP,       ///< run until t_us, then reply and DONE
+    SIM_REC_FINISH,     ///< reply with STATS and exit
+
+    // node -> coordinator
+    SIM_REC_HELLO = 16,  ///< sim_hello_t, once after boot
+    SIM_REC_TX,          ///< 6-byte destination address, then the frame
+    SIM_REC_PUBLISH,     ///< retain flag, topic, NUL, payload
+    SIM_REC_APPLY,       ///< relay output index, level
+    SIM_REC_DONE,        ///< step finished
+    SIM_REC_STATS,       ///< sim_stats_t
+};
+
+typedef struct {
+    uint64_t device_id;
+    uint8_t addr[6];  ///< mesh address the node sends from
+} sim_hello_t;
+
+/** @brief What a node reports when the run ends. */
+typedef struct {
+    uint32_t counters[CNT_COUNT];
+    uint32_t rx_drops;  ///< frames refused by the full receive queue
+    uint64_t cpu_us;    ///< host CPU time of the node process
+    uint32_t prof_count[PROF_STAGE_COUNT];  ///< zero without the profiler
+    uint64_t prof_cycles[PROF_STAGE_COUNT];
+    char prof_name[PROF_STAGE_COUNT][16];
+} sim_stats_t;
+
+/** @brief SoftAP MAC of simulated node @p index (0 is the root). */
+static inline void sim_node_mac(int index, uint8_t mac[6]) {
+    mac[0] = 0x02;
+    mac[1] = 0x53;  // 'S'
+    mac[2] = 0x49;  // 'I'
+    mac[3] = 0x4D;  // 'M'
+    mac[4] = (uint8_t)((index + 1) >> 8);
+    mac[5] = (uint8_t)(index + 1);
+}
@@ -0,0 +1,237 @@
+/**
+ * @file sim_report.c
+ * @brief End-of-run report: press-to-apply latency, traffic per hop tier,
+ *        airtime, drops at every queue, and the root's own cost.  The JSON
+ *        form carries the same numbers for plotting runs against each other.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "sim.h"
+
+typedef struct {
+    int applied;
+    double p50, p90, p99, max, mean;  ///< milliseconds
+} latency_t;
+
+typedef struct {
+    uint64_t tx_drop_normal;
+    uint64_t tx_drop_high;
+    uint64_t send_failed;
+    uint64_t rx_drops;
+    int busiest;  ///< node with the most airtime
+} totals_t;
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static latency_t latency(const sim_result_t* r) {
+    latency_t l = {0};
+    uint64_t* v = malloc((r->press_count + 1) * sizeof(*v));
+    if (v == NULL) abort();
+    double sum = 0;
+    for (int i = 0; i < r->press_count; i++) {
+        const sim_press_result_t* p = &r->presses[i];
+        if (p->apply_us == 0) continue;
+        v[l.applied++] = p->apply_us - p->release_us;
+        sum += p->apply_us - p->release_us;
+    }
+    if (l.applied > 0) {
+        qsort(v, l.applied, sizeof(*v), cmp_u64);
+        l.p50 = v[(l.applied - 1) * 50 / 100] / 1000.0;
+        l.p90 = v[(l.applied - 1) * 90 / 100] / 1000.0;
+        l.p99 = v[(l.applied - 1) * 99 / 100] / 1000.0;
+        l.max = v[l.applied - 1] / 1000.0;
+        l.mean = sum / l.applied / 1000.0;
+    }
+    free(v);
+    return l;
+}
+
+static totals_t totals(const sim_result_t* r) {
+    totals_t t = {0};
+    for (int i = 0; i < r->count; i++) {
+        const sim_stats_t* s = &r->nodes[i].stats;
+        t.tx_drop_normal += s->counters[CNT_DROP_TX_NORMAL];
+        t.tx_drop_high += s->counters[CNT_DROP_TX_HIGH];
+        t.send_failed += s->counters[CNT_MESH_SEND_FAILED];
+        t.rx_drops += s->rx_drops;
+        if (r->nodes[i].airtime_us > r->nodes[t.busiest].airtime_us) {
+            t.busiest = i;
+        }
+    }
+    return t;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0;
+}
+
+// ====================
+// Text
+// ====================
+
+void sim_report_text(const sim_result_t* r, FILE* out) {
+    const sim_config_t* c = r->cfg;
+    const sim_net_stats_t* net = sim_net_stats();
+    latency_t l = latency(r);
+    totals_t t = totals(r);
+
+    fprintf(out,
+            "domator_sim: %d nodes (1 root, %d switches, %d relays), "
+            "fanout %d, %d layers\n",
+            r->count, r->count - 1 - c->relays, c->relays, c->fanout,
+            r->layers);
+    fprintf(out,
+            "link: latency %" PRIu32 "+%" PRIu32 " us, loss %.1f%%, "
+            "%d retries, %" PRIu32 " kbps, queue %d\n",
+            c->latency_us, c->jitter_us, c->loss * 100, c->retries,
+            c->bandwidth_kbps, c->queue);
+    fprintf(out,
+            "run: %.1f s virtual in %.1f s wall, step %" PRIu64
+            " us, config %zu bytes\n\n",
+            r->virtual_us / 1e6, r->wall_s, r->quantum_us, r->config_bytes);
+
+    fprintf(out, "press-to-apply (release to relay output)\n");
+    fprintf(out, "  applied %d/%d, stray %" PRIu64 "\n", l.applied,
+            r->press_count, r->stray_applies);
+    if (l.applied > 0) {
+        fprintf(out,
+                "  p50 %.1f ms  p90 %.1f ms  p99 %.1f ms  max %.1f ms  "
+                "mean %.1f ms\n",
+                l.p50, l.p90, l.p99, l.max, l.mean);
+    }
+
+    fprintf(out, "\nframes per hop tier\n");
+    fprintf(out, "  tier   dir    frames      bytes  retries   lost  qdrop\n");
+    for (int layer = 1; layer < r->layers; layer++) {
+        for (int dir = 0; dir < 2; dir++) {
+            const sim_tier_t* s = &net->tiers[layer][dir];
+            fprintf(out,
+                    "  %2d-%-2d  %-4s %8" PRIu64 " %10" PRIu64 " %8" PRIu64
+                    " %6" PRIu64 " %6" PRIu64 "\n",
+                    layer, layer + 1, dir ? "down" : "up", s->frames,
+                    s->bytes, s->retries, s->lost, s->queue_drops);
+        }
+    }
+    fprintf(out, "  hops/sent by type:");
+    for (int type = 0; type < 256; type++) {
+        if (net->sent_by_type[type] == 0) continue;
+        fprintf(out, " %c %" PRIu64 "/%" PRIu64, type,
+                net->hops_by_type[type], net->sent_by_type[type]);
+    }
+    fprintf(out, "\n  delivered %" PRIu64 ", no route %" PRIu64, net->delivered,
+            net->no_route);
+    if (net->late) fprintf(out, ", late %" PRIu64, net->late);
+    fprintf(out, "\n\n");
+
+    fprintf(out, "airtime: root %.1f%%, busiest node %d (layer %d) %.1f%%\n",
+            percent(r->nodes[0].airtime_us, r->virtual_us), t.busiest,
+            r->nodes[t.busiest].layer,
+            percent(r->nodes[t.busiest].airtime_us, r->virtual_us));
+    fprintf(out,
+            "firmware: tx queue drops %" PRIu64 " normal / %" PRIu64
+            " high, send failures %" PRIu64 ", rx queue drops %" PRIu64
+            "\n",
+            t.tx_drop_normal, t.tx_drop_high, t.send_failed, t.rx_drops);
+    fprintf(out, "root: %.0f ms host CPU, %" PRIu64 " publishes\n",
+            r->nodes[0].stats.cpu_us / 1000.0, r->publishes);
+
+    const sim_stats_t* root = &r->nodes[0].stats;
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        if (root->prof_count[s] == 0) continue;
+        fprintf(out, "  %-12s n %-8" PRIu32 " mean %.0f cycles\n",
+                root->prof_name[s], root->prof_count[s],
+                (double)root->prof_cycles[s] / root->prof_count[s]);
+    }
+}
+
+// ====================
+// JSON
+// ====================
+
+void sim_report_json(const sim_result_t* r, FILE* out) {
+    const sim_config_t* c = r->cfg;
+    const sim_net_stats_t* net = sim_net_stats();
+    latency_t l = latency(r);
+    totals_t t = totals(r);
+
+    fprintf(out,
+            "{\"nodes\":%d,\"switches\":%d,\"relays\":%d,\"fanout\":%d,"
+            "\"layers\":%d,\n",
+            r->count, r->count - 1 - c->relays, c->relays, c->fanout,
+            r->layers);
+    fprintf(out,
+            " \"link\":{\"latency_us\":%" PRIu32 ",\"jitter_us\":%" PRIu32
+            ",\"loss\":%g,\"retries\":%d,\"bandwidth_kbps\":%" PRIu32
+            ",\"queue\":%d},\n",
+            c->latency_us, c->jitter_us, c->loss, c->retries,
+            c->bandwidth_kbps, c->queue);
+    fprintf(out,
+            " \"run\":{\"virtual_s\":%.3f,\"wall_s\":%.3f,\"step_us\":%" PRIu64
+            ",\"config_bytes\":%zu},\n",
+            r->virtual_us / 1e6, r->wall_s, r->quantum_us, r->config_bytes);
+    fprintf(out,
+            " \"latency_ms\":{\"presses\":%d,\"applied\":%d,\"stray\":%" PRIu64
+            ",\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f,"
+            "\"mean\":%.3f},\n",
+            r->press_count, l.applied, r->stray_applies, l.p50, l.p90, l.p99,
+            l.max, l.mean);
+
+    fprintf(out, " \"tiers\":[");
+    for (int layer = 1; layer < r->layers; layer++) {
+        for (int dir = 0; dir < 2; dir++) {
+            const sim_tier_t* s = &net->tiers[layer][dir];
+            fprintf(out,
+                    "%s\n  {\"upper\":%d,\"dir\":\"%s\",\"frames\":%" PRIu64
+                    ",\"bytes\":%" PRIu64 ",\"retries\":%" PRIu64
+                    ",\"lost\":%" PRIu64 ",\"queue_drops\":%" PRIu64 "}",
+                    layer == 1 && dir == 0 ? "" : ",", layer,
+                    dir ? "down" : "up", s->frames, s->bytes, s->retries,
+                    s->lost, s->queue_drops);
+        }
+    }
+    fprintf(out, "],\n \"types\":{");
+    bool first = true;
+    for (int type = 0; type < 256; type++) {
+        if (net->sent_by_type[type] == 0) continue;
+        fprintf(out, "%s\"%c\":{\"sent\":%" PRIu64 ",\"hops\":%" PRIu64 "}",
+                first ? "" : ",", type, net->sent_by_type[type],
+                net->hops_by_type[type]);
+        first = false;
+    }
+    fprintf(out,
+            "},\n \"network\":{\"delivered\":%" PRIu64 ",\"no_route\":%" PRIu64
+            ",\"late\":%" PRIu64 "},\n",
+            net->delivered, net->no_route, net->late);
+
+    fprintf(out, " \"airtime_pct\":[");
+    for (int i = 0; i < r->count; i++) {
+        fprintf(out, "%s%.2f", i ? "," : "",
+                percent(r->nodes[i].airtime_us, r->virtual_us));
+    }
+    fprintf(out,
+            "],\n \"firmware\":{\"tx_drop_normal\":%" PRIu64
+            ",\"tx_drop_high\":%" PRIu64 ",\"send_failed\":%" PRIu64
+            ",\"rx_drops\":%" PRIu64 "},\n",
+            t.tx_drop_normal, t.tx_drop_high, t.send_failed, t.rx_drops);
+
+    const sim_stats_t* root = &r->nodes[0].stats;
+    fprintf(out,
+            " \"root\":{\"cpu_ms\":%.1f,\"publishes\":%" PRIu64
+            ",\"profile\":{",
+            root->cpu_us / 1000.0, r->publishes);
+    first = true;
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        if (root->prof_count[s] == 0) continue;
+        fprintf(out, "%s\"%s\":{\"n\":%" PRIu32 ",\"cycles\":%" PRIu64 "}",
+                first ? "" : ",", root->prof_name[s], root->prof_count[s],
+                root->prof_cycles[s]);
+        first = false;
+    }
+    fprintf(out, "}}}\n");
+}
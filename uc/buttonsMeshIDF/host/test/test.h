@@ -0,0 +1,139 @@
+#pragma once
+
+/**
+ * @file test.h
+ * @brief Minimal check macros and the helpers shared by the host test suites.
+ *
+ * A suite boots one firmware instance with app_main() and then drives it
+ * from the outside: frames go in through host_mesh_inject(), MQTT messages
+ * through host_mqtt_inject(), and what the firmware sends comes back out of
+ * the HAL's mesh and MQTT outboxes.  A failed CHECK prints its location and
+ * lets the suite carry on.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "host_hal.h"
+
+extern int g_test_failures;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,  \
+                    #cond);                                                   \
+            g_test_failures++;                                                \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                        \
+    do {                                                                      \
+        long long va_ = (long long)(a), vb_ = (long long)(b);                 \
+        if (va_ != vb_) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                    __FILE__, __LINE__, #a, #b, va_, vb_);                    \
+            g_test_failures++;                                                \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_STR(a, b)                                                       \
+    do {                                                                      \
+        const char *sa_ = (a), *sb_ = (b);                                    \
+        if (strcmp(sa_, sb_) != 0) {                                          \
+            fprintf(stderr, "%s:%d: CHECK_STR(%s, %s) failed: \"%s\" != "     \
+                    "\"%s\"\n", __FILE__, __LINE__, #a, #b, sa_, sb_);        \
+            g_test_failures++;                                                \
+        }                                                                     \
+    } while (0)
+
+/** @brief Announce one test case of a suite. */
+#define TEST_CASE(name) fprintf(stderr, "-- %s\n", name)
+
+// ====================
+// Suites
+// ====================
+
+void suite_codec(void);
+void suite_routing(void);
+void suite_relay(void);
+void suite_config(void);
+void suite_txqueue(void);
+void suite_bench(void);
+void suite_bench_switch(void);
+void suite_probe(void);
+void suite_probe_node(void);
+void suite_fault(void);
+void suite_fault_node(void);
+void suite_failover(void);
+void suite_failover_node(void);
+void suite_standby(void);
+void suite_standby_node(void);
+
+// ====================
+// Helpers (test_main.c)
+// ====================
+
+/** Device IDs the suites use for simulated peers. */
+#define TEST_SWITCH_ID ((uint64_t)0x0200000000A1)
+#define TEST_RELAY_ID ((uint64_t)0x0200000000B1)
+#define TEST_RELAY2_ID ((uint64_t)0x0200000000B2)
+#define TEST_ROOT_ID ((uint64_t)0x020000000001)
+
+/**
+ * @brief Boot the firmware as root with MQTT connected, then empty both
+ *        outboxes so a suite starts from a quiet node.
+ */
+void test_boot_root(void);
+
+/** @brief Boot as a non-root node of the given hardware_type (NVS value). */
+void test_boot_node(uint8_t hardware_type);
+
+/** @brief Build a message as a peer with ID @p src would send it. */
+void test_make_msg(mesh_app_msg_t* msg, uint64_t src, uint8_t type,
+                   const char* data, int len);
+
+/** @brief Deliver @p msg as if it arrived from node @p src. */
+void test_inject(uint64_t src, const mesh_app_msg_t* msg);
+
+/** @brief Inject a message and let the firmware handle it. */
+void test_send(uint64_t src, uint8_t type, const char* data, int len);
+
+/** @brief Publish on the MQTT broker and let the firmware handle it. */
+void test_mqtt(const char* topic, const char* payload);
+
+/**
+ * @brief Take the next sent frame of @p type, discarding frames of other
+ *        types in front of it.  @p to may be NULL.
+ */
+bool test_pop_frame(uint8_t type, mesh_app_msg_t* out, mesh_addr_t* to);
+
+/**
+ * @brief Take the next publish whose topic starts with @p prefix, discarding
+ *        others in front of it.
+ */
+bool test_pop_publish(const char* prefix, char* topic, size_t tsize,
+                      char* data, size_t dsize);
+
+/**
+ * @brief Take the next publish on exactly @p topic, discarding others in
+ *        front of it, and parse it.
+ * @return The JSON (free with cJSON_Delete()), or NULL if none was sent.
+ */
+cJSON* test_pop_json(const char* topic);
+
+/**
+ * @brief Number at @p path in @p json; "a.b" looks up b inside object a.
+ * @return The value, or -1 if it is missing or not a number.
+ */
+double test_json_number(const cJSON* json, const char* path);
+
+/** @brief Drop everything in the mesh and MQTT outboxes. */
+void test_drain(void);
+
+/** @brief Node ID the frame was addressed to (0 for the root). */
+uint64_t test_addr_to_id(const mesh_addr_t* addr);
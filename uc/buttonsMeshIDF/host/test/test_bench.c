@@ -0,0 +1,350 @@
+/**
+ * @file test_bench.c
+ * @brief Benchmark mode: the root's run control, tagged routing and report
+ *        ("bench"), and the switch's load generator ("bench_switch").
+ */
+
+#include "cJSON.h"
+#include "test.h"
+
+/** @brief Send a tagged MSG_TYPE_BUTTON as a switch's generator would. */
+static void send_tagged(uint64_t src, const char* data, uint32_t run_id,
+                        uint32_t seq) {
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, src, MSG_TYPE_BUTTON, data, -1);
+    bench_tag_t tag = {
+        .magic = BENCH_TAG_MAGIC,
+        .run_id = run_id,
+        .seq = seq,
+        .gen_us = mesh_time_now_us() - 5000,
+    };
+    bench_tag_put(&msg, &tag);
+    test_inject(src, &msg);
+    host_run_for_ms(50);
+}
+
+static void send_op(uint64_t src, char op, const void* body, size_t len) {
+    char data[64];
+    data[0] = op;
+    if (len) memcpy(&data[1], body, len);
+    test_send(src, MSG_TYPE_BENCH, data, 1 + len);
+}
+
+// ====================
+// Root
+// ====================
+
+static void configure(void) {
+    char json[512];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"button_types\",\"data\":{\"%" PRIu64 "\":"
+             "{\"a\":0}}}",
+             TEST_SWITCH_ID);
+    test_mqtt("/switch/cmd/root", json);
+
+    snprintf(json, sizeof(json),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64 "\":{"
+             "\"a\":[[%" PRIu64 ",\"c\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY_ID);
+    test_mqtt("/switch/cmd/root", json);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_TYPE_INFO, "S", 1);
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+}
+
+static uint32_t start_run(const char* json, bench_params_t* params) {
+    test_mqtt("/switch/cmd/root", json);
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_BENCH, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_SWITCH_ID);
+    CHECK_EQ(msg.target_type, DEVICE_TYPE_SWITCH);
+    CHECK_EQ(msg.data[0], BENCH_OP_START);
+    CHECK_EQ(msg.data_len, 1 + sizeof(bench_params_t));
+    memcpy(params, &msg.data[1], sizeof(*params));
+    CHECK(!test_pop_frame(MSG_TYPE_BENCH, NULL, NULL));
+    return params->run_id;
+}
+
+/** @brief Wait for the run's report and parse it. */
+static cJSON* pop_report(void) {
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/bench/%" PRIu64, g_device_id);
+    host_run_for_ms(BENCH_SETTLE_MS + 500);
+    return test_pop_json(topic);
+}
+
+static void test_start(void) {
+    TEST_CASE("start sends the parameters to registered switches only");
+    bench_params_t p;
+    start_run("{\"type\":\"bench\",\"rate\":4,\"duration\":2,"
+              "\"pattern\":\"burst\",\"burst\":3,\"buttons\":2}",
+              &p);
+    CHECK_EQ(p.interval_us, 250000);
+    CHECK_EQ(p.duration_ms, 2000);
+    CHECK_EQ(p.pattern, BENCH_PATTERN_BURST);
+    CHECK_EQ(p.burst, 3);
+    CHECK_EQ(p.buttons, 2);
+    CHECK_EQ(p.flags, BENCH_FLAG_DRY_RUN);
+
+    TEST_CASE("a second start waits for the running one");
+    test_mqtt("/switch/cmd/root", "{\"type\":\"bench\"}");
+    CHECK(!test_pop_frame(MSG_TYPE_BENCH, NULL, NULL));
+
+    TEST_CASE("stop is forwarded; the report follows the last total");
+    test_mqtt("/switch/cmd/root", "{\"type\":\"bench\",\"stop\":true}");
+    mesh_app_msg_t msg;
+    CHECK(test_pop_frame(MSG_TYPE_BENCH, &msg, NULL));
+    CHECK_EQ(msg.data[0], BENCH_OP_STOP);
+
+    bench_done_t done = {.run_id = p.run_id};
+    send_op(TEST_SWITCH_ID, BENCH_OP_DONE, &done, sizeof(done));
+    cJSON* report = pop_report();
+    CHECK(report != NULL);
+    CHECK_EQ(test_json_number(report, "reported"), 1);
+    CHECK_EQ(test_json_number(report, "frames.generated"), 0);
+    cJSON_Delete(report);
+
+    char json[128];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"bench\",\"switches\":[\"%" PRIu64 "\"]}",
+             TEST_RELAY_ID);
+    test_mqtt("/switch/cmd/root", json);
+    CHECK(!test_pop_frame(MSG_TYPE_BENCH, NULL, NULL));
+}
+
+static void test_dry_run(void) {
+    TEST_CASE("tagged presses route with the tag and the dry-run flag");
+    bench_params_t p;
+    uint32_t run = start_run("{\"type\":\"bench\",\"duration\":1}", &p);
+
+    send_tagged(TEST_SWITCH_ID, "a1", run, 0);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    send_tagged(TEST_SWITCH_ID, "a00", run, 1);
+
+    mesh_app_msg_t cmd;
+    mesh_addr_t to;
+    bench_tag_t tag;
+    CHECK(test_pop_frame(MSG_TYPE_COMMAND, &cmd, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(cmd.data[0], 'c');
+    CHECK(bench_tag_get(&cmd, &tag));
+    CHECK_EQ(tag.run_id, run);
+    CHECK_EQ(tag.seq, 1);
+    CHECK_EQ(tag.flags, BENCH_FLAG_DRY_RUN);
+
+    TEST_CASE("synthetic presses are not mirrored to MQTT");
+    CHECK(!test_pop_publish("/switch/state/", NULL, 0, NULL, 0));
+
+    TEST_CASE("presses of another run are dropped");
+    send_tagged(TEST_SWITCH_ID, "a00", run + 2, 3);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+
+    bench_applied_t applied = {
+        .tag = tag,
+        .applied_us = tag.gen_us + 12000,
+    };
+    send_op(TEST_RELAY_ID, BENCH_OP_APPLIED, &applied, sizeof(applied));
+    bench_done_t done = {.run_id = run, .frames = 4, .queue_full = 1};
+    send_op(TEST_SWITCH_ID, BENCH_OP_DONE, &done, sizeof(done));
+
+    TEST_CASE("the report counts frames, commands and latencies");
+    cJSON* report = pop_report();
+    CHECK(report != NULL);
+    CHECK(cJSON_IsTrue(cJSON_GetObjectItem(report, "dryRun")));
+    CHECK_EQ(test_json_number(report, "switches"), 1);
+    CHECK_EQ(test_json_number(report, "reported"), 1);
+    CHECK_EQ(test_json_number(report, "frames.generated"), 4);
+    CHECK_EQ(test_json_number(report, "frames.delivered"), 2);
+    CHECK_EQ(test_json_number(report, "frames.lost"), 2);
+    CHECK_EQ(test_json_number(report, "frames.queueFull"), 1);
+    CHECK_EQ(test_json_number(report, "commands.routed"), 1);
+    CHECK_EQ(test_json_number(report, "commands.applied"), 1);
+    CHECK_EQ(test_json_number(report, "commands.lost"), 0);
+    CHECK_EQ(test_json_number(report, "uplinkUs.n"), 2);
+    CHECK(test_json_number(report, "uplinkUs.min") >= 5000);
+    CHECK_EQ(test_json_number(report, "applyUs.n"), 1);
+    CHECK_EQ(test_json_number(report, "applyUs.max"), 12000);
+    CHECK(test_json_number(report, "applyUs.p99") == 12000);
+    cJSON_Delete(report);
+
+    TEST_CASE("presses after the report are dropped");
+    send_tagged(TEST_SWITCH_ID, "a00", run, 5);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+}
+
+static void test_live(void) {
+    TEST_CASE("dryRun:false clears the flag on routed commands");
+    bench_params_t p;
+    uint32_t run =
+        start_run("{\"type\":\"bench\",\"duration\":1,\"dryRun\":false}", &p);
+    CHECK_EQ(p.flags, 0);
+
+    send_tagged(TEST_SWITCH_ID, "a00", run, 1);
+    mesh_app_msg_t cmd;
+    bench_tag_t tag;
+    CHECK(test_pop_frame(MSG_TYPE_COMMAND, &cmd, NULL));
+    CHECK(bench_tag_get(&cmd, &tag));
+    CHECK_EQ(tag.flags, 0);
+
+    TEST_CASE("a missing total ends the run after the timeout");
+    host_run_for_ms(1000 + BENCH_DONE_TIMEOUT_MS);
+    cJSON* report = pop_report();
+    CHECK(report != NULL);
+    CHECK_EQ(test_json_number(report, "reported"), 0);
+    CHECK_EQ(test_json_number(report, "commands.lost"), 1);
+    cJSON_Delete(report);
+}
+
+void suite_bench(void) {
+    test_boot_root();
+    configure();
+    test_start();
+    test_dry_run();
+    test_live();
+}
+
+// ====================
+// Switch
+// ====================
+
+/** @brief Start a run on the switch as the root would. */
+static void start_generator(const bench_params_t* p) {
+    send_op(TEST_ROOT_ID, BENCH_OP_START, p, sizeof(*p));
+}
+
+/** @brief Count the tagged frames from @p seq on, until BENCH_OP_DONE. */
+static int collect(uint32_t run_id, uint32_t seq, bench_done_t* done,
+                   char* buttons, int max) {
+    mesh_addr_t to;
+    mesh_app_msg_t msg;
+    size_t len = sizeof(msg);
+    int frames = 0;
+    while (host_mesh_pop_sent(&to, &msg, &len)) {
+        len = sizeof(msg);
+        bench_tag_t tag;
+        if (msg.msg_type == MSG_TYPE_BUTTON) {
+            CHECK_EQ(test_addr_to_id(&to), 0);
+            CHECK(bench_tag_get(&msg, &tag));
+            CHECK_EQ(tag.run_id, run_id);
+            CHECK_EQ(tag.seq, seq + frames);
+            CHECK_EQ(msg.data[1], frames % 2 ? '0' : '1');
+            if (frames < max) buttons[frames] = msg.data[0];
+            frames++;
+        } else if (msg.msg_type == MSG_TYPE_BENCH &&
+                   msg.data[0] == BENCH_OP_DONE) {
+            memcpy(done, &msg.data[1], sizeof(*done));
+            return frames;
+        }
+    }
+    CHECK(!"no BENCH_OP_DONE");
+    return frames;
+}
+
+static void test_uniform(void) {
+    TEST_CASE("uniform: press and release per gap, buttons in turn");
+    bench_params_t p = {
+        .run_id = 7,
+        .interval_us = 100000,
+        .duration_ms = 1000,
+        .pattern = BENCH_PATTERN_UNIFORM,
+        .burst = 1,
+        .buttons = 2,
+    };
+    start_generator(&p);
+    host_run_for_ms(1500);
+
+    bench_done_t done = {0};
+    char buttons[20];
+    CHECK_EQ(collect(7, 0, &done, buttons, 20), 20);
+    CHECK_EQ(done.run_id, 7);
+    CHECK_EQ(done.frames, 20);
+    CHECK_EQ(done.queue_full, 0);
+    CHECK(memcmp(buttons, "aabbaabbaa", 10) == 0);
+}
+
+static void test_burst(void) {
+    TEST_CASE("burst: presses back to back, then a gap");
+    bench_params_t p = {
+        .run_id = 8,
+        .interval_us = 100000,
+        .duration_ms = 1000,
+        .pattern = BENCH_PATTERN_BURST,
+        .burst = 5,
+        .buttons = 1,
+    };
+    start_generator(&p);
+    host_run_for_ms(250);
+    bench_done_t done = {0};
+    int in_burst = 0;
+    size_t len = sizeof(mesh_app_msg_t);
+    while (host_mesh_pop_sent(NULL, NULL, &len)) {
+        len = sizeof(mesh_app_msg_t);
+        in_burst++;
+    }
+    CHECK_EQ(in_burst, 10);
+
+    host_run_for_ms(1000);
+    char buttons[20];
+    CHECK_EQ(collect(8, 10, &done, buttons, 20), 10);
+    CHECK_EQ(done.frames, 20);
+}
+
+static void test_poisson_and_stop(void) {
+    TEST_CASE("poisson: the mean rate holds; stop ends the run early");
+    bench_params_t p = {
+        .run_id = 9,
+        .interval_us = 50000,
+        .duration_ms = 60000,
+        .pattern = BENCH_PATTERN_POISSON,
+        .burst = 1,
+        .buttons = 1,
+    };
+    start_generator(&p);
+    host_run_for_ms(10000);
+    send_op(TEST_ROOT_ID, BENCH_OP_STOP, NULL, 0);
+    host_run_for_ms(100);
+
+    bench_done_t done = {0};
+    char buttons[1];
+    int frames = collect(9, 0, &done, buttons, 0);
+    CHECK_EQ(done.frames, frames);
+    // 200 presses expected in 10 s; 4 sigma is about 57.
+    CHECK(frames / 2 > 140 && frames / 2 < 260);
+}
+
+static void test_restart(void) {
+    TEST_CASE("a start during a run stops it and then starts the new run");
+    bench_params_t p = {
+        .run_id = 10,
+        .interval_us = 100000,
+        .duration_ms = 60000,
+        .pattern = BENCH_PATTERN_UNIFORM,
+        .burst = 1,
+        .buttons = 1,
+    };
+    start_generator(&p);
+    host_run_for_ms(550);
+    p.run_id = 11;
+    p.duration_ms = 300;
+    start_generator(&p);
+    host_run_for_ms(1000);
+
+    bench_done_t done = {0};
+    char buttons[1];
+    int frames = collect(10, 0, &done, buttons, 0);
+    CHECK_EQ(done.run_id, 10);
+    CHECK_EQ(done.frames, frames);
+    CHECK_EQ(collect(11, 0, &done, buttons, 0), 6);
+    CHECK_EQ(done.run_id, 11);
+}
+
+void suite_bench_switch(void) {
+    test_boot_node(0);
+    CHECK_EQ(g_node_type, NODE_TYPE_SWITCH_C3);
+    test_uniform();
+    test_burst();
+    test_poisson_and_stop();
+    test_restart();
+}
@@ -0,0 +1,136 @@
+/**
+ * @file test_codec.c
+ * @brief Wire format of mesh_app_msg_t and the RX path that decodes it:
+ *        field layout, short-frame rejection, device-type filtering, and the
+ *        header the root puts on what it sends back.
+ */
+
+#include <stddef.h>
+
+#include "test.h"
+
+static void test_layout(void) {
+    TEST_CASE("layout");
+    CHECK_EQ(sizeof(mesh_app_msg_t), 24 + MESH_MSG_DATA_SIZE);
+    CHECK_EQ(offsetof(mesh_app_msg_t, src_id), 0);
+    CHECK_EQ(offsetof(mesh_app_msg_t, msg_type), 8);
+    CHECK_EQ(offsetof(mesh_app_msg_t, data_len), 9);
+    CHECK_EQ(offsetof(mesh_app_msg_t, data_seq), 11);
+    CHECK_EQ(offsetof(mesh_app_msg_t, target_type), 15);
+    CHECK_EQ(offsetof(mesh_app_msg_t, data), 16);
+    CHECK_EQ(offsetof(mesh_app_msg_t, mesh_time_us), 16 + MESH_MSG_DATA_SIZE);
+    CHECK_EQ(MESH_MSG_LEGACY_SIZE, 16 + MESH_MSG_DATA_SIZE);
+}
+
+static void test_type_info_and_sync(void) {
+    TEST_CASE("type info registers the node and asks relays to sync");
+    test_send(TEST_SWITCH_ID, MSG_TYPE_TYPE_INFO, "S", 1);
+    CHECK(!test_pop_frame(MSG_TYPE_SYNC_REQUEST, NULL, NULL));
+
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_SYNC_REQUEST, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(msg.src_id, g_device_id);
+    CHECK_EQ(msg.data_len, 0);
+
+    uint64_t ids[MAX_NODES];
+    mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+    CHECK_EQ(count, 2);
+}
+
+static void test_ping_reply(void) {
+    TEST_CASE("ping is answered with the counter incremented");
+    uint16_t seq = 0;
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, TEST_SWITCH_ID, MSG_TYPE_PING, (const char*)&seq,
+                  sizeof(seq));
+    uint64_t sent_at = host_now_us();
+    test_inject(TEST_SWITCH_ID, &msg);
+    host_run_for_ms(50);
+
+    mesh_app_msg_t pong;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_PING, &pong, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_SWITCH_ID);
+    CHECK_EQ(pong.src_id, g_device_id);
+    CHECK_EQ(pong.data_len, sizeof(uint16_t));
+    uint16_t reply;
+    memcpy(&reply, pong.data, sizeof(reply));
+    CHECK_EQ(reply, 1);
+    // The root is the mesh clock: stamps are its own virtual time.
+    CHECK(pong.mesh_time_us >= (int64_t)sent_at);
+}
+
+static void test_short_frame_dropped(void) {
+    TEST_CASE("frames shorter than a legacy frame are dropped");
+    uint32_t before = g_rx_counts[MSG_TYPE_PING - 'A'];
+    mesh_app_msg_t msg;
+    uint16_t seq = 1;
+    test_make_msg(&msg, TEST_SWITCH_ID, MSG_TYPE_PING, (const char*)&seq,
+                  sizeof(seq));
+    mesh_addr_t from;
+    host_id_to_addr(TEST_SWITCH_ID, &from);
+    CHECK_EQ(host_mesh_inject(&from, &msg, MESH_MSG_LEGACY_SIZE - 1), ESP_OK);
+    host_run_for_ms(50);
+    CHECK_EQ(g_rx_counts[MSG_TYPE_PING - 'A'], before);
+    CHECK(!test_pop_frame(MSG_TYPE_PING, NULL, NULL));
+}
+
+static void test_legacy_frame_dispatched(void) {
+    TEST_CASE("frames without the mesh time trailer are still dispatched");
+    uint32_t before = g_rx_counts[MSG_TYPE_PING - 'A'];
+    mesh_app_msg_t msg;
+    uint16_t seq = 0;
+    test_make_msg(&msg, TEST_SWITCH_ID, MSG_TYPE_PING, (const char*)&seq,
+                  sizeof(seq));
+    mesh_addr_t from;
+    host_id_to_addr(TEST_SWITCH_ID, &from);
+    CHECK_EQ(host_mesh_inject(&from, &msg, MESH_MSG_LEGACY_SIZE), ESP_OK);
+    host_run_for_ms(50);
+    CHECK_EQ(g_rx_counts[MSG_TYPE_PING - 'A'], before + 1);
+
+    mesh_app_msg_t pong;
+    CHECK(test_pop_frame(MSG_TYPE_PING, &pong, NULL));
+    uint16_t reply;
+    memcpy(&reply, pong.data, sizeof(reply));
+    CHECK_EQ(reply, 1);
+}
+
+static void test_target_type_filter(void) {
+    TEST_CASE("messages for another device type are discarded");
+    uint16_t seq = 1;
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, TEST_SWITCH_ID, MSG_TYPE_PING, (const char*)&seq,
+                  sizeof(seq));
+    msg.target_type = DEVICE_TYPE_RELAY;
+    test_inject(TEST_SWITCH_ID, &msg);
+    host_run_for_ms(50);
+    CHECK(!test_pop_frame(MSG_TYPE_PING, NULL, NULL));
+
+    msg.target_type = DEVICE_TYPE_SWITCH;
+    test_inject(TEST_SWITCH_ID, &msg);
+    host_run_for_ms(50);
+    CHECK(test_pop_frame(MSG_TYPE_PING, NULL, NULL));
+}
+
+static void test_tx_counters(void) {
+    TEST_CASE("sent frames are counted by type");
+    uint32_t before = g_tx_counts[MSG_TYPE_SYNC_REQUEST - 'A'];
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    CHECK(test_pop_frame(MSG_TYPE_SYNC_REQUEST, NULL, NULL));
+    CHECK_EQ(g_tx_counts[MSG_TYPE_SYNC_REQUEST - 'A'], before + 1);
+}
+
+void suite_codec(void) {
+    test_boot_root();
+    test_layout();
+    test_type_info_and_sync();
+    test_ping_reply();
+    test_short_frame_dropped();
+    test_legacy_frame_dispatched();
+    test_target_type_filter();
+    test_tx_counters();
+}
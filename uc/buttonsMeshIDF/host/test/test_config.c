@@ -0,0 +1,136 @@
+/**
+ * @file test_config.c
+ * @brief Root config parsers fed over MQTT: auto-off timers, schedules,
+ *        blind pairs, route replacement, and rejection of bad payloads.
+ */
+
+#include "test.h"
+
+static void root_cmd(const char* json) { test_mqtt("/switch/cmd/root", json); }
+
+static void expect_command(uint8_t type, const char* data, int len) {
+    mesh_app_msg_t cmd;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(type, &cmd, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(cmd.data_len, len);
+    CHECK(memcmp(cmd.data, data, len) == 0);
+}
+
+static void test_auto_off(void) {
+    TEST_CASE("auto_off becomes T commands for registered relays");
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"auto_off\",\"data\":{\"%" PRIu64
+             "\":{\"a\":120,\"B\":5,\"c\":-3},\"%" PRIu64 "\":{\"a\":1}}}",
+             TEST_RELAY_ID, TEST_RELAY_ID + 1);
+    uint32_t before = counter_get(CNT_CFG_AUTO_OFF);
+    root_cmd(json);
+    expect_command(MSG_TYPE_COMMAND, "Ta120", 5);
+    expect_command(MSG_TYPE_COMMAND, "Tb5", 3);
+    expect_command(MSG_TYPE_COMMAND, "Tc0", 3);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    CHECK_EQ(counter_get(CNT_CFG_AUTO_OFF), before + 1);
+}
+
+static void test_schedules(void) {
+    TEST_CASE("schedules become one table per relay");
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"schedules\",\"data\":{\"%" PRIu64 "\":["
+             "[127,\"07:30\",\"ab\",\"on\"],"
+             "[65,\"22:00:15\",\"C\",\"toggle\"],"
+             "[1,\"25:00\",\"a\",\"on\"],"
+             "[1,\"08:00\",\"a\",\"blink\"]]}}",
+             TEST_RELAY_ID);
+    root_cmd(json);
+
+    mesh_app_msg_t msg;
+    CHECK(test_pop_frame(MSG_TYPE_SCHEDULE, &msg, NULL));
+    CHECK_EQ(msg.data[0], 2);
+    CHECK_EQ(msg.data_len, 1 + 2 * sizeof(schedule_entry_t));
+    schedule_entry_t e[2];
+    memcpy(e, &msg.data[1], sizeof(e));
+    CHECK_EQ(e[0].day_mask, 127);
+    CHECK_EQ(e[0].action, SCHEDULE_ACTION_ON);
+    CHECK_EQ(e[0].output_mask, 0x3);
+    CHECK_EQ(e[0].second_of_day, 7 * 3600 + 30 * 60);
+    CHECK_EQ(e[1].day_mask, 65);
+    CHECK_EQ(e[1].action, SCHEDULE_ACTION_TOGGLE);
+    CHECK_EQ(e[1].output_mask, 0x4);
+    CHECK_EQ(e[1].second_of_day, 22 * 3600 + 15);
+}
+
+static void test_blind_pairs(void) {
+    TEST_CASE("blind pair: short release toggles power, long direction");
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"blind_pairs\",\"data\":{\"%" PRIu64
+             "\":[[\"e\",\"f\"]]}}",
+             TEST_RELAY_ID);
+    root_cmd(json);
+    snprintf(json, sizeof(json),
+             "{\"type\":\"button_types\",\"data\":{\"%" PRIu64
+             "\":{\"c\":0}}}",
+             TEST_SWITCH_ID);
+    root_cmd(json);
+    snprintf(json, sizeof(json),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64
+             "\":{\"c\":[[%" PRIu64 ",\"e\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY_ID);
+    root_cmd(json);
+    test_drain();
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "c1", 2);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "c00", 3);
+    expect_command(MSG_TYPE_COMMAND, "e", 1);
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "c01", 3);
+    expect_command(MSG_TYPE_COMMAND, "f", 1);
+}
+
+static void test_routes_replaced(void) {
+    TEST_CASE("a new connections table replaces the old one");
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64
+             "\":{\"d\":[[%" PRIu64 ",\"g\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY_ID);
+    uint32_t before = counter_get(CNT_CFG_ROUTES);
+    root_cmd(json);
+    CHECK_EQ(counter_get(CNT_CFG_ROUTES), before + 1);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "c00", 3);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "d0", 2);
+    expect_command(MSG_TYPE_COMMAND, "g", 1);
+}
+
+static void test_bad_payloads(void) {
+    TEST_CASE("malformed JSON and unknown types are ignored");
+    uint32_t routes = counter_get(CNT_CFG_ROUTES);
+    root_cmd("{\"type\":\"connections\"");
+    root_cmd("{\"data\":{}}");
+    root_cmd("{\"type\":42}");
+    root_cmd("{\"type\":\"connections\"}");
+    root_cmd("{\"type\":\"no_such_type\",\"data\":{}}");
+    root_cmd("{\"type\":\"auto_off\",\"data\":[1,2]}");
+    CHECK_EQ(counter_get(CNT_CFG_ROUTES), routes);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+
+    // The previous table is still in force.
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "d0", 2);
+    expect_command(MSG_TYPE_COMMAND, "g", 1);
+}
+
+void suite_config(void) {
+    test_boot_root();
+    test_send(TEST_SWITCH_ID, MSG_TYPE_TYPE_INFO, "S", 1);
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+    test_auto_off();
+    test_schedules();
+    test_blind_pairs();
+    test_routes_replaced();
+    test_bad_payloads();
+}
@@ -0,0 +1,181 @@
+/**
+ * @file test_failover.c
+ * @brief Root failover timeline: a node promoted to root collects the
+ *        timelines and publishes the report ("failover"); a node records its
+ *        episode and sends it to the root once back ("failover_node").
+ */
+
+#include "cJSON.h"
+#include "test.h"
+
+/** @brief A node's timeline: lost @p lost_ago ms, back @p back_ago ms ago. */
+static void send_timeline(uint64_t src, uint32_t lost_ago, uint32_t back_ago) {
+    failover_report_t report = {
+        .event_count = FAILOVER_EV_COUNT,
+        .now_ms = 100000,
+    };
+    report.at[FAILOVER_EV_PARENT_LOST].at_ms = report.now_ms - lost_ago;
+    report.at[FAILOVER_EV_PARENT].at_ms = report.now_ms - back_ago;
+    test_send(src, MSG_TYPE_FAILOVER, (const char*)&report, sizeof(report));
+}
+
+static bool mqtt_up(void* ctx) {
+    (void)ctx;
+    return g_mqtt_connected;
+}
+
+// ====================
+// Root
+// ====================
+
+static void test_promoted(void) {
+    TEST_CASE("a node elected root records the root-side events");
+    host_node_t node = {
+        .mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0xB1},
+        .is_root = true,
+        .layer = 1,
+        .rssi = -50,
+        .total_nodes = 3,
+    };
+    host_node_config(&node);
+    CHECK_EQ(esp_mesh_disconnect(), ESP_OK);
+    CHECK(host_run_until(mqtt_up, NULL, 10, 5000));
+    CHECK(g_is_root);
+
+    static const failover_event_t order[] = {
+        FAILOVER_EV_PARENT_LOST, FAILOVER_EV_PARENT, FAILOVER_EV_ROOT,
+        FAILOVER_EV_GOT_IP,      FAILOVER_EV_MQTT_INIT, FAILOVER_EV_MQTT,
+    };
+    uint32_t prev_ms = 0;
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        failover_stamp_t stamp = failover_stamp(order[i]);
+        CHECK(stamp.at_ms != 0);
+        CHECK(stamp.at_ms >= prev_ms);
+        prev_ms = stamp.at_ms;
+    }
+    CHECK(failover_stamp(FAILOVER_EV_ROOT).mesh_us != 0);
+    CHECK_EQ(failover_stamp(FAILOVER_EV_CONFIG).at_ms, 0);
+    test_drain();
+}
+
+static void test_report(void) {
+    TEST_CASE("the report waits for the first routed command");
+    // The switch lost its parent 5 s ago, before the new root did.
+    send_timeline(TEST_SWITCH_ID, 5000, 200);
+    test_send(TEST_RELAY2_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS + 5000);
+    CHECK(test_pop_json("/switch/failover") == NULL);
+
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64 "\":{"
+             "\"a\":[[%" PRIu64 ",\"c\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY2_ID);
+    test_mqtt("/switch/cmd/root", json);
+    CHECK(failover_stamp(FAILOVER_EV_CONFIG).at_ms != 0);
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "a0", 2);
+    CHECK(test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    CHECK(failover_stamp(FAILOVER_EV_FIRST_ROUTE).at_ms != 0);
+
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    cJSON* report = test_pop_json("/switch/failover");
+    CHECK(report != NULL);
+    CHECK_EQ(test_json_number(report, "root"), TEST_RELAY_ID);
+    CHECK_EQ(test_json_number(report, "detectedBy"), TEST_SWITCH_ID);
+    CHECK_EQ(test_json_number(report, "healingMs"), MESH_ROOT_HEALING_DELAY_MS);
+
+    const cJSON* phases = cJSON_GetObjectItem(report, "phases");
+    double lost = test_json_number(phases, "parentLost");
+    double election = test_json_number(phases, "election");
+    CHECK(lost > 0 && lost < 5000);
+    CHECK(election >= lost);
+    CHECK(test_json_number(phases, "ip") >= election);
+    CHECK(test_json_number(phases, "mqtt") >=
+          test_json_number(phases, "mqttInit"));
+    CHECK(test_json_number(phases, "config") >=
+          test_json_number(phases, "mqtt"));
+    CHECK(test_json_number(phases, "firstRoute") >=
+          test_json_number(phases, "config"));
+
+    const cJSON* nodes = cJSON_GetObjectItem(report, "nodes");
+    CHECK_EQ(cJSON_GetArraySize(nodes), 1);
+    const cJSON* node = cJSON_GetArrayItem(nodes, 0);
+    CHECK_EQ(test_json_number(node, "id"), TEST_SWITCH_ID);
+    CHECK_EQ(test_json_number(node, "lost"), 0);
+    CHECK_EQ(test_json_number(node, "rejoined"), 4800);
+    CHECK_EQ(test_json_number(report, "rejoined"), 1);
+    CHECK_EQ(test_json_number(report, "lastRejoin"), 4800);
+    cJSON_Delete(report);
+}
+
+static void test_late_timeline(void) {
+    TEST_CASE("a late timeline updates the report, a stale one is ignored");
+    send_timeline(TEST_RELAY2_ID, FAILOVER_WINDOW_MS + 60000, 100);
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    CHECK(test_pop_json("/switch/failover") == NULL);
+
+    send_timeline(TEST_RELAY2_ID, 30000, 100);
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    cJSON* report = test_pop_json("/switch/failover");
+    CHECK(report != NULL);
+    CHECK_EQ(cJSON_GetArraySize(cJSON_GetObjectItem(report, "nodes")), 2);
+    CHECK_EQ(test_json_number(report, "rejoined"), 2);
+    cJSON_Delete(report);
+
+    TEST_CASE("nothing more is published without new timelines");
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    CHECK(test_pop_json("/switch/failover") == NULL);
+}
+
+void suite_failover(void) {
+    test_boot_node(1);
+    CHECK_EQ(failover_stamp(FAILOVER_EV_PARENT).at_ms, 0);
+    test_promoted();
+    test_report();
+    test_late_timeline();
+}
+
+// ====================
+// Node
+// ====================
+
+static void test_episode(void) {
+    TEST_CASE("a lost parent opens an episode and the rejoin closes it");
+    CHECK_EQ(esp_mesh_disconnect(), ESP_OK);
+    failover_stamp_t lost = failover_stamp(FAILOVER_EV_PARENT_LOST);
+    CHECK(lost.at_ms != 0);
+    CHECK_EQ(lost.mesh_us, 0);  // never synced
+    host_run_for_ms(1000);
+    CHECK(g_mesh_connected);
+    failover_stamp_t back = failover_stamp(FAILOVER_EV_PARENT);
+    CHECK(back.at_ms > lost.at_ms);
+    CHECK_EQ(failover_stamp(FAILOVER_EV_ROOT).at_ms, 0);
+
+    TEST_CASE("the timeline goes to the root once");
+    test_drain();
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_FAILOVER, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    CHECK_EQ(msg.data_len, sizeof(failover_report_t));
+    failover_report_t report;
+    memcpy(&report, msg.data, sizeof(report));
+    CHECK_EQ(report.event_count, FAILOVER_EV_COUNT);
+    CHECK_EQ(report.at[FAILOVER_EV_PARENT_LOST].at_ms, lost.at_ms);
+    CHECK_EQ(report.at[FAILOVER_EV_PARENT].at_ms, back.at_ms);
+    CHECK(report.now_ms >= back.at_ms);
+
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    CHECK(!test_pop_frame(MSG_TYPE_FAILOVER, NULL, NULL));
+
+    TEST_CASE("the next loss starts a fresh episode");
+    CHECK_EQ(esp_mesh_disconnect(), ESP_OK);
+    CHECK(failover_stamp(FAILOVER_EV_PARENT_LOST).at_ms > back.at_ms);
+    CHECK_EQ(failover_stamp(FAILOVER_EV_PARENT).at_ms, 0);
+}
+
+void suite_failover_node(void) {
+    test_boot_node(1);
+    test_episode();
+}
@@ -0,0 +1,311 @@
+/**
+ * @file test_fault.c
+ * @brief Fault injection: rules, reports and remote control on the root
+ *        ("fault"); control frames, held RX frames, disconnect and freeze
+ *        on a node ("fault_node").
+ */
+
+#include "cJSON.h"
+#include "test.h"
+
+static cJSON* pop_report(uint64_t device_id) {
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/fault/%" PRIu64, device_id);
+    return test_pop_json(topic);
+}
+
+/** @brief Number of sent frames of @p type, taking every sent frame. */
+static int count_frames(uint8_t type) {
+    int n = 0;
+    while (test_pop_frame(type, NULL, NULL)) n++;
+    return n;
+}
+
+// ====================
+// Root
+// ====================
+
+static void test_rules_reported(void) {
+    TEST_CASE("rules are validated, kept and published");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"fault\",\"rules\":["
+              "{\"msg\":\"C\",\"dir\":\"tx\",\"drop\":100},"
+              "{\"msg\":\"C\",\"drop\":80,\"dup\":30}]}");
+    cJSON* report = pop_report(TEST_ROOT_ID);
+    CHECK(report != NULL);
+    const cJSON* rules = cJSON_GetObjectItem(report, "rules");
+    CHECK_EQ(cJSON_GetArraySize(rules), 1);
+    const cJSON* rule = cJSON_GetArrayItem(rules, 0);
+    CHECK_STR(cJSON_GetObjectItem(rule, "msg")->valuestring, "C");
+    CHECK_STR(cJSON_GetObjectItem(rule, "dir")->valuestring, "tx");
+    CHECK_EQ(cJSON_GetObjectItem(rule, "drop")->valuedouble, 100);
+    CHECK_EQ(test_json_number(report, "tx.drop"), 0);
+    cJSON_Delete(report);
+}
+
+static void test_tx_drop(void) {
+    TEST_CASE("tx drop: the send succeeds but nothing leaves");
+    CHECK(root_send_relay_command(TEST_RELAY_ID, "a1"));
+    CHECK(root_ping_node(TEST_RELAY_ID));
+    host_run_for_ms(50);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 0);
+
+    test_mqtt("/switch/cmd/root", "{\"type\":\"fault\"}");
+    cJSON* report = pop_report(TEST_ROOT_ID);
+    CHECK_EQ(test_json_number(report, "tx.drop"), 1);
+    cJSON_Delete(report);
+}
+
+static void test_tx_delay_dup(void) {
+    TEST_CASE("tx delay holds the frame, tx duplicate sends it twice");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"fault\",\"clear\":true,\"rules\":["
+              "{\"msg\":\"C\",\"dir\":\"tx\",\"delay\":100,"
+              "\"delayMs\":200}]}");
+    test_drain();
+    CHECK(root_send_relay_command(TEST_RELAY_ID, "a1"));
+    host_run_for_ms(100);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 0);
+    host_run_for_ms(150);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 1);
+
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"fault\",\"clear\":true,\"rules\":["
+              "{\"msg\":\"*\",\"dir\":\"tx\",\"dup\":100}]}");
+    CHECK(root_send_relay_command(TEST_RELAY_ID, "a1"));
+    host_run_for_ms(50);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 2);
+}
+
+static void test_tx_reorder(void) {
+    TEST_CASE("tx reorder: the held frame goes after the next one");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"fault\",\"clear\":true,\"rules\":["
+              "{\"msg\":\"C\",\"dir\":\"tx\",\"reorder\":100}]}");
+    test_drain();
+    CHECK(root_send_relay_command(TEST_RELAY_ID, "a1"));
+    host_run_for_ms(20);
+    CHECK(root_ping_node(TEST_RELAY_ID));
+    host_run_for_ms(50);
+
+    mesh_app_msg_t msg;
+    size_t len = sizeof(msg);
+    CHECK(host_mesh_pop_sent(NULL, &msg, &len));
+    CHECK_EQ(msg.msg_type, MSG_TYPE_PING);
+    len = sizeof(msg);
+    CHECK(host_mesh_pop_sent(NULL, &msg, &len));
+    CHECK_EQ(msg.msg_type, MSG_TYPE_COMMAND);
+
+    TEST_CASE("tx reorder: with nothing behind it, it goes after a while");
+    CHECK(root_send_relay_command(TEST_RELAY_ID, "a1"));
+    host_run_for_ms(FAULT_REORDER_MAX_MS / 2);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 0);
+    host_run_for_ms(FAULT_REORDER_MAX_MS);
+    CHECK_EQ(count_frames(MSG_TYPE_COMMAND), 1);
+
+    test_mqtt("/switch/cmd/root", "{\"type\":\"fault\"}");
+    cJSON* report = pop_report(TEST_ROOT_ID);
+    CHECK_EQ(test_json_number(report, "tx.reorder"), 2);
+    cJSON_Delete(report);
+}
+
+static void test_rx_drop(void) {
+    TEST_CASE("rx drop: a dropped type-info never registers the node");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"fault\",\"clear\":true,\"rules\":["
+              "{\"msg\":\"T\",\"dir\":\"rx\",\"drop\":100}]}");
+    test_drain();
+    test_send(TEST_SWITCH_ID, MSG_TYPE_TYPE_INFO, "S", 1);
+    uint64_t ids[MAX_NODES];
+    mesh_addr_t addrs[MAX_NODES];
+    int n = root_registry_snapshot(ids, addrs, MAX_NODES);
+    for (int i = 0; i < n; i++) CHECK(ids[i] != TEST_SWITCH_ID);
+
+    test_mqtt("/switch/cmd/root", "{\"type\":\"fault\"}");
+    cJSON* report = pop_report(TEST_ROOT_ID);
+    CHECK_EQ(test_json_number(report, "rx.drop"), 1);
+    cJSON_Delete(report);
+}
+
+static void test_remote(void) {
+    TEST_CASE("a command for a node goes out as control frames");
+    test_mqtt("/switch/cmd/root", "{\"type\":\"fault\",\"clear\":true}");
+    test_drain();
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"fault\",\"device\":\"%" PRIu64 "\",\"rules\":["
+             "{\"msg\":\"B\",\"dir\":\"rx\",\"drop\":25}],"
+             "\"freeze\":\"mesh_tx\",\"freezeMs\":500}",
+             TEST_RELAY_ID);
+    test_mqtt("/switch/cmd/root", json);
+
+    const char ops[] = {FAULT_OP_ADD, FAULT_OP_FREEZE, FAULT_OP_REPORT_REQ};
+    for (int i = 0; i < 3; i++) {
+        mesh_app_msg_t msg;
+        mesh_addr_t to;
+        CHECK(test_pop_frame(MSG_TYPE_FAULT, &msg, &to));
+        CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+        CHECK_EQ(msg.data[0], ops[i]);
+        fault_ctl_t ctl;
+        memcpy(&ctl, &msg.data[1], sizeof(ctl));
+        if (ops[i] == FAULT_OP_ADD) {
+            CHECK_EQ(ctl.rule.msg_type, 'B');
+            CHECK_EQ(ctl.rule.dir, FAULT_DIR_RX);
+            CHECK_EQ(ctl.rule.drop_pct, 25);
+        } else if (ops[i] == FAULT_OP_FREEZE) {
+            CHECK_STR(ctl.task, "mesh_tx");
+            CHECK_EQ(ctl.ms, 500);
+        }
+    }
+
+    TEST_CASE("a node's report is published under its ID");
+    fault_report_t report = {.rule_count = 1, .disconnects = 2};
+    report.rules[0] = (fault_rule_t){.msg_type = 'B',
+                                     .dir = FAULT_DIR_RX,
+                                     .drop_pct = 25};
+    report.injected[0][FAULT_ACT_DROP] = 7;
+    char data[1 + sizeof(report)];
+    data[0] = FAULT_OP_REPORT;
+    memcpy(&data[1], &report, sizeof(report));
+    test_send(TEST_RELAY_ID, MSG_TYPE_FAULT, data, sizeof(data));
+    cJSON* json_report = pop_report(TEST_RELAY_ID);
+    CHECK(json_report != NULL);
+    CHECK_EQ(test_json_number(json_report, "rx.drop"), 7);
+    CHECK_EQ(cJSON_GetObjectItem(json_report, "disconnects")->valuedouble, 2);
+    const cJSON* rule =
+        cJSON_GetArrayItem(cJSON_GetObjectItem(json_report, "rules"), 0);
+    CHECK_STR(cJSON_GetObjectItem(rule, "dir")->valuestring, "rx");
+    cJSON_Delete(json_report);
+}
+
+void suite_fault(void) {
+    test_boot_root();
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+    test_rules_reported();
+    test_tx_drop();
+    test_tx_delay_dup();
+    test_tx_reorder();
+    test_rx_drop();
+    test_remote();
+}
+
+// ====================
+// Node
+// ====================
+
+static void send_ctl(const fault_ctl_t* ctl) {
+    char data[1 + sizeof(*ctl)];
+    data[0] = ctl->op;
+    memcpy(&data[1], ctl, sizeof(*ctl));
+    test_send(TEST_ROOT_ID, MSG_TYPE_FAULT, data, sizeof(data));
+}
+
+static void send_echo_req(uint32_t seq) {
+    char data[1 + sizeof(probe_frame_t)];
+    probe_frame_t ping = {.run_id = 21, .seq = seq};
+    data[0] = PROBE_OP_ECHO_REQ;
+    memcpy(&data[1], &ping, sizeof(ping));
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, TEST_ROOT_ID, MSG_TYPE_PROBE, data, sizeof(data));
+    test_inject(TEST_ROOT_ID, &msg);
+}
+
+static void test_rx_delay(void) {
+    TEST_CASE("rx delay: the frame is handled when it is due");
+    fault_ctl_t ctl = {
+        .op = FAULT_OP_ADD,
+        .rule = {.msg_type = MSG_TYPE_PROBE,
+                 .dir = FAULT_DIR_RX,
+                 .delay_pct = 100,
+                 .delay_ms = 150},
+    };
+    send_ctl(&ctl);
+    send_echo_req(1);
+    host_run_for_ms(100);
+    CHECK_EQ(count_frames(MSG_TYPE_PROBE), 0);
+    host_run_for_ms(100);
+    CHECK_EQ(count_frames(MSG_TYPE_PROBE), 1);
+
+    TEST_CASE("rx duplicate: the frame is handled twice");
+    ctl = (fault_ctl_t){.op = FAULT_OP_CLEAR};
+    send_ctl(&ctl);
+    ctl = (fault_ctl_t){
+        .op = FAULT_OP_ADD,
+        .rule = {.dir = FAULT_DIR_RX | FAULT_DIR_TX, .dup_pct = 100},
+    };
+    send_ctl(&ctl);
+    send_echo_req(2);
+    host_run_for_ms(50);
+    // Handled twice, each answer sent twice.
+    CHECK_EQ(count_frames(MSG_TYPE_PROBE), 4);
+}
+
+static void test_report(void) {
+    TEST_CASE("a report request is answered to the root");
+    fault_ctl_t ctl = {.op = FAULT_OP_REPORT_REQ};
+    send_ctl(&ctl);
+
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_FAULT, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    CHECK_EQ(msg.data[0], FAULT_OP_REPORT);
+    fault_report_t report;
+    memcpy(&report, &msg.data[1], sizeof(report));
+    CHECK_EQ(report.rule_count, 1);
+    CHECK_EQ(report.injected[0][FAULT_ACT_DUPLICATE], 1);
+    CHECK_EQ(report.injected[1][FAULT_ACT_DUPLICATE], 2);
+    // Fault frames themselves are never touched.
+    CHECK(!test_pop_frame(MSG_TYPE_FAULT, NULL, NULL));
+
+    ctl = (fault_ctl_t){.op = FAULT_OP_CLEAR};
+    send_ctl(&ctl);
+    test_drain();
+}
+
+static void test_disconnect(void) {
+    TEST_CASE("disconnect leaves the parent and the node rejoins");
+    fault_ctl_t ctl = {.op = FAULT_OP_DISCONNECT};
+    send_ctl(&ctl);
+    CHECK(!g_mesh_connected);
+    host_run_for_ms(1000);
+    CHECK(g_mesh_connected);
+
+    fault_report_t report;
+    fault_get_report(&report);
+    CHECK_EQ(report.disconnects, 1);
+    test_drain();
+}
+
+static void test_freeze(void) {
+    TEST_CASE("freeze suspends a task for the given time");
+    fault_ctl_t ctl = {.op = FAULT_OP_FREEZE, .ms = 300};
+    strcpy(ctl.task, "mesh_rx");
+    send_ctl(&ctl);
+    send_echo_req(3);
+    host_run_for_ms(200);
+    CHECK_EQ(count_frames(MSG_TYPE_PROBE), 0);
+    host_run_for_ms(200);
+    CHECK_EQ(count_frames(MSG_TYPE_PROBE), 1);
+
+    TEST_CASE("unknown tasks and esp_timer are refused");
+    CHECK(!fault_control(0, &(fault_ctl_t){.op = FAULT_OP_FREEZE,
+                                           .ms = 100,
+                                           .task = "nope"}));
+    CHECK(!fault_control(0, &(fault_ctl_t){.op = FAULT_OP_FREEZE,
+                                           .ms = 100,
+                                           .task = "esp_timer"}));
+    fault_report_t report;
+    fault_get_report(&report);
+    CHECK_EQ(report.freezes, 1);
+}
+
+void suite_fault_node(void) {
+    test_boot_node(1);
+    test_drain();
+    test_rx_delay();
+    test_report();
+    test_disconnect();
+    test_freeze();
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_main.c
+ * @brief Host test runner: `domator_host_tests <suite>` boots the firmware
+ *        once and runs one suite against it.  ctest starts a fresh process
+ *        per suite because the firmware keeps its state in globals.
+ */
+
+#include <stdlib.h>
+
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "test.h"
+
+void app_main(void);
+
+int g_test_failures;
+
+static const struct {
+    const char* name;
+    void (*run)(void);
+} s_suites[] = {
+    {"codec", suite_codec},     {"routing", suite_routing},
+    {"relay", suite_relay},     {"config", suite_config},
+    {"txqueue", suite_txqueue}, {"bench", suite_bench},
+    {"bench_switch", suite_bench_switch}, {"probe", suite_probe},
+    {"probe_node", suite_probe_node},   {"fault", suite_fault},
+    {"fault_node", suite_fault_node},   {"failover", suite_failover},
+    {"failover_node", suite_failover_node}, {"standby", suite_standby},
+    {"standby_node", suite_standby_node},
+};
+
+#define NUM_SUITES (sizeof(s_suites) / sizeof(s_suites[0]))
+
+// ====================
+// Boot
+// ====================
+
+static bool mqtt_up(void* ctx) {
+    (void)ctx;
+    return g_mqtt_connected;
+}
+
+static bool mesh_up(void* ctx) {
+    (void)ctx;
+    return g_mesh_connected;
+}
+
+void test_boot_root(void) {
+    app_main();
+    if (!host_run_until(mqtt_up, NULL, 10, 5000)) {
+        fprintf(stderr, "root did not reach MQTT\n");
+        exit(1);
+    }
+    host_run_for_ms(100);
+    test_drain();
+}
+
+void test_boot_node(uint8_t hardware_type) {
+    host_node_t node = {
+        .mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0xB1},
+        .is_root = false,
+        .layer = 2,
+        .parent_bssid = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01},
+        .rssi = -60,
+        .total_nodes = 2,
+    };
+    host_node_config(&node);
+
+    nvs_handle_t nvs;
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(nvs_open("domator", NVS_READWRITE, &nvs));
+    ESP_ERROR_CHECK(nvs_set_u8(nvs, "hardware_type", hardware_type));
+    nvs_close(nvs);
+
+    app_main();
+    if (!host_run_until(mesh_up, NULL, 10, 5000)) {
+        fprintf(stderr, "node did not join the mesh\n");
+        exit(1);
+    }
+    host_run_for_ms(100);
+    test_drain();
+}
+
+// ====================
+// Traffic
+// ====================
+
+void test_make_msg(mesh_app_msg_t* msg, uint64_t src, uint8_t type,
+                   const char* data, int len) {
+    memset(msg, 0, sizeof(*msg));
+    msg->src_id = src;
+    msg->msg_type = type;
+    if (data) {
+        if (len < 0) len = (int)strlen(data);
+        memcpy(msg->data, data, len);
+        msg->data_len = (uint16_t)len;
+    }
+}
+
+void test_inject(uint64_t src, const mesh_app_msg_t* msg) {
+    mesh_addr_t from;
+    host_id_to_addr(src, &from);
+    CHECK_EQ(host_mesh_inject(&from, msg, sizeof(*msg)), ESP_OK);
+}
+
+void test_send(uint64_t src, uint8_t type, const char* data, int len) {
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, src, type, data, len);
+    test_inject(src, &msg);
+    host_run_for_ms(50);
+}
+
+void test_mqtt(const char* topic, const char* payload) {
+    CHECK(host_mqtt_inject(topic, payload, -1));
+    host_run_for_ms(50);
+}
+
+bool test_pop_frame(uint8_t type, mesh_app_msg_t* out, mesh_addr_t* to) {
+    mesh_addr_t addr;
+    mesh_app_msg_t msg;
+    size_t len = sizeof(msg);
+    while (host_mesh_pop_sent(&addr, &msg, &len)) {
+        if (len == sizeof(msg) && msg.msg_type == type) {
+            if (out) *out = msg;
+            if (to) *to = addr;
+            return true;
+        }
+        len = sizeof(msg);
+    }
+    return false;
+}
+
+bool test_pop_publish(const char* prefix, char* topic, size_t tsize,
+                      char* data, size_t dsize) {
+    char t[128];
+    char d[512];
+    while (host_mqtt_pop_published(t, sizeof(t), d, sizeof(d))) {
+        if (strncmp(t, prefix, strlen(prefix)) == 0) {
+            if (topic) snprintf(topic, tsize, "%s", t);
+            if (data) snprintf(data, dsize, "%s", d);
+            return true;
+        }
+    }
+    return false;
+}
+
+cJSON* test_pop_json(const char* topic) {
+    char t[128];
+    static char d[4096];
+    while (host_mqtt_pop_published(t, sizeof(t), d, sizeof(d))) {
+        if (strcmp(t, topic) == 0) return cJSON_Parse(d);
+    }
+    return NULL;
+}
+
+double test_json_number(const cJSON* json, const char* path) {
+    char key[64];
+    while (json != NULL) {
+        const char* dot = strchr(path, '.');
+        if (dot == NULL) break;
+        snprintf(key, sizeof(key), "%.*s", (int)(dot - path), path);
+        json = cJSON_GetObjectItem(json, key);
+        path = dot + 1;
+    }
+    const cJSON* item = cJSON_GetObjectItem(json, path);
+    return cJSON_IsNumber(item) ? item->valuedouble : -1;
+}
+
+void test_drain(void) {
+    size_t len = 0;
+    while (host_mesh_pop_sent(NULL, NULL, &len)) len = 0;
+    while (host_mqtt_pop_published(NULL, 0, NULL, 0)) {
+    }
+}
+
+uint64_t test_addr_to_id(const mesh_addr_t* addr) {
+    uint64_t id = 0;
+    for (int i = 0; i < 6; i++) id = (id << 8) | addr->addr[i];
+    return id;
+}
+
+// ====================
+// Runner
+// ====================
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <suite>\n", argv[0]);
+        return 2;
+    }
+    for (size_t i = 0; i < NUM_SUITES; i++) {
+        if (strcmp(argv[1], s_suites[i].name) != 0) continue;
+        s_suites[i].run();
+        fprintf(stderr, "%s: %d failure(s)\n", s_suites[i].name,
+                g_test_failures);
+        return g_test_failures ? 1 : 0;
+    }
+    fprintf(stderr, "unknown suite: %s\n", argv[1]);
+    return 2;
+}
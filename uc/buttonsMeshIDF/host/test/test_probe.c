@@ -0,0 +1,290 @@
+/**
+ * @file test_probe.c
+ * @brief Link probe: the root's phases and report ("probe") and the node's
+ *        replies and up stream ("probe_node").
+ */
+
+#include "cJSON.h"
+#include "test.h"
+
+/** @brief Inject a probe frame; @p age_us > 0 stamps it that old. */
+static void send_probe(uint64_t src, char op, const void* body, size_t len,
+                       int64_t age_us) {
+    char data[1 + sizeof(probe_result_t)];
+    data[0] = op;
+    memcpy(&data[1], body, len);
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, src, MSG_TYPE_PROBE, data, 1 + len);
+    if (age_us > 0) msg.mesh_time_us = mesh_time_now_us() - age_us;
+    test_inject(src, &msg);
+}
+
+/** @brief Pop the next probe frame with op @p op. */
+static bool pop_probe(char op, probe_frame_t* frame, mesh_app_msg_t* out,
+                      mesh_addr_t* to) {
+    mesh_app_msg_t msg;
+    while (test_pop_frame(MSG_TYPE_PROBE, &msg, to)) {
+        if (msg.data[0] != op) continue;
+        if (frame) memcpy(frame, &msg.data[1], sizeof(*frame));
+        if (out) *out = msg;
+        return true;
+    }
+    return false;
+}
+
+// ====================
+// Root
+// ====================
+
+static cJSON* pop_report(void) {
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/probe/%" PRIu64, TEST_RELAY_ID);
+    return test_pop_json(topic);
+}
+
+static void start_probe(const char* extra) {
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"probe\",\"device\":\"%" PRIu64 "\"%s}",
+             TEST_RELAY_ID, extra);
+    test_mqtt("/switch/cmd/root", json);
+}
+
+static void test_unknown_node(void) {
+    TEST_CASE("unregistered nodes are not probed");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"probe\",\"device\":\"12345\"}");
+    host_run_for_ms(1000);
+    CHECK(!test_pop_frame(MSG_TYPE_PROBE, NULL, NULL));
+}
+
+static void test_all_phases(void) {
+    TEST_CASE("down: bursts of frames straight to the node, then a request");
+    start_probe(",\"frames\":6,\"burst\":3,\"gapMs\":20,\"pings\":3");
+    host_run_for_ms(200);
+
+    probe_frame_t frame;
+    mesh_addr_t to;
+    CHECK(pop_probe(PROBE_OP_BEGIN_DOWN, &frame, NULL, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(frame.seq, 6);
+    uint32_t run = frame.run_id;
+    int64_t first_us = 0;
+    for (uint32_t seq = 0; seq < 6; seq++) {
+        CHECK(pop_probe(PROBE_OP_DATA, &frame, NULL, NULL));
+        CHECK_EQ(frame.run_id, run);
+        CHECK_EQ(frame.seq, seq);
+        if (seq == 0) first_us = frame.tx_us;
+    }
+    CHECK(frame.tx_us - first_us >= 20000);
+
+    host_run_for_ms(PROBE_DRAIN_MS);
+    CHECK(pop_probe(PROBE_OP_RESULT_REQ, &frame, NULL, NULL));
+    probe_result_t result = {
+        .run_id = run,
+        .received = 5,
+        .reordered = 1,
+        .span_us = 50000,
+        .layer = 3,
+    };
+    lat_hist_add(&result.latency, 4000);
+    send_probe(TEST_RELAY_ID, PROBE_OP_RESULT, &result, sizeof(result), 0);
+    host_run_for_ms(50);
+
+    TEST_CASE("up: the node streams and reports its totals");
+    mesh_app_msg_t msg;
+    CHECK(pop_probe(PROBE_OP_BEGIN_UP, NULL, &msg, NULL));
+    probe_up_params_t up;
+    memcpy(&up, &msg.data[1], sizeof(up));
+    CHECK_EQ(up.run_id, run);
+    CHECK_EQ(up.frames, 6);
+    CHECK_EQ(up.burst, 3);
+    CHECK_EQ(up.gap_ms, 20);
+
+    uint32_t order[] = {0, 2, 1, 4};
+    for (int i = 0; i < 4; i++) {
+        probe_frame_t data = {.run_id = run, .seq = order[i]};
+        send_probe(TEST_RELAY_ID, PROBE_OP_DATA, &data, sizeof(data), 3000);
+        host_run_for_ms(10);
+    }
+    probe_frame_t stale = {.run_id = run + 2, .seq = 5};
+    send_probe(TEST_RELAY_ID, PROBE_OP_DATA, &stale, sizeof(stale), 0);
+    probe_up_done_t done = {
+        .run_id = run,
+        .sent = 6,
+        .span_us = 30000,
+        .layer = 3,
+    };
+    send_probe(TEST_RELAY_ID, PROBE_OP_UP_DONE, &done, sizeof(done), 0);
+    host_run_for_ms(PROBE_DRAIN_MS + 100);
+
+    TEST_CASE("rtt: one ping at a time; an unanswered one counts as lost");
+    CHECK(pop_probe(PROBE_OP_ECHO_REQ, &frame, NULL, NULL));
+    CHECK_EQ(frame.seq, 0);
+    host_run_for_ms(4);
+    send_probe(TEST_RELAY_ID, PROBE_OP_ECHO, &frame, sizeof(frame), 0);
+    host_run_for_ms(PROBE_PING_GAP_MS + 20);
+    CHECK(pop_probe(PROBE_OP_ECHO_REQ, &frame, NULL, NULL));
+    CHECK_EQ(frame.seq, 1);
+    host_run_for_ms(PROBE_ECHO_TIMEOUT_MS + PROBE_PING_GAP_MS);
+    CHECK(pop_probe(PROBE_OP_ECHO_REQ, &frame, NULL, NULL));
+    CHECK_EQ(frame.seq, 2);
+    probe_frame_t late = frame;
+    late.seq = 1;
+    send_probe(TEST_RELAY_ID, PROBE_OP_ECHO, &late, sizeof(late), 0);
+    host_run_for_ms(2);
+    send_probe(TEST_RELAY_ID, PROBE_OP_ECHO, &frame, sizeof(frame), 0);
+    host_run_for_ms(200);
+
+    TEST_CASE("the report has both directions and the RTT");
+    cJSON* report = pop_report();
+    CHECK(report != NULL);
+    CHECK_EQ(test_json_number(report, "run"), run);
+    CHECK_EQ(test_json_number(report, "frameBytes"), sizeof(mesh_app_msg_t));
+    CHECK_EQ(test_json_number(report, "down.sent"), 6);
+    CHECK_EQ(test_json_number(report, "down.received"), 5);
+    CHECK_EQ(test_json_number(report, "down.lost"), 1);
+    CHECK_EQ(test_json_number(report, "down.reordered"), 1);
+    CHECK_EQ(test_json_number(report, "down.hops"), 2);
+    // 4 frame intervals of 536 bytes in 50 ms.
+    CHECK_EQ(test_json_number(report, "down.goodputKbps"), 4 * 536 * 8 / 50.0);
+    const cJSON* down = cJSON_GetObjectItem(report, "down");
+    CHECK_EQ(test_json_number(down, "latencyUs.max"), 4000);
+
+    const cJSON* up_obj = cJSON_GetObjectItem(report, "up");
+    CHECK(cJSON_IsTrue(cJSON_GetObjectItem(up_obj, "reported")));
+    CHECK_EQ(test_json_number(report, "up.sent"), 6);
+    CHECK_EQ(test_json_number(report, "up.received"), 4);
+    CHECK_EQ(test_json_number(report, "up.lost"), 2);
+    CHECK_EQ(test_json_number(report, "up.reordered"), 1);
+    CHECK_EQ(test_json_number(report, "up.hops"), 2);
+    CHECK_EQ(test_json_number(up_obj, "latencyUs.n"), 4);
+    CHECK(test_json_number(up_obj, "latencyUs.min") >= 3000);
+
+    CHECK_EQ(test_json_number(report, "rttUs.n"), 2);
+    CHECK_EQ(test_json_number(report, "rttUs.lost"), 1);
+    CHECK(test_json_number(report, "rttUs.min") >= 4000);
+    cJSON_Delete(report);
+}
+
+static void test_silent_node(void) {
+    TEST_CASE("a silent node ends each phase after its timeout");
+    start_probe(",\"frames\":2,\"pings\":0,\"direction\":\"down\"");
+    host_run_for_ms(PROBE_DRAIN_MS + PROBE_REPLY_TIMEOUT_MS + 500);
+    CHECK(!pop_probe(PROBE_OP_BEGIN_UP, NULL, NULL, NULL));
+
+    cJSON* report = pop_report();
+    CHECK(report != NULL);
+    const cJSON* down = cJSON_GetObjectItem(report, "down");
+    CHECK(cJSON_IsFalse(cJSON_GetObjectItem(down, "answered")));
+    CHECK_EQ(test_json_number(down, "sent"), 2);
+    CHECK(cJSON_GetObjectItem(report, "up") == NULL);
+    CHECK(cJSON_GetObjectItem(report, "rttUs") == NULL);
+    cJSON_Delete(report);
+
+    start_probe(",\"frames\":2,\"pings\":0,\"direction\":\"up\"");
+    host_run_for_ms(PROBE_DRAIN_MS + PROBE_REPLY_TIMEOUT_MS + 500);
+    report = pop_report();
+    CHECK(report != NULL);
+    const cJSON* up = cJSON_GetObjectItem(report, "up");
+    CHECK(cJSON_IsFalse(cJSON_GetObjectItem(up, "reported")));
+    CHECK_EQ(test_json_number(up, "received"), 0);
+    cJSON_Delete(report);
+}
+
+void suite_probe(void) {
+    test_boot_root();
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+    test_unknown_node();
+    test_all_phases();
+    test_silent_node();
+}
+
+// ====================
+// Node
+// ====================
+
+static void test_down_result(void) {
+    TEST_CASE("the node counts a down stream and answers with its result");
+    probe_frame_t begin = {.run_id = 11, .seq = 4};
+    send_probe(TEST_ROOT_ID, PROBE_OP_BEGIN_DOWN, &begin, sizeof(begin), 0);
+    uint32_t order[] = {0, 1, 3, 2};
+    for (int i = 0; i < 4; i++) {
+        probe_frame_t data = {.run_id = 11, .seq = order[i]};
+        send_probe(TEST_ROOT_ID, PROBE_OP_DATA, &data, sizeof(data), 0);
+        host_run_for_ms(10);
+    }
+    probe_frame_t other = {.run_id = 12};
+    send_probe(TEST_ROOT_ID, PROBE_OP_DATA, &other, sizeof(other), 0);
+
+    probe_frame_t req = {.run_id = 11};
+    send_probe(TEST_ROOT_ID, PROBE_OP_RESULT_REQ, &req, sizeof(req), 0);
+    host_run_for_ms(50);
+
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(pop_probe(PROBE_OP_RESULT, NULL, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    probe_result_t result;
+    memcpy(&result, &msg.data[1], sizeof(result));
+    CHECK_EQ(result.run_id, 11);
+    CHECK_EQ(result.received, 4);
+    CHECK_EQ(result.reordered, 1);
+    CHECK_EQ(result.span_us, 30000);
+    CHECK_EQ(result.layer, 2);
+}
+
+static void test_up_stream(void) {
+    TEST_CASE("the node streams up in bursts and sends its totals");
+    probe_up_params_t p = {
+        .run_id = 13,
+        .frames = 5,
+        .burst = 2,
+        .gap_ms = 30,
+    };
+    send_probe(TEST_ROOT_ID, PROBE_OP_BEGIN_UP, &p, sizeof(p), 0);
+    host_run_for_ms(200);
+
+    probe_frame_t frame;
+    mesh_addr_t to;
+    int64_t tx_us[5];
+    for (uint32_t seq = 0; seq < 5; seq++) {
+        CHECK(pop_probe(PROBE_OP_DATA, &frame, NULL, &to));
+        CHECK_EQ(test_addr_to_id(&to), 0);
+        CHECK_EQ(frame.run_id, 13);
+        CHECK_EQ(frame.seq, seq);
+        tx_us[seq] = frame.tx_us;
+    }
+    CHECK(tx_us[1] - tx_us[0] < 1000);
+    CHECK(tx_us[2] - tx_us[1] >= 30000);
+
+    mesh_app_msg_t msg;
+    CHECK(pop_probe(PROBE_OP_UP_DONE, NULL, &msg, NULL));
+    probe_up_done_t done;
+    memcpy(&done, &msg.data[1], sizeof(done));
+    CHECK_EQ(done.run_id, 13);
+    CHECK_EQ(done.sent, 5);
+    CHECK_EQ(done.failed, 0);
+    CHECK_EQ(done.layer, 2);
+}
+
+static void test_echo(void) {
+    TEST_CASE("echo requests come straight back");
+    probe_frame_t ping = {.run_id = 14, .seq = 3, .tx_us = 123456};
+    send_probe(TEST_ROOT_ID, PROBE_OP_ECHO_REQ, &ping, sizeof(ping), 0);
+    host_run_for_ms(10);
+    probe_frame_t echo;
+    CHECK(pop_probe(PROBE_OP_ECHO, &echo, NULL, NULL));
+    CHECK_EQ(echo.run_id, 14);
+    CHECK_EQ(echo.seq, 3);
+    CHECK_EQ(echo.tx_us, 123456);
+}
+
+void suite_probe_node(void) {
+    test_boot_node(1);
+    test_drain();
+    test_down_result();
+    test_up_stream();
+    test_echo();
+}
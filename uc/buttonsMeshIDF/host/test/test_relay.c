@@ -0,0 +1,154 @@
+/**
+ * @file test_relay.c
+ * @brief Relay node command parser: set/toggle/sync commands from the root,
+ *        the confirmations sent back, GPIO outputs, and auto-off timers.
+ */
+
+#include "nvs.h"
+#include "test.h"
+
+static void command(const char* data) {
+    test_send(TEST_ROOT_ID, MSG_TYPE_COMMAND, data, -1);
+}
+
+/** @brief Expect exactly one RELAY_STATE frame to the root. */
+static void expect_state(const char* data) {
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_RELAY_STATE, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    CHECK_EQ(msg.src_id, g_device_id);
+    CHECK_EQ(msg.data_len, 2);
+    CHECK(memcmp(msg.data, data, 2) == 0);
+    CHECK(!test_pop_frame(MSG_TYPE_RELAY_STATE, NULL, NULL));
+}
+
+static void test_set_and_toggle(void) {
+    TEST_CASE("set and toggle drive the output and confirm");
+    command("a1");
+    CHECK(relay_get_state(0));
+    CHECK_EQ(host_gpio_get_output(g_relay_8_pins[0]), 1);
+    expect_state("A1");
+
+    command("a");
+    CHECK(!relay_get_state(0));
+    CHECK_EQ(host_gpio_get_output(g_relay_8_pins[0]), 0);
+    expect_state("A0");
+
+    command("H1");
+    CHECK(relay_get_state(7));
+    expect_state("H1");
+    command("h0");
+    CHECK(!relay_get_state(7));
+    expect_state("H0");
+}
+
+static void test_invalid(void) {
+    TEST_CASE("malformed commands change nothing");
+    uint16_t before = g_relay_outputs;
+    command("i1");
+    command("a2");
+    command("a11");
+    command("#");
+    CHECK_EQ(g_relay_outputs, before);
+    CHECK(!test_pop_frame(MSG_TYPE_RELAY_STATE, NULL, NULL));
+}
+
+static void test_sync(void) {
+    TEST_CASE("sync reports every output");
+    command("c1");
+    test_drain();
+
+    command("S");
+    mesh_app_msg_t msg;
+    for (int i = 0; i < MAX_RELAYS_8; i++) {
+        CHECK(test_pop_frame(MSG_TYPE_RELAY_STATE, &msg, NULL));
+        CHECK_EQ(msg.data[0], 'A' + i);
+        CHECK_EQ(msg.data[1], i == 2 ? '1' : '0');
+    }
+    CHECK(!test_pop_frame(MSG_TYPE_RELAY_STATE, NULL, NULL));
+
+    test_send(TEST_ROOT_ID, MSG_TYPE_SYNC_REQUEST, NULL, 0);
+    int count = 0;
+    while (test_pop_frame(MSG_TYPE_RELAY_STATE, NULL, NULL)) count++;
+    CHECK_EQ(count, MAX_RELAYS_8);
+}
+
+static void test_auto_off(void) {
+    TEST_CASE("auto-off switches the output off and confirms");
+    command("Tb2");
+    command("b1");
+    CHECK(relay_get_state(1));
+    expect_state("B1");
+
+    host_run_for_ms(1500);
+    CHECK(relay_get_state(1));
+    host_run_for_ms(1000);
+    CHECK(!relay_get_state(1));
+    expect_state("B0");
+
+    nvs_handle_t nvs;
+    uint16_t saved = 0xFFFF;
+    CHECK_EQ(nvs_open("relay_states", NVS_READONLY, &nvs), ESP_OK);
+    CHECK_EQ(nvs_get_u16(nvs, "outputs", &saved), ESP_OK);
+    nvs_close(nvs);
+    CHECK_EQ(saved & (1u << 1), 0);
+}
+
+static void test_root_commands_only_for_relays(void) {
+    TEST_CASE("frames addressed to switches are ignored");
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, TEST_ROOT_ID, MSG_TYPE_COMMAND, "d1", 2);
+    msg.target_type = DEVICE_TYPE_SWITCH;
+    test_inject(TEST_ROOT_ID, &msg);
+    host_run_for_ms(50);
+    CHECK(!relay_get_state(3));
+}
+
+static void test_bench_commands(void) {
+    TEST_CASE("tagged commands are reported; dry runs leave the output");
+    mesh_app_msg_t msg, applied_msg;
+    bench_tag_t tag = {
+        .magic = BENCH_TAG_MAGIC,
+        .flags = BENCH_FLAG_DRY_RUN,
+        .run_id = 11,
+        .seq = 4,
+    };
+    test_make_msg(&msg, TEST_ROOT_ID, MSG_TYPE_COMMAND, "e1", 2);
+    bench_tag_put(&msg, &tag);
+    test_inject(TEST_ROOT_ID, &msg);
+    host_run_for_ms(50);
+    CHECK(!relay_get_state(4));
+
+    bench_applied_t applied;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_BENCH, &applied_msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    CHECK_EQ(applied_msg.data[0], BENCH_OP_APPLIED);
+    memcpy(&applied, &applied_msg.data[1], sizeof(applied));
+    CHECK_EQ(applied.tag.run_id, 11);
+    CHECK_EQ(applied.tag.seq, 4);
+    CHECK(!test_pop_frame(MSG_TYPE_RELAY_STATE, NULL, NULL));
+
+    tag.flags = 0;
+    test_make_msg(&msg, TEST_ROOT_ID, MSG_TYPE_COMMAND, "e1", 2);
+    bench_tag_put(&msg, &tag);
+    test_inject(TEST_ROOT_ID, &msg);
+    host_run_for_ms(50);
+    CHECK(relay_get_state(4));
+    CHECK(test_pop_frame(MSG_TYPE_RELAY_STATE, &msg, NULL));
+    CHECK(memcmp(msg.data, "E1", 2) == 0);
+    CHECK(test_pop_frame(MSG_TYPE_BENCH, NULL, NULL));
+}
+
+void suite_relay(void) {
+    test_boot_node(1);
+    CHECK_EQ(g_node_type, NODE_TYPE_RELAY_8);
+    CHECK(!g_is_root);
+    test_set_and_toggle();
+    test_invalid();
+    test_sync();
+    test_auto_off();
+    test_root_commands_only_for_relays();
+    test_bench_commands();
+}
@@ -0,0 +1,135 @@
+/**
+ * @file test_routing.c
+ * @brief Root routing: switch presses to relay commands through the
+ *        connections table, MQTT mirroring of presses and relay states, and
+ *        direct MQTT relay commands.
+ */
+
+#include "test.h"
+
+static void configure(void) {
+    char json[512];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"button_types\",\"data\":{\"%" PRIu64 "\":"
+             "{\"a\":0,\"b\":0,\"f\":1}}}",
+             TEST_SWITCH_ID);
+    test_mqtt("/switch/cmd/root", json);
+
+    snprintf(json, sizeof(json),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64 "\":{"
+             "\"a\":[[%" PRIu64 ",\"c\"]],"
+             "\"b\":[[%" PRIu64 ",\"d\"],[%" PRIu64 ",\"e\"]],"
+             "\"f\":[[%" PRIu64 ",\"f\"]],"
+             "\"g\":[[%" PRIu64 ",\"a\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY_ID, TEST_RELAY_ID, TEST_RELAY_ID,
+             TEST_RELAY_ID, (uint64_t)0x0200000000FFULL);
+    test_mqtt("/switch/cmd/root", json);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_TYPE_INFO, "S", 1);
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+}
+
+static void expect_command(const char* data) {
+    mesh_app_msg_t cmd;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_COMMAND, &cmd, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(cmd.src_id, g_device_id);
+    CHECK_EQ(cmd.data_len, strlen(data));
+    CHECK(memcmp(cmd.data, data, strlen(data)) == 0);
+}
+
+static void test_toggle_press(void) {
+    TEST_CASE("toggle button acts on release");
+    char topic[64], data[64], want[64];
+    snprintf(want, sizeof(want), "/switch/state/%" PRIu64, TEST_SWITCH_ID);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "a1", 2);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    CHECK(!test_pop_publish(want, NULL, 0, NULL, 0));
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "a0", 2);
+    expect_command("c");
+    CHECK(test_pop_publish(want, topic, sizeof(topic), data, sizeof(data)));
+    CHECK_STR(data, "a");
+}
+
+static void test_fan_out(void) {
+    TEST_CASE("one button drives every target in order");
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "b0", 2);
+    expect_command("d");
+    expect_command("e");
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+    test_drain();
+}
+
+static void test_stateful(void) {
+    TEST_CASE("stateful button sends the state with the command");
+    char want[64], data[64];
+    snprintf(want, sizeof(want), "/switch/state/%" PRIu64, TEST_SWITCH_ID);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "f1", 2);
+    expect_command("f0");
+    CHECK(test_pop_publish(want, NULL, 0, data, sizeof(data)));
+    CHECK_STR(data, "f1");
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "f0", 2);
+    expect_command("f1");
+}
+
+static void test_unrouted(void) {
+    TEST_CASE("unconfigured buttons and unknown targets send nothing");
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "h0", 2);
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "g0", 2);
+    test_send(TEST_SWITCH_ID + 1, MSG_TYPE_BUTTON, "a0", 2);
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+}
+
+static void test_relay_state_published(void) {
+    TEST_CASE("relay state is retained on MQTT");
+    char want[64], data[64];
+    snprintf(want, sizeof(want), "/relay/state/%" PRIu64, TEST_RELAY_ID);
+    test_send(TEST_RELAY_ID, MSG_TYPE_RELAY_STATE, "C1", 2);
+    CHECK(test_pop_publish(want, NULL, 0, data, sizeof(data)));
+    CHECK_STR(data, "C1");
+}
+
+static void test_mqtt_relay_command(void) {
+    TEST_CASE("MQTT relay command reaches the relay");
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/relay/cmd/%" PRIu64, TEST_RELAY_ID);
+    test_mqtt(topic, "b1");
+    expect_command("b1");
+
+    snprintf(topic, sizeof(topic), "/relay/cmd/%" PRIu64, TEST_RELAY_ID + 1);
+    test_mqtt(topic, "b1");
+    CHECK(!test_pop_frame(MSG_TYPE_COMMAND, NULL, NULL));
+}
+
+static void test_mqtt_offline(void) {
+    TEST_CASE("routing keeps working without the broker");
+    host_mqtt_set_connected(false);
+    host_run_for_ms(50);
+    CHECK(!g_mqtt_connected);
+
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "a0", 2);
+    expect_command("c");
+    CHECK(!test_pop_publish("/switch/state/", NULL, 0, NULL, 0));
+
+    host_mqtt_set_connected(true);
+    host_run_for_ms(50);
+    CHECK(g_mqtt_connected);
+}
+
+void suite_routing(void) {
+    test_boot_root();
+    configure();
+    test_toggle_press();
+    test_fan_out();
+    test_stateful();
+    test_unrouted();
+    test_relay_state_published();
+    test_mqtt_relay_command();
+    test_mqtt_offline();
+}
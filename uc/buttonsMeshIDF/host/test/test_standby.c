@@ -0,0 +1,427 @@
+/**
+ * @file test_standby.c
+ * @brief Root roles and the hot standby: the root keeps the best-ranked node
+ *        in sync and hands the root over to it ("standby"); the standby
+ *        stores the replica and takes over warm when elected
+ *        ("standby_node").
+ */
+
+#include "cJSON.h"
+#include "nvs.h"
+#include "test.h"
+
+/** @brief The MSG_TYPE_REPLICA frames sent so far, decoded. */
+typedef struct {
+    int frames;
+    int misaddressed;  // frames not sent to the expected standby
+    replica_node_t nodes[MAX_NODES];
+    int node_count;
+    char config[REPLICA_CFG_COUNT][4096];
+    int config_len[REPLICA_CFG_COUNT];
+    replica_output_t outputs[MAX_NODES];
+    int output_count;
+} replica_seen_t;
+
+static replica_seen_t s_seen;
+
+static void seen_reset(void) { memset(&s_seen, 0, sizeof(s_seen)); }
+
+/** @brief Decode the replica frames queued since the last call. */
+static void collect(uint64_t standby_id) {
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    while (test_pop_frame(MSG_TYPE_REPLICA, &msg, &to)) {
+        s_seen.frames++;
+        if (test_addr_to_id(&to) != standby_id) s_seen.misaddressed++;
+        int count = (uint8_t)msg.data[1];
+        if (msg.data[0] == REPLICA_OP_REGISTRY &&
+            s_seen.node_count + count <= MAX_NODES) {
+            memcpy(&s_seen.nodes[s_seen.node_count], &msg.data[2],
+                   count * sizeof(replica_node_t));
+            s_seen.node_count += count;
+        } else if (msg.data[0] == REPLICA_OP_OUTPUTS &&
+                   s_seen.output_count + count <= MAX_NODES) {
+            memcpy(&s_seen.outputs[s_seen.output_count], &msg.data[2],
+                   count * sizeof(replica_output_t));
+            s_seen.output_count += count;
+        } else if (msg.data[0] == REPLICA_OP_CONFIG) {
+            replica_config_hdr_t hdr;
+            memcpy(&hdr, &msg.data[1], sizeof(hdr));
+            int n = msg.data_len - 1 - (int)sizeof(hdr);
+            CHECK(hdr.kind < REPLICA_CFG_COUNT);
+            if (hdr.kind >= REPLICA_CFG_COUNT) continue;
+            CHECK_EQ(hdr.offset, s_seen.config_len[hdr.kind]);
+            CHECK(hdr.offset + n <= (int)sizeof(s_seen.config[0]));
+            if (hdr.offset + n > (int)sizeof(s_seen.config[0])) continue;
+            memcpy(&s_seen.config[hdr.kind][hdr.offset],
+                   &msg.data[1 + sizeof(hdr)], n);
+            s_seen.config_len[hdr.kind] = hdr.offset + n;
+        }
+    }
+}
+
+static const replica_node_t* seen_node(uint64_t id) {
+    for (int i = 0; i < s_seen.node_count; i++) {
+        if (s_seen.nodes[i].device_id == id) return &s_seen.nodes[i];
+    }
+    return NULL;
+}
+
+static bool seen_config(replica_config_t kind, const char* json) {
+    return s_seen.config_len[kind] == (int)strlen(json) &&
+           memcmp(s_seen.config[kind], json, strlen(json)) == 0;
+}
+
+/** @brief A connections command spanning several replica frames. */
+static void build_connections(char* json, size_t size) {
+    int len = snprintf(json, size,
+                       "{\"type\":\"connections\",\"data\":{\"%" PRIu64
+                       "\":{",
+                       TEST_SWITCH_ID);
+    for (char button = 'a'; button <= 'h'; button++) {
+        len += snprintf(json + len, size - len, "%s\"%c\":[",
+                        button == 'a' ? "" : ",", button);
+        for (char relay = 'A'; relay <= 'P'; relay++) {
+            len += snprintf(json + len, size - len, "%s[%" PRIu64 ",\"%c\"]",
+                            relay == 'A' ? "" : ",", TEST_RELAY2_ID, relay);
+        }
+        len += snprintf(json + len, size - len, "]");
+    }
+    snprintf(json + len, size - len, "}}}");
+}
+
+static bool mqtt_up(void* ctx) {
+    (void)ctx;
+    return g_mqtt_connected;
+}
+
+// ====================
+// Root
+// ====================
+
+static char s_connections[4096];
+static char s_button_types[256];
+
+static void test_role_command(void) {
+    TEST_CASE("root_role sends the role to the node");
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_drain();
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"root_role\",\"device\":\"%" PRIu64
+             "\",\"role\":\"standby\"}",
+             TEST_RELAY_ID);
+    test_mqtt("/switch/cmd/root", json);
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_CONFIG, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY_ID);
+    CHECK_EQ(msg.data_len, 2);
+    CHECK_EQ(msg.data[0], CONFIG_KEY_ROOT_ROLE);
+    CHECK_EQ(msg.data[1], ROOT_ROLE_STANDBY);
+
+    TEST_CASE("an unknown role is refused");
+    snprintf(json, sizeof(json),
+             "{\"type\":\"root_role\",\"device\":\"%" PRIu64
+             "\",\"role\":\"primary\"}",
+             TEST_RELAY_ID);
+    test_mqtt("/switch/cmd/root", json);
+    CHECK(!test_pop_frame(MSG_TYPE_CONFIG, NULL, NULL));
+
+    TEST_CASE("without a role no node is kept in sync");
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    CHECK(!test_pop_frame(MSG_TYPE_REPLICA, NULL, NULL));
+}
+
+static void test_snapshot(void) {
+    TEST_CASE("the standby gets everything once it announces its role");
+    build_connections(s_connections, sizeof(s_connections));
+    CHECK(strlen(s_connections) >
+          REPLICA_FRAMES_PER_POLL * MESH_MSG_DATA_SIZE);
+    test_mqtt("/switch/cmd/root", s_connections);
+    snprintf(s_button_types, sizeof(s_button_types),
+             "{\"type\":\"button_types\",\"data\":{\"%" PRIu64
+             "\":{\"a\":1}}}",
+             TEST_SWITCH_ID);
+    test_mqtt("/switch/cmd/root", s_button_types);
+    test_send(TEST_RELAY2_ID, MSG_TYPE_TYPE_INFO, "R", 1);
+    test_send(TEST_RELAY2_ID, MSG_TYPE_RELAY_STATE, "A1", 2);
+    test_drain();
+
+    const char info[2] = {DEVICE_TYPE_RELAY, ROOT_ROLE_STANDBY};
+    test_send(TEST_RELAY_ID, MSG_TYPE_TYPE_INFO, info, 2);
+    CHECK_EQ(root_registry_role(TEST_RELAY_ID), ROOT_ROLE_STANDBY);
+    seen_reset();
+    int ticks = 0;  // 1 ms steps that queued frames, one tick at most each
+    for (int ms = 0; ms < 10 * REPLICA_POLL_MS; ms++) {
+        int before = s_seen.frames;
+        host_run_for_ms(1);
+        collect(TEST_RELAY_ID);
+        CHECK(s_seen.frames - before <= REPLICA_FRAMES_PER_POLL);
+        if (s_seen.frames > before) ticks++;
+    }
+    CHECK(ticks > 1);
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    collect(TEST_RELAY_ID);
+    CHECK(s_seen.frames > REPLICA_FRAMES_PER_POLL);
+    CHECK_EQ(s_seen.misaddressed, 0);
+
+    const replica_node_t* standby = seen_node(TEST_RELAY_ID);
+    const replica_node_t* relay2 = seen_node(TEST_RELAY2_ID);
+    CHECK(standby != NULL && standby->role == ROOT_ROLE_STANDBY);
+    CHECK(relay2 != NULL && relay2->type == DEVICE_TYPE_RELAY &&
+          relay2->role == ROOT_ROLE_NONE);
+    if (relay2) {
+        mesh_addr_t addr;
+        host_id_to_addr(TEST_RELAY2_ID, &addr);
+        CHECK(memcmp(relay2->mesh_addr, addr.addr, 6) == 0);
+    }
+    CHECK(seen_config(REPLICA_CFG_CONNECTIONS, s_connections));
+    CHECK(seen_config(REPLICA_CFG_BUTTON_TYPES, s_button_types));
+    CHECK_EQ(s_seen.config_len[REPLICA_CFG_BLIND_PAIRS], 0);
+    CHECK_EQ(s_seen.output_count, 1);
+    CHECK_EQ(s_seen.outputs[0].device_id, TEST_RELAY2_ID);
+    CHECK_EQ(s_seen.outputs[0].known, 0x1);
+    CHECK_EQ(s_seen.outputs[0].on, 0x1);
+
+    standby_status_t st;
+    standby_get_status(&st);
+    CHECK_EQ(st.target_id, TEST_RELAY_ID);
+    CHECK(st.target_synced);
+    CHECK(!host_mesh_pop_waive(NULL));  // not before ROOT_HANDOVER_DELAY_MS
+}
+
+static void test_updates(void) {
+    TEST_CASE("a change wakes the standby task");
+    seen_reset();
+    test_send(TEST_RELAY2_ID, MSG_TYPE_RELAY_STATE, "B1", 2);
+    collect(TEST_RELAY_ID);
+    CHECK_EQ(s_seen.output_count, 1);
+    CHECK_EQ(s_seen.outputs[0].known, 0x3);
+    CHECK_EQ(s_seen.outputs[0].on, 0x3);
+
+    test_send(TEST_RELAY2_ID, MSG_TYPE_RELAY_STATE, "B1", 2);
+    host_run_for_ms(REPLICA_POLL_MS);
+    seen_reset();
+    collect(TEST_RELAY_ID);
+    CHECK_EQ(s_seen.frames, 0);
+
+    char json[128];
+    snprintf(json, sizeof(json),
+             "{\"type\":\"blind_pairs\",\"data\":{\"%" PRIu64
+             "\":[[\"A\",\"B\"]]}}",
+             TEST_RELAY2_ID);
+    test_mqtt("/switch/cmd/root", json);
+    host_run_for_ms(REPLICA_POLL_MS);
+    collect(TEST_RELAY_ID);
+    CHECK(seen_config(REPLICA_CFG_BLIND_PAIRS, json));
+
+    TEST_CASE("routing commands pushed to nodes are not replicated");
+    test_mqtt("/switch/cmd/root", "{\"type\":\"auto_off\",\"data\":{}}");
+    host_run_for_ms(REPLICA_POLL_MS);
+    seen_reset();
+    collect(TEST_RELAY_ID);
+    CHECK_EQ(s_seen.frames, 0);
+}
+
+static void test_handover(void) {
+    TEST_CASE("a preferred root keeps the root");
+    test_mqtt("/switch/cmd/root",
+              "{\"type\":\"root_role\",\"role\":\"preferred\"}");
+    CHECK_EQ(standby_role(), ROOT_ROLE_PREFERRED);
+    host_run_for_ms(ROOT_HANDOVER_DELAY_MS + STATUS_REPORT_INTERVAL_MS);
+    CHECK(!host_mesh_pop_waive(NULL));
+
+    TEST_CASE("a plain root hands over to its standby once in sync");
+    test_mqtt("/switch/cmd/root", "{\"type\":\"root_role\",\"role\":\"none\"}");
+    host_run_for_ms(STATUS_REPORT_INTERVAL_MS);
+    mesh_vote_t vote;
+    CHECK(host_mesh_pop_waive(&vote));
+    CHECK(vote.is_rc_specified);
+    CHECK_EQ(test_addr_to_id(&vote.config.rc_addr), TEST_RELAY_ID);
+
+    TEST_CASE("no second attempt before ROOT_HANDOVER_RETRY_MS");
+    host_run_for_ms(2 * STATUS_REPORT_INTERVAL_MS);
+    CHECK(!host_mesh_pop_waive(NULL));
+    host_run_for_ms(ROOT_HANDOVER_RETRY_MS);
+    CHECK(host_mesh_pop_waive(NULL));
+}
+
+void suite_standby(void) {
+    test_boot_root();
+    test_role_command();
+    test_snapshot();
+    test_updates();
+    test_handover();
+}
+
+// ====================
+// Node
+// ====================
+
+static char s_replicated[128];
+
+static void send_replica(uint8_t op, const void* body, int len) {
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, TEST_ROOT_ID, MSG_TYPE_REPLICA, NULL, 0);
+    msg.data[0] = op;
+    memcpy(&msg.data[1], body, len);
+    msg.data_len = 1 + len;
+    test_inject(TEST_ROOT_ID, &msg);
+    host_run_for_ms(50);
+}
+
+static void send_chunk(const char* json, uint16_t offset, uint16_t len) {
+    uint8_t body[sizeof(replica_config_hdr_t) + MESH_MSG_DATA_SIZE];
+    replica_config_hdr_t hdr = {
+        .kind = REPLICA_CFG_CONNECTIONS,
+        .total = (uint16_t)strlen(json),
+        .offset = offset,
+    };
+    memcpy(body, &hdr, sizeof(hdr));
+    memcpy(body + sizeof(hdr), json + offset, len);
+    send_replica(REPLICA_OP_CONFIG, body, sizeof(hdr) + len);
+}
+
+static void test_no_role(void) {
+    TEST_CASE("a node without a role keeps no replica");
+    replica_node_t node = {.device_id = TEST_SWITCH_ID,
+                           .type = DEVICE_TYPE_SWITCH};
+    uint8_t body[1 + sizeof(node)] = {1};
+    memcpy(&body[1], &node, sizeof(node));
+    send_replica(REPLICA_OP_REGISTRY, body, sizeof(body));
+    standby_status_t st;
+    standby_get_status(&st);
+    CHECK_EQ(st.role, ROOT_ROLE_NONE);
+    CHECK_EQ(st.nodes, 0);
+}
+
+static void test_role(void) {
+    TEST_CASE("a role from the root is stored and announced");
+    char cfg[2] = {CONFIG_KEY_ROOT_ROLE, ROOT_ROLE_STANDBY};
+    test_send(TEST_ROOT_ID, MSG_TYPE_CONFIG, cfg, 2);
+    CHECK_EQ(standby_role(), ROOT_ROLE_STANDBY);
+    nvs_handle_t nvs;
+    uint8_t stored = 0;
+    CHECK_EQ(nvs_open("domator", NVS_READONLY, &nvs), ESP_OK);
+    CHECK_EQ(nvs_get_u8(nvs, "root_role", &stored), ESP_OK);
+    nvs_close(nvs);
+    CHECK_EQ(stored, ROOT_ROLE_STANDBY);
+
+    mesh_app_msg_t msg;
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_TYPE_INFO, &msg, &to));
+    CHECK_EQ(test_addr_to_id(&to), 0);
+    CHECK_EQ(msg.data_len, 2);
+    CHECK_EQ(msg.data[0], DEVICE_TYPE_RELAY);
+    CHECK_EQ(msg.data[1], ROOT_ROLE_STANDBY);
+
+    TEST_CASE("an invalid role is ignored");
+    cfg[1] = 7;
+    test_send(TEST_ROOT_ID, MSG_TYPE_CONFIG, cfg, 2);
+    CHECK_EQ(standby_role(), ROOT_ROLE_STANDBY);
+}
+
+static void test_replica(void) {
+    TEST_CASE("registry and outputs are merged");
+    uint8_t body[1 + 2 * sizeof(replica_node_t)];
+    replica_node_t nodes[2] = {
+        {.device_id = TEST_SWITCH_ID, .type = DEVICE_TYPE_SWITCH},
+        {.device_id = TEST_RELAY2_ID, .type = DEVICE_TYPE_RELAY},
+    };
+    for (int i = 0; i < 2; i++) {
+        mesh_addr_t addr;
+        host_id_to_addr(nodes[i].device_id, &addr);
+        memcpy(nodes[i].mesh_addr, addr.addr, 6);
+    }
+    body[0] = 2;
+    memcpy(&body[1], nodes, sizeof(nodes));
+    send_replica(REPLICA_OP_REGISTRY, body, sizeof(body));
+    send_replica(REPLICA_OP_REGISTRY, body, sizeof(body));
+
+    uint8_t out_body[1 + sizeof(replica_output_t)];
+    replica_output_t out = {
+        .device_id = TEST_RELAY2_ID, .known = 0x5, .on = 0x4};
+    out_body[0] = 1;
+    memcpy(&out_body[1], &out, sizeof(out));
+    send_replica(REPLICA_OP_OUTPUTS, out_body, sizeof(out_body));
+
+    standby_status_t st;
+    standby_get_status(&st);
+    CHECK_EQ(st.nodes, 2);
+    CHECK_EQ(st.outputs, 1);
+    CHECK_EQ(st.configs, 0);
+
+    TEST_CASE("a configuration missing a chunk is dropped");
+    snprintf(s_replicated, sizeof(s_replicated),
+             "{\"type\":\"connections\",\"data\":{\"%" PRIu64 "\":{"
+             "\"a\":[[%" PRIu64 ",\"c\"]]}}}",
+             TEST_SWITCH_ID, TEST_RELAY2_ID);
+    uint16_t total = (uint16_t)strlen(s_replicated);
+    send_chunk(s_replicated, 0, 20);
+    send_chunk(s_replicated, 30, total - 30);
+    standby_get_status(&st);
+    CHECK_EQ(st.configs, 0);
+
+    TEST_CASE("a configuration is kept once complete");
+    send_chunk(s_replicated, 0, 20);
+    standby_get_status(&st);
+    CHECK_EQ(st.configs, 0);
+    send_chunk(s_replicated, 20, total - 20);
+    standby_get_status(&st);
+    CHECK_EQ(st.configs, 1);
+}
+
+static void test_takeover(void) {
+    TEST_CASE("elected root: replica applied before MQTT is up");
+    host_node_t node = {
+        .mac = {0x02, 0x00, 0x00, 0x00, 0x00, 0xB1},
+        .is_root = true,
+        .layer = 1,
+        .rssi = -50,
+        .total_nodes = 3,
+    };
+    host_node_config(&node);
+    CHECK_EQ(esp_mesh_disconnect(), ESP_OK);
+    CHECK(host_run_until(mqtt_up, NULL, 10, 5000));
+    CHECK(g_is_root);
+    failover_stamp_t config = failover_stamp(FAILOVER_EV_CONFIG);
+    CHECK(config.at_ms != 0);
+    CHECK(config.at_ms <= failover_stamp(FAILOVER_EV_MQTT).at_ms);
+    CHECK_EQ(root_registry_type(TEST_RELAY2_ID), DEVICE_TYPE_RELAY);
+
+    TEST_CASE("cached outputs are published once MQTT is up");
+    char topic[128];
+    char data[64];
+    char expected[64];
+    snprintf(expected, sizeof(expected), "/relay/state/%" PRIu64,
+             TEST_RELAY2_ID);
+    CHECK(test_pop_publish("/relay/state/", topic, sizeof(topic), data,
+                           sizeof(data)));
+    CHECK_STR(topic, expected);
+    CHECK_STR(data, "A0");
+    CHECK(test_pop_publish("/relay/state/", topic, sizeof(topic), data,
+                           sizeof(data)));
+    CHECK_STR(data, "C1");
+    CHECK(!test_pop_publish("/relay/state/", NULL, 0, NULL, 0));
+
+    TEST_CASE("routes work before the relay or the backend says anything");
+    test_drain();
+    test_send(TEST_SWITCH_ID, MSG_TYPE_BUTTON, "a0", 2);
+    mesh_addr_t to;
+    CHECK(test_pop_frame(MSG_TYPE_COMMAND, NULL, &to));
+    CHECK_EQ(test_addr_to_id(&to), TEST_RELAY2_ID);
+
+    standby_status_t st;
+    standby_get_status(&st);
+    CHECK_EQ(st.nodes, 0);
+    CHECK_EQ(st.configs, 1);  // kept as this root's own copy
+}
+
+void suite_standby_node(void) {
+    test_boot_node(1);
+    test_no_role();
+    test_role();
+    test_replica();
+    test_takeover();
+}
@@ -0,0 +1,140 @@
+/**
+ * @file test_txqueue.c
+ * @brief TX scheduling in mesh_comm.c: high priority jumps the queue, a full
+ *        queue drops and counts, the TX task paces frames, and send errors
+ *        land in their counters.
+ */
+
+#include "test.h"
+
+#define TX_QUEUE_DEPTH 40
+
+typedef struct {
+    int count;
+    uint32_t seq[64];
+    uint64_t at_us[64];
+    esp_err_t result;
+} capture_t;
+
+static esp_err_t capture_commands(const mesh_addr_t* to, const uint8_t* data,
+                                  size_t len, int flag, void* ctx) {
+    (void)to;
+    (void)flag;
+    capture_t* cap = ctx;
+    const mesh_app_msg_t* msg = (const mesh_app_msg_t*)data;
+    if (len != sizeof(*msg) || msg->msg_type != MSG_TYPE_COMMAND) {
+        return ESP_OK;
+    }
+    if (cap->count < 64) {
+        cap->seq[cap->count] = msg->data_seq;
+        cap->at_us[cap->count] = host_now_us();
+    }
+    cap->count++;
+    return cap->result;
+}
+
+static bool queue(uint32_t seq, tx_priority_t prio) {
+    mesh_app_msg_t msg;
+    test_make_msg(&msg, g_device_id, MSG_TYPE_COMMAND, "a", 1);
+    msg.data_seq = seq;
+    mesh_addr_t dest;
+    host_id_to_addr(TEST_RELAY_ID, &dest);
+    return mesh_queue_to_node(&msg, prio, &dest);
+}
+
+/** @brief Park the TX task in its OTA pause so the queue only fills. */
+static void stall_tx(void) {
+    g_ota_in_progress = true;
+    host_run_for_ms(6000);
+}
+
+static void release_tx(void) {
+    g_ota_in_progress = false;
+    host_run_for_ms(2000);
+}
+
+static void test_priority(void) {
+    TEST_CASE("high priority goes to the front");
+    capture_t cap = {.result = ESP_OK};
+    host_mesh_set_tx_hook(capture_commands, &cap);
+
+    stall_tx();
+    for (uint32_t i = 1; i <= 3; i++) CHECK(queue(i, TX_PRIO_NORMAL));
+    CHECK(queue(100, TX_PRIO_HIGH));
+    CHECK_EQ(mesh_tx_queue_depth(), 4);
+    release_tx();
+
+    CHECK_EQ(cap.count, 4);
+    CHECK_EQ(cap.seq[0], 100);
+    CHECK_EQ(cap.seq[1], 1);
+    CHECK_EQ(cap.seq[2], 2);
+    CHECK_EQ(cap.seq[3], 3);
+    host_mesh_set_tx_hook(NULL, NULL);
+}
+
+static void test_overflow(void) {
+    TEST_CASE("a full queue drops and counts");
+    capture_t cap = {.result = ESP_OK};
+    host_mesh_set_tx_hook(capture_commands, &cap);
+    uint32_t normal = counter_get(CNT_DROP_TX_NORMAL);
+    uint32_t high = counter_get(CNT_DROP_TX_HIGH);
+
+    stall_tx();
+    int accepted = 0;
+    for (uint32_t i = 0; i < TX_QUEUE_DEPTH + 5; i++) {
+        accepted += queue(i, TX_PRIO_NORMAL);
+    }
+    CHECK_EQ(accepted, TX_QUEUE_DEPTH);
+    CHECK(!queue(1000, TX_PRIO_HIGH));
+    CHECK_EQ(counter_get(CNT_DROP_TX_NORMAL), normal + 5);
+    CHECK_EQ(counter_get(CNT_DROP_TX_HIGH), high + 1);
+    release_tx();
+
+    CHECK_EQ(cap.count, TX_QUEUE_DEPTH);
+    CHECK_EQ(mesh_tx_queue_depth(), 0);
+    host_mesh_set_tx_hook(NULL, NULL);
+}
+
+static void test_pacing(void) {
+    TEST_CASE("the TX task spaces frames by its pacing delay");
+    capture_t cap = {.result = ESP_OK};
+    host_mesh_set_tx_hook(capture_commands, &cap);
+
+    stall_tx();
+    for (uint32_t i = 0; i < 10; i++) CHECK(queue(i, TX_PRIO_NORMAL));
+    release_tx();
+
+    CHECK_EQ(cap.count, 10);
+    for (int i = 1; i < 10 && i < cap.count; i++) {
+        CHECK(cap.at_us[i] - cap.at_us[i - 1] >= 2000);
+        CHECK_EQ(cap.seq[i], i);
+    }
+    host_mesh_set_tx_hook(NULL, NULL);
+}
+
+static void test_send_errors(void) {
+    TEST_CASE("send errors are counted by class");
+    capture_t cap = {.result = ESP_ERR_MESH_NO_ROUTE_FOUND};
+    host_mesh_set_tx_hook(capture_commands, &cap);
+    uint32_t no_route = counter_get(CNT_ERR_NO_ROUTE);
+    uint32_t failed = counter_get(CNT_MESH_SEND_FAILED);
+    uint32_t ok = counter_get(CNT_MESH_SEND_OK);
+
+    CHECK(queue(1, TX_PRIO_NORMAL));
+    CHECK(queue(2, TX_PRIO_NORMAL));
+    host_run_for_ms(100);
+
+    CHECK_EQ(cap.count, 2);
+    CHECK_EQ(counter_get(CNT_ERR_NO_ROUTE), no_route + 2);
+    CHECK_EQ(counter_get(CNT_MESH_SEND_FAILED), failed + 2);
+    CHECK_EQ(counter_get(CNT_MESH_SEND_OK), ok);
+    host_mesh_set_tx_hook(NULL, NULL);
+}
+
+void suite_txqueue(void) {
+    test_boot_root();
+    test_priority();
+    test_overflow();
+    test_pacing();
+    test_send_errors();
+}
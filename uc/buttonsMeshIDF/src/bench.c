@@ -0,0 +1,625 @@
+/**
+ * @file bench.c
+ * @brief Benchmark mode: synthetic button load from switch nodes, measured
+ *        at the root.
+ *
+ * The "bench" root command picks switch nodes and sends each a
+ * BENCH_OP_START.  A switch then runs bench_gen_task(), which emits press
+ * and release MSG_TYPE_BUTTON frames at the requested rate and pattern,
+ * tagged with the run, a sequence number and the mesh time they were made.
+ * The root routes them through the normal button-type and connections
+ * lookups; the commands it sends keep the tag, so a relay answers each with
+ * BENCH_OP_APPLIED.  In a dry run (the default) the relay answers without
+ * touching its outputs.  When the time is up every switch sends its totals
+ * (BENCH_OP_DONE) and the root publishes one report on
+ * /switch/bench/<root id>:
+ *
+ *  - frames:   generated by the switches, delivered to the root, lost.
+ *  - commands: routed by the root, applied by relays, lost.
+ *  - uplinkUs: switch press to root (needs the mesh clock synced).
+ *  - applyUs:  switch press to relay handling it.
+ *
+ * Latencies go into lat_hist_t histograms (percentiles within 25 %; min,
+ * mean and max are exact).
+ *
+ * Start:  {"type":"bench","rate":5,"duration":30,"pattern":"poisson"}
+ *         optional "switches":[ids] (default: every registered switch),
+ *         "burst":5, "buttons":1, "dryRun":false.
+ * Stop:   {"type":"bench","stop":true}
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+
+static const char* TAG = "BENCH";
+
+#define BENCH_POLL_MS 100
+
+// ====================
+// Tags
+// ====================
+
+bool bench_tag_get(const mesh_app_msg_t* msg, bench_tag_t* tag) {
+    if (msg->data_len > MESH_MSG_DATA_SIZE) return false;
+    size_t at = strnlen(msg->data, msg->data_len) + 1;
+    if (msg->data_len != at + sizeof(bench_tag_t)) return false;
+
+    memcpy(tag, &msg->data[at], sizeof(bench_tag_t));
+    return tag->magic == BENCH_TAG_MAGIC;
+}
+
+void bench_tag_put(mesh_app_msg_t* msg, const bench_tag_t* tag) {
+    size_t at = msg->data_len + 1;
+    msg->data[msg->data_len] = '\0';
+    memcpy(&msg->data[at], tag, sizeof(bench_tag_t));
+    msg->data_len = at + sizeof(bench_tag_t);
+}
+
+// ====================
+// Switch: Load Generator
+// ====================
+
+static portMUX_TYPE s_gen_lock = portMUX_INITIALIZER_UNLOCKED;
+static bench_params_t s_gen_params;  // next run, under s_gen_lock
+static bool s_gen_pending = false;    // s_gen_params not started yet
+static bool s_gen_running = false;    // generator task alive
+static volatile bool s_gen_stop = false;
+
+/** @brief xorshift32; seeded per switch and run, so runs repeat exactly. */
+static uint32_t bench_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/** @brief Gap in µs between press number @p n and the next one. */
+static int64_t bench_next_gap(const bench_params_t* p, uint32_t n,
+                              uint32_t* rng) {
+    switch (p->pattern) {
+        case BENCH_PATTERN_POISSON: {
+            // Uniform in (0, 1], then the inverse CDF of the exponential.
+            float u = ((bench_random(rng) >> 8) + 1) / 16777216.0f;
+            return (int64_t)(-logf(u) * p->interval_us);
+        }
+        case BENCH_PATTERN_BURST:
+            if (n % p->burst != 0) return 0;
+            return (int64_t)p->interval_us * p->burst;
+        default:
+            return p->interval_us;
+    }
+}
+
+/** @brief Queue one tagged press or release frame to the root. */
+static bool bench_send_frame(const bench_params_t* p, char button,
+                             bool pressed, uint32_t seq) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_BUTTON;
+    msg.data[0] = button;
+    msg.data[1] = pressed ? '1' : '0';
+    if (pressed) {
+        msg.data_len = 2;
+    } else {
+        msg.data[2] = '0';  // short press
+        msg.data_len = 3;
+    }
+
+    bench_tag_t tag = {
+        .magic = BENCH_TAG_MAGIC,
+        .flags = p->flags,
+        .run_id = p->run_id,
+        .seq = seq,
+        .gen_us = mesh_time_now_us(),
+    };
+    bench_tag_put(&msg, &tag);
+    return mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+}
+
+/**
+ * @brief One benchmark run on a switch.  Presses are paced against absolute
+ *        deadlines, so a late wake-up is caught up on and the mean rate
+ *        holds at any tick rate.
+ */
+static void bench_run(bench_params_t p) {
+    uint32_t rng = (uint32_t)g_device_id ^ p.run_id;
+    if (rng == 0) rng = 1;
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)p.duration_ms * 1000;
+    int64_t next_us = start_us;
+    uint32_t presses = 0, frames = 0, queue_full = 0;
+
+    ESP_LOGI(TAG, "Run %" PRIu32 ": %" PRIu32 " us mean gap for %" PRIu32
+             " ms", p.run_id, p.interval_us, p.duration_ms);
+
+    while (!s_gen_stop && !g_ota_in_progress) {
+        int64_t now_us = esp_timer_get_time();
+        if (now_us >= end_us) break;
+        if (now_us < next_us) {
+            TickType_t wait = pdMS_TO_TICKS((next_us - now_us + 999) / 1000);
+            vTaskDelay(wait ? wait : 1);
+            continue;
+        }
+
+        char button = 'a' + presses % p.buttons;
+        for (int pressed = 1; pressed >= 0; pressed--) {
+            if (!bench_send_frame(&p, button, pressed, frames)) queue_full++;
+            frames++;
+        }
+        presses++;
+        next_us += bench_next_gap(&p, presses, &rng);
+    }
+
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_BENCH;
+    msg.data[0] = BENCH_OP_DONE;
+    bench_done_t done = {
+        .run_id = p.run_id,
+        .frames = frames,
+        .queue_full = queue_full,
+    };
+    memcpy(&msg.data[1], &done, sizeof(done));
+    msg.data_len = 1 + sizeof(done);
+    mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+
+    ESP_LOGI(TAG, "Run %" PRIu32 " done: %" PRIu32 " frames, %" PRIu32
+             " refused by the TX queue", p.run_id, frames, queue_full);
+}
+
+/**
+ * @brief FreeRTOS task: runs the pending run, then any run started while it
+ *        was going, and exits when none is left.
+ */
+static void bench_gen_task(void* arg) {
+    while (true) {
+        taskENTER_CRITICAL(&s_gen_lock);
+        bool pending = s_gen_pending;
+        bench_params_t p = s_gen_params;
+        s_gen_pending = false;
+        if (pending) {
+            s_gen_stop = false;
+        } else {
+            s_gen_running = false;
+        }
+        taskEXIT_CRITICAL(&s_gen_lock);
+        if (!pending) break;
+        bench_run(p);
+    }
+    vTaskDelete(NULL);
+}
+
+void bench_switch_handle(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 1) return;
+
+    if (msg->data[0] == BENCH_OP_STOP) {
+        s_gen_stop = true;
+        return;
+    }
+    if (msg->data[0] != BENCH_OP_START ||
+        msg->data_len < 1 + sizeof(bench_params_t)) {
+        ESP_LOGW(TAG, "Unknown bench op '%c'", msg->data[0]);
+        return;
+    }
+
+    bench_params_t params;
+    memcpy(&params, &msg->data[1], sizeof(params));
+    if (params.interval_us == 0 || params.buttons == 0 || params.burst == 0) {
+        ESP_LOGW(TAG, "Invalid bench parameters");
+        return;
+    }
+
+    // A new run replaces the current one, which still reports its totals;
+    // the generator task starts it once that one has stopped.
+    taskENTER_CRITICAL(&s_gen_lock);
+    s_gen_params = params;
+    s_gen_pending = true;
+    bool running = s_gen_running;
+    s_gen_running = true;
+    if (running) s_gen_stop = true;
+    taskEXIT_CRITICAL(&s_gen_lock);
+    if (running) return;
+
+    if (xTaskCreate(bench_gen_task, "bench_gen", 3072, NULL, 3, NULL) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to start the bench generator");
+        taskENTER_CRITICAL(&s_gen_lock);
+        s_gen_pending = false;
+        s_gen_running = false;
+        taskEXIT_CRITICAL(&s_gen_lock);
+    }
+}
+
+// ====================
+// Relay: Applied Reports
+// ====================
+
+void bench_relay_applied(const bench_tag_t* tag) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_BENCH;
+    msg.data[0] = BENCH_OP_APPLIED;
+    bench_applied_t applied = {
+        .tag = *tag,
+        .applied_us = mesh_time_now_us(),
+    };
+    memcpy(&msg.data[1], &applied, sizeof(applied));
+    msg.data_len = 1 + sizeof(applied);
+    mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+}
+
+// ====================
+// Root: Run State
+// ====================
+
+/** Per-switch totals of the current run. */
+typedef struct {
+    uint64_t device_id;
+    mesh_addr_t addr;
+    bool done;
+    uint32_t frames;      // from BENCH_OP_DONE
+    uint32_t queue_full;  // from BENCH_OP_DONE
+    uint32_t delivered;   // tagged frames received
+} bench_node_t;
+
+typedef struct {
+    bench_params_t params;
+    float rate;
+    int64_t start_us;
+    int node_count;
+    int done_count;
+    bench_node_t nodes[MAX_NODES];
+    uint32_t routed;
+    uint32_t unroutable;  // target not registered or TX queue full
+    uint32_t applied;
+    uint32_t unsynced;    // samples dropped for want of mesh time
+    lat_hist_t uplink;
+    lat_hist_t apply;
+} bench_run_t;
+
+static bench_run_t s_run;
+static volatile bool s_running = false;
+static SemaphoreHandle_t s_run_mutex = NULL;
+
+static const char* const s_pattern_names[] = {"uniform", "poisson", "burst"};
+
+static bench_node_t* bench_find_node(uint64_t device_id) {
+    for (int i = 0; i < s_run.node_count; i++) {
+        if (s_run.nodes[i].device_id == device_id) return &s_run.nodes[i];
+    }
+    return NULL;
+}
+
+static bool bench_lock(void) {
+    return s_run_mutex != NULL &&
+           xSemaphoreTake(s_run_mutex, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+/** @brief Send BENCH_OP_START or BENCH_OP_STOP to every run participant. */
+static void bench_send_op(char op) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_BENCH;
+    msg.target_type = DEVICE_TYPE_SWITCH;
+    msg.data[0] = op;
+    msg.data_len = 1;
+    if (op == BENCH_OP_START) {
+        memcpy(&msg.data[1], &s_run.params, sizeof(bench_params_t));
+        msg.data_len += sizeof(bench_params_t);
+    }
+    for (int i = 0; i < s_run.node_count; i++) {
+        mesh_queue_to_node(&msg, TX_PRIO_HIGH, &s_run.nodes[i].addr);
+    }
+}
+
+bool bench_root_on_button(const mesh_app_msg_t* msg, bench_tag_t* tag) {
+    int64_t now_us = mesh_time_now_us();
+    if (!s_running || tag->run_id != s_run.params.run_id) return false;
+    if (!bench_lock()) return false;
+
+    bench_node_t* node = bench_find_node(msg->src_id);
+    if (node != NULL) {
+        node->delivered++;
+        if (tag->gen_us && now_us) {
+            lat_hist_add(&s_run.uplink, now_us - tag->gen_us);
+        } else {
+            s_run.unsynced++;
+        }
+        tag->flags = s_run.params.flags;
+    }
+    xSemaphoreGive(s_run_mutex);
+    return node != NULL;
+}
+
+void bench_root_on_command(bool queued) {
+    if (!bench_lock()) return;
+    if (queued) {
+        s_run.routed++;
+    } else {
+        s_run.unroutable++;
+    }
+    xSemaphoreGive(s_run_mutex);
+}
+
+void bench_root_handle(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 1 || !s_running) return;
+
+    if (msg->data[0] == BENCH_OP_DONE &&
+        msg->data_len >= 1 + sizeof(bench_done_t)) {
+        bench_done_t done;
+        memcpy(&done, &msg->data[1], sizeof(done));
+        if (done.run_id != s_run.params.run_id || !bench_lock()) return;
+
+        bench_node_t* node = bench_find_node(msg->src_id);
+        if (node != NULL && !node->done) {
+            node->done = true;
+            node->frames = done.frames;
+            node->queue_full = done.queue_full;
+            s_run.done_count++;
+        }
+        xSemaphoreGive(s_run_mutex);
+    } else if (msg->data[0] == BENCH_OP_APPLIED &&
+               msg->data_len >= 1 + sizeof(bench_applied_t)) {
+        bench_applied_t applied;
+        memcpy(&applied, &msg->data[1], sizeof(applied));
+        if (applied.tag.run_id != s_run.params.run_id || !bench_lock()) {
+            return;
+        }
+
+        s_run.applied++;
+        if (applied.tag.gen_us && applied.applied_us) {
+            lat_hist_add(&s_run.apply,
+                         applied.applied_us - applied.tag.gen_us);
+        } else {
+            s_run.unsynced++;
+        }
+        xSemaphoreGive(s_run_mutex);
+    }
+}
+
+// ====================
+// Root: Report
+// ====================
+
+static void bench_publish_report(const bench_run_t* run, int64_t elapsed_us) {
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+
+    uint32_t frames = 0, delivered = 0, queue_full = 0;
+    for (int i = 0; i < run->node_count; i++) {
+        frames += run->nodes[i].frames;
+        delivered += run->nodes[i].delivered;
+        queue_full += run->nodes[i].queue_full;
+    }
+
+    cJSON_AddNumberToObject(json, "run", run->params.run_id);
+    cJSON_AddBoolToObject(json, "dryRun",
+                          run->params.flags & BENCH_FLAG_DRY_RUN);
+    cJSON_AddStringToObject(json, "pattern",
+                            s_pattern_names[run->params.pattern]);
+    cJSON_AddNumberToObject(json, "rate", run->rate);
+    cJSON_AddNumberToObject(json, "durationMs", run->params.duration_ms);
+    cJSON_AddNumberToObject(json, "elapsedMs", elapsed_us / 1000);
+    cJSON_AddNumberToObject(json, "switches", run->node_count);
+    cJSON_AddNumberToObject(json, "reported", run->done_count);
+
+    cJSON* obj = cJSON_AddObjectToObject(json, "frames");
+    cJSON_AddNumberToObject(obj, "generated", frames);
+    cJSON_AddNumberToObject(obj, "delivered", delivered);
+    cJSON_AddNumberToObject(obj, "lost",
+                            frames > delivered ? frames - delivered : 0);
+    cJSON_AddNumberToObject(obj, "queueFull", queue_full);
+    cJSON_AddNumberToObject(obj, "perSec",
+                            elapsed_us ? delivered * 1e6 / elapsed_us : 0);
+
+    obj = cJSON_AddObjectToObject(json, "commands");
+    cJSON_AddNumberToObject(obj, "routed", run->routed);
+    cJSON_AddNumberToObject(obj, "unroutable", run->unroutable);
+    cJSON_AddNumberToObject(obj, "applied", run->applied);
+    cJSON_AddNumberToObject(
+        obj, "lost", run->routed > run->applied ? run->routed - run->applied
+                                                : 0);
+
+    lat_hist_add_json(json, "uplinkUs", &run->uplink);
+    lat_hist_add_json(json, "applyUs", &run->apply);
+    cJSON_AddNumberToObject(json, "unsynced", run->unsynced);
+
+    cJSON* nodes = cJSON_AddArrayToObject(json, "nodes");
+    for (int i = 0; i < run->node_count; i++) {
+        const bench_node_t* n = &run->nodes[i];
+        char id[24];
+        snprintf(id, sizeof(id), "%" PRIu64, n->device_id);
+        cJSON* node = cJSON_CreateObject();
+        cJSON_AddStringToObject(node, "id", id);
+        if (n->done) {
+            cJSON_AddNumberToObject(node, "generated", n->frames);
+        }
+        cJSON_AddNumberToObject(node, "delivered", n->delivered);
+        cJSON_AddItemToArray(nodes, node);
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise bench report");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/bench/%" PRIu64, g_device_id);
+    if (g_mqtt_connected) {
+        esp_mqtt_client_publish(g_mqtt_client, topic, json_str, 0, 0, 0);
+    }
+    cJSON_free(json_str);
+
+    ESP_LOGI(TAG,
+             "Run %" PRIu32 ": %" PRIu32 "/%" PRIu32 " frames delivered, %"
+             PRIu32 "/%" PRIu32 " commands applied, uplink p99 %" PRIu32
+             " us",
+             run->params.run_id, delivered, frames, run->applied,
+             run->routed, lat_hist_quantile(&run->uplink, 990));
+}
+
+/**
+ * @brief FreeRTOS task: wait for every switch to report (or for
+ *        BENCH_DONE_TIMEOUT_MS past the end), give the last commands
+ *        BENCH_SETTLE_MS to be applied, then publish the report.
+ */
+static void bench_root_task(void* arg) {
+    int64_t deadline_us = s_run.start_us +
+                          ((int64_t)s_run.params.duration_ms +
+                           BENCH_DONE_TIMEOUT_MS) * 1000;
+    while (s_run.done_count < s_run.node_count &&
+           esp_timer_get_time() < deadline_us) {
+        vTaskDelay(pdMS_TO_TICKS(BENCH_POLL_MS));
+    }
+    vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+
+    static bench_run_t snapshot;
+    if (!bench_lock()) {
+        ESP_LOGE(TAG, "bench_root_task: mutex timeout");
+        s_running = false;
+        vTaskDelete(NULL);
+        return;
+    }
+    snapshot = s_run;
+    s_running = false;
+    xSemaphoreGive(s_run_mutex);
+
+    bench_publish_report(&snapshot,
+                         esp_timer_get_time() - snapshot.start_us -
+                             (int64_t)BENCH_SETTLE_MS * 1000);
+    vTaskDelete(NULL);
+}
+
+// ====================
+// Root: Command
+// ====================
+
+/** @brief Number field of the command clamped to [lo, hi], or @p def. */
+static double bench_json_number(const cJSON* json, const char* key,
+                                double def, double lo, double hi) {
+    const cJSON* item = cJSON_GetObjectItem(json, key);
+    if (!cJSON_IsNumber(item)) return def;
+    double v = item->valuedouble;
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+/** @brief Add one switch to the run; false if it is not a known switch. */
+static bool bench_add_node(uint64_t device_id, const uint64_t* ids,
+                           const mesh_addr_t* addrs, int count) {
+    if (root_registry_type(device_id) != DEVICE_TYPE_SWITCH) return false;
+    for (int i = 0; i < count; i++) {
+        if (ids[i] != device_id) continue;
+        bench_node_t* node = &s_run.nodes[s_run.node_count++];
+        node->device_id = device_id;
+        node->addr = addrs[i];
+        return true;
+    }
+    return false;
+}
+
+void bench_root_command(const cJSON* json) {
+    if (s_run_mutex == NULL) {
+        s_run_mutex = xSemaphoreCreateMutex();
+        if (s_run_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create bench mutex");
+            return;
+        }
+    }
+
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "stop"))) {
+        if (s_running) {
+            ESP_LOGI(TAG, "Stopping run %" PRIu32, s_run.params.run_id);
+            bench_send_op(BENCH_OP_STOP);
+        }
+        return;
+    }
+    if (s_running) {
+        ESP_LOGW(TAG, "Run %" PRIu32 " still in progress",
+                 s_run.params.run_id);
+        return;
+    }
+
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+
+    memset(&s_run, 0, sizeof(s_run));
+    const cJSON* switches = cJSON_GetObjectItem(json, "switches");
+    if (cJSON_IsArray(switches)) {
+        const cJSON* item;
+        cJSON_ArrayForEach(item, switches) {
+            uint64_t id = 0;
+            if (cJSON_IsString(item)) {
+                id = strtoull(item->valuestring, NULL, 10);
+            } else if (cJSON_IsNumber(item)) {
+                id = (uint64_t)item->valuedouble;
+            }
+            if (bench_find_node(id) != NULL) continue;
+            if (!bench_add_node(id, ids, addrs, count)) {
+                ESP_LOGW(TAG, "%" PRIu64 " is not a registered switch", id);
+            }
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            bench_add_node(ids[i], ids, addrs, count);
+        }
+    }
+    if (s_run.node_count == 0) {
+        ESP_LOGW(TAG, "No switches to run the benchmark on");
+        return;
+    }
+
+    bench_params_t* p = &s_run.params;
+    s_run.rate = bench_json_number(json, "rate", 5, 0.1, BENCH_MAX_RATE);
+    p->interval_us = (uint32_t)(1e6 / s_run.rate);
+    p->duration_ms = (uint32_t)(bench_json_number(json, "duration", 10, 1,
+                                                  BENCH_MAX_DURATION_S) *
+                                1000);
+    p->burst = (uint8_t)bench_json_number(json, "burst", 5, 1, 50);
+    p->buttons = (uint8_t)bench_json_number(json, "buttons", 1, 1,
+                                            NUM_BUTTONS);
+    p->pattern = BENCH_PATTERN_UNIFORM;
+    const cJSON* pattern = cJSON_GetObjectItem(json, "pattern");
+    if (cJSON_IsString(pattern)) {
+        for (int i = 0; i < 3; i++) {
+            if (strcmp(pattern->valuestring, s_pattern_names[i]) == 0) {
+                p->pattern = i;
+            }
+        }
+    }
+    const cJSON* dry_run = cJSON_GetObjectItem(json, "dryRun");
+    p->flags = cJSON_IsFalse(dry_run) ? 0 : BENCH_FLAG_DRY_RUN;
+    p->run_id = (uint32_t)(esp_timer_get_time() / 1000) | 1;
+
+    s_run.start_us = esp_timer_get_time();
+    s_running = true;
+    bench_send_op(BENCH_OP_START);
+    ESP_LOGI(TAG,
+             "Run %" PRIu32 ": %d switch(es), %.1f presses/s each, %s, %"
+             PRIu32 " ms%s",
+             p->run_id, s_run.node_count, s_run.rate,
+             s_pattern_names[p->pattern], p->duration_ms,
+             (p->flags & BENCH_FLAG_DRY_RUN) ? ", dry run" : "");
+
+    if (xTaskCreate(bench_root_task, "bench", 4096, NULL, 2, NULL) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to start the bench task");
+        s_running = false;
+    }
+}
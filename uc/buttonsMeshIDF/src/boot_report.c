@@ -0,0 +1,121 @@
+/**
+ * @file boot_report.c
+ * @brief Boot-phase timeline and the once-per-boot boot report.
+ *
+ * boot_mark() stamps each boot_phase_t the first time it is reached with
+ * esp_timer_get_time() in milliseconds, i.e. time since the application
+ * started (ROM and bootloader time are not included).  The marks sit in
+ * app_main(), the mesh/IP event handlers, the MQTT handler, the config
+ * paths and, for BOOT_PHASE_FIRST_ROUTE, wherever a routed command completes
+ * on this node: a relay command sent by the root, a button message sent by a
+ * switch or a relay command applied by a relay board.
+ *
+ * Once the first route happened, or after BOOT_REPORT_TIMEOUT_MS if nobody
+ * pressed a button, boot_report_poll() sends the timeline to the root as
+ * MSG_TYPE_BOOT_REPORT.  The root publishes it on /switch/boot/<id> with the
+ * slowest phase named, so regressions in time-to-working-button show up per
+ * node and per reset reason.  A sent report also counts as the successful
+ * boot after which fast_boot.c caches the probed hardware type.
+ */
+
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "esp_system.h"
+
+static const char* TAG = "BOOT";
+
+static uint32_t s_at_ms[BOOT_PHASE_COUNT];
+static bool s_reported = false;
+
+/** @brief Record a phase; later calls for the same phase are ignored. */
+void boot_mark(boot_phase_t phase) {
+    if (phase >= BOOT_PHASE_COUNT) return;
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (now_ms == 0) now_ms = 1;  // 0 means "not reached"
+
+    uint32_t expected = 0;
+    if (__atomic_compare_exchange_n(&s_at_ms[phase], &expected, now_ms, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        ESP_LOGI(TAG, "Boot phase %s at %" PRIu32 " ms",
+                 boot_phase_name(phase), now_ms);
+    }
+}
+
+uint32_t boot_phase_ms(boot_phase_t phase) {
+    if (phase >= BOOT_PHASE_COUNT) return 0;
+    return __atomic_load_n(&s_at_ms[phase], __ATOMIC_RELAXED);
+}
+
+const char* boot_phase_name(boot_phase_t phase) {
+    switch (phase) {
+        case BOOT_PHASE_APP_START:
+            return "app";
+        case BOOT_PHASE_NVS:
+            return "nvs";
+        case BOOT_PHASE_HW_DETECT:
+            return "hw";
+        case BOOT_PHASE_RELAY_INIT:
+            return "relay";
+        case BOOT_PHASE_MESH_INIT:
+            return "meshInit";
+        case BOOT_PHASE_TASKS:
+            return "tasks";
+        case BOOT_PHASE_MESH_STARTED:
+            return "meshStart";
+        case BOOT_PHASE_PARENT:
+            return "parent";
+        case BOOT_PHASE_ROOT:
+            return "root";
+        case BOOT_PHASE_GOT_IP:
+            return "ip";
+        case BOOT_PHASE_MQTT:
+            return "mqtt";
+        case BOOT_PHASE_CONFIG:
+            return "config";
+        case BOOT_PHASE_FIRST_ROUTE:
+            return "firstRoute";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Send the timeline once per boot.  Waits for the first routed command
+ *        so the report carries the number the household notices, but gives
+ *        up waiting after BOOT_REPORT_TIMEOUT_MS.
+ */
+void boot_report_poll(void) {
+    if (s_reported) return;
+    if (g_is_root ? !g_mqtt_connected : !g_mesh_connected) return;
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (boot_phase_ms(BOOT_PHASE_FIRST_ROUTE) == 0 &&
+        now_ms < BOOT_REPORT_TIMEOUT_MS) {
+        return;
+    }
+
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_BOOT_REPORT;
+
+    boot_report_t report = {
+        .reset_reason = esp_reset_reason(),
+        .phase_count = BOOT_PHASE_COUNT,
+    };
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        report.at_ms[i] = boot_phase_ms(i);
+    }
+    memcpy(msg.data, &report, sizeof(report));
+    msg.data_len = sizeof(report);
+
+    if (g_is_root) {
+        root_handle_boot_report(&msg);
+    } else if (!mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL)) {
+        ESP_LOGW(TAG, "Boot report not queued, retrying later");
+        return;
+    }
+    s_reported = true;
+    fast_boot_save_hw();
+}
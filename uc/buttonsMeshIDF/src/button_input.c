@@ -0,0 +1,314 @@
+/**
+ * @file button_input.c
+ * @brief Shared ISR-timestamped button input for switch and relay boards.
+ *
+ * The GPIO ISR samples the pin level and esp_timer_get_time() at the moment
+ * of the edge and pushes (index, level, timestamp) into a lock-free
+ * single-producer / single-consumer ring, then wakes the owning task
+ * (button_task_handle).  The task drains the ring in order and runs an exact
+ * debounce state machine per button:
+ *
+ *  - The first edge that leaves the stable level opens a pending transition
+ *    and fixes its timestamp.
+ *  - Further edges (bounce) only move the last-edge time.
+ *  - Once the line has been quiet for BUTTON_DEBOUNCE_MS the transition is
+ *    confirmed if the level still differs from the stable one, and reported
+ *    with the timestamp of the first edge; otherwise it was a glitch.
+ *
+ * Press timing therefore reflects when the contact actually moved, not when
+ * the task got scheduled.  Two consecutive samples with the same level mean
+ * the opposite edge was lost (counted as a missed edge); a full ring drops
+ * the sample, counts an overflow, and forces a level resync.  Where the SoC
+ * has a pin glitch filter it is enabled in front of the ISR
+ * (CONFIG_DOMATOR_BUTTON_GLITCH_FILTER).
+ */
+
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "soc/soc_caps.h"
+
+#if SOC_GPIO_SUPPORT_PIN_GLITCH_FILTER
+#include "driver/gpio_filter.h"
+#endif
+
+static const char* TAG = "BUTTON_INPUT";
+
+#define BUTTON_RING_SIZE 64  // power of two
+#define BUTTON_EVENT_QUEUE_SIZE 16
+
+/** One raw edge sample captured by the ISR. */
+typedef struct {
+    uint8_t index;
+    uint8_t level;
+    int64_t time_us;
+} button_edge_t;
+
+/** Per-button debounce state, owned by the consuming task. */
+typedef struct {
+    uint8_t stable_level;
+    uint8_t raw_level;
+    bool pending;
+    int64_t first_edge_us;
+    int64_t last_edge_us;
+} button_debounce_t;
+
+// ISR → task ring: s_ring_head written only by the ISR, s_ring_tail only by
+// the task.
+static button_edge_t s_ring[BUTTON_RING_SIZE];
+static volatile uint32_t s_ring_head = 0;
+static volatile uint32_t s_ring_tail = 0;
+static volatile bool s_resync = false;
+// One writer each (ISR, button task): no read-modify-write race.
+static volatile uint32_t s_ring_overflows = 0;
+static uint32_t s_queue_overflows = 0;
+static volatile uint32_t s_missed_edges = 0;
+
+static const int* s_pins = NULL;
+static int s_count = 0;
+static button_debounce_t s_debounce[MAX_BUTTON_INPUTS];
+
+// Confirmed events not yet returned by button_input_get_event()
+static button_event_t s_events[BUTTON_EVENT_QUEUE_SIZE];
+static int s_events_head = 0;
+static int s_events_count = 0;
+
+// ====================
+// ISR
+// ====================
+
+/**
+ * @brief GPIO ISR: capture level and timestamp, push to the ring and wake
+ *        the button task.
+ * @param arg Button index cast to (void*).
+ */
+static void IRAM_ATTR button_input_isr_handler(void* arg) {
+    TRACE_ISR_ENTER(TRACE_ISR_BUTTON);
+    uint32_t index = (uint32_t)arg;
+    int64_t now_us = esp_timer_get_time();
+    uint8_t level = gpio_ll_get_level(&GPIO, s_pins[index]);
+
+    uint32_t head = s_ring_head;
+    uint32_t tail = __atomic_load_n(&s_ring_tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= BUTTON_RING_SIZE) {
+        s_ring_overflows++;
+        s_resync = true;
+    } else {
+        button_edge_t* slot = &s_ring[head & (BUTTON_RING_SIZE - 1)];
+        slot->index = index;
+        slot->level = level;
+        slot->time_us = now_us;
+        __atomic_store_n(&s_ring_head, head + 1, __ATOMIC_RELEASE);
+    }
+
+    if (button_task_handle == NULL) {  // task not started yet
+        TRACE_ISR_EXIT(TRACE_ISR_BUTTON);
+        return;
+    }
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(button_task_handle, &xHigherPriorityTaskWoken);
+    TRACE_ISR_EXIT(TRACE_ISR_BUTTON);
+    if (xHigherPriorityTaskWoken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// ====================
+// Initialization
+// ====================
+
+/**
+ * @brief Configure button GPIOs and install the timestamping ISR.
+ * @param pins  GPIO numbers, indexed by button number.
+ * @param count Number of buttons (≤ MAX_BUTTON_INPUTS).
+ */
+void button_input_init(const int* pins, int count) {
+    if (count > MAX_BUTTON_INPUTS) count = MAX_BUTTON_INPUTS;
+    s_pins = pins;
+    s_count = count;
+
+    for (int i = 0; i < count; i++) {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = (1ULL << pins[i]),
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_ENABLE,
+            .intr_type = GPIO_INTR_ANYEDGE,
+        };
+        gpio_config(&io_conf);
+
+#if SOC_GPIO_SUPPORT_PIN_GLITCH_FILTER && CONFIG_DOMATOR_BUTTON_GLITCH_FILTER
+        gpio_pin_glitch_filter_config_t filter_conf = {
+            .clk_src = GLITCH_FILTER_CLK_SRC_DEFAULT,
+            .gpio_num = pins[i],
+        };
+        gpio_glitch_filter_handle_t filter = NULL;
+        if (gpio_new_pin_glitch_filter(&filter_conf, &filter) != ESP_OK ||
+            gpio_glitch_filter_enable(filter) != ESP_OK) {
+            ESP_LOGW(TAG, "Glitch filter unavailable on GPIO %d", pins[i]);
+        }
+#endif
+
+        uint8_t level = gpio_get_level(pins[i]);
+        s_debounce[i] = (button_debounce_t){
+            .stable_level = level,
+            .raw_level = level,
+            .pending = false,
+        };
+
+        ESP_LOGI(TAG, "Button %d initialized on GPIO %d", i, pins[i]);
+    }
+
+    ESP_ERROR_CHECK(gpio_install_isr_service(ESP_INTR_FLAG_IRAM));
+
+    for (int i = 0; i < count; i++) {
+        ESP_ERROR_CHECK(gpio_isr_handler_add(pins[i], button_input_isr_handler,
+                                             (void*)i));
+    }
+}
+
+// ====================
+// Debounce State Machine
+// ====================
+
+/** @brief Append a confirmed transition to the output queue. */
+static void emit_event(int index, uint8_t level, int64_t time_us) {
+    if (s_events_count == BUTTON_EVENT_QUEUE_SIZE) {
+        // Task fell far behind; drop the oldest so the newest state wins.
+        s_events_head = (s_events_head + 1) % BUTTON_EVENT_QUEUE_SIZE;
+        s_events_count--;
+        s_queue_overflows++;
+    }
+    int slot = (s_events_head + s_events_count) % BUTTON_EVENT_QUEUE_SIZE;
+    s_events[slot] = (button_event_t){
+        .index = index, .level = level, .time_us = time_us};
+    s_events_count++;
+}
+
+/** @brief Close a pending transition once the line has been quiet. */
+static void debounce_confirm(int index) {
+    button_debounce_t* b = &s_debounce[index];
+    b->pending = false;
+    if (b->raw_level != b->stable_level) {
+        b->stable_level = b->raw_level;
+        emit_event(index, b->stable_level, b->first_edge_us);
+    }
+}
+
+/** @brief Feed one edge sample into the button's state machine. */
+static void debounce_edge(int index, uint8_t level, int64_t time_us) {
+    button_debounce_t* b = &s_debounce[index];
+
+    if (b->pending && time_us - b->last_edge_us >= BUTTON_DEBOUNCE_MS * 1000) {
+        debounce_confirm(index);
+    }
+
+    if (level == b->raw_level) {
+        // The edge in between never made it into the ring.
+        s_missed_edges++;
+    }
+    b->raw_level = level;
+    b->last_edge_us = time_us;
+
+    if (!b->pending && level != b->stable_level) {
+        b->pending = true;
+        b->first_edge_us = time_us;
+    }
+}
+
+/**
+ * @brief Drain the ISR ring and confirm transitions whose quiet period has
+ *        elapsed.
+ * @return Microseconds until the next pending transition may be confirmed,
+ *         or -1 if nothing is pending.
+ */
+static int64_t button_input_process(void) {
+    uint32_t head = __atomic_load_n(&s_ring_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = s_ring_tail;
+
+    while (tail != head) {
+        button_edge_t edge = s_ring[tail & (BUTTON_RING_SIZE - 1)];
+        tail++;
+        __atomic_store_n(&s_ring_tail, tail, __ATOMIC_RELEASE);
+        if (edge.index < s_count) {
+            debounce_edge(edge.index, edge.level, edge.time_us);
+        }
+    }
+
+    int64_t now_us = esp_timer_get_time();
+
+    if (s_resync) {
+        // Samples were dropped: trust the pins over the stale raw levels.
+        s_resync = false;
+        for (int i = 0; i < s_count; i++) {
+            uint8_t level = gpio_get_level(s_pins[i]);
+            if (level != s_debounce[i].raw_level) {
+                debounce_edge(i, level, now_us);
+            }
+        }
+    }
+
+    int64_t next_us = -1;
+    for (int i = 0; i < s_count; i++) {
+        if (!s_debounce[i].pending) continue;
+
+        int64_t remaining =
+            s_debounce[i].last_edge_us + BUTTON_DEBOUNCE_MS * 1000 - now_us;
+        if (remaining <= 0) {
+            debounce_confirm(i);
+        } else if (next_us < 0 || remaining < next_us) {
+            next_us = remaining;
+        }
+    }
+    return next_us;
+}
+
+/**
+ * @brief Block until the next debounced button transition.
+ *
+ * Must be called from the task stored in button_task_handle, since the ISR
+ * wakes that task.
+ * @param ev       Filled with index, new level and first-edge timestamp.
+ * @param max_wait Maximum time to block.
+ * @return true if an event was returned, false on timeout.
+ */
+bool button_input_get_event(button_event_t* ev, TickType_t max_wait) {
+    TickType_t start = xTaskGetTickCount();
+
+    while (1) {
+        int64_t next_us = button_input_process();
+
+        if (s_events_count > 0) {
+            *ev = s_events[s_events_head];
+            s_events_head = (s_events_head + 1) % BUTTON_EVENT_QUEUE_SIZE;
+            s_events_count--;
+            return true;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (max_wait != portMAX_DELAY && elapsed >= max_wait) {
+            return false;
+        }
+
+        TickType_t wait =
+            (max_wait == portMAX_DELAY) ? portMAX_DELAY : max_wait - elapsed;
+        if (next_us >= 0) {
+            TickType_t debounce_wait = pdMS_TO_TICKS(next_us / 1000 + 1);
+            if (debounce_wait < wait) wait = debounce_wait;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/**
+ * @brief Read the input health counters.
+ * @param overflows    Ring or event-queue overflows since boot.
+ * @param missed_edges Edges inferred lost from repeated levels since boot.
+ */
+void button_input_get_stats(uint32_t* overflows, uint32_t* missed_edges) {
+    if (overflows) *overflows = s_ring_overflows + s_queue_overflows;
+    if (missed_edges) *missed_edges = s_missed_edges;
+}
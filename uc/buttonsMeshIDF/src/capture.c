@@ -0,0 +1,339 @@
+/**
+ * @file capture.c
+ * @brief Mesh and MQTT traffic capture streamed to a host over TCP
+ *        (CONFIG_DOMATOR_CAPTURE).
+ *
+ * capture_start() (called with telnet_start() when the node becomes root)
+ * launches capture_task(), which listens on CONFIG_DOMATOR_CAPTURE_PORT for
+ * a single host.  When one connects it gets a capture_file_hdr_t and from
+ * then on one record per event:
+ *  - MESH_RX   every frame mesh_rx_task() accepts, before dispatch;
+ *  - MESH_TX   every frame mesh_send_to_node() sent successfully;
+ *  - MQTT_IN   every MQTT_EVENT_DATA, before handle_mqtt_command();
+ *  - MQTT_OUT  every publish through root_mqtt_publish().
+ * The stream is the file: tools/mesh_capture.py saves it unchanged and
+ * domator_replay feeds it to the host build of the root.
+ *
+ * The hot paths only copy the record into a stream buffer under a short
+ * mutex and never touch the socket.  A record that does not fit is counted
+ * instead of blocking the caller, and the count goes out as a DROP record
+ * ahead of the next record that fits.  With no host connected each hook is
+ * a single flag check.
+ */
+
+#include "domator_mesh.h"
+
+#if CONFIG_DOMATOR_CAPTURE
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "freertos/stream_buffer.h"
+#include "lwip/sockets.h"
+
+static const char* TAG = "CAPTURE";
+
+#define CAPTURE_PORT CONFIG_DOMATOR_CAPTURE_PORT
+#define CAPTURE_BUF_SIZE CONFIG_DOMATOR_CAPTURE_BUFFER
+#define CAPTURE_SNAPLEN CONFIG_DOMATOR_CAPTURE_SNAPLEN
+#define CAPTURE_POLL_MS 100       // accept / drain / stop-request latency
+#define CAPTURE_SEND_TIMEOUT_S 2  // a host this slow is dropped
+#define CAPTURE_CHUNK 1024        // bytes moved to the socket per send
+
+_Static_assert(sizeof(capture_file_hdr_t) == 32,
+               "tools/mesh_capture.py reads a 32-byte file header");
+_Static_assert(sizeof(capture_rec_hdr_t) == 12,
+               "tools/mesh_capture.py reads 12-byte record headers");
+_Static_assert(CAPTURE_MSG_HDR_SIZE == 24,
+               "tools/mesh_capture.py decodes a 24-byte message header");
+
+static TaskHandle_t s_task = NULL;
+static StreamBufferHandle_t s_stream = NULL;
+static SemaphoreHandle_t s_write_mutex = NULL;
+static int s_listen_sock = -1;
+static int s_client_sock = -1;
+static volatile bool s_streaming = false;
+static volatile bool s_stop_requested = false;
+
+// Guarded by s_write_mutex.
+static int64_t s_start_us = 0;
+static uint32_t s_records = 0;
+static uint32_t s_dropped = 0;
+static uint32_t s_unreported = 0;  // drops not yet sent as a DROP record
+
+// ====================
+// Recording (any task)
+// ====================
+
+static void capture_write_header(capture_rec_kind_t kind, uint8_t flags,
+                                 size_t len) {
+    int64_t t = esp_timer_get_time() - s_start_us;
+    capture_rec_hdr_t hdr = {
+        .ts_sec = (uint32_t)(t / 1000000),
+        .ts_usec = (uint32_t)(t % 1000000),
+        .len = (uint16_t)len,
+        .kind = kind,
+        .flags = flags,
+    };
+    xStreamBufferSend(s_stream, &hdr, sizeof(hdr), 0);
+}
+
+/**
+ * @brief Append one record made of @p head and @p body, cutting @p body at
+ *        the snapshot length.  Never waits for buffer space.
+ */
+static void capture_put(capture_rec_kind_t kind, uint8_t flags,
+                        const void* head, size_t head_len, const void* body,
+                        size_t body_len) {
+    if (head_len + body_len > CAPTURE_SNAPLEN) {
+        body_len = CAPTURE_SNAPLEN - head_len;
+        flags |= CAPTURE_FLAG_TRUNCATED;
+    }
+    size_t need = sizeof(capture_rec_hdr_t) + head_len + body_len;
+
+    if (xSemaphoreTake(s_write_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (!s_streaming) {
+        xSemaphoreGive(s_write_mutex);
+        return;
+    }
+
+    size_t drop_len = sizeof(capture_rec_hdr_t) + sizeof(uint32_t);
+    size_t space = xStreamBufferSpacesAvailable(s_stream);
+    if (space < need + (s_unreported ? drop_len : 0)) {
+        s_unreported++;
+        s_dropped++;
+        xSemaphoreGive(s_write_mutex);
+        return;
+    }
+
+    if (s_unreported) {
+        capture_write_header(CAPTURE_REC_DROP, 0, sizeof(uint32_t));
+        xStreamBufferSend(s_stream, &s_unreported, sizeof(uint32_t), 0);
+        s_unreported = 0;
+    }
+    capture_write_header(kind, flags, head_len + body_len);
+    xStreamBufferSend(s_stream, head, head_len, 0);
+    if (body_len) xStreamBufferSend(s_stream, body, body_len, 0);
+    s_records++;
+    xSemaphoreGive(s_write_mutex);
+}
+
+void capture_mesh(capture_rec_kind_t kind, const mesh_addr_t* peer,
+                  const mesh_app_msg_t* msg) {
+    if (!s_streaming) return;
+
+    uint8_t head[6 + CAPTURE_MSG_HDR_SIZE];
+    if (peer) {
+        memcpy(head, peer->addr, 6);
+    } else {
+        memset(head, 0, 6);
+    }
+    memcpy(head + 6, msg, CAPTURE_MSG_HDR_SIZE);
+    size_t data_len = msg->data_len < MESH_MSG_DATA_SIZE ? msg->data_len
+                                                         : MESH_MSG_DATA_SIZE;
+    capture_put(kind, 0, head, sizeof(head), msg->data, data_len);
+}
+
+void capture_mqtt(capture_rec_kind_t kind, const char* topic, int topic_len,
+                  const char* data, int data_len, bool retain) {
+    if (!s_streaming) return;
+
+    if (topic_len < 0) topic_len = strlen(topic);
+    if (topic_len > UINT8_MAX) topic_len = UINT8_MAX;
+    if (data_len < 0) data_len = 0;
+
+    uint8_t head[1 + UINT8_MAX];
+    head[0] = (uint8_t)topic_len;
+    memcpy(head + 1, topic, topic_len);
+    capture_put(kind, retain ? CAPTURE_FLAG_RETAIN : 0, head, 1 + topic_len,
+                data, data_len);
+}
+
+bool capture_active(void) { return s_streaming; }
+
+void capture_get_stats(uint32_t* records, uint32_t* dropped) {
+    *records = __atomic_load_n(&s_records, __ATOMIC_RELAXED);
+    *dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+// ====================
+// Client Handling
+// ====================
+
+static bool capture_send_all(const void* data, size_t len) {
+    const uint8_t* p = data;
+    while (len > 0) {
+        int sent = send(s_client_sock, p, len, 0);
+        if (sent <= 0) return false;
+        p += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+/** @brief Stop recording and close the client socket. */
+static void capture_client_close(const char* why) {
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    s_streaming = false;
+    xSemaphoreGive(s_write_mutex);
+
+    close(s_client_sock);
+    s_client_sock = -1;
+    ESP_LOGI(TAG, "Capture ended (%s): %" PRIu32 " records, %" PRIu32
+             " dropped", why, s_records, s_dropped);
+}
+
+/** @brief Take a new host: send the file header and start recording. */
+static void capture_accept(void) {
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    int sock = accept(s_listen_sock, (struct sockaddr*)&client_addr, &addr_len);
+    if (sock < 0) return;
+
+    if (s_client_sock >= 0) {
+        close(sock);
+        ESP_LOGW(TAG, "Rejected capture client: one already connected");
+        return;
+    }
+
+    struct timeval timeout = {.tv_sec = CAPTURE_SEND_TIMEOUT_S};
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    s_client_sock = sock;
+
+    xSemaphoreTake(s_write_mutex, portMAX_DELAY);
+    xStreamBufferReset(s_stream);
+    s_start_us = esp_timer_get_time();
+    s_records = 0;
+    s_dropped = 0;
+    s_unreported = 0;
+    capture_file_hdr_t hdr = {
+        .magic = CAPTURE_MAGIC,
+        .version = CAPTURE_VERSION,
+        .hdr_size = sizeof(capture_file_hdr_t),
+        .snaplen = CAPTURE_SNAPLEN,
+        .device_id = g_device_id,
+        .start_us = s_start_us,
+    };
+    xStreamBufferSend(s_stream, &hdr, sizeof(hdr), 0);
+    s_streaming = true;
+    xSemaphoreGive(s_write_mutex);
+
+    ESP_LOGI(TAG, "Capture client connected from %s",
+             inet_ntoa(client_addr.sin_addr));
+}
+
+/** @brief True while the host keeps the connection open. */
+static bool capture_client_alive(void) {
+    uint8_t buf[16];
+    int len = recv(s_client_sock, buf, sizeof(buf), MSG_DONTWAIT);
+    if (len == 0) return false;
+    return len > 0 || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// ====================
+// Capture Server Task
+// ====================
+
+/**
+ * @brief FreeRTOS task: accept one capture host on CAPTURE_PORT and move
+ *        the stream buffer to its socket until it disconnects or
+ *        capture_stop() is called.
+ */
+static void capture_task(void* arg) {
+    static uint8_t chunk[CAPTURE_CHUNK];
+
+    s_listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (s_listen_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+    } else {
+        int reuse = 1;
+        setsockopt(s_listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                   sizeof(reuse));
+
+        struct sockaddr_in server_addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(CAPTURE_PORT),
+            .sin_addr.s_addr = INADDR_ANY,
+        };
+        if (bind(s_listen_sock, (struct sockaddr*)&server_addr,
+                 sizeof(server_addr)) != 0 ||
+            listen(s_listen_sock, 1) != 0) {
+            ESP_LOGE(TAG, "Socket bind/listen failed: errno %d", errno);
+            close(s_listen_sock);
+            s_listen_sock = -1;
+        } else {
+            ESP_LOGI(TAG, "Capture server listening on port %d",
+                     CAPTURE_PORT);
+        }
+    }
+
+    while (!s_stop_requested && s_listen_sock >= 0) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(s_listen_sock, &read_fds);
+        struct timeval timeout = {.tv_usec = 0};
+        if (s_client_sock < 0) timeout.tv_usec = CAPTURE_POLL_MS * 1000;
+        if (select(s_listen_sock + 1, &read_fds, NULL, NULL, &timeout) > 0) {
+            capture_accept();
+        }
+        if (s_client_sock < 0) continue;
+
+        size_t len = xStreamBufferReceive(s_stream, chunk, sizeof(chunk),
+                                          pdMS_TO_TICKS(CAPTURE_POLL_MS));
+        if (len > 0 && !capture_send_all(chunk, len)) {
+            capture_client_close("send failed");
+        } else if (len == 0 && !capture_client_alive()) {
+            capture_client_close("host disconnected");
+        }
+    }
+
+    // Shutdown requested by capture_stop().
+    if (s_client_sock >= 0) capture_client_close("root stopped");
+    if (s_listen_sock >= 0) {
+        close(s_listen_sock);
+        s_listen_sock = -1;
+    }
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+// ====================
+// Lifecycle
+// ====================
+
+void capture_start(void) {
+    if (s_task != NULL) return;
+
+    if (s_stream == NULL) {
+        s_stream = xStreamBufferCreate(CAPTURE_BUF_SIZE, 1);
+        s_write_mutex = xSemaphoreCreateMutex();
+        if (s_stream == NULL || s_write_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate the capture buffer");
+            return;
+        }
+    }
+
+    s_stop_requested = false;
+    xTaskCreate(capture_task, "capture", 3072, NULL, 2, &s_task);
+}
+
+void capture_stop(void) {
+    if (s_task == NULL) return;
+
+    s_stop_requested = true;
+    for (int i = 0; i < 50 && s_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    if (s_task != NULL) {
+        ESP_LOGW(TAG, "Capture task did not stop, deleting it");
+        s_streaming = false;
+        vTaskDelete(s_task);
+        s_task = NULL;
+    }
+}
+
+#endif  // CONFIG_DOMATOR_CAPTURE
@@ -0,0 +1,144 @@
+/**
+ * @file counters.c
+ * @brief Lock-free runtime counters registry.
+ *
+ * Counters are plain uint32_t slots in g_counters, g_rx_counts and
+ * g_tx_counts (domator_mesh.c) bumped with relaxed atomic adds by the inline
+ * helpers in domator_mesh.h, so the button, mesh and MQTT paths never take a
+ * lock or skip an increment.  Readers see each counter individually; a
+ * snapshot is not consistent across counters, which is fine for telemetry.
+ *
+ * counters_format() renders every non-zero counter as compact
+ * "name=value" tokens, e.g. "btn=12 rC=40 tS=81 eTo=2 dTxN=1", used in the
+ * status report ("cnt") and by the shell's "stats" command.
+ */
+
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+
+static const char* const s_names[CNT_COUNT] = {
+    [CNT_BUTTON_PRESSES] = "btn",
+    [CNT_MESH_DISCONNECTS] = "disc",
+    [CNT_LOW_HEAP] = "lowHeap",
+    [CNT_CRITICAL_HEAP] = "critHeap",
+    [CNT_MQTT_DROPPED] = "mqttDrop",
+    [CNT_MESH_SEND_OK] = "sendOk",
+    [CNT_MESH_SEND_FAILED] = "sendFail",
+    [CNT_ERR_NO_MEMORY] = "eMem",
+    [CNT_ERR_TIMEOUT] = "eTo",
+    [CNT_ERR_QUEUE_FULL] = "eQFull",
+    [CNT_ERR_NO_ROUTE] = "eRoute",
+    [CNT_ERR_DISCONNECTED] = "eDisc",
+    [CNT_ERR_NOT_START] = "eStart",
+    [CNT_ERR_OTHER] = "eOther",
+    [CNT_DROP_TX_HIGH] = "dTxH",
+    [CNT_DROP_TX_NORMAL] = "dTxN",
+    [CNT_DROP_TX_OOM] = "dTxMem",
+    [CNT_DROP_LED] = "dLed",
+    [CNT_DROP_SHELL] = "dShell",
+    [CNT_CFG_ROUTES] = "cfgRoute",
+    [CNT_CFG_BUTTON_TYPES] = "cfgBtn",
+    [CNT_CFG_AUTO_OFF] = "cfgOff",
+    [CNT_CFG_BLIND_PAIRS] = "cfgBlind",
+    [CNT_CFG_SCHEDULES] = "cfgSched",
+    [CNT_CFG_GESTURES] = "cfgGest",
+};
+
+/** @brief Short name of a counter for reports. */
+const char* counter_name(counter_t id) {
+    return id < CNT_COUNT && s_names[id] ? s_names[id] : "unknown";
+}
+
+/**
+ * @brief Count a failed esp_mesh_send() (also bumps CNT_MESH_SEND_FAILED).
+ * @param err Error returned by esp_mesh_send().
+ */
+void counter_send_error(esp_err_t err) {
+    counter_t id;
+    switch (err) {
+        case ESP_ERR_MESH_NO_MEMORY:
+            id = CNT_ERR_NO_MEMORY;
+            break;
+        case ESP_ERR_MESH_TIMEOUT:
+            id = CNT_ERR_TIMEOUT;
+            break;
+        case ESP_ERR_MESH_QUEUE_FULL:
+            id = CNT_ERR_QUEUE_FULL;
+            break;
+        case ESP_ERR_MESH_NO_ROUTE_FOUND:
+            id = CNT_ERR_NO_ROUTE;
+            break;
+        case ESP_ERR_MESH_DISCONNECTED:
+            id = CNT_ERR_DISCONNECTED;
+            break;
+        case ESP_ERR_MESH_NOT_START:
+            id = CNT_ERR_NOT_START;
+            break;
+        default:
+            id = CNT_ERR_OTHER;
+            break;
+    }
+    counter_inc(CNT_MESH_SEND_FAILED);
+    counter_inc(id);
+}
+
+/** @brief Append one token if it fits; returns false once buf is full. */
+static bool append_token(char* buf, size_t len, size_t* pos,
+                         const char* name, char type, uint32_t value) {
+    char token[24];
+    int n = type ? snprintf(token, sizeof(token), "%s%c=%" PRIu32,
+                            name, type, value)
+                 : snprintf(token, sizeof(token), "%s=%" PRIu32, name,
+                            value);
+    size_t need = n + (*pos > 0 ? 1 : 0);
+    if (*pos + need >= len) return false;
+
+    if (*pos > 0) buf[(*pos)++] = ' ';
+    memcpy(buf + *pos, token, n);
+    *pos += n;
+    buf[*pos] = '\0';
+    return true;
+}
+
+/**
+ * @brief Render all non-zero counters: named counters first, then per-type
+ *        RX ("rX") and TX ("tX") counts.
+ */
+size_t counters_format(char* buf, size_t len) {
+    size_t pos = 0;
+    if (len == 0) return 0;
+    buf[0] = '\0';
+
+    for (int i = 0; i < CNT_COUNT; i++) {
+        uint32_t v = counter_get(i);
+        if (v && !append_token(buf, len, &pos, s_names[i], 0, v)) return pos;
+    }
+    for (int i = 0; i < COUNTER_MSG_TYPES; i++) {
+        uint32_t v = __atomic_load_n(&g_rx_counts[i], __ATOMIC_RELAXED);
+        if (v && !append_token(buf, len, &pos, "r", 'A' + i, v)) return pos;
+    }
+    for (int i = 0; i < COUNTER_MSG_TYPES; i++) {
+        uint32_t v = __atomic_load_n(&g_tx_counts[i], __ATOMIC_RELAXED);
+        if (v && !append_token(buf, len, &pos, "t", 'A' + i, v)) return pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief Add "cnt":"<tokens>" to a status object.
+ * @param budget Bytes the field may take in the serialised JSON, so a leaf
+ *               status still fits in one mesh message.
+ */
+void counters_add_summary(struct cJSON* json, size_t budget) {
+    const size_t overhead = sizeof(",\"cnt\":\"\"") - 1;
+    char buf[256];
+    if (budget <= overhead + 1) return;
+
+    size_t len = budget - overhead + 1;
+    if (len > sizeof(buf)) len = sizeof(buf);
+    if (counters_format(buf, len) > 0) {
+        cJSON_AddStringToObject(json, "cnt", buf);
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file dlog.c
+ * @brief Deferred binary logging (CONFIG_DOMATOR_DEFERRED_LOG).
+ *
+ * The DLOGx() macros in domator_mesh.h place each format string in flash
+ * (.rodata.dlog) and log only its address, the TAG pointer, a millisecond
+ * timestamp and the raw argument bytes.  No formatting happens on the device:
+ * a record is hex-encoded into a single "@D:<hex>" line and handed to the log
+ * ring (or UART when the ring is not running).  tools/dlog_decode.py turns
+ * those lines back into normal log text using the firmware ELF.
+ *
+ * Record layout (little-endian):
+ *   u32 fmt address    first char of the format is the level ('E','W','I','D')
+ *   u32 tag address
+ *   u32 timestamp (esp_log_timestamp(), ms)
+ *   args, in order:    32-bit values  → 4 bytes
+ *                      64-bit / double → 8 bytes
+ *                      strings        → u8 length + bytes (≤ DLOG_MAX_STR)
+ * Records are capped at DLOG_MAX_RECORD bytes; excess arguments are dropped
+ * and the decoder marks the line as truncated.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+
+#if CONFIG_DOMATOR_DEFERRED_LOG
+
+static const char s_hex[] = "0123456789abcdef";
+
+/** @brief Append raw bytes, or mark the record truncated if they don't fit. */
+static inline void dlog_put_bytes(dlog_record_t* r, const void* data,
+                                  size_t len) {
+    if (r->len + len > DLOG_MAX_RECORD) {
+        r->truncated = true;
+        return;
+    }
+    memcpy(&r->buf[r->len], data, len);
+    r->len += len;
+}
+
+/** @brief Start a record for the given format and tag. */
+void dlog_begin(dlog_record_t* r, const char* fmt, const char* tag) {
+    uint32_t header[3] = {
+        (uint32_t)(uintptr_t)fmt,
+        (uint32_t)(uintptr_t)tag,
+        esp_log_timestamp(),
+    };
+    memcpy(r->buf, header, sizeof(header));
+    r->len = sizeof(header);
+    r->truncated = false;
+}
+
+void dlog_put_u32(dlog_record_t* r, uint32_t v) {
+    dlog_put_bytes(r, &v, sizeof(v));
+}
+
+void dlog_put_u64(dlog_record_t* r, uint64_t v) {
+    dlog_put_bytes(r, &v, sizeof(v));
+}
+
+void dlog_put_f64(dlog_record_t* r, double v) {
+    dlog_put_bytes(r, &v, sizeof(v));
+}
+
+void dlog_put_ptr(dlog_record_t* r, const void* v) {
+    dlog_put_u32(r, (uint32_t)(uintptr_t)v);
+}
+
+void dlog_put_str(dlog_record_t* r, const char* s) {
+    if (s == NULL) s = "(null)";
+    size_t n = strnlen(s, DLOG_MAX_STR);
+    if (r->len + 1 + n > DLOG_MAX_RECORD) {
+        r->truncated = true;
+        return;
+    }
+    r->buf[r->len++] = (uint8_t)n;
+    memcpy(&r->buf[r->len], s, n);
+    r->len += n;
+}
+
+/**
+ * @brief Hex-encode the record as one "@D:" line and emit it.
+ *        A truncated record ends with "!" so the decoder can flag it.
+ */
+void dlog_end(dlog_record_t* r) {
+    char line[3 + 2 * DLOG_MAX_RECORD + 2];
+    size_t n = 0;
+
+    line[n++] = '@';
+    line[n++] = 'D';
+    line[n++] = ':';
+    for (size_t i = 0; i < r->len; i++) {
+        line[n++] = s_hex[r->buf[i] >> 4];
+        line[n++] = s_hex[r->buf[i] & 0x0F];
+    }
+    if (r->truncated) line[n++] = '!';
+    line[n++] = '\n';
+
+    if (telnet_task_handle != NULL) {
+        log_ring_write(line, n);
+    } else {
+        fwrite(line, 1, n, stdout);
+    }
+}
+
+#endif  // CONFIG_DOMATOR_DEFERRED_LOG
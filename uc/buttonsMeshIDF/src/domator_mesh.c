@@ -39,7 +39,9 @@ static const char* TAG = "DOMATOR";
 
 uint64_t g_device_id = 0;
 node_type_t g_node_type = NODE_TYPE_UNKNOWN;
-device_stats_t g_stats = {0};
+uint32_t g_counters[CNT_COUNT] = {0};
+uint32_t g_rx_counts[COUNTER_MSG_TYPES] = {0};
+uint32_t g_tx_counts[COUNTER_MSG_TYPES] = {0};
 uint64_t g_firmware_timestamp = 0;
 
 volatile bool g_mesh_connected = false;
@@ -79,11 +81,12 @@ peer_health_t g_peer_health[MAX_NODES] = {0};
 uint8_t g_peer_count = 0;
 
 QueueHandle_t g_mesh_tx_queue = NULL;
-SemaphoreHandle_t g_stats_mutex = NULL;
 
 TaskHandle_t button_task_handle = NULL;
 TaskHandle_t telnet_task_handle = NULL;
 
+volatile bool g_time_synced = false;
+
 volatile bool g_ota_in_progress = false;
 volatile bool g_ota_requested = false;
 
@@ -154,13 +157,15 @@ void build_time_to_unix(const char* build_time) {
  * Detection priority:
  *  1. NVS key ``hardware_type`` (0=switch, 1=relay_8, 2=relay_16) overrides
  *     everything.
- *  2. On ESP32-C3 targets the hardware is always SWITCH_C3 (relay boards
+ *  2. The type cached by fast_boot.c after an earlier successful boot,
+ *     unless a re-detect was requested.
+ *  3. On ESP32-C3 targets the hardware is always SWITCH_C3 (relay boards
  *     require the classic ESP32 GPIO range).
- *  3. Probe shift-register pins (GPIO 12-14): all high with pull-up means a
+ *  4. Probe shift-register pins (GPIO 12-14): all high with pull-up means a
  *     16-relay board is attached.
- *  4. Probe relay-specific GPIOs (32, 33, 25): accessible on ESP32 means an
+ *  5. Probe relay-specific GPIOs (32, 33, 25): accessible on ESP32 means an
  *     8-relay board is attached.
- *  5. Default to SWITCH_C3.
+ *  6. Default to SWITCH_C3.
  */
 void detect_hardware_type(void) {
     ESP_LOGI(TAG, "Starting hardware detection...");
@@ -192,6 +197,8 @@ void detect_hardware_type(void) {
         nvs_close(nvs_handle);
     }
 
+    if (fast_boot_load_hw()) return;
+
 #ifdef CONFIG_IDF_TARGET_ESP32C3
     ESP_LOGI(TAG, "ESP32-C3 detected - skipping hardware auto-detection");
     ESP_LOGI(TAG, "Defaulting to SWITCH_C3 mode (ESP32-C3 primary use case)");
@@ -300,19 +307,24 @@ void detect_hardware_type(void) {
  * @brief Firmware entry point.
  *
  * Execution order:
- *  1. Initialise NVS flash.
+ *  1. Record the boot in the RTC event journal and initialise NVS flash.
  *  2. Generate device ID and firmware timestamp.
  *  3. Detect hardware type.
  *  4. Create all FreeRTOS queues and mutexes.
  *  5. Pre-initialise relay hardware if this is a relay node.
  *  6. Start the mesh network stack.
- *  7. Launch shared tasks: mesh RX/TX, status reporter, health monitor, OTA.
+ *  7. Launch shared tasks: mesh RX/TX, status reporter, health monitor, OTA,
+ *     time sync.
  *  8. Launch node-type-specific tasks (button/LED for switch, relay buttons
- *     for relay boards).
+ *     and schedule engine for relay boards).
  */
 void app_main(void) {
+    boot_mark(BOOT_PHASE_APP_START);
     ESP_LOGI(TAG, "Domator Mesh starting...");
 
+    journal_init();
+    heap_stats_init();
+
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
         ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -320,22 +332,21 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_mark(BOOT_PHASE_NVS);
 
     generate_device_id();
     build_time_to_unix(FW_BUILD_TIME);
     detect_hardware_type();
+    boot_mark(BOOT_PHASE_HW_DETECT);
+    time_sync_init();
+    standby_init();
 
     g_mesh_tx_queue = xQueueCreate(MESH_TX_QUEUE_SIZE, sizeof(mesh_app_msg_t));
     if (g_mesh_tx_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create mesh TX queue");
         return;
     }
-
-    g_stats_mutex = xSemaphoreCreateMutex();
-    if (g_stats_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create stats mutex");
-        return;
-    }
+    task_stats_register_queue("tx_global", g_mesh_tx_queue);
 
     g_connections_mutex = xSemaphoreCreateMutex();
     if (g_connections_mutex == NULL) {
@@ -360,20 +371,25 @@ void app_main(void) {
                  g_board_type == BOARD_TYPE_16_RELAY ? "16-relay" : "8-relay");
         relay_init();
         relay_button_init();
+        schedule_init();
+        boot_mark(BOOT_PHASE_RELAY_INIT);
     }
 
     mesh_network_init();
+    boot_mark(BOOT_PHASE_MESH_INIT);
 
     xTaskCreate(mesh_rx_task, "mesh_rx", 8192, NULL, 5, NULL);
     xTaskCreate(mesh_tx_task, "mesh_tx", 4096, NULL, 4, NULL);
     xTaskCreate(status_report_task, "status", 4096, NULL, 1, NULL);
     xTaskCreate(health_monitor_task, "health_monitor", 3072, NULL, 2, NULL);
     xTaskCreate(ota_task, "ota", 8192, NULL, 10, NULL);
+    xTaskCreate(time_sync_task, "time_sync", 3072, NULL, 3, NULL);
 
     // Start node-specific tasks
     if (g_node_type == NODE_TYPE_SWITCH_C3) {
         ESP_LOGI(TAG, "Starting switch node tasks");
         button_init();
+        gesture_init();
         led_init();
         xTaskCreate(button_task, "button", 4096, NULL, 6, &button_task_handle);
         xTaskCreate(led_task, "led", 3072, NULL, 2, NULL);
@@ -382,7 +398,9 @@ void app_main(void) {
         ESP_LOGI(TAG, "Starting relay tasks (hardware already initialized)");
         xTaskCreate(relay_button_task, "relay_button", 5120, NULL, 6,
                     &button_task_handle);
+        xTaskCreate(schedule_task, "schedule", 3072, NULL, 3, NULL);
     }
 
+    boot_mark(BOOT_PHASE_TASKS);
     ESP_LOGI(TAG, "Domator Mesh initialized");
 }
\ No newline at end of file
@@ -15,6 +15,7 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -41,9 +42,42 @@
 #define BUTTON_POLL_INTERVAL_MS 20
 #define BUTTON_DEBOUNCE_MS 15
 #define BUTTON_PRESS_TIME_MS 250
-#define LED_UPDATE_INTERVAL_MS 100
 #define LED_FLASH_DURATION_MS 50
+#define LOG_RING_SLOTS 64            // power of two
+#define LOG_RING_SLOT_TEXT 120       // bytes of log text per slot
+// Longest log line the ring keeps; longer lines are cut.
+#define LOG_LINE_MAX ((LOG_RING_SLOTS / 2) * LOG_RING_SLOT_TEXT)
+#define JOURNAL_ENTRIES 256          // RTC event journal records
+#define JOURNAL_CHUNK_ENTRIES 40     // records per MSG_TYPE_DIAG chunk
+#define TELNET_MAX_CLIENTS 3
+#define TELNET_DRAIN_INTERVAL_MS 20  // log ring → UART/Telnet latency bound
+#define SHELL_LINE_MAX 128
+#define SHELL_QUEUE_SIZE 4
+#define SHELL_OUTPUT_BUF_SIZE 1024   // per-client shell → Telnet buffer
+#define SHELL_OUTPUT_TIMEOUT_MS 500
+#define TASK_STATS_MAX_TASKS 20      // tasks kept per telemetry sample
+#define TASK_STATS_MAX_QUEUES 8
+#define TASK_STATS_NAME_LEN 12       // task name bytes on the wire
+#define PROF_BUCKETS 24              // log2 cycle buckets per profiler stage
+#define BOOT_REPORT_TIMEOUT_MS 300000  // stop waiting for a first route
+#define FAST_REJOIN_TIMEOUT_MS 4000  // directed rejoin before a full scan
+#define FAILOVER_REPORT_TIMEOUT_MS 120000  // stop waiting for a first route
+#define FAILOVER_WINDOW_MS 120000  // node losses this long before election count
+#define MESH_ROOT_HEALING_DELAY_MS 10000
+#define MESH_VOTE_PERCENTAGE 0.6f
+#define ROOT_HANDOVER_DELAY_MS 30000   // candidate kept in sync this long first
+#define ROOT_HANDOVER_RETRY_MS 300000  // next handover attempt if still root
+#define REPLICA_RESYNC_MS 300000       // full root state to the standby
+#define REPLICA_POLL_MS 100            // standby task tick
+#define REPLICA_FRAMES_PER_POLL 4      // replica frames queued per tick
+#define LED_ANIM_FRAME_MS 20        // frame interval while an animation runs
+#define LED_BLINK_PERIOD_MS 500
+#define LED_BREATHE_PERIOD_MS 2000
+#define LED_FAIL_FADE_MS 400
+#define LED_EVENT_QUEUE_SIZE 8
 #define LONG_PRESS_THRESHOLD_MS 500
+#define GESTURE_CLICK_GAP_MS 300  // max release-to-press gap within a multi-click
+#define GESTURE_REPEAT_MS 250     // hold repeat tick interval
 #define ROOT_LOSS_RESET_TIMEOUT_MS 300000    // 5 minutes
 #define PEER_HEALTH_CHECK_INTERVAL_MS 30000  // 30 seconds
 #define OTA_COUNTDOWN_MS 5000
@@ -53,6 +87,7 @@
 #define BUTTON_PRESS_OTA_INTERVAL_MS 150
 
 #define NUM_BUTTONS 7
+#define MAX_BUTTON_INPUTS 8  // largest button count on any board
 #define MAX_QUEUE_SIZE 30
 #define MESH_TX_QUEUE_SIZE 20
 #define MESH_MSG_DATA_SIZE 512
@@ -63,7 +98,13 @@
 #define MAX_BUTTONS_EXTENDED 24
 #define MAX_BUTTONS 8
 #define ROUTING_MUTEX_TIMEOUT_MS 200
-#define STATS_MUTEX_TIMEOUT_MS 10
+#define TIME_SYNC_INTERVAL_MS 60000
+#define TIME_SYNC_STEP_THRESHOLD_US 500000  // larger offsets step, smaller slew
+#define TIME_SYNC_FAST_INTERVAL_MS 2000  // poll interval until model converges
+#define TIME_SYNC_POLL_SPACING_MS 100    // gap between polls of different nodes
+#define TIME_SYNC_SAMPLES 8              // offset samples kept per node
+#define SCHEDULE_MAX_ENTRIES 48
+#define SCHEDULE_MAX_CATCHUP_S 300  // max missed window replayed after a gap
 
 // GPIO pin definitions for ESP32-C3 switch board
 #define BUTTON_GPIO_0 0
@@ -118,11 +159,51 @@
 #define MSG_TYPE_TYPE_INFO 'T'     // Message to convey device type info
 #define MSG_TYPE_OTA_START 'U'     // OTA update start packet
 #define MSG_TYPE_PING 'P'          // Ping message for health check'
+#define MSG_TYPE_TIME 'W'          // Mesh clock sync (poll/reply/apply)
+#define MSG_TYPE_SCHEDULE 'K'      // Schedule table from root to relay
+#define MSG_TYPE_GESTURE 'E'       // Recognized button gesture from switch
+#define MSG_TYPE_DIAG 'D'          // Event journal upload / upload request
+#define MSG_TYPE_TASK_STATS 'Q'    // Task/queue telemetry snapshot / request
+#define MSG_TYPE_BOOT_REPORT 'O'   // Once-per-boot phase timeline to root
+#define MSG_TYPE_BENCH 'N'         // Benchmark run control and results
+#define MSG_TYPE_PROBE 'L'         // Link throughput / RTT probe
+#define MSG_TYPE_FAULT 'X'         // Fault injection control and reports
+#define MSG_TYPE_FAILOVER 'F'      // Root failover timeline to the new root
+#define MSG_TYPE_REPLICA 'H'       // Root state replicated to the standby
+
+// MSG_TYPE_CONFIG keys (data[0])
+#define CONFIG_KEY_GESTURES 'g'  // followed by one GESTURE_EN_* mask per button
+#define CONFIG_KEY_REDETECT 'h'  // probe the hardware again on next boot
+#define CONFIG_KEY_ROOT_ROLE 'r'  // followed by one ROOT_ROLE_* byte
+
+// Gesture enable bits (per button)
+#define GESTURE_EN_MULTI 0x01  // double / triple click
+#define GESTURE_EN_LONG 0x02   // long press
+#define GESTURE_EN_HOLD 0x04   // hold with repeat ticks
+
+// Gesture codes carried in MSG_TYPE_GESTURE data[1]
+#define GESTURE_SINGLE 's'
+#define GESTURE_DOUBLE 'd'
+#define GESTURE_TRIPLE 't'
+#define GESTURE_LONG 'l'
+#define GESTURE_HOLD 'h'
+#define GESTURE_REPEAT 'r'
+#define GESTURE_HOLD_END 'e'
+
+// Schedule entry actions
+#define SCHEDULE_ACTION_OFF 0
+#define SCHEDULE_ACTION_ON 1
+#define SCHEDULE_ACTION_TOGGLE 2
 
 // Device types for type info messages
 #define DEVICE_TYPE_SWITCH 'S'
 #define DEVICE_TYPE_RELAY 'R'
 
+// Root roles (NVS "root_role", MSG_TYPE_TYPE_INFO data[1]); see standby.c
+#define ROOT_ROLE_NONE 0
+#define ROOT_ROLE_STANDBY 1    // kept warm, takes over from a plain root
+#define ROOT_ROLE_PREFERRED 2  // should be root whenever it is in the mesh
+
 /** @brief Node role/type in the mesh network. */
 typedef enum {
     NODE_TYPE_UNKNOWN = 0,
@@ -146,27 +227,81 @@ typedef struct {
     uint32_t data_seq;
     uint8_t target_type;
     char data[MESH_MSG_DATA_SIZE];
+    int64_t mesh_time_us;  // sender mesh clock at send, 0 if unsynced
 } __attribute__((packed)) mesh_app_msg_t;
 
-/** @brief Runtime counters for this device. */
+// Size of a frame from firmware without the mesh_time_us trailer. Such
+// frames are still accepted so a mesh can be updated node by node.
+#define MESH_MSG_LEGACY_SIZE offsetof(mesh_app_msg_t, mesh_time_us)
+
+/** @brief One weekly schedule rule evaluated locally on a relay node. */
 typedef struct {
-    uint32_t button_presses;
-    uint32_t mesh_send_failed;
-    uint32_t mesh_send_success;
-    uint32_t mqtt_dropped;
-    uint32_t low_heap_events;
-    uint32_t critical_heap_events;
-    uint32_t mesh_disconnects;
-} device_stats_t;
+    uint8_t day_mask;        // bit N = weekday N (0 = Sunday, as tm_wday)
+    uint8_t action;          // SCHEDULE_ACTION_*
+    uint16_t output_mask;    // bit N = relay N
+    uint32_t second_of_day;  // local time, 0-86399
+} __attribute__((packed)) schedule_entry_t;
+
+/**
+ * @brief Named runtime counters (see counters.c).  Incremented atomically
+ *        from any task or ISR; nothing ever waits on them.
+ */
+typedef enum {
+    CNT_BUTTON_PRESSES,
+    CNT_MESH_DISCONNECTS,
+    CNT_LOW_HEAP,
+    CNT_CRITICAL_HEAP,
+    CNT_MQTT_DROPPED,
+    CNT_MESH_SEND_OK,
+    CNT_MESH_SEND_FAILED,
+    // Send errors by esp_err_t (counter_send_error())
+    CNT_ERR_NO_MEMORY,
+    CNT_ERR_TIMEOUT,
+    CNT_ERR_QUEUE_FULL,
+    CNT_ERR_NO_ROUTE,
+    CNT_ERR_DISCONNECTED,
+    CNT_ERR_NOT_START,
+    CNT_ERR_OTHER,
+    // Queue drops by class
+    CNT_DROP_TX_HIGH,
+    CNT_DROP_TX_NORMAL,
+    CNT_DROP_TX_OOM,
+    CNT_DROP_LED,
+    CNT_DROP_SHELL,
+    // Configuration applied
+    CNT_CFG_ROUTES,
+    CNT_CFG_BUTTON_TYPES,
+    CNT_CFG_AUTO_OFF,
+    CNT_CFG_BLIND_PAIRS,
+    CNT_CFG_SCHEDULES,
+    CNT_CFG_GESTURES,
+    CNT_COUNT,
+} counter_t;
+
+#define COUNTER_MSG_TYPES 26  // per-type RX/TX counters for 'A'..'Z'
 
 /** @brief Debounce and timing state for a single button. */
 typedef struct {
     int last_state;
-    uint32_t last_bounce_time;
     uint32_t press_start_time;
     uint32_t last_release_time;
 } button_state_t;
 
+/** @brief Debounced button transition reported by button_input.c. */
+typedef struct {
+    uint8_t index;    // button number
+    uint8_t level;    // new stable level (1 = pressed)
+    int64_t time_us;  // esp_timer time of the first edge of the transition
+} button_event_t;
+
+/** @brief Events that drive the status LED (see led_post_event()). */
+typedef enum {
+    LED_EVENT_STATE_CHANGED = 0,  // mesh started/connected or OTA changed
+    LED_EVENT_PRESS,              // button press seen locally
+    LED_EVENT_DELIVERED,          // button message handed to the mesh
+    LED_EVENT_DELIVERY_FAILED,    // button message send failed
+} led_event_t;
+
 /** @brief RGB colour triplet for the NeoPixel status LED. */
 typedef struct {
     uint8_t r;
@@ -199,6 +334,175 @@ typedef struct {
     uint8_t types[MAX_BUTTONS];
 } button_types_t;
 
+/** @brief Event codes stored in the RTC journal (arg meaning in brackets). */
+typedef enum {
+    JOURNAL_EV_BOOT = 1,             // [esp_reset_reason_t]
+    JOURNAL_EV_MESH_STARTED,
+    JOURNAL_EV_MESH_STOPPED,
+    JOURNAL_EV_PARENT_CONNECTED,     // [mesh layer]
+    JOURNAL_EV_PARENT_DISCONNECTED,  // [wifi disconnect reason]
+    JOURNAL_EV_ROOT_GAINED,
+    JOURNAL_EV_ROOT_LOST,
+    JOURNAL_EV_HEAP_LOW,             // [free bytes]
+    JOURNAL_EV_HEAP_CRITICAL,        // [free bytes]
+    JOURNAL_EV_TX_DROP,              // [messages pending in TX queue]
+    JOURNAL_EV_TASK_WDT,
+    JOURNAL_EV_OTA_START,
+    JOURNAL_EV_OTA_FAILED,           // [esp_err_t]
+    JOURNAL_EV_MQTT_CONNECTED,
+    JOURNAL_EV_MQTT_DISCONNECTED,
+} journal_event_t;
+
+/** @brief One journal record (also the MSG_TYPE_DIAG wire format). */
+typedef struct {
+    uint32_t uptime_ms;
+    uint16_t boot;  // low 16 bits of the boot counter
+    uint8_t event;  // journal_event_t
+    uint8_t reserved;
+    uint32_t arg;
+} __attribute__((packed)) journal_entry_t;
+
+/** @brief MSG_TYPE_DIAG chunk header, followed by count journal_entry_t. */
+typedef struct {
+    uint8_t chunk;
+    uint8_t chunks;
+    uint8_t reset_reason;  // esp_reset_reason() of the current boot
+    uint8_t count;
+    uint32_t boot_count;
+} __attribute__((packed)) journal_chunk_hdr_t;
+
+/** @brief Per-task telemetry (MSG_TYPE_TASK_STATS wire format). */
+typedef struct {
+    char name[TASK_STATS_NAME_LEN];  // not NUL-terminated when full
+    uint8_t priority;
+    uint8_t state;          // eTaskState
+    uint16_t cpu_permille;  // share of one core over the last interval
+    uint16_t stack_free;    // stack high-watermark: lowest free bytes ever
+} __attribute__((packed)) task_stat_t;
+
+/** @brief Per-queue telemetry (MSG_TYPE_TASK_STATS wire format). */
+typedef struct {
+    char name[10];
+    uint16_t depth;  // items waiting at the last sample
+    uint16_t hwm;    // highest depth seen since boot
+    uint16_t size;   // capacity, 0 when unknown (mesh stack queues)
+} __attribute__((packed)) queue_stat_t;
+
+/** @brief MSG_TYPE_TASK_STATS header, followed by the task and queue arrays. */
+typedef struct {
+    uint8_t task_count;
+    uint8_t queue_count;
+    uint32_t interval_ms;  // sampling window behind cpu_permille
+} __attribute__((packed)) task_stats_hdr_t;
+
+_Static_assert(sizeof(task_stats_hdr_t) +
+                       TASK_STATS_MAX_TASKS * sizeof(task_stat_t) +
+                       TASK_STATS_MAX_QUEUES * sizeof(queue_stat_t) <=
+                   MESH_MSG_DATA_SIZE,
+               "task telemetry must fit in one mesh message");
+
+/** @brief Boot phases, in the order they normally complete. */
+typedef enum {
+    BOOT_PHASE_APP_START,     // app_main() entered
+    BOOT_PHASE_NVS,           // NVS initialised
+    BOOT_PHASE_HW_DETECT,     // detect_hardware_type() done
+    BOOT_PHASE_RELAY_INIT,    // relay outputs and buttons ready (relay only)
+    BOOT_PHASE_MESH_INIT,     // mesh_network_init() returned
+    BOOT_PHASE_TASKS,         // app_main() finished starting tasks
+    BOOT_PHASE_MESH_STARTED,  // MESH_EVENT_STARTED
+    BOOT_PHASE_PARENT,        // first parent connection
+    BOOT_PHASE_ROOT,          // elected root (root only)
+    BOOT_PHASE_GOT_IP,        // router IP address (root only)
+    BOOT_PHASE_MQTT,          // MQTT connected (root only)
+    BOOT_PHASE_CONFIG,        // first configuration received
+    BOOT_PHASE_FIRST_ROUTE,   // first routed command sent or applied
+    BOOT_PHASE_COUNT,
+} boot_phase_t;
+
+/**
+ * @brief MSG_TYPE_BOOT_REPORT payload: milliseconds since start-up at which
+ *        each phase was first reached, 0 if it was not.
+ */
+typedef struct {
+    uint8_t reset_reason;  // esp_reset_reason()
+    uint8_t phase_count;   // BOOT_PHASE_COUNT of the sender
+    uint32_t at_ms[BOOT_PHASE_COUNT];
+} __attribute__((packed)) boot_report_t;
+
+/**
+ * @brief Root failover events, in the order they normally happen.  The
+ *        first three open a failover episode; the rest are only recorded
+ *        while one is open.
+ */
+typedef enum {
+    FAILOVER_EV_PARENT_LOST,  // MESH_EVENT_PARENT_DISCONNECTED
+    FAILOVER_EV_NO_PARENT,    // MESH_EVENT_NO_PARENT_FOUND
+    FAILOVER_EV_SWITCH_REQ,   // MESH_EVENT_ROOT_SWITCH_REQ
+    FAILOVER_EV_SWITCH_ACK,   // MESH_EVENT_ROOT_SWITCH_ACK
+    FAILOVER_EV_PARENT,       // MESH_EVENT_PARENT_CONNECTED again
+    FAILOVER_EV_ROOT,         // elected root
+    FAILOVER_EV_GOT_IP,       // router IP address (root only)
+    FAILOVER_EV_MQTT_INIT,    // mqtt_init() (root only)
+    FAILOVER_EV_MQTT,         // MQTT connected (root only)
+    FAILOVER_EV_CONFIG,       // connections received (root only)
+    FAILOVER_EV_FIRST_ROUTE,  // first routed command sent or applied
+    FAILOVER_EV_COUNT,
+} failover_event_t;
+
+/** @brief When one failover event happened on a node. */
+typedef struct {
+    uint32_t at_ms;   // ms since start-up, 0 if not reached
+    int64_t mesh_us;  // mesh time at that moment, 0 if unsynced
+} __attribute__((packed)) failover_stamp_t;
+
+/** @brief MSG_TYPE_FAILOVER payload: one node's timeline of an episode. */
+typedef struct {
+    uint8_t event_count;  // FAILOVER_EV_COUNT of the sender
+    uint32_t now_ms;      // sender's ms since start-up when sent
+    failover_stamp_t at[FAILOVER_EV_COUNT];
+} __attribute__((packed)) failover_report_t;
+
+/*
+ * Root placement and the hot standby.  A node's root role (ROOT_ROLE_*,
+ * NVS "domator"/"root_role") reaches the root as data[1] of
+ * MSG_TYPE_TYPE_INFO.  The root keeps the best-ranked other node in sync
+ * with MSG_TYPE_REPLICA frames (REPLICA_OP_* in data[0]) and hands the root
+ * over to it once it outranks the root itself.
+ */
+#define REPLICA_OP_REGISTRY 'r'  // data[1] = count, then replica_node_t[]
+#define REPLICA_OP_CONFIG 'c'    // replica_config_hdr_t, then JSON bytes
+#define REPLICA_OP_OUTPUTS 'o'   // data[1] = count, then replica_output_t[]
+
+/** @brief Root configuration kept as the JSON command that set it. */
+typedef enum {
+    REPLICA_CFG_CONNECTIONS,
+    REPLICA_CFG_BUTTON_TYPES,
+    REPLICA_CFG_BLIND_PAIRS,
+    REPLICA_CFG_COUNT,
+} replica_config_t;
+
+/** @brief One registry entry on the wire. */
+typedef struct {
+    uint64_t device_id;
+    uint8_t mesh_addr[6];
+    char type;     // DEVICE_TYPE_*, 0 if unknown
+    uint8_t role;  // ROOT_ROLE_*
+} __attribute__((packed)) replica_node_t;
+
+/** @brief One chunk of a configuration command. */
+typedef struct {
+    uint8_t kind;     // replica_config_t
+    uint16_t total;   // length of the whole command
+    uint16_t offset;  // of this chunk; chunks follow in order
+} __attribute__((packed)) replica_config_hdr_t;
+
+/** @brief Last reported outputs of one relay board. */
+typedef struct {
+    uint64_t device_id;
+    uint16_t known;  // bit N = relay N reported
+    uint16_t on;     // bit N = relay N on
+} __attribute__((packed)) replica_output_t;
+
 /** @brief Runtime health record for a peer node. */
 typedef struct {
     uint64_t device_id;
@@ -209,6 +513,30 @@ typedef struct {
     bool is_alive;
 } peer_health_t;
 
+/** @brief Heap numbers for one MALLOC_CAP_* class. */
+typedef struct {
+    uint32_t free;
+    uint32_t largest;        // largest free block
+    uint32_t min_free;       // lowest free size since boot
+    uint16_t frag_permille;  // 1000 * (1 - largest / free)
+} heap_caps_stat_t;
+
+/** @brief Subsystems that live heap bytes are attributed to. */
+typedef enum {
+    HEAP_TAG_CJSON,
+    HEAP_TAG_MQTT,  // esp-mqtt outbox, sampled
+    HEAP_TAG_MESH_TX,
+    HEAP_TAG_TELNET,
+    HEAP_TAG_COUNT,
+} heap_tag_t;
+
+/** @brief Allocation tag counters. */
+typedef struct {
+    int32_t live;  // bytes currently allocated
+    int32_t peak;
+    uint32_t allocs;
+} heap_tag_stat_t;
+
 // ====================
 // Global Variables (extern)
 // ====================
@@ -217,7 +545,9 @@ typedef struct {
 extern uint64_t g_device_id;
 extern uint64_t g_firmware_timestamp;
 extern node_type_t g_node_type;
-extern device_stats_t g_stats;
+extern uint32_t g_counters[CNT_COUNT];
+extern uint32_t g_rx_counts[COUNTER_MSG_TYPES];
+extern uint32_t g_tx_counts[COUNTER_MSG_TYPES];
 
 // Mesh state
 extern volatile bool g_mesh_connected;
@@ -254,12 +584,14 @@ extern uint8_t g_peer_count;
 
 // Queues and mutexes
 extern QueueHandle_t g_mesh_tx_queue;
-extern SemaphoreHandle_t g_stats_mutex;
 
 // Task handles
 extern TaskHandle_t button_task_handle;
 extern TaskHandle_t telnet_task_handle;
 
+// Wall clock (set from SNTP on root, from root beacons elsewhere)
+extern volatile bool g_time_synced;
+
 // OTA flag
 extern volatile bool g_ota_in_progress;
 extern volatile bool g_ota_requested;
@@ -285,6 +617,12 @@ bool domator_mesh_is_wifi_connected(void);
  */
 bool mesh_stop_and_connect_sta(uint32_t timeout_ms);
 
+/**
+ * @brief Tell the root this node's device type and, if it has one, its root
+ *        role (MSG_TYPE_TYPE_INFO).
+ */
+void mesh_send_type_info(void);
+
 // ====================
 // Function Declarations: node_switch.c
 // ====================
@@ -302,8 +640,8 @@ void button_task(void* arg);
 void led_init(void);
 
 /**
- * @brief FreeRTOS task: updates the status LED colour based on mesh state
- *        and handles short flash requests.
+ * @brief FreeRTOS task: event-driven status LED; sleeps until an event,
+ *        animation frame, or overlay end and refreshes only on change.
  */
 void led_task(void* arg);
 
@@ -318,6 +656,12 @@ void led_set_color(uint8_t r, uint8_t g, uint8_t b);
 /** @brief Trigger a short cyan LED flash to acknowledge a button press. */
 void led_flash_cyan(void);
 
+/**
+ * @brief Post an event to the LED task.  Non-blocking; does nothing on nodes
+ *        without a status LED.
+ */
+void led_post_event(led_event_t event);
+
 // ====================
 // Function Declarations: mesh_comm.c
 // ====================
@@ -344,6 +688,23 @@ void mesh_tx_task(void* arg);
 bool mesh_queue_to_node(mesh_app_msg_t* msg, tx_priority_t prio,
                         mesh_addr_t* dest);
 
+/** @brief Number of messages currently waiting in the internal TX queue. */
+int mesh_tx_queue_depth(void);
+
+/**
+ * @brief Send a message now, bypassing the TX queue.  Blocks while the
+ *        mesh stack's own queue is full.
+ * @param dest Destination mesh address, or NULL to send to the root node.
+ * @return ESP_OK on success, or an esp_err_t error code.
+ */
+esp_err_t mesh_send_to_node(mesh_addr_t* dest, mesh_app_msg_t* msg);
+
+/**
+ * @brief mesh_send_to_node() without the time stamp and the fault layer,
+ *        for frames the fault layer held back.
+ */
+esp_err_t mesh_send_raw(mesh_addr_t* dest, mesh_app_msg_t* msg);
+
 /**
  * @brief FreeRTOS task: periodically publishes a device status report.
  *        Root nodes publish to MQTT; leaf nodes send a JSON status message
@@ -374,6 +735,67 @@ void node_root_stop(void);
 /** @brief Build and publish a JSON status report for the root node to MQTT. */
 void root_publish_status(void);
 
+/**
+ * @brief Copy the IDs and mesh addresses of all registered nodes.
+ * @return Number of entries written (at most max).
+ */
+int root_registry_snapshot(uint64_t* ids, mesh_addr_t* addrs, int max);
+
+/**
+ * @brief Device type a registered node reported (DEVICE_TYPE_*).
+ * @return The type character, or 0 if unknown or not registered.
+ */
+char root_registry_type(uint64_t device_id);
+
+/**
+ * @brief Root role a registered node reported (ROOT_ROLE_*).
+ * @return The role, or ROOT_ROLE_NONE if unknown or not registered.
+ */
+uint8_t root_registry_role(uint64_t device_id);
+
+/**
+ * @brief Add a node known from the replicated registry, unless it already
+ *        registered with this root.
+ */
+void root_registry_restore(const replica_node_t* node);
+
+/** @brief Apply a JSON command as if it arrived on /switch/cmd/root. */
+void root_apply_config(const char* json, int len);
+
+/**
+ * @brief Publish one MSG_TYPE_DIAG journal chunk to /switch/diag/<src_id>.
+ * @param msg Chunk from a node (or built locally by the root's journal).
+ */
+void root_handle_diag(const mesh_app_msg_t* msg);
+
+/**
+ * @brief Publish a MSG_TYPE_TASK_STATS snapshot to /switch/tasks/<src_id>.
+ * @param msg Snapshot from a node (or built locally by the root).
+ */
+void root_handle_task_stats(const mesh_app_msg_t* msg);
+
+/**
+ * @brief Publish a MSG_TYPE_BOOT_REPORT timeline to /switch/boot/<src_id>.
+ * @param msg Report from a node (or built locally by the root).
+ */
+void root_handle_boot_report(const mesh_app_msg_t* msg);
+
+/**
+ * @brief Start a ping/pong RTT test with one node (result is logged and
+ *        published to MQTT).
+ * @return true if the first ping was queued.
+ */
+bool root_ping_node(uint64_t target_id);
+
+/**
+ * @brief Send a raw relay command string (e.g. "a", "b1") to a relay node.
+ * @return true if the command was queued.
+ */
+bool root_send_relay_command(uint64_t target_id, const char* command);
+
+/** @brief Print the node registry to the current shell client. */
+void root_shell_print_registry(void);
+
 // ====================
 // Function Declarations: node_relay.c
 // ====================
@@ -472,27 +894,1176 @@ void ota_check_rollback_on_boot(void);
  */
 void health_monitor_task(void* arg);
 
+// ====================
+// Function Declarations: button_input.c
+// ====================
+
+/**
+ * @brief Configure button GPIOs and install the timestamping edge ISR.
+ *        The ISR wakes the task stored in button_task_handle.
+ * @param pins  GPIO numbers indexed by button number.
+ * @param count Number of buttons (at most MAX_BUTTON_INPUTS).
+ */
+void button_input_init(const int* pins, int count);
+
+/**
+ * @brief Block until the next debounced button transition.
+ * @param ev       Receives the transition (timestamp = first edge).
+ * @param max_wait Maximum time to block.
+ * @return true if ev was filled, false on timeout.
+ */
+bool button_input_get_event(button_event_t* ev, TickType_t max_wait);
+
+/** @brief Read ring overflow and missed-edge counters. */
+void button_input_get_stats(uint32_t* overflows, uint32_t* missed_edges);
+
+// ====================
+// Function Declarations: gesture.c
+// ====================
+
+/** @brief Restore per-button gesture masks from NVS (switch nodes). */
+void gesture_init(void);
+
+/** @brief Apply a CONFIG_KEY_GESTURES config message from the root. */
+void gesture_handle_config(const mesh_app_msg_t* msg);
+
+/**
+ * @brief Feed a debounced button edge into the gesture recognizer.
+ * @return true if consumed (button in gesture mode, no raw message needed).
+ */
+bool gesture_handle_event(const button_event_t* ev);
+
+/**
+ * @brief Fire expired gesture timers.
+ * @return Ticks until the next timer, or portMAX_DELAY if none is pending.
+ */
+TickType_t gesture_poll(void);
+
+// ====================
+// Function Declarations: time_sync.c
+// ====================
+
+/** @brief Set the local timezone (CONFIG_DOMATOR_TIMEZONE). */
+void time_sync_init(void);
+
+/** @brief Returns true once the wall clock has been set from SNTP or root. */
+bool time_sync_is_valid(void);
+
+/** @brief Start the SNTP client (root node only, after getting an IP). */
+void time_sync_start_sntp(void);
+
+/** @brief Stop the SNTP client when this node loses the root role. */
+void time_sync_stop_sntp(void);
+
+/**
+ * @brief Root: forget a (re)joining node's sync history and poll it now.
+ * @param device_id Joining device.
+ * @param addr      Its mesh address.
+ */
+void time_sync_node_joined(uint64_t device_id, mesh_addr_t* addr);
+
+/** @brief Root: publish per-node clock offset/uncertainty to MQTT. */
+void time_sync_publish_report(void);
+
+/**
+ * @brief Fill mesh_time_us (and TIME exchange stamps) on an outgoing
+ *        message.  Called by mesh_send_to_node() right before sending.
+ */
+void time_sync_stamp_outgoing(mesh_app_msg_t* msg);
+
+/**
+ * @brief Handle a MSG_TYPE_TIME poll/reply/apply message.
+ * @param from        Sender mesh address.
+ * @param msg         Received message.
+ * @param rx_local_us esp_timer_get_time() taken right after receive.
+ */
+void time_sync_handle_message(mesh_addr_t* from, const mesh_app_msg_t* msg,
+                              int64_t rx_local_us);
+
+/**
+ * @brief FreeRTOS task: polls nodes round-robin for clock samples (root) or
+ *        watches for stale sync (leaf).
+ */
+void time_sync_task(void* arg);
+
+/** @brief Current mesh time in µs since the epoch, 0 if not synced. */
+int64_t mesh_time_now_us(void);
+
+/** @brief Convert an esp_timer_get_time() value to mesh time (0 if unsynced). */
+int64_t mesh_time_from_local_us(int64_t local_us);
+
+/** @brief Estimated mesh clock error bound in µs (0 on root, -1 unsynced). */
+int32_t mesh_time_uncertainty_us(void);
+
+/**
+ * @brief One-way latency of a received message from its mesh_time_us stamp.
+ * @return Latency in µs, or -1 if sender or receiver is unsynced.
+ */
+int64_t mesh_time_message_age_us(const mesh_app_msg_t* msg);
+
+// ====================
+// Function Declarations: schedule.c
+// ====================
+
+/** @brief Create the schedule mutex and restore the table from NVS. */
+void schedule_init(void);
+
+/**
+ * @brief Replace the local schedule table from a MSG_TYPE_SCHEDULE message.
+ * @param msg Message holding a count byte followed by schedule_entry_t
+ *            records.
+ */
+void schedule_handle_message(const mesh_app_msg_t* msg);
+
+/**
+ * @brief FreeRTOS task: evaluate the schedule table once per second against
+ *        the local wall clock (relay nodes only).
+ */
+void schedule_task(void* arg);
+
+// ====================
+// Function Declarations: log_ring.c
+// ====================
+
+/** @brief Allocate the log ring (idempotent). */
+esp_err_t log_ring_init(void);
+
+/**
+ * @brief Append bytes to the log ring.  Lock-free, never blocks; safe from
+ *        any task.  No-op before log_ring_init().
+ */
+void log_ring_write(const char* data, size_t len);
+
+/**
+ * @brief Copy committed log bytes at *cursor into out and advance it.
+ * @param dropped Incremented by chunks lost to overwrite; may be NULL.
+ * @return Bytes copied.
+ */
+size_t log_ring_read(uint32_t* cursor, char* out, size_t max,
+                     uint32_t* dropped);
+
+/** @brief Reader cursor at the oldest data still retained. */
+uint32_t log_ring_oldest_cursor(void);
+
+/** @brief Reader cursor at the current write position. */
+uint32_t log_ring_head_cursor(void);
+
+// ====================
+// Function Declarations: dlog.c
+// ====================
+
+/*
+ * DLOGE/W/I/D(tag, fmt, ...) – drop-in replacements for ESP_LOGx() on hot
+ * paths.  With CONFIG_DOMATOR_DEFERRED_LOG the format string is never parsed
+ * on the device: only its flash address and the raw arguments (at most
+ * DLOG_MAX_ARGS) are logged, see dlog.c.  Supported argument types are
+ * integers up to 64 bits, float/double, strings and void pointers.
+ */
+#if CONFIG_DOMATOR_DEFERRED_LOG
+
+#define DLOG_MAX_RECORD 56  // header + argument bytes per record
+#define DLOG_MAX_STR 24     // string arguments are cut to this length
+#define DLOG_MAX_ARGS 8
+
+/** One encoded log record under construction. */
+typedef struct {
+    uint8_t buf[DLOG_MAX_RECORD];
+    size_t len;
+    bool truncated;
+} dlog_record_t;
+
+void dlog_begin(dlog_record_t* r, const char* fmt, const char* tag);
+void dlog_put_u32(dlog_record_t* r, uint32_t v);
+void dlog_put_u64(dlog_record_t* r, uint64_t v);
+void dlog_put_f64(dlog_record_t* r, double v);
+void dlog_put_ptr(dlog_record_t* r, const void* v);
+void dlog_put_str(dlog_record_t* r, const char* s);
+
+/** @brief Emit the record as one "@D:<hex>" log line. */
+void dlog_end(dlog_record_t* r);
+
+#define DLOG_PUT(r, x)                                                   \
+    _Generic((x),                                                        \
+        char*: dlog_put_str,                                             \
+        const char*: dlog_put_str,                                       \
+        void*: dlog_put_ptr,                                             \
+        const void*: dlog_put_ptr,                                       \
+        int64_t: dlog_put_u64,                                           \
+        uint64_t: dlog_put_u64,                                          \
+        float: dlog_put_f64,                                             \
+        double: dlog_put_f64,                                            \
+        default: dlog_put_u32)(r, x)
+
+#define DLOG_NARGS(...) \
+    DLOG_NARGS_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+
+#define DLOG_PUT_0(r)
+#define DLOG_PUT_1(r, a) DLOG_PUT(r, a);
+#define DLOG_PUT_2(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_1(r, __VA_ARGS__)
+#define DLOG_PUT_3(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_2(r, __VA_ARGS__)
+#define DLOG_PUT_4(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_3(r, __VA_ARGS__)
+#define DLOG_PUT_5(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_4(r, __VA_ARGS__)
+#define DLOG_PUT_6(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_5(r, __VA_ARGS__)
+#define DLOG_PUT_7(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_6(r, __VA_ARGS__)
+#define DLOG_PUT_8(r, a, ...) DLOG_PUT(r, a); DLOG_PUT_7(r, __VA_ARGS__)
+
+// The level letter is prepended to the format so the decoder needs only the
+// format address.  The .rodata.dlog section keeps the strings in flash and
+// groups them for the decoder.  Filtered like ESP_LOGx: at compile time by
+// LOG_LOCAL_LEVEL, at run time by esp_log_level_set() (the shell "log").
+#define DLOG_EMIT(level, letter, tag, fmt, ...)                            \
+    do {                                                                   \
+        if (LOG_LOCAL_LEVEL >= (level) &&                                  \
+            esp_log_level_get(tag) >= (level)) {                           \
+            static const char _dlog_fmt[]                                  \
+                __attribute__((section(".rodata.dlog"), used)) =           \
+                    letter fmt;                                            \
+            dlog_record_t _dlog_rec;                                       \
+            dlog_begin(&_dlog_rec, _dlog_fmt, (tag));                      \
+            DLOG_CAT(DLOG_PUT_, DLOG_NARGS(__VA_ARGS__))                   \
+            (&_dlog_rec, ##__VA_ARGS__) dlog_end(&_dlog_rec);              \
+        }                                                                  \
+    } while (0)
+
+#define DLOGE(tag, fmt, ...) \
+    DLOG_EMIT(ESP_LOG_ERROR, "E", tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) \
+    DLOG_EMIT(ESP_LOG_WARN, "W", tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) \
+    DLOG_EMIT(ESP_LOG_INFO, "I", tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) \
+    DLOG_EMIT(ESP_LOG_DEBUG, "D", tag, fmt, ##__VA_ARGS__)
+
+#else
+
+#define DLOGE(tag, fmt, ...) ESP_LOGE(tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) ESP_LOGW(tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) ESP_LOGD(tag, fmt, ##__VA_ARGS__)
+
+#endif  // CONFIG_DOMATOR_DEFERRED_LOG
+
+// ====================
+// Function Declarations: journal.c
+// ====================
+
+/** @brief Validate the RTC journal and record this boot.  Call first. */
+void journal_init(void);
+
+/** @brief Append an event to the RTC journal.  Safe from tasks and ISRs. */
+void journal_record(journal_event_t event, uint32_t arg);
+
+/** @brief Make the next upload resend the whole retained journal. */
+void journal_request_upload(void);
+
+/**
+ * @brief Upload journal records not yet sent as MSG_TYPE_DIAG chunks (the
+ *        root publishes its own directly).  No-op while offline.
+ */
+void journal_upload_pending(void);
+
+/** @brief Short name for a journal_event_t code. */
+const char* journal_event_name(uint8_t event);
+
+/** @brief Short name for an esp_reset_reason_t value. */
+const char* journal_reset_reason_name(uint8_t reason);
+
 // ====================
 // Function Declarations: telnet.c
 // ====================
 
 /**
- * @brief FreeRTOS task: listens for a Telnet TCP connection on port 23 and
- *        echoes received data back to the client.
+ * @brief FreeRTOS task: drains the log ring to UART and serves up to
+ *        TELNET_MAX_CLIENTS Telnet clients on port 23.
  */
 void telnet_task(void* arg);
 
 /**
- * @brief Custom vprintf handler that mirrors log output to both UART and
- *        the active Telnet client socket.
+ * @brief Log vprintf backend: formats the line into the lock-free log ring.
  * @param fmt printf-style format string.
  * @param args Variadic argument list.
  * @return Number of bytes written.
  */
 int dual_log_vprintf(const char* fmt, va_list args);
 
-/** @brief Start the Telnet server and enable dual UART/Telnet logging. */
+/** @brief Start the Telnet server and route logging through the ring. */
 void telnet_start(void);
 
 /** @brief Stop the Telnet server and restore the default log handler. */
 void telnet_stop(void);
+
+/**
+ * @brief Queue shell output for one Telnet client.  Blocks up to
+ *        SHELL_OUTPUT_TIMEOUT_MS while the client's buffer is full.
+ */
+void telnet_client_write(int client, const char* data, size_t len);
+
+/** @brief Enable or disable log streaming to one Telnet client. */
+void telnet_client_set_logs(int client, bool enabled);
+
+// ====================
+// Function Declarations: shell.c
+// ====================
+
+/** @brief Register the console commands and start shell_task (idempotent). */
+void shell_init(void);
+
+/**
+ * @brief Queue a command line received from a Telnet client for execution
+ *        in shell_task.
+ * @return false if the shell is busy (queue full).
+ */
+bool shell_submit(int client, const char* line);
+
+/** @brief printf() to the Telnet client whose command is running. */
+int shell_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// ====================
+// Function Declarations: task_stats.c
+// ====================
+
+/**
+ * @brief Track the depth high-watermark of a FreeRTOS queue.
+ * @param name Short name used in telemetry (static string).
+ * @param q    Queue handle; its capacity is read at registration.
+ */
+void task_stats_register_queue(const char* name, QueueHandle_t q);
+
+/** @brief Fold the current depth of a registered queue into its HWM. */
+void task_stats_note_queue(QueueHandle_t q);
+
+/**
+ * @brief Sample run-time counters, stack high-watermarks and queue depths.
+ *        CPU shares cover the time since the previous call.
+ */
+void task_stats_sample(void);
+
+struct cJSON;
+
+/** @brief Add compact telemetry fields (stkMin, cpuTop, txHwm) to a status. */
+void task_stats_add_summary(struct cJSON* json);
+
+/** @brief Fill msg with the last sample as a MSG_TYPE_TASK_STATS payload. */
+void task_stats_build_msg(mesh_app_msg_t* msg);
+
+/**
+ * @brief Copy the last sample.
+ * @return Number of tasks written to tasks (at most TASK_STATS_MAX_TASKS);
+ *         *queue_count receives the number of queues written to queues.
+ */
+int task_stats_snapshot(task_stat_t* tasks, queue_stat_t* queues,
+                        int* queue_count, uint32_t* interval_ms);
+
+/**
+ * @brief List registered queues that have a FreeRTOS handle.
+ * @return Number of entries written (at most max).
+ */
+int task_stats_queue_handles(QueueHandle_t* handles, const char** names,
+                             int max);
+
+// ====================
+// Function Declarations: heap_stats.c
+// ====================
+
+/** @brief Install allocation hooks (if tagging) and log the boot heap. */
+void heap_stats_init(void);
+
+/** @brief Free, largest block, minimum-ever and fragmentation for caps. */
+void heap_stats_get(uint32_t caps, heap_caps_stat_t* out);
+
+/** @brief Add heapBlk/heapMin/heapFrag/intFree/dmaBlk (and heapTags). */
+void heap_stats_add_summary(struct cJSON* json);
+
+/** @brief Short name of a heap_tag_t. */
+const char* heap_tag_name(heap_tag_t tag);
+
+#if CONFIG_DOMATOR_HEAP_TAGS
+
+/** @brief malloc() whose block is counted against tag. */
+void* heap_tag_malloc(heap_tag_t tag, size_t size);
+
+/** @brief calloc() whose block is counted against tag. */
+void* heap_tag_calloc(heap_tag_t tag, size_t n, size_t size);
+
+/** @brief free() a block allocated with heap_tag_malloc/calloc(tag). */
+void heap_tag_free(heap_tag_t tag, void* ptr);
+
+/** @brief Count an allocation made elsewhere (e.g. by FreeRTOS). */
+void heap_tag_account(heap_tag_t tag, int32_t bytes);
+
+/** @brief Read one tag's counters. */
+void heap_tag_get(heap_tag_t tag, heap_tag_stat_t* out);
+
+/** @brief Refresh sampled tags (MQTT outbox). */
+void heap_tags_sample(void);
+
+#else
+
+#define heap_tag_malloc(tag, size) malloc(size)
+#define heap_tag_calloc(tag, n, size) calloc(n, size)
+#define heap_tag_free(tag, ptr) free(ptr)
+#define heap_tag_account(tag, bytes) ((void)0)
+
+#endif  // CONFIG_DOMATOR_HEAP_TAGS
+
+// ====================
+// Function Declarations: counters.c
+// ====================
+
+/** @brief Increment a named counter.  Lock-free; safe from ISRs. */
+static inline void counter_inc(counter_t id) {
+    __atomic_fetch_add(&g_counters[id], 1, __ATOMIC_RELAXED);
+}
+
+/** @brief Read a named counter. */
+static inline uint32_t counter_get(counter_t id) {
+    return __atomic_load_n(&g_counters[id], __ATOMIC_RELAXED);
+}
+
+/** @brief Count one received mesh message of the given MSG_TYPE_*. */
+static inline void counter_rx(uint8_t msg_type) {
+    if (msg_type >= 'A' && msg_type <= 'Z') {
+        __atomic_fetch_add(&g_rx_counts[msg_type - 'A'], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/** @brief Count one sent mesh message of the given MSG_TYPE_*. */
+static inline void counter_tx(uint8_t msg_type) {
+    if (msg_type >= 'A' && msg_type <= 'Z') {
+        __atomic_fetch_add(&g_tx_counts[msg_type - 'A'], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/** @brief Count a failed esp_mesh_send() under its CNT_ERR_* class. */
+void counter_send_error(esp_err_t err);
+
+/** @brief Short name of a counter_t for reports. */
+const char* counter_name(counter_t id);
+
+/**
+ * @brief Write the non-zero counters as "name=value" tokens separated by
+ *        spaces ("rB" / "tB" for RX/TX of MSG_TYPE_BUTTON).  Stops at a token
+ *        boundary when buf is full.
+ * @return Length written (excluding the NUL).
+ */
+size_t counters_format(char* buf, size_t len);
+
+/**
+ * @brief Add the counter snapshot as "cnt" if it fits in budget bytes of
+ *        serialised JSON (tokens that don't fit are left out).
+ */
+void counters_add_summary(struct cJSON* json, size_t budget);
+
+// ====================
+// Function Declarations: profiler.c
+// ====================
+
+/** @brief Stages timed by the cycle profiler (CONFIG_DOMATOR_PROFILER). */
+typedef enum {
+    PROF_RX_FIRST,  // root_handle_mesh_message(), one stage per 'A'..'Z'
+    PROF_REGISTRY_LOOKUP = PROF_RX_FIRST + 26,
+    PROF_ROUTE_LOOKUP,
+    PROF_TX_ENQUEUE,
+    PROF_MQTT_PUBLISH,
+    PROF_CONFIG_PARSE,
+    PROF_STAGE_COUNT,
+} prof_stage_t;
+
+#if CONFIG_DOMATOR_PROFILER
+
+#include "esp_cpu.h"
+
+/** @brief Cycle histogram of one stage; bucket i counts [2^(i-1), 2^i). */
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[PROF_BUCKETS];
+} prof_hist_t;
+
+/** @brief Add one sample (in CPU cycles) to a stage.  Lock-free. */
+void profiler_record(prof_stage_t stage, uint32_t cycles);
+
+/** @brief Copy one stage's histogram. */
+void profiler_get(prof_stage_t stage, prof_hist_t* out);
+
+/** @brief Clear all histograms. */
+void profiler_reset(void);
+
+/** @brief Short name of a stage ("rxB", "route", ...). */
+const char* profiler_stage_name(prof_stage_t stage, char* buf, size_t len);
+
+/** @brief Publish all non-empty histograms on /switch/profile/<id>. */
+void profiler_publish(void);
+
+typedef struct {
+    prof_stage_t stage;
+    uint32_t start;
+} prof_scope_t;
+
+static inline void prof_scope_end(prof_scope_t* scope) {
+    profiler_record(scope->stage, esp_cpu_get_cycle_count() - scope->start);
+}
+
+/** @brief Time the rest of the enclosing block as one sample of stage. */
+#define PROF_SCOPE(stage)                                                     \
+    prof_scope_t _prof_scope __attribute__((cleanup(prof_scope_end))) = {     \
+        (stage), esp_cpu_get_cycle_count()}
+
+/** @brief RX dispatch stage of a MSG_TYPE_* letter (anything else: 'A'). */
+#define PROF_RX_STAGE(type)                                                   \
+    ((type) >= 'A' && (type) <= 'Z' ? PROF_RX_FIRST + (type) - 'A'            \
+                                    : PROF_RX_FIRST)
+
+#else
+
+#define PROF_SCOPE(stage)                                                     \
+    do {                                                                      \
+    } while (0)
+
+#endif  // CONFIG_DOMATOR_PROFILER
+
+// ====================
+// Function Declarations: boot_report.c
+// ====================
+
+/** @brief Record that a boot phase was reached (only the first time counts). */
+void boot_mark(boot_phase_t phase);
+
+/** @brief Milliseconds since start-up when a phase was reached, or 0. */
+uint32_t boot_phase_ms(boot_phase_t phase);
+
+/** @brief Short name of a boot phase ("nvs", "parent", ...). */
+const char* boot_phase_name(boot_phase_t phase);
+
+/**
+ * @brief Send the boot report once the first route happened or
+ *        BOOT_REPORT_TIMEOUT_MS has passed.  Called from status_report_task().
+ */
+void boot_report_poll(void);
+
+// ====================
+// Function Declarations: failover.c
+// ====================
+
+/**
+ * @brief Record a failover event.  Episode-opening events start a new
+ *        timeline when none is open; any event counts only the first time.
+ */
+void failover_mark(failover_event_t event);
+
+/** @brief This node's stamp of an event in the open or last episode. */
+failover_stamp_t failover_stamp(failover_event_t event);
+
+/** @brief Short name of a failover event ("parentLost", "mqtt", ...). */
+const char* failover_event_name(failover_event_t event);
+
+/**
+ * @brief Send this node's timeline to the new root once it is back in the
+ *        mesh; on the root, publish the failover report once the first
+ *        route happened or FAILOVER_REPORT_TIMEOUT_MS has passed.  Called
+ *        from status_report_task().
+ */
+void failover_poll(void);
+
+/**
+ * @brief Root: add a node's MSG_TYPE_FAILOVER timeline to the report of the
+ *        failover this root took over from.
+ */
+void failover_handle_report(const mesh_app_msg_t* msg);
+
+// ====================
+// Function Declarations: standby.c
+// ====================
+
+/** @brief What the shell shows of the standby state. */
+typedef struct {
+    uint8_t role;          // this node's ROOT_ROLE_*
+    uint64_t target_id;    // root: node kept in sync, 0 if none
+    uint8_t target_role;
+    bool target_synced;    // root: full state sent to the target
+    int nodes;             // standby: replicated registry entries
+    int configs;           // configurations held (REPLICA_CFG_*)
+    int outputs;           // relay boards in the output cache
+    uint32_t updated_ms;   // standby: ms since the last replica frame
+} standby_status_t;
+
+/**
+ * @brief Load the root role from NVS; a node with a role starts the standby
+ *        task now, any other node when it becomes root.  Called once from
+ *        app_main().
+ */
+void standby_init(void);
+
+/** @brief This node's ROOT_ROLE_*. */
+uint8_t standby_role(void);
+
+/** @brief "none", "standby" or "preferred". */
+const char* standby_role_name(uint8_t role);
+
+/** @brief Parse a role name; false if it is not one. */
+bool standby_parse_role(const char* name, uint8_t* role);
+
+/**
+ * @brief Store a new root role in NVS and announce it to the root with a
+ *        fresh MSG_TYPE_TYPE_INFO.
+ */
+void standby_set_role(uint8_t role);
+
+/**
+ * @brief Root: a node (re)registered; pick the standby again and mark the
+ *        registry for resending.
+ */
+void standby_node_joined(void);
+
+/**
+ * @brief Root: keep a copy of a configuration command that was applied and
+ *        mark it for sending to the standby.
+ */
+void standby_config_applied(replica_config_t kind, const char* json, int len);
+
+/**
+ * @brief Root: track a MSG_TYPE_RELAY_STATE; a change marks the outputs for
+ *        sending.
+ */
+void standby_output_changed(uint64_t device_id, char relay, char state);
+
+/** @brief Standby: store one MSG_TYPE_REPLICA frame from the root. */
+void standby_handle_replica(const mesh_app_msg_t* msg);
+
+/**
+ * @brief New root: have the standby task load the replicated registry and
+ *        replay the replicated configuration.  Called from node_root_start().
+ */
+void standby_on_root_start(void);
+
+/** @brief Former root: forget the root state.  Called from node_root_stop(). */
+void standby_on_root_stop(void);
+
+/** @brief New root: publish the cached relay outputs once MQTT is up. */
+void standby_on_mqtt_connected(void);
+
+/**
+ * @brief Root: apply a pending takeover, pick the standby, queue the next
+ *        few replica frames and hand the root over when the standby outranks
+ *        this node.  Called from the standby task, at most every
+ *        REPLICA_POLL_MS.
+ */
+void standby_poll(void);
+
+/** @brief Snapshot for the shell. */
+void standby_get_status(standby_status_t* out);
+
+// ====================
+// Function Declarations: fast_boot.c
+// ====================
+
+/** @brief Use the cached hardware type; false if the probes must run. */
+bool fast_boot_load_hw(void);
+
+/** @brief Cache a probed hardware type after a successful boot. */
+void fast_boot_save_hw(void);
+
+/** @brief Set the NVS flag that forces hardware probing on next boot. */
+void fast_boot_request_redetect(void);
+
+/**
+ * @brief Arm a directed rejoin to the last parent.
+ * @return true if self-organisation was left off for the attempt.
+ */
+bool fast_boot_rejoin_prepare(void);
+
+/** @brief Mesh started: call esp_mesh_set_parent() if a rejoin is armed. */
+void fast_boot_on_mesh_started(void);
+
+/** @brief Parent connected: end the rejoin attempt, cache the parent. */
+void fast_boot_on_parent_connected(const mesh_event_connected_t* connected);
+
+/** @brief Parent lost / not found: fall back to a full scan if armed. */
+void fast_boot_on_parent_lost(void);
+
+// ====================
+// Function Declarations: trace.c
+// ====================
+
+/** @brief Custom trace markers (instant events with a 32-bit value). */
+typedef enum {
+    TRACE_MARK_MESH_RX,   // value: msg_type
+    TRACE_MARK_MESH_TX,   // value: msg_type
+    TRACE_MARK_MQTT_CMD,  // value: payload length
+    TRACE_MARK_BUTTON,    // value: button index
+    TRACE_MARK_COUNT,
+} trace_marker_t;
+
+#define TRACE_ISR_BUTTON 0x100  // trace ISR id of the button GPIO ISR
+
+#if CONFIG_DOMATOR_TRACE
+
+#include "trace_hooks.h"
+
+/** @brief One trace record; time is esp_timer_get_time() truncated. */
+typedef struct {
+    uint32_t time_us;
+    uint32_t obj;  // task/queue handle or marker value
+    uint8_t type;  // TRACE_EV_*
+    uint8_t core;
+    uint16_t arg;  // ISR id, marker id, or 1 for a failed queue send
+} trace_event_t;
+
+/**
+ * @brief Clear the buffer and start recording.
+ * @param oneshot Stop when the buffer is full instead of overwriting the
+ *                oldest events.
+ */
+void trace_start(bool oneshot);
+
+/** @brief Stop recording; the buffer is kept for trace_dump(). */
+void trace_stop(void);
+
+/** @brief True while recording. */
+bool trace_active(void);
+
+/** @brief Number of events recorded since trace_start() (may exceed size). */
+uint32_t trace_recorded(void);
+
+/**
+ * @brief Stop recording and print the buffer as "@T:" text lines for
+ *        tools/trace_export.py.
+ * @param print printf-like sink, e.g. shell_printf.
+ */
+void trace_dump(int (*print)(const char* fmt, ...));
+
+void trace_mark(trace_marker_t id, uint32_t value);
+void trace_isr_enter(uint32_t isr);
+void trace_isr_exit(uint32_t isr);
+
+#define TRACE_MARK(id, value) trace_mark((id), (value))
+#define TRACE_ISR_ENTER(isr) trace_isr_enter(isr)
+#define TRACE_ISR_EXIT(isr) trace_isr_exit(isr)
+
+#else
+
+#define TRACE_MARK(id, value)                                                 \
+    do {                                                                      \
+    } while (0)
+#define TRACE_ISR_ENTER(isr)                                                  \
+    do {                                                                      \
+    } while (0)
+#define TRACE_ISR_EXIT(isr)                                                   \
+    do {                                                                      \
+    } while (0)
+
+#endif  // CONFIG_DOMATOR_TRACE
+
+// ====================
+// Function Declarations: capture.c
+// ====================
+
+/*
+ * Capture format, shared by the root's capture stream, the files
+ * tools/mesh_capture.py saves and domator_replay.  Laid out like pcap: one
+ * capture_file_hdr_t, then records, each a capture_rec_hdr_t followed by
+ * @c len payload bytes.  All fields are little-endian.
+ */
+#define CAPTURE_MAGIC 0x50434D44  // "DMCP"
+#define CAPTURE_VERSION 1
+
+typedef struct {
+    uint32_t magic;      // CAPTURE_MAGIC
+    uint16_t version;    // CAPTURE_VERSION
+    uint16_t hdr_size;   // sizeof(capture_file_hdr_t)
+    uint32_t snaplen;    // payload bytes kept per record
+    uint32_t reserved;
+    uint64_t device_id;  // the capturing root
+    int64_t start_us;    // esp_timer_get_time() when the capture began
+} __attribute__((packed)) capture_file_hdr_t;
+
+typedef enum {
+    CAPTURE_REC_MESH_RX = 1,  // peer[6], message header, data[data_len]
+    CAPTURE_REC_MESH_TX,      // same; an all-zero peer means "to root"
+    CAPTURE_REC_MQTT_IN,      // topic length (1 byte), topic, payload
+    CAPTURE_REC_MQTT_OUT,     // same
+    CAPTURE_REC_DROP,         // uint32 records lost to a full buffer
+} capture_rec_kind_t;
+
+#define CAPTURE_FLAG_TRUNCATED 0x01  // payload cut at snaplen
+#define CAPTURE_FLAG_RETAIN 0x02     // MQTT_OUT published with retain
+
+typedef struct {
+    uint32_t ts_sec;  // time since capture_file_hdr_t.start_us
+    uint32_t ts_usec;
+    uint16_t len;   // payload bytes after this header
+    uint8_t kind;   // capture_rec_kind_t
+    uint8_t flags;  // CAPTURE_FLAG_*
+} __attribute__((packed)) capture_rec_hdr_t;
+
+/** @brief Bytes of mesh_app_msg_t in front of data[]. */
+#define CAPTURE_MSG_HDR_SIZE offsetof(mesh_app_msg_t, data)
+
+#if CONFIG_DOMATOR_CAPTURE
+
+/** @brief Start the capture server (root only).  Idempotent. */
+void capture_start(void);
+
+/** @brief Close the capture client and stop the server task. */
+void capture_stop(void);
+
+/** @brief True while a host is connected and records are streamed. */
+bool capture_active(void);
+
+/** @brief Records streamed and lost since the current client connected. */
+void capture_get_stats(uint32_t* records, uint32_t* dropped);
+
+/**
+ * @brief Record a mesh frame received from or sent to @p peer (NULL for
+ *        the root).  Only the used part of msg->data is kept.
+ */
+void capture_mesh(capture_rec_kind_t kind, const mesh_addr_t* peer,
+                  const mesh_app_msg_t* msg);
+
+/** @brief Record an MQTT message; @p topic_len < 0 means NUL-terminated. */
+void capture_mqtt(capture_rec_kind_t kind, const char* topic, int topic_len,
+                  const char* data, int data_len, bool retain);
+
+#define CAPTURE_MESH(kind, peer, msg) capture_mesh((kind), (peer), (msg))
+#define CAPTURE_MQTT(kind, topic, topic_len, data, data_len, retain)          \
+    capture_mqtt((kind), (topic), (topic_len), (data), (data_len), (retain))
+
+#else
+
+#define capture_start()                                                       \
+    do {                                                                      \
+    } while (0)
+#define capture_stop()                                                        \
+    do {                                                                      \
+    } while (0)
+#define CAPTURE_MESH(kind, peer, msg)                                         \
+    do {                                                                      \
+    } while (0)
+#define CAPTURE_MQTT(kind, topic, topic_len, data, data_len, retain)          \
+    do {                                                                      \
+    } while (0)
+
+#endif  // CONFIG_DOMATOR_CAPTURE
+
+// ====================
+// Function Declarations: lat_hist.c
+// ====================
+
+#define LAT_HIST_BUCKETS 96  // log-linear, up to ~33 s
+
+/**
+ * @brief Latency histogram in µs: exact below 4, then four buckets per
+ *        power of two, so quantiles are within 25 %.  Also a wire format
+ *        (link probe results).
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LAT_HIST_BUCKETS];
+} __attribute__((packed)) lat_hist_t;
+
+/** @brief Add one sample; negative values count as 0. */
+void lat_hist_add(lat_hist_t* h, int64_t us);
+
+/** @brief Upper bound of the @p permille quantile, clamped to the max. */
+uint32_t lat_hist_quantile(const lat_hist_t* h, int permille);
+
+/** @brief Add {n, min, mean, p50, p90, p99, max} as object @p name. */
+void lat_hist_add_json(struct cJSON* parent, const char* name,
+                       const lat_hist_t* h);
+
+// ====================
+// Function Declarations: bench.c
+// ====================
+
+/*
+ * Benchmark mode.  MSG_TYPE_BENCH carries a BENCH_OP_* in data[0] followed
+ * by the struct named below.  The synthetic presses themselves are ordinary
+ * MSG_TYPE_BUTTON frames, and the commands routed from them ordinary
+ * MSG_TYPE_COMMAND frames; both carry a bench_tag_t after the NUL that ends
+ * their normal data, which older handlers never read.
+ */
+#define BENCH_OP_START 's'    // root → switch: bench_params_t
+#define BENCH_OP_STOP 'x'     // root → switch: end the run now
+#define BENCH_OP_DONE 'd'     // switch → root: bench_done_t
+#define BENCH_OP_APPLIED 'a'  // relay → root: bench_applied_t
+
+#define BENCH_TAG_MAGIC 0xBE4C
+#define BENCH_FLAG_DRY_RUN 0x01  // relay reports the command, outputs stay
+
+#define BENCH_MAX_RATE 50          // presses per second per switch
+#define BENCH_MAX_DURATION_S 600
+#define BENCH_DONE_TIMEOUT_MS 5000  // wait for late BENCH_OP_DONE reports
+#define BENCH_SETTLE_MS 2000        // wait for the last applied reports
+
+typedef enum {
+    BENCH_PATTERN_UNIFORM = 0,  // fixed gap
+    BENCH_PATTERN_POISSON,      // exponential gaps, same mean
+    BENCH_PATTERN_BURST,        // `burst` presses back to back, then a gap
+} bench_pattern_t;
+
+/** @brief Trailer of a synthetic press and of the commands routed from it. */
+typedef struct {
+    uint16_t magic;  // BENCH_TAG_MAGIC
+    uint8_t flags;   // BENCH_FLAG_*
+    uint8_t reserved;
+    uint32_t run_id;
+    uint32_t seq;    // frame number within the switch's run
+    int64_t gen_us;  // switch mesh time when generated, 0 if unsynced
+} __attribute__((packed)) bench_tag_t;
+
+/** @brief BENCH_OP_START: what one switch generates. */
+typedef struct {
+    uint32_t run_id;
+    uint32_t interval_us;  // mean gap between presses
+    uint32_t duration_ms;
+    uint8_t pattern;       // bench_pattern_t
+    uint8_t burst;         // presses per burst (BENCH_PATTERN_BURST)
+    uint8_t buttons;       // presses cycle through 'a'..'a'+buttons-1
+    uint8_t flags;         // BENCH_FLAG_*
+} __attribute__((packed)) bench_params_t;
+
+/** @brief BENCH_OP_DONE: a switch's totals, sent after its last press. */
+typedef struct {
+    uint32_t run_id;
+    uint32_t frames;      // MSG_TYPE_BUTTON frames generated
+    uint32_t queue_full;  // of those, refused by the local TX queue
+} __attribute__((packed)) bench_done_t;
+
+/** @brief BENCH_OP_APPLIED: a relay handled a tagged command. */
+typedef struct {
+    bench_tag_t tag;     // copied from the command
+    int64_t applied_us;  // relay mesh time when handled, 0 if unsynced
+} __attribute__((packed)) bench_applied_t;
+
+/** @brief Read the bench_tag_t trailer of a frame; false if it has none. */
+bool bench_tag_get(const mesh_app_msg_t* msg, bench_tag_t* tag);
+
+/** @brief Append a bench_tag_t after the NUL that ends msg->data. */
+void bench_tag_put(mesh_app_msg_t* msg, const bench_tag_t* tag);
+
+/**
+ * @brief Root: handle the "bench" JSON command (start a run, or stop the
+ *        running one with "stop":true).
+ */
+void bench_root_command(const struct cJSON* json);
+
+/**
+ * @brief Root: account for a tagged MSG_TYPE_BUTTON and set the tag's flags
+ *        for the commands routed from it.
+ * @return false if the frame is not from the current run (drop it).
+ */
+bool bench_root_on_button(const mesh_app_msg_t* msg, bench_tag_t* tag);
+
+/** @brief Root: one tagged command was routed (queued or not). */
+void bench_root_on_command(bool queued);
+
+/** @brief Root: handle BENCH_OP_DONE and BENCH_OP_APPLIED from nodes. */
+void bench_root_handle(const mesh_app_msg_t* msg);
+
+/** @brief Switch: handle BENCH_OP_START and BENCH_OP_STOP from the root. */
+void bench_switch_handle(const mesh_app_msg_t* msg);
+
+/** @brief Relay: report a tagged command to the root. */
+void bench_relay_applied(const bench_tag_t* tag);
+
+// ====================
+// Function Declarations: link_probe.c
+// ====================
+
+/*
+ * Link probe (MSG_TYPE_PROBE, op in data[0]).  Every frame after the op is a
+ * probe_frame_t unless noted.  DATA frames are full mesh_app_msg_t frames,
+ * like every application frame, so the numbers hold for OTA and config
+ * traffic too.
+ */
+#define PROBE_OP_BEGIN_DOWN 'b'  // root → node: reset the receive counters
+#define PROBE_OP_DATA 'd'        // either way: one test frame
+#define PROBE_OP_RESULT_REQ 'r'  // root → node: send PROBE_OP_RESULT
+#define PROBE_OP_RESULT 'R'      // node → root: probe_result_t
+#define PROBE_OP_BEGIN_UP 'u'    // root → node: probe_up_params_t
+#define PROBE_OP_UP_DONE 'U'     // node → root: probe_up_done_t
+#define PROBE_OP_ECHO_REQ 'e'    // root → node: echo this frame back
+#define PROBE_OP_ECHO 'E'        // node → root: the echoed frame
+
+#define PROBE_MAX_FRAMES 2000
+#define PROBE_MAX_PINGS 200
+#define PROBE_DRAIN_MS 500          // after a stream, before asking
+#define PROBE_REPLY_TIMEOUT_MS 2000  // per reply, and idle time per stream
+#define PROBE_ECHO_TIMEOUT_MS 1000
+#define PROBE_PING_GAP_MS 20
+
+typedef struct {
+    uint32_t run_id;
+    uint32_t seq;
+    int64_t tx_us;  // sender esp_timer time (echoes: the root's)
+} __attribute__((packed)) probe_frame_t;
+
+/** @brief What a node saw of a downstream stream. */
+typedef struct {
+    uint32_t run_id;
+    uint32_t received;
+    uint32_t reordered;  // frames with a lower seq than one already seen
+    uint32_t span_us;    // first to last frame received
+    uint8_t layer;       // mesh layer of the node (root = 1)
+    lat_hist_t latency;  // one-way, from mesh_time_us (synced frames only)
+} __attribute__((packed)) probe_result_t;
+
+typedef struct {
+    uint32_t run_id;
+    uint16_t frames;
+    uint8_t burst;    // frames sent back to back
+    uint8_t reserved;
+    uint16_t gap_ms;  // pause after each burst
+} __attribute__((packed)) probe_up_params_t;
+
+typedef struct {
+    uint32_t run_id;
+    uint32_t sent;
+    uint32_t failed;   // esp_mesh_send() errors
+    uint32_t span_us;  // first to last send
+    uint8_t layer;
+} __attribute__((packed)) probe_up_done_t;
+
+/**
+ * @brief Root: handle the "probe" JSON command.  Runs in its own task and
+ *        publishes the result on /switch/probe/<device id>.
+ */
+void link_probe_command(const struct cJSON* json);
+
+/**
+ * @brief Handle a MSG_TYPE_PROBE frame on any node.
+ * @param rx_local_us esp_timer_get_time() taken right after receive.
+ */
+void link_probe_handle_message(const mesh_app_msg_t* msg,
+                               int64_t rx_local_us);
+
+// ====================
+// Function Declarations: fault.c
+// ====================
+
+/*
+ * Fault injection in the mesh_comm.c send and receive paths
+ * (CONFIG_DOMATOR_FAULT).  Rules pick frames by message type and direction
+ * and drop, delay, duplicate or reorder a percentage of them.  Control and
+ * reports travel as MSG_TYPE_FAULT frames (FAULT_OP_* in data[0]), which are
+ * never faulted themselves.
+ */
+#define FAULT_OP_ADD 'a'         // fault_ctl_t: append ctl.rule
+#define FAULT_OP_CLEAR 'c'       // remove every rule, zero the counters
+#define FAULT_OP_DISCONNECT 'd'  // leave the parent (esp_mesh_disconnect)
+#define FAULT_OP_FREEZE 'f'      // fault_ctl_t: suspend ctl.task for ctl.ms
+#define FAULT_OP_REPORT_REQ 'r'  // answer with FAULT_OP_REPORT
+#define FAULT_OP_REPORT 'R'      // node → root: fault_report_t
+
+#define FAULT_MAX_RULES 8
+#define FAULT_HELD_MAX 8          // delayed/reordered frames per direction
+#define FAULT_REORDER_MAX_MS 1000  // longest a reordered frame waits
+#define FAULT_MAX_FREEZE_MS 60000
+
+#define FAULT_DIR_RX 0x01
+#define FAULT_DIR_TX 0x02
+
+/** @brief What the send or receive path does with one frame. */
+typedef enum {
+    FAULT_PASS,       // handle normally
+    FAULT_DROP,       // forget it (a send still reports ESP_OK)
+    FAULT_HOLD,       // taken by the fault layer, handled later
+    FAULT_DUPLICATE,  // handle twice
+} fault_verdict_t;
+
+typedef enum {
+    FAULT_ACT_DROP,
+    FAULT_ACT_DELAY,
+    FAULT_ACT_DUPLICATE,
+    FAULT_ACT_REORDER,
+    FAULT_ACT_COUNT,
+} fault_action_t;
+
+/**
+ * @brief One rule.  The percentages are tried in the order drop, delay,
+ *        duplicate, reorder and add up to at most 100.
+ */
+typedef struct {
+    uint8_t msg_type;     // MSG_TYPE_*, or 0 for every type
+    uint8_t dir;          // FAULT_DIR_* bits
+    uint8_t drop_pct;
+    uint8_t delay_pct;
+    uint8_t dup_pct;
+    uint8_t reorder_pct;  // held until the next frame in that direction
+    uint16_t delay_ms;    // also the reorder timeout when set
+} __attribute__((packed)) fault_rule_t;
+
+typedef struct {
+    uint8_t op;         // FAULT_OP_*
+    fault_rule_t rule;  // FAULT_OP_ADD
+    uint32_t ms;        // FAULT_OP_FREEZE
+    char task[16];      // FAULT_OP_FREEZE: FreeRTOS task name
+} __attribute__((packed)) fault_ctl_t;
+
+typedef struct {
+    uint32_t injected[2][FAULT_ACT_COUNT];  // [0] RX, [1] TX
+    uint32_t disconnects;
+    uint32_t freezes;
+    uint8_t rule_count;
+    fault_rule_t rules[FAULT_MAX_RULES];
+} __attribute__((packed)) fault_report_t;
+
+#if CONFIG_DOMATOR_FAULT
+
+/**
+ * @brief Root: handle the "fault" JSON command.  Works on the root itself
+ *        or, with "device", on any registered node.  The resulting
+ *        fault_report_t is published on /switch/fault/<device id>.
+ */
+void fault_command(const struct cJSON* json);
+
+/**
+ * @brief Apply @p ctl on @p device_id: here when it is 0 or this node,
+ *        otherwise sent to the node (root only).
+ * @return false if the node is unknown or the request was refused.
+ */
+bool fault_control(uint64_t device_id, const fault_ctl_t* ctl);
+
+/** @brief Current rules and counters of this node. */
+void fault_get_report(fault_report_t* report);
+
+/** @brief Handle a MSG_TYPE_FAULT frame (control on nodes, reports on root). */
+void fault_handle_message(const mesh_app_msg_t* msg);
+
+/** @brief Verdict for a frame about to be sent; FAULT_HOLD keeps a copy. */
+fault_verdict_t fault_on_tx(const mesh_addr_t* dest, const mesh_app_msg_t* msg);
+
+/** @brief Verdict for a received frame; FAULT_HOLD keeps a copy. */
+fault_verdict_t fault_on_rx(const mesh_addr_t* from, const mesh_app_msg_t* msg);
+
+/**
+ * @brief Next held received frame that is due, if any (mesh_rx_task only).
+ * @return true with the frame copied out.
+ */
+bool fault_rx_release(mesh_addr_t* from, mesh_app_msg_t* msg,
+                      int64_t* rx_local_us);
+
+/** @brief Shorten a receive timeout so held frames are released on time. */
+int fault_rx_timeout_ms(int timeout_ms);
+
+#define FAULT_TX(dest, msg) fault_on_tx((dest), (msg))
+#define FAULT_RX(from, msg) fault_on_rx((from), (msg))
+#define FAULT_RX_RELEASE(from, msg, rx_us)                                    \
+    fault_rx_release((from), (msg), (rx_us))
+#define FAULT_RX_TIMEOUT_MS(ms) fault_rx_timeout_ms(ms)
+
+#else
+
+#define FAULT_TX(dest, msg) FAULT_PASS
+#define FAULT_RX(from, msg) FAULT_PASS
+#define FAULT_RX_RELEASE(from, msg, rx_us) false
+#define FAULT_RX_TIMEOUT_MS(ms) (ms)
+
+#endif  // CONFIG_DOMATOR_FAULT
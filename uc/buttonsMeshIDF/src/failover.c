@@ -0,0 +1,414 @@
+/**
+ * @file failover.c
+ * @brief Root failover timeline and the failover report.
+ *
+ * Losing the root sets off a chain of events spread over many seconds and
+ * several nodes: the children of the dead root lose their parent, wait out
+ * the root healing delay and elect a new root, which gets an IP address,
+ * starts the MQTT client, receives its configuration from the backend and
+ * finally routes a command again.  failover_mark() stamps each
+ * failover_event_t on the node where it happens, with its uptime and, when
+ * the node has one, its mesh clock.  An episode opens with the first parent
+ * loss (or root switch request) and keeps the first occurrence of every
+ * event after it.
+ *
+ * A node that is back in the mesh sends its timeline to the root as
+ * MSG_TYPE_FAILOVER.  A root elected during an episode collects these
+ * timelines and, once it routed its first command or after
+ * FAILOVER_REPORT_TIMEOUT_MS, publishes the failover report as retained
+ * JSON on /switch/failover.  Timelines that arrive later update it.
+ *
+ * Report times are ms after detection, the earliest parent loss on any
+ * node.  A stamp taken without mesh time (a node that was never synced) is
+ * placed from its age when the timeline was sent, ignoring the transit
+ * time.  Mesh time itself runs on across the failover: the new root's
+ * system clock was kept on the old root's mesh clock (see time_sync.c).
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "mqtt_client.h"
+
+static const char* TAG = "FAILOVER";
+
+/** @brief A node's part in the failover, in mesh µs (0 if not reached). */
+typedef struct {
+    uint64_t device_id;
+    int64_t lost_us;
+    int64_t rejoined_us;
+} failover_node_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static failover_stamp_t s_at[FAILOVER_EV_COUNT];
+static bool s_open = false;     // episode running, events are recorded
+static bool s_pending = false;  // node: timeline not sent to the root yet
+
+// Root: the failover this root was elected in.
+static bool s_collecting = false;
+static bool s_published = false;
+static bool s_dirty = false;  // node timelines added since the last publish
+static int64_t s_elected_us = 0;
+static failover_node_t s_nodes[MAX_NODES];
+static int s_node_count = 0;
+
+static uint32_t uptime_ms(void) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    return now_ms ? now_ms : 1;  // 0 means "not reached"
+}
+
+/**
+ * @brief Mesh time of a stamp.  Stamps without mesh time are placed
+ *        (now_ms - at_ms) before @p now_mesh_us.
+ * @return Mesh µs, or 0 if the event was not reached.
+ */
+static int64_t stamp_mesh_us(const failover_stamp_t* stamp, uint32_t now_ms,
+                             int64_t now_mesh_us) {
+    if (stamp->at_ms == 0) return 0;
+    if (stamp->mesh_us != 0) return stamp->mesh_us;
+    return now_mesh_us - (int64_t)(now_ms - stamp->at_ms) * 1000;
+}
+
+/** @brief Earliest episode-opening event of a timeline, 0 if none. */
+static int64_t lost_mesh_us(const failover_stamp_t* at, uint32_t now_ms,
+                            int64_t now_mesh_us) {
+    int64_t lost_us = 0;
+    for (int i = FAILOVER_EV_PARENT_LOST; i <= FAILOVER_EV_SWITCH_REQ; i++) {
+        int64_t t = stamp_mesh_us(&at[i], now_ms, now_mesh_us);
+        if (t != 0 && (lost_us == 0 || t < lost_us)) lost_us = t;
+    }
+    return lost_us;
+}
+
+void failover_mark(failover_event_t event) {
+    if (event >= FAILOVER_EV_COUNT) return;
+
+    uint32_t now_ms = uptime_ms();
+    int64_t mesh_us = mesh_time_now_us();
+    bool marked = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_open && event <= FAILOVER_EV_SWITCH_REQ) {
+        memset(s_at, 0, sizeof(s_at));
+        s_open = true;
+        s_pending = false;
+        s_collecting = false;
+    }
+    if (s_open && s_at[event].at_ms == 0) {
+        s_at[event].at_ms = now_ms;
+        s_at[event].mesh_us = mesh_us;
+        marked = true;
+        if (event == FAILOVER_EV_PARENT) {
+            s_pending = true;
+        } else if (event == FAILOVER_EV_ROOT) {
+            // Our timeline is the root's now; start collecting the others.
+            s_pending = false;
+            s_collecting = true;
+            s_published = false;
+            s_dirty = false;
+            s_elected_us = mesh_us ? mesh_us : esp_timer_get_time();
+            s_node_count = 0;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (marked) {
+        ESP_LOGI(TAG, "Failover event %s at %" PRIu32 " ms",
+                 failover_event_name(event), now_ms);
+    }
+}
+
+failover_stamp_t failover_stamp(failover_event_t event) {
+    failover_stamp_t stamp = {0};
+    if (event >= FAILOVER_EV_COUNT) return stamp;
+    portENTER_CRITICAL(&s_lock);
+    stamp = s_at[event];
+    portEXIT_CRITICAL(&s_lock);
+    return stamp;
+}
+
+const char* failover_event_name(failover_event_t event) {
+    switch (event) {
+        case FAILOVER_EV_PARENT_LOST:
+            return "parentLost";
+        case FAILOVER_EV_NO_PARENT:
+            return "noParent";
+        case FAILOVER_EV_SWITCH_REQ:
+            return "switchReq";
+        case FAILOVER_EV_SWITCH_ACK:
+            return "switchAck";
+        case FAILOVER_EV_PARENT:
+            return "parent";
+        case FAILOVER_EV_ROOT:
+            return "election";
+        case FAILOVER_EV_GOT_IP:
+            return "ip";
+        case FAILOVER_EV_MQTT_INIT:
+            return "mqttInit";
+        case FAILOVER_EV_MQTT:
+            return "mqtt";
+        case FAILOVER_EV_CONFIG:
+            return "config";
+        case FAILOVER_EV_FIRST_ROUTE:
+            return "firstRoute";
+        default:
+            return "unknown";
+    }
+}
+
+// ====================
+// Node Side
+// ====================
+
+/** @brief Send the episode's timeline to the root and close the episode. */
+static void failover_send_timeline(void) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_FAILOVER;
+
+    failover_report_t report = {
+        .event_count = FAILOVER_EV_COUNT,
+        .now_ms = uptime_ms(),
+    };
+    portENTER_CRITICAL(&s_lock);
+    memcpy(report.at, s_at, sizeof(report.at));
+    portEXIT_CRITICAL(&s_lock);
+    memcpy(msg.data, &report, sizeof(report));
+    msg.data_len = sizeof(report);
+
+    if (!mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL)) {
+        ESP_LOGW(TAG, "Failover timeline not queued, retrying later");
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_pending = false;
+    s_open = false;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Failover timeline sent to root");
+}
+
+// ====================
+// Root Side
+// ====================
+
+void failover_handle_report(const mesh_app_msg_t* msg) {
+    failover_report_t report = {0};
+    size_t header = offsetof(failover_report_t, at);
+    if (msg->data_len < header) {
+        ESP_LOGW(TAG, "Short failover timeline from %" PRIu64, msg->src_id);
+        return;
+    }
+    memcpy(&report, msg->data,
+           msg->data_len < sizeof(report) ? msg->data_len : sizeof(report));
+    int events = report.event_count < FAILOVER_EV_COUNT ? report.event_count
+                                                        : FAILOVER_EV_COUNT;
+    if (msg->data_len < header + events * sizeof(failover_stamp_t)) {
+        ESP_LOGW(TAG, "Truncated failover timeline from %" PRIu64,
+                 msg->src_id);
+        return;
+    }
+    for (int i = events; i < FAILOVER_EV_COUNT; i++) {
+        report.at[i] = (failover_stamp_t){0};
+    }
+
+    int64_t now_mesh_us = mesh_time_now_us();
+    int64_t lost_us = lost_mesh_us(report.at, report.now_ms, now_mesh_us);
+    int64_t rejoined_us = stamp_mesh_us(&report.at[FAILOVER_EV_PARENT],
+                                        report.now_ms, now_mesh_us);
+
+    bool added = false;
+    portENTER_CRITICAL(&s_lock);
+    if (s_collecting && lost_us != 0 &&
+        lost_us >= s_elected_us - (int64_t)FAILOVER_WINDOW_MS * 1000) {
+        int slot = 0;
+        while (slot < s_node_count &&
+               s_nodes[slot].device_id != msg->src_id) {
+            slot++;
+        }
+        if (slot < MAX_NODES) {
+            if (slot == s_node_count) s_node_count++;
+            s_nodes[slot].device_id = msg->src_id;
+            s_nodes[slot].lost_us = lost_us;
+            s_nodes[slot].rejoined_us = rejoined_us;
+            s_dirty = true;
+            added = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (added) {
+        ESP_LOGI(TAG,
+                 "Failover timeline from %" PRIu64 ": rejoined %lld ms after "
+                 "losing its parent",
+                 msg->src_id,
+                 rejoined_us ? (long long)((rejoined_us - lost_us) / 1000)
+                             : -1LL);
+    } else {
+        ESP_LOGI(TAG,
+                 "Timeline from %" PRIu64 " is not part of a root failover",
+                 msg->src_id);
+    }
+}
+
+/** @brief Keep the earlier of two mesh times (0 = none) and who it was. */
+static void keep_earliest(int64_t* best_us, uint64_t* best_id, int64_t t,
+                          uint64_t device_id) {
+    if (t == 0) return;
+    if (*best_us == 0 || t < *best_us) {
+        *best_us = t;
+        *best_id = device_id;
+    }
+}
+
+/**
+ * @brief Publish the failover report as retained JSON on /switch/failover.
+ *
+ * Payload: {"root":N,"healingMs":N,"vote":0.6,"detectedBy":N,
+ *           "detectedAt":N,"phases":{"parentLost":0,"election":N,"ip":N,
+ *           "mqttInit":N,"mqtt":N,"config":N,"firstRoute":N},
+ *           "nodes":[{"id":N,"lost":N,"rejoined":N}],
+ *           "rejoined":N,"lastRejoin":N}
+ * Times are ms after detection; "detectedAt" (Unix ms) only when the wall
+ * clock is valid.  Phases and node fields not reached are left out.
+ */
+static void failover_publish(void) {
+    static failover_node_t nodes[MAX_NODES];
+    failover_stamp_t at[FAILOVER_EV_COUNT];
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(at, s_at, sizeof(at));
+    int count = s_node_count;
+    memcpy(nodes, s_nodes, count * sizeof(nodes[0]));
+    s_dirty = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    uint32_t now_ms = uptime_ms();
+    int64_t now_mesh_us = mesh_time_now_us();
+    int64_t own_us[FAILOVER_EV_COUNT];
+    for (int i = 0; i < FAILOVER_EV_COUNT; i++) {
+        own_us[i] = stamp_mesh_us(&at[i], now_ms, now_mesh_us);
+    }
+
+    int64_t detect_us = 0;
+    uint64_t detect_by = 0;
+    keep_earliest(&detect_us, &detect_by,
+                  lost_mesh_us(at, now_ms, now_mesh_us), g_device_id);
+    for (int n = 0; n < count; n++) {
+        keep_earliest(&detect_us, &detect_by, nodes[n].lost_us,
+                      nodes[n].device_id);
+    }
+    if (detect_us == 0) return;
+
+    ESP_LOGI(TAG,
+             "Failover: detected by %" PRIu64 ", election +%lld ms, MQTT "
+             "+%lld ms, first route +%lld ms, %d node timeline(s)",
+             detect_by, (long long)(own_us[FAILOVER_EV_ROOT] - detect_us) / 1000,
+             own_us[FAILOVER_EV_MQTT]
+                 ? (long long)(own_us[FAILOVER_EV_MQTT] - detect_us) / 1000
+                 : -1LL,
+             own_us[FAILOVER_EV_FIRST_ROUTE]
+                 ? (long long)(own_us[FAILOVER_EV_FIRST_ROUTE] - detect_us) /
+                       1000
+                 : -1LL,
+             count);
+
+    if (!g_mqtt_connected) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+    cJSON_AddNumberToObject(json, "root", g_device_id);
+    cJSON_AddNumberToObject(json, "healingMs", MESH_ROOT_HEALING_DELAY_MS);
+    cJSON_AddNumberToObject(json, "vote", MESH_VOTE_PERCENTAGE);
+    cJSON_AddNumberToObject(json, "detectedBy", detect_by);
+    if (time_sync_is_valid()) {
+        cJSON_AddNumberToObject(json, "detectedAt",
+                                (double)(detect_us / 1000));
+    }
+
+    cJSON* phases = cJSON_AddObjectToObject(json, "phases");
+    for (int i = 0; i < FAILOVER_EV_COUNT; i++) {
+        if (own_us[i] == 0) continue;
+        cJSON_AddNumberToObject(phases, failover_event_name(i),
+                                (double)((own_us[i] - detect_us) / 1000));
+    }
+
+    cJSON* arr = cJSON_AddArrayToObject(json, "nodes");
+    int rejoined = 0;
+    int64_t last_rejoin_us = 0;
+    for (int n = 0; n < count; n++) {
+        cJSON* node = cJSON_CreateObject();
+        if (node == NULL) break;
+        cJSON_AddNumberToObject(node, "id", nodes[n].device_id);
+        cJSON_AddNumberToObject(node, "lost",
+                                (double)((nodes[n].lost_us - detect_us) / 1000));
+        if (nodes[n].rejoined_us != 0) {
+            cJSON_AddNumberToObject(
+                node, "rejoined",
+                (double)((nodes[n].rejoined_us - detect_us) / 1000));
+            rejoined++;
+            if (nodes[n].rejoined_us > last_rejoin_us) {
+                last_rejoin_us = nodes[n].rejoined_us;
+            }
+        }
+        cJSON_AddItemToArray(arr, node);
+    }
+    cJSON_AddNumberToObject(json, "rejoined", rejoined);
+    if (last_rejoin_us != 0) {
+        cJSON_AddNumberToObject(json, "lastRejoin",
+                                (double)((last_rejoin_us - detect_us) / 1000));
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise failover report");
+        return;
+    }
+    esp_mqtt_client_publish(g_mqtt_client, "/switch/failover", json_str, 0, 1,
+                            1);
+    cJSON_free(json_str);
+}
+
+/** @brief Publish once the first route happened or waiting timed out. */
+static void failover_root_poll(void) {
+    portENTER_CRITICAL(&s_lock);
+    bool collecting = s_collecting;
+    bool published = s_published;
+    bool dirty = s_dirty;
+    uint32_t elected_ms = s_at[FAILOVER_EV_ROOT].at_ms;
+    bool routed = s_at[FAILOVER_EV_FIRST_ROUTE].at_ms != 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!collecting || !g_mqtt_connected) return;
+    if (published) {
+        if (dirty) failover_publish();
+        return;
+    }
+    if (!routed && uptime_ms() - elected_ms < FAILOVER_REPORT_TIMEOUT_MS) {
+        return;
+    }
+
+    failover_publish();
+    portENTER_CRITICAL(&s_lock);
+    s_published = true;
+    s_open = false;  // later events belong to no failover
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void failover_poll(void) {
+    if (g_is_root) {
+        failover_root_poll();
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool pending = s_pending;
+    portEXIT_CRITICAL(&s_lock);
+    if (pending && g_mesh_connected) failover_send_timeline();
+}
@@ -0,0 +1,281 @@
+/**
+ * @file fast_boot.c
+ * @brief Fast boot path: cached hardware detection and directed mesh rejoin.
+ *
+ * Hardware: detect_hardware_type() probes GPIOs with settle delays on every
+ * boot.  Once a boot has been successful (its boot report went out), the
+ * probed type is stored in NVS and later boots take it from there.  The
+ * "redetect" shell/root command sets a flag that forces one more probe; the
+ * NVS override key ``hardware_type`` still wins over both.
+ *
+ * Mesh: on every parent connection of a non-root node the parent's SSID,
+ * BSSID, channel and our layer are stored (only when they changed).  On the
+ * next boot the mesh starts with self-organisation off and
+ * esp_mesh_set_parent() aims straight at that parent.  If the parent does
+ * not accept us within FAST_REJOIN_TIMEOUT_MS, or the attempt fails, normal
+ * self-organised networking (full scan and parent selection) is turned back
+ * on.  A node that was root last time does not use the cache, so root
+ * election is never skipped.
+ */
+
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "nvs.h"
+
+static const char* TAG = "FAST_BOOT";
+
+#define NVS_FAST_BOOT_NAMESPACE "fast_boot"
+
+/** Cached parent, stored as one blob. */
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t layer;  // our own layer under this parent
+} fast_boot_parent_t;
+
+static bool s_hw_probed = false;  // this boot ran the GPIO probes
+
+static fast_boot_parent_t s_parent;
+static bool s_parent_valid = false;
+static bool s_rejoin_pending = false;
+static int64_t s_rejoin_start_us = 0;
+static esp_timer_handle_t s_rejoin_timer = NULL;
+
+// ====================
+// Hardware Type Cache
+// ====================
+
+/**
+ * @brief Take the hardware type from the NVS cache.
+ * @return true if g_node_type/g_board_type were set and probing can be
+ *         skipped; false if the probes must run (no cache or re-detect
+ *         requested).
+ */
+bool fast_boot_load_hw(void) {
+    s_hw_probed = true;
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_FAST_BOOT_NAMESPACE, NVS_READONLY, &nvs_handle) !=
+        ESP_OK) {
+        return false;
+    }
+    uint8_t redetect = 0;
+    uint8_t hw = 0xFF;
+    nvs_get_u8(nvs_handle, "redetect", &redetect);
+    esp_err_t err = nvs_get_u8(nvs_handle, "hw", &hw);
+    nvs_close(nvs_handle);
+
+    if (redetect) {
+        ESP_LOGI(TAG, "Re-detect requested, probing hardware");
+        return false;
+    }
+    if (err != ESP_OK) return false;
+
+    switch (hw) {
+        case 0:
+            g_node_type = NODE_TYPE_SWITCH_C3;
+            break;
+        case 1:
+            g_node_type = NODE_TYPE_RELAY_8;
+            g_board_type = BOARD_TYPE_8_RELAY;
+            break;
+        case 2:
+            g_node_type = NODE_TYPE_RELAY_16;
+            g_board_type = BOARD_TYPE_16_RELAY;
+            break;
+        default:
+            ESP_LOGW(TAG, "Invalid cached hardware type %d", hw);
+            return false;
+    }
+    s_hw_probed = false;
+    ESP_LOGI(TAG, "Hardware type from cache: %d (probes skipped)", hw);
+    return true;
+}
+
+/**
+ * @brief Store the probed hardware type and clear the re-detect flag.  Call
+ *        once the boot proved good; does nothing if the type came from the
+ *        cache or the NVS override.
+ */
+void fast_boot_save_hw(void) {
+    if (!s_hw_probed) return;
+    s_hw_probed = false;
+
+    uint8_t hw = 0;
+    if (g_node_type == NODE_TYPE_RELAY_16) {
+        hw = 2;
+    } else if (g_node_type == NODE_TYPE_RELAY_8) {
+        hw = 1;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err =
+        nvs_open(NVS_FAST_BOOT_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return;
+    }
+    err = nvs_set_u8(nvs_handle, "hw", hw);
+    nvs_erase_key(nvs_handle, "redetect");
+    if (err == ESP_OK) err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to cache hardware type: %s",
+                 esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Hardware type %d cached", hw);
+    }
+}
+
+/** @brief Probe the hardware again on the next boot. */
+void fast_boot_request_redetect(void) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err =
+        nvs_open(NVS_FAST_BOOT_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u8(nvs_handle, "redetect", 1);
+        if (err == ESP_OK) err = nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set re-detect flag: %s",
+                 esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Hardware will be re-detected on next boot");
+}
+
+// ====================
+// Directed Rejoin
+// ====================
+
+/** @brief Leave the directed attempt and let the mesh scan normally. */
+static void rejoin_fallback(const char* why) {
+    if (!__atomic_exchange_n(&s_rejoin_pending, false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    esp_timer_stop(s_rejoin_timer);
+    ESP_LOGW(TAG, "Directed rejoin failed (%s), falling back to full scan",
+             why);
+    esp_err_t err = esp_mesh_set_self_organized(true, true);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to re-enable self-organisation: %s",
+                 esp_err_to_name(err));
+    }
+}
+
+static void rejoin_timeout_cb(void* arg) { rejoin_fallback("timeout"); }
+
+/**
+ * @brief Decide how the mesh starts.  Call from mesh_network_init() in place
+ *        of enabling self-organisation.
+ * @return true if a directed rejoin is armed (self-organisation is off until
+ *         it succeeds or falls back); false to start normally.
+ */
+bool fast_boot_rejoin_prepare(void) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_FAST_BOOT_NAMESPACE, NVS_READONLY, &nvs_handle) !=
+        ESP_OK) {
+        return false;
+    }
+    size_t size = sizeof(s_parent);
+    esp_err_t err = nvs_get_blob(nvs_handle, "parent", &s_parent, &size);
+    nvs_close(nvs_handle);
+
+    s_parent_valid = err == ESP_OK && size == sizeof(s_parent) &&
+                     s_parent.ssid_len <= sizeof(s_parent.ssid) &&
+                     s_parent.layer >= 2;
+    if (!s_parent_valid) return false;
+
+    if (s_rejoin_timer == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = rejoin_timeout_cb,
+            .name = "fast_rejoin",
+        };
+        if (esp_timer_create(&args, &s_rejoin_timer) != ESP_OK) return false;
+    }
+    if (esp_mesh_set_self_organized(false, false) != ESP_OK) return false;
+
+    s_rejoin_pending = true;
+    ESP_LOGI(TAG, "Directed rejoin armed: parent " MACSTR ", layer %d",
+             MAC2STR(s_parent.bssid), s_parent.layer);
+    return true;
+}
+
+/** @brief MESH_EVENT_STARTED: aim at the cached parent. */
+void fast_boot_on_mesh_started(void) {
+    if (!__atomic_load_n(&s_rejoin_pending, __ATOMIC_ACQUIRE)) return;
+
+    wifi_config_t parent = {0};
+    memcpy(parent.sta.ssid, s_parent.ssid, s_parent.ssid_len);
+    memcpy(parent.sta.bssid, s_parent.bssid, sizeof(s_parent.bssid));
+    parent.sta.bssid_set = true;
+    parent.sta.channel = s_parent.channel;
+    memcpy(parent.sta.password, CONFIG_MESH_AP_PASSWD,
+           strlen(CONFIG_MESH_AP_PASSWD));
+
+    mesh_addr_t mesh_id;
+    memcpy(mesh_id.addr, CONFIG_MESH_ID, sizeof(mesh_id.addr));
+
+    s_rejoin_start_us = esp_timer_get_time();
+    esp_err_t err =
+        esp_mesh_set_parent(&parent, &mesh_id, MESH_NODE, s_parent.layer);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_mesh_set_parent: %s", esp_err_to_name(err));
+        rejoin_fallback("set_parent");
+        return;
+    }
+    esp_timer_start_once(s_rejoin_timer, FAST_REJOIN_TIMEOUT_MS * 1000);
+}
+
+/**
+ * @brief MESH_EVENT_PARENT_CONNECTED: finish a directed rejoin and remember
+ *        the parent for the next boot.
+ */
+void fast_boot_on_parent_connected(const mesh_event_connected_t* connected) {
+    if (__atomic_exchange_n(&s_rejoin_pending, false, __ATOMIC_ACQ_REL)) {
+        esp_timer_stop(s_rejoin_timer);
+        // Keep this parent but let the mesh heal on its own from now on.
+        esp_mesh_set_self_organized(true, false);
+        ESP_LOGI(TAG, "Directed rejoin succeeded in %lld ms",
+                 (long long)((esp_timer_get_time() - s_rejoin_start_us) /
+                             1000));
+    }
+
+    fast_boot_parent_t p = {0};
+    bool valid = !esp_mesh_is_root();
+    if (valid) {
+        const wifi_event_sta_connected_t* sta = &connected->connected;
+        p.ssid_len = sta->ssid_len < sizeof(p.ssid) ? sta->ssid_len
+                                                    : sizeof(p.ssid);
+        memcpy(p.ssid, sta->ssid, p.ssid_len);
+        memcpy(p.bssid, sta->bssid, sizeof(p.bssid));
+        p.channel = sta->channel;
+        p.layer = connected->self_layer;
+    }
+    if (valid == s_parent_valid &&
+        (!valid || memcmp(&p, &s_parent, sizeof(p)) == 0)) {
+        return;  // nothing changed, spare the flash
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err =
+        nvs_open(NVS_FAST_BOOT_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return;
+    err = valid ? nvs_set_blob(nvs_handle, "parent", &p, sizeof(p))
+                : nvs_erase_key(nvs_handle, "parent");
+    if (err == ESP_OK) err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+
+    if (err == ESP_OK) {
+        s_parent = p;
+        s_parent_valid = valid;
+    }
+}
+
+/** @brief MESH_EVENT_PARENT_DISCONNECTED / NO_PARENT_FOUND. */
+void fast_boot_on_parent_lost(void) { rejoin_fallback("parent lost"); }
@@ -0,0 +1,607 @@
+/**
+ * @file fault.c
+ * @brief Fault injection in the mesh send and receive paths
+ *        (CONFIG_DOMATOR_FAULT).
+ *
+ * mesh_send_to_node() asks fault_on_tx() and mesh_rx_task() asks
+ * fault_on_rx() what to do with each frame.  The first rule matching the
+ * frame's message type and direction rolls once and decides:
+ *
+ *  - drop:      the frame is forgotten (a send still returns ESP_OK).
+ *  - delay:     the frame is held for delayMs, then sent or dispatched.
+ *  - duplicate: the frame is sent or dispatched twice.
+ *  - reorder:   the frame is held until the next frame in the same
+ *               direction has gone through (or delayMs, by default
+ *               FAULT_REORDER_MAX_MS, has passed).
+ *
+ * Held TX frames are sent by fault_task(); held RX frames are handed back
+ * to mesh_rx_task() by fault_rx_release(), so every handler still runs on
+ * the RX task.  When a hold slot is not free the frame passes unharmed.
+ *
+ * Besides the frame rules a node can be told to leave its parent
+ * (esp_mesh_disconnect(), after which the stack rejoins by itself) and to
+ * suspend one of its tasks for a while.  The root takes the "fault" MQTT
+ * command and the shell's "fault" command, applies them itself or forwards
+ * them as MSG_TYPE_FAULT frames, and publishes each node's rules and
+ * injection counts on /switch/fault/<device id>:
+ *
+ * {"type":"fault","device":"<id>","clear":true,
+ *  "rules":[{"msg":"B","dir":"rx","drop":10,"delay":20,"delayMs":300,
+ *            "dup":5,"reorder":5}],
+ *  "disconnect":true,"freeze":"mesh_rx","freezeMs":2000}
+ *
+ * Without "device" the root itself is the target.  The report is sent in
+ * any case, so {"type":"fault"} alone just asks for it.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+
+#if CONFIG_DOMATOR_FAULT
+
+static const char* TAG = "FAULT";
+
+#define FAULT_POLL_MS 5
+
+enum { FAULT_RX_INDEX, FAULT_TX_INDEX };
+
+typedef struct {
+    bool used;
+    bool reorder;  // released early once a later frame has gone through
+    bool to_root;  // TX sent with dest NULL
+    int64_t due_us;
+    mesh_addr_t peer;
+    mesh_app_msg_t msg;
+} fault_held_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static fault_rule_t s_rules[FAULT_MAX_RULES];
+static int s_rule_count = 0;
+static fault_held_t s_held[2][FAULT_HELD_MAX];
+static int s_held_count[2];
+static uint32_t s_injected[2][FAULT_ACT_COUNT];
+static uint32_t s_disconnects = 0;
+static uint32_t s_freezes = 0;
+static uint32_t s_rng = 0;
+
+static TaskHandle_t s_task = NULL;
+static esp_timer_handle_t s_thaw_timer = NULL;
+static TaskHandle_t s_frozen = NULL;
+
+// ====================
+// Frame Verdicts
+// ====================
+
+/** @brief xorshift32 (caller holds s_lock). */
+static uint32_t fault_random(void) {
+    if (s_rng == 0) s_rng = (uint32_t)g_device_id | 1;
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/**
+ * @brief Roll the first rule matching the frame (caller holds s_lock).
+ * @return The action, or FAULT_ACT_COUNT to let the frame pass.
+ */
+static fault_action_t fault_roll(int d, uint8_t msg_type,
+                                 uint32_t* hold_ms) {
+    uint8_t dir = d == FAULT_TX_INDEX ? FAULT_DIR_TX : FAULT_DIR_RX;
+    for (int i = 0; i < s_rule_count; i++) {
+        const fault_rule_t* r = &s_rules[i];
+        if (!(r->dir & dir)) continue;
+        if (r->msg_type != 0 && r->msg_type != msg_type) continue;
+
+        uint32_t roll = fault_random() % 100;
+        const uint8_t pct[FAULT_ACT_COUNT] = {r->drop_pct, r->delay_pct,
+                                              r->dup_pct, r->reorder_pct};
+        for (int a = 0; a < FAULT_ACT_COUNT; a++) {
+            if (roll < pct[a]) {
+                *hold_ms = r->delay_ms;
+                if (a == FAULT_ACT_REORDER && r->delay_ms == 0) {
+                    *hold_ms = FAULT_REORDER_MAX_MS;
+                }
+                return a;
+            }
+            roll -= pct[a];
+        }
+        break;
+    }
+    return FAULT_ACT_COUNT;
+}
+
+/** @brief Keep a copy of the frame (caller holds s_lock); false if full. */
+static bool fault_hold(int d, const mesh_addr_t* peer,
+                       const mesh_app_msg_t* msg, uint32_t hold_ms,
+                       bool reorder) {
+    for (int i = 0; i < FAULT_HELD_MAX; i++) {
+        fault_held_t* h = &s_held[d][i];
+        if (h->used) continue;
+        h->used = true;
+        h->reorder = reorder;
+        h->to_root = peer == NULL;
+        if (peer != NULL) h->peer = *peer;
+        h->due_us = esp_timer_get_time() + (int64_t)hold_ms * 1000;
+        memcpy(&h->msg, msg, sizeof(h->msg));
+        s_held_count[d]++;
+        return true;
+    }
+    return false;
+}
+
+static fault_verdict_t fault_on_frame(int d, const mesh_addr_t* peer,
+                                      const mesh_app_msg_t* msg) {
+    if (__atomic_load_n(&s_rule_count, __ATOMIC_RELAXED) == 0 &&
+        __atomic_load_n(&s_held_count[d], __ATOMIC_RELAXED) == 0) {
+        return FAULT_PASS;
+    }
+    if (msg->msg_type == MSG_TYPE_FAULT) return FAULT_PASS;
+
+    fault_verdict_t verdict = FAULT_PASS;
+    uint32_t hold_ms = 0;
+    portENTER_CRITICAL(&s_lock);
+    fault_action_t act = fault_roll(d, msg->msg_type, &hold_ms);
+    switch (act) {
+        case FAULT_ACT_DROP:
+            verdict = FAULT_DROP;
+            break;
+        case FAULT_ACT_DUPLICATE:
+            verdict = FAULT_DUPLICATE;
+            break;
+        case FAULT_ACT_DELAY:
+        case FAULT_ACT_REORDER:
+            if (fault_hold(d, peer, msg, hold_ms,
+                           act == FAULT_ACT_REORDER)) {
+                verdict = FAULT_HOLD;
+            } else {
+                act = FAULT_ACT_COUNT;
+            }
+            break;
+        default:
+            break;
+    }
+    if (act < FAULT_ACT_COUNT) s_injected[d][act]++;
+
+    // This frame overtakes every frame held for reordering.
+    if (verdict != FAULT_DROP && verdict != FAULT_HOLD) {
+        for (int i = 0; i < FAULT_HELD_MAX; i++) {
+            if (s_held[d][i].used && s_held[d][i].reorder) {
+                s_held[d][i].due_us = 0;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return verdict;
+}
+
+fault_verdict_t fault_on_tx(const mesh_addr_t* dest,
+                            const mesh_app_msg_t* msg) {
+    return fault_on_frame(FAULT_TX_INDEX, dest, msg);
+}
+
+fault_verdict_t fault_on_rx(const mesh_addr_t* from,
+                            const mesh_app_msg_t* msg) {
+    return fault_on_frame(FAULT_RX_INDEX, from, msg);
+}
+
+/** @brief Take the earliest due held frame of direction @p d. */
+static bool fault_take_due(int d, fault_held_t* out) {
+    if (__atomic_load_n(&s_held_count[d], __ATOMIC_RELAXED) == 0) {
+        return false;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    bool found = false;
+    portENTER_CRITICAL(&s_lock);
+    fault_held_t* first = NULL;
+    for (int i = 0; i < FAULT_HELD_MAX; i++) {
+        fault_held_t* h = &s_held[d][i];
+        if (h->used && h->due_us <= now_us &&
+            (first == NULL || h->due_us < first->due_us)) {
+            first = h;
+        }
+    }
+    if (first != NULL) {
+        memcpy(out, first, sizeof(*out));
+        first->used = false;
+        s_held_count[d]--;
+        found = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return found;
+}
+
+bool fault_rx_release(mesh_addr_t* from, mesh_app_msg_t* msg,
+                      int64_t* rx_local_us) {
+    static fault_held_t held;  // mesh_rx_task only
+    if (!fault_take_due(FAULT_RX_INDEX, &held)) return false;
+
+    *from = held.peer;
+    memcpy(msg, &held.msg, sizeof(*msg));
+    *rx_local_us = esp_timer_get_time();  // the delay is part of the trip
+    return true;
+}
+
+int fault_rx_timeout_ms(int timeout_ms) {
+    if (__atomic_load_n(&s_held_count[FAULT_RX_INDEX], __ATOMIC_RELAXED) ==
+        0) {
+        return timeout_ms;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t wait_ms = timeout_ms;
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < FAULT_HELD_MAX; i++) {
+        const fault_held_t* h = &s_held[FAULT_RX_INDEX][i];
+        if (!h->used) continue;
+        int64_t ms = (h->due_us - now_us + 999) / 1000;
+        if (ms < wait_ms) wait_ms = ms;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return wait_ms < 1 ? 1 : (int)wait_ms;
+}
+
+/** @brief FreeRTOS task: send held TX frames once they are due. */
+static void fault_task(void* arg) {
+    static fault_held_t held;
+    while (true) {
+        while (fault_take_due(FAULT_TX_INDEX, &held)) {
+            mesh_send_raw(held.to_root ? NULL : &held.peer, &held.msg);
+        }
+        vTaskDelay(pdMS_TO_TICKS(FAULT_POLL_MS));
+    }
+}
+
+// ====================
+// Control
+// ====================
+
+static bool fault_add_rule(const fault_rule_t* rule) {
+    int total = rule->drop_pct + rule->delay_pct + rule->dup_pct +
+                rule->reorder_pct;
+    if (total > 100 || !(rule->dir & (FAULT_DIR_RX | FAULT_DIR_TX))) {
+        ESP_LOGW(TAG, "Invalid rule (%d %%, dir 0x%x)", total, rule->dir);
+        return false;
+    }
+    if (s_task == NULL &&
+        xTaskCreate(fault_task, "fault", 3072, NULL, 4, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start the fault task");
+        s_task = NULL;
+        return false;
+    }
+
+    bool added = false;
+    portENTER_CRITICAL(&s_lock);
+    if (s_rule_count < FAULT_MAX_RULES) {
+        s_rules[s_rule_count] = *rule;
+        __atomic_store_n(&s_rule_count, s_rule_count + 1, __ATOMIC_RELAXED);
+        added = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!added) {
+        ESP_LOGW(TAG, "Rule table full (%d)", FAULT_MAX_RULES);
+        return false;
+    }
+    ESP_LOGW(TAG,
+             "Rule: type %c%s%s drop %u%% delay %u%% dup %u%% reorder %u%% "
+             "(%u ms)",
+             rule->msg_type ? rule->msg_type : '*',
+             (rule->dir & FAULT_DIR_RX) ? " rx" : "",
+             (rule->dir & FAULT_DIR_TX) ? " tx" : "", rule->drop_pct,
+             rule->delay_pct, rule->dup_pct, rule->reorder_pct,
+             rule->delay_ms);
+    return true;
+}
+
+/** @brief Remove every rule and zero the counters; held frames go now. */
+static void fault_clear(void) {
+    portENTER_CRITICAL(&s_lock);
+    __atomic_store_n(&s_rule_count, 0, __ATOMIC_RELAXED);
+    memset(s_injected, 0, sizeof(s_injected));
+    s_disconnects = 0;
+    s_freezes = 0;
+    for (int d = 0; d < 2; d++) {
+        for (int i = 0; i < FAULT_HELD_MAX; i++) s_held[d][i].due_us = 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGW(TAG, "Rules cleared");
+}
+
+static void fault_thaw(void* arg) {
+    TaskHandle_t task = s_frozen;
+    if (task == NULL) return;
+    vTaskResume(task);
+    s_frozen = NULL;
+    ESP_LOGW(TAG, "Task %s resumed", pcTaskGetName(task));
+}
+
+static bool fault_freeze(const char* name, uint32_t ms) {
+    if (s_frozen != NULL) {
+        ESP_LOGW(TAG, "Task %s is still frozen", pcTaskGetName(s_frozen));
+        return false;
+    }
+    if (ms == 0 || ms > FAULT_MAX_FREEZE_MS) {
+        ESP_LOGW(TAG, "Freeze time must be 1..%d ms", FAULT_MAX_FREEZE_MS);
+        return false;
+    }
+    // The thaw timer runs there.
+    if (strcmp(name, "esp_timer") == 0) {
+        ESP_LOGW(TAG, "Cannot freeze esp_timer");
+        return false;
+    }
+    TaskHandle_t task = xTaskGetHandle(name);
+    if (task == NULL) {
+        ESP_LOGW(TAG, "No task named %s", name);
+        return false;
+    }
+    if (s_thaw_timer == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = fault_thaw,
+            .name = "fault_thaw",
+        };
+        if (esp_timer_create(&args, &s_thaw_timer) != ESP_OK) return false;
+    }
+
+    ESP_LOGW(TAG, "Freezing task %s for %" PRIu32 " ms", name, ms);
+    s_frozen = task;
+    s_freezes++;
+    esp_timer_start_once(s_thaw_timer, (uint64_t)ms * 1000);
+    vTaskSuspend(task);  // may be this task; it resumes here
+    return true;
+}
+
+/** @brief Apply @p ctl on this node; FAULT_OP_REPORT_REQ is the caller's. */
+static bool fault_apply(const fault_ctl_t* ctl) {
+    switch (ctl->op) {
+        case FAULT_OP_ADD:
+            return fault_add_rule(&ctl->rule);
+        case FAULT_OP_CLEAR:
+            fault_clear();
+            return true;
+        case FAULT_OP_DISCONNECT: {
+            ESP_LOGW(TAG, "Leaving the parent");
+            s_disconnects++;
+            esp_err_t err = esp_mesh_disconnect();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "esp_mesh_disconnect: %s", esp_err_to_name(err));
+            }
+            return err == ESP_OK;
+        }
+        case FAULT_OP_FREEZE: {
+            char name[sizeof(ctl->task) + 1];
+            memcpy(name, ctl->task, sizeof(ctl->task));
+            name[sizeof(ctl->task)] = '\0';
+            return fault_freeze(name, ctl->ms);
+        }
+        default:
+            ESP_LOGW(TAG, "Unknown fault op '%c'", ctl->op);
+            return false;
+    }
+}
+
+void fault_get_report(fault_report_t* report) {
+    memset(report, 0, sizeof(*report));
+    portENTER_CRITICAL(&s_lock);
+    memcpy(report->injected, s_injected, sizeof(report->injected));
+    report->disconnects = s_disconnects;
+    report->freezes = s_freezes;
+    report->rule_count = (uint8_t)s_rule_count;
+    memcpy(report->rules, s_rules, sizeof(fault_rule_t) * s_rule_count);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// ====================
+// Reports
+// ====================
+
+static void fault_add_counts(cJSON* json, const char* name,
+                             const uint32_t* counts) {
+    cJSON* obj = cJSON_AddObjectToObject(json, name);
+    cJSON_AddNumberToObject(obj, "drop", counts[FAULT_ACT_DROP]);
+    cJSON_AddNumberToObject(obj, "delay", counts[FAULT_ACT_DELAY]);
+    cJSON_AddNumberToObject(obj, "duplicate", counts[FAULT_ACT_DUPLICATE]);
+    cJSON_AddNumberToObject(obj, "reorder", counts[FAULT_ACT_REORDER]);
+}
+
+/** @brief Root: publish @p report of @p device_id on /switch/fault/<id>. */
+static void fault_publish_report(uint64_t device_id,
+                                 const fault_report_t* report) {
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+
+    char id[24];
+    snprintf(id, sizeof(id), "%" PRIu64, device_id);
+    cJSON_AddStringToObject(json, "device", id);
+
+    cJSON* rules = cJSON_AddArrayToObject(json, "rules");
+    for (int i = 0; i < report->rule_count && i < FAULT_MAX_RULES; i++) {
+        const fault_rule_t* r = &report->rules[i];
+        cJSON* rule = cJSON_CreateObject();
+        char type[2] = {r->msg_type ? (char)r->msg_type : '*', '\0'};
+        cJSON_AddStringToObject(rule, "msg", type);
+        cJSON_AddStringToObject(rule, "dir",
+                                r->dir == FAULT_DIR_RX   ? "rx"
+                                : r->dir == FAULT_DIR_TX ? "tx"
+                                                         : "both");
+        cJSON_AddNumberToObject(rule, "drop", r->drop_pct);
+        cJSON_AddNumberToObject(rule, "delay", r->delay_pct);
+        cJSON_AddNumberToObject(rule, "delayMs", r->delay_ms);
+        cJSON_AddNumberToObject(rule, "dup", r->dup_pct);
+        cJSON_AddNumberToObject(rule, "reorder", r->reorder_pct);
+        cJSON_AddItemToArray(rules, rule);
+    }
+    uint32_t counts[2][FAULT_ACT_COUNT];
+    memcpy(counts, report->injected, sizeof(counts));
+    fault_add_counts(json, "rx", counts[FAULT_RX_INDEX]);
+    fault_add_counts(json, "tx", counts[FAULT_TX_INDEX]);
+    cJSON_AddNumberToObject(json, "disconnects", report->disconnects);
+    cJSON_AddNumberToObject(json, "freezes", report->freezes);
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise fault report");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/fault/%" PRIu64, device_id);
+    if (g_mqtt_connected) {
+        esp_mqtt_client_publish(g_mqtt_client, topic, json_str, 0, 0, 0);
+    }
+    cJSON_free(json_str);
+}
+
+/** @brief Send this node's report to the root, or publish it on the root. */
+static void fault_report(void) {
+    static fault_report_t report;
+    fault_get_report(&report);
+    if (g_is_root) {
+        fault_publish_report(g_device_id, &report);
+        return;
+    }
+
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_FAULT;
+    msg.data[0] = FAULT_OP_REPORT;
+    memcpy(&msg.data[1], &report, sizeof(report));
+    msg.data_len = 1 + sizeof(report);
+    mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+}
+
+bool fault_control(uint64_t device_id, const fault_ctl_t* ctl) {
+    if (device_id == 0 || device_id == g_device_id) {
+        if (ctl->op == FAULT_OP_REPORT_REQ) {
+            fault_report();
+            return true;
+        }
+        return fault_apply(ctl);
+    }
+    if (!g_is_root) return false;
+
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+    for (int i = 0; i < count; i++) {
+        if (ids[i] != device_id) continue;
+        mesh_app_msg_t msg = {0};
+        msg.src_id = g_device_id;
+        msg.msg_type = MSG_TYPE_FAULT;
+        msg.data[0] = ctl->op;
+        memcpy(&msg.data[1], ctl, sizeof(*ctl));
+        msg.data_len = 1 + sizeof(*ctl);
+        return mesh_queue_to_node(&msg, TX_PRIO_NORMAL, &addrs[i]);
+    }
+    ESP_LOGW(TAG, "%" PRIu64 " is not a registered node", device_id);
+    return false;
+}
+
+void fault_handle_message(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 1) return;
+
+    if (g_is_root) {
+        if (msg->data[0] != FAULT_OP_REPORT ||
+            msg->data_len < 1 + sizeof(fault_report_t)) {
+            return;
+        }
+        static fault_report_t report;
+        memcpy(&report, &msg->data[1], sizeof(report));
+        fault_publish_report(msg->src_id, &report);
+        return;
+    }
+
+    if (msg->data_len < 1 + sizeof(fault_ctl_t)) return;
+    fault_ctl_t ctl;
+    memcpy(&ctl, &msg->data[1], sizeof(ctl));
+    fault_control(0, &ctl);
+}
+
+// ====================
+// Root: Command
+// ====================
+
+static uint32_t fault_json_number(const cJSON* json, const char* key,
+                                  uint32_t def, uint32_t max) {
+    const cJSON* item = cJSON_GetObjectItem(json, key);
+    if (!cJSON_IsNumber(item) || item->valuedouble < 0) return def;
+    return item->valuedouble > max ? max : (uint32_t)item->valuedouble;
+}
+
+static void fault_parse_rule(const cJSON* json, fault_rule_t* rule) {
+    memset(rule, 0, sizeof(*rule));
+    const cJSON* type = cJSON_GetObjectItem(json, "msg");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "*") != 0) {
+        rule->msg_type = (uint8_t)type->valuestring[0];
+    }
+    rule->dir = FAULT_DIR_RX | FAULT_DIR_TX;
+    const cJSON* dir = cJSON_GetObjectItem(json, "dir");
+    if (cJSON_IsString(dir) && strcmp(dir->valuestring, "rx") == 0) {
+        rule->dir = FAULT_DIR_RX;
+    } else if (cJSON_IsString(dir) && strcmp(dir->valuestring, "tx") == 0) {
+        rule->dir = FAULT_DIR_TX;
+    }
+    rule->drop_pct = fault_json_number(json, "drop", 0, 100);
+    rule->delay_pct = fault_json_number(json, "delay", 0, 100);
+    rule->dup_pct = fault_json_number(json, "dup", 0, 100);
+    rule->reorder_pct = fault_json_number(json, "reorder", 0, 100);
+    rule->delay_ms = fault_json_number(json, "delayMs", 0, UINT16_MAX);
+}
+
+void fault_command(const cJSON* json) {
+    uint64_t device_id = 0;
+    const cJSON* device = cJSON_GetObjectItem(json, "device");
+    if (cJSON_IsString(device)) {
+        device_id = strtoull(device->valuestring, NULL, 10);
+    } else if (cJSON_IsNumber(device)) {
+        device_id = (uint64_t)device->valuedouble;
+    }
+
+    // A step that fails skips the rest; the report shows what was set.
+    fault_ctl_t ctl = {0};
+    bool ok = true;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "clear"))) {
+        ctl.op = FAULT_OP_CLEAR;
+        ok = fault_control(device_id, &ctl);
+    }
+
+    const cJSON* rules = cJSON_GetObjectItem(json, "rules");
+    const cJSON* item;
+    cJSON_ArrayForEach(item, rules) {
+        if (!ok) break;
+        ctl.op = FAULT_OP_ADD;
+        fault_parse_rule(item, &ctl.rule);
+        ok = fault_control(device_id, &ctl);
+    }
+
+    if (ok && cJSON_IsTrue(cJSON_GetObjectItem(json, "disconnect"))) {
+        ctl.op = FAULT_OP_DISCONNECT;
+        ok = fault_control(device_id, &ctl);
+    }
+
+    const cJSON* freeze = cJSON_GetObjectItem(json, "freeze");
+    if (ok && cJSON_IsString(freeze)) {
+        ctl.op = FAULT_OP_FREEZE;
+        strncpy(ctl.task, freeze->valuestring, sizeof(ctl.task));
+        ctl.ms = fault_json_number(json, "freezeMs", 1000,
+                                   FAULT_MAX_FREEZE_MS);
+        fault_control(device_id, &ctl);
+    }
+
+    ctl.op = FAULT_OP_REPORT_REQ;
+    fault_control(device_id, &ctl);
+}
+
+#endif  // CONFIG_DOMATOR_FAULT
@@ -0,0 +1,260 @@
+/**
+ * @file gesture.c
+ * @brief Per-button gesture recognizer on switch nodes.
+ *
+ * Buttons with no gestures enabled keep the raw protocol (one MSG_TYPE_BUTTON
+ * per press and per release).  For a button with a non-zero GESTURE_EN_* mask
+ * the recognizer consumes the debounced edges from button_task() and sends
+ * one MSG_TYPE_GESTURE per interaction instead:
+ *
+ *  - 's' single click – sent on press if nothing else is enabled, on release
+ *                       if only long/hold is enabled, otherwise after
+ *                       GESTURE_CLICK_GAP_MS without a further press.
+ *  - 'd' / 't'        – double / triple click (GESTURE_EN_MULTI).  A triple
+ *                       is sent on the third release, without waiting.
+ *  - 'l' long press   – sent once LONG_PRESS_THRESHOLD_MS is reached, while
+ *                       the button is still held (GESTURE_EN_LONG).
+ *  - 'h' / 'r' / 'e'  – hold start, repeat tick every GESTURE_REPEAT_MS
+ *                       (data[2] = tick number), hold end (GESTURE_EN_HOLD).
+ *
+ * All timing uses the ISR edge timestamps from button_input.c.  The masks
+ * are pushed by the root (MSG_TYPE_CONFIG, "gestures" command) and persisted
+ * in NVS.
+ */
+
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "nvs.h"
+
+static const char* TAG = "GESTURE";
+
+#define NVS_GESTURE_NAMESPACE "gesture"
+#define NVS_GESTURE_KEY "masks"
+
+/** Recognizer state for one button. */
+typedef struct {
+    bool pressed;
+    bool long_fired;
+    uint8_t clicks;
+    uint8_t repeat_count;
+    int64_t press_us;
+    int64_t deadline_us;  // 0 = no timer pending
+} gesture_state_t;
+
+static uint8_t s_masks[MAX_BUTTONS] = {0};
+static gesture_state_t s_state[MAX_BUTTONS];
+
+// ====================
+// NVS Persistence
+// ====================
+
+/** @brief Persist the per-button gesture masks. */
+static void gesture_save_to_nvs(void) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_GESTURE_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS for gestures: %s",
+                 esp_err_to_name(err));
+        return;
+    }
+
+    err = nvs_set_blob(nvs_handle, NVS_GESTURE_KEY, s_masks, sizeof(s_masks));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save gestures: %s", esp_err_to_name(err));
+    }
+    nvs_close(nvs_handle);
+}
+
+/** @brief Restore the gesture masks from NVS (all zero if absent). */
+void gesture_init(void) {
+    memset(s_state, 0, sizeof(s_state));
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_GESTURE_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        ESP_LOGI(TAG, "No saved gesture config in NVS");
+        return;
+    }
+
+    size_t size = sizeof(s_masks);
+    esp_err_t err = nvs_get_blob(nvs_handle, NVS_GESTURE_KEY, s_masks, &size);
+    if (err != ESP_OK || size != sizeof(s_masks)) {
+        memset(s_masks, 0, sizeof(s_masks));
+    }
+    nvs_close(nvs_handle);
+
+    for (int i = 0; i < MAX_BUTTONS; i++) {
+        if (s_masks[i]) {
+            ESP_LOGI(TAG, "Button '%c' gestures: 0x%02X", 'a' + i, s_masks[i]);
+        }
+    }
+}
+
+/**
+ * @brief Apply a gesture config from the root.
+ * @param msg MSG_TYPE_CONFIG with data[0] = CONFIG_KEY_GESTURES followed by
+ *            one GESTURE_EN_* mask byte per button.
+ */
+void gesture_handle_config(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 1 + MAX_BUTTONS) {
+        ESP_LOGW(TAG, "Gesture config too short (%d bytes)", msg->data_len);
+        return;
+    }
+
+    if (memcmp(s_masks, &msg->data[1], MAX_BUTTONS) == 0) {
+        ESP_LOGI(TAG, "Gesture config unchanged");
+        return;
+    }
+
+    memcpy(s_masks, &msg->data[1], MAX_BUTTONS);
+    memset(s_state, 0, sizeof(s_state));
+    gesture_save_to_nvs();
+
+    for (int i = 0; i < MAX_BUTTONS; i++) {
+        ESP_LOGI(TAG, "Button '%c' gestures: 0x%02X", 'a' + i, s_masks[i]);
+    }
+}
+
+// ====================
+// Recognizer
+// ====================
+
+/** @brief Send one MSG_TYPE_GESTURE to the root. */
+static void gesture_send(int index, char gesture, uint8_t count) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_GESTURE;
+    msg.data[0] = 'a' + index;
+    msg.data[1] = gesture;
+    if (gesture == GESTURE_REPEAT) {
+        msg.data[2] = count;
+        msg.data_len = 3;
+    } else {
+        msg.data_len = 2;
+    }
+    mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+
+    ESP_LOGI(TAG, "Gesture '%c' on button '%c'", gesture, 'a' + index);
+}
+
+/** @brief Send the single/double click for the clicks collected so far. */
+static void gesture_flush_clicks(int index) {
+    gesture_state_t* st = &s_state[index];
+    if (st->clicks == 1) {
+        gesture_send(index, GESTURE_SINGLE, 0);
+    } else if (st->clicks == 2) {
+        gesture_send(index, GESTURE_DOUBLE, 0);
+    } else if (st->clicks >= 3) {
+        gesture_send(index, GESTURE_TRIPLE, 0);
+    }
+    st->clicks = 0;
+}
+
+/**
+ * @brief Feed a debounced edge into the recognizer.
+ * @param ev Edge from button_input_get_event().
+ * @return true if the button is in gesture mode and the edge was consumed
+ *         (the caller must not send a raw MSG_TYPE_BUTTON for it).
+ */
+bool gesture_handle_event(const button_event_t* ev) {
+    if (ev->index >= MAX_BUTTONS) return false;
+
+    uint8_t mask = s_masks[ev->index];
+    if (mask == 0) return false;
+
+    gesture_state_t* st = &s_state[ev->index];
+    bool timed = mask & (GESTURE_EN_LONG | GESTURE_EN_HOLD);
+
+    if (ev->level) {
+        if (st->pressed) return true;
+        st->pressed = true;
+        st->long_fired = false;
+        st->repeat_count = 0;
+        st->press_us = ev->time_us;
+
+        if (!(mask & GESTURE_EN_MULTI) && !timed) {
+            // Nothing to disambiguate: act on the press itself.
+            gesture_send(ev->index, GESTURE_SINGLE, 0);
+            st->deadline_us = 0;
+        } else {
+            st->deadline_us =
+                timed ? ev->time_us + LONG_PRESS_THRESHOLD_MS * 1000 : 0;
+        }
+        return true;
+    }
+
+    if (!st->pressed) return true;
+    st->pressed = false;
+    st->deadline_us = 0;
+
+    if (st->long_fired) {
+        if (mask & GESTURE_EN_HOLD) {
+            gesture_send(ev->index, GESTURE_HOLD_END, 0);
+        }
+        st->clicks = 0;
+        return true;
+    }
+
+    if (!(mask & GESTURE_EN_MULTI)) {
+        if (timed) gesture_send(ev->index, GESTURE_SINGLE, 0);
+        return true;
+    }
+
+    st->clicks++;
+    if (st->clicks >= 3) {
+        gesture_flush_clicks(ev->index);
+    } else {
+        st->deadline_us = ev->time_us + GESTURE_CLICK_GAP_MS * 1000;
+    }
+    return true;
+}
+
+/**
+ * @brief Fire expired gesture timers (long press, hold repeat, click gap).
+ * @return Ticks until the next pending timer, or portMAX_DELAY if none.
+ */
+TickType_t gesture_poll(void) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = -1;
+
+    for (int i = 0; i < MAX_BUTTONS; i++) {
+        gesture_state_t* st = &s_state[i];
+        if (st->deadline_us == 0) continue;
+
+        if (now_us >= st->deadline_us) {
+            uint8_t mask = s_masks[i];
+            st->deadline_us = 0;
+
+            if (st->pressed && !st->long_fired) {
+                // Held past the long-press threshold.  Clicks collected
+                // before this press are reported first.
+                st->long_fired = true;
+                gesture_flush_clicks(i);
+                if (mask & GESTURE_EN_HOLD) {
+                    gesture_send(i, GESTURE_HOLD, 0);
+                    st->deadline_us = now_us + GESTURE_REPEAT_MS * 1000;
+                } else {
+                    gesture_send(i, GESTURE_LONG, 0);
+                }
+            } else if (st->pressed) {
+                if (st->repeat_count < UINT8_MAX) st->repeat_count++;
+                gesture_send(i, GESTURE_REPEAT, st->repeat_count);
+                st->deadline_us = now_us + GESTURE_REPEAT_MS * 1000;
+            } else {
+                // Click gap expired with no further press.
+                gesture_flush_clicks(i);
+            }
+        }
+
+        if (st->deadline_us != 0) {
+            int64_t remaining = st->deadline_us - now_us;
+            if (next_us < 0 || remaining < next_us) next_us = remaining;
+        }
+    }
+
+    if (next_us < 0) return portMAX_DELAY;
+    return pdMS_TO_TICKS(next_us / 1000) + 1;
+}
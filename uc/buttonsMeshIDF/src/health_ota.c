@@ -5,7 +5,9 @@
  * Health monitoring:
  *  - health_monitor_task() runs every 5 seconds, logs warnings when free heap
  *    falls below LOW_HEAP_THRESHOLD or CRITICAL_HEAP_THRESHOLD, and increments
- *    the corresponding statistics counters.
+ *    the corresponding statistics counters.  The warnings include the largest
+ *    free block and minimum-ever free heap (see heap_stats.c) to tell
+ *    fragmentation from a real shortage.
  *
  * OTA update flow:
  *  1. Any node can request an OTA by setting g_ota_requested (via mesh message
@@ -21,6 +23,7 @@
 
 #include "domator_mesh.h"
 #include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
 #include "esp_http_client.h"
 #include "esp_https_ota.h"
 #include "esp_log.h"
@@ -154,6 +157,8 @@ esp_err_t mesh_disconnect_and_ota() {
 
     ESP_LOGI(TAG, "Stopping mesh...");
     g_ota_in_progress = true;
+    journal_record(JOURNAL_EV_OTA_START, 0);
+    led_post_event(LED_EVENT_STATE_CHANGED);
 
     if (g_is_root) node_root_stop();
 
@@ -250,6 +255,7 @@ esp_err_t mesh_disconnect_and_ota() {
     if (!(bits & WIFI_CONNECTED_BIT)) {
         ESP_LOGE(TAG, "Failed to connect to SSID: %s", CONFIG_ROUTER_SSID);
         ret = ESP_FAIL;
+        journal_record(JOURNAL_EV_OTA_FAILED, ret);
         esp_restart();
     }
 
@@ -274,6 +280,7 @@ esp_err_t mesh_disconnect_and_ota() {
         esp_restart();
     } else {
         ESP_LOGE(TAG, "OTA failed: %s", esp_err_to_name(ret));
+        journal_record(JOURNAL_EV_OTA_FAILED, ret);
         uint8_t fail_count = ota_get_fail_count() + 1;
         ota_set_fail_count(fail_count);
         ESP_LOGE(TAG, "OTA failure count: %d / %d", fail_count,
@@ -378,32 +385,34 @@ void health_monitor_task(void* arg) {
 
         vTaskDelay(pdMS_TO_TICKS(5000));
 
-        uint32_t free_heap = esp_get_free_heap_size();
+        heap_caps_stat_t heap;
+        heap_stats_get(MALLOC_CAP_DEFAULT, &heap);
+        uint32_t free_heap = heap.free;
         uint32_t current_time = esp_timer_get_time() / 1000;
 
         if (free_heap < LOW_HEAP_THRESHOLD) {
             if (current_time - last_low_heap_log > 60000) {
-                ESP_LOGW(TAG, "Low heap detected: %lu bytes free", free_heap);
+                ESP_LOGW(TAG,
+                         "Low heap detected: %" PRIu32 " bytes free, largest "
+                         "block %" PRIu32 ", min ever %" PRIu32,
+                         free_heap, heap.largest, heap.min_free);
                 last_low_heap_log = current_time;
+                journal_record(JOURNAL_EV_HEAP_LOW, free_heap);
 
-                if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) ==
-                    pdTRUE) {
-                    g_stats.low_heap_events++;
-                    xSemaphoreGive(g_stats_mutex);
-                }
+                counter_inc(CNT_LOW_HEAP);
             }
         }
 
         if (free_heap < CRITICAL_HEAP_THRESHOLD) {
             if (current_time - last_critical_heap_log > 60000) {
-                ESP_LOGE(TAG, "CRITICAL heap level: %lu bytes free", free_heap);
+                ESP_LOGE(TAG,
+                         "CRITICAL heap level: %" PRIu32 " bytes free, "
+                         "largest block %" PRIu32,
+                         free_heap, heap.largest);
                 last_critical_heap_log = current_time;
+                journal_record(JOURNAL_EV_HEAP_CRITICAL, free_heap);
 
-                if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) ==
-                    pdTRUE) {
-                    g_stats.critical_heap_events++;
-                    xSemaphoreGive(g_stats_mutex);
-                }
+                counter_inc(CNT_CRITICAL_HEAP);
             }
         }
 
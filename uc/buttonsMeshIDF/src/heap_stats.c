@@ -0,0 +1,189 @@
+/**
+ * @file heap_stats.c
+ * @brief Heap fragmentation telemetry and optional allocation tagging.
+ *
+ * heap_stats_get() reports, for one capability class, the free bytes, the
+ * largest free block, the minimum free size since boot and a fragmentation
+ * ratio (1 - largest / free, in permille).  A node whose free heap looks fine
+ * but whose largest block is small is fragmented; one whose minimum-ever is
+ * near zero ran out at some point.  The default, internal and DMA-capable
+ * classes go into the status report (heap_stats_add_summary()) and the
+ * shell's "heap" command.
+ *
+ * With CONFIG_DOMATOR_HEAP_TAGS, heap_tag_malloc()/heap_tag_free() attribute
+ * live bytes to a subsystem (cJSON through cJSON_InitHooks(), mesh TX items,
+ * Telnet buffers).  The MQTT share is the esp-mqtt outbox size, sampled
+ * because its allocations happen inside the client.  Sizes come from
+ * heap_caps_get_allocated_size(), so no header is added to the blocks.
+ * Without the option the heap_tag_*() calls compile to plain malloc()/free().
+ */
+
+#include <stdlib.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_heap_caps.h"
+
+static const char* TAG = "HEAP_STATS";
+
+// ====================
+// Capability Classes
+// ====================
+
+/**
+ * @brief Read heap numbers for one capability class.
+ * @param caps MALLOC_CAP_* mask, e.g. MALLOC_CAP_DEFAULT or MALLOC_CAP_DMA.
+ * @param out  Receives free, largest block, minimum-ever free and
+ *             fragmentation.
+ */
+void heap_stats_get(uint32_t caps, heap_caps_stat_t* out) {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, caps);
+
+    out->free = info.total_free_bytes;
+    out->largest = info.largest_free_block;
+    out->min_free = info.minimum_free_bytes;
+    out->frag_permille =
+        info.total_free_bytes
+            ? 1000 - (uint32_t)((uint64_t)info.largest_free_block * 1000 /
+                                info.total_free_bytes)
+            : 0;
+}
+
+/**
+ * @brief Add heap fields to a status report:
+ *        "heapBlk"  largest free block (default caps),
+ *        "heapMin"  minimum free heap since boot,
+ *        "heapFrag" fragmentation in permille,
+ *        "intFree"  free internal RAM, "dmaBlk" largest DMA-capable block,
+ *        "heapTags" live bytes per heap_tag_t (CONFIG_DOMATOR_HEAP_TAGS only).
+ */
+void heap_stats_add_summary(struct cJSON* json) {
+    heap_caps_stat_t def, internal, dma;
+    heap_stats_get(MALLOC_CAP_DEFAULT, &def);
+    heap_stats_get(MALLOC_CAP_INTERNAL, &internal);
+    heap_stats_get(MALLOC_CAP_DMA, &dma);
+
+    cJSON_AddNumberToObject(json, "heapBlk", def.largest);
+    cJSON_AddNumberToObject(json, "heapMin", def.min_free);
+    cJSON_AddNumberToObject(json, "heapFrag", def.frag_permille);
+    cJSON_AddNumberToObject(json, "intFree", internal.free);
+    cJSON_AddNumberToObject(json, "dmaBlk", dma.largest);
+
+#if CONFIG_DOMATOR_HEAP_TAGS
+    heap_tags_sample();
+    cJSON* tags = cJSON_AddArrayToObject(json, "heapTags");
+    for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+        heap_tag_stat_t s;
+        heap_tag_get(i, &s);
+        cJSON_AddItemToArray(tags, cJSON_CreateNumber(s.live));
+    }
+#endif
+}
+
+/** @brief Short name of a heap_tag_t for reports. */
+const char* heap_tag_name(heap_tag_t tag) {
+    switch (tag) {
+        case HEAP_TAG_CJSON:
+            return "cjson";
+        case HEAP_TAG_MQTT:
+            return "mqtt";
+        case HEAP_TAG_MESH_TX:
+            return "mesh_tx";
+        case HEAP_TAG_TELNET:
+            return "telnet";
+        default:
+            return "unknown";
+    }
+}
+
+// ====================
+// Allocation Tagging
+// ====================
+
+#if CONFIG_DOMATOR_HEAP_TAGS
+
+static int32_t s_live[HEAP_TAG_COUNT];
+static int32_t s_peak[HEAP_TAG_COUNT];
+static uint32_t s_allocs[HEAP_TAG_COUNT];
+
+/** @brief Add (or with a negative value, remove) bytes from a tag. */
+void heap_tag_account(heap_tag_t tag, int32_t bytes) {
+    int32_t live =
+        __atomic_add_fetch(&s_live[tag], bytes, __ATOMIC_RELAXED);
+    if (bytes > 0) {
+        __atomic_add_fetch(&s_allocs[tag], 1, __ATOMIC_RELAXED);
+        // A racing update can lose a peak by a few bytes; good enough.
+        if (live > __atomic_load_n(&s_peak[tag], __ATOMIC_RELAXED)) {
+            __atomic_store_n(&s_peak[tag], live, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void* heap_tag_malloc(heap_tag_t tag, size_t size) {
+    void* p = malloc(size);
+    if (p != NULL) heap_tag_account(tag, heap_caps_get_allocated_size(p));
+    return p;
+}
+
+void* heap_tag_calloc(heap_tag_t tag, size_t n, size_t size) {
+    void* p = calloc(n, size);
+    if (p != NULL) heap_tag_account(tag, heap_caps_get_allocated_size(p));
+    return p;
+}
+
+void heap_tag_free(heap_tag_t tag, void* ptr) {
+    if (ptr == NULL) return;
+    heap_tag_account(tag, -(int32_t)heap_caps_get_allocated_size(ptr));
+    free(ptr);
+}
+
+static void* cjson_malloc(size_t size) {
+    return heap_tag_malloc(HEAP_TAG_CJSON, size);
+}
+
+static void cjson_free(void* ptr) { heap_tag_free(HEAP_TAG_CJSON, ptr); }
+
+/** @brief Current live/peak bytes and allocation count of a tag. */
+void heap_tag_get(heap_tag_t tag, heap_tag_stat_t* out) {
+    out->live = __atomic_load_n(&s_live[tag], __ATOMIC_RELAXED);
+    out->peak = __atomic_load_n(&s_peak[tag], __ATOMIC_RELAXED);
+    out->allocs = __atomic_load_n(&s_allocs[tag], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Refresh tags whose size is sampled rather than counted (the MQTT
+ *        outbox).
+ */
+void heap_tags_sample(void) {
+    int32_t outbox = 0;
+    if (g_is_root && g_mqtt_client != NULL) {
+        outbox = esp_mqtt_client_get_outbox_size(g_mqtt_client);
+    }
+    __atomic_store_n(&s_live[HEAP_TAG_MQTT], outbox, __ATOMIC_RELAXED);
+    if (outbox > __atomic_load_n(&s_peak[HEAP_TAG_MQTT], __ATOMIC_RELAXED)) {
+        __atomic_store_n(&s_peak[HEAP_TAG_MQTT], outbox, __ATOMIC_RELAXED);
+    }
+}
+
+#endif  // CONFIG_DOMATOR_HEAP_TAGS
+
+/**
+ * @brief Install the cJSON allocation hooks when tagging is enabled.  Call
+ *        before anything creates a cJSON object.
+ */
+void heap_stats_init(void) {
+#if CONFIG_DOMATOR_HEAP_TAGS
+    cJSON_Hooks hooks = {
+        .malloc_fn = cjson_malloc,
+        .free_fn = cjson_free,
+    };
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "Heap allocation tagging enabled");
+#endif
+
+    heap_caps_stat_t def;
+    heap_stats_get(MALLOC_CAP_DEFAULT, &def);
+    ESP_LOGI(TAG, "Heap at boot: %" PRIu32 " free, largest block %" PRIu32,
+             def.free, def.largest);
+}
@@ -0,0 +1,250 @@
+/**
+ * @file journal.c
+ * @brief Crash-surviving event journal in RTC no-init memory.
+ *
+ * A fixed ring of JOURNAL_ENTRIES small binary records (uptime, boot number,
+ * event code, one argument) lives in RTC_NOINIT memory, so it survives panics,
+ * watchdog resets and esp_restart() but not a power cycle.  Each boot appends
+ * a JOURNAL_EV_BOOT record carrying esp_reset_reason().
+ *
+ * Records that have not been uploaded yet (typically the tail of the previous
+ * boot plus the new boot record) are sent to the root as MSG_TYPE_DIAG chunks
+ * once the node is connected; the root publishes them on /switch/diag/<id>.
+ * The "diag" root command asks every node to upload its whole journal again.
+ */
+
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_task_wdt.h"
+
+static const char* TAG = "JOURNAL";
+
+#define JOURNAL_MAGIC 0x4A524E31  // "JRN1"
+
+/** Journal image kept in RTC memory across warm resets. */
+typedef struct {
+    uint32_t magic;
+    uint32_t check;       // magic ^ boot_count ^ head ^ uploaded
+    uint32_t boot_count;
+    uint32_t head;        // total records ever written
+    uint32_t uploaded;    // head value at the last successful upload
+    journal_entry_t entries[JOURNAL_ENTRIES];
+} journal_image_t;
+
+static RTC_NOINIT_ATTR journal_image_t s_journal;
+static portMUX_TYPE s_journal_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_reset_reason_t s_reset_reason = ESP_RST_UNKNOWN;
+static volatile bool s_upload_all = false;
+
+static inline uint32_t journal_checksum(void) {
+    return s_journal.magic ^ s_journal.boot_count ^ s_journal.head ^
+           s_journal.uploaded;
+}
+
+// ====================
+// Initialization
+// ====================
+
+/**
+ * @brief Validate the RTC journal (reset it after a power cycle), bump the
+ *        boot counter and record the reset reason.  Call early in app_main().
+ */
+void journal_init(void) {
+    s_reset_reason = esp_reset_reason();
+
+    bool valid = s_journal.magic == JOURNAL_MAGIC &&
+                 s_journal.check == journal_checksum() &&
+                 s_journal.uploaded <= s_journal.head;
+    if (!valid || s_reset_reason == ESP_RST_POWERON) {
+        memset(&s_journal, 0, sizeof(s_journal));
+        s_journal.magic = JOURNAL_MAGIC;
+    }
+
+    s_journal.boot_count++;
+    s_journal.check = journal_checksum();
+
+    ESP_LOGI(TAG, "Boot #%" PRIu32 ", reset reason: %s, %" PRIu32
+             " journal record(s) retained",
+             s_journal.boot_count, journal_reset_reason_name(s_reset_reason),
+             s_journal.head < JOURNAL_ENTRIES ? s_journal.head
+                                              : (uint32_t)JOURNAL_ENTRIES);
+
+    journal_record(JOURNAL_EV_BOOT, s_reset_reason);
+}
+
+// ====================
+// Recording
+// ====================
+
+/**
+ * @brief Append one record.  Safe from any task and from ISRs.
+ * @param event JOURNAL_EV_* code.
+ * @param arg   Event-specific argument (see journal_event_t).
+ */
+void IRAM_ATTR journal_record(journal_event_t event, uint32_t arg) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL_SAFE(&s_journal_mux);
+    journal_entry_t* e = &s_journal.entries[s_journal.head % JOURNAL_ENTRIES];
+    e->uptime_ms = now_ms;
+    e->boot = (uint16_t)s_journal.boot_count;
+    e->event = event;
+    e->reserved = 0;
+    e->arg = arg;
+    s_journal.head++;
+    s_journal.check = journal_checksum();
+    portEXIT_CRITICAL_SAFE(&s_journal_mux);
+}
+
+/**
+ * @brief Task watchdog hook (weak in ESP-IDF): note the timeout so it is
+ *        still visible if the watchdog then resets the chip.
+ */
+void IRAM_ATTR esp_task_wdt_isr_user_handler(void) {
+    journal_record(JOURNAL_EV_TASK_WDT, 0);
+}
+
+// ====================
+// Upload
+// ====================
+
+/** @brief Ask for the whole retained journal on the next upload. */
+void journal_request_upload(void) { s_upload_all = true; }
+
+/**
+ * @brief Send unsent records (or all of them after journal_request_upload())
+ *        to the root as MSG_TYPE_DIAG chunks.  On the root the chunks are
+ *        published directly.  Called periodically from status_report_task().
+ */
+void journal_upload_pending(void) {
+    if (g_is_root ? !g_mqtt_connected : !g_mesh_connected) return;
+
+    portENTER_CRITICAL(&s_journal_mux);
+    uint32_t head = s_journal.head;
+    uint32_t first = s_upload_all ? 0 : s_journal.uploaded;
+    portEXIT_CRITICAL(&s_journal_mux);
+
+    if (head > JOURNAL_ENTRIES && head - first > JOURNAL_ENTRIES) {
+        first = head - JOURNAL_ENTRIES;  // older records were overwritten
+    }
+    if (first == head) return;
+
+    uint32_t total = head - first;
+    uint8_t chunks =
+        (total + JOURNAL_CHUNK_ENTRIES - 1) / JOURNAL_CHUNK_ENTRIES;
+
+    for (uint8_t c = 0; c < chunks; c++) {
+        mesh_app_msg_t msg = {0};
+        msg.src_id = g_device_id;
+        msg.msg_type = MSG_TYPE_DIAG;
+
+        journal_chunk_hdr_t* hdr = (journal_chunk_hdr_t*)msg.data;
+        hdr->chunk = c;
+        hdr->chunks = chunks;
+        hdr->reset_reason = s_reset_reason;
+        hdr->boot_count = s_journal.boot_count;
+
+        uint32_t start = first + c * JOURNAL_CHUNK_ENTRIES;
+        uint32_t count = head - start;
+        if (count > JOURNAL_CHUNK_ENTRIES) count = JOURNAL_CHUNK_ENTRIES;
+        hdr->count = count;
+
+        journal_entry_t* out = (journal_entry_t*)(msg.data + sizeof(*hdr));
+        portENTER_CRITICAL(&s_journal_mux);
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = s_journal.entries[(start + i) % JOURNAL_ENTRIES];
+        }
+        portEXIT_CRITICAL(&s_journal_mux);
+        msg.data_len = sizeof(*hdr) + count * sizeof(journal_entry_t);
+
+        if (g_is_root) {
+            root_handle_diag(&msg);
+        } else if (!mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL)) {
+            ESP_LOGW(TAG, "Journal upload interrupted at chunk %d/%d", c + 1,
+                     chunks);
+            return;  // the whole batch is resent next time
+        }
+    }
+
+    portENTER_CRITICAL(&s_journal_mux);
+    s_journal.uploaded = head;
+    s_journal.check = journal_checksum();
+    portEXIT_CRITICAL(&s_journal_mux);
+    s_upload_all = false;
+
+    ESP_LOGI(TAG, "Uploaded %" PRIu32 " journal record(s) in %d chunk(s)",
+             total, chunks);
+}
+
+// ====================
+// Names
+// ====================
+
+/** @brief Short name of a JOURNAL_EV_* code for MQTT output. */
+const char* journal_event_name(uint8_t event) {
+    switch (event) {
+        case JOURNAL_EV_BOOT:
+            return "boot";
+        case JOURNAL_EV_MESH_STARTED:
+            return "mesh_started";
+        case JOURNAL_EV_MESH_STOPPED:
+            return "mesh_stopped";
+        case JOURNAL_EV_PARENT_CONNECTED:
+            return "parent_connected";
+        case JOURNAL_EV_PARENT_DISCONNECTED:
+            return "parent_disconnected";
+        case JOURNAL_EV_ROOT_GAINED:
+            return "root_gained";
+        case JOURNAL_EV_ROOT_LOST:
+            return "root_lost";
+        case JOURNAL_EV_HEAP_LOW:
+            return "heap_low";
+        case JOURNAL_EV_HEAP_CRITICAL:
+            return "heap_critical";
+        case JOURNAL_EV_TX_DROP:
+            return "tx_drop";
+        case JOURNAL_EV_TASK_WDT:
+            return "task_wdt";
+        case JOURNAL_EV_OTA_START:
+            return "ota_start";
+        case JOURNAL_EV_OTA_FAILED:
+            return "ota_failed";
+        case JOURNAL_EV_MQTT_CONNECTED:
+            return "mqtt_connected";
+        case JOURNAL_EV_MQTT_DISCONNECTED:
+            return "mqtt_disconnected";
+        default:
+            return "unknown";
+    }
+}
+
+/** @brief Short name of an esp_reset_reason_t value. */
+const char* journal_reset_reason_name(uint8_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON:
+            return "poweron";
+        case ESP_RST_EXT:
+            return "external";
+        case ESP_RST_SW:
+            return "software";
+        case ESP_RST_PANIC:
+            return "panic";
+        case ESP_RST_INT_WDT:
+            return "int_wdt";
+        case ESP_RST_TASK_WDT:
+            return "task_wdt";
+        case ESP_RST_WDT:
+            return "wdt";
+        case ESP_RST_DEEPSLEEP:
+            return "deepsleep";
+        case ESP_RST_BROWNOUT:
+            return "brownout";
+        case ESP_RST_SDIO:
+            return "sdio";
+        default:
+            return "unknown";
+    }
+}
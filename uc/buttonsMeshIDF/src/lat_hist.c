@@ -0,0 +1,66 @@
+/**
+ * @file lat_hist.c
+ * @brief Log-linear latency histograms for the benchmark and link probe
+ *        reports.
+ *
+ * Values are in µs.  Below 4 every value has its own bucket; above, each
+ * power of two is split into four, so a quantile read back is at most 25 %
+ * above the true value.  Count, min, mean and max are exact.  The struct is
+ * fixed-size and packed so a node can send one to the root as is.
+ */
+
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+
+/** @brief Bucket of v: exact below 4, then four per power of two. */
+static int lat_hist_bucket(uint32_t v) {
+    if (v < 4) return v;
+    int octave = 31 - __builtin_clz(v);
+    int bucket = 4 * (octave - 1) + ((v >> (octave - 2)) & 3);
+    return bucket < LAT_HIST_BUCKETS ? bucket : LAT_HIST_BUCKETS - 1;
+}
+
+/** @brief Largest value that falls into bucket b. */
+static uint32_t lat_hist_bucket_top(int b) {
+    if (b < 4) return b;
+    int octave = b / 4 + 1;
+    uint32_t width = 1u << (octave - 2);
+    return (uint32_t)(4 + b % 4) * width + width - 1;
+}
+
+void lat_hist_add(lat_hist_t* h, int64_t us) {
+    if (us < 0) us = 0;
+    uint32_t v = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    if (h->count == 0 || v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->count++;
+    h->sum += v;
+    h->buckets[lat_hist_bucket(v)]++;
+}
+
+uint32_t lat_hist_quantile(const lat_hist_t* h, int permille) {
+    uint64_t rank = ((uint64_t)h->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int b = 0; b < LAT_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t top = lat_hist_bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+void lat_hist_add_json(cJSON* parent, const char* name, const lat_hist_t* h) {
+    cJSON* obj = cJSON_AddObjectToObject(parent, name);
+    cJSON_AddNumberToObject(obj, "n", h->count);
+    if (h->count == 0) return;
+    cJSON_AddNumberToObject(obj, "min", h->min);
+    cJSON_AddNumberToObject(obj, "mean", (double)(h->sum / h->count));
+    cJSON_AddNumberToObject(obj, "p50", lat_hist_quantile(h, 500));
+    cJSON_AddNumberToObject(obj, "p90", lat_hist_quantile(h, 900));
+    cJSON_AddNumberToObject(obj, "p99", lat_hist_quantile(h, 990));
+    cJSON_AddNumberToObject(obj, "max", h->max);
+}
@@ -0,0 +1,530 @@
+/**
+ * @file link_probe.c
+ * @brief Link probe: goodput, loss, one-way latency and RTT between the root
+ *        and one node, measured over esp_mesh_send().
+ *
+ * The "probe" root command starts link_probe_task(), which runs up to three
+ * phases against the chosen node, one after the other:
+ *
+ *  - down:  the root streams PROBE_OP_DATA frames to the node in bursts,
+ *           waits PROBE_DRAIN_MS and asks for what arrived (PROBE_OP_RESULT).
+ *  - up:    the node streams to the root the same way (PROBE_OP_BEGIN_UP)
+ *           and sends its send totals (PROBE_OP_UP_DONE) when done.
+ *  - rtt:   sequential PROBE_OP_ECHO_REQ pings, each answered at once.
+ *
+ * Test frames skip the TX queue and go straight to mesh_send_to_node(), so
+ * the numbers are the link's and not the queue's pacing.  Each direction
+ * reports the frames sent and received, loss, reordering, the offered rate
+ * and the goodput (both between the first and the last frame), the
+ * one-way latency from the mesh_time_us stamps (when both clocks are
+ * synced) and the node's hop count.  The report goes to
+ * /switch/probe/<device id>.
+ *
+ * Command: {"type":"probe","device":"<id>"} with optional "frames":200,
+ *          "burst":10, "gapMs":10, "pings":20, "direction":"both".
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+
+static const char* TAG = "PROBE";
+
+#define PROBE_POLL_MS 10
+
+/** @brief Receive side of one stream (the node's down, the root's up). */
+typedef struct {
+    uint32_t run_id;
+    uint32_t received;
+    uint32_t reordered;
+    uint32_t next_seq;  // one past the highest seq seen
+    int64_t first_us;
+    int64_t last_us;
+    lat_hist_t latency;
+} probe_rx_t;
+
+static probe_rx_t s_rx;
+
+static void probe_rx_reset(uint32_t run_id) {
+    memset(&s_rx, 0, sizeof(s_rx));
+    s_rx.run_id = run_id;
+}
+
+static void probe_rx_frame(const mesh_app_msg_t* msg,
+                           const probe_frame_t* frame, int64_t rx_local_us) {
+    if (frame->run_id != s_rx.run_id) return;
+
+    if (s_rx.received == 0) s_rx.first_us = rx_local_us;
+    s_rx.last_us = rx_local_us;
+    s_rx.received++;
+    if (frame->seq < s_rx.next_seq) {
+        s_rx.reordered++;
+    } else {
+        s_rx.next_seq = frame->seq + 1;
+    }
+
+    int64_t rx_mesh_us = mesh_time_from_local_us(rx_local_us);
+    if (msg->mesh_time_us != 0 && rx_mesh_us != 0) {
+        lat_hist_add(&s_rx.latency, rx_mesh_us - msg->mesh_time_us);
+    }
+}
+
+/** @brief Send one probe frame now; @p dest NULL is the root. */
+static esp_err_t probe_send(mesh_addr_t* dest, char op, const void* body,
+                            size_t len) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_PROBE;
+    msg.data[0] = op;
+    memcpy(&msg.data[1], body, len);
+    msg.data_len = 1 + len;
+    return mesh_send_to_node(dest, &msg);
+}
+
+/**
+ * @brief Stream @p frames DATA frames, @p burst back to back and then
+ *        @p gap_ms of pause.  Returns the send failures; @p span_us gets the
+ *        time from the first to the last send.
+ */
+static uint32_t probe_stream(mesh_addr_t* dest, uint32_t run_id,
+                             uint32_t frames, uint32_t burst, uint32_t gap_ms,
+                             uint32_t* span_us) {
+    uint32_t failed = 0;
+    int64_t first_us = esp_timer_get_time(), last_us = first_us;
+    for (uint32_t seq = 0; seq < frames && !g_ota_in_progress; seq++) {
+        if (seq > 0 && seq % burst == 0) {
+            vTaskDelay(gap_ms ? pdMS_TO_TICKS(gap_ms) : 1);
+        }
+        last_us = esp_timer_get_time();
+        probe_frame_t frame = {
+            .run_id = run_id,
+            .seq = seq,
+            .tx_us = last_us,
+        };
+        if (probe_send(dest, PROBE_OP_DATA, &frame, sizeof(frame)) !=
+            ESP_OK) {
+            failed++;
+        }
+    }
+    *span_us = (uint32_t)(last_us - first_us);
+    return failed;
+}
+
+// ====================
+// Node
+// ====================
+
+static probe_up_params_t s_up_params;
+static TaskHandle_t s_up_task = NULL;
+
+/** @brief FreeRTOS task: the node's half of the up phase. */
+static void probe_up_task(void* arg) {
+    probe_up_params_t p = s_up_params;
+    uint32_t span_us;
+    uint32_t failed = probe_stream(NULL, p.run_id, p.frames, p.burst,
+                                   p.gap_ms, &span_us);
+    probe_up_done_t done = {
+        .run_id = p.run_id,
+        .sent = p.frames - failed,
+        .failed = failed,
+        .span_us = span_us,
+        .layer = (uint8_t)g_mesh_layer,
+    };
+    probe_send(NULL, PROBE_OP_UP_DONE, &done, sizeof(done));
+
+    ESP_LOGI(TAG, "Run %" PRIu32 ": sent %" PRIu32 " frames up, %" PRIu32
+             " failed", p.run_id, done.sent, done.failed);
+    s_up_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void probe_node_handle(const mesh_app_msg_t* msg,
+                              const probe_frame_t* frame,
+                              int64_t rx_local_us) {
+    switch (msg->data[0]) {
+        case PROBE_OP_BEGIN_DOWN:
+            probe_rx_reset(frame->run_id);
+            ESP_LOGI(TAG, "Run %" PRIu32 ": expecting %" PRIu32 " frames",
+                     frame->run_id, frame->seq);
+            break;
+        case PROBE_OP_DATA:
+            probe_rx_frame(msg, frame, rx_local_us);
+            break;
+        case PROBE_OP_RESULT_REQ: {
+            probe_result_t result = {
+                .run_id = frame->run_id,
+                .layer = (uint8_t)g_mesh_layer,
+            };
+            if (s_rx.run_id == frame->run_id) {
+                result.received = s_rx.received;
+                result.reordered = s_rx.reordered;
+                result.span_us = (uint32_t)(s_rx.last_us - s_rx.first_us);
+                result.latency = s_rx.latency;
+            }
+            probe_send(NULL, PROBE_OP_RESULT, &result, sizeof(result));
+            break;
+        }
+        case PROBE_OP_BEGIN_UP:
+            if (msg->data_len < 1 + sizeof(probe_up_params_t)) return;
+            if (s_up_task != NULL) {
+                ESP_LOGW(TAG, "Up stream already running");
+                return;
+            }
+            memcpy(&s_up_params, &msg->data[1], sizeof(s_up_params));
+            if (s_up_params.burst == 0) s_up_params.burst = 1;
+            if (xTaskCreate(probe_up_task, "probe_up", 3072, NULL, 3,
+                            &s_up_task) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to start the probe task");
+                s_up_task = NULL;
+            }
+            break;
+        case PROBE_OP_ECHO_REQ:
+            probe_send(NULL, PROBE_OP_ECHO, frame, sizeof(*frame));
+            break;
+        default:
+            ESP_LOGW(TAG, "Unknown probe op '%c'", msg->data[0]);
+            break;
+    }
+}
+
+// ====================
+// Root: Replies
+// ====================
+
+/** @brief Probe parameters; fixed while s_running. */
+typedef struct {
+    uint64_t device_id;
+    mesh_addr_t addr;
+    uint32_t run_id;
+    uint32_t frames;
+    uint32_t burst;
+    uint32_t gap_ms;
+    uint32_t pings;
+    bool down;
+    bool up;
+} probe_params_t;
+
+static probe_params_t s_params;
+static volatile bool s_running = false;
+
+// One reply is awaited at a time: the probe task sets the op (and for
+// echoes the seq), the RX task fills the slot and then sets s_reply_ready.
+static char s_wait_op = 0;
+static uint32_t s_wait_seq = 0;
+static bool s_reply_ready = false;
+static uint8_t s_reply[sizeof(probe_result_t)];
+static int64_t s_reply_rx_us = 0;
+
+static void probe_expect(char op, uint32_t seq) {
+    __atomic_store_n(&s_reply_ready, false, __ATOMIC_RELAXED);
+    s_wait_seq = seq;
+    __atomic_store_n(&s_wait_op, op, __ATOMIC_RELEASE);
+}
+
+static bool probe_replied(void) {
+    return __atomic_load_n(&s_reply_ready, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Wait for the expected reply; false after @p timeout_ms. */
+static bool probe_wait(uint32_t timeout_ms) {
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (!probe_replied()) {
+        if (esp_timer_get_time() >= deadline_us) return false;
+        vTaskDelay(pdMS_TO_TICKS(PROBE_POLL_MS));
+    }
+    return true;
+}
+
+static void probe_root_handle(const mesh_app_msg_t* msg,
+                              const probe_frame_t* frame,
+                              int64_t rx_local_us) {
+    if (!s_running || msg->src_id != s_params.device_id ||
+        frame->run_id != s_params.run_id) {
+        return;
+    }
+
+    char op = msg->data[0];
+    if (op == PROBE_OP_DATA) {
+        probe_rx_frame(msg, frame, rx_local_us);
+        return;
+    }
+    if (op != __atomic_load_n(&s_wait_op, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&s_reply_ready, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (op == PROBE_OP_ECHO && frame->seq != s_wait_seq) return;
+
+    size_t len = msg->data_len - 1;
+    memcpy(s_reply, &msg->data[1], len < sizeof(s_reply) ? len
+                                                          : sizeof(s_reply));
+    s_reply_rx_us = rx_local_us;
+    __atomic_store_n(&s_reply_ready, true, __ATOMIC_RELEASE);
+}
+
+void link_probe_handle_message(const mesh_app_msg_t* msg,
+                               int64_t rx_local_us) {
+    // Every body starts with the run ID; shorter ones read as zero seq.
+    if (msg->data_len < 1 + sizeof(uint32_t) ||
+        msg->data_len > MESH_MSG_DATA_SIZE) {
+        return;
+    }
+    probe_frame_t frame = {0};
+    size_t len = msg->data_len - 1;
+    memcpy(&frame, &msg->data[1], len < sizeof(frame) ? len : sizeof(frame));
+
+    if (g_is_root) {
+        probe_root_handle(msg, &frame, rx_local_us);
+    } else {
+        probe_node_handle(msg, &frame, rx_local_us);
+    }
+}
+
+// ====================
+// Root: Phases and Report
+// ====================
+
+/** @brief Rate in kbit/s of @p frames full frames spread over @p span_us. */
+static double probe_kbps(uint32_t frames, uint32_t span_us) {
+    if (frames < 2 || span_us == 0) return 0;
+    return (double)(frames - 1) * sizeof(mesh_app_msg_t) * 8000.0 / span_us;
+}
+
+/**
+ * @brief Add one direction's numbers to the report.
+ * @param result What the receiving side saw, or NULL if it never said.
+ */
+static void probe_add_direction(cJSON* json, const char* name, uint32_t sent,
+                                uint32_t failed, uint32_t send_span_us,
+                                const probe_result_t* result) {
+    cJSON* obj = cJSON_AddObjectToObject(json, name);
+    cJSON_AddNumberToObject(obj, "sent", sent);
+    cJSON_AddNumberToObject(obj, "sendFailed", failed);
+    cJSON_AddNumberToObject(obj, "offeredKbps",
+                            probe_kbps(sent, send_span_us));
+    cJSON_AddBoolToObject(obj, "answered", result != NULL);
+    if (result == NULL) return;
+
+    uint32_t received = result->received;
+    uint32_t lost = sent > received ? sent - received : 0;
+    cJSON_AddNumberToObject(obj, "received", received);
+    cJSON_AddNumberToObject(obj, "lost", lost);
+    cJSON_AddNumberToObject(obj, "lossPct", sent ? 100.0 * lost / sent : 0);
+    cJSON_AddNumberToObject(obj, "reordered", result->reordered);
+    cJSON_AddNumberToObject(obj, "goodputKbps",
+                            probe_kbps(received, result->span_us));
+    cJSON_AddNumberToObject(obj, "hops",
+                            result->layer > 0 ? result->layer - 1 : 0);
+    lat_hist_add_json(obj, "latencyUs", &result->latency);
+}
+
+static void probe_run_down(cJSON* json) {
+    probe_params_t* p = &s_params;
+    probe_frame_t begin = {.run_id = p->run_id, .seq = p->frames};
+    probe_send(&p->addr, PROBE_OP_BEGIN_DOWN, &begin, sizeof(begin));
+
+    uint32_t span_us;
+    uint32_t failed = probe_stream(&p->addr, p->run_id, p->frames, p->burst,
+                                   p->gap_ms, &span_us);
+    vTaskDelay(pdMS_TO_TICKS(PROBE_DRAIN_MS));
+
+    probe_expect(PROBE_OP_RESULT, 0);
+    probe_frame_t req = {.run_id = p->run_id};
+    probe_send(&p->addr, PROBE_OP_RESULT_REQ, &req, sizeof(req));
+    bool answered = probe_wait(PROBE_REPLY_TIMEOUT_MS);
+
+    static probe_result_t result;
+    memcpy(&result, s_reply, sizeof(result));
+    probe_add_direction(json, "down", p->frames - failed, failed, span_us,
+                        answered ? &result : NULL);
+}
+
+static void probe_run_up(cJSON* json) {
+    probe_params_t* p = &s_params;
+    probe_rx_reset(p->run_id);
+    probe_expect(PROBE_OP_UP_DONE, 0);
+    probe_up_params_t up = {
+        .run_id = p->run_id,
+        .frames = (uint16_t)p->frames,
+        .burst = (uint8_t)p->burst,
+        .gap_ms = (uint16_t)p->gap_ms,
+    };
+    probe_send(&p->addr, PROBE_OP_BEGIN_UP, &up, sizeof(up));
+
+    // No fixed deadline: give up once the node has been quiet too long.
+    uint32_t seen = 0;
+    int64_t active_us = esp_timer_get_time();
+    while (!probe_replied()) {
+        int64_t now_us = esp_timer_get_time();
+        uint32_t received = __atomic_load_n(&s_rx.received, __ATOMIC_RELAXED);
+        if (received != seen) {
+            seen = received;
+            active_us = now_us;
+        } else if (now_us - active_us >
+                   (int64_t)PROBE_REPLY_TIMEOUT_MS * 1000) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(PROBE_POLL_MS));
+    }
+    bool answered = probe_replied();
+    vTaskDelay(pdMS_TO_TICKS(PROBE_DRAIN_MS));
+
+    // The root is the receiver here, so the result is always known; only
+    // the send totals depend on PROBE_OP_UP_DONE.
+    probe_up_done_t done = {0};
+    if (answered) memcpy(&done, s_reply, sizeof(done));
+    static probe_result_t result;
+    result.received = s_rx.received;
+    result.reordered = s_rx.reordered;
+    result.span_us = (uint32_t)(s_rx.last_us - s_rx.first_us);
+    result.layer = done.layer;
+    result.latency = s_rx.latency;
+    probe_add_direction(json, "up", answered ? done.sent : p->frames,
+                        done.failed, done.span_us, &result);
+    cJSON_AddBoolToObject(cJSON_GetObjectItem(json, "up"), "reported",
+                          answered);
+}
+
+static void probe_run_rtt(cJSON* json) {
+    probe_params_t* p = &s_params;
+    static lat_hist_t rtt;
+    memset(&rtt, 0, sizeof(rtt));
+    uint32_t lost = 0;
+
+    for (uint32_t seq = 0; seq < p->pings && !g_ota_in_progress; seq++) {
+        probe_expect(PROBE_OP_ECHO, seq);
+        probe_frame_t ping = {
+            .run_id = p->run_id,
+            .seq = seq,
+            .tx_us = esp_timer_get_time(),
+        };
+        probe_send(&p->addr, PROBE_OP_ECHO_REQ, &ping, sizeof(ping));
+        if (probe_wait(PROBE_ECHO_TIMEOUT_MS)) {
+            lat_hist_add(&rtt, s_reply_rx_us - ping.tx_us);
+        } else {
+            lost++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(PROBE_PING_GAP_MS));
+    }
+
+    lat_hist_add_json(json, "rttUs", &rtt);
+    cJSON_AddNumberToObject(cJSON_GetObjectItem(json, "rttUs"), "lost",
+                            lost);
+}
+
+/** @brief FreeRTOS task: run the phases in turn and publish the report. */
+static void link_probe_task(void* arg) {
+    probe_params_t* p = &s_params;
+    int64_t start_us = esp_timer_get_time();
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        s_running = false;
+        vTaskDelete(NULL);
+        return;
+    }
+    char id[24];
+    snprintf(id, sizeof(id), "%" PRIu64, p->device_id);
+    cJSON_AddStringToObject(json, "node", id);
+    cJSON_AddNumberToObject(json, "run", p->run_id);
+    cJSON_AddNumberToObject(json, "frameBytes", sizeof(mesh_app_msg_t));
+    cJSON_AddNumberToObject(json, "burst", p->burst);
+    cJSON_AddNumberToObject(json, "gapMs", p->gap_ms);
+
+    if (p->down) probe_run_down(json);
+    if (p->up) probe_run_up(json);
+    if (p->pings) probe_run_rtt(json);
+    cJSON_AddNumberToObject(json, "elapsedMs",
+                            (esp_timer_get_time() - start_us) / 1000);
+    s_running = false;
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise probe report");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/probe/%" PRIu64, p->device_id);
+    if (g_mqtt_connected) {
+        esp_mqtt_client_publish(g_mqtt_client, topic, json_str, 0, 0, 0);
+    }
+    ESP_LOGI(TAG, "Run %" PRIu32 " done: %s", p->run_id, json_str);
+    cJSON_free(json_str);
+    vTaskDelete(NULL);
+}
+
+// ====================
+// Root: Command
+// ====================
+
+/** @brief Number field of the command clamped to [lo, hi], or @p def. */
+static uint32_t probe_json_number(const cJSON* json, const char* key,
+                                  uint32_t def, uint32_t lo, uint32_t hi) {
+    const cJSON* item = cJSON_GetObjectItem(json, key);
+    if (!cJSON_IsNumber(item)) return def;
+    double v = item->valuedouble;
+    return v < lo ? lo : v > hi ? hi : (uint32_t)v;
+}
+
+void link_probe_command(const cJSON* json) {
+    if (s_running) {
+        ESP_LOGW(TAG, "Probe %" PRIu32 " still in progress", s_params.run_id);
+        return;
+    }
+
+    const cJSON* device = cJSON_GetObjectItem(json, "device");
+    uint64_t device_id = 0;
+    if (cJSON_IsString(device)) {
+        device_id = strtoull(device->valuestring, NULL, 10);
+    } else if (cJSON_IsNumber(device)) {
+        device_id = (uint64_t)device->valuedouble;
+    }
+
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+    int found = -1;
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == device_id) found = i;
+    }
+    if (found < 0) {
+        ESP_LOGW(TAG, "%" PRIu64 " is not a registered node", device_id);
+        return;
+    }
+
+    probe_params_t* p = &s_params;
+    memset(p, 0, sizeof(*p));
+    p->device_id = device_id;
+    p->addr = addrs[found];
+    p->frames = probe_json_number(json, "frames", 200, 1, PROBE_MAX_FRAMES);
+    p->burst = probe_json_number(json, "burst", 10, 1, 255);
+    p->gap_ms = probe_json_number(json, "gapMs", 10, 0, 1000);
+    p->pings = probe_json_number(json, "pings", 20, 0, PROBE_MAX_PINGS);
+    p->down = p->up = true;
+    const cJSON* direction = cJSON_GetObjectItem(json, "direction");
+    if (cJSON_IsString(direction)) {
+        p->down = strcmp(direction->valuestring, "up") != 0;
+        p->up = strcmp(direction->valuestring, "down") != 0;
+    }
+    p->run_id = (uint32_t)(esp_timer_get_time() / 1000) | 1;
+
+    s_running = true;
+    ESP_LOGI(TAG,
+             "Run %" PRIu32 ": %" PRIu64 ", %" PRIu32 " frames in bursts of %"
+             PRIu32 " every %" PRIu32 " ms, %" PRIu32 " pings",
+             p->run_id, device_id, p->frames, p->burst, p->gap_ms, p->pings);
+    if (xTaskCreate(link_probe_task, "probe", 4096, NULL, 2, NULL) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to start the probe task");
+        s_running = false;
+    }
+}
@@ -0,0 +1,177 @@
+/**
+ * @file log_ring.c
+ * @brief Lock-free multi-producer in-RAM log ring.
+ *
+ * Log output is treated as a byte stream cut into fixed LOG_RING_SLOT_TEXT
+ * chunks.  A writer reserves as many consecutive tickets as its line needs
+ * with one atomic fetch-add on s_head, fills the slots those tickets map to,
+ * and publishes each one by storing an even sequence number (ticket << 1);
+ * while a slot is being filled its sequence is odd.  Writers never wait for
+ * each other or for readers: the oldest data is simply overwritten.
+ *
+ * Readers own a cursor (the next ticket they want).  A slot is valid for a
+ * cursor only if its sequence equals cursor << 1 both before and after the
+ * copy (per-slot seqlock); a newer sequence means the reader was lapped and
+ * the gap is reported as dropped slots.  Any number of readers can follow
+ * the ring independently (UART drain and each Telnet client).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+
+static const char* TAG = "LOG_RING";
+
+/** One chunk of log text. */
+typedef struct {
+    volatile uint32_t seq;  // ticket << 1 when valid, odd while writing
+    uint8_t len;
+    char text[LOG_RING_SLOT_TEXT];
+} log_slot_t;
+
+static log_slot_t* s_slots = NULL;
+static volatile uint32_t s_head = 0;  // next ticket to hand out
+
+// ====================
+// Initialization
+// ====================
+
+/**
+ * @brief Allocate the ring.  Idempotent.
+ * @return ESP_OK, or ESP_ERR_NO_MEM.
+ */
+esp_err_t log_ring_init(void) {
+    if (s_slots != NULL) return ESP_OK;
+
+    log_slot_t* slots =
+        heap_tag_calloc(HEAP_TAG_TELNET, LOG_RING_SLOTS, sizeof(log_slot_t));
+    if (slots == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate log ring (%d bytes)",
+                 (int)(LOG_RING_SLOTS * sizeof(log_slot_t)));
+        return ESP_ERR_NO_MEM;
+    }
+    // No ticket maps to an all-ones sequence, so fresh slots read as empty.
+    for (int i = 0; i < LOG_RING_SLOTS; i++) {
+        slots[i].seq = UINT32_MAX;
+    }
+    s_slots = slots;
+    return ESP_OK;
+}
+
+/** @brief Cursor positioned at the oldest data still in the ring. */
+uint32_t log_ring_oldest_cursor(void) {
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+    return head > LOG_RING_SLOTS ? head - LOG_RING_SLOTS : 0;
+}
+
+/** @brief Cursor positioned at the newest data (nothing pending). */
+uint32_t log_ring_head_cursor(void) {
+    return __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+}
+
+// ====================
+// Writer
+// ====================
+
+/**
+ * @brief Append bytes to the ring.  Safe from any task on any core; never
+ *        blocks.  Does nothing if the ring has not been initialised.
+ * @param data Bytes to append.
+ * @param len  Number of bytes.
+ */
+void log_ring_write(const char* data, size_t len) {
+    if (s_slots == NULL || len == 0) return;
+
+    // Lines longer than the whole ring would only overwrite themselves.
+    if (len > LOG_LINE_MAX) len = LOG_LINE_MAX;
+
+    uint32_t count = (len + LOG_RING_SLOT_TEXT - 1) / LOG_RING_SLOT_TEXT;
+    uint32_t ticket = __atomic_fetch_add(&s_head, count, __ATOMIC_ACQ_REL);
+
+    for (uint32_t i = 0; i < count; i++, ticket++) {
+        log_slot_t* slot = &s_slots[ticket & (LOG_RING_SLOTS - 1)];
+        size_t chunk = len > LOG_RING_SLOT_TEXT ? LOG_RING_SLOT_TEXT : len;
+
+        __atomic_store_n(&slot->seq, (ticket << 1) | 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(slot->text, data, chunk);
+        slot->len = chunk;
+        __atomic_store_n(&slot->seq, ticket << 1, __ATOMIC_RELEASE);
+
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+// ====================
+// Reader
+// ====================
+
+/**
+ * @brief Copy committed bytes starting at *cursor into out.
+ *
+ * Stops at the first slot that is not yet committed, at the head, or when
+ * the next slot would not fit.  If the reader has been lapped, the cursor
+ * jumps to the oldest retained slot and the skipped slot count is added to
+ * *dropped.
+ *
+ * @param cursor  Reader cursor, advanced past the copied slots.
+ * @param out     Output buffer.
+ * @param max     Output buffer size (≥ LOG_RING_SLOT_TEXT).
+ * @param dropped Incremented by the number of slots lost; may be NULL.
+ * @return Number of bytes copied.
+ */
+size_t log_ring_read(uint32_t* cursor, char* out, size_t max,
+                     uint32_t* dropped) {
+    if (s_slots == NULL) return 0;
+
+    size_t used = 0;
+    while (used + LOG_RING_SLOT_TEXT <= max) {
+        uint32_t head = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+        uint32_t c = *cursor;
+        if (c == head) break;
+
+        if (head - c > LOG_RING_SLOTS) {
+            uint32_t oldest = head - LOG_RING_SLOTS;
+            if (dropped) *dropped += oldest - c;
+            *cursor = c = oldest;
+        }
+
+        log_slot_t* slot = &s_slots[c & (LOG_RING_SLOTS - 1)];
+        uint32_t want = c << 1;
+        uint32_t seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq1 != want) {
+            if (seq1 != UINT32_MAX && (int32_t)(seq1 - want) > 1) {
+                // Overwritten by a later lap before we got to it.
+                if (dropped) (*dropped)++;
+                *cursor = c + 1;
+                continue;
+            }
+            if (head - c > LOG_RING_SLOTS / 2) {
+                // Writer stalled mid-copy for far too long: skip it.
+                if (dropped) (*dropped)++;
+                *cursor = c + 1;
+                continue;
+            }
+            break;  // still being written, try again later
+        }
+
+        uint8_t len = slot->len;
+        if (len > LOG_RING_SLOT_TEXT) len = LOG_RING_SLOT_TEXT;
+        memcpy(out + used, slot->text, len);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq1) {
+            // Lapped during the copy: discard it.
+            if (dropped) (*dropped)++;
+            *cursor = c + 1;
+            continue;
+        }
+
+        used += len;
+        *cursor = c + 1;
+    }
+    return used;
+}
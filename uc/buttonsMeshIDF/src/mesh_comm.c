@@ -5,6 +5,7 @@
  *
  * Provides:
  *  - mesh_send_to_node()   – thin wrapper around esp_mesh_send().
+ *  - mesh_send_raw()       – the same without time stamp or fault layer.
  *  - mesh_rx_task()        – receives packets and dispatches to root or leaf
  *                            handler.
  *  - mesh_tx_task()        – drains a queue of outbound packets.
@@ -24,12 +25,12 @@ static const char* TAG = "MESH_COMM";
 // ====================
 
 /**
- * @brief Send a mesh application message to a specific node or to the root.
+ * @brief Hand a stamped message to esp_mesh_send() and account for it.
  * @param dest Destination mesh address.  Pass NULL to route to root.
  * @param msg  Pointer to the message structure to send.
  * @return ESP_OK on success, or an esp_err_t error code.
  */
-esp_err_t mesh_send_to_node(mesh_addr_t* dest, mesh_app_msg_t* msg) {
+esp_err_t mesh_send_raw(mesh_addr_t* dest, mesh_app_msg_t* msg) {
     mesh_data_t data = {
         .data = (uint8_t*)msg,
         .size = sizeof(mesh_app_msg_t),
@@ -37,26 +38,208 @@ esp_err_t mesh_send_to_node(mesh_addr_t* dest, mesh_app_msg_t* msg) {
         .tos = MESH_TOS_P2P,
     };
 
+    TRACE_MARK(TRACE_MARK_MESH_TX, msg->msg_type);
     esp_err_t err = esp_mesh_send(dest, &data, MESH_DATA_P2P, NULL, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Send to node failed: %s", esp_err_to_name(err));
+        counter_send_error(err);
+    } else {
+        counter_inc(CNT_MESH_SEND_OK);
+        counter_tx(msg->msg_type);
+        CAPTURE_MESH(CAPTURE_REC_MESH_TX, dest, msg);
+        if (msg->msg_type == MSG_TYPE_COMMAND ||
+            msg->msg_type == MSG_TYPE_BUTTON) {
+            boot_mark(BOOT_PHASE_FIRST_ROUTE);
+            failover_mark(FAILOVER_EV_FIRST_ROUTE);
+        }
     }
     return err;
 }
 
+/**
+ * @brief Send a mesh application message to a specific node or to the root.
+ *        The message is time-stamped here, then passes the fault layer
+ *        (CONFIG_DOMATOR_FAULT), which may drop, hold or duplicate it.
+ * @param dest Destination mesh address.  Pass NULL to route to root.
+ * @param msg  Pointer to the message structure to send.
+ * @return ESP_OK on success, or an esp_err_t error code.
+ */
+esp_err_t mesh_send_to_node(mesh_addr_t* dest, mesh_app_msg_t* msg) {
+    time_sync_stamp_outgoing(msg);
+
+    switch (FAULT_TX(dest, msg)) {
+        case FAULT_DROP:
+        case FAULT_HOLD:
+            return ESP_OK;
+        case FAULT_DUPLICATE:
+            mesh_send_raw(dest, msg);
+            break;
+        default:
+            break;
+    }
+    return mesh_send_raw(dest, msg);
+}
+
 // ====================
 // RX Task
 // ====================
 
 /**
- * @brief Receive incoming mesh packets and dispatch them to the appropriate
- *        handler.
+ * @brief Dispatch one received message to the appropriate handler.
  *
- * When this node is root, all messages are forwarded to
+ * MSG_TYPE_TIME and MSG_TYPE_PROBE go straight to time_sync_handle_message()
+ * and link_probe_handle_message() on every node, together with the receive
+ * timestamp taken right after esp_mesh_recv(), and MSG_TYPE_FAULT to
+ * fault_handle_message() (CONFIG_DOMATOR_FAULT).
+ * Otherwise, when this node is root, all messages are forwarded to
  * root_handle_mesh_message().  Leaf nodes handle MSG_TYPE_COMMAND,
- * MSG_TYPE_SYNC_REQUEST, MSG_TYPE_OTA_START, and MSG_TYPE_PING directly.
+ * MSG_TYPE_SYNC_REQUEST, MSG_TYPE_OTA_START, MSG_TYPE_SCHEDULE,
+ * MSG_TYPE_CONFIG, MSG_TYPE_REPLICA, MSG_TYPE_DIAG, MSG_TYPE_TASK_STATS and
+ * MSG_TYPE_PING directly.
+ */
+static void mesh_rx_dispatch(mesh_addr_t* from, mesh_app_msg_t* msg,
+                             int64_t rx_local_us) {
+    if (msg->msg_type == MSG_TYPE_TIME) {
+        time_sync_handle_message(from, msg, rx_local_us);
+        return;
+    }
+
+    if (msg->msg_type == MSG_TYPE_PROBE) {
+        link_probe_handle_message(msg, rx_local_us);
+        return;
+    }
+
+#if CONFIG_DOMATOR_FAULT
+    if (msg->msg_type == MSG_TYPE_FAULT) {
+        fault_handle_message(msg);
+        return;
+    }
+#endif
+
+    if (g_is_root) {
+        root_handle_mesh_message(from, msg);
+        return;
+    }
+    switch (msg->msg_type) {
+        case MSG_TYPE_COMMAND: {
+            ESP_LOGI(TAG, "Command received: %.*s (latency %lld us)",
+                     (int)strnlen(msg->data, msg->data_len), msg->data,
+                     (long long)mesh_time_message_age_us(msg));
+
+            if (g_node_type == NODE_TYPE_RELAY_8 ||
+                g_node_type == NODE_TYPE_RELAY_16) {
+                bench_tag_t tag;
+                if (!bench_tag_get(msg, &tag)) {
+                    relay_handle_command((char*)msg->data);
+                    boot_mark(BOOT_PHASE_FIRST_ROUTE);
+                    failover_mark(FAILOVER_EV_FIRST_ROUTE);
+                    break;
+                }
+                if (!(tag.flags & BENCH_FLAG_DRY_RUN)) {
+                    relay_handle_command((char*)msg->data);
+                }
+                bench_relay_applied(&tag);
+            }
+
+            break;
+        }
+
+        case MSG_TYPE_SYNC_REQUEST: {
+            ESP_LOGI(TAG, "Received sync request from root");
+
+            if (g_node_type == NODE_TYPE_RELAY_8 ||
+                g_node_type == NODE_TYPE_RELAY_16) {
+                relay_sync_all_states();
+            }
+
+            break;
+        }
+
+        case MSG_TYPE_OTA_START: {
+            ESP_LOGI(TAG, "OTA update packet received from root");
+            g_ota_requested = true;
+            break;
+        }
+
+        case MSG_TYPE_SCHEDULE: {
+            ESP_LOGI(TAG, "Schedule table received from root");
+
+            if (g_node_type == NODE_TYPE_RELAY_8 ||
+                g_node_type == NODE_TYPE_RELAY_16) {
+                schedule_handle_message(msg);
+                boot_mark(BOOT_PHASE_CONFIG);
+            }
+
+            break;
+        }
+
+        case MSG_TYPE_CONFIG: {
+            if (msg->data_len >= 1 &&
+                msg->data[0] == CONFIG_KEY_GESTURES &&
+                g_node_type == NODE_TYPE_SWITCH_C3) {
+                ESP_LOGI(TAG, "Gesture config received from root");
+                gesture_handle_config(msg);
+                boot_mark(BOOT_PHASE_CONFIG);
+            } else if (msg->data_len >= 1 &&
+                       msg->data[0] == CONFIG_KEY_REDETECT) {
+                fast_boot_request_redetect();
+            } else if (msg->data_len >= 2 &&
+                       msg->data[0] == CONFIG_KEY_ROOT_ROLE) {
+                standby_set_role((uint8_t)msg->data[1]);
+            }
+            break;
+        }
+
+        case MSG_TYPE_REPLICA: {
+            standby_handle_replica(msg);
+            break;
+        }
+
+        case MSG_TYPE_DIAG: {
+            ESP_LOGI(TAG, "Journal upload requested by root");
+            journal_request_upload();
+            break;
+        }
+
+        case MSG_TYPE_TASK_STATS: {
+            ESP_LOGI(TAG, "Task telemetry requested by root");
+            mesh_app_msg_t reply;
+            task_stats_build_msg(&reply);
+            mesh_queue_to_node(&reply, TX_PRIO_NORMAL, NULL);
+            break;
+        }
+
+        case MSG_TYPE_BENCH: {
+            if (g_node_type == NODE_TYPE_SWITCH_C3) {
+                bench_switch_handle(msg);
+            }
+            break;
+        }
+
+        case MSG_TYPE_PING: {
+            ESP_LOGV(TAG, "Received ping from %" PRIu64, msg->src_id);
+
+            mesh_app_msg_t pong = *msg;
+            pong.src_id = g_device_id;
+            pong.msg_type = MSG_TYPE_PING;
+            mesh_queue_to_node(&pong, TX_PRIO_HIGH, from);
+            ESP_LOGV(TAG, "Sent pong to %" PRIu64, msg->src_id);
+            break;
+        }
+
+        default: {
+            ESP_LOGW(TAG, "Unknown msg type: %c", msg->msg_type);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Receive incoming mesh packets and hand them to mesh_rx_dispatch().
+ *
  * Messages targeted at a device type that does not match this node are
- * silently discarded.
+ * silently discarded.  With CONFIG_DOMATOR_FAULT the rest pass the fault
+ * layer first; frames it holds back are dispatched from here once due.
  */
 void mesh_rx_task(void* arg) {
     mesh_addr_t from;
@@ -81,9 +264,16 @@ void mesh_rx_task(void* arg) {
         rx_data.size = sizeof(rx_buf);
 
         esp_err_t err =
-            esp_mesh_recv(&from, &rx_data, pdMS_TO_TICKS(5000), &flag, NULL, 0);
+            esp_mesh_recv(&from, &rx_data,
+                          pdMS_TO_TICKS(FAULT_RX_TIMEOUT_MS(5000)), &flag,
+                          NULL, 0);
+        int64_t rx_local_us = esp_timer_get_time();
+        mesh_app_msg_t* msg = (mesh_app_msg_t*)rx_buf;
 
         if (err == ESP_ERR_MESH_TIMEOUT) {
+            while (FAULT_RX_RELEASE(&from, msg, &rx_local_us)) {
+                mesh_rx_dispatch(&from, msg, rx_local_us);
+            }
             esp_task_wdt_reset();
             continue;
         }
@@ -95,11 +285,16 @@ void mesh_rx_task(void* arg) {
             continue;
         }
 
-        if (rx_data.size < sizeof(mesh_app_msg_t)) {
+        if (rx_data.size < MESH_MSG_LEGACY_SIZE) {
             continue;
         }
+        if (rx_data.size < sizeof(mesh_app_msg_t)) {
+            msg->mesh_time_us = 0;  // legacy sender, no clock stamp
+        }
 
-        mesh_app_msg_t* msg = (mesh_app_msg_t*)rx_data.data;
+        counter_rx(msg->msg_type);
+        TRACE_MARK(TRACE_MARK_MESH_RX, msg->msg_type);
+        CAPTURE_MESH(CAPTURE_REC_MESH_RX, &from, msg);
 
         if ((msg->target_type == DEVICE_TYPE_RELAY &&
              g_node_type != NODE_TYPE_RELAY_8 &&
@@ -114,56 +309,16 @@ void mesh_rx_task(void* arg) {
             continue;
         }
 
-        if (g_is_root) {
-            root_handle_mesh_message(&from, msg);
-            esp_task_wdt_reset();
-            continue;
+        fault_verdict_t verdict = FAULT_RX(&from, msg);
+        if (verdict == FAULT_DUPLICATE) {
+            mesh_rx_dispatch(&from, msg, rx_local_us);
         }
-        switch (msg->msg_type) {
-            case MSG_TYPE_COMMAND: {
-                ESP_LOGI(TAG, "Command received: %.*s", msg->data_len,
-                         msg->data);
-
-                if (g_node_type == NODE_TYPE_RELAY_8 ||
-                    g_node_type == NODE_TYPE_RELAY_16) {
-                    relay_handle_command((char*)msg->data);
-                }
-
-                break;
-            }
-
-            case MSG_TYPE_SYNC_REQUEST: {
-                ESP_LOGI(TAG, "Received sync request from root");
-
-                if (g_node_type == NODE_TYPE_RELAY_8 ||
-                    g_node_type == NODE_TYPE_RELAY_16) {
-                    relay_sync_all_states();
-                }
-
-                break;
-            }
-
-            case MSG_TYPE_OTA_START: {
-                ESP_LOGI(TAG, "OTA update packet received from root");
-                g_ota_requested = true;
-                break;
-            }
-
-            case MSG_TYPE_PING: {
-                ESP_LOGV(TAG, "Received ping from %" PRIu64, msg->src_id);
-
-                mesh_app_msg_t pong = *msg;
-                pong.src_id = g_device_id;
-                pong.msg_type = MSG_TYPE_PING;
-                mesh_queue_to_node(&pong, TX_PRIO_HIGH, &from);
-                ESP_LOGV(TAG, "Sent pong to %" PRIu64, msg->src_id);
-                break;
-            }
-
-            default: {
-                ESP_LOGW(TAG, "Unknown msg type: %c", msg->msg_type);
-                break;
-            }
+        if (verdict == FAULT_PASS || verdict == FAULT_DUPLICATE) {
+            mesh_rx_dispatch(&from, msg, rx_local_us);
+        }
+        // Held frames go out after the one that overtook them.
+        while (FAULT_RX_RELEASE(&from, msg, &rx_local_us)) {
+            mesh_rx_dispatch(&from, msg, rx_local_us);
         }
         esp_task_wdt_reset();
     }
@@ -189,6 +344,7 @@ static QueueHandle_t queue = NULL;
  */
 void mesh_tx_task(void* arg) {
     queue = xQueueCreate(40, sizeof(tx_item_t*));
+    task_stats_register_queue("tx", queue);
 
     esp_err_t wdt_err = esp_task_wdt_add(NULL);
     if (wdt_err != ESP_OK) {
@@ -209,20 +365,33 @@ void mesh_tx_task(void* arg) {
             continue;
         }
 
+        esp_err_t err;
         if (item->to_root) {
-            mesh_send_to_node(NULL, item->msg);
+            err = mesh_send_to_node(NULL, item->msg);
         } else {
-            mesh_send_to_node(&item->dest, item->msg);
+            err = mesh_send_to_node(&item->dest, item->msg);
+        }
+
+        // Delivery feedback for the user's own presses.
+        if (item->msg->msg_type == MSG_TYPE_BUTTON ||
+            item->msg->msg_type == MSG_TYPE_GESTURE) {
+            led_post_event(err == ESP_OK ? LED_EVENT_DELIVERED
+                                         : LED_EVENT_DELIVERY_FAILED);
         }
 
-        free(item->msg);
-        free(item);
+        heap_tag_free(HEAP_TAG_MESH_TX, item->msg);
+        heap_tag_free(HEAP_TAG_MESH_TX, item);
 
         vTaskDelay(pdMS_TO_TICKS(2));
         esp_task_wdt_reset();
     }
 }
 
+/** @brief Number of messages waiting in the internal TX queue. */
+int mesh_tx_queue_depth(void) {
+    return queue ? (int)uxQueueMessagesWaiting(queue) : 0;
+}
+
 /**
  * @brief Enqueue a message for asynchronous transmission.
  *
@@ -242,9 +411,11 @@ void mesh_tx_task(void* arg) {
  */
 bool mesh_queue_to_node(mesh_app_msg_t* msg, tx_priority_t prio,
                         mesh_addr_t* dest) {
-    tx_item_t* item = malloc(sizeof(tx_item_t));
+    PROF_SCOPE(PROF_TX_ENQUEUE);
+    tx_item_t* item = heap_tag_malloc(HEAP_TAG_MESH_TX, sizeof(tx_item_t));
     if (!item) {
         ESP_LOGE(TAG, "OOM queuing message");
+        counter_inc(CNT_DROP_TX_OOM);
         return false;
     }
 
@@ -256,9 +427,10 @@ bool mesh_queue_to_node(mesh_app_msg_t* msg, tx_priority_t prio,
         item->to_root = true;
     }
 
-    item->msg = malloc(sizeof(mesh_app_msg_t));
+    item->msg = heap_tag_malloc(HEAP_TAG_MESH_TX, sizeof(mesh_app_msg_t));
     if (!item->msg) {
-        free(item);
+        heap_tag_free(HEAP_TAG_MESH_TX, item);
+        counter_inc(CNT_DROP_TX_OOM);
         return false;
     }
     memcpy(item->msg, msg, sizeof(mesh_app_msg_t));
@@ -278,11 +450,15 @@ bool mesh_queue_to_node(mesh_app_msg_t* msg, tx_priority_t prio,
     if (sent != pdTRUE) {
         ESP_LOGW(TAG, "Queue full, dropping message (prio=%d, pending=%u)",
                  prio, (unsigned int)uxQueueMessagesWaiting(queue));
-        free(item->msg);
-        free(item);
+        journal_record(JOURNAL_EV_TX_DROP, uxQueueMessagesWaiting(queue));
+        counter_inc(prio == TX_PRIO_HIGH ? CNT_DROP_TX_HIGH
+                                         : CNT_DROP_TX_NORMAL);
+        heap_tag_free(HEAP_TAG_MESH_TX, item->msg);
+        heap_tag_free(HEAP_TAG_MESH_TX, item);
         return false;
     }
 
+    task_stats_note_queue(queue);
     return true;
 }
 
@@ -293,9 +469,10 @@ bool mesh_queue_to_node(mesh_app_msg_t* msg, tx_priority_t prio,
 /**
  * @brief Build a JSON status payload and enqueue it toward the root node.
  *
- * Collects uptime, free heap, RSSI, mesh layer, firmware hash, and statistics
- * counters, serialises them as a compact JSON object, and places the result
- * into a MSG_TYPE_STATUS message.  Skipped when this node is root (the root
+ * Collects uptime, free heap, RSSI, mesh layer, firmware hash, the task and
+ * heap telemetry summaries and as much of the counter snapshot as fits,
+ * serialises them as a compact JSON object, and places the result into a
+ * MSG_TYPE_STATUS message.  Skipped when this node is root (the root
  * publishes its own status directly to MQTT via root_publish_status()).
  */
 void node_publish_status(void) {
@@ -318,10 +495,7 @@ void node_publish_status(void) {
     esp_wifi_sta_get_rssi(&rssi);
 
     if (free_heap < LOW_HEAP_THRESHOLD) {
-        if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            g_stats.low_heap_events++;
-            xSemaphoreGive(g_stats_mutex);
-        }
+        counter_inc(CNT_LOW_HEAP);
     }
 
     const char* type_str = "unknown";
@@ -352,13 +526,32 @@ void node_publish_status(void) {
     cJSON_AddNumberToObject(json, "freeHeap", free_heap);
     cJSON_AddNumberToObject(json, "uptime", uptime);
     cJSON_AddNumberToObject(json, "firmware", g_firmware_timestamp);
-    cJSON_AddNumberToObject(json, "clicks", g_stats.button_presses);
+    cJSON_AddNumberToObject(json, "clicks", counter_get(CNT_BUTTON_PRESSES));
     cJSON_AddNumberToObject(json, "rssi", rssi);
     cJSON_AddNumberToObject(json, "meshLayer", g_mesh_layer);
-    cJSON_AddNumberToObject(json, "disconnects", g_stats.mesh_disconnects);
-    cJSON_AddNumberToObject(json, "lowHeap", g_stats.low_heap_events);
-
+    cJSON_AddNumberToObject(json, "disconnects",
+                            counter_get(CNT_MESH_DISCONNECTS));
+    cJSON_AddNumberToObject(json, "lowHeap", counter_get(CNT_LOW_HEAP));
+    cJSON_AddNumberToObject(json, "clockUncUs", mesh_time_uncertainty_us());
+
+    uint32_t btn_overflows = 0, btn_missed = 0;
+    button_input_get_stats(&btn_overflows, &btn_missed);
+    cJSON_AddNumberToObject(json, "btnOverflow", btn_overflows);
+    cJSON_AddNumberToObject(json, "btnMissed", btn_missed);
+    task_stats_add_summary(json);
+    heap_stats_add_summary(json);
+
+    // The counter snapshot gets whatever room is left in the mesh message.
     char* json_str = cJSON_PrintUnformatted(json);
+    if (json_str != NULL) {
+        size_t used = strlen(json_str);
+        cJSON_free(json_str);
+        if (used < MESH_MSG_DATA_SIZE - 1) {
+            counters_add_summary(json, MESH_MSG_DATA_SIZE - 1 - used);
+        }
+    }
+
+    json_str = cJSON_PrintUnformatted(json);
     cJSON_Delete(json);
 
     if (json_str != NULL) {
@@ -377,7 +570,7 @@ void node_publish_status(void) {
                      msg.data_len, MESH_MSG_DATA_SIZE - 1);
         }
 
-        free(json_str);
+        cJSON_free(json_str);
     }
 }
 
@@ -389,9 +582,10 @@ void node_publish_status(void) {
  * @brief Periodically publish a status report.
  *
  * Waits 5 seconds after start-up to let the mesh stabilise, then loops
- * every STATUS_REPORT_INTERVAL_MS.  Root nodes call root_publish_status();
- * leaf nodes call node_publish_status() to send a mesh message to the root.
- * Pauses during OTA.
+ * every STATUS_REPORT_INTERVAL_MS, taking a task telemetry sample each time
+ * (so CPU shares cover one status interval).  Root nodes call
+ * root_publish_status(); leaf nodes call node_publish_status() to send a
+ * mesh message to the root.  Pauses during OTA.
  */
 void status_report_task(void* arg) {
     ESP_LOGI(TAG, "Status report task started");
@@ -407,6 +601,8 @@ void status_report_task(void* arg) {
         ESP_LOGI(TAG, "Status: root=%d, connected=%d, heap=%" PRIu32, g_is_root,
                  g_mesh_connected, (uint32_t)esp_get_free_heap_size());
 
+        task_stats_sample();
+
         if (g_is_root) {
             root_publish_status();
         }
@@ -415,6 +611,10 @@ void status_report_task(void* arg) {
             node_publish_status();
         }
 
+        journal_upload_pending();
+        boot_report_poll();
+        failover_poll();
+
         vTaskDelay(pdMS_TO_TICKS(STATUS_REPORT_INTERVAL_MS));
     }
 }
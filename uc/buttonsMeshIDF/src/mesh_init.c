@@ -24,13 +24,38 @@ bool domator_mesh_is_wifi_connected(void) {
     return esp_netif_is_netif_up(netif);
 }
 
+/** @brief Send MSG_TYPE_TYPE_INFO (device type, root role) to the root. */
+void mesh_send_type_info(void) {
+    mesh_app_msg_t* msg = calloc(1, sizeof(mesh_app_msg_t));
+    if (msg == NULL) {
+        ESP_LOGW(TAG, "Failed to allocate type info msg");
+        return;
+    }
+    msg->src_id = g_device_id;
+    msg->msg_type = MSG_TYPE_TYPE_INFO;
+    char type_str = DEVICE_TYPE_SWITCH;
+    if (g_node_type == NODE_TYPE_RELAY_8 || g_node_type == NODE_TYPE_RELAY_16) {
+        type_str = DEVICE_TYPE_RELAY;
+    }
+
+    msg->data_len = 1;
+    msg->data[0] = type_str;
+    // Only nodes with a root role add it; the frame is otherwise unchanged.
+    if (standby_role() != ROOT_ROLE_NONE) {
+        msg->data[1] = (char)standby_role();
+        msg->data_len = 2;
+    }
+    mesh_queue_to_node(msg, TX_PRIO_NORMAL, NULL);
+    free(msg);
+}
+
 // ====================
 // IP Event Handler
 // ====================
 
 /**
- * @brief Handle IP_EVENT_STA_GOT_IP: start MQTT and Telnet when this node
- *        has been elected root and has an IP address.  Non-root nodes ignore
+ * @brief Handle IP_EVENT_STA_GOT_IP: start MQTT, Telnet, and SNTP when this
+ *        node has been elected root and has an IP address.  Non-root nodes ignore
  *        this event.
  */
 static void ip_event_handler(void* arg, esp_event_base_t event_base,
@@ -41,6 +66,8 @@ static void ip_event_handler(void* arg, esp_event_base_t event_base,
 
         if (esp_mesh_is_root()) {
             ESP_LOGI(TAG, "This node IS root, initializing MQTT");
+            boot_mark(BOOT_PHASE_GOT_IP);
+            failover_mark(FAILOVER_EV_GOT_IP);
             g_is_root = true;
             g_mesh_layer = 1;
 
@@ -52,6 +79,8 @@ static void ip_event_handler(void* arg, esp_event_base_t event_base,
             }
 
             telnet_start();
+            capture_start();
+            time_sync_start_sntp();
         } else {
             ESP_LOGI(TAG, "Got IP but not root (layer %d), skipping MQTT init",
                      g_mesh_layer);
@@ -75,12 +104,18 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
         case MESH_EVENT_STARTED:
             ESP_LOGI(TAG, "Mesh started");
             g_mesh_started = true;
+            journal_record(JOURNAL_EV_MESH_STARTED, 0);
+            boot_mark(BOOT_PHASE_MESH_STARTED);
+            fast_boot_on_mesh_started();
+            led_post_event(LED_EVENT_STATE_CHANGED);
             break;
 
         case MESH_EVENT_STOPPED:
             ESP_LOGI(TAG, "Mesh stopped");
             g_mesh_started = false;
             g_mesh_connected = false;
+            journal_record(JOURNAL_EV_MESH_STOPPED, 0);
+            led_post_event(LED_EVENT_STATE_CHANGED);
             break;
 
         case MESH_EVENT_PARENT_CONNECTED: {
@@ -89,16 +124,25 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "Parent connected, layer:%d", connected->self_layer);
             g_mesh_connected = true;
             g_mesh_layer = connected->self_layer;
+            journal_record(JOURNAL_EV_PARENT_CONNECTED, g_mesh_layer);
+            boot_mark(BOOT_PHASE_PARENT);
+            failover_mark(FAILOVER_EV_PARENT);
+            fast_boot_on_parent_connected(connected);
+            led_post_event(LED_EVENT_STATE_CHANGED);
 
             if (esp_mesh_is_root()) {
                 ESP_LOGI(TAG, "*** I AM ROOT ***");
+                if (!g_is_root) journal_record(JOURNAL_EV_ROOT_GAINED, 0);
                 g_is_root = true;
+                boot_mark(BOOT_PHASE_ROOT);
+                failover_mark(FAILOVER_EV_ROOT);
                 esp_netif_dhcpc_start(
                     esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"));
                 node_root_start();
             } else {
                 ESP_LOGI(TAG, "Not root (layer %d), ensuring MQTT is stopped",
                          g_mesh_layer);
+                if (g_is_root) journal_record(JOURNAL_EV_ROOT_LOST, 0);
                 g_is_root = false;
                 node_root_stop();
                 uint8_t parent_mac[6];
@@ -111,24 +155,7 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
                 ESP_LOGI(TAG, "Parent ID: %" PRIu64, g_parent_id);
             }
 
-            mesh_app_msg_t* msg = calloc(1, sizeof(mesh_app_msg_t));
-            if (msg) {
-                msg->src_id = g_device_id;
-                msg->msg_type = MSG_TYPE_TYPE_INFO;
-                char type_str = DEVICE_TYPE_SWITCH;
-                if (g_node_type == NODE_TYPE_RELAY_8 ||
-                    g_node_type == NODE_TYPE_RELAY_16) {
-                    type_str = DEVICE_TYPE_RELAY;
-                }
-
-                msg->data_len = 1;
-                msg->data[0] = type_str;
-                mesh_queue_to_node(msg, TX_PRIO_NORMAL, NULL);
-                free(msg);
-            } else {
-                ESP_LOGW(TAG,
-                         "Failed to allocate msg for parent connected event");
-            }
+            mesh_send_type_info();
 
             ESP_LOGI(TAG,
                      "Parent connected - Layer: %d, Mesh connected, status "
@@ -141,17 +168,23 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
             mesh_event_disconnected_t* disconnected =
                 (mesh_event_disconnected_t*)event_data;
             g_mesh_connected = false;
+            led_post_event(LED_EVENT_STATE_CHANGED);
 
             ESP_LOGW(TAG, "Parent disconnected - Reason: %d",
                      disconnected->reason);
+            journal_record(JOURNAL_EV_PARENT_DISCONNECTED,
+                           disconnected->reason);
 
             g_parent_id = 0;
+            counter_inc(CNT_MESH_DISCONNECTS);
+            failover_mark(FAILOVER_EV_PARENT_LOST);
+            fast_boot_on_parent_lost();
+            break;
 
-            if (g_stats_mutex &&
-                xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                g_stats.mesh_disconnects++;
-                xSemaphoreGive(g_stats_mutex);
-            }
+        case MESH_EVENT_NO_PARENT_FOUND:
+            ESP_LOGW(TAG, "No parent found");
+            failover_mark(FAILOVER_EV_NO_PARENT);
+            fast_boot_on_parent_lost();
             break;
 
         case MESH_EVENT_TODS_STATE: {
@@ -163,18 +196,28 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
 
         case MESH_EVENT_ROOT_SWITCH_REQ:
             ESP_LOGI(TAG, "Root switch requested");
+            failover_mark(FAILOVER_EV_SWITCH_REQ);
             break;
 
-        case MESH_EVENT_ROOT_SWITCH_ACK:
+        case MESH_EVENT_ROOT_SWITCH_ACK: {
+            bool was_root = g_is_root;
             g_is_root = esp_mesh_is_root();
+            if (g_is_root != was_root) {
+                journal_record(g_is_root ? JOURNAL_EV_ROOT_GAINED
+                                         : JOURNAL_EV_ROOT_LOST,
+                               0);
+            }
             ESP_LOGI(TAG, "Root switched, am I root? %s",
                      g_is_root ? "YES" : "NO");
+            failover_mark(FAILOVER_EV_SWITCH_ACK);
             if (g_is_root) {
+                failover_mark(FAILOVER_EV_ROOT);
                 node_root_start();
             } else {
                 node_root_stop();
             }
             break;
+        }
 
         case MESH_EVENT_CHILD_CONNECTED: {
             mesh_event_child_connected_t* child =
@@ -208,7 +251,8 @@ static void mesh_event_handler(void* arg, esp_event_base_t event_base,
  *  2. Initialise the mesh stack and register event handlers.
  *  3. Configure mesh ID, router SSID/password, softAP password, topology,
  *     parent-switching thresholds, and root-healing delay.
- *  4. Start the mesh.  Root election happens asynchronously.
+ *  4. Start the mesh.  Root election happens asynchronously, unless
+ *     fast_boot.c first tries a directed rejoin to the last parent.
  */
 void mesh_network_init(void) {
     ESP_ERROR_CHECK(esp_netif_init());
@@ -250,7 +294,9 @@ void mesh_network_init(void) {
 
     ESP_ERROR_CHECK(esp_mesh_set_config(&cfg));
 
-    ESP_ERROR_CHECK(esp_mesh_set_self_organized(true, true));
+    if (!fast_boot_rejoin_prepare()) {
+        ESP_ERROR_CHECK(esp_mesh_set_self_organized(true, true));
+    }
 
     mesh_switch_parent_t switch_parent_paras = {0};
     esp_mesh_get_switch_parent_paras(&switch_parent_paras);
@@ -263,9 +309,10 @@ void mesh_network_init(void) {
 
     ESP_ERROR_CHECK(esp_mesh_set_max_layer(4));
 
-    ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(0.6));
+    ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(MESH_VOTE_PERCENTAGE));
     ESP_ERROR_CHECK(esp_mesh_set_topology(MESH_TOPO_TREE));
-    ESP_ERROR_CHECK(esp_mesh_set_root_healing_delay(10000));
+    ESP_ERROR_CHECK(
+        esp_mesh_set_root_healing_delay(MESH_ROOT_HEALING_DELAY_MS));
 
     ESP_ERROR_CHECK(esp_mesh_start());
 
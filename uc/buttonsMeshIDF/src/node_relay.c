@@ -184,15 +184,6 @@ static void relay_set_auto_off_seconds(int index, uint32_t timeout_seconds) {
 // Helper Functions
 // ====================
 
-/** @brief Safely increment the global button press counter under the stats
- * mutex. */
-static void stats_increment_button_presses(void) {
-    if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        g_stats.button_presses++;
-        xSemaphoreGive(g_stats_mutex);
-    }
-}
-
 // ====================
 // NVS Flash Storage for Relay States
 // ====================
@@ -366,7 +357,7 @@ void relay_set(int index, bool state) {
 
     relay_update_auto_off_timer(index, state);
 
-    ESP_LOGI(TAG, "Relay %d set to %s", index, state ? "ON" : "OFF");
+    DLOGI(TAG, "Relay %d set to %s", index, state ? "ON" : "OFF");
 }
 
 /**
@@ -558,22 +549,22 @@ void relay_handle_command(const char* cmd_data) {
     }
 
     if (strlen(cmd_data) == 1) {
-        ESP_LOGI(TAG, "Toggle relay %d", index);
+        DLOGI(TAG, "Toggle relay %d", index);
         relay_toggle(index);
-        stats_increment_button_presses();
+        counter_inc(CNT_BUTTON_PRESSES);
     } else if (strlen(cmd_data) == 2) {
         char state_char = cmd_data[1];
         if (state_char == '0') {
-            ESP_LOGI(TAG, "Set relay %d OFF", index);
+            DLOGI(TAG, "Set relay %d OFF", index);
             relay_set(index, false);
         } else if (state_char == '1') {
-            ESP_LOGI(TAG, "Set relay %d ON", index);
+            DLOGI(TAG, "Set relay %d ON", index);
             relay_set(index, true);
         } else {
             ESP_LOGW(TAG, "Invalid state character: %c", state_char);
             return;
         }
-        stats_increment_button_presses();
+        counter_inc(CNT_BUTTON_PRESSES);
     } else {
         ESP_LOGW(TAG, "Invalid command length: %s", cmd_data);
         return;
@@ -583,70 +574,34 @@ void relay_handle_command(const char* cmd_data) {
 }
 
 // ====================
-// Physical Button ISR
+// Physical Buttons
 // ====================
 
 /**
- * @brief GPIO ISR handler for relay board buttons.
- *        Notifies relay_button_task() by setting the bit corresponding to the
- *        button index in the task notification value.
- * @param arg Button index cast to (void*).
- */
-static void IRAM_ATTR relay_button_isr_handler(void* arg) {
-    uint32_t button_index = (uint32_t)arg;
-
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-    xTaskNotifyFromISR(button_task_handle, (1 << button_index), eSetBits,
-                       &xHigherPriorityTaskWoken);
-
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
-    }
-}
-
-/**
- * @brief Configure relay board button GPIOs and install ISR handlers.
+ * @brief Configure relay board button GPIOs via the shared timestamping
+ *        input (button_input.c).
  */
 void relay_button_init(void) {
     ESP_LOGI(TAG, "Initializing relay board buttons");
 
-    for (int i = 0; i < NUM_BUTTONS; i++) {
-        gpio_config_t io_conf = {
-            .pin_bit_mask = (1ULL << g_relay_button_pins[i]),
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .pull_down_en = GPIO_PULLDOWN_ENABLE,
-            .intr_type = GPIO_INTR_ANYEDGE,
-        };
-        gpio_config(&io_conf);
+    button_input_init(g_relay_button_pins, NUM_BUTTONS);
 
+    for (int i = 0; i < NUM_BUTTONS; i++) {
         g_relay_button_states[i].last_state =
             gpio_get_level(g_relay_button_pins[i]);
-        g_relay_button_states[i].last_bounce_time = 0;
         g_relay_button_states[i].press_start_time = 0;
         g_relay_button_states[i].last_release_time = 0;
-
-        ESP_LOGI(TAG, "Relay button %d initialized on GPIO %d", i,
-                 g_relay_button_pins[i]);
-    }
-
-    ESP_ERROR_CHECK(gpio_install_isr_service(ESP_INTR_FLAG_IRAM));
-
-    for (int i = 0; i < NUM_BUTTONS; i++) {
-        ESP_ERROR_CHECK(gpio_isr_handler_add(
-            g_relay_button_pins[i], relay_button_isr_handler, (void*)i));
     }
 }
 
 /**
- * @brief FreeRTOS task: handle button interrupts on relay boards and forward
- *        button state changes to the root node via MSG_TYPE_BUTTON.
+ * @brief FreeRTOS task: take debounced, ISR-timestamped button transitions
+ *        on relay boards and forward them to the root via MSG_TYPE_BUTTON.
  */
 void relay_button_task(void* arg) {
     ESP_LOGI(TAG, "Relay button task started");
 
-    uint32_t notified_value;
+    button_event_t ev;
 
     while (1) {
         if (g_ota_in_progress) {
@@ -654,88 +609,72 @@ void relay_button_task(void* arg) {
             continue;
         }
 
-        if (!xTaskNotifyWait(0, 0xFFFFFFFF, &notified_value, portMAX_DELAY)) {
+        if (!button_input_get_event(&ev, pdMS_TO_TICKS(1000))) {
             continue;
         }
 
-        for (int i = 0; i < NUM_BUTTONS; i++) {
-            if (!(notified_value & (1 << i))) {
-                continue;
-            }
-
-            int gpio_num = g_relay_button_pins[i];
+        int i = ev.index;
+        int current_state = ev.level;
+        uint32_t current_time = ev.time_us / 1000;
 
-            int current_state = gpio_get_level(gpio_num);
-            uint32_t current_time = esp_timer_get_time() / 1000;
+        if (current_state == g_relay_button_states[i].last_state) {
+            continue;
+        }
 
-            if (current_state == g_relay_button_states[i].last_state) {
-                continue;
-            }
+        g_relay_button_states[i].last_state = current_state;
+
+        DLOGI(TAG, "Relay button %d state changed to %d", i, current_state);
+
+        if (current_state == 0 &&
+            current_time - g_relay_button_states[i].press_start_time >
+                BUTTON_PRESS_OTA_THRESHOLD_MS &&
+            g_relay_button_states[i].press_start_time -
+                    g_relay_button_states[i].last_release_time <
+                BUTTON_PRESS_OTA_INTERVAL_MS) {
+            ESP_LOGI(TAG,
+                     "Button %d was pressed for %" PRIu32
+                     " ms, which exceeds the OTA threshold. "
+                     "Triggering OTA...",
+                     i,
+                     (uint32_t)(current_time -
+                                g_relay_button_states[i].press_start_time));
+            g_ota_requested = true;
+        }
 
-            g_relay_button_states[i].last_state = current_state;
-
-            if (current_time - g_relay_button_states[i].last_bounce_time >
-                BUTTON_DEBOUNCE_MS) {
-                ESP_LOGI(TAG, "Relay button %d state changed to %d", i,
-                         current_state);
-
-                if (current_state == 0 &&
-                    current_time - g_relay_button_states[i].press_start_time >
-                        BUTTON_PRESS_OTA_THRESHOLD_MS &&
-                    g_relay_button_states[i].press_start_time -
-                            g_relay_button_states[i].last_release_time <
-                        BUTTON_PRESS_OTA_INTERVAL_MS) {
-                    ESP_LOGI(
-                        TAG,
-                        "Button %d was pressed for %" PRIu32
-                        " ms, which exceeds the OTA threshold. "
-                        "Triggering OTA...",
-                        i,
-                        (uint32_t)(current_time -
-                                   g_relay_button_states[i].press_start_time));
-                    g_ota_requested = true;
-                }
-
-                if (current_state == 1) {
-                    g_relay_button_states[i].press_start_time = current_time;
-                } else {
-                    g_relay_button_states[i].last_release_time = current_time;
-                }
-
-                stats_increment_button_presses();
-
-                char button_char = 'a' + i;
-                uint32_t duration_ms =
-                    current_time - g_relay_button_states[i].press_start_time;
-
-                mesh_app_msg_t msg = {0};
-                msg.src_id = g_device_id;
-                msg.msg_type = MSG_TYPE_BUTTON;
-                msg.data[0] = button_char;
-                msg.data[1] = current_state ? '1' : '0';
-                if (current_state == 0) {
-                    /* On release: encode long/short press in 3rd byte.
-                     * '1' = long press (≥ LONG_PRESS_THRESHOLD_MS). */
-                    msg.data[2] =
-                        (duration_ms >= LONG_PRESS_THRESHOLD_MS) ? '1' : '0';
-                    msg.data_len = 3;
-                } else {
-                    msg.data_len = 2;
-                }
-                mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
-
-                ESP_LOGI(TAG,
-                         "Sent button '%c' state %d to root. "
-                         "Pressed for %" PRIu32 " ms (%s)",
-                         button_char, current_state, duration_ms,
-                         (current_state == 0 &&
-                          duration_ms >= LONG_PRESS_THRESHOLD_MS)
-                             ? "LONG"
-                             : "short");
-            }
+        if (current_state == 1) {
+            g_relay_button_states[i].press_start_time = current_time;
+        } else {
+            g_relay_button_states[i].last_release_time = current_time;
+        }
 
-            g_relay_button_states[i].last_bounce_time = current_time;
+        counter_inc(CNT_BUTTON_PRESSES);
+
+        char button_char = 'a' + i;
+        uint32_t duration_ms =
+            current_time - g_relay_button_states[i].press_start_time;
+
+        mesh_app_msg_t msg = {0};
+        msg.src_id = g_device_id;
+        msg.msg_type = MSG_TYPE_BUTTON;
+        msg.data[0] = button_char;
+        msg.data[1] = current_state ? '1' : '0';
+        if (current_state == 0) {
+            /* On release: encode long/short press in 3rd byte.
+             * '1' = long press (≥ LONG_PRESS_THRESHOLD_MS). */
+            msg.data[2] = (duration_ms >= LONG_PRESS_THRESHOLD_MS) ? '1' : '0';
+            msg.data_len = 3;
+        } else {
+            msg.data_len = 2;
         }
+        mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+
+        ESP_LOGI(TAG,
+                 "Sent button '%c' state %d to root. "
+                 "Pressed for %" PRIu32 " ms (%s)",
+                 button_char, current_state, duration_ms,
+                 (current_state == 0 && duration_ms >= LONG_PRESS_THRESHOLD_MS)
+                     ? "LONG"
+                     : "short");
     }
 }
 
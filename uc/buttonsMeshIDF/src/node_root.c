@@ -8,8 +8,8 @@
  *  - Maintains a registry (node_registry) mapping device IDs to mesh addresses.
  *  - Connects to the MQTT broker and subscribes to command topics.
  *  - Publishes relay state, button state, and device status messages.
- *  - Routes button press events to relay nodes based on the connection map
- *    (g_connections) pushed via MQTT JSON commands.
+ *  - Routes button presses and gestures to relay nodes based on the
+ *    connection map (g_connections) pushed via MQTT JSON commands.
  *  - Handles ping/pong round-trip latency tests.
  *
  * When the node loses root status, node_root_stop() tears down the MQTT client
@@ -17,6 +17,7 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "cJSON.h"
@@ -43,6 +44,7 @@ typedef struct {
     int64_t last_ping;
     int32_t avg_ping;
     int outputs;
+    uint8_t root_role;  // ROOT_ROLE_*
 } node_registry_entry_t;
 
 static node_registry_entry_t node_registry[MAX_NODES];
@@ -60,13 +62,27 @@ static blind_pair_t g_blind_pairs[MAX_BLIND_PAIRS];
 static int g_blind_pair_count = 0;
 static SemaphoreHandle_t g_blind_pairs_mutex = NULL;
 
-static void route_button_to_relays(uint64_t from_id, char button, int state);
+static void route_button_to_relays(uint64_t from_id, char button, int state,
+                                   const bench_tag_t* bench);
 static void route_blind_press(uint64_t from_id, char button,
                               bool is_long_press);
 static void parse_json_blind_pairs(cJSON* data);
+static void root_handle_gesture(const mesh_app_msg_t* msg);
+static void root_handle_bench_button(const mesh_app_msg_t* msg,
+                                     bench_tag_t* tag);
 static void handle_mqtt_command(const char* topic, int topic_len,
                                 const char* data, int data_len);
 
+/** @brief Publish with the root client; timed as PROF_MQTT_PUBLISH. */
+static int root_mqtt_publish(const char* topic, const char* data, int len,
+                             int qos, int retain) {
+    PROF_SCOPE(PROF_MQTT_PUBLISH);
+    CAPTURE_MQTT(CAPTURE_REC_MQTT_OUT, topic, -1, data,
+                 len > 0 ? len : (int)strlen(data), retain);
+    return esp_mqtt_client_publish(g_mqtt_client, topic, data, len, qos,
+                                   retain);
+}
+
 // ====================
 // Node Registry
 // ====================
@@ -82,6 +98,7 @@ static void handle_mqtt_command(const char* topic, int topic_len,
  */
 static void registry_update(uint64_t device_id, mesh_addr_t* addr,
                             const char* type) {
+    PROF_SCOPE(PROF_REGISTRY_LOOKUP);
     if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
         ESP_LOGE(TAG, "registry_update: mutex timeout");
         return;
@@ -115,6 +132,7 @@ static bool registry_find(uint64_t device_id, mesh_addr_t* out_addr) {
         return false;
     }
 
+    PROF_SCOPE(PROF_REGISTRY_LOOKUP);
     if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
         ESP_LOGE(TAG, "registry_find: mutex timeout");
         return false;
@@ -130,6 +148,109 @@ static bool registry_find(uint64_t device_id, mesh_addr_t* out_addr) {
     return false;
 }
 
+/**
+ * @brief Copy the IDs and mesh addresses of all registered nodes.
+ * @param ids   Output array of device IDs.
+ * @param addrs Output array of mesh addresses (same order as ids).
+ * @param max   Capacity of both arrays.
+ * @return Number of entries written.
+ */
+int root_registry_snapshot(uint64_t* ids, mesh_addr_t* addrs, int max) {
+    if (registry_mutex == NULL) return 0;
+
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "root_registry_snapshot: mutex timeout");
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < MAX_NODES && count < max; i++) {
+        if (node_registry[i].device_id == 0) continue;
+        ids[count] = node_registry[i].device_id;
+        memcpy(&addrs[count], &node_registry[i].mesh_addr, sizeof(mesh_addr_t));
+        count++;
+    }
+    xSemaphoreGive(registry_mutex);
+    return count;
+}
+
+/** @brief Record the root role a node reported in MSG_TYPE_TYPE_INFO. */
+static void registry_set_role(uint64_t device_id, uint8_t role) {
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "registry_set_role: mutex timeout");
+        return;
+    }
+    for (int i = 0; i < node_count; i++) {
+        if (node_registry[i].device_id == device_id) {
+            node_registry[i].root_role = role;
+            break;
+        }
+    }
+    xSemaphoreGive(registry_mutex);
+}
+
+char root_registry_type(uint64_t device_id) {
+    if (registry_mutex == NULL) return 0;
+
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "root_registry_type: mutex timeout");
+        return 0;
+    }
+    char type = 0;
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (node_registry[i].device_id == device_id) {
+            type = node_registry[i].node_type[0];
+            break;
+        }
+    }
+    xSemaphoreGive(registry_mutex);
+    return type;
+}
+
+uint8_t root_registry_role(uint64_t device_id) {
+    if (registry_mutex == NULL) return ROOT_ROLE_NONE;
+
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "root_registry_role: mutex timeout");
+        return ROOT_ROLE_NONE;
+    }
+    uint8_t role = ROOT_ROLE_NONE;
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (node_registry[i].device_id == device_id) {
+            role = node_registry[i].root_role;
+            break;
+        }
+    }
+    xSemaphoreGive(registry_mutex);
+    return role;
+}
+
+void root_registry_restore(const replica_node_t* node) {
+    if (registry_mutex == NULL || node->device_id == 0) return;
+
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "root_registry_restore: mutex timeout");
+        return;
+    }
+    int i = 0;
+    while (i < node_count && node_registry[i].device_id != node->device_id) {
+        i++;
+    }
+    if (i == node_count) {
+        if (node_count == MAX_NODES) {
+            xSemaphoreGive(registry_mutex);
+            return;
+        }
+        memset(&node_registry[i], 0, sizeof(node_registry[i]));
+        node_registry[i].device_id = node->device_id;
+        node_registry[i].last_seen = esp_timer_get_time() / 1000;
+        node_count++;
+    }
+    memcpy(node_registry[i].mesh_addr.addr, node->mesh_addr, 6);
+    if (node->type) node_registry[i].node_type[0] = node->type;
+    node_registry[i].root_role = node->role;
+    xSemaphoreGive(registry_mutex);
+}
+
 /**
  * @brief Retrieve the configured button type for a specific button on a device.
  * @param device_id Source device ID.
@@ -233,6 +354,7 @@ static bool button_targets_blind_pair(uint64_t from_id, char button,
  * @param msg  Pointer to the decoded application message.
  */
 void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
+    PROF_SCOPE(PROF_RX_STAGE(msg->msg_type));
     registry_update(msg->src_id, from, NULL);
     ESP_LOGV(TAG, "Message from %" PRIu64 " (type=%c, len=%d)", msg->src_id,
              msg->msg_type, msg->data_len);
@@ -261,11 +383,19 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
         }
 
         case MSG_TYPE_BUTTON: {
+            bench_tag_t tag;
+            if (bench_tag_get(msg, &tag)) {
+                root_handle_bench_button(msg, &tag);
+                break;
+            }
+
             char button = msg->data[0];
             int state = (msg->data_len > 1) ? msg->data[1] - '0' : -1;
 
-            ESP_LOGI(TAG, "Button '%c' from switch %" PRIu64 " (state=%d)",
-                     button, msg->src_id, state);
+            DLOGI(TAG,
+                  "Button '%c' from switch %" PRIu64
+                  " (state=%d, latency %" PRId64 " us)",
+                  button, msg->src_id, state, mesh_time_message_age_us(msg));
 
             int button_type = get_button_type(msg->src_id, button);
 
@@ -297,8 +427,7 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
                         snprintf(topic, sizeof(topic), "/switch/state/%" PRIu64,
                                  msg->src_id);
                         char payload[2] = {button, '\0'};
-                        esp_mqtt_client_publish(g_mqtt_client, topic, payload,
-                                                1, 1, 0);
+                        root_mqtt_publish(topic, payload, 1, 1, 0);
                     }
                 }
                 /* For state==1 (press): do nothing, wait for release. */
@@ -321,18 +450,21 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
                     char payload[2] = {button, '\0'};
                     ESP_LOGI(TAG, "Publishing button status to MQTT: %s",
                              payload);
-                    esp_mqtt_client_publish(g_mqtt_client, topic, payload, 2, 1,
-                                            0);
+                    root_mqtt_publish(topic, payload, 2, 1, 0);
                 } else {
                     char payload[3] = {button, state + '0', '\0'};
                     ESP_LOGI(TAG, "Publishing button status to MQTT: %s",
                              payload);
-                    esp_mqtt_client_publish(g_mqtt_client, topic, payload, 3, 1,
-                                            0);
+                    root_mqtt_publish(topic, payload, 3, 1, 0);
                 }
             }
 
-            route_button_to_relays(msg->src_id, button, state);
+            route_button_to_relays(msg->src_id, button, state, NULL);
+            break;
+        }
+
+        case MSG_TYPE_GESTURE: {
+            root_handle_gesture(msg);
             break;
         }
 
@@ -348,8 +480,9 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
                          msg->src_id);
                 char payload[3] = {relay_char, state_char, '\0'};
                 ESP_LOGI(TAG, "Publishing relay state to MQTT: %s", payload);
-                esp_mqtt_client_publish(g_mqtt_client, topic, payload, 2, 1, 1);
+                root_mqtt_publish(topic, payload, 2, 1, 1);
             }
+            standby_output_changed(msg->src_id, relay_char, state_char);
             break;
         }
 
@@ -366,20 +499,51 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
                 snprintf(topic, sizeof(topic), "/switch/state/root");
                 ESP_LOGV(TAG, "Publishing device status to MQTT: %s",
                          msg->data);
-                esp_mqtt_client_publish(g_mqtt_client, topic, msg->data,
-                                        msg->data_len, 0, 0);
+                root_mqtt_publish(topic, msg->data, msg->data_len, 0, 0);
             }
             break;
         }
 
-        case MSG_TYPE_TYPE_INFO: {
-            char type_str;
-            memcpy(&type_str, msg->data, msg->data_len);
-            ESP_LOGI(TAG, "Device type info from %" PRIu64 ": %c", msg->src_id,
-                     type_str);
-            registry_update(msg->src_id, from, &type_str);
+        case MSG_TYPE_DIAG: {
+            root_handle_diag(msg);
+            break;
+        }
 
-            if (type_str == DEVICE_TYPE_RELAY) {
+        case MSG_TYPE_TASK_STATS: {
+            root_handle_task_stats(msg);
+            break;
+        }
+
+        case MSG_TYPE_BOOT_REPORT: {
+            root_handle_boot_report(msg);
+            break;
+        }
+
+        case MSG_TYPE_BENCH: {
+            bench_root_handle(msg);
+            break;
+        }
+
+        case MSG_TYPE_FAILOVER: {
+            failover_handle_report(msg);
+            break;
+        }
+
+        case MSG_TYPE_TYPE_INFO: {
+            // One type character; registry_update() copies a string.
+            char type_str[2] = {msg->data_len ? msg->data[0] : '\0', '\0'};
+            uint8_t role =
+                msg->data_len > 1 ? (uint8_t)msg->data[1] : ROOT_ROLE_NONE;
+            ESP_LOGI(TAG, "Device type info from %" PRIu64 ": %c (root role %s)",
+                     msg->src_id, type_str[0], standby_role_name(role));
+            registry_update(msg->src_id, from, type_str);
+            registry_set_role(msg->src_id, role);
+            standby_node_joined();
+
+            // Start clock sync right away instead of at the next poll round.
+            time_sync_node_joined(msg->src_id, from);
+
+            if (type_str[0] == DEVICE_TYPE_RELAY) {
                 mesh_app_msg_t sync_msg = {0};
                 sync_msg.src_id = g_device_id;
                 sync_msg.msg_type = MSG_TYPE_SYNC_REQUEST;
@@ -438,8 +602,7 @@ void root_handle_mesh_message(mesh_addr_t* from, mesh_app_msg_t* msg) {
                 char payload[32];
                 snprintf(payload, sizeof(payload), "%" PRId32, avg_ping);
                 xSemaphoreGive(registry_mutex);
-                esp_mqtt_client_publish(g_mqtt_client, topic, payload,
-                                        strlen(payload), 0, 0);
+                root_mqtt_publish(topic, payload, strlen(payload), 0, 0);
                 break;
             }
 
@@ -517,6 +680,29 @@ static void route_blind_press(uint64_t from_id, char button,
 // Route Button to Relays
 // ====================
 
+/**
+ * @brief Find the routing entry of one button of a switch.
+ * @return Pointer into g_connections, or NULL if the device has no routes.
+ */
+static button_route_t* find_button_route(uint64_t from_id, int button_idx) {
+    PROF_SCOPE(PROF_ROUTE_LOOKUP);
+    button_route_t* route = NULL;
+    if (xSemaphoreTake(g_connections_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "route_button_to_relays: mutex timeout");
+        return NULL;
+    }
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (g_connections[i].device_id == from_id) {
+            DLOGI(TAG, "Found device index %d for device ID %" PRIu64, i,
+                  from_id);
+            route = &g_connections[i].buttons[button_idx];
+            break;
+        }
+    }
+    xSemaphoreGive(g_connections_mutex);
+    return route;
+}
+
 /**
  * @brief Forward a button event to all configured relay targets.
  *
@@ -528,35 +714,24 @@ static void route_blind_press(uint64_t from_id, char button,
  * @param from_id Source device ID (the switch that was pressed).
  * @param button  Button character ('a' – 'x').
  * @param state   Physical button state: 1 = pressed, 0 = released.
+ * @param bench   Benchmark tag copied into every command, or NULL outside
+ *                benchmark mode.
  */
-static void route_button_to_relays(uint64_t from_id, char button, int state) {
-    ESP_LOGI(TAG, "Route button '%c' from %" PRIu64 " (state=%d)", button,
-             from_id, state);
+static void route_button_to_relays(uint64_t from_id, char button, int state,
+                                   const bench_tag_t* bench) {
+    DLOGI(TAG, "Route button '%c' from %" PRIu64 " (state=%d)", button,
+          from_id, state);
 
     int button_idx = button - 'a';
     if (button_idx < 0 || button_idx >= MAX_BUTTONS_EXTENDED) {
         ESP_LOGW(TAG, "Invalid button index: %d", button_idx);
         return;
     }
-    button_route_t* route = NULL;
-    if (xSemaphoreTake(g_connections_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        ESP_LOGE(TAG, "route_button_to_relays: mutex timeout");
-        return;
-    }
-    for (int i = 0; i < MAX_NODES; i++) {
-        if (g_connections[i].device_id == from_id) {
-            ESP_LOGI(TAG, "Found device index %d for device ID %" PRIu64, i,
-                     from_id);
-            route = &g_connections[i].buttons[button_idx];
-            break;
-        }
-    }
-    xSemaphoreGive(g_connections_mutex);
-
+    button_route_t* route = find_button_route(from_id, button_idx);
     if (route == NULL) {
-        ESP_LOGI(TAG,
-                 "No routing configured for button '%c' from device %" PRIu64,
-                 button, from_id);
+        DLOGI(TAG,
+              "No routing configured for button '%c' from device %" PRIu64,
+              button, from_id);
         return;
     }
 
@@ -574,17 +749,447 @@ static void route_button_to_relays(uint64_t from_id, char button, int state) {
             } else {
                 cmd.data_len = 1;
             }
-            mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
-            ESP_LOGI(TAG,
-                     "Routed button '%c' of type %d from %" PRIu64
-                     " to relay command '%c' on device %" PRIu64,
-                     button, get_button_type(from_id, button), from_id,
-                     target->relay_command[0], target->target_node_id);
+            if (bench) bench_tag_put(&cmd, bench);
+            bool queued = mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+            if (bench) bench_root_on_command(queued);
+            DLOGI(TAG,
+                  "Routed button '%c' of type %d from %" PRIu64
+                  " to relay command '%c' on device %" PRIu64,
+                  button, get_button_type(from_id, button), from_id,
+                  target->relay_command[0], target->target_node_id);
         } else {
             ESP_LOGW(TAG, "No mesh address found for target device %" PRIu64,
                      target->target_node_id);
+            if (bench) bench_root_on_command(false);
+        }
+    }
+}
+
+/**
+ * @brief Route a synthetic press from a benchmark run (bench.c).
+ *
+ * Takes the same button-type and connections lookups as a real press, and
+ * the commands carry the tag so the relay reports when it handled them.
+ * Blind pairs and the /switch/state mirror are skipped: a blind motor has
+ * no dry run, and home automation must not react to synthetic presses.
+ */
+static void root_handle_bench_button(const mesh_app_msg_t* msg,
+                                     bench_tag_t* tag) {
+    if (!bench_root_on_button(msg, tag)) return;
+
+    char button = msg->data[0];
+    int state = (msg->data_len > 1) ? msg->data[1] - '0' : -1;
+    if (get_button_type(msg->src_id, button) == 0 && state == 1) {
+        return;  // toggle buttons act on release
+    }
+    route_button_to_relays(msg->src_id, button, state, tag);
+}
+
+// ====================
+// Gesture Handling
+// ====================
+
+/**
+ * @brief Route a MSG_TYPE_GESTURE from a switch and publish it to MQTT.
+ *
+ * Every gesture is published on /switch/gesture/<id> as "<button><gesture>"
+ * (plus the tick number for hold repeats).  Clicks are routed like presses of
+ * toggle buttons: a single click uses the button itself, double and triple
+ * clicks use the virtual buttons at +MAX_BUTTONS and +2*MAX_BUTTONS ('i'..'p',
+ * 'q'..'x') of the same switch's connection table.  For buttons wired to a
+ * blind pair, single click toggles power and long press toggles direction,
+ * exactly like the short/long release of a raw button.
+ */
+static void root_handle_gesture(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 2) return;
+
+    char button = msg->data[0];
+    char gesture = msg->data[1];
+    int button_idx = button - 'a';
+    if (button_idx < 0 || button_idx >= MAX_BUTTONS) {
+        ESP_LOGW(TAG, "Invalid gesture button: %c", button);
+        return;
+    }
+
+    ESP_LOGI(TAG,
+             "Gesture '%c' on button '%c' from switch %" PRIu64
+             " (latency %lld us)",
+             gesture, button, msg->src_id,
+             (long long)mesh_time_message_age_us(msg));
+
+    if (g_mqtt_connected) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "/switch/gesture/%" PRIu64, msg->src_id);
+        char payload[8];
+        int len;
+        if (gesture == GESTURE_REPEAT && msg->data_len >= 3) {
+            len = snprintf(payload, sizeof(payload), "%c%c%u", button, gesture,
+                           (uint8_t)msg->data[2]);
+        } else {
+            len = snprintf(payload, sizeof(payload), "%c%c", button, gesture);
+        }
+        root_mqtt_publish(topic, payload, len, 1, 0);
+    }
+
+    uint64_t blind_relay_id = 0;
+    char blind_power_id = 0, blind_dir_id = 0;
+    bool is_blind = button_targets_blind_pair(
+        msg->src_id, button, &blind_relay_id, &blind_power_id, &blind_dir_id);
+
+    if (is_blind && (gesture == GESTURE_SINGLE || gesture == GESTURE_LONG)) {
+        route_blind_press(msg->src_id, button, gesture == GESTURE_LONG);
+        return;
+    }
+
+    char routed = 0;
+    if (gesture == GESTURE_SINGLE) {
+        routed = button;
+    } else if (gesture == GESTURE_DOUBLE) {
+        routed = button + MAX_BUTTONS;
+    } else if (gesture == GESTURE_TRIPLE) {
+        routed = button + 2 * MAX_BUTTONS;
+    }
+    if (routed == 0) return;
+
+    if (g_mqtt_connected) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "/switch/state/%" PRIu64, msg->src_id);
+        char payload[2] = {routed, '\0'};
+        root_mqtt_publish(topic, payload, 1, 1, 0);
+    }
+
+    route_button_to_relays(msg->src_id, routed, 0, NULL);
+}
+
+// ====================
+// Journal Upload
+// ====================
+
+/**
+ * @brief Publish one MSG_TYPE_DIAG journal chunk as JSON on
+ *        /switch/diag/<id>.
+ *
+ * Payload: {"boot":N,"reset":"panic","chunk":i,"of":n,
+ *           "events":[[uptime_ms,boot,"event",arg],...]}
+ */
+void root_handle_diag(const mesh_app_msg_t* msg) {
+    if (msg->data_len < sizeof(journal_chunk_hdr_t)) {
+        ESP_LOGW(TAG, "Short diag chunk from %" PRIu64, msg->src_id);
+        return;
+    }
+
+    journal_chunk_hdr_t hdr;
+    memcpy(&hdr, msg->data, sizeof(hdr));
+    size_t max_count =
+        (msg->data_len - sizeof(hdr)) / sizeof(journal_entry_t);
+    if (hdr.count > max_count) hdr.count = max_count;
+
+    ESP_LOGI(TAG,
+             "Journal chunk %d/%d from %" PRIu64 " (boot %" PRIu32
+             ", reset %s, %d records)",
+             hdr.chunk + 1, hdr.chunks, msg->src_id, hdr.boot_count,
+             journal_reset_reason_name(hdr.reset_reason), hdr.count);
+
+    if (!g_mqtt_connected) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+    cJSON_AddNumberToObject(json, "boot", hdr.boot_count);
+    cJSON_AddStringToObject(json, "reset",
+                            journal_reset_reason_name(hdr.reset_reason));
+    cJSON_AddNumberToObject(json, "chunk", hdr.chunk);
+    cJSON_AddNumberToObject(json, "of", hdr.chunks);
+
+    cJSON* events = cJSON_AddArrayToObject(json, "events");
+    for (int i = 0; i < hdr.count; i++) {
+        journal_entry_t e;
+        memcpy(&e, msg->data + sizeof(hdr) + i * sizeof(e), sizeof(e));
+
+        cJSON* item = cJSON_CreateArray();
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(e.uptime_ms));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(e.boot));
+        cJSON_AddItemToArray(item,
+                             cJSON_CreateString(journal_event_name(e.event)));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(e.arg));
+        cJSON_AddItemToArray(events, item);
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise diag chunk");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/diag/%" PRIu64, msg->src_id);
+    root_mqtt_publish(topic, json_str, 0, 1, 0);
+    cJSON_free(json_str);
+}
+
+/**
+ * @brief Ask every registered node (and the root itself) to upload its whole
+ *        journal again.
+ */
+static void root_request_diag(void) {
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+
+    mesh_app_msg_t req = {0};
+    req.src_id = g_device_id;
+    req.msg_type = MSG_TYPE_DIAG;
+    req.data_len = 0;
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == g_device_id) continue;
+        mesh_queue_to_node(&req, TX_PRIO_NORMAL, &addrs[i]);
+    }
+
+    journal_request_upload();
+    ESP_LOGI(TAG, "Requested journal upload from %d node(s)", count);
+}
+
+// ====================
+// Task Telemetry
+// ====================
+
+/**
+ * @brief Publish a MSG_TYPE_TASK_STATS snapshot as JSON on
+ *        /switch/tasks/<id>.
+ *
+ * Payload: {"intervalMs":N,
+ *           "tasks":[["name",prio,"state",cpu_permille,stack_free],...],
+ *           "queues":[["name",depth,hwm,size],...]}
+ */
+void root_handle_task_stats(const mesh_app_msg_t* msg) {
+    if (msg->data_len < sizeof(task_stats_hdr_t)) {
+        ESP_LOGW(TAG, "Short task telemetry from %" PRIu64, msg->src_id);
+        return;
+    }
+
+    task_stats_hdr_t hdr;
+    memcpy(&hdr, msg->data, sizeof(hdr));
+    size_t needed = sizeof(hdr) + hdr.task_count * sizeof(task_stat_t) +
+                    hdr.queue_count * sizeof(queue_stat_t);
+    if (needed > msg->data_len) {
+        ESP_LOGW(TAG, "Truncated task telemetry from %" PRIu64, msg->src_id);
+        return;
+    }
+
+    if (!g_mqtt_connected) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+    cJSON_AddNumberToObject(json, "intervalMs", hdr.interval_ms);
+
+    static const char* const states[] = {"run",  "ready",   "blocked",
+                                         "susp", "deleted", "invalid"};
+    const uint8_t* p = (const uint8_t*)msg->data + sizeof(hdr);
+
+    cJSON* tasks = cJSON_AddArrayToObject(json, "tasks");
+    for (int i = 0; i < hdr.task_count; i++, p += sizeof(task_stat_t)) {
+        task_stat_t t;
+        memcpy(&t, p, sizeof(t));
+        char name[TASK_STATS_NAME_LEN + 1];
+        memcpy(name, t.name, TASK_STATS_NAME_LEN);
+        name[TASK_STATS_NAME_LEN] = '\0';
+
+        cJSON* item = cJSON_CreateArray();
+        cJSON_AddItemToArray(item, cJSON_CreateString(name));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(t.priority));
+        cJSON_AddItemToArray(
+            item, cJSON_CreateString(t.state < 6 ? states[t.state] : "?"));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(t.cpu_permille));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(t.stack_free));
+        cJSON_AddItemToArray(tasks, item);
+    }
+
+    cJSON* queues = cJSON_AddArrayToObject(json, "queues");
+    for (int i = 0; i < hdr.queue_count; i++, p += sizeof(queue_stat_t)) {
+        queue_stat_t q;
+        memcpy(&q, p, sizeof(q));
+        char name[sizeof(q.name) + 1];
+        memcpy(name, q.name, sizeof(q.name));
+        name[sizeof(q.name)] = '\0';
+
+        cJSON* item = cJSON_CreateArray();
+        cJSON_AddItemToArray(item, cJSON_CreateString(name));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(q.depth));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(q.hwm));
+        cJSON_AddItemToArray(item, cJSON_CreateNumber(q.size));
+        cJSON_AddItemToArray(queues, item);
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise task telemetry");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/tasks/%" PRIu64, msg->src_id);
+    root_mqtt_publish(topic, json_str, 0, 0, 0);
+    cJSON_free(json_str);
+}
+
+/**
+ * @brief Ask every registered node for its last task telemetry sample and
+ *        publish the root's own.
+ */
+static void root_request_task_stats(void) {
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+    int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+
+    mesh_app_msg_t req = {0};
+    req.src_id = g_device_id;
+    req.msg_type = MSG_TYPE_TASK_STATS;
+    req.data_len = 0;
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == g_device_id) continue;
+        mesh_queue_to_node(&req, TX_PRIO_NORMAL, &addrs[i]);
+    }
+
+    mesh_app_msg_t own;
+    task_stats_build_msg(&own);
+    root_handle_task_stats(&own);
+    ESP_LOGI(TAG, "Requested task telemetry from %d node(s)", count);
+}
+
+// ====================
+// Boot Reports
+// ====================
+
+/** @brief Make one node (or the root itself) re-probe its hardware. */
+static void root_request_redetect(uint64_t device_id) {
+    if (device_id == g_device_id) {
+        fast_boot_request_redetect();
+        return;
+    }
+
+    mesh_addr_t dest;
+    if (!registry_find(device_id, &dest)) {
+        ESP_LOGW(TAG, "redetect: unknown node %" PRIu64, device_id);
+        return;
+    }
+    mesh_app_msg_t cmd = {0};
+    cmd.src_id = g_device_id;
+    cmd.msg_type = MSG_TYPE_CONFIG;
+    cmd.data[0] = CONFIG_KEY_REDETECT;
+    cmd.data_len = 1;
+    mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+    ESP_LOGI(TAG, "Hardware re-detect requested on %" PRIu64, device_id);
+}
+
+/** @brief Give one node (or the root itself) a new root role. */
+static void root_request_root_role(uint64_t device_id, uint8_t role) {
+    if (device_id == g_device_id) {
+        standby_set_role(role);
+        return;
+    }
+
+    mesh_addr_t dest;
+    if (!registry_find(device_id, &dest)) {
+        ESP_LOGW(TAG, "root_role: unknown node %" PRIu64, device_id);
+        return;
+    }
+    mesh_app_msg_t cmd = {0};
+    cmd.src_id = g_device_id;
+    cmd.msg_type = MSG_TYPE_CONFIG;
+    cmd.data[0] = CONFIG_KEY_ROOT_ROLE;
+    cmd.data[1] = (char)role;
+    cmd.data_len = 2;
+    mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+    ESP_LOGI(TAG, "Root role %s requested on %" PRIu64,
+             standby_role_name(role), device_id);
+}
+
+/**
+ * @brief Publish a MSG_TYPE_BOOT_REPORT as retained JSON on /switch/boot/<id>.
+ *
+ * Payload: {"reset":"poweron","phases":{"app":N,"nvs":N,...},
+ *           "slowest":"parent","slowestMs":N}
+ * Phase values are ms since start-up; phases not reached are left out.
+ * "slowest" is the phase with the longest gap after the previous one.
+ */
+void root_handle_boot_report(const mesh_app_msg_t* msg) {
+    boot_report_t report = {0};
+    size_t header = offsetof(boot_report_t, at_ms);
+    if (msg->data_len < header) {
+        ESP_LOGW(TAG, "Short boot report from %" PRIu64, msg->src_id);
+        return;
+    }
+    memcpy(&report, msg->data,
+           msg->data_len < sizeof(report) ? msg->data_len : sizeof(report));
+    int phases = report.phase_count < BOOT_PHASE_COUNT ? report.phase_count
+                                                       : BOOT_PHASE_COUNT;
+    if (msg->data_len < header + phases * sizeof(uint32_t)) {
+        ESP_LOGW(TAG, "Truncated boot report from %" PRIu64, msg->src_id);
+        return;
+    }
+
+    // Longest gap between consecutive phases, in time order.
+    int slowest = -1;
+    uint32_t slowest_ms = 0;
+    uint32_t prev_ms = 0;
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < phases; i++) {
+            uint32_t t = report.at_ms[i];
+            if (t > prev_ms && (next < 0 || t < report.at_ms[next])) next = i;
+        }
+        if (next < 0) break;
+        if (report.at_ms[next] - prev_ms > slowest_ms) {
+            slowest_ms = report.at_ms[next] - prev_ms;
+            slowest = next;
         }
+        prev_ms = report.at_ms[next];
     }
+
+    ESP_LOGI(TAG,
+             "Boot report from %" PRIu64 ": reset %s, first route %" PRIu32
+             " ms, slowest %s (%" PRIu32 " ms)",
+             msg->src_id, journal_reset_reason_name(report.reset_reason),
+             report.at_ms[BOOT_PHASE_FIRST_ROUTE],
+             slowest >= 0 ? boot_phase_name(slowest) : "-", slowest_ms);
+
+    if (!g_mqtt_connected) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+    cJSON_AddStringToObject(json, "reset",
+                            journal_reset_reason_name(report.reset_reason));
+    cJSON* obj = cJSON_AddObjectToObject(json, "phases");
+    for (int i = 0; i < phases; i++) {
+        if (report.at_ms[i] == 0) continue;
+        cJSON_AddNumberToObject(obj, boot_phase_name(i), report.at_ms[i]);
+    }
+    if (slowest >= 0) {
+        cJSON_AddStringToObject(json, "slowest", boot_phase_name(slowest));
+        cJSON_AddNumberToObject(json, "slowestMs", slowest_ms);
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise boot report");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/boot/%" PRIu64, msg->src_id);
+    root_mqtt_publish(topic, json_str, 0, 1, 1);
+    cJSON_free(json_str);
 }
 
 // ====================
@@ -610,11 +1215,7 @@ void root_publish_status(void) {
     uint32_t free_heap = esp_get_free_heap_size();
 
     if (free_heap < LOW_HEAP_THRESHOLD) {
-        if (xSemaphoreTake(g_stats_mutex,
-                           pdMS_TO_TICKS(STATS_MUTEX_TIMEOUT_MS)) == pdTRUE) {
-            g_stats.low_heap_events++;
-            xSemaphoreGive(g_stats_mutex);
-        }
+        counter_inc(CNT_LOW_HEAP);
     }
 
     int peer_count = esp_mesh_get_total_node_num() - 1;
@@ -647,8 +1248,11 @@ void root_publish_status(void) {
     cJSON_AddNumberToObject(json, "peerCount", peer_count);
     cJSON_AddNumberToObject(json, "firmware", g_firmware_timestamp);
     cJSON_AddNumberToObject(json, "rssi", rssi);
-    cJSON_AddNumberToObject(json, "clicks", g_stats.button_presses);
-    cJSON_AddNumberToObject(json, "lowHeap", g_stats.low_heap_events);
+    cJSON_AddNumberToObject(json, "clicks", counter_get(CNT_BUTTON_PRESSES));
+    cJSON_AddNumberToObject(json, "lowHeap", counter_get(CNT_LOW_HEAP));
+    task_stats_add_summary(json);
+    heap_stats_add_summary(json);
+    counters_add_summary(json, SIZE_MAX);
 
     char* json_str = cJSON_PrintUnformatted(json);
     cJSON_Delete(json);
@@ -657,20 +1261,15 @@ void root_publish_status(void) {
         char topic[64];
         snprintf(topic, sizeof(topic), "/switch/state/root");
 
-        int msg_id =
-            esp_mqtt_client_publish(g_mqtt_client, topic, json_str, 0, 0, 0);
+        int msg_id = root_mqtt_publish(topic, json_str, 0, 0, 0);
         if (msg_id >= 0) {
             ESP_LOGV(TAG, "Published root status to %s: %s", topic, json_str);
         } else {
             ESP_LOGW(TAG, "Failed to publish root status to %s", topic);
-
-            if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-                g_stats.mqtt_dropped++;
-                xSemaphoreGive(g_stats_mutex);
-            }
+            counter_inc(CNT_MQTT_DROPPED);
         }
 
-        free(json_str);
+        cJSON_free(json_str);
     }
 }
 
@@ -720,15 +1319,14 @@ static void publish_connection_status(bool connected) {
     char* json_str = cJSON_PrintUnformatted(json);
     if (json_str) {
         // Publish with QoS 1 and retain flag for monitoring
-        int msg_id = esp_mqtt_client_publish(
-            g_mqtt_client, "/switch/state/root", json_str, 0, 1, 1);
+        int msg_id = root_mqtt_publish("/switch/state/root", json_str, 0, 1, 1);
         if (msg_id >= 0) {
             ESP_LOGI(TAG, "Published connection status: %s (msg_id=%d)",
                      connected ? "connected" : "disconnected", msg_id);
         } else {
             ESP_LOGE(TAG, "Failed to publish connection status");
         }
-        free(json_str);
+        cJSON_free(json_str);
     }
 
     cJSON_Delete(json);
@@ -754,6 +1352,10 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base,
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT connected");
             g_mqtt_connected = true;
+            journal_record(JOURNAL_EV_MQTT_CONNECTED, 0);
+            boot_mark(BOOT_PHASE_MQTT);
+            failover_mark(FAILOVER_EV_MQTT);
+            standby_on_mqtt_connected();
             esp_mqtt_client_subscribe(g_mqtt_client, "/switch/cmd/+", 0);
             esp_mqtt_client_subscribe(g_mqtt_client, "/switch/cmd", 0);
             esp_mqtt_client_subscribe(g_mqtt_client, "/relay/cmd/+", 0);
@@ -768,6 +1370,7 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base,
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "MQTT disconnected");
             g_mqtt_connected = false;
+            journal_record(JOURNAL_EV_MQTT_DISCONNECTED, 0);
             connection_status_published = false;
             break;
 
@@ -776,6 +1379,9 @@ static void mqtt_event_handler(void* handler_args, esp_event_base_t base,
             break;
 
         case MQTT_EVENT_DATA:
+            TRACE_MARK(TRACE_MARK_MQTT_CMD, event->data_len);
+            CAPTURE_MQTT(CAPTURE_REC_MQTT_IN, event->topic, event->topic_len,
+                         event->data, event->data_len, false);
             ESP_LOGI(TAG, "MQTT data received: topic=%.*s, data=%.*s",
                      event->topic_len, event->topic, event->data_len,
                      event->data);
@@ -1083,6 +1689,191 @@ static void parse_json_auto_off(cJSON* data) {
     }
 }
 
+/**
+ * @brief Parse a "schedules" JSON payload and push each relay's table to it.
+ *
+ * Expected format:
+ * @code
+ * { "<relay_id>": [[<day_mask>, "<HH:MM[:SS]>", "<outputs>", "<action>"],
+ *                  ...], ... }
+ * @endcode
+ * day_mask bit N enables weekday N (0 = Sunday), outputs is a string of relay
+ * characters ("ab"), action is "on", "off", or "toggle".  Each relay receives
+ * its complete table in one MSG_TYPE_SCHEDULE message; an empty array clears
+ * it.  The relay stores the table in NVS and evaluates it locally.
+ */
+static void parse_json_schedules(cJSON* data) {
+    if (!data || !cJSON_IsObject(data)) return;
+
+    cJSON* relay_item = NULL;
+    cJSON_ArrayForEach(relay_item, data) {
+        if (!relay_item->string || !cJSON_IsArray(relay_item)) continue;
+
+        uint64_t relay_id = strtoull(relay_item->string, NULL, 10);
+        if (relay_id == 0) continue;
+
+        mesh_app_msg_t cmd = {0};
+        cmd.src_id = g_device_id;
+        cmd.msg_type = MSG_TYPE_SCHEDULE;
+        schedule_entry_t* entries = (schedule_entry_t*)&cmd.data[1];
+        int count = 0;
+
+        cJSON* rule = NULL;
+        cJSON_ArrayForEach(rule, relay_item) {
+            if (count >= SCHEDULE_MAX_ENTRIES) {
+                ESP_LOGW(TAG, "Schedule for relay %" PRIu64 " truncated to %d",
+                         relay_id, SCHEDULE_MAX_ENTRIES);
+                break;
+            }
+            if (!cJSON_IsArray(rule) || cJSON_GetArraySize(rule) < 4) continue;
+
+            cJSON* days_item = cJSON_GetArrayItem(rule, 0);
+            cJSON* time_item = cJSON_GetArrayItem(rule, 1);
+            cJSON* outputs_item = cJSON_GetArrayItem(rule, 2);
+            cJSON* action_item = cJSON_GetArrayItem(rule, 3);
+            if (!cJSON_IsNumber(days_item) || !cJSON_IsString(time_item) ||
+                !cJSON_IsString(outputs_item) || !cJSON_IsString(action_item))
+                continue;
+
+            int hour = 0, min = 0, sec = 0;
+            if (sscanf(time_item->valuestring, "%d:%d:%d", &hour, &min,
+                       &sec) < 2 ||
+                hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 ||
+                sec > 59) {
+                ESP_LOGW(TAG, "Invalid schedule time: %s",
+                         time_item->valuestring);
+                continue;
+            }
+
+            uint16_t mask = 0;
+            for (const char* p = outputs_item->valuestring; *p; p++) {
+                char c = *p;
+                if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+                if (c >= 'a' && c < 'a' + MAX_RELAYS_16) mask |= 1u << (c - 'a');
+            }
+
+            uint8_t action;
+            if (strcmp(action_item->valuestring, "on") == 0) {
+                action = SCHEDULE_ACTION_ON;
+            } else if (strcmp(action_item->valuestring, "off") == 0) {
+                action = SCHEDULE_ACTION_OFF;
+            } else if (strcmp(action_item->valuestring, "toggle") == 0) {
+                action = SCHEDULE_ACTION_TOGGLE;
+            } else {
+                ESP_LOGW(TAG, "Invalid schedule action: %s",
+                         action_item->valuestring);
+                continue;
+            }
+
+            if (mask == 0) continue;
+
+            schedule_entry_t entry = {
+                .day_mask = (uint8_t)(days_item->valueint & 0x7F),
+                .action = action,
+                .output_mask = mask,
+                .second_of_day = hour * 3600 + min * 60 + sec,
+            };
+            memcpy(&entries[count], &entry, sizeof(entry));
+            count++;
+        }
+
+        cmd.data[0] = (char)count;
+        cmd.data_len = 1 + count * sizeof(schedule_entry_t);
+
+        if (relay_id == g_device_id) {
+            // The root itself is the relay board: apply directly.
+            if (g_node_type == NODE_TYPE_RELAY_8 ||
+                g_node_type == NODE_TYPE_RELAY_16) {
+                schedule_handle_message(&cmd);
+            }
+            continue;
+        }
+
+        mesh_addr_t dest = {0};
+        if (!registry_find(relay_id, &dest)) {
+            ESP_LOGW(TAG, "Schedule: relay %" PRIu64 " not found in registry",
+                     relay_id);
+            continue;
+        }
+
+        mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+        ESP_LOGI(TAG, "Routed %d schedule entries to relay %" PRIu64, count,
+                 relay_id);
+    }
+}
+
+/**
+ * @brief Parse a "gestures" JSON payload and push each switch's masks to it.
+ *
+ * Expected format:
+ * @code
+ * { "<switch_id>": { "a": ["double", "long", "hold"], "b": [], ... }, ... }
+ * @endcode
+ * "double" (or "triple") enables multi-click, "long" the long press and
+ * "hold" hold-with-repeat.  Buttons that are not listed, or have an empty
+ * list, keep sending raw press/release events.
+ */
+static void parse_json_gestures(cJSON* data) {
+    if (!data || !cJSON_IsObject(data)) return;
+
+    cJSON* switch_item = NULL;
+    cJSON_ArrayForEach(switch_item, data) {
+        if (!switch_item->string || !cJSON_IsObject(switch_item)) continue;
+
+        uint64_t switch_id = strtoull(switch_item->string, NULL, 10);
+        if (switch_id == 0) continue;
+
+        mesh_app_msg_t cmd = {0};
+        cmd.src_id = g_device_id;
+        cmd.msg_type = MSG_TYPE_CONFIG;
+        cmd.target_type = DEVICE_TYPE_SWITCH;
+        cmd.data[0] = CONFIG_KEY_GESTURES;
+        cmd.data_len = 1 + MAX_BUTTONS;
+
+        cJSON* button_item = NULL;
+        cJSON_ArrayForEach(button_item, switch_item) {
+            if (!button_item->string || !cJSON_IsArray(button_item)) continue;
+            int button_idx = button_item->string[0] - 'a';
+            if (button_idx < 0 || button_idx >= MAX_BUTTONS) continue;
+
+            uint8_t mask = 0;
+            cJSON* name = NULL;
+            cJSON_ArrayForEach(name, button_item) {
+                if (!cJSON_IsString(name)) continue;
+                if (strcmp(name->valuestring, "double") == 0 ||
+                    strcmp(name->valuestring, "triple") == 0) {
+                    mask |= GESTURE_EN_MULTI;
+                } else if (strcmp(name->valuestring, "long") == 0) {
+                    mask |= GESTURE_EN_LONG;
+                } else if (strcmp(name->valuestring, "hold") == 0) {
+                    mask |= GESTURE_EN_HOLD;
+                } else {
+                    ESP_LOGW(TAG, "Unknown gesture: %s", name->valuestring);
+                }
+            }
+            cmd.data[1 + button_idx] = (char)mask;
+        }
+
+        if (switch_id == g_device_id) {
+            // The root itself is the switch: apply directly.
+            if (g_node_type == NODE_TYPE_SWITCH_C3) {
+                gesture_handle_config(&cmd);
+            }
+            continue;
+        }
+
+        mesh_addr_t dest = {0};
+        if (!registry_find(switch_id, &dest)) {
+            ESP_LOGW(TAG, "Gestures: switch %" PRIu64 " not found in registry",
+                     switch_id);
+            continue;
+        }
+
+        mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+        ESP_LOGI(TAG, "Routed gesture config to switch %" PRIu64, switch_id);
+    }
+}
+
 /**
  * @brief Parse a "blind_pairs" JSON payload and populate g_blind_pairs.
  *
@@ -1137,6 +1928,17 @@ static void parse_json_blind_pairs(cJSON* data) {
     ESP_LOGI(TAG, "Loaded %d blind pair(s)", g_blind_pair_count);
 }
 
+/** @brief The "device" of a JSON command (string or number), else the root. */
+static uint64_t json_device_id(const cJSON* json) {
+    const cJSON* device = cJSON_GetObjectItem(json, "device");
+    if (cJSON_IsString(device)) {
+        return strtoull(device->valuestring, NULL, 10);
+    } else if (cJSON_IsNumber(device)) {
+        return (uint64_t)device->valuedouble;
+    }
+    return g_device_id;
+}
+
 /**
  * @brief Dispatch a JSON MQTT command received on /switch/cmd/root.
  *
@@ -1145,9 +1947,27 @@ static void parse_json_blind_pairs(cJSON* data) {
  *  - "button_types" – update the toggle/stateful classification per button.
  *  - "auto_off"     – update per-relay output auto-off timeout values.
  *  - "blind_pairs"  – update blind pair (power/direction output) associations.
+ *  - "schedules"    – push weekly schedule tables to relay nodes.
+ *  - "gestures"     – enable gesture recognition per switch button.
+ *  - "time_sync"    – publish per-node clock offset/uncertainty.
+ *  - "diag"         – ask all nodes to re-upload their event journal.
+ *  - "tasks"        – publish per-task/queue telemetry of every node.
+ *  - "profile"      – publish root hot-path cycle histograms
+ *                     ("reset":true clears them afterwards).
+ *  - "redetect"     – probe the hardware of "device" (default: the root)
+ *                     again on its next boot.
+ *  - "root_role"    – set the root role ("role": none, standby or
+ *                     preferred) of "device" (default: the root).
+ *
+ * "connections", "button_types" and "blind_pairs" are also kept for the
+ * standby root (standby.c).
  */
 static void handle_json_mqtt_root_command(const char* topic, int topic_len,
                                           const char* data, int data_len) {
+    PROF_SCOPE(PROF_CONFIG_PARSE);
+    // The "data" members below shadow the payload; keep it for the standby.
+    const char* payload = data;
+    int payload_len = data_len;
     cJSON* json = cJSON_ParseWithLength(data, data_len);
 
     if (!json) {
@@ -1170,6 +1990,10 @@ static void handle_json_mqtt_root_command(const char* topic, int topic_len,
             return;
         }
         parse_json_connections(data);
+        standby_config_applied(REPLICA_CFG_CONNECTIONS, payload, payload_len);
+        counter_inc(CNT_CFG_ROUTES);
+        boot_mark(BOOT_PHASE_CONFIG);
+        failover_mark(FAILOVER_EV_CONFIG);
     } else if (strcmp(msgType->valuestring, "button_types") == 0) {
         cJSON* data = cJSON_GetObjectItem(json, "data");
         if (!data) {
@@ -1178,6 +2002,8 @@ static void handle_json_mqtt_root_command(const char* topic, int topic_len,
             return;
         }
         parse_json_button_types(data);
+        standby_config_applied(REPLICA_CFG_BUTTON_TYPES, payload, payload_len);
+        counter_inc(CNT_CFG_BUTTON_TYPES);
     } else if (strcmp(msgType->valuestring, "auto_off") == 0) {
         cJSON* data = cJSON_GetObjectItem(json, "data");
         if (!data) {
@@ -1186,6 +2012,7 @@ static void handle_json_mqtt_root_command(const char* topic, int topic_len,
             return;
         }
         parse_json_auto_off(data);
+        counter_inc(CNT_CFG_AUTO_OFF);
     } else if (strcmp(msgType->valuestring, "blind_pairs") == 0) {
         cJSON* data = cJSON_GetObjectItem(json, "data");
         if (!data) {
@@ -1194,6 +2021,63 @@ static void handle_json_mqtt_root_command(const char* topic, int topic_len,
             return;
         }
         parse_json_blind_pairs(data);
+        standby_config_applied(REPLICA_CFG_BLIND_PAIRS, payload, payload_len);
+        counter_inc(CNT_CFG_BLIND_PAIRS);
+    } else if (strcmp(msgType->valuestring, "schedules") == 0) {
+        cJSON* data = cJSON_GetObjectItem(json, "data");
+        if (!data) {
+            ESP_LOGE(TAG, "Schedules command missing 'data' field");
+            cJSON_Delete(json);
+            return;
+        }
+        parse_json_schedules(data);
+        counter_inc(CNT_CFG_SCHEDULES);
+    } else if (strcmp(msgType->valuestring, "gestures") == 0) {
+        cJSON* data = cJSON_GetObjectItem(json, "data");
+        if (!data) {
+            ESP_LOGE(TAG, "Gestures command missing 'data' field");
+            cJSON_Delete(json);
+            return;
+        }
+        parse_json_gestures(data);
+        counter_inc(CNT_CFG_GESTURES);
+    } else if (strcmp(msgType->valuestring, "time_sync") == 0) {
+        time_sync_publish_report();
+    } else if (strcmp(msgType->valuestring, "diag") == 0) {
+        root_request_diag();
+    } else if (strcmp(msgType->valuestring, "tasks") == 0) {
+        root_request_task_stats();
+    } else if (strcmp(msgType->valuestring, "profile") == 0) {
+#if CONFIG_DOMATOR_PROFILER
+        profiler_publish();
+        if (cJSON_IsTrue(cJSON_GetObjectItem(json, "reset"))) {
+            profiler_reset();
+        }
+#else
+        ESP_LOGW(TAG, "Profiler disabled (CONFIG_DOMATOR_PROFILER)");
+#endif
+    } else if (strcmp(msgType->valuestring, "bench") == 0) {
+        bench_root_command(json);
+    } else if (strcmp(msgType->valuestring, "probe") == 0) {
+        link_probe_command(json);
+    } else if (strcmp(msgType->valuestring, "fault") == 0) {
+#if CONFIG_DOMATOR_FAULT
+        fault_command(json);
+#else
+        ESP_LOGW(TAG, "Fault injection disabled (CONFIG_DOMATOR_FAULT)");
+#endif
+    } else if (strcmp(msgType->valuestring, "redetect") == 0) {
+        root_request_redetect(json_device_id(json));
+    } else if (strcmp(msgType->valuestring, "root_role") == 0) {
+        cJSON* role = cJSON_GetObjectItem(json, "role");
+        uint8_t value;
+        if (!cJSON_IsString(role) ||
+            !standby_parse_role(role->valuestring, &value)) {
+            ESP_LOGE(TAG, "Root role command needs \"role\": none, standby "
+                          "or preferred");
+        } else {
+            root_request_root_role(json_device_id(json), value);
+        }
     } else {
         ESP_LOGW(TAG, "Unknown JSON command type: %s", msgType->valuestring);
     }
@@ -1201,6 +2085,11 @@ static void handle_json_mqtt_root_command(const char* topic, int topic_len,
     cJSON_Delete(json);
 }
 
+void root_apply_config(const char* json, int len) {
+    static const char topic[] = "/switch/cmd/root";
+    handle_json_mqtt_root_command(topic, sizeof(topic) - 1, json, len);
+}
+
 /**
  * @brief Handle non-JSON MQTT commands targeting device nodes.
  *
@@ -1340,39 +2229,7 @@ static void handle_nonJson_mqtt_command(const char* topic, int topic_len,
         }
 
         ESP_LOGI(TAG, "Ping command for target device %" PRIu64, target_id);
-        mesh_addr_t dest = {0};
-        if (registry_find(target_id, &dest)) {
-            mesh_app_msg_t ping = {0};
-            ping.src_id = g_device_id;
-            ping.msg_type = MSG_TYPE_PING;
-            uint16_t pingNum = 1;
-            memcpy(ping.data, &pingNum, sizeof(uint16_t));
-            ping.data_len = sizeof(uint16_t);
-
-            if (mesh_queue_to_node(&ping, TX_PRIO_HIGH, &dest)) {
-                if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) ==
-                    pdTRUE) {
-                    int index = -1;
-                    for (int i = 0; i < MAX_NODES; i++) {
-                        if (node_registry[i].device_id == target_id) {
-                            index = i;
-                            break;
-                        }
-                    }
-                    if (index >= 0) {
-                        node_registry[index].last_ping =
-                            esp_timer_get_time() / 1000;
-                    }
-                    xSemaphoreGive(registry_mutex);
-                }
-                ESP_LOGV(TAG, "Sent MQTT ping to device %" PRIu64, target_id);
-            } else {
-                ESP_LOGW(TAG, "Failed to enqueue ping for device %" PRIu64,
-                         target_id);
-            }
-        } else {
-            ESP_LOGW(TAG, "Could not find target device %" PRIu64, target_id);
-        }
+        root_ping_node(target_id);
     } else {
         ESP_LOGW(TAG,
                  "Received unrecognized non-JSON MQTT command: topic=%s, "
@@ -1383,6 +2240,101 @@ static void handle_nonJson_mqtt_command(const char* topic, int topic_len,
     free(device_type);
 }
 
+// ====================
+// Diagnostics Helpers
+// ====================
+
+/**
+ * @brief Start a ping/pong round-trip test with one node.  The average RTT
+ *        is logged and published on /switch/state/<id> when it completes.
+ * @param target_id Device to probe.
+ * @return true if the first ping was queued.
+ */
+bool root_ping_node(uint64_t target_id) {
+    mesh_addr_t dest = {0};
+    if (!registry_find(target_id, &dest)) {
+        ESP_LOGW(TAG, "Could not find target device %" PRIu64, target_id);
+        return false;
+    }
+
+    mesh_app_msg_t ping = {0};
+    ping.src_id = g_device_id;
+    ping.msg_type = MSG_TYPE_PING;
+    uint16_t pingNum = 1;
+    memcpy(ping.data, &pingNum, sizeof(uint16_t));
+    ping.data_len = sizeof(uint16_t);
+
+    if (!mesh_queue_to_node(&ping, TX_PRIO_HIGH, &dest)) {
+        ESP_LOGW(TAG, "Failed to enqueue ping for device %" PRIu64, target_id);
+        return false;
+    }
+
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(5000)) == pdTRUE) {
+        for (int i = 0; i < MAX_NODES; i++) {
+            if (node_registry[i].device_id == target_id) {
+                node_registry[i].last_ping = esp_timer_get_time() / 1000;
+                break;
+            }
+        }
+        xSemaphoreGive(registry_mutex);
+    }
+    ESP_LOGV(TAG, "Sent ping to device %" PRIu64, target_id);
+    return true;
+}
+
+/**
+ * @brief Send a raw relay command (e.g. "a", "b1") to a relay node, exactly
+ *        as a routed button press would.
+ * @return true if the command was queued.
+ */
+bool root_send_relay_command(uint64_t target_id, const char* command) {
+    size_t len = strlen(command);
+    if (len == 0 || len >= MESH_MSG_DATA_SIZE) return false;
+
+    mesh_addr_t dest = {0};
+    if (!registry_find(target_id, &dest)) {
+        ESP_LOGW(TAG, "Could not find target device %" PRIu64, target_id);
+        return false;
+    }
+
+    mesh_app_msg_t cmd = {0};
+    cmd.src_id = g_device_id;
+    cmd.msg_type = MSG_TYPE_COMMAND;
+    memcpy(cmd.data, command, len);
+    cmd.data_len = len;
+    return mesh_queue_to_node(&cmd, TX_PRIO_NORMAL, &dest);
+}
+
+/** @brief Print the node registry to the current shell client. */
+void root_shell_print_registry(void) {
+    if (registry_mutex == NULL) {
+        shell_printf("Not root\n");
+        return;
+    }
+
+    static node_registry_entry_t copy[MAX_NODES];
+    if (xSemaphoreTake(registry_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        shell_printf("Registry busy\n");
+        return;
+    }
+    int count = node_count;
+    memcpy(copy, node_registry, sizeof(copy));
+    xSemaphoreGive(registry_mutex);
+
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    shell_printf("%-16s %-4s %-17s %9s %8s\n", "device", "type", "mesh addr",
+                 "seen ago", "ping ms");
+    for (int i = 0; i < count; i++) {
+        node_registry_entry_t* e = &copy[i];
+        if (e->device_id == 0) continue;
+        shell_printf("%-16" PRIu64 " %-4.4s " MACSTR " %7llds %8" PRId32 "\n",
+                     e->device_id, e->node_type[0] ? e->node_type : "?",
+                     MAC2STR(e->mesh_addr.addr),
+                     (long long)((now_ms - e->last_seen) / 1000), e->avg_ping);
+    }
+    shell_printf("%d node(s)\n", count);
+}
+
 // ====================
 // Handle MQTT Commands
 // ====================
@@ -1435,7 +2387,8 @@ static void handle_mqtt_command(const char* topic, int topic_len,
 
 /**
  * @brief Initialise root-only resources when this node becomes root.
- *        Creates the node registry mutex if it does not yet exist.
+ *        Creates the node registry mutex if it does not yet exist and takes
+ *        over the state replicated to this node as standby.
  *        Idempotent: returns immediately if the MQTT client is already running.
  */
 void node_root_start(void) {
@@ -1449,6 +2402,7 @@ void node_root_start(void) {
     }
 
     ESP_LOGI(TAG, "Starting root services...");
+    standby_on_root_start();
 }
 
 // ====================
@@ -1479,6 +2433,7 @@ void mqtt_init(void) {
     ESP_LOGI(TAG,
              "Initializing MQTT client (ROOT node, device_id: %" PRIu64 ")",
              g_device_id);
+    failover_mark(FAILOVER_EV_MQTT_INIT);
 
     // Build complete MQTT broker URI
     char broker_uri[128];
@@ -1546,8 +2501,8 @@ void mqtt_init(void) {
  * @brief Stop the MQTT client and all root-specific services.
  *
  * If connected, publishes a "disconnected" status before stopping.
- * Destroys the MQTT client handle, stops the Telnet server, and clears
- * g_is_root.  Safe to call when already stopped.
+ * Destroys the MQTT client handle, stops the Telnet server and SNTP client,
+ * and clears g_is_root.  Safe to call when already stopped.
  */
 void node_root_stop(void) {
     if (g_mqtt_client) {
@@ -1568,6 +2523,9 @@ void node_root_stop(void) {
     }
 
     telnet_stop();  // Stop telnet server if running
+    capture_stop();
+    time_sync_stop_sntp();
+    standby_on_root_stop();
 
     g_is_root = false;  // Ensure we update root status
     ESP_LOGI(TAG, "Root services stopped");
@@ -3,18 +3,21 @@
  * @brief Switch node driver: 7-button input handling and NeoPixel status LED.
  *
  * Runs on ESP32-C3 switch boards.  Provides:
- *  - button_init()  – configure GPIO inputs and install ISR handlers.
- *  - button_task()  – debounce button events and send MSG_TYPE_BUTTON to root.
+ *  - button_init()  – configure GPIO inputs via button_input.c.
+ *  - button_task()  – turn debounced button events into MSG_TYPE_BUTTON, or
+ *                     into MSG_TYPE_GESTURE via gesture.c.
  *  - led_init()     – configure the single WS2812 LED via the RMT peripheral.
- *  - led_task()     – update the LED colour to reflect mesh connection state.
+ *  - led_task()     – event-driven LED engine (see led_post_event()).
  *  - led_set_color() / led_flash_cyan() – low-level LED helpers.
  *
  * LED colour semantics:
- *  - Red    – mesh not started.
- *  - Yellow – mesh started, not yet connected.
- *  - Green  – fully connected and operational.
- *  - Cyan   – short flash on button press acknowledgement.
- *  - Blue   – OTA update in progress.
+ *  - Red              – mesh not started.
+ *  - Breathing yellow – mesh started, not yet connected.
+ *  - Green            – fully connected and operational.
+ *  - Cyan flash       – button press acknowledgement.
+ *  - White flash      – button message handed to the mesh.
+ *  - Red fade         – button message could not be sent.
+ *  - Blinking blue    – OTA update in progress.
  */
 
 #include <domator_mesh.h>
@@ -34,74 +37,26 @@ static const char* TAG = "NODE_SWITCH";
 // LED strip handle
 static led_strip_handle_t g_led_strip = NULL;
 static led_color_t g_current_led_color = {0, 0, 0};
-static bool g_led_flash_active = false;
-static uint32_t g_led_flash_end_time = 0;
-
-// ====================
-// Button Press Statistics
-// ====================
-
-/** @brief Safely increment the global button press counter under the stats
- * mutex. */
-static void stats_increment_button_presses(void) {
-    if (xSemaphoreTake(g_stats_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        g_stats.button_presses++;
-        xSemaphoreGive(g_stats_mutex);
-    }
-}
+static bool g_led_written = false;
+static QueueHandle_t g_led_queue = NULL;
 
 // ====================
 // Button Initialization
 // ====================
 
 /**
- * @brief GPIO ISR handler for switch buttons.
- *        Sets the bit for the triggered button in the task notification value
- *        and wakes button_task().
- * @param arg Button index cast to (void*).
- */
-static void IRAM_ATTR button_isr_handler(void* arg) {
-    uint32_t button_index = (uint32_t)arg;
-
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-    xTaskNotifyFromISR(button_task_handle, (1 << button_index), eSetBits,
-                       &xHigherPriorityTaskWoken);
-
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
-    }
-}
-
-/**
- * @brief Configure all 7 button GPIOs and install edge-triggered ISR handlers.
+ * @brief Configure all 7 button GPIOs via the shared timestamping input
+ *        (button_input.c).
  */
 void button_init(void) {
     ESP_LOGI(TAG, "Initializing buttons");
 
-    for (int i = 0; i < NUM_BUTTONS; i++) {
-        gpio_config_t io_conf = {
-            .pin_bit_mask = (1ULL << g_button_pins[i]),
-            .mode = GPIO_MODE_INPUT,
-            .pull_up_en = GPIO_PULLUP_DISABLE,
-            .pull_down_en = GPIO_PULLDOWN_ENABLE,
-            .intr_type = GPIO_INTR_ANYEDGE,
-        };
-        gpio_config(&io_conf);
+    button_input_init(g_button_pins, NUM_BUTTONS);
 
+    for (int i = 0; i < NUM_BUTTONS; i++) {
         g_button_states[i].last_state = gpio_get_level(g_button_pins[i]);
-        g_button_states[i].last_bounce_time = 0;
         g_button_states[i].press_start_time = 0;
         g_button_states[i].last_release_time = 0;
-
-        ESP_LOGI(TAG, "Button %d initialized on GPIO %d", i, g_button_pins[i]);
-    }
-
-    ESP_ERROR_CHECK(gpio_install_isr_service(ESP_INTR_FLAG_IRAM));
-
-    for (int i = 0; i < NUM_BUTTONS; i++) {
-        ESP_ERROR_CHECK(gpio_isr_handler_add(g_button_pins[i],
-                                             button_isr_handler, (void*)i));
     }
 }
 
@@ -110,13 +65,14 @@ void button_init(void) {
 // ====================
 
 /**
- * @brief FreeRTOS task: debounce button events and send MSG_TYPE_BUTTON to
- * root.
+ * @brief FreeRTOS task: take debounced, ISR-timestamped button transitions
+ *        and send MSG_TYPE_BUTTON to root, or pass them to the gesture
+ *        recognizer for buttons that have gestures enabled.
  */
 void button_task(void* arg) {
     ESP_LOGI(TAG, "Button task started");
 
-    uint32_t notified_value;
+    button_event_t ev;
 
     while (1) {
         if (g_ota_in_progress) {
@@ -124,87 +80,81 @@ void button_task(void* arg) {
             continue;
         }
 
-        if (!xTaskNotifyWait(0, 0xFFFFFFFF, &notified_value, portMAX_DELAY)) {
+        TickType_t wait = gesture_poll();
+        if (wait > pdMS_TO_TICKS(1000)) wait = pdMS_TO_TICKS(1000);
+
+        if (!button_input_get_event(&ev, wait)) {
             continue;
         }
 
-        for (int i = 0; i < NUM_BUTTONS; i++) {
-            if (!(notified_value & (1 << i))) {
-                continue;
-            }
-
-            int gpio_num = g_button_pins[i];
+        int i = ev.index;
+        int current_state = ev.level;
+        uint32_t current_time = ev.time_us / 1000;
 
-            int current_state = gpio_get_level(gpio_num);
-            uint32_t current_time = esp_timer_get_time() / 1000;
+        if (current_state == g_button_states[i].last_state) {
+            continue;
+        }
 
-            if (current_state == g_button_states[i].last_state) {
-                continue;
-            }
+        g_button_states[i].last_state = current_state;
+
+        ESP_LOGI(TAG, "Button %d state changed to %d", i, current_state);
+
+        if (current_state == 0 &&
+            current_time - g_button_states[i].press_start_time >
+                BUTTON_PRESS_OTA_THRESHOLD_MS &&
+            g_button_states[i].press_start_time -
+                    g_button_states[i].last_release_time <
+                BUTTON_PRESS_OTA_INTERVAL_MS) {
+            ESP_LOGI(TAG,
+                     "Button %d was pressed for %" PRIu32
+                     " ms, which exceeds the OTA threshold. "
+                     "Triggering OTA...",
+                     i,
+                     (uint32_t)(current_time -
+                                g_button_states[i].press_start_time));
+            g_ota_requested = true;
+        }
 
-            g_button_states[i].last_state = current_state;
-
-            if (current_time - g_button_states[i].last_bounce_time >
-                BUTTON_DEBOUNCE_MS) {
-                ESP_LOGI(TAG, "Button %d state changed to %d", i,
-                         current_state);
-
-                if (current_state == 0 &&
-                    current_time - g_button_states[i].press_start_time >
-                        BUTTON_PRESS_OTA_THRESHOLD_MS &&
-                    g_button_states[i].press_start_time -
-                            g_button_states[i].last_release_time <
-                        BUTTON_PRESS_OTA_INTERVAL_MS) {
-                    ESP_LOGI(TAG,
-                             "Button %d was pressed for %" PRIu32
-                             " ms, which exceeds the OTA threshold. "
-                             "Triggering OTA...",
-                             i,
-                             (uint32_t)(current_time -
-                                        g_button_states[i].press_start_time));
-                    g_ota_requested = true;
-                }
+        if (current_state == 1) {
+            led_post_event(LED_EVENT_PRESS);
+            g_button_states[i].press_start_time = current_time;
+        } else {
+            g_button_states[i].last_release_time = current_time;
+        }
 
-                if (current_state == 1) {
-                    g_button_states[i].press_start_time = current_time;
-                } else {
-                    g_button_states[i].last_release_time = current_time;
-                }
+        counter_inc(CNT_BUTTON_PRESSES);
+        TRACE_MARK(TRACE_MARK_BUTTON, i);
 
-                stats_increment_button_presses();
-
-                char button_char = 'a' + i;
-                uint32_t duration_ms =
-                    current_time - g_button_states[i].press_start_time;
-
-                mesh_app_msg_t msg = {0};
-                msg.src_id = g_device_id;
-                msg.msg_type = MSG_TYPE_BUTTON;
-                msg.data[0] = button_char;
-                msg.data[1] = current_state ? '1' : '0';
-                if (current_state == 0) {
-                    /* On release: encode long/short press in 3rd byte.
-                     * '1' = long press (≥ LONG_PRESS_THRESHOLD_MS). */
-                    msg.data[2] =
-                        (duration_ms >= LONG_PRESS_THRESHOLD_MS) ? '1' : '0';
-                    msg.data_len = 3;
-                } else {
-                    msg.data_len = 2;
-                }
-                mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
-
-                ESP_LOGI(TAG,
-                         "Sent button '%c' state %d to root. "
-                         "Pressed for %" PRIu32 " ms (%s)",
-                         button_char, current_state, duration_ms,
-                         (current_state == 0 &&
-                          duration_ms >= LONG_PRESS_THRESHOLD_MS)
-                             ? "LONG"
-                             : "short");
-            }
+        if (gesture_handle_event(&ev)) {
+            continue;
+        }
 
-            g_button_states[i].last_bounce_time = current_time;
+        char button_char = 'a' + i;
+        uint32_t duration_ms =
+            current_time - g_button_states[i].press_start_time;
+
+        mesh_app_msg_t msg = {0};
+        msg.src_id = g_device_id;
+        msg.msg_type = MSG_TYPE_BUTTON;
+        msg.data[0] = button_char;
+        msg.data[1] = current_state ? '1' : '0';
+        if (current_state == 0) {
+            /* On release: encode long/short press in 3rd byte.
+             * '1' = long press (≥ LONG_PRESS_THRESHOLD_MS). */
+            msg.data[2] = (duration_ms >= LONG_PRESS_THRESHOLD_MS) ? '1' : '0';
+            msg.data_len = 3;
+        } else {
+            msg.data_len = 2;
         }
+        mesh_queue_to_node(&msg, TX_PRIO_NORMAL, NULL);
+
+        ESP_LOGI(TAG,
+                 "Sent button '%c' state %d to root. "
+                 "Pressed for %" PRIu32 " ms (%s)",
+                 button_char, current_state, duration_ms,
+                 (current_state == 0 && duration_ms >= LONG_PRESS_THRESHOLD_MS)
+                     ? "LONG"
+                     : "short");
     }
 }
 
@@ -213,11 +163,18 @@ void button_task(void* arg) {
 // ====================
 
 /**
- * @brief Initialise the WS2812 NeoPixel via the RMT peripheral.
+ * @brief Initialise the WS2812 NeoPixel via the RMT peripheral and create
+ *        the LED event queue.
  */
 void led_init(void) {
     ESP_LOGI(TAG, "Initializing NeoPixel LED on GPIO %d", LED_GPIO);
 
+    g_led_queue = xQueueCreate(LED_EVENT_QUEUE_SIZE, sizeof(led_event_t));
+    if (g_led_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create LED event queue");
+    }
+    task_stats_register_queue("led", g_led_queue);
+
     led_strip_config_t strip_config = {
         .strip_gpio_num = LED_GPIO,
         .max_leds = 1,
@@ -240,6 +197,7 @@ void led_init(void) {
     }
 
     led_strip_clear(g_led_strip);
+    g_led_written = true;
 
     ESP_LOGI(TAG, "NeoPixel LED initialized");
 }
@@ -250,6 +208,7 @@ void led_init(void) {
 
 /**
  * @brief Set the NeoPixel to the given RGB colour at ~2 % brightness.
+ *        The strip is only refreshed when the scaled colour changes.
  * @param r Red component (0-255 before scaling).
  * @param g Green component (0-255 before scaling).
  * @param b Blue component (0-255 before scaling).
@@ -263,61 +222,205 @@ void led_set_color(uint8_t r, uint8_t g, uint8_t b) {
     g = g / 51;
     b = b / 51;
 
+    if (g_led_written && g_current_led_color.r == r &&
+        g_current_led_color.g == g && g_current_led_color.b == b) {
+        return;
+    }
+
     g_current_led_color.r = r;
     g_current_led_color.g = g;
     g_current_led_color.b = b;
+    g_led_written = true;
 
     led_strip_set_pixel(g_led_strip, 0, r, g, b);
     led_strip_refresh(g_led_strip);
 }
 
 // ====================
-// LED Flash Cyan
+// LED Events
 // ====================
 
-void led_flash_cyan(void) {
-    g_led_flash_active = true;
-    g_led_flash_end_time =
-        (esp_timer_get_time() / 1000) + LED_FLASH_DURATION_MS;
+/**
+ * @brief Post a state-change event to led_task().  Never blocks; a no-op on
+ *        nodes without a status LED.
+ * @param event Event to post.
+ */
+void led_post_event(led_event_t event) {
+    if (g_led_queue == NULL) {
+        return;
+    }
+    if (xQueueSend(g_led_queue, &event, 0) == pdTRUE) {
+        task_stats_note_queue(g_led_queue);
+    } else {
+        counter_inc(CNT_DROP_LED);
+    }
 }
 
+/** @brief Acknowledge a button press with a short cyan flash. */
+void led_flash_cyan(void) { led_post_event(LED_EVENT_PRESS); }
+
 // ====================
 // LED Task
 // ====================
 
+/** Animation applied to a colour. */
+typedef enum {
+    LED_ANIM_SOLID = 0,
+    LED_ANIM_BLINK,    // on/off, half period each
+    LED_ANIM_BREATHE,  // triangle ramp up and down
+    LED_ANIM_FADE,     // single ramp down to off
+} led_anim_t;
+
+/** A colour plus how it moves over time. */
+typedef struct {
+    led_color_t color;
+    led_anim_t anim;
+    uint32_t period_ms;
+    int64_t start_us;
+} led_pattern_t;
+
+/** @brief Base pattern for the current mesh / OTA state. */
+static led_pattern_t led_base_pattern(void) {
+    led_pattern_t p = {.anim = LED_ANIM_SOLID};
+    if (g_ota_in_progress) {
+        p.color = (led_color_t){0, 0, 255};
+        p.anim = LED_ANIM_BLINK;
+        p.period_ms = LED_BLINK_PERIOD_MS;
+    } else if (g_mesh_connected) {
+        p.color = (led_color_t){0, 255, 0};
+    } else if (g_mesh_started) {
+        p.color = (led_color_t){255, 255, 0};
+        p.anim = LED_ANIM_BREATHE;
+        p.period_ms = LED_BREATHE_PERIOD_MS;
+    } else {
+        p.color = (led_color_t){255, 0, 0};
+    }
+    return p;
+}
+
 /**
- * @brief FreeRTOS task: update the NeoPixel colour to reflect mesh state.
+ * @brief Render a pattern at the given time.
+ * @param p       Pattern to render.
+ * @param now_us  Current esp_timer time.
+ * @param next_us Set to the time of the next frame, or 0 if static.
+ */
+static void led_render(const led_pattern_t* p, int64_t now_us,
+                       int64_t* next_us) {
+    uint32_t period_us = p->period_ms * 1000;
+    uint32_t scale = 255;  // 0-255 brightness factor
+    *next_us = 0;
+
+    if (p->anim == LED_ANIM_BLINK && period_us > 0) {
+        int64_t phase = (now_us - p->start_us) % period_us;
+        scale = (phase < period_us / 2) ? 255 : 0;
+        // Sleep exactly until the next on/off edge.
+        *next_us = now_us + (phase < period_us / 2 ? period_us / 2 - phase
+                                                   : period_us - phase);
+    } else if (p->anim == LED_ANIM_BREATHE && period_us > 0) {
+        int64_t phase = (now_us - p->start_us) % period_us;
+        int64_t half = period_us / 2;
+        int64_t ramp = phase < half ? phase : period_us - phase;
+        scale = (uint32_t)(ramp * 255 / half);
+        *next_us = now_us + LED_ANIM_FRAME_MS * 1000;
+    } else if (p->anim == LED_ANIM_FADE && period_us > 0) {
+        int64_t elapsed = now_us - p->start_us;
+        if (elapsed < period_us) {
+            scale = (uint32_t)(255 - elapsed * 255 / period_us);
+            *next_us = now_us + LED_ANIM_FRAME_MS * 1000;
+        } else {
+            scale = 0;
+        }
+    }
+
+    led_set_color(p->color.r * scale / 255, p->color.g * scale / 255,
+                  p->color.b * scale / 255);
+}
+
+/**
+ * @brief FreeRTOS task: event-driven status LED.
+ *
+ * Blocks on the LED event queue and only wakes for an event, the next
+ * animation frame, or the end of a short overlay (press acknowledgement,
+ * delivery result).  Static states sleep indefinitely, and the strip is
+ * refreshed only when the rendered colour actually changes.
  *
- * Also handles OTA blue indication and short cyan flash after a button press.
+ * Base states: red = mesh not started, breathing yellow = connecting,
+ * green = connected, blinking blue = OTA.  Overlays: cyan = press seen,
+ * white = button message handed to the mesh, red fade = send failed.
  */
 void led_task(void* arg) {
     ESP_LOGI(TAG, "LED task started");
 
+    led_pattern_t base = led_base_pattern();
+    base.start_us = esp_timer_get_time();
+    led_pattern_t overlay = {0};
+    int64_t overlay_end_us = 0;
+
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(LED_UPDATE_INTERVAL_MS));
+        int64_t now_us = esp_timer_get_time();
+        int64_t next_us = 0;
 
-        if (g_ota_in_progress) {
-            led_set_color(0, 0, 255);
-            continue;
+        if (overlay_end_us != 0 && now_us >= overlay_end_us) {
+            overlay_end_us = 0;
         }
 
-        uint32_t current_time = esp_timer_get_time() / 1000;
-
-        if (g_led_flash_active) {
-            if (current_time < g_led_flash_end_time) {
-                led_set_color(0, 255, 255);
-                continue;
-            } else {
-                g_led_flash_active = false;
+        if (overlay_end_us != 0) {
+            led_render(&overlay, now_us, &next_us);
+            if (next_us == 0 || next_us > overlay_end_us) {
+                next_us = overlay_end_us;
             }
+        } else {
+            led_render(&base, now_us, &next_us);
         }
 
-        if (g_mesh_connected) {
-            led_set_color(0, 255, 0);
-        } else if (g_mesh_started) {
-            led_set_color(255, 255, 0);
-        } else {
-            led_set_color(255, 0, 0);
+        TickType_t wait = portMAX_DELAY;
+        if (next_us != 0) {
+            int64_t delta_ms = (next_us - now_us + 999) / 1000;
+            wait = pdMS_TO_TICKS(delta_ms > 0 ? delta_ms : 1);
+        }
+
+        led_event_t event;
+        if (xQueueReceive(g_led_queue, &event, wait) != pdTRUE) {
+            continue;
+        }
+
+        now_us = esp_timer_get_time();
+        switch (event) {
+            case LED_EVENT_STATE_CHANGED: {
+                led_pattern_t next = led_base_pattern();
+                if (next.anim != base.anim || next.color.r != base.color.r ||
+                    next.color.g != base.color.g ||
+                    next.color.b != base.color.b) {
+                    base = next;
+                    base.start_us = now_us;
+                }
+                break;
+            }
+
+            case LED_EVENT_PRESS:
+                overlay = (led_pattern_t){.color = {0, 255, 255},
+                                          .anim = LED_ANIM_SOLID,
+                                          .start_us = now_us};
+                overlay_end_us = now_us + LED_FLASH_DURATION_MS * 1000;
+                break;
+
+            case LED_EVENT_DELIVERED:
+                overlay = (led_pattern_t){.color = {255, 255, 255},
+                                          .anim = LED_ANIM_SOLID,
+                                          .start_us = now_us};
+                overlay_end_us = now_us + LED_FLASH_DURATION_MS * 1000;
+                break;
+
+            case LED_EVENT_DELIVERY_FAILED:
+                overlay = (led_pattern_t){.color = {255, 0, 0},
+                                          .anim = LED_ANIM_FADE,
+                                          .period_ms = LED_FAIL_FADE_MS,
+                                          .start_us = now_us};
+                overlay_end_us = now_us + LED_FAIL_FADE_MS * 1000;
+                break;
+
+            default:
+                break;
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,172 @@
+/**
+ * @file profiler.c
+ * @brief Cycle-count profiler for the root's hot paths
+ *        (CONFIG_DOMATOR_PROFILER).
+ *
+ * PROF_SCOPE(stage) in domator_mesh.h reads esp_cpu_get_cycle_count() on
+ * entry and again when the enclosing block is left (GCC cleanup attribute),
+ * and feeds the difference to profiler_record().  Each stage keeps a
+ * fixed log2 histogram: bucket 0 counts zero-cycle samples, bucket i counts
+ * [2^(i-1), 2^i) cycles and the last bucket everything above.  Updates are
+ * relaxed atomic adds, so timed code on both cores never blocks.
+ *
+ * Timed stages: root RX dispatch per message type, registry lookup, route
+ * lookup, TX enqueue, MQTT publish and JSON command parsing.  Results are
+ * published on /switch/profile/<id> by the "profile" root command (with
+ * "reset":true to clear afterwards) and printed by the shell's "prof"
+ * command.  With the option off, PROF_SCOPE() expands to nothing.
+ */
+
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_rom_sys.h"
+
+#if CONFIG_DOMATOR_PROFILER
+
+static const char* TAG = "PROFILER";
+
+static prof_hist_t s_hist[PROF_STAGE_COUNT];
+
+// ====================
+// Recording
+// ====================
+
+/** @brief Add one sample.  Safe from any task on either core. */
+void profiler_record(prof_stage_t stage, uint32_t cycles) {
+    if (stage >= PROF_STAGE_COUNT) return;
+    prof_hist_t* h = &s_hist[stage];
+
+    int bucket = cycles ? 32 - __builtin_clz(cycles) : 0;
+    if (bucket >= PROF_BUCKETS) bucket = PROF_BUCKETS - 1;
+
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, cycles, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (cycles > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, cycles, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/** @brief Copy one stage's histogram (counters read individually). */
+void profiler_get(prof_stage_t stage, prof_hist_t* out) {
+    const prof_hist_t* h = &s_hist[stage];
+    out->count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    out->max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    out->sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+    for (int i = 0; i < PROF_BUCKETS; i++) {
+        out->buckets[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    }
+}
+
+/** @brief Clear all histograms.  Samples racing with the reset may survive. */
+void profiler_reset(void) {
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        prof_hist_t* h = &s_hist[s];
+        __atomic_store_n(&h->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&h->sum, 0, __ATOMIC_RELAXED);
+        for (int i = 0; i < PROF_BUCKETS; i++) {
+            __atomic_store_n(&h->buckets[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    ESP_LOGI(TAG, "Profiler histograms cleared");
+}
+
+// ====================
+// Reporting
+// ====================
+
+/**
+ * @brief Name of a stage: "rx<type>" for RX dispatch, otherwise a fixed
+ *        word.
+ * @return buf.
+ */
+const char* profiler_stage_name(prof_stage_t stage, char* buf, size_t len) {
+    if (stage < PROF_REGISTRY_LOOKUP) {
+        snprintf(buf, len, "rx%c", 'A' + (stage - PROF_RX_FIRST));
+        return buf;
+    }
+
+    const char* name;
+    switch (stage) {
+        case PROF_REGISTRY_LOOKUP:
+            name = "registry";
+            break;
+        case PROF_ROUTE_LOOKUP:
+            name = "route";
+            break;
+        case PROF_TX_ENQUEUE:
+            name = "txEnqueue";
+            break;
+        case PROF_MQTT_PUBLISH:
+            name = "mqttPublish";
+            break;
+        case PROF_CONFIG_PARSE:
+            name = "configParse";
+            break;
+        default:
+            name = "unknown";
+            break;
+    }
+    strlcpy(buf, name, len);
+    return buf;
+}
+
+/**
+ * @brief Publish all stages with samples as JSON on /switch/profile/<id>.
+ *
+ * Payload: {"cyclesPerUs":N,
+ *           "stages":{"rxB":{"n":N,"sum":N,"max":N,"hist":[b0,b1,...]},...}}
+ * where hist is trimmed after the last non-empty bucket.
+ */
+void profiler_publish(void) {
+    if (!g_mqtt_connected) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to create JSON object");
+        return;
+    }
+    cJSON_AddNumberToObject(json, "cyclesPerUs",
+                            esp_rom_get_cpu_ticks_per_us());
+    cJSON* stages = cJSON_AddObjectToObject(json, "stages");
+
+    static prof_hist_t h;
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        profiler_get(s, &h);
+        if (h.count == 0) continue;
+
+        int last = PROF_BUCKETS - 1;
+        while (last > 0 && h.buckets[last] == 0) last--;
+
+        char name[16];
+        cJSON* stage = cJSON_AddObjectToObject(
+            stages, profiler_stage_name(s, name, sizeof(name)));
+        cJSON_AddNumberToObject(stage, "n", h.count);
+        cJSON_AddNumberToObject(stage, "sum", (double)h.sum);
+        cJSON_AddNumberToObject(stage, "max", h.max);
+        cJSON* hist = cJSON_AddArrayToObject(stage, "hist");
+        for (int i = 0; i <= last; i++) {
+            cJSON_AddItemToArray(hist, cJSON_CreateNumber(h.buckets[i]));
+        }
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        ESP_LOGE(TAG, "Failed to serialise profile");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "/switch/profile/%" PRIu64, g_device_id);
+    esp_mqtt_client_publish(g_mqtt_client, topic, json_str, 0, 0, 0);
+    cJSON_free(json_str);
+}
+
+#endif  // CONFIG_DOMATOR_PROFILER
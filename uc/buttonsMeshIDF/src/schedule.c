@@ -0,0 +1,259 @@
+/**
+ * @file schedule.c
+ * @brief On-device weekly schedule engine for relay nodes.
+ *
+ * The root pushes a compact schedule table (MSG_TYPE_SCHEDULE) to each relay
+ * node.  The table is persisted in NVS and evaluated locally once per second
+ * against the wall clock distributed by time_sync.c, so timed automation
+ * keeps running while the root, the broker, or the backend is unreachable
+ * and costs no mesh traffic per event.
+ *
+ * Wire/NVS format: one byte entry count followed by packed
+ * schedule_entry_t records (see domator_mesh.h).
+ */
+
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "domator_mesh.h"
+#include "nvs.h"
+
+static const char* TAG = "SCHEDULE";
+
+#define NVS_SCHEDULE_NAMESPACE "schedule"
+#define NVS_SCHEDULE_KEY "table"
+
+static schedule_entry_t s_entries[SCHEDULE_MAX_ENTRIES];
+static uint8_t s_num_entries = 0;
+static SemaphoreHandle_t s_schedule_mutex = NULL;
+
+// ====================
+// NVS Persistence
+// ====================
+
+/** @brief Write the current table to NVS (skipped when unchanged). */
+static void schedule_save_to_nvs(void) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_SCHEDULE_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS for schedule: %s",
+                 esp_err_to_name(err));
+        return;
+    }
+
+    size_t size = s_num_entries * sizeof(schedule_entry_t);
+    if (size == 0) {
+        err = nvs_erase_key(nvs_handle, NVS_SCHEDULE_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    } else {
+        err = nvs_set_blob(nvs_handle, NVS_SCHEDULE_KEY, s_entries, size);
+    }
+
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save schedule: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Schedule saved to NVS (%d entries)", s_num_entries);
+    }
+    nvs_close(nvs_handle);
+}
+
+/** @brief Load the persisted table from NVS, if any. */
+static void schedule_load_from_nvs(void) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_SCHEDULE_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "No saved schedule in NVS");
+        return;
+    }
+
+    size_t size = sizeof(s_entries);
+    err = nvs_get_blob(nvs_handle, NVS_SCHEDULE_KEY, s_entries, &size);
+    if (err == ESP_OK && size % sizeof(schedule_entry_t) == 0) {
+        s_num_entries = size / sizeof(schedule_entry_t);
+        ESP_LOGI(TAG, "Loaded %d schedule entries from NVS", s_num_entries);
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to read schedule from NVS: %s",
+                 esp_err_to_name(err));
+        s_num_entries = 0;
+    }
+    nvs_close(nvs_handle);
+}
+
+// ====================
+// Table Updates
+// ====================
+
+/** @brief Create the schedule mutex and restore the table from NVS. */
+void schedule_init(void) {
+    s_schedule_mutex = xSemaphoreCreateMutex();
+    if (s_schedule_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create schedule mutex");
+        return;
+    }
+    schedule_load_from_nvs();
+}
+
+/**
+ * @brief Replace the schedule table with the one carried by a
+ *        MSG_TYPE_SCHEDULE message from the root.
+ * @param msg Message whose data holds a count byte followed by entries.
+ */
+void schedule_handle_message(const mesh_app_msg_t* msg) {
+    if (s_schedule_mutex == NULL) return;
+
+    if (msg->data_len < 1) {
+        ESP_LOGW(TAG, "Empty schedule message");
+        return;
+    }
+
+    uint8_t count = (uint8_t)msg->data[0];
+    if (count > SCHEDULE_MAX_ENTRIES ||
+        msg->data_len < 1 + count * sizeof(schedule_entry_t)) {
+        ESP_LOGW(TAG, "Invalid schedule message (count=%d, len=%d)", count,
+                 msg->data_len);
+        return;
+    }
+
+    if (xSemaphoreTake(s_schedule_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGW(TAG, "schedule_handle_message: mutex timeout");
+        return;
+    }
+
+    bool changed = count != s_num_entries ||
+                   memcmp(s_entries, &msg->data[1],
+                          count * sizeof(schedule_entry_t)) != 0;
+    if (changed) {
+        memcpy(s_entries, &msg->data[1], count * sizeof(schedule_entry_t));
+        s_num_entries = count;
+        schedule_save_to_nvs();
+    }
+
+    xSemaphoreGive(s_schedule_mutex);
+
+    ESP_LOGI(TAG, "Schedule update: %d entries (%s)", count,
+             changed ? "changed" : "unchanged");
+}
+
+// ====================
+// Evaluation
+// ====================
+
+/**
+ * @brief Apply one schedule entry to the relay outputs.
+ * @return true if any output changed state.
+ */
+static bool schedule_apply(const schedule_entry_t* entry) {
+    int max_relays =
+        (g_board_type == BOARD_TYPE_16_RELAY) ? MAX_RELAYS_16 : MAX_RELAYS_8;
+    bool changed = false;
+
+    for (int i = 0; i < max_relays; i++) {
+        if (!(entry->output_mask & (1u << i))) continue;
+
+        bool current = relay_get_state(i);
+        bool target = current;
+        if (entry->action == SCHEDULE_ACTION_ON) {
+            target = true;
+        } else if (entry->action == SCHEDULE_ACTION_OFF) {
+            target = false;
+        } else if (entry->action == SCHEDULE_ACTION_TOGGLE) {
+            target = !current;
+        }
+
+        if (target != current) {
+            relay_set(i, target);
+            relay_send_state_confirmation(i);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Fire every entry whose trigger time falls in (from, to].
+ *
+ * Both bounds are local times; the window spans at most
+ * SCHEDULE_MAX_CATCHUP_S so a forward clock step or a delayed task still
+ * fires the entries it skipped over, while a large jump (first sync) does
+ * not replay the whole day.
+ */
+static void schedule_evaluate(time_t from, time_t to) {
+    if (to - from > SCHEDULE_MAX_CATCHUP_S) {
+        from = to - SCHEDULE_MAX_CATCHUP_S;
+    }
+
+    if (xSemaphoreTake(s_schedule_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        ESP_LOGW(TAG, "schedule_evaluate: mutex timeout");
+        return;
+    }
+
+    bool changed = false;
+    for (time_t t = from + 1; t <= to; t++) {
+        struct tm tm_now;
+        localtime_r(&t, &tm_now);
+        uint32_t second_of_day =
+            tm_now.tm_hour * 3600 + tm_now.tm_min * 60 + tm_now.tm_sec;
+
+        for (int i = 0; i < s_num_entries; i++) {
+            const schedule_entry_t* entry = &s_entries[i];
+            if (entry->second_of_day != second_of_day) continue;
+            if (!(entry->day_mask & (1u << tm_now.tm_wday))) continue;
+
+            ESP_LOGI(TAG,
+                     "Schedule %d fired at %02d:%02d:%02d (mask=0x%04X, "
+                     "action=%d)",
+                     i, tm_now.tm_hour, tm_now.tm_min, tm_now.tm_sec,
+                     entry->output_mask, entry->action);
+            changed |= schedule_apply(entry);
+        }
+    }
+
+    xSemaphoreGive(s_schedule_mutex);
+
+    if (changed) {
+        relay_save_states_to_nvs();
+    }
+}
+
+/**
+ * @brief FreeRTOS task: evaluate the schedule table once per second.
+ *
+ * Wakes shortly after each wall-clock second boundary.  Does nothing until
+ * the clock has been set by time_sync.c; afterwards it keeps evaluating on
+ * the free-running local clock even when the mesh is down.  A small
+ * backwards clock step never re-fires entries that already ran.
+ */
+void schedule_task(void* arg) {
+    ESP_LOGI(TAG, "Schedule task started");
+
+    time_t last_evaluated = 0;
+
+    while (1) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        uint32_t to_next_second_ms = (1000000 - tv.tv_usec) / 1000 + 1;
+        vTaskDelay(pdMS_TO_TICKS(to_next_second_ms));
+
+        if (g_ota_in_progress || !time_sync_is_valid()) {
+            continue;
+        }
+
+        time_t now = time(NULL);
+        if (last_evaluated == 0 ||
+            last_evaluated - now > SCHEDULE_MAX_CATCHUP_S) {
+            // First valid second, or a large backwards step: restart here.
+            last_evaluated = now;
+            continue;
+        }
+
+        // Small backwards steps wait for the clock to catch up again.
+        if (now > last_evaluated) {
+            schedule_evaluate(last_evaluated, now);
+            last_evaluated = now;
+        }
+    }
+}
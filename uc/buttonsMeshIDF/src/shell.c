@@ -0,0 +1,735 @@
+/**
+ * @file shell.c
+ * @brief Interactive esp_console shell for Telnet clients on the root.
+ *
+ * telnet.c collects complete lines from each client and passes them to
+ * shell_submit().  The lines are executed one at a time by shell_task(), a
+ * priority-1 task, so diagnostics never run on the mesh RX/TX or button
+ * paths and a slow command only delays other shell commands.  Commands print
+ * with shell_printf(), which sends the text back to the client that issued
+ * the command.
+ *
+ * Commands:
+ *  - help                     list commands
+ *  - nodes                    node registry (type, address, last seen, RTT)
+ *  - routes                   button → relay routing table
+ *  - stats                    non-zero counters, per-type RX/TX, heap
+ *  - tasks                    last telemetry sample: per-task state,
+ *                             priority, stack and CPU; queue depths
+ *  - heap                     free, largest block, min-ever and fragmentation
+ *                             per capability; allocation tags if enabled
+ *  - prof [reset]             hot-path cycle counts (CONFIG_DOMATOR_PROFILER)
+ *  - trace <start [oneshot]|stop|status|dump>
+ *                             scheduling trace (CONFIG_DOMATOR_TRACE); save
+ *                             the dump for tools/trace_export.py
+ *  - boot                     boot-phase timeline of this boot (ms)
+ *  - failover                 timeline of the last root failover (ms)
+ *  - standby                  root role, standby and replicated state
+ *  - redetect                 probe the hardware again on next boot
+ *  - mesh                     layer, parent and mesh routing table
+ *  - log <tag|*> <level>      change the log level of a tag
+ *  - logs <on|off>            pause/resume the log stream to this client
+ *  - ping <device>            start a ping/pong RTT probe
+ *  - relay <device> <cmd>     send a relay command, e.g. "relay 123 a1"
+ *  - fault [<device|root> <clear|disconnect|report|freeze <task> <ms>|
+ *          <rx|tx|both> <type|*> <drop%> [<delay%> <ms> [<dup%>
+ *          [<reorder%>]]]>]
+ *                             fault injection (CONFIG_DOMATOR_FAULT); the
+ *                             node's report goes to /switch/fault/<id>
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+
+static const char* TAG = "SHELL";
+
+/** One command line waiting for shell_task(). */
+typedef struct {
+    int client;
+    char line[SHELL_LINE_MAX];
+} shell_request_t;
+
+static QueueHandle_t s_shell_queue = NULL;
+static int s_current_client = -1;
+
+// ====================
+// Output
+// ====================
+
+/**
+ * @brief printf() to the client whose command is running.  "\n" is sent as
+ *        "\r\n" for Telnet.
+ * @return Number of characters formatted.
+ */
+int shell_printf(const char* fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len < 0) return len;
+    size_t n = len < (int)sizeof(buf) ? (size_t)len : sizeof(buf) - 1;
+
+    const char* p = buf;
+    const char* end = buf + n;
+    while (p < end) {
+        const char* nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            telnet_client_write(s_current_client, p, end - p);
+            break;
+        }
+        telnet_client_write(s_current_client, p, nl - p);
+        telnet_client_write(s_current_client, "\r\n", 2);
+        p = nl + 1;
+    }
+    return len;
+}
+
+/** @brief Parse a decimal device ID argument. */
+static bool parse_device_id(const char* arg, uint64_t* out) {
+    char* end = NULL;
+    *out = strtoull(arg, &end, 10);
+    if (end == arg || *end != '\0' || *out == 0) {
+        shell_printf("Invalid device ID: %s\n", arg);
+        return false;
+    }
+    return true;
+}
+
+// ====================
+// Commands
+// ====================
+
+static int cmd_help(int argc, char** argv);
+
+static int cmd_nodes(int argc, char** argv) {
+    root_shell_print_registry();
+    return 0;
+}
+
+static int cmd_routes(int argc, char** argv) {
+    // One device's routes, copied so a slow client never holds the table
+    // that find_button_route() needs on every button press.
+    static route_target_t targets[MAX_BUTTONS_EXTENDED][MAX_ROUTES_PER_BUTTON];
+    uint8_t counts[MAX_BUTTONS_EXTENDED];
+
+    int routes = 0;
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (xSemaphoreTake(g_connections_mutex, pdMS_TO_TICKS(1000)) !=
+            pdTRUE) {
+            shell_printf("Routing table busy\n");
+            return 1;
+        }
+        device_connections_t* dev = &g_connections[i];
+        uint64_t device_id = dev->device_id;
+        for (int b = 0; device_id != 0 && b < MAX_BUTTONS_EXTENDED; b++) {
+            button_route_t* route = &dev->buttons[b];
+            counts[b] = route->num_targets < MAX_ROUTES_PER_BUTTON
+                            ? route->num_targets
+                            : MAX_ROUTES_PER_BUTTON;
+            if (counts[b] > 0) {
+                memcpy(targets[b], route->targets,
+                       counts[b] * sizeof(route_target_t));
+            }
+        }
+        xSemaphoreGive(g_connections_mutex);
+        if (device_id == 0) continue;
+
+        for (int b = 0; b < MAX_BUTTONS_EXTENDED; b++) {
+            if (counts[b] == 0) continue;
+
+            shell_printf("%" PRIu64 " '%c' ->", device_id, 'a' + b);
+            for (int t = 0; t < counts[b]; t++) {
+                shell_printf(" %" PRIu64 ":%c", targets[b][t].target_node_id,
+                             targets[b][t].relay_command[0]);
+            }
+            shell_printf("\n");
+            routes++;
+        }
+    }
+
+    shell_printf("%d route(s)\n", routes);
+    return 0;
+}
+
+static int cmd_stats(int argc, char** argv) {
+    uint32_t btn_overflows = 0, btn_missed = 0;
+    button_input_get_stats(&btn_overflows, &btn_missed);
+
+    shell_printf("uptime        %lld s\n",
+                 (long long)(esp_timer_get_time() / 1000000));
+    shell_printf("heap          %" PRIu32 " free, %" PRIu32 " min\n",
+                 (uint32_t)esp_get_free_heap_size(),
+                 (uint32_t)esp_get_minimum_free_heap_size());
+    shell_printf("tx queue      %d waiting\n", mesh_tx_queue_depth());
+    shell_printf("button input  %" PRIu32 " overflows, %" PRIu32
+                 " missed edges\n",
+                 btn_overflows, btn_missed);
+    shell_printf("clock unc     %" PRId32 " us\n", mesh_time_uncertainty_us());
+
+    for (int i = 0; i < CNT_COUNT; i++) {
+        uint32_t v = counter_get(i);
+        if (v) shell_printf("%-13s %" PRIu32 "\n", counter_name(i), v);
+    }
+
+    shell_printf("msg  %8s %8s\n", "rx", "tx");
+    for (int i = 0; i < COUNTER_MSG_TYPES; i++) {
+        uint32_t rx = __atomic_load_n(&g_rx_counts[i], __ATOMIC_RELAXED);
+        uint32_t tx = __atomic_load_n(&g_tx_counts[i], __ATOMIC_RELAXED);
+        if (rx || tx) {
+            shell_printf("%c    %8" PRIu32 " %8" PRIu32 "\n", 'A' + i, rx, tx);
+        }
+    }
+    return 0;
+}
+
+static int cmd_tasks(int argc, char** argv) {
+    static task_stat_t tasks[TASK_STATS_MAX_TASKS];
+    static queue_stat_t queues[TASK_STATS_MAX_QUEUES];
+    int queue_count = 0;
+    uint32_t interval_ms = 0;
+    int task_count =
+        task_stats_snapshot(tasks, queues, &queue_count, &interval_ms);
+
+    if (task_count == 0) {
+        shell_printf("No task sample yet (needs "
+                     "CONFIG_FREERTOS_USE_TRACE_FACILITY)\n");
+    } else {
+        static const char states[] = {'X', 'R', 'B', 'S', 'D', 'I'};
+        shell_printf("%-12s %2s %4s %10s %6s\n", "task", "st", "prio",
+                     "stack free", "cpu%");
+        for (int i = 0; i < task_count; i++) {
+            task_stat_t* t = &tasks[i];
+            char state = t->state < sizeof(states) ? states[t->state] : '?';
+            shell_printf("%-12.*s %2c %4u %10u %4u.%u\n", TASK_STATS_NAME_LEN,
+                         t->name, state, t->priority, t->stack_free,
+                         t->cpu_permille / 10, t->cpu_permille % 10);
+        }
+        shell_printf("cpu%% over the last %" PRIu32 " ms\n", interval_ms);
+    }
+
+    shell_printf("%-10s %6s %6s %6s\n", "queue", "depth", "hwm", "size");
+    for (int i = 0; i < queue_count; i++) {
+        shell_printf("%-10.*s %6u %6u %6u\n", (int)sizeof(queues[i].name),
+                     queues[i].name, queues[i].depth, queues[i].hwm,
+                     queues[i].size);
+    }
+    return 0;
+}
+
+static int cmd_heap(int argc, char** argv) {
+    static const struct {
+        const char* name;
+        uint32_t caps;
+    } classes[] = {
+        {"default", MALLOC_CAP_DEFAULT},
+        {"internal", MALLOC_CAP_INTERNAL},
+        {"dma", MALLOC_CAP_DMA},
+    };
+
+    shell_printf("%-9s %8s %8s %8s %6s\n", "caps", "free", "largest",
+                 "min ever", "frag%");
+    for (int i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+        heap_caps_stat_t s;
+        heap_stats_get(classes[i].caps, &s);
+        shell_printf("%-9s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %4u.%u\n",
+                     classes[i].name, s.free, s.largest, s.min_free,
+                     s.frag_permille / 10, s.frag_permille % 10);
+    }
+
+#if CONFIG_DOMATOR_HEAP_TAGS
+    heap_tags_sample();
+    shell_printf("%-9s %8s %8s %8s\n", "tag", "live", "peak", "allocs");
+    for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+        heap_tag_stat_t s;
+        heap_tag_get(i, &s);
+        shell_printf("%-9s %8" PRId32 " %8" PRId32 " %8" PRIu32 "\n",
+                     heap_tag_name(i), s.live, s.peak, s.allocs);
+    }
+#endif
+    return 0;
+}
+
+#if CONFIG_DOMATOR_PROFILER
+static int cmd_prof(int argc, char** argv) {
+    shell_printf("%-12s %8s %10s %10s\n", "stage", "n", "avg cyc", "max cyc");
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        prof_hist_t h;
+        profiler_get(s, &h);
+        if (h.count == 0) continue;
+
+        char name[16];
+        shell_printf("%-12s %8" PRIu32 " %10" PRIu32 " %10" PRIu32 "\n",
+                     profiler_stage_name(s, name, sizeof(name)), h.count,
+                     (uint32_t)(h.sum / h.count), h.max);
+    }
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) profiler_reset();
+    return 0;
+}
+#endif
+
+#if CONFIG_DOMATOR_TRACE
+static int cmd_trace(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+        bool oneshot = argc == 3 && strcmp(argv[2], "oneshot") == 0;
+        trace_start(oneshot);
+        shell_printf("Trace started (%s)\n", oneshot ? "one-shot" : "ring");
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        trace_stop();
+        shell_printf("Trace stopped, %" PRIu32 " events\n", trace_recorded());
+    } else if (argc == 2 && strcmp(argv[1], "status") == 0) {
+        shell_printf("Trace %s, %" PRIu32 " events recorded\n",
+                     trace_active() ? "running" : "stopped", trace_recorded());
+    } else if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        trace_dump(shell_printf);
+    } else {
+        shell_printf("Usage: trace <start [oneshot]|stop|status|dump>\n");
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+#if CONFIG_DOMATOR_CAPTURE
+static int cmd_capture(int argc, char** argv) {
+    uint32_t records, dropped;
+    capture_get_stats(&records, &dropped);
+    shell_printf("Capture %s on port %d, %" PRIu32 " records, %" PRIu32
+                 " dropped\n",
+                 capture_active() ? "streaming" : "idle",
+                 CONFIG_DOMATOR_CAPTURE_PORT, records, dropped);
+    return 0;
+}
+#endif
+
+#if CONFIG_DOMATOR_FAULT
+static void fault_usage(void) {
+    shell_printf("Usage: fault [<device|root> <clear|disconnect|report|"
+                 "freeze <task> <ms>|<rx|tx|both> <type|*> <drop%%> "
+                 "[<delay%%> <ms> [<dup%%> [<reorder%%>]]]>]\n");
+}
+
+/** @brief Parse a decimal argument in 0..max. */
+static bool parse_uint(const char* arg, uint32_t max, uint32_t* out) {
+    char* end = NULL;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || arg[0] == '-' || value > max) {
+        shell_printf("Invalid value: %s (0..%" PRIu32 ")\n", arg, max);
+        return false;
+    }
+    *out = (uint32_t)value;
+    return true;
+}
+
+/** @brief Parse a percentage argument into @p out. */
+static bool parse_pct(const char* arg, uint8_t* out) {
+    uint32_t value;
+    if (!parse_uint(arg, 100, &value)) return false;
+    *out = (uint8_t)value;
+    return true;
+}
+
+static void fault_print_counts(const char* dir, const uint32_t* counts) {
+    shell_printf("%s: drop %" PRIu32 ", delay %" PRIu32 ", dup %" PRIu32
+                 ", reorder %" PRIu32 "\n",
+                 dir, counts[FAULT_ACT_DROP], counts[FAULT_ACT_DELAY],
+                 counts[FAULT_ACT_DUPLICATE], counts[FAULT_ACT_REORDER]);
+}
+
+static int cmd_fault(int argc, char** argv) {
+    if (argc == 1) {
+        fault_report_t report;
+        fault_get_report(&report);
+        for (int i = 0; i < report.rule_count; i++) {
+            const fault_rule_t* r = &report.rules[i];
+            shell_printf("%c %-4s drop %u%% delay %u%% (%u ms) dup %u%% "
+                         "reorder %u%%\n",
+                         r->msg_type ? r->msg_type : '*',
+                         r->dir == FAULT_DIR_RX   ? "rx"
+                         : r->dir == FAULT_DIR_TX ? "tx"
+                                                  : "both",
+                         r->drop_pct, r->delay_pct, r->delay_ms, r->dup_pct,
+                         r->reorder_pct);
+        }
+        uint32_t counts[2][FAULT_ACT_COUNT];
+        memcpy(counts, report.injected, sizeof(counts));
+        fault_print_counts("rx", counts[0]);
+        fault_print_counts("tx", counts[1]);
+        shell_printf("disconnects %" PRIu32 ", freezes %" PRIu32 "\n",
+                     report.disconnects, report.freezes);
+        return 0;
+    }
+
+    uint64_t id = 0;
+    if (argc < 3 ||
+        (strcmp(argv[1], "root") != 0 && !parse_device_id(argv[1], &id))) {
+        fault_usage();
+        return 1;
+    }
+
+    fault_ctl_t ctl = {0};
+    if (argc == 3 && strcmp(argv[2], "clear") == 0) {
+        ctl.op = FAULT_OP_CLEAR;
+    } else if (argc == 3 && strcmp(argv[2], "disconnect") == 0) {
+        ctl.op = FAULT_OP_DISCONNECT;
+    } else if (argc == 3 && strcmp(argv[2], "report") == 0) {
+        ctl.op = FAULT_OP_REPORT_REQ;
+    } else if (argc == 5 && strcmp(argv[2], "freeze") == 0) {
+        ctl.op = FAULT_OP_FREEZE;
+        strncpy(ctl.task, argv[3], sizeof(ctl.task));
+        uint32_t ms;
+        if (!parse_uint(argv[4], FAULT_MAX_FREEZE_MS, &ms)) {
+            fault_usage();
+            return 1;
+        }
+        ctl.ms = ms;
+    } else if (argc >= 5 && argc <= 9) {
+        ctl.op = FAULT_OP_ADD;
+        ctl.rule.dir = strcmp(argv[2], "rx") == 0   ? FAULT_DIR_RX
+                       : strcmp(argv[2], "tx") == 0 ? FAULT_DIR_TX
+                       : strcmp(argv[2], "both") == 0
+                           ? FAULT_DIR_RX | FAULT_DIR_TX
+                           : 0;
+        ctl.rule.msg_type = strcmp(argv[3], "*") == 0 ? 0 : argv[3][0];
+        uint32_t delay_ms = 0;
+        if (!parse_pct(argv[4], &ctl.rule.drop_pct) ||
+            (argc >= 7 && (!parse_pct(argv[5], &ctl.rule.delay_pct) ||
+                           !parse_uint(argv[6], UINT16_MAX, &delay_ms))) ||
+            (argc >= 8 && !parse_pct(argv[7], &ctl.rule.dup_pct)) ||
+            (argc >= 9 && !parse_pct(argv[8], &ctl.rule.reorder_pct))) {
+            fault_usage();
+            return 1;
+        }
+        ctl.rule.delay_ms = (uint16_t)delay_ms;
+    } else {
+        shell_printf("Unknown fault command\n");
+        return 1;
+    }
+
+    if (!fault_control(id, &ctl)) {
+        shell_printf("Not applied (see log)\n");
+        return 1;
+    }
+    if (ctl.op != FAULT_OP_REPORT_REQ) {
+        ctl.op = FAULT_OP_REPORT_REQ;
+        fault_control(id, &ctl);
+    }
+    shell_printf("Done, report on /switch/fault/<id>\n");
+    return 0;
+}
+#endif
+
+static int cmd_boot(int argc, char** argv) {
+    uint32_t prev_ms = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        uint32_t at_ms = boot_phase_ms(i);
+        if (at_ms == 0) {
+            shell_printf("%-10s %8s\n", boot_phase_name(i), "-");
+            continue;
+        }
+        shell_printf("%-10s %8" PRIu32 " ms  +%" PRIu32 "\n",
+                     boot_phase_name(i), at_ms,
+                     at_ms > prev_ms ? at_ms - prev_ms : 0);
+        prev_ms = at_ms;
+    }
+    return 0;
+}
+
+static int cmd_failover(int argc, char** argv) {
+    uint32_t start_ms = 0;
+    for (int i = 0; i < FAILOVER_EV_COUNT; i++) {
+        uint32_t at_ms = failover_stamp(i).at_ms;
+        if (at_ms != 0 && (start_ms == 0 || at_ms < start_ms)) start_ms = at_ms;
+    }
+    if (start_ms == 0) {
+        shell_printf("No failover since boot\n");
+        return 0;
+    }
+    for (int i = 0; i < FAILOVER_EV_COUNT; i++) {
+        failover_stamp_t stamp = failover_stamp(i);
+        if (stamp.at_ms == 0) {
+            shell_printf("%-10s %8s\n", failover_event_name(i), "-");
+            continue;
+        }
+        shell_printf("%-10s %8" PRIu32 " ms  +%" PRIu32 "%s\n",
+                     failover_event_name(i), stamp.at_ms,
+                     stamp.at_ms - start_ms,
+                     stamp.mesh_us ? "" : "  (no mesh time)");
+    }
+    return 0;
+}
+
+static int cmd_standby(int argc, char** argv) {
+    standby_status_t st;
+    standby_get_status(&st);
+    shell_printf("role %s\n", standby_role_name(st.role));
+    if (g_is_root) {
+        if (st.target_id == 0) {
+            shell_printf("no standby (no node has a root role)\n");
+        } else {
+            shell_printf("standby %" PRIu64 " (%s), %s\n", st.target_id,
+                         standby_role_name(st.target_role),
+                         st.target_synced ? "in sync" : "syncing");
+        }
+        shell_printf("%d configuration(s), %d relay board(s) kept\n",
+                     st.configs, st.outputs);
+        return 0;
+    }
+    shell_printf("replica: %d node(s), %d configuration(s), %d relay "
+                 "board(s)",
+                 st.nodes, st.configs, st.outputs);
+    if (st.updated_ms) {
+        shell_printf(", updated %" PRIu32 " ms ago", st.updated_ms);
+    }
+    shell_printf("\n");
+    return 0;
+}
+
+static int cmd_redetect(int argc, char** argv) {
+    fast_boot_request_redetect();
+    shell_printf("Hardware will be re-detected on next boot\n");
+    return 0;
+}
+
+static int cmd_mesh(int argc, char** argv) {
+    shell_printf("root %s, layer %d, parent %" PRIu64 ", connected %s\n",
+                 g_is_root ? "yes" : "no", g_mesh_layer, g_parent_id,
+                 g_mesh_connected ? "yes" : "no");
+
+    int size = esp_mesh_get_routing_table_size();
+    if (size <= 0) {
+        shell_printf("Routing table empty\n");
+        return 0;
+    }
+
+    mesh_addr_t* table = malloc(size * sizeof(mesh_addr_t));
+    if (table == NULL) {
+        shell_printf("Out of memory\n");
+        return 1;
+    }
+    int count = 0;
+    esp_mesh_get_routing_table(table, size * sizeof(mesh_addr_t), &count);
+    shell_printf("Routing table (%d):\n", count);
+    for (int i = 0; i < count; i++) {
+        shell_printf("  " MACSTR "\n", MAC2STR(table[i].addr));
+    }
+    free(table);
+    return 0;
+}
+
+static int cmd_log(int argc, char** argv) {
+    static const char* levels[] = {"none", "error", "warn",
+                                   "info", "debug", "verbose"};
+    if (argc != 3) {
+        shell_printf("Usage: log <tag|*> <none|error|warn|info|debug|"
+                     "verbose>\n");
+        return 1;
+    }
+
+    for (int i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (strcmp(argv[2], levels[i]) == 0) {
+            esp_log_level_set(argv[1], (esp_log_level_t)i);
+            shell_printf("Log level of %s set to %s\n", argv[1], levels[i]);
+            return 0;
+        }
+    }
+    shell_printf("Unknown level: %s\n", argv[2]);
+    return 1;
+}
+
+static int cmd_logs(int argc, char** argv) {
+    if (argc != 2 || (strcmp(argv[1], "on") && strcmp(argv[1], "off"))) {
+        shell_printf("Usage: logs <on|off>\n");
+        return 1;
+    }
+    telnet_client_set_logs(s_current_client, strcmp(argv[1], "on") == 0);
+    return 0;
+}
+
+static int cmd_ping(int argc, char** argv) {
+    uint64_t id;
+    if (argc != 2) {
+        shell_printf("Usage: ping <device>\n");
+        return 1;
+    }
+    if (!parse_device_id(argv[1], &id)) return 1;
+    if (!root_ping_node(id)) {
+        shell_printf("Ping not sent (unknown node or queue full)\n");
+        return 1;
+    }
+    shell_printf("Ping sent, result will be logged\n");
+    return 0;
+}
+
+static int cmd_relay(int argc, char** argv) {
+    uint64_t id;
+    if (argc != 3) {
+        shell_printf("Usage: relay <device> <command>\n");
+        return 1;
+    }
+    if (!parse_device_id(argv[1], &id)) return 1;
+    if (!root_send_relay_command(id, argv[2])) {
+        shell_printf("Command not sent (unknown node or queue full)\n");
+        return 1;
+    }
+    shell_printf("Sent '%s' to %" PRIu64 "\n", argv[2], id);
+    return 0;
+}
+
+static const esp_console_cmd_t s_commands[] = {
+    {.command = "help", .help = "List commands", .func = cmd_help},
+    {.command = "nodes", .help = "Show the node registry", .func = cmd_nodes},
+    {.command = "routes", .help = "Show button routing", .func = cmd_routes},
+    {.command = "stats",
+     .help = "Counters, heap and queue depths",
+     .func = cmd_stats},
+    {.command = "tasks",
+     .help = "Task CPU/stack and queue depths",
+     .func = cmd_tasks},
+    {.command = "heap",
+     .help = "Free/largest/min heap per capability",
+     .func = cmd_heap},
+#if CONFIG_DOMATOR_PROFILER
+    {.command = "prof",
+     .help = "Hot-path cycle counts",
+     .hint = "[reset]",
+     .func = cmd_prof},
+#endif
+#if CONFIG_DOMATOR_TRACE
+    {.command = "trace",
+     .help = "Scheduling trace to RAM",
+     .hint = "<start|stop|status|dump>",
+     .func = cmd_trace},
+#endif
+#if CONFIG_DOMATOR_CAPTURE
+    {.command = "capture",
+     .help = "Traffic capture status",
+     .func = cmd_capture},
+#endif
+#if CONFIG_DOMATOR_FAULT
+    {.command = "fault",
+     .help = "Fault injection",
+     .hint = "[<device|root> <op>]",
+     .func = cmd_fault},
+#endif
+    {.command = "boot", .help = "Boot-phase timeline", .func = cmd_boot},
+    {.command = "failover",
+     .help = "Timeline of the last root failover",
+     .func = cmd_failover},
+    {.command = "standby",
+     .help = "Root role and hot-standby state",
+     .func = cmd_standby},
+    {.command = "redetect",
+     .help = "Re-probe hardware on next boot",
+     .func = cmd_redetect},
+    {.command = "mesh",
+     .help = "Mesh layer and routing table",
+     .func = cmd_mesh},
+    {.command = "log",
+     .help = "Set log level",
+     .hint = "<tag|*> <level>",
+     .func = cmd_log},
+    {.command = "logs",
+     .help = "Pause/resume log stream",
+     .hint = "<on|off>",
+     .func = cmd_logs},
+    {.command = "ping",
+     .help = "RTT probe to a node",
+     .hint = "<device>",
+     .func = cmd_ping},
+    {.command = "relay",
+     .help = "Send a relay command",
+     .hint = "<device> <cmd>",
+     .func = cmd_relay},
+};
+
+static int cmd_help(int argc, char** argv) {
+    for (int i = 0; i < sizeof(s_commands) / sizeof(s_commands[0]); i++) {
+        const esp_console_cmd_t* cmd = &s_commands[i];
+        shell_printf("  %-6s %-16s %s\n", cmd->command,
+                     cmd->hint ? cmd->hint : "", cmd->help);
+    }
+    return 0;
+}
+
+// ====================
+// Shell Task
+// ====================
+
+/**
+ * @brief FreeRTOS task: execute queued command lines one at a time and
+ *        send a prompt after each.
+ */
+static void shell_task(void* arg) {
+    static shell_request_t req;
+
+    while (1) {
+        if (xQueueReceive(s_shell_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        s_current_client = req.client;
+        int ret = 0;
+        esp_err_t err = esp_console_run(req.line, &ret);
+        if (err == ESP_ERR_NOT_FOUND) {
+            shell_printf("Unknown command, type 'help'\n");
+        } else if (err != ESP_OK && err != ESP_ERR_INVALID_ARG) {
+            shell_printf("Error: %s\n", esp_err_to_name(err));
+        }
+        shell_printf("> ");
+        s_current_client = -1;
+    }
+}
+
+/**
+ * @brief Queue a command line from a Telnet client.
+ * @param client Client slot index (used to route the output).
+ * @param line   NUL-terminated command line.
+ * @return false if the queue is full.
+ */
+bool shell_submit(int client, const char* line) {
+    if (s_shell_queue == NULL) return false;
+
+    shell_request_t req = {.client = client};
+    strlcpy(req.line, line, sizeof(req.line));
+    if (xQueueSend(s_shell_queue, &req, 0) != pdTRUE) {
+        counter_inc(CNT_DROP_SHELL);
+        return false;
+    }
+    task_stats_note_queue(s_shell_queue);
+    return true;
+}
+
+/** @brief Register all commands and start shell_task().  Idempotent. */
+void shell_init(void) {
+    if (s_shell_queue != NULL) return;
+
+    esp_console_config_t config = ESP_CONSOLE_CONFIG_DEFAULT();
+    config.max_cmdline_length = SHELL_LINE_MAX;
+    config.max_cmdline_args = 4;
+    esp_err_t err = esp_console_init(&config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "esp_console_init failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    for (int i = 0; i < sizeof(s_commands) / sizeof(s_commands[0]); i++) {
+        ESP_ERROR_CHECK(esp_console_cmd_register(&s_commands[i]));
+    }
+
+    s_shell_queue = xQueueCreate(SHELL_QUEUE_SIZE, sizeof(shell_request_t));
+    if (s_shell_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create shell queue");
+        return;
+    }
+    task_stats_register_queue("shell", s_shell_queue);
+    xTaskCreate(shell_task, "shell", 4096, NULL, 1, NULL);
+    ESP_LOGI(TAG, "Shell ready (%d commands)",
+             (int)(sizeof(s_commands) / sizeof(s_commands[0])));
+}
@@ -0,0 +1,849 @@
+/**
+ * @file standby.c
+ * @brief Root placement by role and the hot-standby root.
+ *
+ * ESP-MESH elects the root by itself (self-organised, vote
+ * MESH_VOTE_PERCENTAGE), so any node can end up carrying the MQTT client,
+ * the registry and the routing tables, a C3 switch included.  Boards that
+ * should carry them get a root role in NVS: ROOT_ROLE_PREFERRED for relay
+ * boards close to the router, ROOT_ROLE_STANDBY for the one kept warm.  The
+ * role is set with the "root_role" command and reported to the root with
+ * MSG_TYPE_TYPE_INFO.
+ *
+ * The root picks the best-ranked other node as its standby and keeps it in
+ * sync with MSG_TYPE_REPLICA frames: the registry, the routing
+ * configuration (connections, button types and blind pairs, kept as the
+ * JSON commands that set them) and the last reported relay outputs.
+ * Everything goes out when the standby is picked and every
+ * REPLICA_RESYNC_MS, and in between whatever changes.  Changes only mark the
+ * state dirty and wake standby_task(), which queues at most
+ * REPLICA_FRAMES_PER_POLL frames per REPLICA_POLL_MS and none while the TX
+ * queue holds button traffic, so a large configuration never crowds out
+ * relay commands.  The task and the replica buffers only exist on a root or
+ * a node with a root role, and the task sleeps while there is nothing to
+ * send.  A root that its standby outranks hands the root over with
+ * esp_mesh_waive_root() once the standby has been in sync for
+ * ROOT_HANDOVER_DELAY_MS.
+ *
+ * The election itself stays self-organised (a fixed root would give up
+ * healing), so a lost root is replaced by whichever node the mesh elects.
+ * A standby that becomes root loads the replicated registry and replays the
+ * configuration from standby_task() (not the mesh event handler) before
+ * MQTT is up, and publishes the cached outputs once the broker is
+ * connected; any other new root hands over to the warm standby.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+#include "esp_mesh.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+
+static const char* TAG = "STANDBY";
+
+#define NVS_ROOT_ROLE_KEY "root_role"
+#define REPLICA_TX_BACKLOG 4  // skip the tick while more are queued
+#define REPLICA_PICK_MS 5000  // look for a better standby
+#define REPLICA_NODES_PER_FRAME \
+    ((MESH_MSG_DATA_SIZE - 2) / (int)sizeof(replica_node_t))
+#define REPLICA_OUTPUTS_PER_FRAME \
+    ((MESH_MSG_DATA_SIZE - 2) / (int)sizeof(replica_output_t))
+#define REPLICA_CHUNK_SIZE \
+    (MESH_MSG_DATA_SIZE - 1 - (int)sizeof(replica_config_hdr_t))
+
+// What the standby still has to receive, one bit per item.
+#define ITEM_REGISTRY 0
+#define ITEM_OUTPUTS 1
+#define ITEM_CONFIG(kind) (2 + (kind))
+#define ITEM_NONE (-1)
+#define DIRTY(item) (1u << (item))
+#define DIRTY_ALL (DIRTY(ITEM_CONFIG(REPLICA_CFG_COUNT)) - 1)
+
+/** @brief A configuration command as received on /switch/cmd/root. */
+typedef struct {
+    char* json;
+    uint16_t len;
+} replica_blob_t;
+
+/** @brief A configuration command still arriving in chunks. */
+typedef struct {
+    char* buf;
+    uint16_t total;
+    uint16_t received;
+} replica_partial_t;
+
+/** @brief Buffers only a root or a node with a root role allocates. */
+typedef struct {
+    replica_output_t outputs[MAX_NODES];  // root state or its replica
+    replica_node_t nodes[MAX_NODES];      // replicated registry
+    // Scratch for standby_poll(), only ever run by standby_task().
+    uint64_t ids[MAX_NODES];
+    mesh_addr_t addrs[MAX_NODES];
+    replica_node_t registry[MAX_NODES];  // registry item being sent
+    mesh_app_msg_t batch[REPLICA_FRAMES_PER_POLL];
+    replica_node_t takeover[MAX_NODES];   // take_over()
+    replica_output_t publish[MAX_NODES];  // standby_on_mqtt_connected()
+} standby_buf_t;
+
+static SemaphoreHandle_t s_mutex = NULL;
+static SemaphoreHandle_t s_wake = NULL;  // wakes standby_task() early
+static uint8_t s_role = ROOT_ROLE_NONE;
+static standby_buf_t* s_buf = NULL;  // set once by standby_start()
+
+// Root state: held by the root, or replicated to the standby.
+static replica_blob_t s_config[REPLICA_CFG_COUNT];
+static int s_output_count = 0;
+
+// Standby side.
+static int s_node_count = 0;
+static replica_partial_t s_partial[REPLICA_CFG_COUNT];
+static int64_t s_updated_ms = 0;
+static bool s_was_root = false;
+static bool s_takeover = false;         // new root: replica not applied yet
+static bool s_publish_outputs = false;  // new root: cache not published yet
+
+// Root side.
+static uint64_t s_target_id = 0;
+static mesh_addr_t s_target_addr;
+static uint8_t s_target_role = ROOT_ROLE_NONE;
+static bool s_repick = false;    // registry changed, pick again
+static int64_t s_picked_ms = 0;  // last pick
+static uint8_t s_dirty = 0;
+static int s_item = ITEM_NONE;   // item being sent
+static int s_item_pos = 0;       // entries or bytes of it framed so far
+static int64_t s_synced_ms = 0;  // target got everything, 0 = not yet
+static int64_t s_resync_ms = 0;  // last full copy
+static int64_t s_waived_ms = 0;  // last handover attempt, 0 = none
+static int s_registry_count = 0;  // entries in s_buf->registry
+
+static void standby_task(void* arg);
+
+static int64_t now_ms(void) { return esp_timer_get_time() / 1000; }
+
+static bool standby_lock(void) {
+    if (s_mutex == NULL) return false;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+        ESP_LOGE(TAG, "standby mutex timeout");
+        return false;
+    }
+    return true;
+}
+
+static void standby_unlock(void) { xSemaphoreGive(s_mutex); }
+
+static const char* config_name(int kind) {
+    switch (kind) {
+        case REPLICA_CFG_CONNECTIONS:
+            return "connections";
+        case REPLICA_CFG_BUTTON_TYPES:
+            return "button_types";
+        case REPLICA_CFG_BLIND_PAIRS:
+            return "blind_pairs";
+        default:
+            return "unknown";
+    }
+}
+
+// ====================
+// Role
+// ====================
+
+/**
+ * @brief Allocate the replica buffers and start standby_task() on the first
+ *        call.  Nodes that never get a role or become root skip both.
+ * @return false if the buffers or the task could not be created.
+ */
+static bool standby_start(void) {
+    if (!standby_lock()) return false;
+    bool ok = s_buf != NULL;
+    if (!ok) {
+        s_buf = calloc(1, sizeof(standby_buf_t));
+        if (s_buf == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate standby buffers (%d bytes)",
+                     (int)sizeof(standby_buf_t));
+        } else if (xTaskCreate(standby_task, "standby", 6144, NULL, 2,
+                               NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start the standby task");
+            free(s_buf);
+            s_buf = NULL;
+        } else {
+            ok = true;
+        }
+    }
+    standby_unlock();
+    return ok;
+}
+
+/** @brief Run standby_poll() now instead of at its next deadline. */
+static void standby_wake(void) {
+    if (s_wake) xSemaphoreGive(s_wake);
+}
+
+void standby_init(void) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open("domator", NVS_READONLY, &nvs_handle) == ESP_OK) {
+        uint8_t role = ROOT_ROLE_NONE;
+        if (nvs_get_u8(nvs_handle, NVS_ROOT_ROLE_KEY, &role) == ESP_OK &&
+            role <= ROOT_ROLE_PREFERRED) {
+            s_role = role;
+        }
+        nvs_close(nvs_handle);
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    s_wake = xSemaphoreCreateBinary();
+    if (s_mutex == NULL || s_wake == NULL) {
+        ESP_LOGE(TAG, "Failed to create standby semaphores");
+        return;
+    }
+
+    if (s_role != ROOT_ROLE_NONE) {
+        ESP_LOGI(TAG, "Root role: %s", standby_role_name(s_role));
+        standby_start();
+    }
+}
+
+uint8_t standby_role(void) { return s_role; }
+
+const char* standby_role_name(uint8_t role) {
+    switch (role) {
+        case ROOT_ROLE_NONE:
+            return "none";
+        case ROOT_ROLE_STANDBY:
+            return "standby";
+        case ROOT_ROLE_PREFERRED:
+            return "preferred";
+        default:
+            return "unknown";
+    }
+}
+
+bool standby_parse_role(const char* name, uint8_t* role) {
+    for (uint8_t r = ROOT_ROLE_NONE; r <= ROOT_ROLE_PREFERRED; r++) {
+        if (strcmp(name, standby_role_name(r)) == 0) {
+            *role = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+void standby_set_role(uint8_t role) {
+    if (role > ROOT_ROLE_PREFERRED) {
+        ESP_LOGW(TAG, "Ignoring invalid root role %u", role);
+        return;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open("domator", NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS for the root role: %s",
+                 esp_err_to_name(err));
+        return;
+    }
+    err = nvs_set_u8(nvs_handle, NVS_ROOT_ROLE_KEY, role);
+    if (err == ESP_OK) err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save the root role: %s",
+                 esp_err_to_name(err));
+        return;
+    }
+
+    s_role = role;
+    ESP_LOGI(TAG, "Root role set to %s", standby_role_name(role));
+    if (role != ROOT_ROLE_NONE) standby_start();
+    standby_wake();  // a root may now be outranked by its standby
+    if (!g_is_root && g_mesh_connected) mesh_send_type_info();
+}
+
+// ====================
+// Root Side
+// ====================
+
+/** @brief Freeze the registry for the registry item.  Caller holds s_mutex. */
+static void snapshot_registry(void) {
+    int count = root_registry_snapshot(s_buf->ids, s_buf->addrs, MAX_NODES);
+    for (int i = 0; i < count; i++) {
+        s_buf->registry[i].device_id = s_buf->ids[i];
+        memcpy(s_buf->registry[i].mesh_addr, s_buf->addrs[i].addr, 6);
+        s_buf->registry[i].type = root_registry_type(s_buf->ids[i]);
+        s_buf->registry[i].role = root_registry_role(s_buf->ids[i]);
+    }
+    s_registry_count = count;
+}
+
+/**
+ * @brief Frame the next piece of the dirty state into @p msg, starting the
+ *        next dirty item when the current one is done.  Caller holds
+ *        s_mutex.
+ * @param item Set to the item the frame belongs to.
+ * @return false if nothing is left to send.
+ */
+static bool frame_next(mesh_app_msg_t* msg, int* item) {
+    while (true) {
+        if (s_item == ITEM_NONE) {
+            if (s_dirty == 0) return false;
+            s_item = __builtin_ctz(s_dirty);
+            s_item_pos = 0;
+            s_dirty &= ~DIRTY(s_item);
+            if (s_item == ITEM_REGISTRY) snapshot_registry();
+        }
+
+        memset(msg, 0, sizeof(*msg));
+        msg->src_id = g_device_id;
+        msg->msg_type = MSG_TYPE_REPLICA;
+        *item = s_item;
+        int remaining;
+        if (s_item == ITEM_REGISTRY) {
+            remaining = s_registry_count - s_item_pos;
+            int n = remaining < REPLICA_NODES_PER_FRAME
+                        ? remaining
+                        : REPLICA_NODES_PER_FRAME;
+            if (n > 0) {
+                msg->data[0] = REPLICA_OP_REGISTRY;
+                msg->data[1] = (char)n;
+                memcpy(&msg->data[2], &s_buf->registry[s_item_pos],
+                       n * sizeof(replica_node_t));
+                msg->data_len = 2 + n * sizeof(replica_node_t);
+                s_item_pos += n;
+            }
+            remaining -= n;
+        } else if (s_item == ITEM_OUTPUTS) {
+            remaining = s_output_count - s_item_pos;
+            int n = remaining < REPLICA_OUTPUTS_PER_FRAME
+                        ? remaining
+                        : REPLICA_OUTPUTS_PER_FRAME;
+            if (n > 0) {
+                msg->data[0] = REPLICA_OP_OUTPUTS;
+                msg->data[1] = (char)n;
+                memcpy(&msg->data[2], &s_buf->outputs[s_item_pos],
+                       n * sizeof(replica_output_t));
+                msg->data_len = 2 + n * sizeof(replica_output_t);
+                s_item_pos += n;
+            }
+            remaining -= n;
+        } else {
+            int kind = s_item - ITEM_CONFIG(0);
+            const replica_blob_t* config = &s_config[kind];
+            remaining = config->json ? config->len - s_item_pos : 0;
+            int n = remaining < REPLICA_CHUNK_SIZE ? remaining
+                                                   : REPLICA_CHUNK_SIZE;
+            if (n > 0) {
+                replica_config_hdr_t hdr = {
+                    .kind = (uint8_t)kind,
+                    .total = config->len,
+                    .offset = (uint16_t)s_item_pos,
+                };
+                msg->data[0] = REPLICA_OP_CONFIG;
+                memcpy(&msg->data[1], &hdr, sizeof(hdr));
+                memcpy(&msg->data[1 + sizeof(hdr)], config->json + s_item_pos,
+                       n);
+                msg->data_len = 1 + sizeof(hdr) + n;
+                s_item_pos += n;
+            }
+            remaining -= n;
+        }
+
+        if (remaining <= 0) s_item = ITEM_NONE;
+        if (msg->data_len > 0) return true;
+    }
+}
+
+/**
+ * @brief Queue up to REPLICA_FRAMES_PER_POLL frames to the standby.  Frames
+ *        are built under s_mutex and queued after it is released; an item
+ *        whose frame could not be queued is sent again from the start.
+ */
+static void send_some(const mesh_addr_t* to) {
+    int items[REPLICA_FRAMES_PER_POLL];
+    int count = 0;
+    if (!standby_lock()) return;
+    while (count < REPLICA_FRAMES_PER_POLL &&
+           frame_next(&s_buf->batch[count], &items[count])) {
+        count++;
+    }
+    standby_unlock();
+
+    mesh_addr_t dest = *to;
+    int sent = 0;
+    while (sent < count &&
+           mesh_queue_to_node(&s_buf->batch[sent], TX_PRIO_NORMAL, &dest)) {
+        sent++;
+    }
+    if (sent == count) return;
+
+    if (!standby_lock()) return;
+    for (int i = sent; i < count; i++) {
+        s_dirty |= DIRTY(items[i]);
+        if (s_item == items[i]) s_item = ITEM_NONE;
+    }
+    standby_unlock();
+}
+
+/**
+ * @brief Best-ranked registered node other than this one.
+ * @return Its device ID, or 0 if no node has a root role.
+ */
+static uint64_t pick_target(mesh_addr_t* addr, uint8_t* role) {
+    int count = root_registry_snapshot(s_buf->ids, s_buf->addrs, MAX_NODES);
+    uint64_t best_id = 0;
+    uint8_t best_role = ROOT_ROLE_NONE;
+    for (int i = 0; i < count; i++) {
+        if (s_buf->ids[i] == g_device_id) continue;
+        uint8_t r = root_registry_role(s_buf->ids[i]);
+        if (r > best_role) {
+            best_id = s_buf->ids[i];
+            best_role = r;
+            memcpy(addr, &s_buf->addrs[i], sizeof(mesh_addr_t));
+        }
+    }
+    *role = best_role;
+    return best_id;
+}
+
+/** @brief Ask the mesh to make @p to root in place of this node. */
+static void hand_over(const mesh_addr_t* to, uint64_t to_id) {
+    mesh_vote_t vote = {
+        .percentage = MESH_VOTE_PERCENTAGE,
+        .is_rc_specified = true,
+    };
+    memcpy(&vote.config.rc_addr, to, sizeof(mesh_addr_t));
+    esp_err_t err = esp_mesh_waive_root(&vote, MESH_VOTE_REASON_ROOT_INITIATED);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Root handover to %" PRIu64 " failed: %s", to_id,
+                 esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Handing the root over to %" PRIu64, to_id);
+}
+
+/** @brief Pick the standby again.  Caller holds s_mutex. */
+static void repick(int64_t now) {
+    mesh_addr_t addr = {0};
+    uint8_t role = ROOT_ROLE_NONE;
+    uint64_t target = pick_target(&addr, &role);
+    s_repick = false;
+    s_picked_ms = now;
+    s_target_addr = addr;
+    s_target_role = role;
+    if (target == s_target_id) return;
+
+    s_target_id = target;
+    s_synced_ms = 0;
+    s_waived_ms = 0;
+    s_resync_ms = now;
+    s_dirty = target ? DIRTY_ALL : 0;
+    s_item = ITEM_NONE;
+    if (target) {
+        ESP_LOGI(TAG, "Standby is %" PRIu64 " (%s)", target,
+                 standby_role_name(role));
+    } else {
+        ESP_LOGI(TAG, "No standby");
+    }
+}
+
+static void take_over(void);
+
+void standby_poll(void) {
+    if (!g_is_root) return;
+    if (!standby_lock()) return;
+    bool takeover = s_takeover;
+    standby_unlock();
+    if (takeover) take_over();
+
+    if (!standby_lock()) return;
+    int64_t now = now_ms();
+    if (s_repick || now - s_picked_ms >= REPLICA_PICK_MS) repick(now);
+    uint64_t target = s_target_id;
+    mesh_addr_t addr = s_target_addr;
+    if (target && now - s_resync_ms >= REPLICA_RESYNC_MS) {
+        s_resync_ms = now;
+        s_dirty = DIRTY_ALL;
+    }
+    bool pending = s_dirty != 0 || s_item != ITEM_NONE;
+    standby_unlock();
+    if (target == 0) return;
+
+    // Button commands first: replication waits while the TX queue is busy.
+    if (pending && mesh_tx_queue_depth() <= REPLICA_TX_BACKLOG) {
+        send_some(&addr);
+    }
+
+    if (!standby_lock()) return;
+    if (s_synced_ms == 0 && s_target_id == target && s_dirty == 0 &&
+        s_item == ITEM_NONE) {
+        s_synced_ms = now;
+        ESP_LOGI(TAG, "Standby %" PRIu64 " is in sync", target);
+    }
+    bool handover =
+        s_synced_ms != 0 && s_target_role > s_role &&
+        now - s_synced_ms >= ROOT_HANDOVER_DELAY_MS &&
+        (s_waived_ms == 0 || now - s_waived_ms >= ROOT_HANDOVER_RETRY_MS);
+    if (handover) s_waived_ms = now;
+    standby_unlock();
+
+    if (handover) hand_over(&addr, target);
+}
+
+/**
+ * @brief How long standby_task() can sleep before standby_poll() has work:
+ *        REPLICA_POLL_MS while frames are pending, the next repick, resync
+ *        or handover deadline otherwise, and forever on a node that is not
+ *        root.
+ */
+static TickType_t next_wait(void) {
+    if (!g_is_root) return portMAX_DELAY;
+    if (!standby_lock()) return pdMS_TO_TICKS(REPLICA_POLL_MS);
+    int64_t now = now_ms();
+    int64_t due = INT64_MAX;
+    if (s_takeover || s_repick || s_dirty != 0 || s_item != ITEM_NONE ||
+        (s_target_id != 0 && s_synced_ms == 0)) {
+        due = now + REPLICA_POLL_MS;
+    } else if (s_target_id != 0) {
+        due = s_picked_ms + REPLICA_PICK_MS;
+        if (s_resync_ms + REPLICA_RESYNC_MS < due) {
+            due = s_resync_ms + REPLICA_RESYNC_MS;
+        }
+        if (s_target_role > s_role) {
+            int64_t handover = s_synced_ms + ROOT_HANDOVER_DELAY_MS;
+            if (s_waived_ms != 0 &&
+                s_waived_ms + ROOT_HANDOVER_RETRY_MS > handover) {
+                handover = s_waived_ms + ROOT_HANDOVER_RETRY_MS;
+            }
+            if (handover < due) due = handover;
+        }
+    }
+    standby_unlock();
+    if (due == INT64_MAX) return portMAX_DELAY;
+    return due > now ? pdMS_TO_TICKS(due - now) : 0;
+}
+
+static void standby_task(void* arg) {
+    const TickType_t spacing = pdMS_TO_TICKS(REPLICA_POLL_MS);
+    TickType_t last = xTaskGetTickCount() - spacing;
+    while (true) {
+        xSemaphoreTake(s_wake, next_wait());
+        // An early wakeup still keeps REPLICA_POLL_MS between polls.
+        TickType_t since = xTaskGetTickCount() - last;
+        if (since < spacing) vTaskDelay(spacing - since);
+        last = xTaskGetTickCount();
+        if (!g_ota_in_progress) standby_poll();
+    }
+}
+
+void standby_node_joined(void) {
+    if (!standby_lock()) return;
+    s_repick = true;
+    if (s_target_id != 0) s_dirty |= DIRTY(ITEM_REGISTRY);
+    standby_unlock();
+    standby_wake();
+}
+
+void standby_config_applied(replica_config_t kind, const char* json,
+                            int len) {
+    if (kind >= REPLICA_CFG_COUNT || len <= 0 || len > UINT16_MAX) return;
+    char* copy = malloc(len);
+    if (copy == NULL) {
+        ESP_LOGE(TAG, "OOM keeping %s for the standby", config_name(kind));
+        return;
+    }
+    memcpy(copy, json, len);
+
+    if (!standby_lock()) {
+        free(copy);
+        return;
+    }
+    free(s_config[kind].json);
+    s_config[kind].json = copy;
+    s_config[kind].len = (uint16_t)len;
+    if (s_target_id != 0) {
+        // A copy half sent is stale; the standby restarts at offset 0.
+        if (s_item == ITEM_CONFIG(kind)) s_item = ITEM_NONE;
+        s_dirty |= DIRTY(ITEM_CONFIG(kind));
+    }
+    bool wake = s_target_id != 0;
+    standby_unlock();
+    if (wake) standby_wake();
+}
+
+void standby_output_changed(uint64_t device_id, char relay, char state) {
+    int index = relay - 'A';
+    if (index < 0 || index >= 16) return;
+    uint16_t bit = 1u << index;
+    bool on = state == '1';
+
+    if (!standby_lock()) return;
+    if (s_buf == NULL) {
+        standby_unlock();
+        return;
+    }
+    int slot = 0;
+    while (slot < s_output_count &&
+           s_buf->outputs[slot].device_id != device_id) {
+        slot++;
+    }
+    if (slot == MAX_NODES) {
+        standby_unlock();
+        return;
+    }
+    if (slot == s_output_count) {
+        s_buf->outputs[slot] = (replica_output_t){.device_id = device_id};
+        s_output_count++;
+    }
+
+    replica_output_t* out = &s_buf->outputs[slot];
+    bool changed = !(out->known & bit) || ((out->on & bit) != 0) != on;
+    out->known |= bit;
+    if (on) {
+        out->on |= bit;
+    } else {
+        out->on &= ~bit;
+    }
+    bool wake = changed && s_target_id != 0;
+    if (wake) s_dirty |= DIRTY(ITEM_OUTPUTS);
+    standby_unlock();
+    if (wake) standby_wake();
+}
+
+// ====================
+// Standby Side
+// ====================
+
+/** @brief Merge replicated registry entries.  Caller holds s_mutex. */
+static void store_nodes(const mesh_app_msg_t* msg) {
+    int count = msg->data_len >= 2 ? (uint8_t)msg->data[1] : 0;
+    if (msg->data_len < 2 + count * sizeof(replica_node_t)) {
+        ESP_LOGW(TAG, "Truncated registry replica");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        replica_node_t node;
+        memcpy(&node, &msg->data[2 + i * sizeof(node)], sizeof(node));
+        int slot = 0;
+        while (slot < s_node_count &&
+               s_buf->nodes[slot].device_id != node.device_id) {
+            slot++;
+        }
+        if (slot == MAX_NODES) break;
+        if (slot == s_node_count) s_node_count++;
+        s_buf->nodes[slot] = node;
+    }
+}
+
+/** @brief Merge replicated relay outputs.  Caller holds s_mutex. */
+static void store_outputs(const mesh_app_msg_t* msg) {
+    int count = msg->data_len >= 2 ? (uint8_t)msg->data[1] : 0;
+    if (msg->data_len < 2 + count * sizeof(replica_output_t)) {
+        ESP_LOGW(TAG, "Truncated output replica");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        replica_output_t out;
+        memcpy(&out, &msg->data[2 + i * sizeof(out)], sizeof(out));
+        int slot = 0;
+        while (slot < s_output_count &&
+               s_buf->outputs[slot].device_id != out.device_id) {
+            slot++;
+        }
+        if (slot == MAX_NODES) break;
+        if (slot == s_output_count) s_output_count++;
+        s_buf->outputs[slot] = out;
+    }
+}
+
+/**
+ * @brief Add one chunk of a configuration command; the command replaces
+ *        the stored one once complete.  A chunk out of order drops the
+ *        partial copy until the root starts the next one.  Caller holds
+ *        s_mutex.
+ */
+static void store_config_chunk(const mesh_app_msg_t* msg) {
+    replica_config_hdr_t hdr;
+    if (msg->data_len < 1 + sizeof(hdr)) {
+        ESP_LOGW(TAG, "Short config replica");
+        return;
+    }
+    memcpy(&hdr, &msg->data[1], sizeof(hdr));
+    if (hdr.kind >= REPLICA_CFG_COUNT || hdr.total == 0) return;
+    uint16_t n = msg->data_len - 1 - sizeof(hdr);
+
+    replica_partial_t* p = &s_partial[hdr.kind];
+    if (hdr.offset == 0) {
+        free(p->buf);
+        p->buf = malloc(hdr.total);
+        p->total = hdr.total;
+        p->received = 0;
+        if (p->buf == NULL) {
+            ESP_LOGE(TAG, "OOM receiving %s", config_name(hdr.kind));
+            return;
+        }
+    }
+    if (p->buf == NULL || hdr.total != p->total ||
+        hdr.offset != p->received || n > p->total - p->received) {
+        ESP_LOGW(TAG, "%s replica out of order, waiting for the next copy",
+                 config_name(hdr.kind));
+        free(p->buf);
+        p->buf = NULL;
+        return;
+    }
+    memcpy(p->buf + p->received, &msg->data[1 + sizeof(hdr)], n);
+    p->received += n;
+    if (p->received < p->total) return;
+
+    free(s_config[hdr.kind].json);
+    s_config[hdr.kind].json = p->buf;
+    s_config[hdr.kind].len = p->total;
+    p->buf = NULL;
+    ESP_LOGI(TAG, "Replicated %s (%u bytes)", config_name(hdr.kind),
+             p->total);
+}
+
+void standby_handle_replica(const mesh_app_msg_t* msg) {
+    if (msg->data_len < 1) return;
+    if (!standby_lock()) return;
+    if (s_buf == NULL) {
+        // No role here yet; the root sends everything again on resync.
+        standby_unlock();
+        return;
+    }
+    switch (msg->data[0]) {
+        case REPLICA_OP_REGISTRY:
+            store_nodes(msg);
+            break;
+        case REPLICA_OP_CONFIG:
+            store_config_chunk(msg);
+            break;
+        case REPLICA_OP_OUTPUTS:
+            store_outputs(msg);
+            break;
+        default:
+            ESP_LOGW(TAG, "Unknown replica op '%c'", msg->data[0]);
+            break;
+    }
+    s_updated_ms = now_ms();
+    standby_unlock();
+}
+
+// ====================
+// Takeover
+// ====================
+
+void standby_on_root_start(void) {
+    if (!standby_start()) return;
+    if (!standby_lock()) return;
+    s_was_root = true;
+    s_takeover = true;
+    s_publish_outputs = s_output_count > 0;
+    s_target_id = 0;
+    s_dirty = 0;
+    s_item = ITEM_NONE;
+    standby_unlock();
+    // The replay parses JSON: leave it to standby_task(), not the event task.
+    standby_wake();
+}
+
+/** @brief Load the replicated registry and replay the configuration. */
+static void take_over(void) {
+    replica_node_t* nodes = s_buf->takeover;
+    replica_blob_t configs[REPLICA_CFG_COUNT];
+
+    if (!standby_lock()) return;
+    s_takeover = false;
+    int node_count = s_node_count;
+    memcpy(nodes, s_buf->nodes, node_count * sizeof(nodes[0]));
+    s_node_count = 0;
+    // Replaying a command stores it again (standby_config_applied()).
+    memcpy(configs, s_config, sizeof(configs));
+    memset(s_config, 0, sizeof(s_config));
+    for (int kind = 0; kind < REPLICA_CFG_COUNT; kind++) {
+        free(s_partial[kind].buf);
+        s_partial[kind].buf = NULL;
+    }
+    int output_count = s_output_count;
+    standby_unlock();
+
+    for (int i = 0; i < node_count; i++) {
+        if (nodes[i].device_id != g_device_id) root_registry_restore(&nodes[i]);
+    }
+    int config_count = 0;
+    for (int kind = 0; kind < REPLICA_CFG_COUNT; kind++) {
+        if (configs[kind].json == NULL) continue;
+        root_apply_config(configs[kind].json, configs[kind].len);
+        free(configs[kind].json);
+        config_count++;
+    }
+
+    if (node_count || config_count || output_count) {
+        ESP_LOGI(TAG,
+                 "Warm takeover: %d node(s), %d configuration(s), %d relay "
+                 "board(s) from the replica",
+                 node_count, config_count, output_count);
+    }
+}
+
+void standby_on_root_stop(void) {
+    if (!standby_lock()) return;
+    if (s_was_root && !s_takeover) {
+        // What this node held as root is stale now; a replica starts empty.
+        for (int kind = 0; kind < REPLICA_CFG_COUNT; kind++) {
+            free(s_config[kind].json);
+            s_config[kind].json = NULL;
+            s_config[kind].len = 0;
+        }
+        s_output_count = 0;
+        s_node_count = 0;
+    }
+    s_was_root = false;
+    s_takeover = false;
+    s_target_id = 0;
+    s_dirty = 0;
+    s_item = ITEM_NONE;
+    s_publish_outputs = false;
+    standby_unlock();
+}
+
+void standby_on_mqtt_connected(void) {
+    if (!standby_lock()) return;
+    int count = s_publish_outputs ? s_output_count : 0;
+    replica_output_t* outputs = s_buf ? s_buf->publish : NULL;
+    if (count > 0) {
+        memcpy(outputs, s_buf->outputs, count * sizeof(outputs[0]));
+    }
+    s_publish_outputs = false;
+    standby_unlock();
+    if (count == 0) return;
+
+    int published = 0;
+    for (int i = 0; i < count; i++) {
+        char topic[64];
+        snprintf(topic, sizeof(topic), "/relay/state/%" PRIu64,
+                 outputs[i].device_id);
+        for (int r = 0; r < 16; r++) {
+            if (!(outputs[i].known & (1u << r))) continue;
+            char payload[3] = {'A' + r, (outputs[i].on & (1u << r)) ? '1' : '0',
+                               '\0'};
+            esp_mqtt_client_publish(g_mqtt_client, topic, payload, 2, 1, 1);
+            published++;
+        }
+    }
+    ESP_LOGI(TAG, "Published %d cached relay output(s)", published);
+}
+
+void standby_get_status(standby_status_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->role = s_role;
+    if (!standby_lock()) return;
+    out->target_id = s_target_id;
+    out->target_role = s_target_role;
+    out->target_synced = s_synced_ms != 0;
+    out->nodes = s_node_count;
+    for (int kind = 0; kind < REPLICA_CFG_COUNT; kind++) {
+        if (s_config[kind].json) out->configs++;
+    }
+    out->outputs = s_output_count;
+    out->updated_ms = s_updated_ms ? (uint32_t)(now_ms() - s_updated_ms) : 0;
+    standby_unlock();
+}
@@ -0,0 +1,385 @@
+/**
+ * @file task_stats.c
+ * @brief Per-task CPU, stack high-watermark and queue-depth telemetry.
+ *
+ * task_stats_sample() is called once per status interval from
+ * status_report_task().  It reads uxTaskGetSystemState() and turns the
+ * run-time counters into a per-task CPU share of one core over the interval
+ * since the previous sample, and keeps each task's stack high-watermark
+ * (lowest free stack ever, in bytes).
+ *
+ * Queues registered with task_stats_register_queue() report their current
+ * depth and the highest depth seen since boot.  Producers call
+ * task_stats_note_queue() right after a successful send so short bursts are
+ * not missed between samples.  The mesh stack's own RX/TX backlog
+ * (esp_mesh_get_rx_pending()/esp_mesh_get_tx_pending()) is sampled as two
+ * extra queues of unknown capacity.
+ *
+ * The last sample is published compactly in the node status (stkMin, cpuTop,
+ * txHwm), in full on /switch/tasks/<id> via the "tasks" root command, and
+ * printed by the shell's "tasks" command.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+
+static const char* TAG = "TASK_STATS";
+
+/** One tracked queue (or mesh stack backlog when handle is NULL). */
+typedef struct {
+    const char* name;
+    QueueHandle_t handle;
+    uint16_t size;
+    uint16_t depth;
+    uint16_t hwm;
+} queue_entry_t;
+
+/** Run-time counter of a task at the previous sample. */
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t runtime;
+} prev_runtime_t;
+
+static portMUX_TYPE s_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static queue_entry_t s_queues[TASK_STATS_MAX_QUEUES];
+static int s_queue_count = 0;
+
+static task_stat_t s_tasks[TASK_STATS_MAX_TASKS];
+static int s_task_count = 0;
+static uint32_t s_interval_ms = 0;
+
+static prev_runtime_t s_prev[TASK_STATS_MAX_TASKS * 2];
+static int s_prev_count = 0;
+static uint32_t s_prev_total = 0;
+static int64_t s_prev_sample_us = 0;
+
+// ====================
+// Queues
+// ====================
+
+/** @brief Find or add a queue slot.  Call with s_stats_mux held. */
+static queue_entry_t* queue_slot(const char* name, QueueHandle_t q) {
+    for (int i = 0; i < s_queue_count; i++) {
+        if ((q != NULL && s_queues[i].handle == q) ||
+            strcmp(s_queues[i].name, name) == 0) {
+            return &s_queues[i];
+        }
+    }
+    if (s_queue_count >= TASK_STATS_MAX_QUEUES) return NULL;
+
+    queue_entry_t* e = &s_queues[s_queue_count++];
+    memset(e, 0, sizeof(*e));
+    e->name = name;
+    e->handle = q;
+    return e;
+}
+
+/**
+ * @brief Start tracking a FreeRTOS queue.
+ * @param name Short name shown in telemetry (must stay valid, e.g. literal).
+ * @param q    Queue handle; NULL is ignored.
+ */
+void task_stats_register_queue(const char* name, QueueHandle_t q) {
+    if (q == NULL) return;
+
+    UBaseType_t waiting = uxQueueMessagesWaiting(q);
+    UBaseType_t size = waiting + uxQueueSpacesAvailable(q);
+
+    portENTER_CRITICAL(&s_stats_mux);
+    queue_entry_t* e = queue_slot(name, q);
+    if (e != NULL) {
+        e->handle = q;
+        e->size = size;
+    }
+    portEXIT_CRITICAL(&s_stats_mux);
+
+    if (e == NULL) {
+        ESP_LOGW(TAG, "No slot left to track queue %s", name);
+    }
+}
+
+/**
+ * @brief Record the current depth of a registered queue if it is a new
+ *        high-watermark.  Cheap enough for every send.
+ */
+void task_stats_note_queue(QueueHandle_t q) {
+    if (q == NULL) return;
+    UBaseType_t depth = uxQueueMessagesWaiting(q);
+
+    portENTER_CRITICAL(&s_stats_mux);
+    for (int i = 0; i < s_queue_count; i++) {
+        if (s_queues[i].handle == q) {
+            if (depth > s_queues[i].hwm) s_queues[i].hwm = depth;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_stats_mux);
+}
+
+/** @brief Update one queue slot with a freshly sampled depth. */
+static void queue_sampled(const char* name, QueueHandle_t q, int depth) {
+    if (depth < 0) depth = 0;
+    if (depth > UINT16_MAX) depth = UINT16_MAX;
+
+    portENTER_CRITICAL(&s_stats_mux);
+    queue_entry_t* e = queue_slot(name, q);
+    if (e != NULL) {
+        e->depth = depth;
+        if (depth > e->hwm) e->hwm = depth;
+    }
+    portEXIT_CRITICAL(&s_stats_mux);
+}
+
+/** @brief Sample every registered queue and the mesh stack backlog. */
+static void sample_queues(void) {
+    for (int i = 0; i < s_queue_count; i++) {
+        QueueHandle_t q = s_queues[i].handle;
+        if (q != NULL) {
+            queue_sampled(s_queues[i].name, q, uxQueueMessagesWaiting(q));
+        }
+    }
+
+    if (!g_mesh_connected) return;
+
+    mesh_rx_pending_t rx = {0};
+    if (esp_mesh_get_rx_pending(&rx) == ESP_OK) {
+        queue_sampled("mesh_rx", NULL, rx.toSelf + rx.toDS);
+    }
+
+    mesh_tx_pending_t tx = {0};
+    if (esp_mesh_get_tx_pending(&tx) == ESP_OK) {
+        queue_sampled("mesh_tx", NULL,
+                      tx.to_parent + tx.to_parent_p2p + tx.to_child +
+                          tx.to_child_p2p + tx.mgmt + tx.broadcast);
+    }
+}
+
+// ====================
+// Tasks
+// ====================
+
+#if configUSE_TRACE_FACILITY
+
+/** @brief Run-time counter of a task at the previous sample, or 0. */
+static uint32_t prev_runtime(TaskHandle_t handle) {
+    for (int i = 0; i < s_prev_count; i++) {
+        if (s_prev[i].handle == handle) return s_prev[i].runtime;
+    }
+    return 0;
+}
+
+/** @brief qsort order: least free stack first. */
+static int compare_stack_free(const void* a, const void* b) {
+    const task_stat_t* ta = a;
+    const task_stat_t* tb = b;
+    return (int)ta->stack_free - (int)tb->stack_free;
+}
+
+/**
+ * @brief Read all tasks and update s_tasks.  When there are more than
+ *        TASK_STATS_MAX_TASKS tasks, the ones with the most free stack are
+ *        left out.
+ */
+static void sample_tasks(void) {
+    UBaseType_t count = uxTaskGetNumberOfTasks();
+    if (count > TASK_STATS_MAX_TASKS * 2) count = TASK_STATS_MAX_TASKS * 2;
+
+    TaskStatus_t* status = malloc(count * sizeof(TaskStatus_t));
+    task_stat_t* out = malloc(count * sizeof(task_stat_t));
+    if (status == NULL || out == NULL) {
+        ESP_LOGW(TAG, "Out of memory sampling %u tasks", (unsigned)count);
+        free(status);
+        free(out);
+        return;
+    }
+
+    uint32_t total = 0;
+    count = uxTaskGetSystemState(status, count, &total);
+    uint32_t total_delta = total - s_prev_total;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskStatus_t* t = &status[i];
+        task_stat_t* o = &out[i];
+
+        strncpy(o->name, t->pcTaskName, sizeof(o->name));
+        o->priority = t->uxCurrentPriority;
+        o->state = t->eCurrentState;
+        o->stack_free = t->usStackHighWaterMark > UINT16_MAX
+                            ? UINT16_MAX
+                            : t->usStackHighWaterMark;
+
+        o->cpu_permille = 0;
+#if configGENERATE_RUN_TIME_STATS
+        if (s_prev_total != 0 && total_delta != 0) {
+            uint32_t delta = t->ulRunTimeCounter - prev_runtime(t->xHandle);
+            uint64_t permille = (uint64_t)delta * 1000 / total_delta;
+            o->cpu_permille = permille > 1000 ? 1000 : permille;
+        }
+#endif
+    }
+
+    s_prev_count = count;
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_prev[i].handle = status[i].xHandle;
+        s_prev[i].runtime = status[i].ulRunTimeCounter;
+    }
+    s_prev_total = total;
+    free(status);
+
+    qsort(out, count, sizeof(task_stat_t), compare_stack_free);
+    if (count > TASK_STATS_MAX_TASKS) count = TASK_STATS_MAX_TASKS;
+
+    portENTER_CRITICAL(&s_stats_mux);
+    memcpy(s_tasks, out, count * sizeof(task_stat_t));
+    s_task_count = count;
+    portEXIT_CRITICAL(&s_stats_mux);
+    free(out);
+}
+
+#endif  // configUSE_TRACE_FACILITY
+
+/**
+ * @brief Take a telemetry sample.  CPU shares cover the time since the
+ *        previous call (nothing on the first call).
+ */
+void task_stats_sample(void) {
+    int64_t now_us = esp_timer_get_time();
+
+#if configUSE_TRACE_FACILITY
+    sample_tasks();
+#endif
+    sample_queues();
+
+    s_interval_ms =
+        s_prev_sample_us ? (uint32_t)((now_us - s_prev_sample_us) / 1000) : 0;
+    s_prev_sample_us = now_us;
+}
+
+// ====================
+// Reporting
+// ====================
+
+/**
+ * @brief Copy the last sample.
+ * @param tasks       TASK_STATS_MAX_TASKS entries, sorted by free stack.
+ * @param queues      TASK_STATS_MAX_QUEUES entries.
+ * @param queue_count Receives the number of queues written.
+ * @param interval_ms Receives the sampling window (0 before two samples).
+ * @return Number of tasks written.
+ */
+int task_stats_snapshot(task_stat_t* tasks, queue_stat_t* queues,
+                        int* queue_count, uint32_t* interval_ms) {
+    portENTER_CRITICAL(&s_stats_mux);
+    int task_count = s_task_count;
+    memcpy(tasks, s_tasks, task_count * sizeof(task_stat_t));
+
+    for (int i = 0; i < s_queue_count; i++) {
+        strncpy(queues[i].name, s_queues[i].name, sizeof(queues[i].name));
+        queues[i].depth = s_queues[i].depth;
+        queues[i].hwm = s_queues[i].hwm;
+        queues[i].size = s_queues[i].size;
+    }
+    *queue_count = s_queue_count;
+    portEXIT_CRITICAL(&s_stats_mux);
+
+    *interval_ms = s_interval_ms;
+    return task_count;
+}
+
+/**
+ * @brief List registered queues that have a FreeRTOS handle (pseudo-queues
+ *        such as "mesh_rx" are skipped).
+ * @return Number of entries written to handles and names.
+ */
+int task_stats_queue_handles(QueueHandle_t* handles, const char** names,
+                             int max) {
+    int n = 0;
+    portENTER_CRITICAL(&s_stats_mux);
+    for (int i = 0; i < s_queue_count && n < max; i++) {
+        if (s_queues[i].handle == NULL) continue;
+        handles[n] = s_queues[i].handle;
+        names[n] = s_queues[i].name;
+        n++;
+    }
+    portEXIT_CRITICAL(&s_stats_mux);
+    return n;
+}
+
+/**
+ * @brief Add the compact status fields:
+ *        "stkMin":"<task>:<free bytes>"   task closest to overflowing,
+ *        "cpuTop":"<task>:<permille>"     busiest non-idle task,
+ *        "txHwm":N                        TX queue high-watermark.
+ */
+void task_stats_add_summary(struct cJSON* json) {
+    static task_stat_t tasks[TASK_STATS_MAX_TASKS];
+    static queue_stat_t queues[TASK_STATS_MAX_QUEUES];
+    int queue_count = 0;
+    uint32_t interval_ms = 0;
+    int task_count =
+        task_stats_snapshot(tasks, queues, &queue_count, &interval_ms);
+
+    char buf[TASK_STATS_NAME_LEN + 8];
+    if (task_count > 0) {
+        // The snapshot is sorted by free stack.
+        snprintf(buf, sizeof(buf), "%.*s:%u", TASK_STATS_NAME_LEN,
+                 tasks[0].name, tasks[0].stack_free);
+        cJSON_AddStringToObject(json, "stkMin", buf);
+    }
+
+    const task_stat_t* top = NULL;
+    for (int i = 0; i < task_count; i++) {
+        if (strncmp(tasks[i].name, "IDLE", 4) == 0) continue;
+        if (top == NULL || tasks[i].cpu_permille > top->cpu_permille) {
+            top = &tasks[i];
+        }
+    }
+    if (top != NULL && interval_ms > 0) {
+        snprintf(buf, sizeof(buf), "%.*s:%u", TASK_STATS_NAME_LEN, top->name,
+                 top->cpu_permille);
+        cJSON_AddStringToObject(json, "cpuTop", buf);
+    }
+
+    for (int i = 0; i < queue_count; i++) {
+        if (strncmp(queues[i].name, "tx", sizeof(queues[i].name)) == 0) {
+            cJSON_AddNumberToObject(json, "txHwm", queues[i].hwm);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Fill msg (src_id, type, data) with the last sample:
+ *        task_stats_hdr_t, task_count task_stat_t, queue_count queue_stat_t.
+ */
+void task_stats_build_msg(mesh_app_msg_t* msg) {
+    static task_stat_t tasks[TASK_STATS_MAX_TASKS];
+    static queue_stat_t queues[TASK_STATS_MAX_QUEUES];
+    int queue_count = 0;
+    uint32_t interval_ms = 0;
+    int task_count =
+        task_stats_snapshot(tasks, queues, &queue_count, &interval_ms);
+
+    task_stats_hdr_t hdr = {
+        .task_count = task_count,
+        .queue_count = queue_count,
+        .interval_ms = interval_ms,
+    };
+
+    memset(msg, 0, sizeof(*msg));
+    msg->src_id = g_device_id;
+    msg->msg_type = MSG_TYPE_TASK_STATS;
+
+    uint8_t* p = (uint8_t*)msg->data;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, tasks, task_count * sizeof(task_stat_t));
+    p += task_count * sizeof(task_stat_t);
+    memcpy(p, queues, queue_count * sizeof(queue_stat_t));
+    p += queue_count * sizeof(queue_stat_t);
+    msg->data_len = p - (uint8_t*)msg->data;
+}
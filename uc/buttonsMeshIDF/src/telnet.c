@@ -1,15 +1,26 @@
 /**
  * @file telnet.c
- * @brief Minimal Telnet server and dual UART/Telnet log mirror.
+ * @brief Multi-client Telnet log server on top of the lock-free log ring.
  *
  * When the root node gains an IP address, telnet_start() is called to:
- *  - Install dual_log_vprintf() as the ESP-IDF log backend so every log line
- *    is written to both UART and the active Telnet socket.
- *  - Launch telnet_task() which listens on TCP port 23, accepts one client
- *    at a time, and echoes received data back to the client.
+ *  - Allocate the log ring (log_ring.c) and install dual_log_vprintf() as the
+ *    ESP-IDF log backend.  Logging tasks only format the line and copy it
+ *    into the ring; they never take a lock or touch a socket.
+ *  - Launch telnet_task(), the single consumer that drains the ring to UART
+ *    and to up to TELNET_MAX_CLIENTS Telnet clients on TCP port 23.
  *
- * telnet_stop() (called when the node loses root status) tears down the
- * server socket, deletes the task, and restores the default log handler.
+ * Every client has its own ring cursor and send buffer.  Sends are
+ * non-blocking: a slow client keeps its unsent bytes and is simply lapped by
+ * the ring, after which it is told how many chunks it missed.
+ *
+ * Lines typed by a client are handed to the console shell (shell.c), which
+ * runs the command in its own low-priority task.  Command output comes back
+ * through a per-client stream buffer and is sent ahead of pending log data;
+ * "logs off" pauses the log stream for that client.
+ *
+ * telnet_stop() (called when the node loses root status) asks the task to
+ * close all sockets, flush the ring to UART, restore the default log handler
+ * and exit.
  */
 
 #include <errno.h>
@@ -20,209 +31,435 @@
 #include <sys/socket.h>
 
 #include "domator_mesh.h"
-#include "esp_console.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
-#include "linenoise/linenoise.h"
+#include "freertos/stream_buffer.h"
 #include "lwip/sockets.h"
 
 #define TELNET_PORT 23
 #define RX_BUF_SIZE 256
+#define TELNET_TX_BUF_SIZE (4 * LOG_RING_SLOT_TEXT)
+#define LOG_LINE_BUFS 2  // lines formatted at once in full, see below
 
 static const char* TAG = "TELNET";
 
-int telnet_sock = -1;
-
-static SemaphoreHandle_t log_mutex;
+/** One connected Telnet client. */
+typedef struct {
+    int sock;
+    uint32_t cursor;          // next log ring ticket to send
+    uint32_t dropped;         // ring chunks lost since last notice
+    uint32_t dropped_total;   // ring chunks lost since connect
+    size_t tx_len;            // pending bytes in tx_buf
+    size_t tx_off;            // bytes of tx_buf already sent
+    bool logs_enabled;        // stream the log ring to this client
+    uint8_t iac_skip;         // bytes left of a Telnet IAC sequence
+    size_t line_len;
+    char line[SHELL_LINE_MAX];
+    char tx_buf[TELNET_TX_BUF_SIZE];
+} telnet_client_t;
+
+static telnet_client_t s_clients[TELNET_MAX_CLIENTS];
+static StreamBufferHandle_t s_shell_out[TELNET_MAX_CLIENTS];
+static int s_listen_sock = -1;
+static uint32_t s_uart_cursor = 0;
+static volatile bool s_stop_requested = false;
 static int (*prev_log_vprintf)(const char* fmt, va_list args) = NULL;
+static char (*s_line_bufs)[LOG_LINE_MAX] = NULL;  // LOG_LINE_BUFS lines
+static uint32_t s_line_bufs_busy = 0;  // bit per s_line_bufs entry
 
 // ====================
 // Telnet Lifecycle
 // ====================
 
 /**
- * @brief Start the Telnet server task and enable dual UART/Telnet logging.
+ * @brief Start the Telnet server task and route logging through the ring.
  *        Idempotent: does nothing if telnet_task_handle is already set.
- *        Creates the log mutex on first invocation.
  */
 void telnet_start(void) {
     if (telnet_task_handle != NULL) return;
 
-    if (log_mutex == NULL) {
-        log_mutex = xSemaphoreCreateMutex();
+    if (log_ring_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Log ring unavailable, Telnet not started");
+        return;
+    }
+    if (s_line_bufs == NULL) {
+        s_line_bufs =
+            heap_tag_calloc(HEAP_TAG_TELNET, LOG_LINE_BUFS, LOG_LINE_MAX);
+        if (s_line_bufs == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate log line buffers");
+            return;
+        }
     }
 
+    for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+        if (s_shell_out[i] != NULL) continue;
+        s_shell_out[i] = xStreamBufferCreate(SHELL_OUTPUT_BUF_SIZE, 1);
+        if (s_shell_out[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate shell output buffer");
+            return;
+        }
+        heap_tag_account(HEAP_TAG_TELNET, SHELL_OUTPUT_BUF_SIZE);
+    }
+    shell_init();
+
+    s_stop_requested = false;
+    s_uart_cursor = log_ring_head_cursor();
     prev_log_vprintf = esp_log_set_vprintf(dual_log_vprintf);
 
-    xTaskCreate(telnet_task, "telnet", 8192, NULL, 5, &telnet_task_handle);
+    xTaskCreate(telnet_task, "telnet", 6144, NULL, 3, &telnet_task_handle);
 }
 
 /**
- * @brief Stop the Telnet server, close the active socket, delete the task,
- *        and restore the previous log vprintf handler.
+ * @brief Stop the Telnet server.  The task closes every socket, flushes the
+ *        remaining log data to UART, restores the previous vprintf handler
+ *        and deletes itself; this waits up to one second for that.
  */
 void telnet_stop(void) {
-    if (telnet_task_handle != NULL) {
-        if (telnet_sock >= 0) {
-            ESP_LOGI(TAG, "Closing Telnet socket");
-            close(telnet_sock);
-            telnet_sock = -1;
-        }
+    if (telnet_task_handle == NULL) return;
+
+    s_stop_requested = true;
+    for (int i = 0; i < 50 && telnet_task_handle != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
 
+    if (telnet_task_handle != NULL) {
+        ESP_LOGW(TAG, "Telnet task did not stop, deleting it");
         if (prev_log_vprintf != NULL) {
             esp_log_set_vprintf(prev_log_vprintf);
             prev_log_vprintf = NULL;
         }
-
         vTaskDelete(telnet_task_handle);
         telnet_task_handle = NULL;
     }
 }
 
 // ====================
-// Telnet Server Task
+// Client Handling
 // ====================
 
+/** @brief Close a client socket and free its slot. */
+static void telnet_client_close(telnet_client_t* client) {
+    if (client->sock >= 0) {
+        close(client->sock);
+    }
+    ESP_LOGI(TAG, "Client disconnected (%" PRIu32 " log chunks dropped)",
+             client->dropped_total);
+    client->sock = -1;
+}
+
+/** @brief Accept a pending connection into a free client slot. */
+static void telnet_accept(void) {
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    int sock = accept(s_listen_sock, (struct sockaddr*)&client_addr, &addr_len);
+    if (sock < 0) return;
+
+    for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+        if (s_clients[i].sock >= 0) continue;
+
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+        telnet_client_t* client = &s_clients[i];
+        memset(client, 0, sizeof(*client));
+        client->sock = sock;
+        client->logs_enabled = true;
+        // Replay what is still in the ring so the client gets context.
+        client->cursor = log_ring_oldest_cursor();
+        xStreamBufferReset(s_shell_out[i]);
+        ESP_LOGI(TAG, "Client %d connected from %s", i,
+                 inet_ntoa(client_addr.sin_addr));
+
+        const char* banner = "Domator shell - type 'help'\r\n> ";
+        xStreamBufferSend(s_shell_out[i], banner, strlen(banner), 0);
+        return;
+    }
+
+    const char* busy = "Too many Telnet clients\r\n";
+    send(sock, busy, strlen(busy), MSG_DONTWAIT);
+    close(sock);
+    ESP_LOGW(TAG, "Rejected client: %d already connected", TELNET_MAX_CLIENTS);
+}
+
 /**
- * @brief FreeRTOS task: run the Telnet TCP server loop.
- *
- * Binds to INADDR_ANY:TELNET_PORT, accepts one client at a time, and
- * echoes all received data back ("dumb terminal" mode).  Loops back to
- * accept() after each client disconnects.
+ * @brief Push pending shell output and log data to one client without
+ *        blocking.
+ * @return false if the client must be closed.
  */
-void telnet_task(void* arg) {
-    int listen_sock;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-    char rxbuf[RX_BUF_SIZE];
+static bool telnet_client_flush(int index) {
+    telnet_client_t* client = &s_clients[index];
+    while (1) {
+        if (client->tx_off == client->tx_len) {
+            client->tx_off = client->tx_len = 0;
+
+            // Shell output goes out ahead of log data.
+            client->tx_len = xStreamBufferReceive(
+                s_shell_out[index], client->tx_buf, sizeof(client->tx_buf), 0);
+            if (client->tx_len == 0) {
+                if (!client->logs_enabled) {
+                    client->cursor = log_ring_head_cursor();
+                } else if (client->dropped > 0) {
+                    client->tx_len = snprintf(
+                        client->tx_buf, sizeof(client->tx_buf),
+                        "\r\n[telnet: %" PRIu32 " log chunks dropped]\r\n",
+                        client->dropped);
+                    client->dropped_total += client->dropped;
+                    client->dropped = 0;
+                } else {
+                    client->tx_len =
+                        log_ring_read(&client->cursor, client->tx_buf,
+                                      sizeof(client->tx_buf), &client->dropped);
+                }
+            }
+            if (client->tx_len == 0) return true;
+        }
 
-    listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (listen_sock < 0) {
-        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
-        vTaskDelete(NULL);
-        return;
+        int sent = send(client->sock, client->tx_buf + client->tx_off,
+                        client->tx_len - client->tx_off, MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;  // socket full: keep the rest for later
+            }
+            return false;
+        }
+        client->tx_off += sent;
     }
+}
 
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(TELNET_PORT);
-    server_addr.sin_addr.s_addr = INADDR_ANY;
+/**
+ * @brief Read whatever a client sent, collect it into lines and pass each
+ *        complete line to the shell.  Telnet option negotiation (IAC) is
+ *        skipped.
+ * @return false if the client disconnected.
+ */
+static bool telnet_client_receive(int index) {
+    telnet_client_t* client = &s_clients[index];
+    char rxbuf[RX_BUF_SIZE];
+    int len = recv(client->sock, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+    if (len == 0) return false;
+    if (len < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+
+    for (int i = 0; i < len; i++) {
+        uint8_t c = rxbuf[i];
+        if (client->iac_skip > 0) {
+            client->iac_skip--;
+            continue;
+        }
+        if (c == 0xFF) {  // IAC <command> <option>
+            client->iac_skip = 2;
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            if (client->line_len == 0) continue;
+            client->line[client->line_len] = '\0';
+            client->line_len = 0;
+            if (!shell_submit(index, client->line)) {
+                const char* busy = "Shell busy, try again\r\n> ";
+                xStreamBufferSend(s_shell_out[index], busy, strlen(busy), 0);
+            }
+        } else if (c == 0x08 || c == 0x7F) {  // backspace
+            if (client->line_len > 0) client->line_len--;
+        } else if (c >= 0x20 && client->line_len < SHELL_LINE_MAX - 1) {
+            client->line[client->line_len++] = c;
+        }
+    }
+    return true;
+}
 
-    if (bind(listen_sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) != 0) {
-        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
-        close(listen_sock);
-        vTaskDelete(NULL);
+/**
+ * @brief Queue shell output for a client; telnet_task() sends it before any
+ *        pending log data.  Output for a disconnected client is discarded.
+ * @param client Client slot index.
+ * @param data   Bytes to send.
+ * @param len    Number of bytes.
+ */
+void telnet_client_write(int client, const char* data, size_t len) {
+    if (client < 0 || client >= TELNET_MAX_CLIENTS ||
+        s_shell_out[client] == NULL) {
         return;
     }
 
-    if (listen(listen_sock, 1) != 0) {
-        ESP_LOGE(TAG, "Socket listen failed: errno %d", errno);
-        close(listen_sock);
-        vTaskDelete(NULL);
-        return;
+    while (len > 0 && s_clients[client].sock >= 0) {
+        size_t sent = xStreamBufferSend(s_shell_out[client], data, len,
+                                        pdMS_TO_TICKS(SHELL_OUTPUT_TIMEOUT_MS));
+        if (sent == 0) return;  // client is not reading
+        data += sent;
+        len -= sent;
     }
+}
 
-    ESP_LOGI(TAG, "Telnet server listening on port %d", TELNET_PORT);
+/** @brief Pause or resume log streaming to one client ("logs" command). */
+void telnet_client_set_logs(int client, bool enabled) {
+    if (client < 0 || client >= TELNET_MAX_CLIENTS) return;
+    s_clients[client].logs_enabled = enabled;
+}
 
-    while (1) {
-        telnet_sock =
-            accept(listen_sock, (struct sockaddr*)&client_addr, &addr_len);
+/** @brief Copy any new ring data to UART. */
+static void telnet_drain_uart(void) {
+    char buf[4 * LOG_RING_SLOT_TEXT];
+    uint32_t dropped = 0;
+    size_t len;
+    while ((len = log_ring_read(&s_uart_cursor, buf, sizeof(buf), &dropped)) >
+           0) {
+        fwrite(buf, 1, len, stdout);
+    }
+    if (dropped > 0) {
+        printf("[log: %" PRIu32 " chunks dropped]\n", dropped);
+    }
+}
+
+// ====================
+// Telnet Server Task
+// ====================
+
+/**
+ * @brief FreeRTOS task: drain the log ring and serve Telnet clients.
+ *
+ * Binds to INADDR_ANY:TELNET_PORT and waits in select() for at most
+ * TELNET_DRAIN_INTERVAL_MS, so new log data reaches UART and clients with
+ * that latency while sockets are serviced as soon as they become ready.
+ */
+void telnet_task(void* arg) {
+    struct sockaddr_in server_addr;
 
-        ESP_LOGI(TAG, "Client connected");
+    for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+        s_clients[i].sock = -1;
+    }
+
+    s_listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (s_listen_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+    } else {
+        int reuse = 1;
+        setsockopt(s_listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                   sizeof(reuse));
+
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(TELNET_PORT);
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+
+        if (bind(s_listen_sock, (struct sockaddr*)&server_addr,
+                 sizeof(server_addr)) != 0 ||
+            listen(s_listen_sock, TELNET_MAX_CLIENTS) != 0) {
+            ESP_LOGE(TAG, "Socket bind/listen failed: errno %d", errno);
+            close(s_listen_sock);
+            s_listen_sock = -1;
+        } else {
+            ESP_LOGI(TAG, "Telnet server listening on port %d (max %d clients)",
+                     TELNET_PORT, TELNET_MAX_CLIENTS);
+        }
+    }
 
-        while (1) {
-            int len = recv(telnet_sock, rxbuf, sizeof(rxbuf) - 1, 0);
+    while (!s_stop_requested) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        int max_fd = -1;
 
-            if (len <= 0) break;
+        if (s_listen_sock >= 0) {
+            FD_SET(s_listen_sock, &read_fds);
+            max_fd = s_listen_sock;
+        }
+        for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+            if (s_clients[i].sock < 0) continue;
+            FD_SET(s_clients[i].sock, &read_fds);
+            if (s_clients[i].sock > max_fd) max_fd = s_clients[i].sock;
+        }
 
-            rxbuf[len] = 0;
+        struct timeval timeout = {
+            .tv_sec = 0,
+            .tv_usec = TELNET_DRAIN_INTERVAL_MS * 1000,
+        };
+        int ready = 0;
+        if (max_fd >= 0) {
+            ready = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(TELNET_DRAIN_INTERVAL_MS));
+        }
 
-            printf("%s", rxbuf);               // echo to console/log
-            send(telnet_sock, rxbuf, len, 0);  // echo back
+        if (ready > 0) {
+            if (s_listen_sock >= 0 && FD_ISSET(s_listen_sock, &read_fds)) {
+                telnet_accept();
+            }
+            for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+                telnet_client_t* client = &s_clients[i];
+                if (client->sock >= 0 && FD_ISSET(client->sock, &read_fds) &&
+                    !telnet_client_receive(i)) {
+                    telnet_client_close(client);
+                }
+            }
         }
 
-        close(telnet_sock);
-        telnet_sock = -1;
+        telnet_drain_uart();
+
+        for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+            telnet_client_t* client = &s_clients[i];
+            if (client->sock >= 0 && !telnet_client_flush(i)) {
+                telnet_client_close(client);
+            }
+        }
+    }
 
-        ESP_LOGI(TAG, "Client disconnected");
+    // Shutdown requested by telnet_stop().
+    for (int i = 0; i < TELNET_MAX_CLIENTS; i++) {
+        if (s_clients[i].sock >= 0) telnet_client_close(&s_clients[i]);
+    }
+    if (s_listen_sock >= 0) {
+        close(s_listen_sock);
+        s_listen_sock = -1;
     }
+    if (prev_log_vprintf != NULL) {
+        esp_log_set_vprintf(prev_log_vprintf);
+        prev_log_vprintf = NULL;
+    }
+    telnet_drain_uart();
+
+    telnet_task_handle = NULL;
+    vTaskDelete(NULL);
 }
 
 // ====================
-// Dual Log Handler
+// Log Handler
 // ====================
 
 /**
- * @brief Custom ESP-IDF vprintf log handler that writes to UART and, if a
- *        Telnet client is connected, also to the Telnet socket.
+ * @brief ESP-IDF vprintf log backend: format the line and append it to the
+ *        log ring.  Never blocks and never touches a socket; telnet_task()
+ *        delivers the text to UART and Telnet clients.
  *
- * Uses a small stack buffer for the common case; falls back to a heap
- * allocation for messages that exceed 256 bytes.  Serialised by log_mutex
- * to prevent interleaved output from multiple tasks.
+ * Formats once, without allocating, into one of the LOG_LINE_BUFS buffers
+ * of LOG_LINE_MAX bytes (the longest line the ring keeps) that
+ * telnet_start() allocates; a buffer is claimed with an atomic bit, so
+ * tasks logging at the same time never share one.  When all are in use, or
+ * none are allocated, the line is formatted on the stack and cut at 256
+ * bytes.  Longer lines are truncated either way.
  *
  * @param fmt printf-style format string.
  * @param args Variadic argument list.
  * @return Number of characters written.
  */
 int dual_log_vprintf(const char* fmt, va_list args) {
-    int len = 0;
-    va_list args_copy;
-
     char small_buf[256];
-    va_copy(args_copy, args);
-    len = vsnprintf(small_buf, sizeof(small_buf), fmt, args_copy);
-    va_end(args_copy);
-
-    if (len < 0) return len;
-
-    char* out_buf = NULL;
-    bool used_heap = false;
-
-    if (len >= (int)sizeof(small_buf)) {
-        out_buf = malloc(len + 1);
-        if (out_buf == NULL) {
-            len = sizeof(small_buf) - 1;
-            small_buf[len] = '\0';
-        } else {
-            va_copy(args_copy, args);
-            vsnprintf(out_buf, len + 1, fmt, args_copy);
-            va_end(args_copy);
-            used_heap = true;
-        }
-    }
-
-    if (log_mutex == NULL) {
-        log_mutex = xSemaphoreCreateMutex();
-    }
-
-    if (xSemaphoreTake(log_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        // Fallback: write to UART only
-        if (used_heap) {
-            fwrite(out_buf, 1, len, stdout);
-        } else {
-            fwrite(small_buf, 1, len, stdout);
+    char* buf = small_buf;
+    size_t size = sizeof(small_buf);
+    int claimed = -1;
+
+    for (int i = 0; s_line_bufs != NULL && i < LOG_LINE_BUFS; i++) {
+        uint32_t bit = 1u << i;
+        if (!(__atomic_fetch_or(&s_line_bufs_busy, bit, __ATOMIC_ACQUIRE) &
+              bit)) {
+            claimed = i;
+            buf = s_line_bufs[i];
+            size = LOG_LINE_MAX;
+            break;
         }
-        if (used_heap) free(out_buf);
-        return len;
     }
 
-    if (used_heap) {
-        fwrite(out_buf, 1, len, stdout);
-    } else {
-        fwrite(small_buf, 1, len, stdout);
-    }
+    int len = vsnprintf(buf, size, fmt, args);
+    if (len >= (int)size) len = size - 1;
+    if (len > 0) log_ring_write(buf, len);
 
-    if (telnet_sock >= 0) {
-        if (used_heap) {
-            send(telnet_sock, out_buf, len, MSG_DONTWAIT);
-        } else {
-            send(telnet_sock, small_buf, len, MSG_DONTWAIT);
-        }
+    if (claimed >= 0) {
+        __atomic_fetch_and(&s_line_bufs_busy, ~(1u << claimed),
+                           __ATOMIC_RELEASE);
     }
-
-    xSemaphoreGive(log_mutex);
-
-    if (used_heap) free(out_buf);
-
     return len;
-}
\ No newline at end of file
+}
@@ -0,0 +1,625 @@
+/**
+ * @file time_sync.c
+ * @brief Mesh clock: SNTP on the root, two-way offset/skew estimation for
+ *        every other node.
+ *
+ * The mesh clock is the root's system clock (µs since the Unix epoch; valid
+ * wall time once SNTP has synced).  Every node keeps a disciplined estimate
+ * of it on top of its local esp_timer:
+ *
+ *  1. The root's time_sync_task() polls each registered node in turn, spaced
+ *     TIME_SYNC_POLL_SPACING_MS apart so polls never burst on the air.
+ *  2. POLL   root → node:  t1 = root mesh time, stamped at send.
+ *     REPLY  node → root:  t1, t2 = local receive time, t3 = local send time
+ *                          (stamped in mesh_send_to_node()).
+ *     APPLY  root → node:  offset and round-trip delay computed NTP-style
+ *                          from t1..t4, where t4 is the root receive time.
+ *  3. The node keeps the last TIME_SYNC_SAMPLES samples, anchors its model on
+ *     the one with the lowest round-trip delay, and estimates skew by least
+ *     squares across all of them.
+ *
+ * The model is exposed through mesh_time_now_us(), which also stamps every
+ * outgoing mesh_app_msg_t so one-way latency can be measured across nodes.
+ * The node's system clock is kept on the mesh clock as well (step above
+ * TIME_SYNC_STEP_THRESHOLD_US, adjtime() slew below), so log timestamps
+ * (CONFIG_LOG_TIMESTAMP_SOURCE_SYSTEM) and the relay schedule engine share
+ * the same timeline.  Between samples every node free-runs on its model.
+ *
+ * The root records per-node offset and uncertainty and publishes them on
+ * demand via the "time_sync" root command.
+ */
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "cJSON.h"
+#include "domator_mesh.h"
+#include "esp_sntp.h"
+
+static const char* TAG = "TIME_SYNC";
+
+#define TIME_SYNC_POLL 'Q'
+#define TIME_SYNC_REPLY 'R'
+#define TIME_SYNC_APPLY 'A'
+
+/** Max skew accepted from the regression (crystal tolerance is far lower). */
+#define TIME_SYNC_MAX_SKEW_PPM 500.0
+/** Residual drift assumed after skew correction, for uncertainty growth. */
+#define TIME_SYNC_RESIDUAL_PPM 20
+
+typedef struct {
+    uint8_t kind;
+    int64_t t1;
+} __attribute__((packed)) time_poll_t;
+
+typedef struct {
+    uint8_t kind;
+    int64_t t1;
+    int64_t t2;
+    int64_t t3;
+} __attribute__((packed)) time_reply_t;
+
+typedef struct {
+    uint8_t kind;
+    int64_t local_mid_us;
+    int64_t offset_us;
+    uint32_t delay_us;
+    uint8_t wall_valid;
+} __attribute__((packed)) time_apply_t;
+
+/** One offset measurement on a leaf node (mesh = local + offset). */
+typedef struct {
+    int64_t local_us;
+    int64_t offset_us;
+    uint32_t delay_us;
+} time_sample_t;
+
+/** Root-side record of the last exchange with one node. */
+typedef struct {
+    uint64_t device_id;
+    int64_t offset_us;
+    uint32_t delay_us;
+    uint32_t last_poll_ms;
+    uint32_t last_sync_ms;
+    uint16_t samples;
+} time_peer_t;
+
+// Leaf-side discipline model
+static time_sample_t s_samples[TIME_SYNC_SAMPLES];
+static int s_num_samples = 0;
+static int s_next_sample = 0;
+static int64_t s_ref_local_us = 0;
+static int64_t s_ref_offset_us = 0;
+static uint32_t s_ref_delay_us = 0;
+static double s_skew = 0.0;
+static volatile bool s_model_valid = false;
+static portMUX_TYPE s_model_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** Uptime (ms) of the last sample or SNTP update applied to this node. */
+static volatile uint32_t s_last_sync_ms = 0;
+
+// Root-side peer table (only touched by mesh_rx_task and time_sync_task)
+static time_peer_t s_peers[MAX_NODES];
+static SemaphoreHandle_t s_peers_mutex = NULL;
+
+static bool s_sntp_started = false;
+
+// ====================
+// Clock Helpers
+// ====================
+
+/** @brief Current system (wall) clock in microseconds since the epoch. */
+static int64_t wall_clock_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+/**
+ * @brief Convert a local esp_timer timestamp to mesh time.
+ * @param local_us Value previously returned by esp_timer_get_time().
+ * @return Mesh time in µs, or 0 if this node has no clock model yet.
+ */
+int64_t mesh_time_from_local_us(int64_t local_us) {
+    if (g_is_root) {
+        return local_us + (wall_clock_now_us() - esp_timer_get_time());
+    }
+
+    if (!s_model_valid) return 0;
+
+    portENTER_CRITICAL(&s_model_lock);
+    int64_t elapsed = local_us - s_ref_local_us;
+    int64_t mesh_us =
+        local_us + s_ref_offset_us + (int64_t)(s_skew * (double)elapsed);
+    portEXIT_CRITICAL(&s_model_lock);
+    return mesh_us;
+}
+
+/** @brief Current mesh time in µs, or 0 if this node is not synced yet. */
+int64_t mesh_time_now_us(void) {
+    return mesh_time_from_local_us(esp_timer_get_time());
+}
+
+/**
+ * @brief Current estimate of this node's mesh clock uncertainty.
+ * @return Half the anchor round-trip delay plus assumed residual drift since
+ *         the anchor sample, in µs; 0 on the root, -1 when unsynced.
+ */
+int32_t mesh_time_uncertainty_us(void) {
+    if (g_is_root) return 0;
+    if (!s_model_valid) return -1;
+
+    int64_t age_us = esp_timer_get_time() - s_ref_local_us;
+    int64_t unc = s_ref_delay_us / 2 + age_us * TIME_SYNC_RESIDUAL_PPM / 1000000;
+    return unc > INT32_MAX ? INT32_MAX : (int32_t)unc;
+}
+
+/**
+ * @brief One-way latency of a received message from its send stamp.
+ * @param msg Received message.
+ * @return Latency in µs, or -1 when either side has no mesh clock.
+ */
+int64_t mesh_time_message_age_us(const mesh_app_msg_t* msg) {
+    if (msg->mesh_time_us == 0) return -1;
+    int64_t now = mesh_time_now_us();
+    if (now == 0) return -1;
+    return now - msg->mesh_time_us;
+}
+
+/**
+ * @brief Configure the local timezone used for schedule evaluation and
+ *        log output.  Called once from app_main().
+ */
+void time_sync_init(void) {
+    setenv("TZ", CONFIG_DOMATOR_TIMEZONE, 1);
+    tzset();
+    ESP_LOGI(TAG, "Timezone set to %s", CONFIG_DOMATOR_TIMEZONE);
+
+    s_peers_mutex = xSemaphoreCreateMutex();
+    if (s_peers_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create time sync peers mutex");
+    }
+}
+
+/** @brief Returns true once the wall clock has been set from SNTP or root. */
+bool time_sync_is_valid(void) { return g_time_synced; }
+
+// ====================
+// Root: SNTP
+// ====================
+
+/** @brief SNTP notification callback: marks the root clock as valid. */
+static void sntp_sync_cb(struct timeval* tv) {
+    bool first = !g_time_synced;
+    g_time_synced = true;
+    s_last_sync_ms = esp_timer_get_time() / 1000;
+    ESP_LOGI(TAG, "SNTP time update: %lld", (long long)tv->tv_sec);
+
+    if (first && s_peers_mutex &&
+        xSemaphoreTake(s_peers_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        // The mesh clock just stepped to real wall time: re-poll everyone
+        // right away instead of waiting a full interval.
+        for (int i = 0; i < MAX_NODES; i++) {
+            s_peers[i].last_poll_ms = 0;
+            s_peers[i].samples = 0;
+        }
+        xSemaphoreGive(s_peers_mutex);
+    }
+}
+
+/**
+ * @brief Start the SNTP client on the root node.  Idempotent; called from
+ *        the IP event handler once the root has an address.
+ */
+void time_sync_start_sntp(void) {
+    if (s_sntp_started) return;
+
+    ESP_LOGI(TAG, "Starting SNTP (server: %s)", CONFIG_DOMATOR_SNTP_SERVER);
+    esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, CONFIG_DOMATOR_SNTP_SERVER);
+    sntp_set_time_sync_notification_cb(sntp_sync_cb);
+    esp_sntp_init();
+    s_sntp_started = true;
+}
+
+/** @brief Stop the SNTP client when this node loses the root role. */
+void time_sync_stop_sntp(void) {
+    if (!s_sntp_started) return;
+    esp_sntp_stop();
+    s_sntp_started = false;
+    ESP_LOGI(TAG, "SNTP stopped");
+}
+
+// ====================
+// Root: Peer Table
+// ====================
+
+/**
+ * @brief Find or allocate the root-side record for a device.
+ *        Caller must hold s_peers_mutex.
+ */
+static time_peer_t* peer_get(uint64_t device_id) {
+    time_peer_t* free_slot = NULL;
+    for (int i = 0; i < MAX_NODES; i++) {
+        if (s_peers[i].device_id == device_id) return &s_peers[i];
+        if (s_peers[i].device_id == 0 && free_slot == NULL) {
+            free_slot = &s_peers[i];
+        }
+    }
+    if (free_slot) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->device_id = device_id;
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Send a time POLL to one node.  t1 is filled in at send time by
+ *        time_sync_stamp_outgoing().
+ */
+static void time_sync_poll(uint64_t device_id, mesh_addr_t* dest) {
+    mesh_app_msg_t msg = {0};
+    msg.src_id = g_device_id;
+    msg.msg_type = MSG_TYPE_TIME;
+    time_poll_t poll = {.kind = TIME_SYNC_POLL, .t1 = 0};
+    memcpy(msg.data, &poll, sizeof(poll));
+    msg.data_len = sizeof(poll);
+    mesh_queue_to_node(&msg, TX_PRIO_HIGH, dest);
+    ESP_LOGD(TAG, "Time poll to %" PRIu64, device_id);
+}
+
+/**
+ * @brief Called by the root when a node (re)joins: forget its history so it
+ *        gets fast polls until its model converges.
+ * @param device_id Device that sent MSG_TYPE_TYPE_INFO.
+ * @param addr      Its mesh address.
+ */
+void time_sync_node_joined(uint64_t device_id, mesh_addr_t* addr) {
+    if (!g_is_root || s_peers_mutex == NULL || device_id == g_device_id) return;
+
+    if (xSemaphoreTake(s_peers_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    time_peer_t* peer = peer_get(device_id);
+    if (peer) {
+        peer->samples = 0;
+        peer->last_poll_ms = esp_timer_get_time() / 1000;
+    }
+    xSemaphoreGive(s_peers_mutex);
+
+    if (peer) time_sync_poll(device_id, addr);
+}
+
+/** @brief Root: turn a REPLY into offset/delay and send the APPLY back. */
+static void root_handle_reply(mesh_addr_t* from, const mesh_app_msg_t* msg,
+                              int64_t rx_local_us) {
+    if (msg->data_len < sizeof(time_reply_t)) return;
+
+    time_reply_t reply;
+    memcpy(&reply, msg->data, sizeof(reply));
+    int64_t t4 = mesh_time_from_local_us(rx_local_us);
+
+    // theta = node_local - mesh; node applies mesh = local + offset.
+    int64_t theta = ((reply.t2 - reply.t1) + (reply.t3 - t4)) / 2;
+    int64_t delay = (t4 - reply.t1) - (reply.t3 - reply.t2);
+    if (delay < 0) delay = 0;
+
+    time_apply_t apply = {
+        .kind = TIME_SYNC_APPLY,
+        .local_mid_us = reply.t2 + (reply.t3 - reply.t2) / 2,
+        .offset_us = -theta,
+        .delay_us = delay > UINT32_MAX ? UINT32_MAX : (uint32_t)delay,
+        .wall_valid = g_time_synced,
+    };
+
+    mesh_app_msg_t out = {0};
+    out.src_id = g_device_id;
+    out.msg_type = MSG_TYPE_TIME;
+    memcpy(out.data, &apply, sizeof(apply));
+    out.data_len = sizeof(apply);
+    mesh_queue_to_node(&out, TX_PRIO_HIGH, from);
+
+    if (xSemaphoreTake(s_peers_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        time_peer_t* peer = peer_get(msg->src_id);
+        if (peer) {
+            peer->offset_us = -theta;
+            peer->delay_us = apply.delay_us;
+            peer->last_sync_ms = esp_timer_get_time() / 1000;
+            if (peer->samples < UINT16_MAX) peer->samples++;
+        }
+        xSemaphoreGive(s_peers_mutex);
+    }
+
+    ESP_LOGD(TAG, "Sync %" PRIu64 ": offset=%lld us, delay=%lld us",
+             msg->src_id, (long long)-theta, (long long)delay);
+}
+
+/**
+ * @brief Publish the per-node offset/uncertainty table to MQTT
+ *        (/switch/state/timesync).  Root only.
+ */
+void time_sync_publish_report(void) {
+    if (!g_is_root || !g_mqtt_connected || s_peers_mutex == NULL) return;
+
+    cJSON* json = cJSON_CreateObject();
+    if (json == NULL) return;
+
+    cJSON_AddNumberToObject(json, "rootId", g_device_id);
+    cJSON_AddNumberToObject(json, "wallValid", g_time_synced);
+    cJSON_AddNumberToObject(json, "meshTime", (double)mesh_time_now_us());
+    cJSON* nodes = cJSON_AddObjectToObject(json, "nodes");
+
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    if (xSemaphoreTake(s_peers_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        for (int i = 0; i < MAX_NODES; i++) {
+            if (s_peers[i].device_id == 0 || s_peers[i].samples == 0) continue;
+            char key[24];
+            snprintf(key, sizeof(key), "%" PRIu64, s_peers[i].device_id);
+            cJSON* node = cJSON_AddObjectToObject(nodes, key);
+            cJSON_AddNumberToObject(node, "offsetUs",
+                                    (double)s_peers[i].offset_us);
+            cJSON_AddNumberToObject(node, "uncUs", s_peers[i].delay_us / 2);
+            cJSON_AddNumberToObject(node, "rttUs", s_peers[i].delay_us);
+            cJSON_AddNumberToObject(node, "ageS",
+                                    (now_ms - s_peers[i].last_sync_ms) / 1000);
+            cJSON_AddNumberToObject(node, "samples", s_peers[i].samples);
+        }
+        xSemaphoreGive(s_peers_mutex);
+    }
+
+    char* json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str) {
+        esp_mqtt_client_publish(g_mqtt_client, "/switch/state/timesync",
+                                json_str, 0, 0, 0);
+        cJSON_free(json_str);
+    }
+}
+
+// ====================
+// Leaf: Clock Discipline
+// ====================
+
+/**
+ * @brief Step or slew the system clock toward the current mesh time, so
+ *        wall-clock users (schedules, log timestamps) follow the mesh clock.
+ */
+static void discipline_system_clock(void) {
+    int64_t mesh_us = mesh_time_now_us();
+    int64_t offset_us = mesh_us - wall_clock_now_us();
+
+    if (!g_time_synced || llabs(offset_us) > TIME_SYNC_STEP_THRESHOLD_US) {
+        struct timeval tv = {
+            .tv_sec = mesh_us / 1000000LL,
+            .tv_usec = mesh_us % 1000000LL,
+        };
+        settimeofday(&tv, NULL);
+        ESP_LOGI(TAG, "Clock stepped by %lld ms", (long long)(offset_us / 1000));
+    } else {
+        struct timeval delta = {
+            .tv_sec = offset_us / 1000000LL,
+            .tv_usec = offset_us % 1000000LL,
+        };
+        adjtime(&delta, NULL);
+    }
+}
+
+/**
+ * @brief Fold a new offset sample into the clock model.
+ *
+ * A sample that disagrees with the current prediction by more than
+ * TIME_SYNC_STEP_THRESHOLD_US means the mesh clock itself stepped (SNTP
+ * update, new root): history is dropped and the model restarts from it.
+ */
+static void model_add_sample(int64_t local_us, int64_t offset_us,
+                             uint32_t delay_us) {
+    if (s_model_valid) {
+        int64_t predicted = mesh_time_from_local_us(local_us) - local_us;
+        if (llabs(predicted - offset_us) > TIME_SYNC_STEP_THRESHOLD_US) {
+            ESP_LOGW(TAG, "Mesh clock stepped (%lld ms), resetting model",
+                     (long long)((offset_us - predicted) / 1000));
+            s_num_samples = 0;
+            s_next_sample = 0;
+        }
+    }
+
+    s_samples[s_next_sample] = (time_sample_t){
+        .local_us = local_us, .offset_us = offset_us, .delay_us = delay_us};
+    s_next_sample = (s_next_sample + 1) % TIME_SYNC_SAMPLES;
+    if (s_num_samples < TIME_SYNC_SAMPLES) s_num_samples++;
+
+    // Anchor on the sample with the lowest delay: least queueing asymmetry.
+    const time_sample_t* best = &s_samples[0];
+    for (int i = 1; i < s_num_samples; i++) {
+        if (s_samples[i].delay_us < best->delay_us) best = &s_samples[i];
+    }
+
+    // Least-squares skew (d offset / d local) across the window.
+    double skew = 0.0;
+    if (s_num_samples >= 2) {
+        double mean_x = 0, mean_y = 0;
+        for (int i = 0; i < s_num_samples; i++) {
+            mean_x += (double)(s_samples[i].local_us - best->local_us);
+            mean_y += (double)(s_samples[i].offset_us - best->offset_us);
+        }
+        mean_x /= s_num_samples;
+        mean_y /= s_num_samples;
+
+        double sxx = 0, sxy = 0;
+        for (int i = 0; i < s_num_samples; i++) {
+            double dx =
+                (double)(s_samples[i].local_us - best->local_us) - mean_x;
+            double dy =
+                (double)(s_samples[i].offset_us - best->offset_us) - mean_y;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if (sxx > 0) skew = sxy / sxx;
+
+        double max_skew = TIME_SYNC_MAX_SKEW_PPM / 1e6;
+        if (skew > max_skew) skew = max_skew;
+        if (skew < -max_skew) skew = -max_skew;
+    }
+
+    portENTER_CRITICAL(&s_model_lock);
+    s_ref_local_us = best->local_us;
+    s_ref_offset_us = best->offset_us;
+    s_ref_delay_us = best->delay_us;
+    s_skew = skew;
+    s_model_valid = true;
+    portEXIT_CRITICAL(&s_model_lock);
+
+    s_last_sync_ms = esp_timer_get_time() / 1000;
+
+    ESP_LOGD(TAG, "Sample offset=%lld us delay=%" PRIu32 " us, skew=%.2f ppm",
+             (long long)offset_us, delay_us, skew * 1e6);
+}
+
+// ====================
+// Message Handling
+// ====================
+
+/**
+ * @brief Fill send-time stamps on an outgoing message.  Called by
+ *        mesh_send_to_node() immediately before esp_mesh_send(), so queueing
+ *        delay inside this node does not skew the measurements.
+ * @param msg Message about to be sent.
+ */
+void time_sync_stamp_outgoing(mesh_app_msg_t* msg) {
+    int64_t local_us = esp_timer_get_time();
+    msg->mesh_time_us = mesh_time_from_local_us(local_us);
+
+    if (msg->msg_type != MSG_TYPE_TIME || msg->data_len < 1) return;
+
+    if (msg->data[0] == TIME_SYNC_POLL && msg->data_len >= sizeof(time_poll_t)) {
+        int64_t t1 = msg->mesh_time_us;
+        memcpy(&msg->data[offsetof(time_poll_t, t1)], &t1, sizeof(t1));
+    } else if (msg->data[0] == TIME_SYNC_REPLY &&
+               msg->data_len >= sizeof(time_reply_t)) {
+        memcpy(&msg->data[offsetof(time_reply_t, t3)], &local_us,
+               sizeof(local_us));
+    }
+}
+
+/**
+ * @brief Handle any MSG_TYPE_TIME message.  Called directly from
+ *        mesh_rx_task() with the local receive timestamp.
+ * @param from        Sender mesh address.
+ * @param msg         Received message.
+ * @param rx_local_us esp_timer_get_time() right after esp_mesh_recv().
+ */
+void time_sync_handle_message(mesh_addr_t* from, const mesh_app_msg_t* msg,
+                              int64_t rx_local_us) {
+    if (msg->data_len < 1) return;
+
+    switch (msg->data[0]) {
+        case TIME_SYNC_POLL: {
+            if (g_is_root || msg->data_len < sizeof(time_poll_t)) break;
+
+            time_poll_t poll;
+            memcpy(&poll, msg->data, sizeof(poll));
+
+            time_reply_t reply = {
+                .kind = TIME_SYNC_REPLY,
+                .t1 = poll.t1,
+                .t2 = rx_local_us,
+                .t3 = 0,  // stamped at send
+            };
+            mesh_app_msg_t out = {0};
+            out.src_id = g_device_id;
+            out.msg_type = MSG_TYPE_TIME;
+            memcpy(out.data, &reply, sizeof(reply));
+            out.data_len = sizeof(reply);
+            mesh_queue_to_node(&out, TX_PRIO_HIGH, NULL);
+            break;
+        }
+
+        case TIME_SYNC_REPLY:
+            if (g_is_root) root_handle_reply(from, msg, rx_local_us);
+            break;
+
+        case TIME_SYNC_APPLY: {
+            if (g_is_root || msg->data_len < sizeof(time_apply_t)) break;
+
+            time_apply_t apply;
+            memcpy(&apply, msg->data, sizeof(apply));
+            model_add_sample(apply.local_mid_us, apply.offset_us,
+                             apply.delay_us);
+
+            if (apply.wall_valid) {
+                discipline_system_clock();
+                g_time_synced = true;
+            }
+            break;
+        }
+
+        default:
+            ESP_LOGW(TAG, "Unknown time sync message '%c'", msg->data[0]);
+            break;
+    }
+}
+
+// ====================
+// Time Sync Task
+// ====================
+
+/**
+ * @brief FreeRTOS task: drive the poll schedule on the root.
+ *
+ * Each pass snapshots the node registry and polls every node whose last poll
+ * is older than TIME_SYNC_INTERVAL_MS (TIME_SYNC_FAST_INTERVAL_MS until it
+ * has TIME_SYNC_SAMPLES samples), one node per TIME_SYNC_POLL_SPACING_MS.
+ * Leaf nodes only log when their last sample is getting stale.
+ */
+void time_sync_task(void* arg) {
+    ESP_LOGI(TAG, "Time sync task started");
+
+    static uint64_t ids[MAX_NODES];
+    static mesh_addr_t addrs[MAX_NODES];
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+
+        if (g_ota_in_progress) {
+            continue;
+        }
+
+        uint32_t now_ms = esp_timer_get_time() / 1000;
+
+        if (!g_is_root) {
+            if (s_model_valid &&
+                now_ms - s_last_sync_ms > 10 * TIME_SYNC_INTERVAL_MS) {
+                ESP_LOGW(TAG, "No time sync for %" PRIu32 " s, free-running",
+                         (now_ms - s_last_sync_ms) / 1000);
+                s_last_sync_ms = now_ms;
+            }
+            continue;
+        }
+
+        int count = root_registry_snapshot(ids, addrs, MAX_NODES);
+        for (int i = 0; i < count && g_is_root; i++) {
+            if (ids[i] == g_device_id) continue;
+
+            bool due = false;
+            now_ms = esp_timer_get_time() / 1000;
+            if (xSemaphoreTake(s_peers_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+                time_peer_t* peer = peer_get(ids[i]);
+                if (peer) {
+                    uint32_t interval = peer->samples < TIME_SYNC_SAMPLES
+                                            ? TIME_SYNC_FAST_INTERVAL_MS
+                                            : TIME_SYNC_INTERVAL_MS;
+                    if (peer->last_poll_ms == 0 ||
+                        now_ms - peer->last_poll_ms >= interval) {
+                        peer->last_poll_ms = now_ms;
+                        due = true;
+                    }
+                }
+                xSemaphoreGive(s_peers_mutex);
+            }
+
+            if (due) {
+                time_sync_poll(ids[i], &addrs[i]);
+                vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_POLL_SPACING_MS));
+            }
+        }
+    }
+}
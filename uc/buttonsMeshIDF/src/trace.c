@@ -0,0 +1,205 @@
+/**
+ * @file trace.c
+ * @brief FreeRTOS scheduling trace captured to a RAM ring
+ *        (CONFIG_DOMATOR_TRACE).
+ *
+ * The kernel trace macros in trace_hooks.h call into this file on every task
+ * switch, on sends/receives of the queues registered with task_stats
+ * (semaphores and mutexes are filtered out) and when a receiver blocks on
+ * one of them.  The button GPIO ISR and a few hot paths add ISR enter/exit
+ * events and markers (TRACE_ISR_*(), TRACE_MARK()).  Each event is a 12-byte
+ * trace_event_t stamped with esp_timer_get_time(), so both cores share one
+ * clock.
+ *
+ * Slots are claimed with an atomic fetch-add on the write index, so hooks
+ * never take a lock.  By default the ring overwrites its oldest events; a
+ * one-shot capture stops when the buffer is full instead.
+ *
+ * The shell's "trace" command starts and stops a capture and dumps it as
+ * text lines the Telnet session can be saved from:
+ *   @T:H <events> <recorded> <cores>   header
+ *   @T:N <handle> <priority> <name>    task names
+ *   @T:Q <handle> <name>               queue names
+ *   @T:M <id> <name>                   marker names
+ *   @T:E <hex>                         up to 8 raw events
+ *   @T:Z                               end
+ * tools/trace_export.py turns a saved session into Chrome/Perfetto JSON.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "domator_mesh.h"
+
+#if CONFIG_DOMATOR_TRACE
+
+static const char* TAG = "TRACE";
+
+#define TRACE_EVENTS CONFIG_DOMATOR_TRACE_EVENTS
+#define TRACE_DUMP_PER_LINE 8
+
+_Static_assert(sizeof(trace_event_t) == 12,
+               "tools/trace_export.py decodes 12-byte events");
+
+static trace_event_t s_events[TRACE_EVENTS];
+static uint32_t s_head = 0;  // events claimed since trace_start()
+static volatile bool s_active = false;
+static bool s_oneshot = false;
+
+// Queues whose events are kept, copied from task_stats at trace_start().
+static QueueHandle_t s_queues[TASK_STATS_MAX_QUEUES];
+static const char* s_queue_names[TASK_STATS_MAX_QUEUES];
+static int s_queue_count = 0;
+
+static const char* const s_marker_names[TRACE_MARK_COUNT] = {
+    [TRACE_MARK_MESH_RX] = "mesh_rx",
+    [TRACE_MARK_MESH_TX] = "mesh_tx",
+    [TRACE_MARK_MQTT_CMD] = "mqtt_cmd",
+    [TRACE_MARK_BUTTON] = "button",
+};
+
+// ====================
+// Recording (IRAM, called from the kernel and ISRs)
+// ====================
+
+static void IRAM_ATTR trace_put(uint8_t type, uint32_t obj, uint16_t arg) {
+    if (!s_active) return;
+
+    uint32_t i = __atomic_fetch_add(&s_head, 1, __ATOMIC_RELAXED);
+    if (s_oneshot && i >= TRACE_EVENTS) {
+        s_active = false;
+        return;
+    }
+
+    trace_event_t* e = &s_events[i % TRACE_EVENTS];
+    e->time_us = (uint32_t)esp_timer_get_time();
+    e->obj = obj;
+    e->type = type;
+    e->core = xPortGetCoreID();
+    e->arg = arg;
+}
+
+void IRAM_ATTR trace_hook_task_switched_in(void) {
+    if (!s_active) return;
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    trace_put(TRACE_EV_SWITCH_IN, (uint32_t)(uintptr_t)task, 0);
+}
+
+void IRAM_ATTR trace_hook_queue(uint8_t type, const void* queue,
+                                uint8_t failed) {
+    if (!s_active) return;
+    for (int i = 0; i < s_queue_count; i++) {
+        if (s_queues[i] == queue) {
+            trace_put(type, (uint32_t)(uintptr_t)queue, failed);
+            return;
+        }
+    }
+}
+
+void IRAM_ATTR trace_hook_isr(uint8_t type, uint32_t isr) {
+    trace_put(type, 0, isr);
+}
+
+void IRAM_ATTR trace_isr_enter(uint32_t isr) {
+    trace_put(TRACE_EV_ISR_ENTER, 0, isr);
+}
+
+void IRAM_ATTR trace_isr_exit(uint32_t isr) {
+    trace_put(TRACE_EV_ISR_EXIT, 0, isr);
+}
+
+void IRAM_ATTR trace_mark(trace_marker_t id, uint32_t value) {
+    trace_put(TRACE_EV_MARK, value, id);
+}
+
+// ====================
+// Control
+// ====================
+
+void trace_start(bool oneshot) {
+    s_active = false;
+    s_queue_count = task_stats_queue_handles(s_queues, s_queue_names,
+                                             TASK_STATS_MAX_QUEUES);
+    s_oneshot = oneshot;
+    __atomic_store_n(&s_head, 0, __ATOMIC_RELAXED);
+    s_active = true;
+    ESP_LOGI(TAG, "Trace started (%d events, %s, %d queues)", TRACE_EVENTS,
+             oneshot ? "one-shot" : "ring", s_queue_count);
+}
+
+void trace_stop(void) {
+    if (!s_active) return;
+    s_active = false;
+    ESP_LOGI(TAG, "Trace stopped after %" PRIu32 " events", trace_recorded());
+}
+
+bool trace_active(void) { return s_active; }
+
+uint32_t trace_recorded(void) {
+    return __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+}
+
+// ====================
+// Dump
+// ====================
+
+static void dump_tasks(int (*print)(const char* fmt, ...)) {
+    UBaseType_t count = uxTaskGetNumberOfTasks();
+    TaskStatus_t* status = malloc(count * sizeof(TaskStatus_t));
+    if (status == NULL) {
+        ESP_LOGW(TAG, "No memory for task names");
+        return;
+    }
+    count = uxTaskGetSystemState(status, count, NULL);
+    for (UBaseType_t i = 0; i < count; i++) {
+        print("@T:N %08" PRIx32 " %u %s\n",
+              (uint32_t)(uintptr_t)status[i].xHandle,
+              (unsigned)status[i].uxCurrentPriority, status[i].pcTaskName);
+    }
+    free(status);
+}
+
+/**
+ * @brief Print the capture.  Recording is stopped first so the events are
+ *        stable; a one-shot capture that stopped itself keeps its events.
+ */
+void trace_dump(int (*print)(const char* fmt, ...)) {
+    trace_stop();
+
+    uint32_t recorded = trace_recorded();
+    uint32_t count = recorded < TRACE_EVENTS ? recorded : TRACE_EVENTS;
+    uint32_t first = s_oneshot ? 0 : recorded - count;
+
+    print("@T:H %" PRIu32 " %" PRIu32 " %d\n", count, recorded,
+          portNUM_PROCESSORS);
+    dump_tasks(print);
+    for (int i = 0; i < s_queue_count; i++) {
+        print("@T:Q %08" PRIx32 " %s\n", (uint32_t)(uintptr_t)s_queues[i],
+              s_queue_names[i]);
+    }
+    for (int i = 0; i < TRACE_MARK_COUNT; i++) {
+        print("@T:M %d %s\n", i, s_marker_names[i]);
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    char line[TRACE_DUMP_PER_LINE * sizeof(trace_event_t) * 2 + 1];
+    for (uint32_t n = 0; n < count; n += TRACE_DUMP_PER_LINE) {
+        uint32_t batch = count - n;
+        if (batch > TRACE_DUMP_PER_LINE) batch = TRACE_DUMP_PER_LINE;
+
+        char* p = line;
+        for (uint32_t k = 0; k < batch; k++) {
+            const uint8_t* b =
+                (const uint8_t*)&s_events[(first + n + k) % TRACE_EVENTS];
+            for (size_t j = 0; j < sizeof(trace_event_t); j++) {
+                *p++ = hex[b[j] >> 4];
+                *p++ = hex[b[j] & 0x0f];
+            }
+        }
+        *p = '\0';
+        print("@T:E %s\n", line);
+    }
+    print("@T:Z\n");
+}
+
+#endif  // CONFIG_DOMATOR_TRACE
@@ -0,0 +1,48 @@
+/**
+ * @file trace_hooks.h
+ * @brief FreeRTOS trace macros for the scheduling trace (CONFIG_DOMATOR_TRACE).
+ *
+ * Force-included into the FreeRTOS kernel sources by the project
+ * CMakeLists.txt, so the definitions below replace the empty defaults in
+ * FreeRTOS.h.  Kept free of FreeRTOS and ESP-IDF includes because it is seen
+ * before FreeRTOSConfig.h; the hooks themselves live in trace.c (IRAM).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+void trace_hook_task_switched_in(void);
+void trace_hook_queue(uint8_t type, const void* queue, uint8_t failed);
+void trace_hook_isr(uint8_t type, uint32_t isr);
+
+// Event types, shared with trace.c and tools/trace_export.py.
+#define TRACE_EV_SWITCH_IN 1
+#define TRACE_EV_ISR_ENTER 2
+#define TRACE_EV_ISR_EXIT 3
+#define TRACE_EV_QUEUE_SEND 4
+#define TRACE_EV_QUEUE_RECV 5
+#define TRACE_EV_QUEUE_BLOCK 6
+#define TRACE_EV_MARK 7
+
+#define traceTASK_SWITCHED_IN() trace_hook_task_switched_in()
+
+#define traceQUEUE_SEND(pxQueue)                                              \
+    trace_hook_queue(TRACE_EV_QUEUE_SEND, (pxQueue), 0)
+#define traceQUEUE_SEND_FAILED(pxQueue)                                       \
+    trace_hook_queue(TRACE_EV_QUEUE_SEND, (pxQueue), 1)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)                                     \
+    trace_hook_queue(TRACE_EV_QUEUE_SEND, (pxQueue), 0)
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue)                              \
+    trace_hook_queue(TRACE_EV_QUEUE_SEND, (pxQueue), 1)
+#define traceQUEUE_RECEIVE(pxQueue)                                           \
+    trace_hook_queue(TRACE_EV_QUEUE_RECV, (pxQueue), 0)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)                                  \
+    trace_hook_queue(TRACE_EV_QUEUE_RECV, (pxQueue), 0)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)                               \
+    trace_hook_queue(TRACE_EV_QUEUE_BLOCK, (pxQueue), 0)
+
+// Only some ports emit these; our own ISRs call trace_isr_enter/exit().
+#define traceISR_ENTER(n) trace_hook_isr(TRACE_EV_ISR_ENTER, (n))
+#define traceISR_EXIT() trace_hook_isr(TRACE_EV_ISR_EXIT, 0)
+#define traceISR_EXIT_TO_SCHEDULER() trace_hook_isr(TRACE_EV_ISR_EXIT, 0)
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Decode deferred log records (CONFIG_DOMATOR_DEFERRED_LOG).
+
+The firmware prints "@D:<hex>" lines instead of formatted text for DLOGx()
+calls.  Each record holds the flash addresses of the format string and TAG,
+a millisecond timestamp and the raw argument bytes; this script looks the
+strings up in the firmware ELF and prints ordinary ESP-IDF style log lines.
+Every other line is passed through unchanged, so it can sit at the end of a
+pipe:
+
+    nc <node-ip> 23 | tools/dlog_decode.py build/domator_mesh.elf
+    tools/dlog_decode.py build/domator_mesh.elf capture.log
+
+Only the Python standard library is used.
+"""
+
+import re
+import struct
+import sys
+
+HEADER = struct.Struct("<III")  # fmt address, tag address, timestamp (ms)
+
+# printf conversion: flags, width, precision, length modifier, conversion
+CONV_RE = re.compile(
+    r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXcspfFeEgGaA%])"
+)
+
+LEVEL_COLORS = {"E": "\033[0;31m", "W": "\033[0;33m", "I": "\033[0;32m"}
+COLOR_RESET = "\033[0m"
+
+
+class Elf32:
+    """Just enough of an ELF32 little-endian reader to fetch C strings from
+    loaded segments by virtual address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError(f"{path}: not a 32-bit ELF file")
+        if self.data[5] != 1:
+            raise ValueError(f"{path}: not a little-endian ELF file")
+
+        (phoff,) = struct.unpack_from("<I", self.data, 0x1C)
+        phentsize, phnum = struct.unpack_from("<HH", self.data, 0x2A)
+
+        self.segments = []
+        for i in range(phnum):
+            p_type, p_offset, p_vaddr, _, p_filesz = struct.unpack_from(
+                "<IIIII", self.data, phoff + i * phentsize
+            )
+            if p_type == 1 and p_filesz:  # PT_LOAD
+                self.segments.append((p_vaddr, p_offset, p_filesz))
+
+    def cstring(self, addr):
+        for vaddr, offset, size in self.segments:
+            if vaddr <= addr < vaddr + size:
+                start = offset + (addr - vaddr)
+                end = self.data.find(b"\0", start, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+class Args:
+    """Sequential reader over the argument bytes of one record."""
+
+    def __init__(self, payload):
+        self.payload = payload
+        self.pos = 0
+        self.short = False
+
+    def take(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.pos + size > len(self.payload):
+            self.short = True
+            return None
+        (value,) = struct.unpack_from(fmt, self.payload, self.pos)
+        self.pos += size
+        return value
+
+    def string(self):
+        if self.pos >= len(self.payload):
+            self.short = True
+            return None
+        n = self.payload[self.pos]
+        raw = self.payload[self.pos + 1 : self.pos + 1 + n]
+        self.pos += 1 + n
+        return raw.decode("utf-8", "replace")
+
+
+def render(fmt, args):
+    """Apply the firmware's printf format to the encoded argument stream."""
+    out = []
+    last = 0
+    for m in CONV_RE.finditer(fmt):
+        out.append(fmt[last : m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+
+        # '*' width/precision consume an int argument on the device too.
+        if width == "*":
+            width = str(args.take("<i") or 0)
+        if prec == "*":
+            prec = str(args.take("<i") or 0)
+
+        wide = length in ("ll", "j")
+        if conv in "di":
+            value = args.take("<q" if wide else "<i")
+        elif conv in "ouxX":
+            value = args.take("<Q" if wide else "<I")
+        elif conv == "c":
+            value = args.take("<I")
+        elif conv == "s":
+            value = args.string()
+        elif conv == "p":
+            value = args.take("<I")
+        else:  # floating point is always logged as double
+            value = args.take("<d")
+
+        if value is None:
+            out.append("<?>")
+            continue
+
+        spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+        if conv == "p":
+            out.append((spec + "s") % ("0x%08x" % value))
+        elif conv == "c":
+            out.append((spec + "c") % chr(value & 0xFF))
+        elif conv in "di":
+            out.append((spec + "d") % value)
+        elif conv == "u":
+            out.append((spec + "d") % value)
+        else:
+            out.append((spec + conv) % value)
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode_line(elf, hexdata, color):
+    truncated = hexdata.endswith("!")
+    if truncated:
+        hexdata = hexdata[:-1]
+    try:
+        record = bytes.fromhex(hexdata)
+    except ValueError:
+        return None
+    if len(record) < HEADER.size:
+        return None
+
+    fmt_addr, tag_addr, ts = HEADER.unpack_from(record)
+    fmt = elf.cstring(fmt_addr)
+    tag = elf.cstring(tag_addr) or f"?{tag_addr:08x}"
+    if not fmt:
+        return f"? ({ts}) {tag}: <unknown format @0x{fmt_addr:08x}>"
+
+    level, fmt = fmt[0], fmt[1:]
+    args = Args(record[HEADER.size :])
+    text = render(fmt, args)
+    if truncated or args.short:
+        text += " <truncated>"
+
+    line = f"{level} ({ts}) {tag}: {text}"
+    if color and level in LEVEL_COLORS:
+        line = LEVEL_COLORS[level] + line + COLOR_RESET
+    return line
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write(f"usage: {argv[0]} <firmware.elf> [logfile]\n")
+        return 2
+
+    elf = Elf32(argv[1])
+    stream = open(argv[2], "r", errors="replace") if len(argv) == 3 else sys.stdin
+    color = sys.stdout.isatty()
+
+    marker = re.compile(r"@D:([0-9a-f]+!?)")
+    for raw in stream:
+        line = raw.rstrip("\r\n")
+        m = marker.search(line)
+        if m:
+            decoded = decode_line(elf, m.group(1), color)
+            if decoded is not None:
+                # Keep any prefix the transport added (e.g. another tool's
+                # timestamp) in front of the decoded text.
+                line = line[: m.start()] + decoded + line[m.end() :]
+        print(line, flush=True)
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main(sys.argv))
+    except (BrokenPipeError, KeyboardInterrupt):
+        sys.exit(0)
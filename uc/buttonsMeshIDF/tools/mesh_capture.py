@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Save and read mesh traffic captures from the root (CONFIG_DOMATOR_CAPTURE).
+
+The root streams its captures on TCP port 2324 (DOMATOR_CAPTURE_PORT) in the
+format defined in src/domator_mesh.h: a 32-byte file header, then records of
+a 12-byte header and a payload.  The stream is saved unchanged, so the file
+replays on the host with domator_replay.
+
+Usage:
+    mesh_capture.py record <root-ip> out.dcap [--port 2324] [--seconds N]
+    mesh_capture.py dump capture.dcap [--hex]
+
+"record" runs until Ctrl-C (or --seconds) and prints a running count.
+"dump" prints one line per record:
+
+    <seconds> RX|TX <peer> <type> seq=<n> len=<n> <data>
+    <seconds> IN|OUT <topic> <payload>
+    <seconds> DROP <n>
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+FILE_HDR = struct.Struct("<IHHIIQq")
+REC_HDR = struct.Struct("<IIHBB")
+MSG_HDR = struct.Struct("<QBHIBq")  # mesh_app_msg_t up to data[]
+
+CAPTURE_MAGIC = 0x50434D44
+CAPTURE_VERSION = 1
+
+KIND_NAMES = {1: "RX", 2: "TX", 3: "IN", 4: "OUT", 5: "DROP"}
+FLAG_TRUNCATED = 0x01
+FLAG_RETAIN = 0x02
+
+
+def printable(data, as_hex):
+    if as_hex:
+        return data.hex()
+    out = []
+    for b in data:
+        c = chr(b)
+        out.append(c if c.isprintable() and c != "\\" else "\\x%02x" % b)
+    return "".join(out)
+
+
+def read_header(f, name):
+    raw = f.read(FILE_HDR.size)
+    if len(raw) < FILE_HDR.size:
+        sys.exit("%s: not a capture file" % name)
+    magic, version, hdr_size, snaplen, _, device_id, start_us = FILE_HDR.unpack(
+        raw)
+    if magic != CAPTURE_MAGIC:
+        sys.exit("%s: not a capture file" % name)
+    if version != CAPTURE_VERSION:
+        sys.exit("%s: capture version %d not supported" % (name, version))
+    f.read(hdr_size - FILE_HDR.size)
+    return device_id, snaplen, start_us
+
+
+def records(f):
+    while True:
+        raw = f.read(REC_HDR.size)
+        if len(raw) < REC_HDR.size:
+            return
+        ts_sec, ts_usec, length, kind, flags = REC_HDR.unpack(raw)
+        payload = f.read(length)
+        if len(payload) < length:
+            return
+        yield ts_sec + ts_usec / 1e6, kind, flags, payload
+
+
+def describe(kind, flags, payload, as_hex):
+    name = KIND_NAMES.get(kind, "?%d" % kind)
+    if kind in (1, 2):
+        peer = ":".join("%02x" % b for b in payload[:6])
+        _, msg_type, data_len, seq, _, _ = MSG_HDR.unpack_from(payload, 6)
+        data = payload[6 + MSG_HDR.size:]
+        return "%s %s %s seq=%d len=%d %s" % (
+            name, peer, chr(msg_type), seq, data_len, printable(data, as_hex))
+    if kind in (3, 4):
+        topic_len = payload[0]
+        topic = payload[1:1 + topic_len].decode(errors="replace")
+        data = payload[1 + topic_len:]
+        extra = " (retain)" if flags & FLAG_RETAIN else ""
+        return "%s %s %s%s" % (name, topic, printable(data, as_hex), extra)
+    if kind == 5:
+        return "DROP %d" % struct.unpack_from("<I", payload)[0]
+    return "%s %s" % (name, payload.hex())
+
+
+def dump(args):
+    with open(args.file, "rb") as f:
+        device_id, snaplen, _ = read_header(f, args.file)
+        print("# root %d, snaplen %d" % (device_id, snaplen))
+        for t, kind, flags, payload in records(f):
+            line = describe(kind, flags, payload, args.hex)
+            if flags & FLAG_TRUNCATED:
+                line += " (truncated)"
+            print("%.6f %s" % (t, line))
+
+
+def record(args):
+    sock = socket.create_connection((args.host, args.port), timeout=10)
+    sock.settimeout(1.0)
+    end = time.monotonic() + args.seconds if args.seconds else None
+    total = 0
+    with open(args.file, "wb") as out:
+        try:
+            while end is None or time.monotonic() < end:
+                try:
+                    chunk = sock.recv(65536)
+                except socket.timeout:
+                    continue
+                if not chunk:
+                    print("\nroot closed the capture", file=sys.stderr)
+                    break
+                out.write(chunk)
+                total += len(chunk)
+                print("\r%d bytes" % total, end="", file=sys.stderr)
+        except KeyboardInterrupt:
+            pass
+    sock.close()
+    print("\nsaved %s" % args.file, file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("record", help="save the root's capture stream")
+    p.add_argument("host", help="root IP address")
+    p.add_argument("file", help="output .dcap file")
+    p.add_argument("--port", type=int, default=2324)
+    p.add_argument("--seconds", type=float, default=0,
+                   help="stop after this long (default: Ctrl-C)")
+    p.set_defaults(func=record)
+
+    p = sub.add_parser("dump", help="print a capture as text")
+    p.add_argument("file", help=".dcap file")
+    p.add_argument("--hex", action="store_true", help="payloads as hex")
+    p.set_defaults(func=dump)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Convert a scheduling trace dump (CONFIG_DOMATOR_TRACE) to Chrome trace JSON.
+
+The shell's "trace dump" command prints "@T:" lines: a header, task, queue
+and marker names, then the raw 12-byte events as hex.  Save the Telnet
+session and convert it; the output opens in https://ui.perfetto.dev or
+chrome://tracing:
+
+    (echo "trace dump"; sleep 5) | nc <root-ip> 23 > capture.txt
+    tools/trace_export.py capture.txt > trace.json
+
+Each CPU core becomes one track of task slices; ISRs get their own track per
+core, and queue operations and markers are instant events on the core they
+happened on.  Other lines in the input are ignored; if the file holds several
+dumps, the last one is used.
+
+Only the Python standard library is used.
+"""
+
+import json
+import re
+import struct
+import sys
+
+EVENT = struct.Struct("<IIBBH")  # time (us), obj, type, core, arg
+
+EV_SWITCH_IN = 1
+EV_ISR_ENTER = 2
+EV_ISR_EXIT = 3
+EV_QUEUE_SEND = 4
+EV_QUEUE_RECV = 5
+EV_QUEUE_BLOCK = 6
+EV_MARK = 7
+
+ISR_NAMES = {0x100: "button_gpio"}
+QUEUE_OPS = {EV_QUEUE_SEND: "send", EV_QUEUE_RECV: "recv", EV_QUEUE_BLOCK: "block"}
+
+LINE_RE = re.compile(r"@T:([HNQMEZ])\s?(.*?)\s*$")
+
+ISR_TID_BASE = 100
+
+
+class Capture:
+    def __init__(self):
+        self.header = None
+        self.tasks = {}
+        self.queues = {}
+        self.markers = {}
+        self.events = []
+        self.complete = False
+
+
+def parse(stream):
+    """Return the last capture found in the stream, or None."""
+    last = None
+    cur = None
+    for raw in stream:
+        m = LINE_RE.search(raw)
+        if not m:
+            continue
+        kind, rest = m.groups()
+        if kind == "H":
+            cur = Capture()
+            cur.header = [int(x) for x in rest.split()]
+            continue
+        if cur is None:
+            continue
+
+        if kind == "N":
+            handle, prio, name = rest.split(" ", 2)
+            cur.tasks[int(handle, 16)] = (name, int(prio))
+        elif kind == "Q":
+            handle, name = rest.split(" ", 1)
+            cur.queues[int(handle, 16)] = name
+        elif kind == "M":
+            ident, name = rest.split(" ", 1)
+            cur.markers[int(ident)] = name
+        elif kind == "E":
+            try:
+                data = bytes.fromhex(rest)
+            except ValueError:
+                continue
+            for off in range(0, len(data) - EVENT.size + 1, EVENT.size):
+                cur.events.append(EVENT.unpack_from(data, off))
+        elif kind == "Z":
+            cur.complete = True
+            last = cur
+            cur = None
+    if last is None and cur is not None:
+        sys.stderr.write("warning: dump is incomplete, converting anyway\n")
+        last = cur
+    return last
+
+
+def unwrap(events):
+    """Extend the 32-bit microsecond timestamps and rebase them to zero."""
+    out = []
+    base = 0
+    prev = None
+    for t, obj, kind, core, arg in events:
+        if prev is not None:
+            delta = (t - prev) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000  # slightly out of order across cores
+            base += delta
+        else:
+            base = 0
+        prev = t
+        out.append((base, obj, kind, core, arg))
+    if out:
+        t0 = min(e[0] for e in out)
+        out = [(e[0] - t0,) + e[1:] for e in out]
+    return out
+
+
+def convert(cap):
+    trace = []
+    cores = cap.header[2] if cap.header and len(cap.header) > 2 else 2
+
+    def task_name(handle):
+        if handle in cap.tasks:
+            return cap.tasks[handle][0]
+        return f"task@{handle:08x}"
+
+    for core in range(cores):
+        meta = {"ph": "M", "pid": 0, "name": "thread_name"}
+        trace.append(dict(meta, tid=core, args={"name": f"CPU{core}"}))
+        trace.append(
+            dict(meta, tid=ISR_TID_BASE + core, args={"name": f"CPU{core} ISR"})
+        )
+    trace.append(
+        {"ph": "M", "pid": 0, "name": "process_name", "args": {"name": "esp32"}}
+    )
+
+    running = {}  # core -> (task handle, start)
+    isr_stack = {}  # core -> [isr names]
+    events = unwrap(cap.events)
+    end = events[-1][0] if events else 0
+
+    for t, obj, kind, core, arg in events:
+        if kind == EV_SWITCH_IN:
+            prev = running.get(core)
+            if prev is not None and prev[0] != obj:
+                trace.append(slice_event(task_name(prev[0]), core, prev[1], t))
+            if prev is None or prev[0] != obj:
+                running[core] = (obj, t)
+        elif kind == EV_ISR_ENTER:
+            name = ISR_NAMES.get(arg, f"isr{arg}")
+            isr_stack.setdefault(core, []).append(name)
+            trace.append(
+                {"ph": "B", "pid": 0, "tid": ISR_TID_BASE + core,
+                 "ts": t, "name": name}
+            )
+        elif kind == EV_ISR_EXIT:
+            stack = isr_stack.get(core)
+            if not stack:
+                continue  # exit of an ISR entered before the capture
+            trace.append(
+                {"ph": "E", "pid": 0, "tid": ISR_TID_BASE + core,
+                 "ts": t, "name": stack.pop()}
+            )
+        elif kind in QUEUE_OPS:
+            queue = cap.queues.get(obj, f"q@{obj:08x}")
+            name = f"{QUEUE_OPS[kind]} {queue}"
+            if arg:
+                name += " FAILED"
+            args = {}
+            if core in running:
+                args["task"] = task_name(running[core][0])
+            trace.append(instant(name, core, t, args))
+        elif kind == EV_MARK:
+            name = cap.markers.get(arg, f"mark{arg}")
+            trace.append(instant(name, core, t, {"value": obj}))
+
+    for core, (handle, start) in running.items():
+        trace.append(slice_event(task_name(handle), core, start, end))
+
+    return {
+        "traceEvents": trace,
+        "displayTimeUnit": "ms",
+        "otherData": {
+            "events": len(cap.events),
+            "recorded": cap.header[1] if cap.header else len(cap.events),
+        },
+    }
+
+
+def slice_event(name, core, start, end):
+    return {"ph": "X", "pid": 0, "tid": core, "ts": start,
+            "dur": max(end - start, 0), "name": name}
+
+
+def instant(name, core, t, args):
+    return {"ph": "i", "s": "t", "pid": 0, "tid": core, "ts": t,
+            "name": name, "args": args}
+
+
+def main(argv):
+    if len(argv) > 2:
+        sys.stderr.write(f"usage: {argv[0]} [capture.txt]\n")
+        return 2
+
+    if len(argv) == 2:
+        with open(argv[1], "r", errors="replace") as f:
+            cap = parse(f)
+    else:
+        cap = parse(sys.stdin)
+    if cap is None:
+        sys.stderr.write("no @T: trace dump found\n")
+        return 1
+
+    if cap.header and cap.header[1] > cap.header[0]:
+        sys.stderr.write(
+            f"note: {cap.header[1] - cap.header[0]} events were not "
+            "kept (ring overwritten or one-shot full)\n"
+        )
+    json.dump(convert(cap), sys.stdout)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main(sys.argv))
+    except (BrokenPipeError, KeyboardInterrupt):
+        sys.exit(0)